@@ -1152,6 +1152,42 @@ CREATE TABLE `trends_uint` (
 	`value_max`              bigint unsigned DEFAULT '0'               NOT NULL,
 	PRIMARY KEY (itemid,clock)
 ) ENGINE=InnoDB;
+CREATE TABLE `trends_day` (
+	`itemid`                 bigint unsigned                           NOT NULL,
+	`clock`                  integer         DEFAULT '0'               NOT NULL,
+	`num`                    integer         DEFAULT '0'               NOT NULL,
+	`value_min`              DOUBLE PRECISION DEFAULT '0.0000'          NOT NULL,
+	`value_avg`              DOUBLE PRECISION DEFAULT '0.0000'          NOT NULL,
+	`value_max`              DOUBLE PRECISION DEFAULT '0.0000'          NOT NULL,
+	PRIMARY KEY (itemid,clock)
+) ENGINE=InnoDB;
+CREATE TABLE `trends_uint_day` (
+	`itemid`                 bigint unsigned                           NOT NULL,
+	`clock`                  integer         DEFAULT '0'               NOT NULL,
+	`num`                    integer         DEFAULT '0'               NOT NULL,
+	`value_min`              bigint unsigned DEFAULT '0'               NOT NULL,
+	`value_avg`              DOUBLE PRECISION DEFAULT '0.0000'          NOT NULL,
+	`value_max`              bigint unsigned DEFAULT '0'               NOT NULL,
+	PRIMARY KEY (itemid,clock)
+) ENGINE=InnoDB;
+CREATE TABLE `trends_month` (
+	`itemid`                 bigint unsigned                           NOT NULL,
+	`clock`                  integer         DEFAULT '0'               NOT NULL,
+	`num`                    integer         DEFAULT '0'               NOT NULL,
+	`value_min`              DOUBLE PRECISION DEFAULT '0.0000'          NOT NULL,
+	`value_avg`              DOUBLE PRECISION DEFAULT '0.0000'          NOT NULL,
+	`value_max`              DOUBLE PRECISION DEFAULT '0.0000'          NOT NULL,
+	PRIMARY KEY (itemid,clock)
+) ENGINE=InnoDB;
+CREATE TABLE `trends_uint_month` (
+	`itemid`                 bigint unsigned                           NOT NULL,
+	`clock`                  integer         DEFAULT '0'               NOT NULL,
+	`num`                    integer         DEFAULT '0'               NOT NULL,
+	`value_min`              bigint unsigned DEFAULT '0'               NOT NULL,
+	`value_avg`              DOUBLE PRECISION DEFAULT '0.0000'          NOT NULL,
+	`value_max`              bigint unsigned DEFAULT '0'               NOT NULL,
+	PRIMARY KEY (itemid,clock)
+) ENGINE=InnoDB;
 CREATE TABLE `acknowledges` (
 	`acknowledgeid`          bigint unsigned                           NOT NULL,
 	`userid`                 bigint unsigned                           NOT NULL,
@@ -2113,6 +2149,14 @@ CREATE TABLE `sla_service_tag` (
 	PRIMARY KEY (sla_service_tagid)
 ) ENGINE=InnoDB;
 CREATE INDEX `sla_service_tag_1` ON `sla_service_tag` (`slaid`);
+CREATE TABLE `changelog` (
+	`changelogid`            bigint unsigned                           NOT NULL auto_increment,
+	`object`                 integer         DEFAULT '0'               NOT NULL,
+	`objectid`               bigint unsigned                           NOT NULL,
+	`operation`              integer         DEFAULT '0'               NOT NULL,
+	`clock`                  integer         DEFAULT '0'               NOT NULL,
+	PRIMARY KEY (changelogid)
+) ENGINE=InnoDB;
 CREATE TABLE `dbversion` (
 	`dbversionid`            bigint unsigned                           NOT NULL,
 	`mandatory`              integer         DEFAULT '0'               NOT NULL,
@@ -2145,6 +2189,46 @@ then
 set new.name_upper=upper(new.name);
 end if;
 end;$$
+create trigger items_insert after insert on items for each row
+insert into changelog (object,objectid,operation,clock)
+values (1,new.itemid,1,unix_timestamp())
+$$
+create trigger items_update after update on items for each row
+insert into changelog (object,objectid,operation,clock)
+values (1,new.itemid,2,unix_timestamp())
+$$
+create trigger items_delete after delete on items for each row
+insert into changelog (object,objectid,operation,clock)
+values (1,old.itemid,3,unix_timestamp())
+$$
+create trigger triggers_insert after insert on triggers for each row
+insert into changelog (object,objectid,operation,clock)
+values (2,new.triggerid,1,unix_timestamp())
+$$
+create trigger triggers_update after update on triggers for each row
+begin
+if not (new.description<=>old.description and new.expression<=>old.expression and new.priority<=>old.priority and new.type<=>old.type and new.status<=>old.status and new.recovery_mode<=>old.recovery_mode and new.recovery_expression<=>old.recovery_expression and new.correlation_mode<=>old.correlation_mode and new.correlation_tag<=>old.correlation_tag and new.opdata<=>old.opdata and new.event_name<=>old.event_name and new.flags<=>old.flags)
+then
+insert into changelog (object,objectid,operation,clock)
+values (2,new.triggerid,2,unix_timestamp());
+end if;
+end;$$
+create trigger triggers_delete after delete on triggers for each row
+insert into changelog (object,objectid,operation,clock)
+values (2,old.triggerid,3,unix_timestamp())
+$$
+create trigger functions_insert after insert on functions for each row
+insert into changelog (object,objectid,operation,clock)
+values (3,new.functionid,1,unix_timestamp())
+$$
+create trigger functions_update after update on functions for each row
+insert into changelog (object,objectid,operation,clock)
+values (3,new.functionid,2,unix_timestamp())
+$$
+create trigger functions_delete after delete on functions for each row
+insert into changelog (object,objectid,operation,clock)
+values (3,old.functionid,3,unix_timestamp())
+$$
 DELIMITER ;
 ALTER TABLE `users` ADD CONSTRAINT `c_users_1` FOREIGN KEY (`roleid`) REFERENCES `role` (`roleid`) ON DELETE CASCADE;
 ALTER TABLE `hosts` ADD CONSTRAINT `c_hosts_1` FOREIGN KEY (`proxy_hostid`) REFERENCES `hosts` (`hostid`);
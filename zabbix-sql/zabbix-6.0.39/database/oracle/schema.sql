@@ -1152,6 +1152,42 @@ CREATE TABLE trends_uint (
 	value_max                number(20)      DEFAULT '0'               NOT NULL,
 	PRIMARY KEY (itemid,clock)
 );
+CREATE TABLE trends_day (
+	itemid                   number(20)                                NOT NULL,
+	clock                    number(10)      DEFAULT '0'               NOT NULL,
+	num                      number(10)      DEFAULT '0'               NOT NULL,
+	value_min                BINARY_DOUBLE   DEFAULT '0.0000'          NOT NULL,
+	value_avg                BINARY_DOUBLE   DEFAULT '0.0000'          NOT NULL,
+	value_max                BINARY_DOUBLE   DEFAULT '0.0000'          NOT NULL,
+	PRIMARY KEY (itemid,clock)
+);
+CREATE TABLE trends_uint_day (
+	itemid                   number(20)                                NOT NULL,
+	clock                    number(10)      DEFAULT '0'               NOT NULL,
+	num                      number(10)      DEFAULT '0'               NOT NULL,
+	value_min                number(20)      DEFAULT '0'               NOT NULL,
+	value_avg                BINARY_DOUBLE   DEFAULT '0.0000'          NOT NULL,
+	value_max                number(20)      DEFAULT '0'               NOT NULL,
+	PRIMARY KEY (itemid,clock)
+);
+CREATE TABLE trends_month (
+	itemid                   number(20)                                NOT NULL,
+	clock                    number(10)      DEFAULT '0'               NOT NULL,
+	num                      number(10)      DEFAULT '0'               NOT NULL,
+	value_min                BINARY_DOUBLE   DEFAULT '0.0000'          NOT NULL,
+	value_avg                BINARY_DOUBLE   DEFAULT '0.0000'          NOT NULL,
+	value_max                BINARY_DOUBLE   DEFAULT '0.0000'          NOT NULL,
+	PRIMARY KEY (itemid,clock)
+);
+CREATE TABLE trends_uint_month (
+	itemid                   number(20)                                NOT NULL,
+	clock                    number(10)      DEFAULT '0'               NOT NULL,
+	num                      number(10)      DEFAULT '0'               NOT NULL,
+	value_min                number(20)      DEFAULT '0'               NOT NULL,
+	value_avg                BINARY_DOUBLE   DEFAULT '0.0000'          NOT NULL,
+	value_max                number(20)      DEFAULT '0'               NOT NULL,
+	PRIMARY KEY (itemid,clock)
+);
 CREATE TABLE acknowledges (
 	acknowledgeid            number(20)                                NOT NULL,
 	userid                   number(20)                                NOT NULL,
@@ -2113,6 +2149,14 @@ CREATE TABLE sla_service_tag (
 	PRIMARY KEY (sla_service_tagid)
 );
 CREATE INDEX sla_service_tag_1 ON sla_service_tag (slaid);
+CREATE TABLE changelog (
+	changelogid              number(20)                                NOT NULL,
+	object                   number(10)      DEFAULT '0'               NOT NULL,
+	objectid                 number(20)                                NOT NULL,
+	operation                number(10)      DEFAULT '0'               NOT NULL,
+	clock                    number(10)      DEFAULT '0'               NOT NULL,
+	PRIMARY KEY (changelogid)
+);
 CREATE TABLE dbversion (
 	dbversionid              number(20)                                NOT NULL,
 	mandatory                number(10)      DEFAULT '0'               NOT NULL,
@@ -2156,6 +2200,18 @@ BEGIN
 SELECT proxy_autoreg_host_seq.nextval INTO :new.id FROM dual;
 END;
 /
+CREATE SEQUENCE changelog_seq
+START WITH 1
+INCREMENT BY 1
+NOMAXVALUE
+/
+CREATE TRIGGER changelog_tr
+BEFORE INSERT ON changelog
+FOR EACH ROW
+BEGIN
+SELECT changelog_seq.nextval INTO :new.changelogid FROM dual;
+END;
+/
 create trigger hosts_name_upper_insert
 before insert on hosts for each row
 begin
@@ -2186,6 +2242,69 @@ then
 end if;
 end;
 /
+create trigger items_insert
+after insert on items for each row
+begin
+insert into changelog (object,objectid,operation,clock)
+values (1,:new.itemid,1,(cast(sys_extract_utc(systimestamp) as date)-date'1970-01-01')*86400);
+end;
+/
+create trigger items_update
+after update on items for each row
+begin
+insert into changelog (object,objectid,operation,clock)
+values (1,:new.itemid,2,(cast(sys_extract_utc(systimestamp) as date)-date'1970-01-01')*86400);
+end;
+/
+create trigger items_delete
+after delete on items for each row
+begin
+insert into changelog (object,objectid,operation,clock)
+values (1,:old.itemid,3,(cast(sys_extract_utc(systimestamp) as date)-date'1970-01-01')*86400);
+end;
+/
+create trigger triggers_insert
+after insert on triggers for each row
+begin
+insert into changelog (object,objectid,operation,clock)
+values (2,:new.triggerid,1,(cast(sys_extract_utc(systimestamp) as date)-date'1970-01-01')*86400);
+end;
+/
+create trigger triggers_update
+after update of description,expression,priority,type,status,recovery_mode,recovery_expression,correlation_mode,correlation_tag,opdata,event_name,flags on triggers for each row
+begin
+insert into changelog (object,objectid,operation,clock)
+values (2,:new.triggerid,2,(cast(sys_extract_utc(systimestamp) as date)-date'1970-01-01')*86400);
+end;
+/
+create trigger triggers_delete
+after delete on triggers for each row
+begin
+insert into changelog (object,objectid,operation,clock)
+values (2,:old.triggerid,3,(cast(sys_extract_utc(systimestamp) as date)-date'1970-01-01')*86400);
+end;
+/
+create trigger functions_insert
+after insert on functions for each row
+begin
+insert into changelog (object,objectid,operation,clock)
+values (3,:new.functionid,1,(cast(sys_extract_utc(systimestamp) as date)-date'1970-01-01')*86400);
+end;
+/
+create trigger functions_update
+after update on functions for each row
+begin
+insert into changelog (object,objectid,operation,clock)
+values (3,:new.functionid,2,(cast(sys_extract_utc(systimestamp) as date)-date'1970-01-01')*86400);
+end;
+/
+create trigger functions_delete
+after delete on functions for each row
+begin
+insert into changelog (object,objectid,operation,clock)
+values (3,:old.functionid,3,(cast(sys_extract_utc(systimestamp) as date)-date'1970-01-01')*86400);
+end;
+/
 ALTER TABLE users ADD CONSTRAINT c_users_1 FOREIGN KEY (roleid) REFERENCES role (roleid) ON DELETE CASCADE;
 ALTER TABLE hosts ADD CONSTRAINT c_hosts_1 FOREIGN KEY (proxy_hostid) REFERENCES hosts (hostid);
 ALTER TABLE hosts ADD CONSTRAINT c_hosts_2 FOREIGN KEY (maintenanceid) REFERENCES maintenances (maintenanceid);
@@ -1152,6 +1152,42 @@ CREATE TABLE trends_uint (
 	value_max                numeric(20)     DEFAULT '0'               NOT NULL,
 	PRIMARY KEY (itemid,clock)
 );
+CREATE TABLE trends_day (
+	itemid                   bigint                                    NOT NULL,
+	clock                    integer         DEFAULT '0'               NOT NULL,
+	num                      integer         DEFAULT '0'               NOT NULL,
+	value_min                DOUBLE PRECISION DEFAULT '0.0000'          NOT NULL,
+	value_avg                DOUBLE PRECISION DEFAULT '0.0000'          NOT NULL,
+	value_max                DOUBLE PRECISION DEFAULT '0.0000'          NOT NULL,
+	PRIMARY KEY (itemid,clock)
+);
+CREATE TABLE trends_uint_day (
+	itemid                   bigint                                    NOT NULL,
+	clock                    integer         DEFAULT '0'               NOT NULL,
+	num                      integer         DEFAULT '0'               NOT NULL,
+	value_min                numeric(20)     DEFAULT '0'               NOT NULL,
+	value_avg                DOUBLE PRECISION DEFAULT '0.0000'          NOT NULL,
+	value_max                numeric(20)     DEFAULT '0'               NOT NULL,
+	PRIMARY KEY (itemid,clock)
+);
+CREATE TABLE trends_month (
+	itemid                   bigint                                    NOT NULL,
+	clock                    integer         DEFAULT '0'               NOT NULL,
+	num                      integer         DEFAULT '0'               NOT NULL,
+	value_min                DOUBLE PRECISION DEFAULT '0.0000'          NOT NULL,
+	value_avg                DOUBLE PRECISION DEFAULT '0.0000'          NOT NULL,
+	value_max                DOUBLE PRECISION DEFAULT '0.0000'          NOT NULL,
+	PRIMARY KEY (itemid,clock)
+);
+CREATE TABLE trends_uint_month (
+	itemid                   bigint                                    NOT NULL,
+	clock                    integer         DEFAULT '0'               NOT NULL,
+	num                      integer         DEFAULT '0'               NOT NULL,
+	value_min                numeric(20)     DEFAULT '0'               NOT NULL,
+	value_avg                DOUBLE PRECISION DEFAULT '0.0000'          NOT NULL,
+	value_max                numeric(20)     DEFAULT '0'               NOT NULL,
+	PRIMARY KEY (itemid,clock)
+);
 CREATE TABLE acknowledges (
 	acknowledgeid            bigint                                    NOT NULL,
 	userid                   bigint                                    NOT NULL,
@@ -2113,6 +2149,14 @@ CREATE TABLE sla_service_tag (
 	PRIMARY KEY (sla_service_tagid)
 );
 CREATE INDEX sla_service_tag_1 ON sla_service_tag (slaid);
+CREATE TABLE changelog (
+	changelogid              bigserial                                 NOT NULL,
+	object                   integer         DEFAULT '0'               NOT NULL,
+	objectid                 bigint                                    NOT NULL,
+	operation                integer         DEFAULT '0'               NOT NULL,
+	clock                    integer         DEFAULT '0'               NOT NULL,
+	PRIMARY KEY (changelogid)
+);
 CREATE TABLE dbversion (
 	dbversionid              bigint                                    NOT NULL,
 	mandatory                integer         DEFAULT '0'               NOT NULL,
@@ -2146,6 +2190,96 @@ for each row execute function items_name_upper_upper();
 create trigger items_name_upper_update after update 
 of name on items 
 for each row execute function items_name_upper_upper();
+create or replace function changelog_items_insert()
+returns trigger language plpgsql as $func$
+begin
+insert into changelog (object,objectid,operation,clock)
+values (1,new.itemid,1,cast(extract(epoch from now()) as int));
+return null;
+end $func$;
+create trigger items_insert after insert
+on items
+for each row execute function changelog_items_insert();
+create or replace function changelog_items_update()
+returns trigger language plpgsql as $func$
+begin
+insert into changelog (object,objectid,operation,clock)
+values (1,new.itemid,2,cast(extract(epoch from now()) as int));
+return null;
+end $func$;
+create trigger items_update after update
+on items
+for each row execute function changelog_items_update();
+create or replace function changelog_items_delete()
+returns trigger language plpgsql as $func$
+begin
+insert into changelog (object,objectid,operation,clock)
+values (1,old.itemid,3,cast(extract(epoch from now()) as int));
+return null;
+end $func$;
+create trigger items_delete after delete
+on items
+for each row execute function changelog_items_delete();
+create or replace function changelog_triggers_insert()
+returns trigger language plpgsql as $func$
+begin
+insert into changelog (object,objectid,operation,clock)
+values (2,new.triggerid,1,cast(extract(epoch from now()) as int));
+return null;
+end $func$;
+create trigger triggers_insert after insert
+on triggers
+for each row execute function changelog_triggers_insert();
+create or replace function changelog_triggers_update()
+returns trigger language plpgsql as $func$
+begin
+insert into changelog (object,objectid,operation,clock)
+values (2,new.triggerid,2,cast(extract(epoch from now()) as int));
+return null;
+end $func$;
+create trigger triggers_update after update of description,expression,priority,type,status,recovery_mode,recovery_expression,correlation_mode,correlation_tag,opdata,event_name,flags
+on triggers
+for each row execute function changelog_triggers_update();
+create or replace function changelog_triggers_delete()
+returns trigger language plpgsql as $func$
+begin
+insert into changelog (object,objectid,operation,clock)
+values (2,old.triggerid,3,cast(extract(epoch from now()) as int));
+return null;
+end $func$;
+create trigger triggers_delete after delete
+on triggers
+for each row execute function changelog_triggers_delete();
+create or replace function changelog_functions_insert()
+returns trigger language plpgsql as $func$
+begin
+insert into changelog (object,objectid,operation,clock)
+values (3,new.functionid,1,cast(extract(epoch from now()) as int));
+return null;
+end $func$;
+create trigger functions_insert after insert
+on functions
+for each row execute function changelog_functions_insert();
+create or replace function changelog_functions_update()
+returns trigger language plpgsql as $func$
+begin
+insert into changelog (object,objectid,operation,clock)
+values (3,new.functionid,2,cast(extract(epoch from now()) as int));
+return null;
+end $func$;
+create trigger functions_update after update
+on functions
+for each row execute function changelog_functions_update();
+create or replace function changelog_functions_delete()
+returns trigger language plpgsql as $func$
+begin
+insert into changelog (object,objectid,operation,clock)
+values (3,old.functionid,3,cast(extract(epoch from now()) as int));
+return null;
+end $func$;
+create trigger functions_delete after delete
+on functions
+for each row execute function changelog_functions_delete();
 ALTER TABLE ONLY users ADD CONSTRAINT c_users_1 FOREIGN KEY (roleid) REFERENCES role (roleid) ON DELETE CASCADE;
 ALTER TABLE ONLY hosts ADD CONSTRAINT c_hosts_1 FOREIGN KEY (proxy_hostid) REFERENCES hosts (hostid);
 ALTER TABLE ONLY hosts ADD CONSTRAINT c_hosts_2 FOREIGN KEY (maintenanceid) REFERENCES maintenances (maintenanceid);
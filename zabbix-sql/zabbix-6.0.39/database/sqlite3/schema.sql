@@ -1150,6 +1150,42 @@ CREATE TABLE trends_uint (
 	value_max                bigint          DEFAULT '0'               NOT NULL,
 	PRIMARY KEY (itemid,clock)
 );
+CREATE TABLE trends_day (
+	itemid                   bigint                                    NOT NULL,
+	clock                    integer         DEFAULT '0'               NOT NULL,
+	num                      integer         DEFAULT '0'               NOT NULL,
+	value_min                DOUBLE PRECISION DEFAULT '0.0000'          NOT NULL,
+	value_avg                DOUBLE PRECISION DEFAULT '0.0000'          NOT NULL,
+	value_max                DOUBLE PRECISION DEFAULT '0.0000'          NOT NULL,
+	PRIMARY KEY (itemid,clock)
+);
+CREATE TABLE trends_uint_day (
+	itemid                   bigint                                    NOT NULL,
+	clock                    integer         DEFAULT '0'               NOT NULL,
+	num                      integer         DEFAULT '0'               NOT NULL,
+	value_min                bigint          DEFAULT '0'               NOT NULL,
+	value_avg                DOUBLE PRECISION DEFAULT '0.0000'          NOT NULL,
+	value_max                bigint          DEFAULT '0'               NOT NULL,
+	PRIMARY KEY (itemid,clock)
+);
+CREATE TABLE trends_month (
+	itemid                   bigint                                    NOT NULL,
+	clock                    integer         DEFAULT '0'               NOT NULL,
+	num                      integer         DEFAULT '0'               NOT NULL,
+	value_min                DOUBLE PRECISION DEFAULT '0.0000'          NOT NULL,
+	value_avg                DOUBLE PRECISION DEFAULT '0.0000'          NOT NULL,
+	value_max                DOUBLE PRECISION DEFAULT '0.0000'          NOT NULL,
+	PRIMARY KEY (itemid,clock)
+);
+CREATE TABLE trends_uint_month (
+	itemid                   bigint                                    NOT NULL,
+	clock                    integer         DEFAULT '0'               NOT NULL,
+	num                      integer         DEFAULT '0'               NOT NULL,
+	value_min                bigint          DEFAULT '0'               NOT NULL,
+	value_avg                DOUBLE PRECISION DEFAULT '0.0000'          NOT NULL,
+	value_max                bigint          DEFAULT '0'               NOT NULL,
+	PRIMARY KEY (itemid,clock)
+);
 CREATE TABLE acknowledges (
 	acknowledgeid            bigint                                    NOT NULL,
 	userid                   bigint                                    NOT NULL REFERENCES users (userid) ON DELETE CASCADE,
@@ -2110,6 +2146,13 @@ CREATE TABLE sla_service_tag (
 	PRIMARY KEY (sla_service_tagid)
 );
 CREATE INDEX sla_service_tag_1 ON sla_service_tag (slaid);
+CREATE TABLE changelog (
+	changelogid              integer                                   NOT NULL PRIMARY KEY AUTOINCREMENT,
+	object                   integer         DEFAULT '0'               NOT NULL,
+	objectid                 bigint                                    NOT NULL,
+	operation                integer         DEFAULT '0'               NOT NULL,
+	clock                    integer         DEFAULT '0'               NOT NULL
+);
 CREATE TABLE dbversion (
 	dbversionid              bigint                                    NOT NULL,
 	mandatory                integer         DEFAULT '0'               NOT NULL,
@@ -2117,3 +2160,48 @@ CREATE TABLE dbversion (
 	PRIMARY KEY (dbversionid)
 );
 INSERT INTO dbversion VALUES ('1','6000000','6000054');
+create trigger items_insert after insert on items for each row
+begin
+insert into changelog (object,objectid,operation,clock)
+values (1,new.itemid,1,cast(strftime('%s','now') as integer));
+end;
+create trigger items_update after update on items for each row
+begin
+insert into changelog (object,objectid,operation,clock)
+values (1,new.itemid,2,cast(strftime('%s','now') as integer));
+end;
+create trigger items_delete after delete on items for each row
+begin
+insert into changelog (object,objectid,operation,clock)
+values (1,old.itemid,3,cast(strftime('%s','now') as integer));
+end;
+create trigger triggers_insert after insert on triggers for each row
+begin
+insert into changelog (object,objectid,operation,clock)
+values (2,new.triggerid,1,cast(strftime('%s','now') as integer));
+end;
+create trigger triggers_update after update of description,expression,priority,type,status,recovery_mode,recovery_expression,correlation_mode,correlation_tag,opdata,event_name,flags on triggers for each row
+begin
+insert into changelog (object,objectid,operation,clock)
+values (2,new.triggerid,2,cast(strftime('%s','now') as integer));
+end;
+create trigger triggers_delete after delete on triggers for each row
+begin
+insert into changelog (object,objectid,operation,clock)
+values (2,old.triggerid,3,cast(strftime('%s','now') as integer));
+end;
+create trigger functions_insert after insert on functions for each row
+begin
+insert into changelog (object,objectid,operation,clock)
+values (3,new.functionid,1,cast(strftime('%s','now') as integer));
+end;
+create trigger functions_update after update on functions for each row
+begin
+insert into changelog (object,objectid,operation,clock)
+values (3,new.functionid,2,cast(strftime('%s','now') as integer));
+end;
+create trigger functions_delete after delete on functions for each row
+begin
+insert into changelog (object,objectid,operation,clock)
+values (3,old.functionid,3,cast(strftime('%s','now') as integer));
+end;
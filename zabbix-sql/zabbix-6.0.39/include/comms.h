@@ -112,6 +112,9 @@ int	zbx_tcp_connect(zbx_socket_t *s, const char *source_ip, const char *ip, unsi
 		unsigned int tls_connect, const char *tls_arg1, const char *tls_arg2);
 void	zbx_socket_timeout_set(zbx_socket_t *s, int timeout);
 
+#define ZBX_TCP_HEADER_DATA		"ZBXD"
+#define ZBX_TCP_HEADER_LEN		ZBX_CONST_STRLEN(ZBX_TCP_HEADER_DATA)
+
 #define ZBX_TCP_PROTOCOL		0x01
 #define ZBX_TCP_COMPRESS		0x02
 #define ZBX_TCP_LARGE			0x04
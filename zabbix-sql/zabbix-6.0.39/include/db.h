@@ -523,6 +523,11 @@ void	DBinit_autoincrement_options(void);
 int	DBconnect(int flag);
 void	DBclose(void);
 
+#if defined(HAVE_POSTGRESQL)
+int	DBconnect_async(void);
+void	DBclose_async(void);
+#endif
+
 int	zbx_db_validate_config_features(void);
 #if defined(HAVE_MYSQL) || defined(HAVE_POSTGRESQL)
 void	zbx_db_validate_config(void);
@@ -537,6 +542,9 @@ int		DBexecute_once(const char *fmt, ...) __zbx_attr_format_printf(1, 2);
 DB_RESULT	DBselect_once(const char *fmt, ...) __zbx_attr_format_printf(1, 2);
 DB_RESULT	DBselect(const char *fmt, ...) __zbx_attr_format_printf(1, 2);
 DB_RESULT	DBselectN(const char *query, int n);
+#if defined(HAVE_POSTGRESQL)
+DB_RESULT	DBselect_prepared(const char *sql, int params_num, const char * const *params);
+#endif
 DB_ROW		DBfetch(DB_RESULT result);
 int		DBis_null(const char *field);
 void		DBbegin(void);
@@ -734,6 +742,8 @@ typedef struct
 	zbx_vector_ptr_t	rows;
 	/* index of autoincrement field */
 	int			autoincrement;
+	/* 1 - string values are stored unescaped and rows are loaded with COPY when possible */
+	unsigned char		copy;
 }
 zbx_db_insert_t;
 
@@ -743,8 +753,12 @@ void	zbx_db_insert_prepare(zbx_db_insert_t *self, const char *table, ...);
 void	zbx_db_insert_add_values_dyn(zbx_db_insert_t *self, const zbx_db_value_t **values, int values_num);
 void	zbx_db_insert_add_values(zbx_db_insert_t *self, ...);
 int	zbx_db_insert_execute(zbx_db_insert_t *self);
+#if defined(HAVE_POSTGRESQL)
+void	zbx_db_insert_format(const zbx_db_insert_t *self, char **sql, size_t *sql_alloc, size_t *sql_offset);
+#endif
 void	zbx_db_insert_clean(zbx_db_insert_t *self);
 void	zbx_db_insert_autoincrement(zbx_db_insert_t *self, const char *field_name);
+void	zbx_db_insert_use_copy(zbx_db_insert_t *self);
 int	zbx_db_get_database_type(void);
 
 /* agent (ZABBIX, SNMP, IPMI, JMX) availability data */
@@ -37,7 +37,10 @@
 #define	ZBX_POLLER_TYPE_JAVA		4
 #define	ZBX_POLLER_TYPE_HISTORY		5
 #define	ZBX_POLLER_TYPE_ODBC		6
-#define	ZBX_POLLER_TYPE_COUNT		7	/* number of poller types */
+#define	ZBX_POLLER_TYPE_AGENT		7
+#define	ZBX_POLLER_TYPE_HTTPAGENT	8
+#define	ZBX_POLLER_TYPE_SNMP		9
+#define	ZBX_POLLER_TYPE_COUNT		10	/* number of poller types */
 
 #define MAX_JAVA_ITEMS		32
 #define MAX_SNMP_ITEMS		128
@@ -60,6 +63,9 @@ extern int	CONFIG_TIMEOUT;
 extern zbx_uint64_t	CONFIG_CONF_CACHE_SIZE;
 extern zbx_uint64_t	CONFIG_HISTORY_CACHE_SIZE;
 extern zbx_uint64_t	CONFIG_HISTORY_INDEX_CACHE_SIZE;
+extern int		CONFIG_HISTORY_CACHE_SHARDS;
+extern zbx_uint64_t	CONFIG_HISTORY_RING_SIZE;
+extern int		CONFIG_CACHE_FULL_UPDATE_FREQUENCY;
 extern zbx_uint64_t	CONFIG_TRENDS_CACHE_SIZE;
 
 extern int	CONFIG_POLLER_FORKS;
@@ -73,6 +79,9 @@ extern int	CONFIG_PROXYCONFIG_FREQUENCY;
 extern int	CONFIG_PROXYDATA_FREQUENCY;
 extern int	CONFIG_HISTORYPOLLER_FORKS;
 extern int	CONFIG_ODBCPOLLER_FORKS;
+extern int	CONFIG_AGENTPOLLER_FORKS;
+extern int	CONFIG_HTTPAGENT_POLLER_FORKS;
+extern int	CONFIG_SNMPPOLLER_FORKS;
 
 typedef struct
 {
@@ -712,6 +721,13 @@ void	free_database_cache(int);
 #define ZBX_STATS_HISTORY_INDEX_FREE	19
 #define ZBX_STATS_HISTORY_INDEX_PUSED	20
 #define ZBX_STATS_HISTORY_INDEX_PFREE	21
+#define ZBX_STATS_HISTORY_RING_TOTAL	22
+#define ZBX_STATS_HISTORY_RING_USED	23
+#define ZBX_STATS_HISTORY_RING_FREE	24
+#define ZBX_STATS_HISTORY_RING_PUSED	25
+#define ZBX_STATS_HISTORY_RING_PFREE	26
+#define ZBX_STATS_HISTORY_RING_VALUES	27
+#define ZBX_STATS_HISTORY_RING_OVERFLOW	28
 void	*DCget_stats(int request);
 void	DCget_stats_all(zbx_wcache_info_t *wcache_info);
 
@@ -780,6 +796,9 @@ int	DCconfig_get_interface_by_type(DC_INTERFACE *interface, zbx_uint64_t hostid,
 int	DCconfig_get_interface(DC_INTERFACE *interface, zbx_uint64_t hostid, zbx_uint64_t itemid);
 int	DCconfig_get_poller_nextcheck(unsigned char poller_type);
 int	DCconfig_get_poller_items(unsigned char poller_type, DC_ITEM **items);
+int	DCconfig_get_async_poller_items(unsigned char poller_type, int max_items, DC_ITEM **items);
+void	DCupdate_async_poller_stats(unsigned char poller_type, int checks_delta, int queued_delta);
+void	DCget_async_poller_stats(unsigned char poller_type, int *checks, int *queued);
 #ifdef HAVE_OPENIPMI
 int	DCconfig_get_ipmi_poller_items(int now, DC_ITEM *items, int items_num, int *nextcheck);
 #endif
@@ -1087,8 +1106,37 @@ int	zbx_dc_expand_user_macros_len(const char *text, size_t text_len, zbx_uint64_
 		char **value, char **error);
 
 
+/* history cache shard diagnostic statistics */
+typedef struct
+{
+	zbx_uint64_t	items_num;
+	zbx_uint64_t	values_num;
+	zbx_uint64_t	queue_num;
+	zbx_uint64_t	data_free;
+	zbx_uint64_t	data_total;
+	zbx_uint64_t	index_free;
+	zbx_uint64_t	index_total;
+}
+zbx_hc_shard_stats_t;
+
+/* history syncer statistics, the total time in seconds spent in each stage of batch processing */
+typedef struct
+{
+	zbx_uint64_t	batches_num;
+	double		prepare;	/* taking values from history cache and preparing them */
+	double		history;	/* writing (sending, if pipelined) history */
+	double		trends;		/* updating trends */
+	double		items;		/* updating items and processing internal events */
+	double		wait;		/* waiting for pipelined history writes to complete */
+	double		triggers;	/* recalculating triggers and processing events */
+	double		export;		/* returning items to history cache, loadable modules and export */
+}
+zbx_hc_sync_stats_t;
+
 /* diagnostic data */
-void	zbx_hc_get_diag_stats(zbx_uint64_t *items_num, zbx_uint64_t *values_num);
+void	zbx_hc_get_sync_stats(zbx_hc_sync_stats_t *stats);
+void	zbx_hc_get_diag_stats(zbx_uint64_t *items_num, zbx_uint64_t *values_num, zbx_hc_shard_stats_t *shards,
+		int *shards_num);
 void	zbx_hc_get_mem_stats(zbx_mem_stats_t *data, zbx_mem_stats_t *index);
 int	zbx_hc_is_itemid_cached(zbx_uint64_t itemid);
 void	zbx_hc_get_items(zbx_vector_uint64_pair_t *items);
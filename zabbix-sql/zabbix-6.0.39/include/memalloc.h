@@ -28,10 +28,14 @@
 #define MEM_MAX_BUCKET_SIZE	256 /* starting from this size all free chunks are put into the same bucket */
 #define MEM_BUCKET_COUNT	((MEM_MAX_BUCKET_SIZE - MEM_MIN_BUCKET_SIZE) / 8 + 1)
 
+#define MEM_SLAB_MAX_SIZE	256 /* larger allocations are always taken from free chunks */
+#define MEM_SLAB_CLASS_COUNT	((MEM_SLAB_MAX_SIZE - MEM_MIN_ALLOC) / 8 + 1)
+
 typedef struct
 {
 	void		*base;
 	void		**buckets;
+	void		*slabs;		/* slab size classes, NULL if slabs are not used */
 	void		*lo_bound;
 	void		*hi_bound;
 	zbx_uint64_t	free_size;
@@ -57,15 +61,25 @@ typedef struct
 	zbx_uint64_t	min_chunk_size;
 	zbx_uint64_t	max_chunk_size;
 	zbx_uint64_t	overhead;
+	zbx_uint64_t	fragmented_size;	/* free memory outside of the largest free chunk */
 	unsigned int	chunks_num[MEM_BUCKET_COUNT];
 	unsigned int	free_chunks;
 	unsigned int	used_chunks;
+
+	/* slab statistics, memory taken by slabs is included in used_size */
+	zbx_uint64_t	slabs_size;
+	zbx_uint64_t	slabs_free_size;
+	unsigned int	slabs_num[MEM_SLAB_CLASS_COUNT];
+	unsigned int	slab_objects_num[MEM_SLAB_CLASS_COUNT];
+	unsigned int	slab_objects_used[MEM_SLAB_CLASS_COUNT];
 }
 zbx_mem_stats_t;
 
 int	zbx_mem_create(zbx_mem_info_t **info, zbx_uint64_t size, const char *descr, const char *param, int allow_oom,
 		char **error);
 void	zbx_mem_destroy(zbx_mem_info_t *info);
+void	zbx_mem_use_slabs(zbx_mem_info_t *info);
+int	zbx_mem_set_policies(int huge_pages, char **numa_policies, char **error);
 
 #define	zbx_mem_malloc(info, old, size) __zbx_mem_malloc(__FILE__, __LINE__, info, old, size)
 #define	zbx_mem_realloc(info, old, size) __zbx_mem_realloc(__FILE__, __LINE__, info, old, size)
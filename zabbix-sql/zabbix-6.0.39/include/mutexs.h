@@ -23,6 +23,12 @@
 #include "common.h"
 #include "zbxprof.h"
 
+/* the maximum number of history cache shards, see HistoryCacheShards configuration parameter */
+#define ZBX_HC_SHARDS_MAX	16
+
+/* the number of value cache item lock stripes, items are mapped to stripes by itemid */
+#define ZBX_VC_ITEM_LOCKS_NUM	32
+
 #ifdef _WINDOWS
 #	define ZBX_MUTEX_NULL		NULL
 
@@ -54,6 +60,12 @@ typedef enum
 #endif
 	ZBX_MUTEX_MODBUS,
 	ZBX_MUTEX_TREND_FUNC,
+	/* history cache shards 1..ZBX_HC_SHARDS_MAX-1, the first shard is protected by ZBX_MUTEX_CACHE */
+	ZBX_MUTEX_CACHE_SHARD,
+	ZBX_MUTEX_CACHE_SHARD_LAST = ZBX_MUTEX_CACHE_SHARD + ZBX_HC_SHARDS_MAX - 2,
+	/* value cache item lock stripes */
+	ZBX_MUTEX_VALUECACHE_ITEM,
+	ZBX_MUTEX_VALUECACHE_ITEM_LAST = ZBX_MUTEX_VALUECACHE_ITEM + ZBX_VC_ITEM_LOCKS_NUM - 1,
 	/* NOTE: Do not forget to sync changes here with mutex names in diag_add_locks_info()! */
 	ZBX_MUTEX_COUNT
 }
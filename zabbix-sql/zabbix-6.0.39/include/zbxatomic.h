@@ -0,0 +1,48 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2025 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#ifndef ZABBIX_ZBXATOMIC_H
+#define ZABBIX_ZBXATOMIC_H
+
+#include "common.h"
+
+/* Atomic operations on naturally aligned integers located in shared memory. */
+/* Available only when the compiler supports '__atomic' builtins, the code   */
+/* relying on them must provide a locking alternative otherwise.             */
+
+#if defined(HAVE_ATOMIC_BUILTINS)
+
+#define zbx_atomic_load(ptr)			__atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define zbx_atomic_load_relaxed(ptr)		__atomic_load_n(ptr, __ATOMIC_RELAXED)
+#define zbx_atomic_store(ptr, value)		__atomic_store_n(ptr, value, __ATOMIC_RELEASE)
+#define zbx_atomic_store_relaxed(ptr, value)	__atomic_store_n(ptr, value, __ATOMIC_RELAXED)
+#define zbx_atomic_fetch_add(ptr, value)	__atomic_fetch_add(ptr, value, __ATOMIC_RELAXED)
+#define zbx_atomic_fetch_sub(ptr, value)	__atomic_fetch_sub(ptr, value, __ATOMIC_RELAXED)
+
+/* sequentially consistent operations, used where a store must be ordered before a following load */
+#define zbx_atomic_exchange(ptr, value)		__atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST)
+#define zbx_atomic_fence()			__atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+/* returns non-zero value if *ptr was equal to expected and was replaced with value */
+#define zbx_atomic_cas(ptr, expected, value)								\
+		__atomic_compare_exchange_n(ptr, expected, value, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+
+#endif
+
+#endif
@@ -108,6 +108,16 @@ int	zbx_tsdb_table_has_compressed_chunks(const char *table_names);
 #define ZBX_TSDB2_HISTORY_TABLES "'history_uint','history_log','history_str','history_text','history'"
 #define ZBX_TSDB1_TRENDS_TABLES "'trends'::regclass,'trends_uint'::regclass"
 #define ZBX_TSDB2_TRENDS_TABLES "'trends','trends_uint'"
+
+int	zbx_db_copy(const char *sql, const char *data, size_t size);
+DB_RESULT	zbx_db_select_prepared(const char *sql, int params_num, const char * const *params);
+
+int	zbx_db_async_connect(char *host, char *user, char *password, char *dbname, char *dbschema, char *dbsocket,
+		int port, char *tls_connect, char *cert, char *key, char *ca, char *cipher, char *cipher_13,
+		int read_only_recoverable);
+void	zbx_db_async_close(void);
+int	zbx_db_async_send(const char *sql);
+int	zbx_db_async_wait(const char *sql, int *rows);
 #endif
 
 #ifdef HAVE_ORACLE
@@ -30,6 +30,14 @@
 
 #define ZBX_IPC_WAIT_FOREVER	-1
 
+/* the maximum number of messages returned by zbx_ipc_service_recv_batch() in typical service loops */
+#define ZBX_IPC_RECV_BATCH_SIZE	64
+
+/* message transports */
+#define ZBX_IPC_TRANSPORT_SOCKET	0
+#define ZBX_IPC_TRANSPORT_SHM		1
+#define ZBX_IPC_TRANSPORT_COUNT		2
+
 typedef struct
 {
 	/* the message code */
@@ -43,20 +51,56 @@ typedef struct
 }
 zbx_ipc_message_t;
 
+typedef struct zbx_ipc_shm_ring zbx_ipc_shm_ring_t;
+
 /* Messaging socket, providing blocking connections to IPC service. */
 /* The IPC socket api is used for simple write/read operations.     */
 typedef struct
 {
 	/* socket descriptor */
-	int		fd;
+	int			fd;
 
 	/* incoming data buffer */
-	unsigned char	rx_buffer[ZBX_IPC_SOCKET_BUFFER_SIZE];
-	zbx_uint32_t	rx_buffer_bytes;
-	zbx_uint32_t	rx_buffer_offset;
+	unsigned char		rx_buffer[ZBX_IPC_SOCKET_BUFFER_SIZE];
+	zbx_uint32_t		rx_buffer_bytes;
+	zbx_uint32_t		rx_buffer_offset;
+
+	/* the shared memory ring used to send messages to service, NULL if socket transport is used */
+	zbx_ipc_shm_ring_t	*ring;
+
+	/* small outgoing messages coalesced into a single write, NULL if coalescing is disabled */
+	unsigned char		*tx_buffer;
+	zbx_uint32_t		tx_buffer_bytes;
+
+	/* the time of the first coalesced message */
+	double			tx_time;
+
+	/* the coalescing window, seconds */
+	double			tx_window;
 }
 zbx_ipc_socket_t;
 
+typedef struct
+{
+	zbx_uint64_t	messages;
+	zbx_uint64_t	bytes;
+
+	/* the total time spent on writing messages, seconds */
+	double		time;
+}
+zbx_ipc_transport_stats_t;
+
+/* IPC statistics of the current process */
+typedef struct
+{
+	zbx_ipc_transport_stats_t	sent[ZBX_IPC_TRANSPORT_COUNT];
+	zbx_ipc_transport_stats_t	received[ZBX_IPC_TRANSPORT_COUNT];
+
+	/* the number of times writer had to wait for free space in shared memory ring */
+	zbx_uint64_t			shm_waits;
+}
+zbx_ipc_stats_t;
+
 typedef struct zbx_ipc_client zbx_ipc_client_t;
 
 /* IPC service */
@@ -93,9 +137,13 @@ zbx_ipc_async_socket_t;
 
 int	zbx_ipc_service_init_env(const char *path, char **error);
 void	zbx_ipc_service_free_env(void);
+void	zbx_ipc_set_shm_services(const char *services);
+void	zbx_ipc_get_stats(zbx_ipc_stats_t *stats);
 int	zbx_ipc_service_start(zbx_ipc_service_t *service, const char *service_name, char **error);
 int	zbx_ipc_service_recv(zbx_ipc_service_t *service, const zbx_timespec_t *timeout, zbx_ipc_client_t **client,
 		zbx_ipc_message_t **message);
+int	zbx_ipc_service_recv_batch(zbx_ipc_service_t *service, const zbx_timespec_t *timeout,
+		zbx_ipc_client_t **clients, zbx_ipc_message_t **messages, int *messages_num);
 void	zbx_ipc_service_close(zbx_ipc_service_t *service);
 
 int	zbx_ipc_client_send(zbx_ipc_client_t *client, zbx_uint32_t code, const unsigned char *data, zbx_uint32_t size);
@@ -113,6 +161,9 @@ int	zbx_ipc_socket_open(zbx_ipc_socket_t *csocket, const char *service_name, int
 void	zbx_ipc_socket_close(zbx_ipc_socket_t *csocket);
 int	zbx_ipc_socket_write(zbx_ipc_socket_t *csocket, zbx_uint32_t code, const unsigned char *data,
 		zbx_uint32_t size);
+int	zbx_ipc_socket_write_batch(zbx_ipc_socket_t *csocket, const zbx_ipc_message_t *messages, int messages_num);
+void	zbx_ipc_socket_set_coalesce(zbx_ipc_socket_t *csocket, int window_us);
+int	zbx_ipc_socket_flush(zbx_ipc_socket_t *csocket);
 int	zbx_ipc_socket_read(zbx_ipc_socket_t *csocket, zbx_ipc_message_t *message);
 int	zbx_ipc_socket_connected(const zbx_ipc_socket_t *csocket);
 
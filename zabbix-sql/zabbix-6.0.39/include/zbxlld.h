@@ -27,6 +27,8 @@ void	zbx_lld_process_value(zbx_uint64_t itemid, zbx_uint64_t hostid, const char
 
 void	zbx_lld_process_agent_result(zbx_uint64_t itemid, zbx_uint64_t hostid, AGENT_RESULT *result, zbx_timespec_t *ts, char *error);
 
+void	zbx_lld_flush(void);
+
 int	zbx_lld_get_queue_size(zbx_uint64_t *size, char **error);
 
 int	zbx_lld_get_diag_stats(zbx_uint64_t *items_num, zbx_uint64_t *values_num, char **error);
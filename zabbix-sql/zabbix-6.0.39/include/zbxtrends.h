@@ -39,6 +39,7 @@ int	zbx_parse_timeshift(time_t from, const char *timeshift, struct tm *tm, char
 
 int	zbx_trends_parse_range(time_t from, const char *param, int *start, int *end, char **error);
 int	zbx_trends_parse_nextcheck(time_t from, const char *period_shift, time_t *nextcheck, char **error);
+int	zbx_trends_rollup_clock(int clock, int shift, zbx_time_unit_t unit);
 
 int	zbx_trends_eval_avg(const char *table, zbx_uint64_t itemid, int start, int end, double *value, char **error);
 int	zbx_trends_eval_count(const char *table, zbx_uint64_t itemid, int start, int end, double *value, char **error);
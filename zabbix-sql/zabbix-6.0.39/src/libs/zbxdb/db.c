@@ -104,16 +104,32 @@ static ub4	OCI_DBserver_status(void);
 #define ORA_ERR_UNIQ_CONSTRAINT	-1
 
 #elif defined(HAVE_POSTGRESQL)
+#include "zbxalgo.h"
+
 #define ZBX_PG_READ_ONLY	"25006"
 #define ZBX_PG_UNIQUE_VIOLATION	"23505"
 #define ZBX_PG_DEADLOCK		"40P01"
 
+/* maximum number of cached prepared statements, other statements are executed unnamed */
+#define ZBX_PG_STMT_CACHE_MAX	256
+
+typedef struct
+{
+	char	*sql;
+	char	name[16];
+}
+zbx_pg_stmt_t;
+
 static PGconn			*conn = NULL;
+static PGconn			*conn_async = NULL;	/* connection for pipelined writes */
 int			ZBX_TSDB_VERSION = -1;
 static zbx_uint32_t		ZBX_PG_SVERSION = ZBX_DBVERSION_UNDEFINED;
 char				ZBX_PG_ESCAPE_BACKSLASH = 1;
 static int 			ZBX_TIMESCALE_COMPRESSION_AVAILABLE = OFF;
 static int			ZBX_PG_READ_ONLY_RECOVERABLE = 0;
+static zbx_hashset_t		pg_stmts;
+static PGconn			*pg_stmts_conn = NULL;	/* connection the cached statements belong to */
+static int			pg_stmts_seq;
 #elif defined(HAVE_SQLITE3)
 static sqlite3			*conn = NULL;
 static zbx_mutex_t		sqlite_access = ZBX_MUTEX_NULL;
@@ -985,6 +1001,112 @@ void	zbx_db_deinit(void)
 #endif
 }
 
+#if defined(HAVE_POSTGRESQL)
+static zbx_hash_t	pg_stmt_hash_func(const void *data)
+{
+	const zbx_pg_stmt_t	*stmt = (const zbx_pg_stmt_t *)data;
+
+	return ZBX_DEFAULT_STRING_HASH_FUNC(stmt->sql);
+}
+
+static int	pg_stmt_compare_func(const void *d1, const void *d2)
+{
+	const zbx_pg_stmt_t	*stmt1 = (const zbx_pg_stmt_t *)d1;
+	const zbx_pg_stmt_t	*stmt2 = (const zbx_pg_stmt_t *)d2;
+
+	return strcmp(stmt1->sql, stmt2->sql);
+}
+
+static void	pg_stmt_clean(void *data)
+{
+	zbx_pg_stmt_t	*stmt = (zbx_pg_stmt_t *)data;
+
+	zbx_free(stmt->sql);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: forget statements prepared on the current connection              *
+ *                                                                            *
+ ******************************************************************************/
+static void	pg_stmt_cache_clear(void)
+{
+	if (NULL == pg_stmts_conn)
+		return;
+
+	zbx_hashset_destroy(&pg_stmts);
+	pg_stmts_conn = NULL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get prepared statement name for the specified query, preparing    *
+ *          and caching it if necessary                                       *
+ *                                                                            *
+ * Parameters: sql   - [IN] the query with $1, $2, ... parameter placeholders *
+ *             name  - [OUT] the statement name, empty string if the query    *
+ *                           must be executed as unnamed statement            *
+ *             error - [OUT] the error message                                *
+ *                                                                            *
+ * Return value: ZBX_DB_OK   - the statement was found or prepared            *
+ *               ZBX_DB_FAIL - failed to prepare the statement                *
+ *               ZBX_DB_DOWN - database connection is lost                    *
+ *                                                                            *
+ ******************************************************************************/
+static int	pg_stmt_get(const char *sql, const char **name, char **error)
+{
+	zbx_pg_stmt_t	stmt_local, *stmt;
+	PGresult	*pg_result;
+	int		ret;
+
+	if (conn != pg_stmts_conn)
+	{
+		pg_stmt_cache_clear();
+
+		zbx_hashset_create_ext(&pg_stmts, 16, pg_stmt_hash_func, pg_stmt_compare_func, pg_stmt_clean,
+				ZBX_DEFAULT_MEM_MALLOC_FUNC, ZBX_DEFAULT_MEM_REALLOC_FUNC, ZBX_DEFAULT_MEM_FREE_FUNC);
+		pg_stmts_conn = conn;
+		pg_stmts_seq = 0;
+	}
+
+	stmt_local.sql = (char *)sql;
+
+	if (NULL != (stmt = (zbx_pg_stmt_t *)zbx_hashset_search(&pg_stmts, &stmt_local)))
+	{
+		*name = stmt->name;
+		return ZBX_DB_OK;
+	}
+
+	if (ZBX_PG_STMT_CACHE_MAX <= pg_stmts.num_data)
+	{
+		*name = "";
+		return ZBX_DB_OK;
+	}
+
+	zbx_snprintf(stmt_local.name, sizeof(stmt_local.name), "zbx_stmt_%d", ++pg_stmts_seq);
+
+	/* statements are prepared outside transaction scope and survive its rollback */
+	pg_result = PQprepare(conn, stmt_local.name, sql, 0, NULL);
+
+	if (PGRES_COMMAND_OK != PQresultStatus(pg_result))
+	{
+		zbx_postgresql_error(error, pg_result);
+		ret = (SUCCEED == is_recoverable_postgresql_error(conn, pg_result) ? ZBX_DB_DOWN : ZBX_DB_FAIL);
+	}
+	else
+	{
+		stmt_local.sql = zbx_strdup(NULL, sql);
+		stmt = (zbx_pg_stmt_t *)zbx_hashset_insert(&pg_stmts, &stmt_local, sizeof(stmt_local));
+		*name = stmt->name;
+		ret = ZBX_DB_OK;
+	}
+
+	PQclear(pg_result);
+
+	return ret;
+}
+#endif
+
 void	zbx_db_close(void)
 {
 #if defined(HAVE_MYSQL)
@@ -1043,6 +1165,10 @@ void	zbx_db_close(void)
 #elif defined(HAVE_POSTGRESQL)
 	if (NULL != conn)
 	{
+		/* prepared statements are dropped together with connection */
+		if (conn == pg_stmts_conn)
+			pg_stmt_cache_clear();
+
 		PQfinish(conn);
 		conn = NULL;
 	}
@@ -1055,6 +1181,154 @@ void	zbx_db_close(void)
 #endif
 }
 
+#if defined(HAVE_POSTGRESQL)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: open secondary connection used for pipelined writes               *
+ *                                                                            *
+ * Return value: ZBX_DB_OK - successfully connected                           *
+ *               ZBX_DB_DOWN - database is down                               *
+ *               ZBX_DB_FAIL - failed to connect                              *
+ *                                                                            *
+ * Comments: The connection is initialized in the same way as the main one,   *
+ *           but it is not used by the regular query functions. Statements    *
+ *           are sent with zbx_db_async_send() without waiting for results,   *
+ *           which are collected later with zbx_db_async_wait().              *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_db_async_connect(char *host, char *user, char *password, char *dbname, char *dbschema, char *dbsocket,
+		int port, char *tls_connect, char *cert, char *key, char *ca, char *cipher, char *cipher_13,
+		int read_only_recoverable)
+{
+	PGconn	*conn_main;
+	int	ret;
+
+	/* connecting inside transaction would mark it as failed */
+	if (0 != txn_level)
+	{
+		THIS_SHOULD_NEVER_HAPPEN;
+		return ZBX_DB_FAIL;
+	}
+
+	zbx_db_async_close();
+
+	conn_main = conn;
+	conn = NULL;
+
+	ret = zbx_db_connect(host, user, password, dbname, dbschema, dbsocket, port, tls_connect, cert, key, ca,
+			cipher, cipher_13, read_only_recoverable);
+
+	conn_async = conn;
+	conn = conn_main;
+
+	return ret;
+}
+
+void	zbx_db_async_close(void)
+{
+	if (NULL != conn_async)
+	{
+		PQfinish(conn_async);
+		conn_async = NULL;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: send statements over pipelined write connection                   *
+ *                                                                            *
+ * Parameters: sql - [IN] the statements to execute                           *
+ *                                                                            *
+ * Return value: ZBX_DB_OK - the statements were sent                         *
+ *               ZBX_DB_DOWN - the connection is not available                *
+ *               ZBX_DB_FAIL - failed to send the statements                  *
+ *                                                                            *
+ * Comments: Multiple statements sent at once are executed by the server in   *
+ *           a single implicit transaction.                                   *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_db_async_send(const char *sql)
+{
+	if (NULL == conn_async || CONNECTION_OK != PQstatus(conn_async))
+		return ZBX_DB_DOWN;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "query [async] [%s]", sql);
+
+	if (1 != PQsendQuery(conn_async, sql))
+	{
+		zbx_db_errlog(ERR_Z3005, 0, PQerrorMessage(conn_async), sql);
+		return (CONNECTION_OK == PQstatus(conn_async) ? ZBX_DB_FAIL : ZBX_DB_DOWN);
+	}
+
+	return ZBX_DB_OK;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: wait for the results of statements sent with zbx_db_async_send()  *
+ *                                                                            *
+ * Parameters: sql  - [IN] the sent statements, used for error reporting      *
+ *             rows - [OUT] the number of affected rows                       *
+ *                                                                            *
+ * Return value: ZBX_DB_OK - the statements were executed successfully        *
+ *               ZBX_DB_DOWN - the connection was lost or a recoverable error *
+ *                             occurred, the statements can be resent         *
+ *               ZBX_DB_FAIL - the statements failed, ERR_Z3008 error code    *
+ *                             is set if duplicate values were rejected       *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_db_async_wait(const char *sql, int *rows)
+{
+	PGresult	*result;
+	int		ret = ZBX_DB_OK;
+	char		*error = NULL;
+
+	*rows = 0;
+
+	if (NULL == conn_async)
+		return ZBX_DB_DOWN;
+
+	/* all results must be read before the connection can be reused */
+	while (NULL != (result = PQgetResult(conn_async)))
+	{
+		if (ZBX_DB_OK == ret)
+		{
+			if (PGRES_COMMAND_OK == PQresultStatus(result))
+			{
+				*rows += atoi(PQcmdTuples(result));
+			}
+			else
+			{
+				zbx_err_codes_t	errcode;
+
+				zbx_postgresql_error(&error, result);
+
+				if (0 == zbx_strcmp_null(PQresultErrorField(result, PG_DIAG_SQLSTATE),
+						ZBX_PG_UNIQUE_VIOLATION))
+				{
+					errcode = ERR_Z3008;
+				}
+				else
+					errcode = ERR_Z3005;
+
+				zbx_db_errlog(errcode, 0, error, sql);
+				zbx_free(error);
+
+				ret = (SUCCEED == is_recoverable_postgresql_error(conn_async, result) ? ZBX_DB_DOWN :
+						ZBX_DB_FAIL);
+			}
+		}
+
+		PQclear(result);
+	}
+
+	if (ZBX_DB_OK == ret && CONNECTION_OK != PQstatus(conn_async))
+		ret = ZBX_DB_DOWN;
+
+	return ret;
+}
+#endif
+
 /******************************************************************************
  *                                                                            *
  * Purpose: start transaction                                                 *
@@ -1649,6 +1923,112 @@ clean:
 	return ret;
 }
 
+#if defined(HAVE_POSTGRESQL)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: load rows into table with COPY FROM STDIN                         *
+ *                                                                            *
+ * Parameters: sql  - [IN] the copy statement                                 *
+ *             data - [IN] the rows in the format expected by the statement   *
+ *             size - [IN] the data size                                      *
+ *                                                                            *
+ * Return value: the number of loaded rows, ZBX_DB_FAIL or ZBX_DB_DOWN        *
+ *                                                                            *
+ * Comments: Inside transaction the copy is done within a savepoint, which is *
+ *           rolled back on failure. Unlike zbx_db_vexecute() failure does    *
+ *           not mark the transaction as failed, so the caller can load the   *
+ *           rows with regular inserts instead.                               *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_db_copy(const char *sql, const char *data, size_t size)
+{
+	PGresult	*result;
+	int		ret, rows = 0;
+	char		*error = NULL;
+	double		sec = 0;
+
+	if (ZBX_DB_OK != txn_error)
+		return ZBX_DB_FAIL;
+
+	if (0 != CONFIG_LOG_SLOW_QUERIES)
+		sec = zbx_time();
+
+	zabbix_log(LOG_LEVEL_DEBUG, "query [txnlev:%d] [%s] [" ZBX_FS_SIZE_T " bytes]", txn_level, sql,
+			(zbx_fs_size_t)size);
+
+	if (0 < txn_level && ZBX_DB_OK > (ret = zbx_db_execute("savepoint zbx_copy")))
+		return ret;
+
+	ret = ZBX_DB_OK;
+	result = PQexec(conn, sql);
+
+	if (PGRES_COPY_IN != PQresultStatus(result))
+	{
+		zbx_postgresql_error(&error, result);
+		zbx_db_errlog(ERR_Z3005, 0, error, sql);
+		zbx_free(error);
+
+		ret = (SUCCEED == is_recoverable_postgresql_error(conn, result) ? ZBX_DB_DOWN : ZBX_DB_FAIL);
+		PQclear(result);
+		goto out;
+	}
+
+	PQclear(result);
+
+	if (1 != PQputCopyData(conn, data, (int)size) || 1 != PQputCopyEnd(conn, NULL))
+	{
+		zbx_db_errlog(ERR_Z3005, 0, PQerrorMessage(conn), sql);
+		ret = (CONNECTION_OK == PQstatus(conn) ? ZBX_DB_FAIL : ZBX_DB_DOWN);
+	}
+
+	/* all results must be read before the connection can be reused */
+	while (NULL != (result = PQgetResult(conn)))
+	{
+		if (ZBX_DB_OK == ret)
+		{
+			if (PGRES_COMMAND_OK == PQresultStatus(result))
+			{
+				rows = atoi(PQcmdTuples(result));
+			}
+			else
+			{
+				zbx_err_codes_t	errcode;
+
+				zbx_postgresql_error(&error, result);
+
+				if (0 == zbx_strcmp_null(PQresultErrorField(result, PG_DIAG_SQLSTATE),
+						ZBX_PG_UNIQUE_VIOLATION))
+				{
+					errcode = ERR_Z3008;
+				}
+				else
+					errcode = ERR_Z3005;
+
+				zbx_db_errlog(errcode, 0, error, sql);
+				zbx_free(error);
+
+				ret = (SUCCEED == is_recoverable_postgresql_error(conn, result) ? ZBX_DB_DOWN :
+						ZBX_DB_FAIL);
+			}
+		}
+
+		PQclear(result);
+	}
+out:
+	if (ZBX_DB_FAIL == ret && 0 < txn_level && ZBX_DB_OK > zbx_db_execute("rollback to savepoint zbx_copy"))
+		ret = ZBX_DB_DOWN;
+
+	if (0 != CONFIG_LOG_SLOW_QUERIES)
+	{
+		sec = zbx_time() - sec;
+		if (sec > (double)CONFIG_LOG_SLOW_QUERIES / 1000.0)
+			zabbix_log(LOG_LEVEL_WARNING, "slow query: " ZBX_FS_DBL " sec, \"%s\"", sec, sql);
+	}
+
+	return (ZBX_DB_OK == ret ? rows : ret);
+}
+#endif
+
 /******************************************************************************
  *                                                                            *
  * Purpose: execute a select statement                                        *
@@ -1952,6 +2332,110 @@ clean:
 	return result;
 }
 
+#if defined(HAVE_POSTGRESQL)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: execute a select statement with parameters                        *
+ *                                                                            *
+ * Parameters: sql        - [IN] the query with $1, $2, ... placeholders      *
+ *             params_num - [IN] the number of parameters                     *
+ *             params     - [IN] the parameter values in text format          *
+ *                                                                            *
+ * Return value: data, NULL (on error) or (DB_RESULT)ZBX_DB_DOWN              *
+ *                                                                            *
+ * Comments: The query is prepared once per connection and afterwards only    *
+ *           executed with new parameter values, so the database server does  *
+ *           not have to parse and plan it again. Results are returned in     *
+ *           text format and rows are fetched with zbx_db_fetch() as usual.   *
+ *                                                                            *
+ ******************************************************************************/
+DB_RESULT	zbx_db_select_prepared(const char *sql, int params_num, const char * const *params)
+{
+	DB_RESULT	result = NULL;
+	const char	*name;
+	char		*error = NULL;
+	double		sec = 0;
+	int		ret;
+
+	if (ZBX_DB_OK != txn_error)
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "ignoring query [txnlev:%d] [%s] within failed transaction", txn_level, sql);
+		return NULL;
+	}
+
+	if (0 != CONFIG_LOG_SLOW_QUERIES)
+		sec = zbx_time();
+
+	if (SUCCEED == ZBX_CHECK_LOG_LEVEL(LOG_LEVEL_DEBUG))
+	{
+		char	*params_str = NULL;
+		size_t	params_alloc = 0, params_offset = 0;
+		int	i;
+
+		for (i = 0; i < params_num; i++)
+		{
+			zbx_snprintf_alloc(&params_str, &params_alloc, &params_offset, "%s$%d='%s'", 0 == i ? "" : ",",
+					i + 1, params[i]);
+		}
+
+		zabbix_log(LOG_LEVEL_DEBUG, "query [txnlev:%d] [%s] [%s]", txn_level, sql, ZBX_NULL2EMPTY_STR(params_str));
+		zbx_free(params_str);
+	}
+
+	if (ZBX_DB_OK != (ret = pg_stmt_get(sql, &name, &error)))
+	{
+		zbx_db_errlog(ERR_Z3005, 0, error, sql);
+		zbx_free(error);
+
+		if (ZBX_DB_DOWN == ret)
+			result = (DB_RESULT)ZBX_DB_DOWN;
+
+		goto out;
+	}
+
+	result = zbx_malloc(NULL, sizeof(struct zbx_db_result));
+	result->values = NULL;
+	result->cursor = 0;
+	result->row_num = 0;
+
+	if ('\0' == *name)
+		result->pg_result = PQexecParams(conn, sql, params_num, NULL, params, NULL, NULL, 0);
+	else
+		result->pg_result = PQexecPrepared(conn, name, params_num, params, NULL, NULL, 0);
+
+	if (NULL == result->pg_result)
+		zbx_db_errlog(ERR_Z3005, 0, "result is NULL", sql);
+
+	if (PGRES_TUPLES_OK != PQresultStatus(result->pg_result))
+	{
+		zbx_postgresql_error(&error, result->pg_result);
+		zbx_db_errlog(ERR_Z3005, 0, error, sql);
+		zbx_free(error);
+
+		ret = is_recoverable_postgresql_error(conn, result->pg_result);
+		DBfree_result(result);
+		result = (SUCCEED == ret ? (DB_RESULT)ZBX_DB_DOWN : NULL);
+	}
+	else	/* init rownum */
+		result->row_num = PQntuples(result->pg_result);
+out:
+	if (0 != CONFIG_LOG_SLOW_QUERIES)
+	{
+		sec = zbx_time() - sec;
+		if (sec > (double)CONFIG_LOG_SLOW_QUERIES / 1000.0)
+			zabbix_log(LOG_LEVEL_WARNING, "slow query: " ZBX_FS_DBL " sec, \"%s\"", sec, sql);
+	}
+
+	if (NULL == result && 0 < txn_level)
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "query [%s] failed, setting transaction as failed", sql);
+		txn_error = ZBX_DB_FAIL;
+	}
+
+	return result;
+}
+#endif
+
 /*
  * Execute SQL statement. For select statements only.
  */
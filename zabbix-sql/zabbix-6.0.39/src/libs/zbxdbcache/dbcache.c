@@ -32,14 +32,18 @@
 #include "daemon.h"
 #include "zbxavailability.h"
 #include "zbxtrends.h"
+#include "zbxatomic.h"
+#include "zbxself.h"
 #include "../zbxalgo/vectorimpl.h"
 
-static zbx_mem_info_t	*hc_index_mem = NULL;
-static zbx_mem_info_t	*hc_mem = NULL;
+static zbx_mem_info_t	*hc_index_mems[ZBX_HC_SHARDS_MAX];
+static zbx_mem_info_t	*hc_mems[ZBX_HC_SHARDS_MAX];
 static zbx_mem_info_t	*trend_mem = NULL;
 
 #define	LOCK_CACHE	zbx_mutex_lock(cache_lock)
 #define	UNLOCK_CACHE	zbx_mutex_unlock(cache_lock)
+#define	LOCK_SHARD(shard)	zbx_mutex_lock(hc_locks[(shard)->index])
+#define	UNLOCK_SHARD(shard)	zbx_mutex_unlock(hc_locks[(shard)->index])
 #define	LOCK_TRENDS	zbx_mutex_lock(trends_lock)
 #define	UNLOCK_TRENDS	zbx_mutex_unlock(trends_lock)
 #define	LOCK_CACHE_IDS		zbx_mutex_lock(cache_ids_lock)
@@ -48,18 +52,24 @@ static zbx_mem_info_t	*trend_mem = NULL;
 static zbx_mutex_t	cache_lock = ZBX_MUTEX_NULL;
 static zbx_mutex_t	trends_lock = ZBX_MUTEX_NULL;
 static zbx_mutex_t	cache_ids_lock = ZBX_MUTEX_NULL;
+static zbx_mutex_t	hc_locks[ZBX_HC_SHARDS_MAX];
 
 static char		*sql = NULL;
 static size_t		sql_alloc = 4 * ZBX_KIBIBYTE;
 
 extern unsigned char	program_type;
+extern ZBX_THREAD_LOCAL int	process_num;
 extern int		CONFIG_DOUBLE_PRECISION;
 extern char		*CONFIG_EXPORT_DIR;
+extern int		CONFIG_CACHE_SLAB_ALLOCATOR;
 
 #define ZBX_IDS_SIZE	10
 
 #define ZBX_HC_ITEMS_INIT_SIZE	1000
 
+/* the minimum size of history cache shard data and index memory segments */
+#define ZBX_HC_SHARD_SIZE_MIN	(__UINT64_C(128) * ZBX_KIBIBYTE)
+
 #define ZBX_TRENDS_CLEANUP_TIME	(SEC_PER_MIN * 55)
 
 /* the maximum time spent synchronizing history */
@@ -107,15 +117,27 @@ typedef struct
 }
 zbx_hc_proxyqueue_t;
 
+/* History cache shard. Items are distributed between shards by itemid, each shard */
+/* has its own lock, data and index memory segments, item index and sync queue.   */
 typedef struct
 {
-	zbx_hashset_t		trends;
-	ZBX_DC_STATS		stats;
-
 	zbx_hashset_t		history_items;
 	zbx_binary_heap_t	history_queue;
-
+	ZBX_DC_STATS		stats;
 	int			history_num;
+	int			index;
+}
+zbx_hc_shard_t;
+
+/* The first shard lock (cache_lock) also protects the global history cache data - */
+/* sync progress and proxy queue, which are stored in the first shard index memory. */
+typedef struct
+{
+	zbx_hashset_t		trends;
+
+	zbx_hc_shard_t		*shards[ZBX_HC_SHARDS_MAX];
+	int			shards_num;
+
 	int			trends_num;
 	int			trends_last_cleanup_hour;
 	int			history_num_total;
@@ -124,6 +146,8 @@ typedef struct
 	unsigned char		db_trigger_queue_lock;
 
 	zbx_hc_proxyqueue_t     proxyqueue;
+
+	zbx_hc_sync_stats_t	sync_stats;
 }
 ZBX_DC_CACHE;
 
@@ -172,15 +196,36 @@ static size_t		string_values_alloc = 0, string_values_offset = 0;
 static dc_item_value_t	*item_values = NULL;
 static size_t		item_values_alloc = 0, item_values_num = 0;
 
-static void	hc_add_item_values(dc_item_value_t *values, int values_num);
-static void	hc_pop_items(zbx_vector_ptr_t *history_items);
+/* process local buffers used to order values by history cache shard */
+static int		*hc_value_shards = NULL, *hc_value_index = NULL;
+static size_t		hc_value_shards_alloc = 0;
+static zbx_uint64_t	*hc_record_pos = NULL;
+static size_t		hc_record_pos_alloc = 0;
+
+static int	hc_add_item_value(zbx_hc_shard_t *shard, const dc_item_value_t *item_value, const char *strings,
+		int wait);
+static int	hc_add_item_values(zbx_hc_shard_t *shard, const dc_item_value_t *values, const int *index,
+		int index_num);
+static zbx_hc_shard_t	*hc_get_shard(zbx_uint64_t itemid);
+static int	hc_get_shard_index(zbx_uint64_t itemid);
+static void	hc_reserve_value_shards(size_t values_num);
+static void	hc_sort_values_by_shard(int values_num, int *offsets);
+static zbx_hc_shard_t	*hc_pop_shard_items(zbx_vector_ptr_t *history_items);
 static void	hc_get_item_values(ZBX_DC_HISTORY *history, zbx_vector_ptr_t *history_items);
-static void	hc_push_items(zbx_vector_ptr_t *history_items);
+static void	hc_push_items(zbx_hc_shard_t *shard, zbx_vector_ptr_t *history_items);
 static void	hc_free_item_values(ZBX_DC_HISTORY *history, int history_num);
-static void	hc_queue_item(zbx_hc_item_t *item);
+static void	hc_queue_item(zbx_hc_shard_t *shard, zbx_hc_item_t *item);
 static int	hc_queue_elem_compare_func(const void *d1, const void *d2);
 static int	hc_queue_get_size(void);
+static int	hc_get_history_num(void);
+static void	hc_get_stats(ZBX_DC_STATS *stats, zbx_uint64_t *history_free, zbx_uint64_t *history_total,
+		zbx_uint64_t *index_free, zbx_uint64_t *index_total);
 static int	hc_get_history_compression_age(void);
+static void	hc_rings_get_stats(zbx_uint64_t *total, zbx_uint64_t *used, zbx_uint64_t *values_num,
+		zbx_uint64_t *overflow_num);
+static int	hc_rings_drain(int force);
+static int	hc_rings_get_values_num(void);
+static int	hc_rings_is_itemid_queued(zbx_uint64_t itemid);
 
 ZBX_PTR_VECTOR_DECL(item_tag, zbx_tag_t)
 ZBX_PTR_VECTOR_IMPL(item_tag, zbx_tag_t)
@@ -196,21 +241,18 @@ ZBX_PTR_VECTOR_IMPL(tags, zbx_tag_t*)
  ******************************************************************************/
 void	DCget_stats_all(zbx_wcache_info_t *wcache_info)
 {
-	LOCK_CACHE;
-
-	wcache_info->stats = cache->stats;
-	wcache_info->history_free = hc_mem->free_size;
-	wcache_info->history_total = hc_mem->total_size;
-	wcache_info->index_free = hc_index_mem->free_size;
-	wcache_info->index_total = hc_index_mem->total_size;
+	hc_get_stats(&wcache_info->stats, &wcache_info->history_free, &wcache_info->history_total,
+			&wcache_info->index_free, &wcache_info->index_total);
 
 	if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
 	{
+		LOCK_CACHE;
+
 		wcache_info->trend_free = trend_mem->free_size;
 		wcache_info->trend_total = trend_mem->orig_size;
-	}
 
-	UNLOCK_CACHE;
+		UNLOCK_CACHE;
+	}
 }
 
 /******************************************************************************
@@ -223,57 +265,63 @@ void	*DCget_stats(int request)
 	static zbx_uint64_t	value_uint;
 	static double		value_double;
 	void			*ret;
+	ZBX_DC_STATS		stats;
+	zbx_uint64_t		history_free, history_total, index_free, index_total, ring_total, ring_used,
+				ring_values, ring_overflow;
+
+	hc_get_stats(&stats, &history_free, &history_total, &index_free, &index_total);
+	hc_rings_get_stats(&ring_total, &ring_used, &ring_values, &ring_overflow);
 
 	LOCK_CACHE;
 
 	switch (request)
 	{
 		case ZBX_STATS_HISTORY_COUNTER:
-			value_uint = cache->stats.history_counter;
+			value_uint = stats.history_counter;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_HISTORY_FLOAT_COUNTER:
-			value_uint = cache->stats.history_float_counter;
+			value_uint = stats.history_float_counter;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_HISTORY_UINT_COUNTER:
-			value_uint = cache->stats.history_uint_counter;
+			value_uint = stats.history_uint_counter;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_HISTORY_STR_COUNTER:
-			value_uint = cache->stats.history_str_counter;
+			value_uint = stats.history_str_counter;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_HISTORY_LOG_COUNTER:
-			value_uint = cache->stats.history_log_counter;
+			value_uint = stats.history_log_counter;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_HISTORY_TEXT_COUNTER:
-			value_uint = cache->stats.history_text_counter;
+			value_uint = stats.history_text_counter;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_NOTSUPPORTED_COUNTER:
-			value_uint = cache->stats.notsupported_counter;
+			value_uint = stats.notsupported_counter;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_HISTORY_TOTAL:
-			value_uint = hc_mem->total_size;
+			value_uint = history_total;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_HISTORY_USED:
-			value_uint = hc_mem->total_size - hc_mem->free_size;
+			value_uint = history_total - history_free;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_HISTORY_FREE:
-			value_uint = hc_mem->free_size;
+			value_uint = history_free;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_HISTORY_PUSED:
-			value_double = 100 * (double)(hc_mem->total_size - hc_mem->free_size) / hc_mem->total_size;
+			value_double = 100 * (double)(history_total - history_free) / history_total;
 			ret = (void *)&value_double;
 			break;
 		case ZBX_STATS_HISTORY_PFREE:
-			value_double = 100 * (double)hc_mem->free_size / hc_mem->total_size;
+			value_double = 100 * (double)history_free / history_total;
 			ret = (void *)&value_double;
 			break;
 		case ZBX_STATS_TREND_TOTAL:
@@ -298,26 +346,53 @@ void	*DCget_stats(int request)
 			ret = (void *)&value_double;
 			break;
 		case ZBX_STATS_HISTORY_INDEX_TOTAL:
-			value_uint = hc_index_mem->total_size;
+			value_uint = index_total;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_HISTORY_INDEX_USED:
-			value_uint = hc_index_mem->total_size - hc_index_mem->free_size;
+			value_uint = index_total - index_free;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_HISTORY_INDEX_FREE:
-			value_uint = hc_index_mem->free_size;
+			value_uint = index_free;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_HISTORY_INDEX_PUSED:
-			value_double = 100 * (double)(hc_index_mem->total_size - hc_index_mem->free_size) /
-					hc_index_mem->total_size;
+			value_double = 100 * (double)(index_total - index_free) / index_total;
 			ret = (void *)&value_double;
 			break;
 		case ZBX_STATS_HISTORY_INDEX_PFREE:
-			value_double = 100 * (double)hc_index_mem->free_size / hc_index_mem->total_size;
+			value_double = 100 * (double)index_free / index_total;
+			ret = (void *)&value_double;
+			break;
+		case ZBX_STATS_HISTORY_RING_TOTAL:
+			value_uint = ring_total;
+			ret = (void *)&value_uint;
+			break;
+		case ZBX_STATS_HISTORY_RING_USED:
+			value_uint = ring_used;
+			ret = (void *)&value_uint;
+			break;
+		case ZBX_STATS_HISTORY_RING_FREE:
+			value_uint = ring_total - ring_used;
+			ret = (void *)&value_uint;
+			break;
+		case ZBX_STATS_HISTORY_RING_PUSED:
+			value_double = 0 != ring_total ? 100 * (double)ring_used / ring_total : 0;
 			ret = (void *)&value_double;
 			break;
+		case ZBX_STATS_HISTORY_RING_PFREE:
+			value_double = 0 != ring_total ? 100 * (double)(ring_total - ring_used) / ring_total : 100;
+			ret = (void *)&value_double;
+			break;
+		case ZBX_STATS_HISTORY_RING_VALUES:
+			value_uint = ring_values;
+			ret = (void *)&value_uint;
+			break;
+		case ZBX_STATS_HISTORY_RING_OVERFLOW:
+			value_uint = ring_overflow;
+			ret = (void *)&value_uint;
+			break;
 		default:
 			ret = NULL;
 	}
@@ -405,6 +480,7 @@ static void	dc_insert_trends_in_db(ZBX_DC_TREND *trends, int trends_num, unsigne
 
 	zbx_db_insert_prepare(&db_insert, table_name, "itemid", "clock", "num", "value_min", "value_avg",
 			"value_max", (char *)NULL);
+	zbx_db_insert_use_copy(&db_insert);
 
 	for (i = 0; i < trends_num; i++)
 	{
@@ -579,6 +655,56 @@ static void	dc_trends_update_uint(ZBX_DC_TREND *trend, DB_ROW row, int num, size
 			trend->clock);
 }
 
+#if defined(HAVE_POSTGRESQL)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: select trends of the specified items and hour using prepared      *
+ *          statement                                                         *
+ *                                                                            *
+ * Comments: Item identifiers are passed as a single array parameter, so the  *
+ *           statement does not depend on the number of items.                *
+ *                                                                            *
+ ******************************************************************************/
+static DB_RESULT	dc_trends_select_prepared(const char *table_name, int clock, const zbx_uint64_t *itemids,
+		int itemids_num)
+{
+	char		sql_select[MAX_STRING_LEN], clock_str[MAX_ID_LEN + 1], *itemids_str = NULL;
+	size_t		itemids_alloc = 0, itemids_offset = 0;
+	const char	*params[2];
+	int		i;
+	DB_RESULT	result;
+
+	zbx_snprintf(sql_select, sizeof(sql_select),
+			"select itemid,num,value_min,value_avg,value_max"
+			" from %s"
+			" where clock=$1"
+				" and itemid=any($2::bigint[])"
+			" order by itemid,clock",
+			table_name);
+
+	zbx_snprintf(clock_str, sizeof(clock_str), "%d", clock);
+
+	zbx_chrcpy_alloc(&itemids_str, &itemids_alloc, &itemids_offset, '{');
+
+	for (i = 0; i < itemids_num; i++)
+	{
+		zbx_snprintf_alloc(&itemids_str, &itemids_alloc, &itemids_offset, "%s" ZBX_FS_UI64, 0 == i ? "" : ",",
+				itemids[i]);
+	}
+
+	zbx_chrcpy_alloc(&itemids_str, &itemids_alloc, &itemids_offset, '}');
+
+	params[0] = clock_str;
+	params[1] = itemids_str;
+
+	result = DBselect_prepared(sql_select, 2, params);
+
+	zbx_free(itemids_str);
+
+	return result;
+}
+#endif
+
 /******************************************************************************
  *                                                                            *
  * Purpose: helper function for DCflush trends                                *
@@ -596,6 +722,9 @@ static void	dc_trends_fetch_and_update(ZBX_DC_TREND *trends, int trends_num, zbx
 	ZBX_DC_TREND	*trend;
 	size_t		sql_offset;
 
+#if defined(HAVE_POSTGRESQL)
+	result = dc_trends_select_prepared(table_name, clock, itemids, itemids_num);
+#else
 	sql_offset = 0;
 	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
 			"select itemid,num,value_min,value_avg,value_max"
@@ -606,6 +735,7 @@ static void	dc_trends_fetch_and_update(ZBX_DC_TREND *trends, int trends_num, zbx
 	DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "itemid", itemids, itemids_num);
 
 	result = DBselect("%s order by itemid,clock", sql);
+#endif
 
 	sql_offset = 0;
 	DBbegin_multiple_update(&sql, &sql_alloc, &sql_offset);
@@ -966,192 +1096,567 @@ static int	zbx_trend_compare(const void *d1, const void *d2)
 	return 0;
 }
 
+/* the trends aggregated over a day or month */
+typedef struct
+{
+	zbx_uint64_t	itemid;
+	int		clock;
+	int		num;
+	history_value_t	value_min;
+	double		value_avg;
+	history_value_t	value_max;
+	unsigned char	value_type;
+	unsigned char	exists;
+}
+zbx_trend_rollup_t;
+
+static int	zbx_trend_rollup_compare(const void *d1, const void *d2)
+{
+	const zbx_trend_rollup_t	*p1 = (const zbx_trend_rollup_t *)d1;
+	const zbx_trend_rollup_t	*p2 = (const zbx_trend_rollup_t *)d2;
+
+	ZBX_RETURN_IF_NOT_EQUAL(p1->value_type, p2->value_type);
+	ZBX_RETURN_IF_NOT_EQUAL(p1->clock, p2->clock);
+	ZBX_RETURN_IF_NOT_EQUAL(p1->itemid, p2->itemid);
+
+	return 0;
+}
+
 /******************************************************************************
  *                                                                            *
- * Purpose: prepare history data using items from configuration cache         *
+ * Purpose: merge aggregated values into trends rollup                        *
  *                                                                            *
- * Parameters: trends      - [IN] trends from cache to be added to database   *
- *             trends_num  - [IN] number of trends to add to database         *
- *             trends_diff - [OUT] disable_from updates                       *
+ * Parameters: rollup    - [IN/OUT] the trends rollup                         *
+ *             num       - [IN] the number of aggregated values               *
+ *             value_min - [IN] the minimum value                             *
+ *             value_avg - [IN] the average value                             *
+ *             value_max - [IN] the maximum value                             *
  *                                                                            *
  ******************************************************************************/
-static void	DBmass_update_trends(const ZBX_DC_TREND *trends, int trends_num,
-		zbx_vector_uint64_pair_t *trends_diff)
+static void	dc_trend_rollup_merge(zbx_trend_rollup_t *rollup, int num, const history_value_t *value_min,
+		double value_avg, const history_value_t *value_max)
 {
-	ZBX_DC_TREND	*trends_tmp;
+	if (0 == rollup->num)
+	{
+		rollup->value_min = *value_min;
+		rollup->value_avg = value_avg;
+		rollup->value_max = *value_max;
+		rollup->num = num;
 
-	if (0 != trends_num)
+		return;
+	}
+
+	if (ITEM_VALUE_TYPE_FLOAT == rollup->value_type)
 	{
-		trends_tmp = (ZBX_DC_TREND *)zbx_malloc(NULL, trends_num * sizeof(ZBX_DC_TREND));
-		memcpy(trends_tmp, trends, trends_num * sizeof(ZBX_DC_TREND));
-		qsort(trends_tmp, trends_num, sizeof(ZBX_DC_TREND), zbx_trend_compare);
+		if (value_min->dbl < rollup->value_min.dbl)
+			rollup->value_min.dbl = value_min->dbl;
 
-		while (0 < trends_num)
-			DBflush_trends(trends_tmp, &trends_num, trends_diff);
+		if (value_max->dbl > rollup->value_max.dbl)
+			rollup->value_max.dbl = value_max->dbl;
+	}
+	else
+	{
+		if (value_min->ui64 < rollup->value_min.ui64)
+			rollup->value_min.ui64 = value_min->ui64;
 
-		zbx_free(trends_tmp);
+		if (value_max->ui64 > rollup->value_max.ui64)
+			rollup->value_max.ui64 = value_max->ui64;
 	}
+
+	rollup->value_avg = rollup->value_avg / (rollup->num + num) * rollup->num +
+			value_avg / (rollup->num + num) * num;
+	rollup->num += num;
 }
 
-typedef struct
+/******************************************************************************
+ *                                                                            *
+ * Purpose: merge trends database row into trends rollup                      *
+ *                                                                            *
+ * Parameters: rollup - [IN/OUT] the trends rollup                            *
+ *             row    - [IN] itemid,num,value_min,value_avg,value_max row     *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_trend_rollup_merge_row(zbx_trend_rollup_t *rollup, DB_ROW row)
 {
-	zbx_uint64_t		hostid;
-	zbx_vector_ptr_t	groups;
+	history_value_t	value_min, value_max;
+
+	if (ITEM_VALUE_TYPE_FLOAT == rollup->value_type)
+	{
+		value_min.dbl = atof(row[2]);
+		value_max.dbl = atof(row[4]);
+	}
+	else
+	{
+		ZBX_STR2UINT64(value_min.ui64, row[2]);
+		ZBX_STR2UINT64(value_max.ui64, row[4]);
+	}
+
+	dc_trend_rollup_merge(rollup, atoi(row[1]), &value_min, atof(row[3]), &value_max);
 }
-zbx_host_info_t;
 
 /******************************************************************************
  *                                                                            *
- * Purpose: frees resources allocated to store host groups names              *
+ * Purpose: find trends rollup of the item in trends database row             *
  *                                                                            *
- * Parameters: host_info - [IN] host information                              *
+ * Parameters: rollups     - [IN] the trends rollups of the same period and   *
+ *                                value type sorted by itemid                 *
+ *             rollups_num - [IN] the number of trends rollups                *
+ *             row         - [IN] the trends database row                     *
+ *                                                                            *
+ * Return value: the trends rollup or NULL if it was not found                *
  *                                                                            *
  ******************************************************************************/
-static void	zbx_host_info_clean(zbx_host_info_t *host_info)
+static zbx_trend_rollup_t	*dc_trend_rollup_search(zbx_trend_rollup_t *rollups, int rollups_num, DB_ROW row)
 {
-	zbx_vector_ptr_clear_ext(&host_info->groups, zbx_ptr_free);
-	zbx_vector_ptr_destroy(&host_info->groups);
+	zbx_trend_rollup_t	rollup_local;
+
+	ZBX_STR2UINT64(rollup_local.itemid, row[0]);
+	rollup_local.clock = rollups[0].clock;
+	rollup_local.value_type = rollups[0].value_type;
+
+	return (zbx_trend_rollup_t *)bsearch(&rollup_local, rollups, rollups_num, sizeof(zbx_trend_rollup_t),
+			zbx_trend_rollup_compare);
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: get hosts groups names                                            *
+ * Purpose: flush trends rollups of the same period and value type to the     *
+ *          database                                                          *
  *                                                                            *
- * Parameters: hosts_info - [IN/OUT] output names of host groups for a host   *
- *             hostids    - [IN] hosts identifiers                            *
+ * Parameters: rollups     - [IN/OUT] the trends rollups sorted by itemid     *
+ *             rollups_num - [IN] the number of trends rollups                *
+ *             unit        - [IN] the rollup period unit                      *
+ *             suffix      - [IN] the rollup table name suffix                *
+ *                                                                            *
+ * Comments: Existing rollup rows are updated with the rollups of flushed     *
+ *           trends. Missing rollup rows are created from the hourly trends   *
+ *           of their period, which already include the flushed trends, so    *
+ *           the periods started before the rollup was created are complete.  *
  *                                                                            *
  ******************************************************************************/
-static void	db_get_hosts_info_by_hostid(zbx_hashset_t *hosts_info, const zbx_vector_uint64_t *hostids)
+static void	dc_trends_rollup_flush(zbx_trend_rollup_t *rollups, int rollups_num, zbx_time_unit_t unit,
+		const char *suffix)
 {
-	int			i;
-	size_t			sql_offset = 0;
+	const char		*trends_table;
+	char			table_name[ZBX_TABLENAME_LEN_MAX];
+	int			i, clock = rollups[0].clock;
+	size_t			sql_offset;
+	zbx_vector_uint64_t	itemids;
 	DB_RESULT		result;
 	DB_ROW			row;
-	zbx_host_info_t		*host_info;
-	zbx_hashset_iter_t	iter;
+	zbx_trend_rollup_t	*rollup;
+	zbx_db_insert_t		db_insert;
 
-	for (i = 0; i < hostids->values_num; i++)
-	{
-		zbx_host_info_t	host_info_new = {.hostid = hostids->values[i]};
+	trends_table = (ITEM_VALUE_TYPE_FLOAT == rollups[0].value_type ? "trends" : "trends_uint");
+	zbx_snprintf(table_name, sizeof(table_name), "%s_%s", trends_table, suffix);
 
-		zbx_vector_ptr_create(&host_info_new.groups);
-		zbx_hashset_insert(hosts_info, &host_info_new, sizeof(host_info_new));
-	}
+	zbx_vector_uint64_create(&itemids);
+	zbx_vector_uint64_reserve(&itemids, rollups_num);
 
-	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
-				"select distinct hg.hostid,g.name"
-				" from hstgrp g,hosts_groups hg"
-				" where g.groupid=hg.groupid"
-					" and");
+	for (i = 0; i < rollups_num; i++)
+		zbx_vector_uint64_append(&itemids, rollups[i].itemid);
 
-	DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "hg.hostid", hostids->values, hostids->values_num);
+	sql_offset = 0;
+	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
+			"select itemid,num,value_min,value_avg,value_max"
+			" from %s"
+			" where clock=%d and",
+			table_name, clock);
+	DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "itemid", itemids.values, itemids.values_num);
 
 	result = DBselect("%s", sql);
 
+	sql_offset = 0;
+	DBbegin_multiple_update(&sql, &sql_alloc, &sql_offset);
+
 	while (NULL != (row = DBfetch(result)))
 	{
-		zbx_uint64_t	hostid;
-
-		ZBX_DBROW2UINT64(hostid, row[0]);
-
-		if (NULL == (host_info = (zbx_host_info_t *)zbx_hashset_search(hosts_info, &hostid)))
+		if (NULL == (rollup = dc_trend_rollup_search(rollups, rollups_num, row)))
 		{
 			THIS_SHOULD_NEVER_HAPPEN;
 			continue;
 		}
 
-		zbx_vector_ptr_append(&host_info->groups, zbx_strdup(NULL, row[1]));
-	}
+		dc_trend_rollup_merge_row(rollup, row);
+		rollup->exists = 1;
 
-	zbx_hashset_iter_reset(hosts_info, &iter);
-	while (NULL != (host_info = (zbx_host_info_t *)zbx_hashset_iter_next(&iter)))
-		zbx_vector_ptr_sort(&host_info->groups, ZBX_DEFAULT_STR_COMPARE_FUNC);
+		if (ITEM_VALUE_TYPE_FLOAT == rollup->value_type)
+		{
+			zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, "update %s set"
+					" num=%d,value_min=" ZBX_FS_DBL64_SQL ",value_avg=" ZBX_FS_DBL64_SQL
+					",value_max=" ZBX_FS_DBL64_SQL
+					" where itemid=" ZBX_FS_UI64 " and clock=%d;\n",
+					table_name, rollup->num, rollup->value_min.dbl, rollup->value_avg,
+					rollup->value_max.dbl, rollup->itemid, rollup->clock);
+		}
+		else
+		{
+			zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, "update %s set"
+					" num=%d,value_min=" ZBX_FS_UI64 ",value_avg=" ZBX_FS_DBL64_SQL
+					",value_max=" ZBX_FS_UI64
+					" where itemid=" ZBX_FS_UI64 " and clock=%d;\n",
+					table_name, rollup->num, rollup->value_min.ui64, rollup->value_avg,
+					rollup->value_max.ui64, rollup->itemid, rollup->clock);
+		}
 
-	DBfree_result(result);
-}
+		DBexecute_overflowed_sql(&sql, &sql_alloc, &sql_offset);
+	}
 
-typedef struct
-{
-	zbx_uint64_t		itemid;
-	char			*name;
-	zbx_history_sync_item_t	*item;
-	zbx_vector_item_tag_t	item_tags;
-}
-zbx_item_info_t;
+	DBfree_result(result);
 
-/******************************************************************************
- *                                                                            *
- * Purpose: get items name and item tags                                      *
- *                                                                            *
- * Parameters: items_info - [IN/OUT] output item name and item tags           *
- *             itemids    - [IN] the item identifiers                         *
- *                                                                            *
- ******************************************************************************/
-static void	db_get_items_info_by_itemid(zbx_hashset_t *items_info, const zbx_vector_uint64_t *itemids)
-{
-	size_t		sql_offset = 0;
-	DB_RESULT	result;
-	DB_ROW		row;
+	DBend_multiple_update(&sql, &sql_alloc, &sql_offset);
 
-	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, "select itemid,name from items where");
-	DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "itemid", itemids->values, itemids->values_num);
+	if (sql_offset > 16)	/* In ORACLE always present begin..end; */
+		DBexecute("%s", sql);
 
-	result = DBselect("%s", sql);
+	/* roll up the hourly trends of the missing rollup periods */
+	zbx_vector_uint64_clear(&itemids);
 
-	while (NULL != (row = DBfetch(result)))
+	for (i = 0; i < rollups_num; i++)
 	{
-		zbx_uint64_t	itemid;
-		zbx_item_info_t	*item_info;
-
-		ZBX_DBROW2UINT64(itemid, row[0]);
-
-		if (NULL == (item_info = (zbx_item_info_t *)zbx_hashset_search(items_info, &itemid)))
-		{
-			THIS_SHOULD_NEVER_HAPPEN;
+		if (0 != rollups[i].exists)
 			continue;
-		}
 
-		item_info->name = zbx_strdup(item_info->name, row[1]);
+		rollups[i].num = 0;
+		zbx_vector_uint64_append(&itemids, rollups[i].itemid);
 	}
-	DBfree_result(result);
+
+	if (0 == itemids.values_num)
+		goto out;
 
 	sql_offset = 0;
 	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
-			"select itemid,tag,value from item_tag where");
-
-	DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "itemid", itemids->values, itemids->values_num);
+			"select itemid,num,value_min,value_avg,value_max"
+			" from %s"
+			" where clock>=%d"
+				" and clock<%d"
+				" and",
+			trends_table, clock, zbx_trends_rollup_clock(clock, 1, unit));
+	DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "itemid", itemids.values, itemids.values_num);
 
 	result = DBselect("%s", sql);
 
 	while (NULL != (row = DBfetch(result)))
 	{
-		zbx_uint64_t	itemid;
-		zbx_item_info_t	*item_info;
-		zbx_tag_t	item_tag;
-
-		ZBX_DBROW2UINT64(itemid, row[0]);
-
-		if (NULL == (item_info = (zbx_item_info_t *)zbx_hashset_search(items_info, &itemid)))
+		if (NULL == (rollup = dc_trend_rollup_search(rollups, rollups_num, row)))
 		{
 			THIS_SHOULD_NEVER_HAPPEN;
 			continue;
 		}
 
-		item_tag.tag = zbx_strdup(NULL, row[1]);
-		item_tag.value = zbx_strdup(NULL, row[2]);
-		zbx_vector_item_tag_append(&item_info->item_tags, item_tag);
+		dc_trend_rollup_merge_row(rollup, row);
 	}
+
 	DBfree_result(result);
+
+	zbx_db_insert_prepare(&db_insert, table_name, "itemid", "clock", "num", "value_min", "value_avg",
+			"value_max", (char *)NULL);
+
+	for (i = 0; i < rollups_num; i++)
+	{
+		rollup = &rollups[i];
+
+		/* the flushed hourly trends must be present, check just in case */
+		if (0 != rollup->exists || 0 == rollup->num)
+			continue;
+
+		if (ITEM_VALUE_TYPE_FLOAT == rollup->value_type)
+		{
+			zbx_db_insert_add_values(&db_insert, rollup->itemid, rollup->clock, rollup->num,
+					rollup->value_min.dbl, rollup->value_avg, rollup->value_max.dbl);
+		}
+		else
+		{
+			zbx_db_insert_add_values(&db_insert, rollup->itemid, rollup->clock, rollup->num,
+					rollup->value_min.ui64, rollup->value_avg, rollup->value_max.ui64);
+		}
+	}
+
+	zbx_db_insert_execute(&db_insert);
+	zbx_db_insert_clean(&db_insert);
+out:
+	zbx_vector_uint64_destroy(&itemids);
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: frees resources allocated to store item tag                       *
+ * Purpose: update trends rollup tables with flushed trends                   *
  *                                                                            *
- * Parameters: item_tag - [IN] item tag                                       *
+ * Parameters: trends     - [IN] the flushed trends                           *
+ *             trends_num - [IN] the number of flushed trends                 *
+ *             unit       - [IN] the rollup period unit (day or month)        *
+ *             suffix     - [IN] the rollup table name suffix                 *
+ *                                                                            *
+ * Comments: Must be called after the trends were flushed to the hourly       *
+ *           trends tables in the same transaction.                           *
  *                                                                            *
  ******************************************************************************/
-static void	item_tag_free(zbx_tag_t item_tag)
+static void	DBupdate_trends_rollup(const ZBX_DC_TREND *trends, int trends_num, zbx_time_unit_t unit,
+		const char *suffix)
+{
+	zbx_trend_rollup_t	*rollups;
+	int			rollups_num = 0, i, j, hour = 0, clock = 0;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() unit:%d trends_num:%d", __func__, (int)unit, trends_num);
+
+	rollups = (zbx_trend_rollup_t *)zbx_malloc(NULL, trends_num * sizeof(zbx_trend_rollup_t));
+
+	for (i = 0; i < trends_num; i++)
+	{
+		const ZBX_DC_TREND	*trend = &trends[i];
+		zbx_trend_rollup_t	*rollup = &rollups[rollups_num++];
+		double			value_avg;
+
+		/* trends are flushed mostly for the same hour, avoid converting it again */
+		if (hour != trend->clock)
+		{
+			hour = trend->clock;
+			clock = zbx_trends_rollup_clock(hour, 0, unit);
+		}
+
+		if (ITEM_VALUE_TYPE_FLOAT == trend->value_type)
+		{
+			value_avg = trend->value_avg.dbl;
+		}
+		else
+		{
+			/* unsigned trends cache holds the sum of values */
+			value_avg = ((double)trend->value_avg.ui64.hi * ((double)ZBX_MAX_UINT64 + 1) +
+					(double)trend->value_avg.ui64.lo) / trend->num;
+		}
+
+		rollup->itemid = trend->itemid;
+		rollup->clock = clock;
+		rollup->value_type = trend->value_type;
+		rollup->exists = 0;
+		rollup->num = 0;
+
+		dc_trend_rollup_merge(rollup, trend->num, &trend->value_min, value_avg, &trend->value_max);
+	}
+
+	qsort(rollups, rollups_num, sizeof(zbx_trend_rollup_t), zbx_trend_rollup_compare);
+
+	/* merge trends of the same item and rollup period */
+	for (i = 1, j = 0; i < rollups_num; i++)
+	{
+		if (0 == zbx_trend_rollup_compare(&rollups[j], &rollups[i]))
+		{
+			dc_trend_rollup_merge(&rollups[j], rollups[i].num, &rollups[i].value_min, rollups[i].value_avg,
+					&rollups[i].value_max);
+		}
+		else
+			rollups[++j] = rollups[i];
+	}
+
+	if (0 != rollups_num)
+		rollups_num = j + 1;
+
+	for (i = 0; i < rollups_num; i = j)
+	{
+		for (j = i + 1; j < rollups_num; j++)
+		{
+			if (rollups[i].clock != rollups[j].clock || rollups[i].value_type != rollups[j].value_type)
+				break;
+		}
+
+		dc_trends_rollup_flush(rollups + i, j - i, unit, suffix);
+	}
+
+	zbx_free(rollups);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: prepare history data using items from configuration cache         *
+ *                                                                            *
+ * Parameters: trends      - [IN] trends from cache to be added to database   *
+ *             trends_num  - [IN] number of trends to add to database         *
+ *             trends_diff - [OUT] disable_from updates                       *
+ *                                                                            *
+ ******************************************************************************/
+static void	DBmass_update_trends(const ZBX_DC_TREND *trends, int trends_num,
+		zbx_vector_uint64_pair_t *trends_diff)
+{
+	ZBX_DC_TREND	*trends_tmp;
+	int		trends_tmp_num = trends_num;
+
+	if (0 != trends_num)
+	{
+		trends_tmp = (ZBX_DC_TREND *)zbx_malloc(NULL, trends_num * sizeof(ZBX_DC_TREND));
+		memcpy(trends_tmp, trends, trends_num * sizeof(ZBX_DC_TREND));
+		qsort(trends_tmp, trends_num, sizeof(ZBX_DC_TREND), zbx_trend_compare);
+
+		while (0 < trends_tmp_num)
+			DBflush_trends(trends_tmp, &trends_tmp_num, trends_diff);
+
+		zbx_free(trends_tmp);
+
+		DBupdate_trends_rollup(trends, trends_num, ZBX_TIME_UNIT_DAY, "day");
+		DBupdate_trends_rollup(trends, trends_num, ZBX_TIME_UNIT_MONTH, "month");
+	}
+}
+
+typedef struct
+{
+	zbx_uint64_t		hostid;
+	zbx_vector_ptr_t	groups;
+}
+zbx_host_info_t;
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: frees resources allocated to store host groups names              *
+ *                                                                            *
+ * Parameters: host_info - [IN] host information                              *
+ *                                                                            *
+ ******************************************************************************/
+static void	zbx_host_info_clean(zbx_host_info_t *host_info)
+{
+	zbx_vector_ptr_clear_ext(&host_info->groups, zbx_ptr_free);
+	zbx_vector_ptr_destroy(&host_info->groups);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get hosts groups names                                            *
+ *                                                                            *
+ * Parameters: hosts_info - [IN/OUT] output names of host groups for a host   *
+ *             hostids    - [IN] hosts identifiers                            *
+ *                                                                            *
+ ******************************************************************************/
+static void	db_get_hosts_info_by_hostid(zbx_hashset_t *hosts_info, const zbx_vector_uint64_t *hostids)
+{
+	int			i;
+	size_t			sql_offset = 0;
+	DB_RESULT		result;
+	DB_ROW			row;
+	zbx_host_info_t		*host_info;
+	zbx_hashset_iter_t	iter;
+
+	for (i = 0; i < hostids->values_num; i++)
+	{
+		zbx_host_info_t	host_info_new = {.hostid = hostids->values[i]};
+
+		zbx_vector_ptr_create(&host_info_new.groups);
+		zbx_hashset_insert(hosts_info, &host_info_new, sizeof(host_info_new));
+	}
+
+	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
+				"select distinct hg.hostid,g.name"
+				" from hstgrp g,hosts_groups hg"
+				" where g.groupid=hg.groupid"
+					" and");
+
+	DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "hg.hostid", hostids->values, hostids->values_num);
+
+	result = DBselect("%s", sql);
+
+	while (NULL != (row = DBfetch(result)))
+	{
+		zbx_uint64_t	hostid;
+
+		ZBX_DBROW2UINT64(hostid, row[0]);
+
+		if (NULL == (host_info = (zbx_host_info_t *)zbx_hashset_search(hosts_info, &hostid)))
+		{
+			THIS_SHOULD_NEVER_HAPPEN;
+			continue;
+		}
+
+		zbx_vector_ptr_append(&host_info->groups, zbx_strdup(NULL, row[1]));
+	}
+
+	zbx_hashset_iter_reset(hosts_info, &iter);
+	while (NULL != (host_info = (zbx_host_info_t *)zbx_hashset_iter_next(&iter)))
+		zbx_vector_ptr_sort(&host_info->groups, ZBX_DEFAULT_STR_COMPARE_FUNC);
+
+	DBfree_result(result);
+}
+
+typedef struct
+{
+	zbx_uint64_t		itemid;
+	char			*name;
+	zbx_history_sync_item_t	*item;
+	zbx_vector_item_tag_t	item_tags;
+}
+zbx_item_info_t;
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get items name and item tags                                      *
+ *                                                                            *
+ * Parameters: items_info - [IN/OUT] output item name and item tags           *
+ *             itemids    - [IN] the item identifiers                         *
+ *                                                                            *
+ ******************************************************************************/
+static void	db_get_items_info_by_itemid(zbx_hashset_t *items_info, const zbx_vector_uint64_t *itemids)
+{
+	size_t		sql_offset = 0;
+	DB_RESULT	result;
+	DB_ROW		row;
+
+	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, "select itemid,name from items where");
+	DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "itemid", itemids->values, itemids->values_num);
+
+	result = DBselect("%s", sql);
+
+	while (NULL != (row = DBfetch(result)))
+	{
+		zbx_uint64_t	itemid;
+		zbx_item_info_t	*item_info;
+
+		ZBX_DBROW2UINT64(itemid, row[0]);
+
+		if (NULL == (item_info = (zbx_item_info_t *)zbx_hashset_search(items_info, &itemid)))
+		{
+			THIS_SHOULD_NEVER_HAPPEN;
+			continue;
+		}
+
+		item_info->name = zbx_strdup(item_info->name, row[1]);
+	}
+	DBfree_result(result);
+
+	sql_offset = 0;
+	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
+			"select itemid,tag,value from item_tag where");
+
+	DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "itemid", itemids->values, itemids->values_num);
+
+	result = DBselect("%s", sql);
+
+	while (NULL != (row = DBfetch(result)))
+	{
+		zbx_uint64_t	itemid;
+		zbx_item_info_t	*item_info;
+		zbx_tag_t	item_tag;
+
+		ZBX_DBROW2UINT64(itemid, row[0]);
+
+		if (NULL == (item_info = (zbx_item_info_t *)zbx_hashset_search(items_info, &itemid)))
+		{
+			THIS_SHOULD_NEVER_HAPPEN;
+			continue;
+		}
+
+		item_tag.tag = zbx_strdup(NULL, row[1]);
+		item_tag.value = zbx_strdup(NULL, row[2]);
+		zbx_vector_item_tag_append(&item_info->item_tags, item_tag);
+	}
+	DBfree_result(result);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: frees resources allocated to store item tag                       *
+ *                                                                            *
+ * Parameters: item_tag - [IN] item tag                                       *
+ *                                                                            *
+ ******************************************************************************/
+static void	item_tag_free(zbx_tag_t item_tag)
 {
 	zbx_free(item_tag.tag);
 	zbx_free(item_tag.value);
@@ -1602,14 +2107,8 @@ static void	DCsync_trends(void)
 	if (SUCCEED == zbx_is_export_enabled(ZBX_FLAG_EXPTYPE_TRENDS) && 0 != trends_num)
 		DCexport_all_trends(trends, trends_num);
 
-	if (0 < trends_num)
-		qsort(trends, trends_num, sizeof(ZBX_DC_TREND), zbx_trend_compare);
-
 	DBbegin();
-
-	while (trends_num > 0)
-		DBflush_trends(trends, &trends_num, NULL);
-
+	DBmass_update_trends(trends, trends_num, NULL);
 	DBcommit();
 
 	zbx_free(trends);
@@ -2305,7 +2804,7 @@ static int	add_history(ZBX_DC_HISTORY *history, int history_num, zbx_vector_ptr_
 	}
 
 	if (0 != history_values->values_num)
-		ret = zbx_vc_add_values(history_values, ret_flush);
+		ret = zbx_history_add_values(history_values, ret_flush);
 
 	return ret;
 }
@@ -2346,6 +2845,38 @@ static int	DBmass_add_history(ZBX_DC_HISTORY *history, int history_num)
 	return ret;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: add history values written to history storage to value cache      *
+ *                                                                            *
+ * Parameters: history     - array of history data                            *
+ *             history_num - number of history structures                     *
+ *                                                                            *
+ ******************************************************************************/
+static void	DCmass_add_value_cache(ZBX_DC_HISTORY *history, int history_num)
+{
+	int			i;
+	zbx_vector_ptr_t	history_values;
+
+	zbx_vector_ptr_create(&history_values);
+	zbx_vector_ptr_reserve(&history_values, history_num);
+
+	for (i = 0; i < history_num; i++)
+	{
+		ZBX_DC_HISTORY	*h = &history[i];
+
+		if (0 != (ZBX_DC_FLAGS_NOT_FOR_HISTORY & h->flags))
+			continue;
+
+		zbx_vector_ptr_append(&history_values, h);
+	}
+
+	if (0 != history_values.values_num)
+		zbx_vc_add_values(&history_values);
+
+	zbx_vector_ptr_destroy(&history_values);
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: helper function for DCmass_proxy_add_history()                    *
@@ -3047,6 +3578,7 @@ static void	sync_proxy_history(int *total_num, int *more)
 	zbx_vector_ptr_t	history_items;
 	zbx_vector_ptr_t	item_diff;
 	ZBX_DC_HISTORY		history[ZBX_HC_SYNC_MAX];
+	zbx_hc_shard_t		*shard;
 
 	zbx_vector_ptr_create(&history_items);
 	zbx_vector_ptr_reserve(&history_items, ZBX_HC_SYNC_MAX);
@@ -3058,16 +3590,14 @@ static void	sync_proxy_history(int *total_num, int *more)
 	{
 		*more = ZBX_SYNC_DONE;
 
-		LOCK_CACHE;
+		hc_rings_drain(0);
 
-		hc_pop_items(&history_items);		/* select and take items out of history cache */
-		history_num = history_items.values_num;
-
-		UNLOCK_CACHE;
-
-		if (0 == history_num)
+		/* select and take items out of history cache */
+		if (NULL == (shard = hc_pop_shard_items(&history_items)))
 			break;
 
+		history_num = history_items.values_num;
+
 		hc_get_item_values(history, &history_items);	/* copy item data from history cache */
 		proxy_prepare_history(history, history_items.values_num, &item_diff);
 
@@ -3080,22 +3610,22 @@ static void	sync_proxy_history(int *total_num, int *more)
 		}
 		while (ZBX_DB_DOWN == (txn_rc = DBcommit()));
 
-		LOCK_CACHE;
+		LOCK_SHARD(shard);
 
-		hc_push_items(&history_items);	/* return items to history cache */
+		hc_push_items(shard, &history_items);	/* return items to history cache */
 
 		if (ZBX_DB_FAIL != txn_rc)
 		{
 			if (0 != item_diff.values_num)
 				DCconfig_items_apply_changes(&item_diff);
 
-			cache->history_num -= history_num;
+			shard->history_num -= history_num;
+
+			UNLOCK_SHARD(shard);
 
 			if (0 != hc_queue_get_size())
 				*more = ZBX_SYNC_MORE;
 
-			UNLOCK_CACHE;
-
 			*total_num += history_num;
 
 			hc_free_item_values(history, history_num);
@@ -3103,7 +3633,7 @@ static void	sync_proxy_history(int *total_num, int *more)
 		else
 		{
 			*more = ZBX_SYNC_MORE;
-			UNLOCK_CACHE;
+			UNLOCK_SHARD(shard);
 		}
 
 		zbx_vector_ptr_clear(&history_items);
@@ -3119,6 +3649,45 @@ static void	sync_proxy_history(int *total_num, int *more)
 	zbx_vector_ptr_destroy(&history_items);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: add the time passed since the stage start to the stage statistics *
+ *          and start the next stage                                          *
+ *                                                                            *
+ * Parameters: stage      - [IN/OUT] the stage time statistics                *
+ *             time_stage - [IN/OUT] the stage start time                     *
+ *                                                                            *
+ ******************************************************************************/
+static void	hc_sync_stage_end(double *stage, double *time_stage)
+{
+	double	time_now;
+
+	time_now = zbx_time();
+	*stage += time_now - *time_stage;
+	*time_stage = time_now;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: add history syncer statistics to the history cache totals         *
+ *                                                                            *
+ ******************************************************************************/
+static void	hc_add_sync_stats(const zbx_hc_sync_stats_t *stats)
+{
+	LOCK_CACHE;
+
+	cache->sync_stats.batches_num += stats->batches_num;
+	cache->sync_stats.prepare += stats->prepare;
+	cache->sync_stats.history += stats->history;
+	cache->sync_stats.trends += stats->trends;
+	cache->sync_stats.items += stats->items;
+	cache->sync_stats.wait += stats->wait;
+	cache->sync_stats.triggers += stats->triggers;
+	cache->sync_stats.export += stats->export;
+
+	UNLOCK_CACHE;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: flush history cache to database, process triggers of flushed      *
@@ -3164,6 +3733,9 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 	int				*errcodes = NULL;
 	zbx_vector_uint64_t		itemids;
 	zbx_hashset_t			trigger_info;
+	zbx_hc_shard_t			*shard;
+	zbx_hc_sync_stats_t		sync_stats;
+	double				time_stage;
 
 	item_retrieve_mode = NULL == CONFIG_EXPORT_DIR ? ZBX_ITEM_GET_SYNC : ZBX_ITEM_GET_SYNC_EXPORT;
 
@@ -3224,6 +3796,7 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 
 	zbx_vector_uint64_create(&itemids);
 
+	memset(&sync_stats, 0, sizeof(sync_stats));
 	sync_start = time(NULL);
 
 	do
@@ -3232,18 +3805,18 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 		ZBX_DC_TREND		*trends = NULL;
 
 		*more = ZBX_SYNC_DONE;
+		time_stage = zbx_time();
 
-		LOCK_CACHE;
-		hc_pop_items(&history_items);		/* select and take items out of history cache */
-		UNLOCK_CACHE;
+		hc_rings_drain(0);
 
-		if (0 != history_items.values_num)
+		/* select and take items out of history cache */
+		if (NULL != (shard = hc_pop_shard_items(&history_items)))
 		{
 			if (0 == (history_num = DCconfig_lock_triggers_by_history_items(&history_items, &triggerids)))
 			{
-				LOCK_CACHE;
-				hc_push_items(&history_items);
-				UNLOCK_CACHE;
+				LOCK_SHARD(shard);
+				hc_push_items(shard, &history_items);
+				UNLOCK_SHARD(shard);
 				zbx_vector_ptr_clear(&history_items);
 			}
 		}
@@ -3276,7 +3849,49 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 			DCmass_prepare_history(history, items, errcodes, history_num, &item_diff,
 					&inventory_values, compression_age, &proxy_subscribtions);
 
-			if (FAIL != (ret = DBmass_add_history(history, history_num)))
+			hc_sync_stage_end(&sync_stats.prepare, &time_stage);
+
+			/* with pipelined history writes the values are only sent here and the item  */
+			/* updates are executed while the history is being written; the write is     */
+			/* confirmed before the batch ends, so batches themselves are not overlapped */
+			ret = DBmass_add_history(history, history_num);
+
+			hc_sync_stage_end(&sync_stats.history, &time_stage);
+
+			if (FAIL != ret)
+			{
+				do
+				{
+					DBbegin();
+
+					DBmass_update_items(&item_diff, &inventory_values);
+
+					/* process internal events generated by DCmass_prepare_history() */
+					zbx_process_events(NULL, NULL);
+
+					hc_sync_stage_end(&sync_stats.items, &time_stage);
+
+					/* item updates must not be committed unless the history is written */
+					ret = zbx_history_wait();
+
+					hc_sync_stage_end(&sync_stats.wait, &time_stage);
+
+					if (SUCCEED != ret)
+					{
+						DBrollback();
+						zbx_reset_event_recovery();
+						break;
+					}
+
+					if (ZBX_DB_OK != (txn_error = DBcommit()))
+						zbx_reset_event_recovery();
+				}
+				while (ZBX_DB_DOWN == txn_error);
+
+				hc_sync_stage_end(&sync_stats.items, &time_stage);
+			}
+
+			if (FAIL != ret)
 			{
 				DCconfig_items_apply_changes(&item_diff);
 				DCmass_update_trends(history, history_num, &trends, &trends_num, compression_age);
@@ -3297,19 +3912,11 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 				}
 				while (ZBX_DB_DOWN == txn_error);
 
-				do
-				{
-					DBbegin();
-
-					DBmass_update_items(&item_diff, &inventory_values);
-
-					/* process internal events generated by DCmass_prepare_history() */
-					zbx_process_events(NULL, NULL);
+				hc_sync_stage_end(&sync_stats.trends, &time_stage);
 
-					if (ZBX_DB_OK != (txn_error = DBcommit()))
-						zbx_reset_event_recovery();
-				}
-				while (ZBX_DB_DOWN == txn_error);
+				/* values can be cached only after they are written, otherwise items */
+				/* cached from database by other processes would miss them           */
+				DCmass_add_value_cache(history, history_num);
 			}
 
 			zbx_clean_events();
@@ -3367,6 +3974,8 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 				if (ZBX_DB_OK == txn_error)
 					zbx_events_update_itservices();
 			}
+
+			hc_sync_stage_end(&sync_stats.triggers, &time_stage);
 		}
 
 		if (0 != triggerids.values_num)
@@ -3391,9 +4000,10 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 
 		if (0 != history_num)
 		{
-			LOCK_CACHE;
-			hc_push_items(&history_items);	/* return items to history cache */
-			cache->history_num -= history_num;
+			LOCK_SHARD(shard);
+			hc_push_items(shard, &history_items);	/* return items to history cache */
+			shard->history_num -= history_num;
+			UNLOCK_SHARD(shard);
 
 			if (0 != hc_queue_get_size())
 			{
@@ -3406,8 +4016,6 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 					*more = ZBX_SYNC_MORE;
 			}
 
-			UNLOCK_CACHE;
-
 			*values_num += history_num;
 		}
 
@@ -3468,11 +4076,20 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 
 		zbx_vector_uint64_clear(&itemids);
 
+		if (0 != history_num || 0 != timers_num)
+		{
+			hc_sync_stage_end(&sync_stats.export, &time_stage);
+			sync_stats.batches_num++;
+		}
+
 		/* Exit from sync loop if we have spent too much time here.       */
 		/* This is done to allow syncer process to update its statistics. */
 	}
 	while (ZBX_SYNC_MORE == *more && ZBX_HC_SYNC_TIME_MAX >= time(NULL) - sync_start);
 
+	if (0 != sync_stats.batches_num)
+		hc_add_sync_stats(&sync_stats);
+
 	zbx_free(items);
 	zbx_free(errcodes);
 
@@ -3503,12 +4120,12 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
  ******************************************************************************/
 static void	sync_history_cache_full(void)
 {
-	int			values_num = 0, triggers_num = 0, more;
+	int			values_num = 0, triggers_num = 0, more, i;
 	zbx_hashset_iter_t	iter;
 	zbx_hc_item_t		*item;
-	zbx_binary_heap_t	tmp_history_queue;
+	zbx_binary_heap_t	tmp_history_queues[ZBX_HC_SHARDS_MAX];
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() history_num:%d", __func__, cache->history_num);
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() history_num:%d", __func__, hc_get_history_num());
 
 	/* History index cache might be full without any space left for queueing items from history index to  */
 	/* history queue. The solution: replace the shared-memory history queue with heap-allocated one. Add  */
@@ -3521,122 +4138,735 @@ static void	sync_history_cache_full(void)
 	/*   * other parts of the program do not hold pointers to the elements of history queue that is       */
 	/*     stored in the shared memory.                                                                   */
 
-	if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
+	if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
+	{
+		/* unlock all triggers before full sync so no items are locked by triggers */
+		DCconfig_unlock_all_triggers();
+	}
+
+	for (i = 0; i < cache->shards_num; i++)
+	{
+		zbx_hc_shard_t	*shard = cache->shards[i];
+
+		tmp_history_queues[i] = shard->history_queue;
+
+		zbx_binary_heap_create(&shard->history_queue, hc_queue_elem_compare_func,
+				ZBX_BINARY_HEAP_OPTION_EMPTY);
+		zbx_hashset_iter_reset(&shard->history_items, &iter);
+
+		/* add all items from history index to the new history queue */
+		while (NULL != (item = (zbx_hc_item_t *)zbx_hashset_iter_next(&iter)))
+		{
+			if (NULL != item->tail)
+			{
+				item->status = ZBX_HC_ITEM_STATUS_NORMAL;
+				hc_queue_item(shard, item);
+			}
+		}
+	}
+
+	/* Move values left in history rings, the rings are not drained by anyone else at this point. */
+	/* Values that do not fit into history cache are moved by history sync after freeing space,   */
+	/* the queue size includes them, so syncing continues until all rings are empty.              */
+	hc_rings_drain(1);
+
+	if (0 != hc_queue_get_size())
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "syncing history data...");
+
+		do
+		{
+			if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
+				sync_server_history(&values_num, &triggers_num, &more);
+			else
+				sync_proxy_history(&values_num, &more);
+
+			zabbix_log(LOG_LEVEL_WARNING, "syncing history data... " ZBX_FS_DBL "%%",
+					(double)values_num / (hc_get_history_num() + values_num) * 100);
+		}
+		while (0 != hc_queue_get_size());
+
+		zabbix_log(LOG_LEVEL_WARNING, "syncing history data done");
+	}
+
+	for (i = 0; i < cache->shards_num; i++)
+	{
+		zbx_binary_heap_destroy(&cache->shards[i]->history_queue);
+		cache->shards[i]->history_queue = tmp_history_queues[i];
+	}
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: log progress of syncing history data                              *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_log_sync_history_cache_progress(void)
+{
+	double		pcnt = -1.0;
+	int		ts_last, ts_next, sec, history_num;
+
+	history_num = hc_get_history_num();
+
+	LOCK_CACHE;
+
+	if (INT_MAX == cache->history_progress_ts)
+	{
+		UNLOCK_CACHE;
+		return;
+	}
+
+	ts_last = cache->history_progress_ts;
+	sec = time(NULL);
+
+	if (0 == cache->history_progress_ts)
+	{
+		cache->history_num_total = history_num;
+		cache->history_progress_ts = sec;
+	}
+
+	if (ZBX_HC_SYNC_TIME_MAX <= sec - cache->history_progress_ts || 0 == history_num)
+	{
+		if (0 != cache->history_num_total)
+			pcnt = 100 * (double)(cache->history_num_total - history_num) / cache->history_num_total;
+
+		cache->history_progress_ts = (0 == history_num ? INT_MAX : sec);
+	}
+
+	ts_next = cache->history_progress_ts;
+
+	UNLOCK_CACHE;
+
+	if (0 == ts_last)
+		zabbix_log(LOG_LEVEL_WARNING, "syncing history data in progress... ");
+
+	if (-1.0 != pcnt)
+		zabbix_log(LOG_LEVEL_WARNING, "syncing history data... " ZBX_FS_DBL "%%", pcnt);
+
+	if (INT_MAX == ts_next)
+		zabbix_log(LOG_LEVEL_WARNING, "syncing history data done");
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: writes updates and new data from history cache to database        *
+ *                                                                            *
+ * Parameters: values_num - [OUT] the number of synced values                  *
+ *             more      - [OUT] a flag indicating the cache emptiness:       *
+ *                                ZBX_SYNC_DONE - nothing to sync, go idle    *
+ *                                ZBX_SYNC_MORE - more data to sync           *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_sync_history_cache(int *values_num, int *triggers_num, int *more)
+{
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() history_num:%d", __func__, hc_get_history_num());
+
+	*values_num = 0;
+	*triggers_num = 0;
+
+	if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
+		sync_server_history(values_num, triggers_num, more);
+	else
+		sync_proxy_history(values_num, more);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * history rings                                                              *
+ *                                                                            *
+ * Each data gathering process can own a single producer, multiple consumer   *
+ * ring in shared memory. The owner writes item values directly into the ring *
+ * and publishes them by advancing ring head, history syncers move published  *
+ * values into history cache. Neither side locks the history cache to access  *
+ * the ring, only the process draining the ring locks the target shards.      *
+ *                                                                            *
+ ******************************************************************************/
+#define ZBX_HC_RING_SIZE_MIN		(__UINT64_C(64) * ZBX_KIBIBYTE)
+
+#define ZBX_HC_RING_RECORD_VALUE	0
+#define ZBX_HC_RING_RECORD_SKIP		1
+
+#define ZBX_HC_RING_UNATTACHED		0
+#define ZBX_HC_RING_ATTACHED		1
+#define ZBX_HC_RING_NONE		2
+
+typedef struct
+{
+	zbx_uint64_t	head;		/* published write position, updated by the owner process */
+	zbx_uint64_t	tail;		/* read position, updated by the process draining the ring */
+	zbx_uint64_t	values_num;	/* number of values passed through the ring */
+	zbx_uint64_t	drained_num;	/* number of values moved from the ring into history cache */
+	zbx_uint64_t	overflow_num;	/* number of values added directly because the ring was full */
+	zbx_uint64_t	size;
+	char		*data;
+	int		owner;		/* pid of the owner process, 0 - free ring */
+	int		drain;		/* 1 - the ring is being drained */
+}
+zbx_hc_ring_t;
+
+/* The ring record. The value strings are stored after the record, the string */
+/* offsets are relative to the end of the record. When the record does not    */
+/* fit at the end of ring buffer the remaining space is marked as skipped and */
+/* the record is written at the buffer start.                                 */
+typedef struct
+{
+	zbx_uint32_t	size;		/* record size including strings, aligned to 8 bytes */
+	unsigned char	type;		/* ZBX_HC_RING_RECORD_* */
+	unsigned char	consumed;	/* 1 - the value was moved to history cache */
+	dc_item_value_t	value;
+}
+zbx_hc_ring_record_t;
+
+static zbx_mem_info_t	*hc_ring_mem = NULL;
+static zbx_hc_ring_t	*hc_rings = NULL;
+static int		hc_rings_num = 0;
+static int		hc_ring_values_num = 0;	/* number of values not yet published by the current process */
+
+#if defined(HAVE_ATOMIC_BUILTINS)
+
+/* the state of ring owned by the current process */
+static zbx_hc_ring_t	*hc_ring = NULL;
+static int		hc_ring_status = ZBX_HC_RING_UNATTACHED;
+static zbx_uint64_t	hc_ring_write;		/* write position of not yet published values */
+static int		hc_ring_overflow_num;	/* number of values added to local cache due to full ring */
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: returns the number of processes adding values to history cache    *
+ *                                                                            *
+ * Comments: Values are added to history cache by preprocessing managers,     *
+ *           by trappers and proxy pollers processing history data received   *
+ *           from proxies and agents, and by configuration syncer for items   *
+ *           becoming not supported.                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	hc_rings_get_producers_num(void)
+{
+	return get_process_type_forks(ZBX_PROCESS_TYPE_PREPROCMAN) + get_process_type_forks(ZBX_PROCESS_TYPE_TRAPPER) +
+			get_process_type_forks(ZBX_PROCESS_TYPE_PROXYPOLLER) +
+			get_process_type_forks(ZBX_PROCESS_TYPE_CONFSYNCER);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: creates history rings                                             *
+ *                                                                            *
+ * Parameters: error - [OUT] the error message                                *
+ *                                                                            *
+ * Return value: SUCCEED - the rings were created or are disabled             *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: A ring is created for every configured process adding values to  *
+ *           history cache, so each of them can own a ring.                   *
+ *                                                                            *
+ ******************************************************************************/
+static int	hc_rings_create(char **error)
+{
+	zbx_uint64_t	ring_size;
+	int		i, rings_num;
+
+	if (0 == CONFIG_HISTORY_RING_SIZE)
+		return SUCCEED;
+
+	if (ZBX_HC_RING_SIZE_MIN > CONFIG_HISTORY_RING_SIZE)
+	{
+		*error = zbx_dsprintf(*error, "HistoryRingSize must be either 0 or at least " ZBX_FS_UI64 " bytes",
+				ZBX_HC_RING_SIZE_MIN);
+		return FAIL;
+	}
+
+	if (0 == (rings_num = hc_rings_get_producers_num()))
+		return SUCCEED;
+
+	ring_size = CONFIG_HISTORY_RING_SIZE & ~(zbx_uint64_t)7;
+
+	/* the minimum ring size is reserved for memory allocator overhead */
+	if (SUCCEED != zbx_mem_create(&hc_ring_mem, ring_size * (zbx_uint64_t)rings_num + ZBX_HC_RING_SIZE_MIN +
+			sizeof(zbx_hc_ring_t) * (zbx_uint64_t)rings_num, "history rings", "HistoryRingSize", 0,
+			error))
+	{
+		return FAIL;
+	}
+
+	hc_rings = (zbx_hc_ring_t *)zbx_mem_malloc(hc_ring_mem, NULL, sizeof(zbx_hc_ring_t) * (size_t)rings_num);
+	memset(hc_rings, 0, sizeof(zbx_hc_ring_t) * (size_t)rings_num);
+
+	for (i = 0; i < rings_num; i++)
+	{
+		hc_rings[i].size = ring_size;
+		hc_rings[i].data = (char *)zbx_mem_malloc(hc_ring_mem, NULL, ring_size);
+	}
+
+	hc_rings_num = rings_num;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "created %d history rings of " ZBX_FS_UI64 " bytes", rings_num, ring_size);
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: claims a free history ring for the current process                *
+ *                                                                            *
+ * Comments: The main process never owns a ring as its values are added to    *
+ *           history cache before data gathering processes are started.       *
+ *           Rings of exited processes are reclaimed. Values published by the *
+ *           previous owner stay in the ring until drained by history         *
+ *           syncers, the new owner continues writing after them.             *
+ *                                                                            *
+ ******************************************************************************/
+static void	hc_ring_attach(void)
+{
+	int	i, pid;
+
+	hc_ring_status = ZBX_HC_RING_NONE;
+
+	if (0 == hc_rings_num || 0 == process_num)
+		return;
+
+	pid = (int)getpid();
+
+	for (i = 0; i < hc_rings_num; i++)
+	{
+		int	owner = zbx_atomic_load(&hc_rings[i].owner);
+
+		/* a ring owned by the current pid was left by an exited process with the same pid */
+		if (0 != owner && owner != pid && (0 == kill(owner, 0) || ESRCH != errno))
+			continue;
+
+		if (0 != zbx_atomic_cas(&hc_rings[i].owner, &owner, pid))
+		{
+			hc_ring = &hc_rings[i];
+			hc_ring_write = hc_ring->head;
+			hc_ring_status = ZBX_HC_RING_ATTACHED;
+
+			if (0 != owner)
+			{
+				zabbix_log(LOG_LEVEL_DEBUG, "attached to history ring #%d released by exited process"
+						" %d", i + 1, owner);
+			}
+			else
+				zabbix_log(LOG_LEVEL_DEBUG, "attached to history ring #%d", i + 1);
+
+			return;
+		}
+	}
+
+	zabbix_log(LOG_LEVEL_DEBUG, "no free history rings, values will be added to history cache directly");
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: reserves space for a new value in the history ring of the current *
+ *          process                                                           *
+ *                                                                            *
+ * Parameters: strings_len - [IN] the total length of value strings           *
+ *             strings     - [OUT] the buffer for value strings               *
+ *                                                                            *
+ * Return value: the value to fill or NULL if the process has no ring or the  *
+ *               ring is full                                                 *
+ *                                                                            *
+ * Comments: Once the ring gets full the remaining values are added to local  *
+ *           history cache until it is flushed, preserving the value order.   *
+ *                                                                            *
+ ******************************************************************************/
+static dc_item_value_t	*hc_ring_get_slot(size_t strings_len, char **strings)
+{
+	zbx_hc_ring_record_t	*record;
+	zbx_uint64_t		offset, size, skip;
+
+	if (ZBX_HC_RING_UNATTACHED == hc_ring_status)
+		hc_ring_attach();
+
+	if (NULL == hc_ring)
+		return NULL;
+
+	if (0 != hc_ring_overflow_num)
+		goto full;
+
+	size = sizeof(zbx_hc_ring_record_t) + ZBX_SIZE_T_ALIGN8(strings_len);
+	offset = hc_ring_write % hc_ring->size;
+	skip = (offset + size > hc_ring->size ? hc_ring->size - offset : 0);
+
+	if (hc_ring_write + skip + size - zbx_atomic_load(&hc_ring->tail) > hc_ring->size)
+		goto full;
+
+	if (0 != skip)
+	{
+		record = (zbx_hc_ring_record_t *)(hc_ring->data + offset);
+		record->size = (zbx_uint32_t)skip;
+		record->type = ZBX_HC_RING_RECORD_SKIP;
+		record->consumed = 0;
+
+		hc_ring_write += skip;
+		offset = 0;
+	}
+
+	record = (zbx_hc_ring_record_t *)(hc_ring->data + offset);
+	record->size = (zbx_uint32_t)size;
+	record->type = ZBX_HC_RING_RECORD_VALUE;
+	record->consumed = 0;
+
+	hc_ring_write += size;
+	hc_ring_values_num++;
+
+	*strings = (char *)(record + 1);
+
+	return &record->value;
+full:
+	hc_ring_overflow_num++;
+
+	return NULL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: publishes values written into the history ring of the current     *
+ *          process                                                           *
+ *                                                                            *
+ ******************************************************************************/
+static void	hc_ring_publish(void)
+{
+	if (NULL == hc_ring)
+		return;
+
+	if (0 != hc_ring_values_num)
+	{
+		/* count values before publishing, so drained values never exceed passed values */
+		zbx_atomic_fetch_add(&hc_ring->values_num, (zbx_uint64_t)hc_ring_values_num);
+		zbx_atomic_store(&hc_ring->head, hc_ring_write);
+		hc_ring_values_num = 0;
+	}
+
+	if (0 != hc_ring_overflow_num)
+	{
+		zbx_atomic_fetch_add(&hc_ring->overflow_num, (zbx_uint64_t)hc_ring_overflow_num);
+		hc_ring_overflow_num = 0;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: moves published values from history ring into history cache       *
+ *                                                                            *
+ * Parameters: ring - [IN] the history ring                                   *
+ *             wait - [IN] 1 - wait for the ring to be released by other      *
+ *                             process and for free space in history cache    *
+ *                         0 - skip busy ring, leave values in the ring if    *
+ *                             history cache is full                          *
+ *                                                                            *
+ * Return value: the number of values moved into history cache                *
+ *                                                                            *
+ * Comments: The ring records are ordered by shard in one pass and then       *
+ *           moved shard by shard. Values of a shard that runs out of memory  *
+ *           are left in the ring for the next drain, the ring tail is        *
+ *           advanced only over consumed values.                              *
+ *                                                                            *
+ ******************************************************************************/
+static int	hc_ring_drain(zbx_hc_ring_t *ring, int wait)
+{
+	zbx_hc_ring_record_t	*record;
+	zbx_uint64_t		head, tail, pos;
+	int			drain = 0, values_num = 0, records_num = 0, offsets[ZBX_HC_SHARDS_MAX + 1], i, j;
+
+	while (0 == zbx_atomic_cas(&ring->drain, &drain, 1))
+	{
+		struct timespec	ts = {0, 1000000};
+
+		if (0 == wait)
+			return 0;
+
+		drain = 0;
+		nanosleep(&ts, NULL);
+	}
+
+	head = zbx_atomic_load(&ring->head);
+	tail = zbx_atomic_load_relaxed(&ring->tail);
+
+	for (pos = tail; pos < head; pos += record->size)
+	{
+		record = (zbx_hc_ring_record_t *)(ring->data + pos % ring->size);
+
+		if (ZBX_HC_RING_RECORD_VALUE != record->type || 0 != record->consumed)
+			continue;
+
+		if ((size_t)records_num == hc_record_pos_alloc)
+		{
+			hc_record_pos_alloc = MAX(ZBX_STRUCT_REALLOC_STEP, hc_record_pos_alloc * 2);
+			hc_record_pos = (zbx_uint64_t *)zbx_realloc(hc_record_pos,
+					hc_record_pos_alloc * sizeof(zbx_uint64_t));
+		}
+
+		hc_reserve_value_shards((size_t)records_num + 1);
+		hc_value_shards[records_num] = hc_get_shard_index(record->value.itemid);
+		hc_record_pos[records_num++] = pos;
+	}
+
+	hc_sort_values_by_shard(records_num, offsets);
+
+	for (i = 0; i < cache->shards_num; i++)
+	{
+		zbx_hc_shard_t	*shard;
+
+		if (offsets[i] == offsets[i + 1])
+			continue;
+
+		shard = cache->shards[i];
+
+		LOCK_SHARD(shard);
+
+		for (j = offsets[i]; j < offsets[i + 1]; j++)
+		{
+			record = (zbx_hc_ring_record_t *)(ring->data + hc_record_pos[hc_value_index[j]] % ring->size);
+
+			if (SUCCEED != hc_add_item_value(shard, &record->value, (const char *)(record + 1), wait))
+				break;
+
+			record->consumed = 1;
+			shard->history_num++;
+			values_num++;
+		}
+
+		UNLOCK_SHARD(shard);
+	}
+
+	for (pos = tail; pos < head; pos += record->size)
+	{
+		record = (zbx_hc_ring_record_t *)(ring->data + pos % ring->size);
+
+		if (ZBX_HC_RING_RECORD_VALUE == record->type && 0 == record->consumed)
+			break;
+	}
+
+	zbx_atomic_store(&ring->tail, pos);
+	zbx_atomic_fetch_add(&ring->drained_num, (zbx_uint64_t)values_num);
+	zbx_atomic_store(&ring->drain, 0);
+
+	return values_num;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: moves values from all history rings into history cache            *
+ *                                                                            *
+ * Parameters: force - [IN] 1 - release rings left claimed by terminated      *
+ *                              processes before draining                     *
+ *                                                                            *
+ * Return value: the number of values moved into history cache                *
+ *                                                                            *
+ ******************************************************************************/
+static int	hc_rings_drain(int force)
+{
+	int	i, values_num = 0;
+
+	for (i = 0; i < hc_rings_num; i++)
+	{
+		zbx_hc_ring_t	*ring = &hc_rings[i];
+
+		if (0 != force)
+			zbx_atomic_store(&ring->drain, 0);
+
+		if (zbx_atomic_load(&ring->head) != zbx_atomic_load_relaxed(&ring->tail))
+			values_num += hc_ring_drain(ring, 0);
+	}
+
+	return values_num;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: moves values from the history ring of the current process into    *
+ *          history cache                                                     *
+ *                                                                            *
+ * Comments: Used before adding values from local history cache directly to   *
+ *           history cache, so the older values in the ring are queued first. *
+ *                                                                            *
+ ******************************************************************************/
+static void	hc_ring_drain_own(void)
+{
+	if (NULL != hc_ring && zbx_atomic_load(&hc_ring->head) != zbx_atomic_load_relaxed(&hc_ring->tail))
+		hc_ring_drain(hc_ring, 1);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets the number of values waiting in history rings                *
+ *                                                                            *
+ ******************************************************************************/
+static int	hc_rings_get_values_num(void)
+{
+	int	i, values_num = 0;
+
+	for (i = 0; i < hc_rings_num; i++)
 	{
-		/* unlock all triggers before full sync so no items are locked by triggers */
-		DCconfig_unlock_all_triggers();
+		zbx_hc_ring_t	*ring = &hc_rings[i];
+		zbx_uint64_t	drained_num;
+
+		if (zbx_atomic_load(&ring->head) == zbx_atomic_load_relaxed(&ring->tail))
+			continue;
+
+		drained_num = zbx_atomic_load_relaxed(&ring->drained_num);
+		values_num += (int)(zbx_atomic_load_relaxed(&ring->values_num) - drained_num);
 	}
 
-	tmp_history_queue = cache->history_queue;
+	return values_num;
+}
 
-	zbx_binary_heap_create(&cache->history_queue, hc_queue_elem_compare_func, ZBX_BINARY_HEAP_OPTION_EMPTY);
-	zbx_hashset_iter_reset(&cache->history_items, &iter);
+/******************************************************************************
+ *                                                                            *
+ * Purpose: checks if history rings have a value of the specified item        *
+ *                                                                            *
+ * Return value: SUCCEED - the item has values waiting in history rings       *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: The ring is flagged as being drained while it is searched, so    *
+ *           the tail is not advanced and the owner cannot overwrite the      *
+ *           searched records.                                                *
+ *                                                                            *
+ ******************************************************************************/
+static int	hc_rings_is_itemid_queued(zbx_uint64_t itemid)
+{
+	int	i, ret = FAIL;
 
-	/* add all items from history index to the new history queue */
-	while (NULL != (item = (zbx_hc_item_t *)zbx_hashset_iter_next(&iter)))
+	for (i = 0; i < hc_rings_num && SUCCEED != ret; i++)
 	{
-		if (NULL != item->tail)
+		zbx_hc_ring_t		*ring = &hc_rings[i];
+		zbx_hc_ring_record_t	*record;
+		zbx_uint64_t		head, pos;
+		int			drain = 0;
+
+		if (zbx_atomic_load(&ring->head) == zbx_atomic_load_relaxed(&ring->tail))
+			continue;
+
+		while (0 == zbx_atomic_cas(&ring->drain, &drain, 1))
 		{
-			item->status = ZBX_HC_ITEM_STATUS_NORMAL;
-			hc_queue_item(item);
+			struct timespec	ts = {0, 1000000};
+
+			drain = 0;
+			nanosleep(&ts, NULL);
 		}
-	}
 
-	if (0 != hc_queue_get_size())
-	{
-		zabbix_log(LOG_LEVEL_WARNING, "syncing history data...");
+		head = zbx_atomic_load(&ring->head);
 
-		do
+		for (pos = zbx_atomic_load_relaxed(&ring->tail); pos < head; pos += record->size)
 		{
-			if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
-				sync_server_history(&values_num, &triggers_num, &more);
-			else
-				sync_proxy_history(&values_num, &more);
+			record = (zbx_hc_ring_record_t *)(ring->data + pos % ring->size);
 
-			zabbix_log(LOG_LEVEL_WARNING, "syncing history data... " ZBX_FS_DBL "%%",
-					(double)values_num / (cache->history_num + values_num) * 100);
+			if (ZBX_HC_RING_RECORD_VALUE == record->type && 0 == record->consumed &&
+					itemid == record->value.itemid)
+			{
+				ret = SUCCEED;
+				break;
+			}
 		}
-		while (0 != hc_queue_get_size());
 
-		zabbix_log(LOG_LEVEL_WARNING, "syncing history data done");
+		zbx_atomic_store(&ring->drain, 0);
 	}
 
-	zbx_binary_heap_destroy(&cache->history_queue);
-	cache->history_queue = tmp_history_queue;
-
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+	return ret;
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: log progress of syncing history data                              *
+ * Purpose: gets history ring statistics                                      *
+ *                                                                            *
+ * Parameters: total        - [OUT] the total size of history rings           *
+ *             used         - [OUT] the size of values stored in the rings    *
+ *             values_num   - [OUT] the number of values passed through rings *
+ *             overflow_num - [OUT] the number of values added directly to    *
+ *                                  history cache because of full ring        *
  *                                                                            *
  ******************************************************************************/
-void	zbx_log_sync_history_cache_progress(void)
+static void	hc_rings_get_stats(zbx_uint64_t *total, zbx_uint64_t *used, zbx_uint64_t *values_num,
+		zbx_uint64_t *overflow_num)
 {
-	double		pcnt = -1.0;
-	int		ts_last, ts_next, sec;
+	int	i;
 
-	LOCK_CACHE;
+	*total = *used = *values_num = *overflow_num = 0;
 
-	if (INT_MAX == cache->history_progress_ts)
+	for (i = 0; i < hc_rings_num; i++)
 	{
-		UNLOCK_CACHE;
-		return;
+		zbx_hc_ring_t	*ring = &hc_rings[i];
+
+		*total += ring->size;
+		*used += zbx_atomic_load_relaxed(&ring->head) - zbx_atomic_load_relaxed(&ring->tail);
+		*values_num += zbx_atomic_load_relaxed(&ring->values_num);
+		*overflow_num += zbx_atomic_load_relaxed(&ring->overflow_num);
 	}
+}
 
-	ts_last = cache->history_progress_ts;
-	sec = time(NULL);
+#else
 
-	if (0 == cache->history_progress_ts)
-	{
-		cache->history_num_total = cache->history_num;
-		cache->history_progress_ts = sec;
-	}
+static int	hc_rings_create(char **error)
+{
+	if (0 == CONFIG_HISTORY_RING_SIZE)
+		return SUCCEED;
 
-	if (ZBX_HC_SYNC_TIME_MAX <= sec - cache->history_progress_ts || 0 == cache->history_num)
-	{
-		if (0 != cache->history_num_total)
-			pcnt = 100 * (double)(cache->history_num_total - cache->history_num) / cache->history_num_total;
+	*error = zbx_strdup(*error, "HistoryRingSize must be 0, atomic operations are not supported by compiler");
 
-		cache->history_progress_ts = (0 == cache->history_num ? INT_MAX : sec);
-	}
+	return FAIL;
+}
 
-	ts_next = cache->history_progress_ts;
+static dc_item_value_t	*hc_ring_get_slot(size_t strings_len, char **strings)
+{
+	ZBX_UNUSED(strings_len);
+	ZBX_UNUSED(strings);
 
-	UNLOCK_CACHE;
+	return NULL;
+}
 
-	if (0 == ts_last)
-		zabbix_log(LOG_LEVEL_WARNING, "syncing history data in progress... ");
+static void	hc_ring_publish(void)
+{
+}
 
-	if (-1.0 != pcnt)
-		zabbix_log(LOG_LEVEL_WARNING, "syncing history data... " ZBX_FS_DBL "%%", pcnt);
+static int	hc_rings_drain(int force)
+{
+	ZBX_UNUSED(force);
 
-	if (INT_MAX == ts_next)
-		zabbix_log(LOG_LEVEL_WARNING, "syncing history data done");
+	return 0;
+}
+
+static void	hc_ring_drain_own(void)
+{
+}
+
+static int	hc_rings_get_values_num(void)
+{
+	return 0;
+}
+
+static int	hc_rings_is_itemid_queued(zbx_uint64_t itemid)
+{
+	ZBX_UNUSED(itemid);
+
+	return FAIL;
+}
+
+static void	hc_rings_get_stats(zbx_uint64_t *total, zbx_uint64_t *used, zbx_uint64_t *values_num,
+		zbx_uint64_t *overflow_num)
+{
+	*total = *used = *values_num = *overflow_num = 0;
 }
 
+#endif
+
 /******************************************************************************
  *                                                                            *
- * Purpose: writes updates and new data from history cache to database        *
- *                                                                            *
- * Parameters: values_num - [OUT] the number of synced values                  *
- *             more      - [OUT] a flag indicating the cache emptiness:       *
- *                                ZBX_SYNC_DONE - nothing to sync, go idle    *
- *                                ZBX_SYNC_MORE - more data to sync           *
+ * Purpose: destroys history rings                                            *
  *                                                                            *
  ******************************************************************************/
-void	zbx_sync_history_cache(int *values_num, int *triggers_num, int *more)
+static void	hc_rings_destroy(void)
 {
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() history_num:%d", __func__, cache->history_num);
-
-	*values_num = 0;
-	*triggers_num = 0;
+	if (NULL != hc_ring_mem)
+	{
+		zbx_mem_destroy(hc_ring_mem);
+		hc_ring_mem = NULL;
+	}
 
-	if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
-		sync_server_history(values_num, triggers_num, more);
-	else
-		sync_proxy_history(values_num, more);
+	hc_rings = NULL;
+	hc_rings_num = 0;
 }
 
 /******************************************************************************
@@ -3658,26 +4888,60 @@ static void	dc_string_buffer_realloc(size_t len)
 	string_values = (char *)zbx_realloc(string_values, string_values_alloc);
 }
 
-static dc_item_value_t	*dc_local_get_history_slot(void)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets a slot for new value either in the history ring of the       *
+ *          current process or in local history cache                         *
+ *                                                                            *
+ * Parameters: strings_len    - [IN] the total length of value strings        *
+ *             strings        - [OUT] the buffer for value strings            *
+ *             strings_offset - [OUT] the offset of value strings in buffer   *
+ *                                                                            *
+ * Return value: the value to fill                                            *
+ *                                                                            *
+ ******************************************************************************/
+static dc_item_value_t	*dc_local_get_history_slot(size_t strings_len, char **strings, size_t *strings_offset)
 {
-	if (ZBX_MAX_VALUES_LOCAL == item_values_num)
+	dc_item_value_t	*item_value;
+
+	if (ZBX_MAX_VALUES_LOCAL == item_values_num + hc_ring_values_num)
 		dc_flush_history();
 
+	if (NULL != (item_value = hc_ring_get_slot(strings_len, strings)))
+	{
+		*strings_offset = 0;
+		return item_value;
+	}
+
 	if (item_values_alloc == item_values_num)
 	{
 		item_values_alloc += ZBX_STRUCT_REALLOC_STEP;
 		item_values = (dc_item_value_t *)zbx_realloc(item_values, item_values_alloc * sizeof(dc_item_value_t));
 	}
 
+	dc_string_buffer_realloc(strings_len);
+	*strings = string_values;
+	*strings_offset = string_values_offset;
+	string_values_offset += strings_len;
+
 	return &item_values[item_values_num++];
 }
 
+static void	dc_local_copy_str(dc_value_str_t *str, const char *src, char *strings, size_t *strings_offset)
+{
+	str->pvalue = *strings_offset;
+	memcpy(&strings[*strings_offset], src, str->len);
+	*strings_offset += str->len;
+}
+
 static void	dc_local_add_history_dbl(zbx_uint64_t itemid, unsigned char item_value_type, const zbx_timespec_t *ts,
 		double value_orig, zbx_uint64_t lastlogsize, int mtime, unsigned char flags)
 {
 	dc_item_value_t	*item_value;
+	char		*strings;
+	size_t		strings_offset;
 
-	item_value = dc_local_get_history_slot();
+	item_value = dc_local_get_history_slot(0, &strings, &strings_offset);
 
 	item_value->itemid = itemid;
 	item_value->ts = *ts;
@@ -3700,8 +4964,10 @@ static void	dc_local_add_history_uint(zbx_uint64_t itemid, unsigned char item_va
 		zbx_uint64_t value_orig, zbx_uint64_t lastlogsize, int mtime, unsigned char flags)
 {
 	dc_item_value_t	*item_value;
+	char		*strings;
+	size_t		strings_offset;
 
-	item_value = dc_local_get_history_slot();
+	item_value = dc_local_get_history_slot(0, &strings, &strings_offset);
 
 	item_value->itemid = itemid;
 	item_value->ts = *ts;
@@ -3724,8 +4990,13 @@ static void	dc_local_add_history_text(zbx_uint64_t itemid, unsigned char item_va
 		const char *value_orig, zbx_uint64_t lastlogsize, int mtime, unsigned char flags)
 {
 	dc_item_value_t	*item_value;
+	char		*strings;
+	size_t		strings_offset, value_len = 0;
 
-	item_value = dc_local_get_history_slot();
+	if (0 == (flags & ZBX_DC_FLAG_NOVALUE))
+		value_len = zbx_db_strlen_n(value_orig, ZBX_HISTORY_VALUE_LEN) + 1;
+
+	item_value = dc_local_get_history_slot(value_len, &strings, &strings_offset);
 
 	item_value->itemid = itemid;
 	item_value->ts = *ts;
@@ -3740,25 +5011,28 @@ static void	dc_local_add_history_text(zbx_uint64_t itemid, unsigned char item_va
 		item_value->mtime = mtime;
 	}
 
-	if (0 == (item_value->flags & ZBX_DC_FLAG_NOVALUE))
-	{
-		item_value->value.value_str.len = zbx_db_strlen_n(value_orig, ZBX_HISTORY_VALUE_LEN) + 1;
-		dc_string_buffer_realloc(item_value->value.value_str.len);
+	item_value->value.value_str.len = value_len;
 
-		item_value->value.value_str.pvalue = string_values_offset;
-		memcpy(&string_values[string_values_offset], value_orig, item_value->value.value_str.len);
-		string_values_offset += item_value->value.value_str.len;
-	}
-	else
-		item_value->value.value_str.len = 0;
+	if (0 != value_len)
+		dc_local_copy_str(&item_value->value.value_str, value_orig, strings, &strings_offset);
 }
 
 static void	dc_local_add_history_log(zbx_uint64_t itemid, unsigned char item_value_type, const zbx_timespec_t *ts,
 		const zbx_log_t *log, zbx_uint64_t lastlogsize, int mtime, unsigned char flags)
 {
 	dc_item_value_t	*item_value;
+	char		*strings;
+	size_t		strings_offset, value_len = 0, source_len = 0;
+
+	if (0 == (flags & ZBX_DC_FLAG_NOVALUE))
+	{
+		value_len = zbx_db_strlen_n(log->value, ZBX_HISTORY_VALUE_LEN) + 1;
+
+		if (NULL != log->source && '\0' != *log->source)
+			source_len = zbx_db_strlen_n(log->source, HISTORY_LOG_SOURCE_LEN) + 1;
+	}
 
-	item_value = dc_local_get_history_slot();
+	item_value = dc_local_get_history_slot(value_len + source_len, &strings, &strings_offset);
 
 	item_value->itemid = itemid;
 	item_value->ts = *ts;
@@ -3779,46 +5053,27 @@ static void	dc_local_add_history_log(zbx_uint64_t itemid, unsigned char item_val
 		item_value->severity = log->severity;
 		item_value->logeventid = log->logeventid;
 		item_value->timestamp = log->timestamp;
-
-		item_value->value.value_str.len = zbx_db_strlen_n(log->value, ZBX_HISTORY_VALUE_LEN) + 1;
-
-		if (NULL != log->source && '\0' != *log->source)
-			item_value->source.len = zbx_db_strlen_n(log->source, HISTORY_LOG_SOURCE_LEN) + 1;
-		else
-			item_value->source.len = 0;
-	}
-	else
-	{
-		item_value->value.value_str.len = 0;
-		item_value->source.len = 0;
 	}
 
-	if (0 != item_value->value.value_str.len + item_value->source.len)
-	{
-		dc_string_buffer_realloc(item_value->value.value_str.len + item_value->source.len);
+	item_value->value.value_str.len = value_len;
+	item_value->source.len = source_len;
 
-		if (0 != item_value->value.value_str.len)
-		{
-			item_value->value.value_str.pvalue = string_values_offset;
-			memcpy(&string_values[string_values_offset], log->value, item_value->value.value_str.len);
-			string_values_offset += item_value->value.value_str.len;
-		}
+	if (0 != value_len)
+		dc_local_copy_str(&item_value->value.value_str, log->value, strings, &strings_offset);
 
-		if (0 != item_value->source.len)
-		{
-			item_value->source.pvalue = string_values_offset;
-			memcpy(&string_values[string_values_offset], log->source, item_value->source.len);
-			string_values_offset += item_value->source.len;
-		}
-	}
+	if (0 != source_len)
+		dc_local_copy_str(&item_value->source, log->source, strings, &strings_offset);
 }
 
 static void	dc_local_add_history_notsupported(zbx_uint64_t itemid, const zbx_timespec_t *ts, const char *error,
 		zbx_uint64_t lastlogsize, int mtime, unsigned char flags)
 {
 	dc_item_value_t	*item_value;
+	char		*strings;
+	size_t		strings_offset, value_len;
 
-	item_value = dc_local_get_history_slot();
+	value_len = zbx_db_strlen_n(error, ITEM_ERROR_LEN) + 1;
+	item_value = dc_local_get_history_slot(value_len, &strings, &strings_offset);
 
 	item_value->itemid = itemid;
 	item_value->ts = *ts;
@@ -3831,37 +5086,36 @@ static void	dc_local_add_history_notsupported(zbx_uint64_t itemid, const zbx_tim
 		item_value->mtime = mtime;
 	}
 
-	item_value->value.value_str.len = zbx_db_strlen_n(error, ITEM_ERROR_LEN) + 1;
-	dc_string_buffer_realloc(item_value->value.value_str.len);
-	item_value->value.value_str.pvalue = string_values_offset;
-	memcpy(&string_values[string_values_offset], error, item_value->value.value_str.len);
-	string_values_offset += item_value->value.value_str.len;
+	item_value->value.value_str.len = value_len;
+	dc_local_copy_str(&item_value->value.value_str, error, strings, &strings_offset);
 }
 
 static void	dc_local_add_history_lld(zbx_uint64_t itemid, const zbx_timespec_t *ts, const char *value_orig)
 {
 	dc_item_value_t	*item_value;
+	char		*strings;
+	size_t		strings_offset, value_len;
 
-	item_value = dc_local_get_history_slot();
+	value_len = strlen(value_orig) + 1;
+	item_value = dc_local_get_history_slot(value_len, &strings, &strings_offset);
 
 	item_value->itemid = itemid;
 	item_value->ts = *ts;
 	item_value->state = ITEM_STATE_NORMAL;
 	item_value->flags = ZBX_DC_FLAG_LLD;
-	item_value->value.value_str.len = strlen(value_orig) + 1;
+	item_value->value.value_str.len = value_len;
 
-	dc_string_buffer_realloc(item_value->value.value_str.len);
-	item_value->value.value_str.pvalue = string_values_offset;
-	memcpy(&string_values[string_values_offset], value_orig, item_value->value.value_str.len);
-	string_values_offset += item_value->value.value_str.len;
+	dc_local_copy_str(&item_value->value.value_str, value_orig, strings, &strings_offset);
 }
 
 static void	dc_local_add_history_empty(zbx_uint64_t itemid, unsigned char item_value_type, const zbx_timespec_t *ts,
 		unsigned char flags)
 {
 	dc_item_value_t	*item_value;
+	char		*strings;
+	size_t		strings_offset;
 
-	item_value = dc_local_get_history_slot();
+	item_value = dc_local_get_history_slot(0, &strings, &strings_offset);
 
 	item_value->itemid = itemid;
 	item_value->ts = *ts;
@@ -3987,18 +5241,48 @@ void	dc_add_history(zbx_uint64_t itemid, unsigned char item_value_type, unsigned
 	}
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: flushes values collected by the current process to history cache  *
+ *                                                                            *
+ * Comments: Values written into the history ring are only published and      *
+ *           will be moved to history cache by history syncers. Values in the *
+ *           local history cache (ring is full or not available) are added to *
+ *           history cache directly after draining the ring.                  *
+ *                                                                            *
+ ******************************************************************************/
 void	dc_flush_history(void)
 {
+	int	offsets[ZBX_HC_SHARDS_MAX + 1], i;
+
+	hc_ring_publish();
+
 	if (0 == item_values_num)
 		return;
 
-	LOCK_CACHE;
+	hc_ring_drain_own();
 
-	hc_add_item_values(item_values, item_values_num);
+	hc_reserve_value_shards(item_values_num);
 
-	cache->history_num += item_values_num;
+	for (i = 0; i < (int)item_values_num; i++)
+		hc_value_shards[i] = hc_get_shard_index(item_values[i].itemid);
 
-	UNLOCK_CACHE;
+	hc_sort_values_by_shard((int)item_values_num, offsets);
+
+	for (i = 0; i < cache->shards_num; i++)
+	{
+		zbx_hc_shard_t	*shard;
+
+		if (offsets[i] == offsets[i + 1])
+			continue;
+
+		shard = cache->shards[i];
+
+		LOCK_SHARD(shard);
+		shard->history_num += hc_add_item_values(shard, item_values, hc_value_index + offsets[i],
+				offsets[i + 1] - offsets[i]);
+		UNLOCK_SHARD(shard);
+	}
 
 	item_values_num = 0;
 	string_values_offset = 0;
@@ -4009,8 +5293,122 @@ void	dc_flush_history(void)
  * history cache storage                                                      *
  *                                                                            *
  ******************************************************************************/
-ZBX_MEM_FUNC_IMPL(__hc_index, hc_index_mem)
-ZBX_MEM_FUNC_IMPL(__hc, hc_mem)
+ZBX_MEM_FUNC_IMPL(__hc_index0, hc_index_mems[0])
+ZBX_MEM_FUNC_IMPL(__hc_index1, hc_index_mems[1])
+ZBX_MEM_FUNC_IMPL(__hc_index2, hc_index_mems[2])
+ZBX_MEM_FUNC_IMPL(__hc_index3, hc_index_mems[3])
+ZBX_MEM_FUNC_IMPL(__hc_index4, hc_index_mems[4])
+ZBX_MEM_FUNC_IMPL(__hc_index5, hc_index_mems[5])
+ZBX_MEM_FUNC_IMPL(__hc_index6, hc_index_mems[6])
+ZBX_MEM_FUNC_IMPL(__hc_index7, hc_index_mems[7])
+ZBX_MEM_FUNC_IMPL(__hc_index8, hc_index_mems[8])
+ZBX_MEM_FUNC_IMPL(__hc_index9, hc_index_mems[9])
+ZBX_MEM_FUNC_IMPL(__hc_index10, hc_index_mems[10])
+ZBX_MEM_FUNC_IMPL(__hc_index11, hc_index_mems[11])
+ZBX_MEM_FUNC_IMPL(__hc_index12, hc_index_mems[12])
+ZBX_MEM_FUNC_IMPL(__hc_index13, hc_index_mems[13])
+ZBX_MEM_FUNC_IMPL(__hc_index14, hc_index_mems[14])
+ZBX_MEM_FUNC_IMPL(__hc_index15, hc_index_mems[15])
+
+typedef struct
+{
+	zbx_mem_malloc_func_t	malloc_func;
+	zbx_mem_realloc_func_t	realloc_func;
+	zbx_mem_free_func_t	free_func;
+}
+zbx_hc_mem_funcs_t;
+
+#define HC_INDEX_MEM_FUNCS(n)	{__hc_index ## n ## _mem_malloc_func, __hc_index ## n ## _mem_realloc_func,	\
+		__hc_index ## n ## _mem_free_func}
+
+/* the index memory allocators of history cache shards, one per ZBX_HC_SHARDS_MAX */
+static const zbx_hc_mem_funcs_t	hc_index_mem_funcs[ZBX_HC_SHARDS_MAX] = {
+	HC_INDEX_MEM_FUNCS(0), HC_INDEX_MEM_FUNCS(1), HC_INDEX_MEM_FUNCS(2), HC_INDEX_MEM_FUNCS(3),
+	HC_INDEX_MEM_FUNCS(4), HC_INDEX_MEM_FUNCS(5), HC_INDEX_MEM_FUNCS(6), HC_INDEX_MEM_FUNCS(7),
+	HC_INDEX_MEM_FUNCS(8), HC_INDEX_MEM_FUNCS(9), HC_INDEX_MEM_FUNCS(10), HC_INDEX_MEM_FUNCS(11),
+	HC_INDEX_MEM_FUNCS(12), HC_INDEX_MEM_FUNCS(13), HC_INDEX_MEM_FUNCS(14), HC_INDEX_MEM_FUNCS(15)
+};
+
+#undef HC_INDEX_MEM_FUNCS
+
+/* the history data memory is accessed directly, only under the owning shard lock */
+#define hc_mem_malloc(shard, size)		zbx_mem_malloc(hc_mems[(shard)->index], NULL, size)
+#define hc_mem_free(shard, ptr)			zbx_mem_free(hc_mems[(shard)->index], ptr)
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: returns history cache shard the item belongs to                   *
+ *                                                                            *
+ * Parameters: itemid - [IN] the item id                                      *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_hc_shard_t	*hc_get_shard(zbx_uint64_t itemid)
+{
+	return cache->shards[hc_get_shard_index(itemid)];
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: returns index of history cache shard the item belongs to          *
+ *                                                                            *
+ * Parameters: itemid - [IN] the item id                                      *
+ *                                                                            *
+ ******************************************************************************/
+static int	hc_get_shard_index(zbx_uint64_t itemid)
+{
+	return (int)(itemid % (zbx_uint64_t)cache->shards_num);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: reserves space in the buffers used to order values by shard       *
+ *                                                                            *
+ * Parameters: values_num - [IN] the number of values to order                *
+ *                                                                            *
+ ******************************************************************************/
+static void	hc_reserve_value_shards(size_t values_num)
+{
+	if (hc_value_shards_alloc >= values_num)
+		return;
+
+	hc_value_shards_alloc = MAX(values_num, hc_value_shards_alloc * 2);
+	hc_value_shards = (int *)zbx_realloc(hc_value_shards, hc_value_shards_alloc * sizeof(int));
+	hc_value_index = (int *)zbx_realloc(hc_value_index, hc_value_shards_alloc * sizeof(int));
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: orders values by history cache shard                              *
+ *                                                                            *
+ * Parameters: values_num - [IN] the number of values, their shard indexes    *
+ *                               are stored in hc_value_shards                *
+ *             offsets    - [OUT] hc_value_index elements from offsets[i] to  *
+ *                                offsets[i + 1] are the indexes of values    *
+ *                                belonging to shard i                        *
+ *                                                                            *
+ * Comments: The values are distributed with counting sort, so they are       *
+ *           bucketed in one pass and keep their order within a shard -       *
+ *           values of the same item are added in the order of collection.    *
+ *                                                                            *
+ ******************************************************************************/
+static void	hc_sort_values_by_shard(int values_num, int *offsets)
+{
+	int	next[ZBX_HC_SHARDS_MAX], i;
+
+	memset(offsets, 0, sizeof(int) * (size_t)(cache->shards_num + 1));
+
+	for (i = 0; i < values_num; i++)
+		offsets[hc_value_shards[i] + 1]++;
+
+	for (i = 0; i < cache->shards_num; i++)
+	{
+		offsets[i + 1] += offsets[i];
+		next[i] = offsets[i];
+	}
+
+	for (i = 0; i < values_num; i++)
+		hc_value_index[next[hc_value_shards[i]]++] = i;
+}
 
 /******************************************************************************
  *                                                                            *
@@ -4033,14 +5431,15 @@ static int	hc_queue_elem_compare_func(const void *d1, const void *d2)
  *                                                                            *
  * Purpose: free history item data allocated in history cache                 *
  *                                                                            *
- * Parameters: data - [IN] history item data                                  *
+ * Parameters: shard - [IN] the history cache shard                           *
+ *             data  - [IN] history item data                                 *
  *                                                                            *
  ******************************************************************************/
-static void	hc_free_data(zbx_hc_data_t *data)
+static void	hc_free_data(zbx_hc_shard_t *shard, zbx_hc_data_t *data)
 {
 	if (ITEM_STATE_NOTSUPPORTED == data->state)
 	{
-		__hc_mem_free_func(data->value.str);
+		hc_mem_free(shard, data->value.str);
 	}
 	else
 	{
@@ -4050,86 +5449,91 @@ static void	hc_free_data(zbx_hc_data_t *data)
 			{
 				case ITEM_VALUE_TYPE_STR:
 				case ITEM_VALUE_TYPE_TEXT:
-					__hc_mem_free_func(data->value.str);
+					hc_mem_free(shard, data->value.str);
 					break;
 				case ITEM_VALUE_TYPE_LOG:
-					__hc_mem_free_func(data->value.log->value);
+					hc_mem_free(shard, data->value.log->value);
 
 					if (NULL != data->value.log->source)
-						__hc_mem_free_func(data->value.log->source);
+						hc_mem_free(shard, data->value.log->source);
 
-					__hc_mem_free_func(data->value.log);
+					hc_mem_free(shard, data->value.log);
 					break;
 			}
 		}
 	}
 
-	__hc_mem_free_func(data);
+	hc_mem_free(shard, data);
 }
 
 /******************************************************************************
  *                                                                            *
  * Purpose: put back item into history queue                                  *
  *                                                                            *
- * Parameters: data - [IN] history item data                                  *
+ * Parameters: shard - [IN] the history cache shard                           *
+ *             item  - [IN] history item                                      *
  *                                                                            *
  ******************************************************************************/
-static void	hc_queue_item(zbx_hc_item_t *item)
+static void	hc_queue_item(zbx_hc_shard_t *shard, zbx_hc_item_t *item)
 {
 	zbx_binary_heap_elem_t	elem = {item->itemid, (const void *)item};
 
-	zbx_binary_heap_insert(&cache->history_queue, &elem);
+	zbx_binary_heap_insert(&shard->history_queue, &elem);
 }
 
 /******************************************************************************
  *                                                                            *
  * Purpose: returns history item by itemid                                    *
  *                                                                            *
- * Parameters: itemid - [IN] the item id                                      *
+ * Parameters: shard  - [IN] the history cache shard                          *
+ *             itemid - [IN] the item id                                      *
  *                                                                            *
  * Return value: the history item or NULL if the requested item is not in     *
  *               history cache                                                *
  *                                                                            *
  ******************************************************************************/
-static zbx_hc_item_t	*hc_get_item(zbx_uint64_t itemid)
+static zbx_hc_item_t	*hc_get_item(zbx_hc_shard_t *shard, zbx_uint64_t itemid)
 {
-	return (zbx_hc_item_t *)zbx_hashset_search(&cache->history_items, &itemid);
+	return (zbx_hc_item_t *)zbx_hashset_search(&shard->history_items, &itemid);
 }
 
 /******************************************************************************
  *                                                                            *
  * Purpose: adds a new item to history cache                                  *
  *                                                                            *
- * Parameters: itemid - [IN] the item id                                      *
- *                      [IN] the item data                                    *
+ * Parameters: shard  - [IN] the history cache shard                          *
+ *             itemid - [IN] the item id                                      *
+ *             data   - [IN] the item data                                    *
  *                                                                            *
  * Return value: the added history item                                       *
  *                                                                            *
  ******************************************************************************/
-static zbx_hc_item_t	*hc_add_item(zbx_uint64_t itemid, zbx_hc_data_t *data)
+static zbx_hc_item_t	*hc_add_item(zbx_hc_shard_t *shard, zbx_uint64_t itemid, zbx_hc_data_t *data)
 {
 	zbx_hc_item_t	item_local = {itemid, ZBX_HC_ITEM_STATUS_NORMAL, 0, data, data};
 
-	return (zbx_hc_item_t *)zbx_hashset_insert(&cache->history_items, &item_local, sizeof(item_local));
+	return (zbx_hc_item_t *)zbx_hashset_insert(&shard->history_items, &item_local, sizeof(item_local));
 }
 
 /******************************************************************************
  *                                                                            *
  * Purpose: copies string value to history cache                              *
  *                                                                            *
- * Parameters: str - [IN] the string value                                    *
+ * Parameters: shard   - [IN] the history cache shard                         *
+ *             str     - [IN] the string value                                *
+ *             strings - [IN] the buffer containing string values             *
  *                                                                            *
  * Return value: the copied string or NULL if there was not enough memory     *
  *                                                                            *
  ******************************************************************************/
-static char	*hc_mem_value_str_dup(const dc_value_str_t *str)
+static char	*hc_mem_value_str_dup(zbx_hc_shard_t *shard, const dc_value_str_t *str, const char *strings)
 {
 	char	*ptr;
 
-	if (NULL == (ptr = (char *)__hc_mem_malloc_func(NULL, str->len)))
+	if (NULL == (ptr = (char *)hc_mem_malloc(shard, str->len)))
 		return NULL;
 
-	memcpy(ptr, &string_values[str->pvalue], str->len - 1);
+	memcpy(ptr, &strings[str->pvalue], str->len - 1);
 	ptr[str->len - 1] = '\0';
 
 	return ptr;
@@ -4139,8 +5543,10 @@ static char	*hc_mem_value_str_dup(const dc_value_str_t *str)
  *                                                                            *
  * Purpose: clones string value into history data memory                      *
  *                                                                            *
- * Parameters: dst - [IN/OUT] a reference to the cloned value                 *
- *             str - [IN] the string value to clone                           *
+ * Parameters: shard   - [IN] the history cache shard                         *
+ *             dst     - [IN/OUT] a reference to the cloned value             *
+ *             str     - [IN] the string value to clone                       *
+ *             strings - [IN] the buffer containing string values             *
  *                                                                            *
  * Return value: SUCCESS - either there was no need to clone the string       *
  *                         (it was empty or already cloned) or the string was *
@@ -4151,7 +5557,8 @@ static char	*hc_mem_value_str_dup(const dc_value_str_t *str)
  *           until it finishes cloning string value.                          *
  *                                                                            *
  ******************************************************************************/
-static int	hc_clone_history_str_data(char **dst, const dc_value_str_t *str)
+static int	hc_clone_history_str_data(zbx_hc_shard_t *shard, char **dst, const dc_value_str_t *str,
+		const char *strings)
 {
 	if (0 == str->len)
 		return SUCCEED;
@@ -4159,7 +5566,7 @@ static int	hc_clone_history_str_data(char **dst, const dc_value_str_t *str)
 	if (NULL != *dst)
 		return SUCCEED;
 
-	if (NULL != (*dst = hc_mem_value_str_dup(str)))
+	if (NULL != (*dst = hc_mem_value_str_dup(shard, str, strings)))
 		return SUCCEED;
 
 	return FAIL;
@@ -4169,8 +5576,10 @@ static int	hc_clone_history_str_data(char **dst, const dc_value_str_t *str)
  *                                                                            *
  * Purpose: clones log value into history data memory                         *
  *                                                                            *
- * Parameters: dst        - [IN/OUT] a reference to the cloned value          *
+ * Parameters: shard      - [IN] the history cache shard                      *
+ *             dst        - [IN/OUT] a reference to the cloned value          *
  *             item_value - [IN] the log value to clone                       *
+ *             strings    - [IN] the buffer containing string values          *
  *                                                                            *
  * Return value: SUCCESS - the log value was cloned successfully              *
  *               FAIL    - not enough memory                                  *
@@ -4179,21 +5588,21 @@ static int	hc_clone_history_str_data(char **dst, const dc_value_str_t *str)
  *           until it finishes cloning log value.                             *
  *                                                                            *
  ******************************************************************************/
-static int	hc_clone_history_log_data(zbx_log_value_t **dst, const dc_item_value_t *item_value)
+static int	hc_clone_history_log_data(zbx_hc_shard_t *shard, zbx_log_value_t **dst,
+		const dc_item_value_t *item_value, const char *strings)
 {
 	if (NULL == *dst)
 	{
-		/* using realloc instead of malloc just to suppress 'not used' warning for realloc */
-		if (NULL == (*dst = (zbx_log_value_t *)__hc_mem_realloc_func(NULL, sizeof(zbx_log_value_t))))
+		if (NULL == (*dst = (zbx_log_value_t *)hc_mem_malloc(shard, sizeof(zbx_log_value_t))))
 			return FAIL;
 
 		memset(*dst, 0, sizeof(zbx_log_value_t));
 	}
 
-	if (SUCCEED != hc_clone_history_str_data(&(*dst)->value, &item_value->value.value_str))
+	if (SUCCEED != hc_clone_history_str_data(shard, &(*dst)->value, &item_value->value.value_str, strings))
 		return FAIL;
 
-	if (SUCCEED != hc_clone_history_str_data(&(*dst)->source, &item_value->source))
+	if (SUCCEED != hc_clone_history_str_data(shard, &(*dst)->source, &item_value->source, strings))
 		return FAIL;
 
 	(*dst)->logeventid = item_value->logeventid;
@@ -4207,8 +5616,10 @@ static int	hc_clone_history_log_data(zbx_log_value_t **dst, const dc_item_value_
  *                                                                            *
  * Purpose: clones item value from local cache into history cache             *
  *                                                                            *
- * Parameters: data       - [IN/OUT] a reference to the cloned value          *
+ * Parameters: shard      - [IN] the history cache shard                      *
+ *             data       - [IN/OUT] a reference to the cloned value          *
  *             item_value - [IN] the item value                               *
+ *             strings    - [IN] the buffer containing string values          *
  *                                                                            *
  * Return value: SUCCESS - the item value was cloned successfully             *
  *               FAIL    - not enough memory                                  *
@@ -4217,11 +5628,12 @@ static int	hc_clone_history_log_data(zbx_log_value_t **dst, const dc_item_value_
  *           until it finishes cloning item value.                            *
  *                                                                            *
  ******************************************************************************/
-static int	hc_clone_history_data(zbx_hc_data_t **data, const dc_item_value_t *item_value)
+static int	hc_clone_history_data(zbx_hc_shard_t *shard, zbx_hc_data_t **data, const dc_item_value_t *item_value,
+		const char *strings)
 {
 	if (NULL == *data)
 	{
-		if (NULL == (*data = (zbx_hc_data_t *)__hc_mem_malloc_func(NULL, sizeof(zbx_hc_data_t))))
+		if (NULL == (*data = (zbx_hc_data_t *)hc_mem_malloc(shard, sizeof(zbx_hc_data_t))))
 			return FAIL;
 
 		memset(*data, 0, sizeof(zbx_hc_data_t));
@@ -4239,24 +5651,30 @@ static int	hc_clone_history_data(zbx_hc_data_t **data, const dc_item_value_t *it
 
 	if (ITEM_STATE_NOTSUPPORTED == item_value->state)
 	{
-		if (NULL == ((*data)->value.str = hc_mem_value_str_dup(&item_value->value.value_str)))
+		if (NULL == ((*data)->value.str = hc_mem_value_str_dup(shard, &item_value->value.value_str,
+				strings)))
+		{
 			return FAIL;
+		}
 
 		(*data)->value_type = item_value->value_type;
-		cache->stats.notsupported_counter++;
+		shard->stats.notsupported_counter++;
 
 		return SUCCEED;
 	}
 
 	if (0 != (ZBX_DC_FLAG_LLD & item_value->flags))
 	{
-		if (NULL == ((*data)->value.str = hc_mem_value_str_dup(&item_value->value.value_str)))
+		if (NULL == ((*data)->value.str = hc_mem_value_str_dup(shard, &item_value->value.value_str,
+				strings)))
+		{
 			return FAIL;
+		}
 
 		(*data)->value_type = ITEM_VALUE_TYPE_TEXT;
 
-		cache->stats.history_text_counter++;
-		cache->stats.history_counter++;
+		shard->stats.history_text_counter++;
+		shard->stats.history_counter++;
 
 		return SUCCEED;
 	}
@@ -4272,121 +5690,202 @@ static int	hc_clone_history_data(zbx_hc_data_t **data, const dc_item_value_t *it
 				(*data)->value.ui64 = item_value->value.value_uint;
 				break;
 			case ITEM_VALUE_TYPE_STR:
-				if (SUCCEED != hc_clone_history_str_data(&(*data)->value.str,
-						&item_value->value.value_str))
+				if (SUCCEED != hc_clone_history_str_data(shard, &(*data)->value.str,
+						&item_value->value.value_str, strings))
 				{
 					return FAIL;
 				}
 				break;
 			case ITEM_VALUE_TYPE_TEXT:
-				if (SUCCEED != hc_clone_history_str_data(&(*data)->value.str,
-						&item_value->value.value_str))
+				if (SUCCEED != hc_clone_history_str_data(shard, &(*data)->value.str,
+						&item_value->value.value_str, strings))
 				{
 					return FAIL;
 				}
 				break;
 			case ITEM_VALUE_TYPE_LOG:
-				if (SUCCEED != hc_clone_history_log_data(&(*data)->value.log, item_value))
+				if (SUCCEED != hc_clone_history_log_data(shard, &(*data)->value.log, item_value, strings))
 					return FAIL;
 				break;
 		}
 
 		switch (item_value->item_value_type)
 		{
-			case ITEM_VALUE_TYPE_FLOAT:
-				cache->stats.history_float_counter++;
-				break;
-			case ITEM_VALUE_TYPE_UINT64:
-				cache->stats.history_uint_counter++;
-				break;
+			case ITEM_VALUE_TYPE_FLOAT:
+				shard->stats.history_float_counter++;
+				break;
+			case ITEM_VALUE_TYPE_UINT64:
+				shard->stats.history_uint_counter++;
+				break;
+			case ITEM_VALUE_TYPE_STR:
+				shard->stats.history_str_counter++;
+				break;
+			case ITEM_VALUE_TYPE_TEXT:
+				shard->stats.history_text_counter++;
+				break;
+			case ITEM_VALUE_TYPE_LOG:
+				shard->stats.history_log_counter++;
+				break;
+		}
+
+		shard->stats.history_counter++;
+	}
+
+	(*data)->value_type = item_value->value_type;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: frees partially cloned history data                               *
+ *                                                                            *
+ * Parameters: shard      - [IN] the history cache shard                      *
+ *             data       - [IN] the partially cloned history data            *
+ *             item_value - [IN] the item value being cloned                  *
+ *                                                                            *
+ ******************************************************************************/
+static void	hc_free_partial_data(zbx_hc_shard_t *shard, zbx_hc_data_t *data, const dc_item_value_t *item_value)
+{
+	if (ITEM_STATE_NOTSUPPORTED == item_value->state || 0 != (ZBX_DC_FLAG_LLD & item_value->flags))
+	{
+		if (NULL != data->value.str)
+			hc_mem_free(shard, data->value.str);
+	}
+	else if (0 == (ZBX_DC_FLAG_NOVALUE & item_value->flags))
+	{
+		switch (item_value->value_type)
+		{
 			case ITEM_VALUE_TYPE_STR:
-				cache->stats.history_str_counter++;
-				break;
 			case ITEM_VALUE_TYPE_TEXT:
-				cache->stats.history_text_counter++;
+				if (NULL != data->value.str)
+					hc_mem_free(shard, data->value.str);
 				break;
 			case ITEM_VALUE_TYPE_LOG:
-				cache->stats.history_log_counter++;
+				if (NULL == data->value.log)
+					break;
+
+				if (NULL != data->value.log->value)
+					hc_mem_free(shard, data->value.log->value);
+
+				if (NULL != data->value.log->source)
+					hc_mem_free(shard, data->value.log->source);
+
+				hc_mem_free(shard, data->value.log);
 				break;
 		}
-
-		cache->stats.history_counter++;
 	}
 
-	(*data)->value_type = item_value->value_type;
-
-	return SUCCEED;
+	hc_mem_free(shard, data);
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: adds item values to the history cache                             *
+ * Purpose: adds item value to the history cache shard                        *
  *                                                                            *
- * Parameters: values     - [IN] the item values to add                       *
- *             values_num - [IN] the number of item values to add             *
+ * Parameters: shard      - [IN] the history cache shard                      *
+ *             item_value - [IN] the item value to add                        *
+ *             strings    - [IN] the buffer containing string values          *
+ *             wait       - [IN] 1 - wait for free space if the history cache *
+ *                                   is full                                  *
+ *                               0 - fail if the history cache is full        *
  *                                                                            *
- * Comments: If the history cache is full this function will wait until       *
- *           history syncers processes values freeing enough space to store   *
- *           the new value.                                                   *
+ * Return value: SUCCEED - the value was added                                *
+ *               FAIL    - not enough memory (only when not waiting)          *
+ *                                                                            *
+ * Comments: The shard must be locked. When waiting for free space the shard  *
+ *           lock is released while sleeping, so history syncers can process  *
+ *           the cached values.                                               *
  *                                                                            *
  ******************************************************************************/
-static void	hc_add_item_values(dc_item_value_t *values, int values_num)
+static int	hc_add_item_value(zbx_hc_shard_t *shard, const dc_item_value_t *item_value, const char *strings,
+		int wait)
 {
-	dc_item_value_t	*item_value;
-	int		i;
 	zbx_hc_item_t	*item;
+	zbx_hc_data_t	*data = NULL;
 
-	for (i = 0; i < values_num; i++)
+	/* a record with metadata and no value can be dropped if  */
+	/* the metadata update is copied to the last queued value */
+	if (NULL != (item = hc_get_item(shard, item_value->itemid)) &&
+			0 != (item_value->flags & ZBX_DC_FLAG_NOVALUE) &&
+			0 != (item_value->flags & ZBX_DC_FLAG_META))
 	{
-		zbx_hc_data_t	*data = NULL;
-
-		item_value = &values[i];
-
-		/* a record with metadata and no value can be dropped if  */
-		/* the metadata update is copied to the last queued value */
-		if (NULL != (item = hc_get_item(item_value->itemid)) &&
-				0 != (item_value->flags & ZBX_DC_FLAG_NOVALUE) &&
-				0 != (item_value->flags & ZBX_DC_FLAG_META))
+		/* skip metadata updates when only one value is queued, */
+		/* because the item might be already being processed    */
+		if (item->head != item->tail)
 		{
-			/* skip metadata updates when only one value is queued, */
-			/* because the item might be already being processed    */
-			if (item->head != item->tail)
-			{
-				item->head->lastlogsize = item_value->lastlogsize;
-				item->head->mtime = item_value->mtime;
-				item->head->flags |= ZBX_DC_FLAG_META;
-				continue;
-			}
+			item->head->lastlogsize = item_value->lastlogsize;
+			item->head->mtime = item_value->mtime;
+			item->head->flags |= ZBX_DC_FLAG_META;
+			return SUCCEED;
 		}
+	}
 
-		if (SUCCEED != hc_clone_history_data(&data, item_value))
+	if (SUCCEED != hc_clone_history_data(shard, &data, item_value, strings))
+	{
+		if (0 == wait)
 		{
-			do
-			{
-				UNLOCK_CACHE;
-
-				zabbix_log(LOG_LEVEL_DEBUG, "History cache is full. Sleeping for 1 second.");
-				sleep(1);
+			if (NULL != data)
+				hc_free_partial_data(shard, data, item_value);
 
-				LOCK_CACHE;
-			}
-			while (SUCCEED != hc_clone_history_data(&data, item_value));
-
-			item = hc_get_item(item_value->itemid);
+			return FAIL;
 		}
 
-		if (NULL == item)
-		{
-			item = hc_add_item(item_value->itemid, data);
-			hc_queue_item(item);
-		}
-		else
+		do
 		{
-			item->head->next = data;
-			item->head = data;
+			UNLOCK_SHARD(shard);
+
+			zabbix_log(LOG_LEVEL_DEBUG, "History cache is full. Sleeping for 1 second.");
+			sleep(1);
+
+			LOCK_SHARD(shard);
 		}
-		item->values_num++;
+		while (SUCCEED != hc_clone_history_data(shard, &data, item_value, strings));
+
+		item = hc_get_item(shard, item_value->itemid);
+	}
+
+	if (NULL == item)
+	{
+		item = hc_add_item(shard, item_value->itemid, data);
+		hc_queue_item(shard, item);
+	}
+	else
+	{
+		item->head->next = data;
+		item->head = data;
 	}
+	item->values_num++;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: adds item values to the history cache shard                       *
+ *                                                                            *
+ * Parameters: shard     - [IN] the history cache shard                       *
+ *             values    - [IN] the item values                               *
+ *             index     - [IN] the indexes of values to add, all of them     *
+ *                              belonging to the specified shard              *
+ *             index_num - [IN] the number of values to add                   *
+ *                                                                            *
+ * Return value: the number of added values                                   *
+ *                                                                            *
+ * Comments: If the history cache is full this function will wait until       *
+ *           history syncers processes values freeing enough space to store   *
+ *           the new value.                                                   *
+ *                                                                            *
+ ******************************************************************************/
+static int	hc_add_item_values(zbx_hc_shard_t *shard, const dc_item_value_t *values, const int *index,
+		int index_num)
+{
+	int	i;
+
+	for (i = 0; i < index_num; i++)
+		hc_add_item_value(shard, &values[index[i]], string_values, 1);
+
+	return index_num;
 }
 
 /******************************************************************************
@@ -4453,27 +5952,71 @@ static void	hc_copy_history_data(ZBX_DC_HISTORY *history, zbx_uint64_t itemid, z
 
 /******************************************************************************
  *                                                                            *
- * Purpose: pops the next batch of history items from cache for processing    *
+ * Purpose: pops the next batch of history items from cache shard for         *
+ *          processing                                                        *
  *                                                                            *
- * Parameters: history_items - [OUT] the locked history items                 *
+ * Parameters: shard         - [IN] the history cache shard                   *
+ *             history_items - [OUT] the locked history items                 *
  *                                                                            *
  * Comments: The history_items must be returned back to history cache with    *
  *           hc_push_items() function after they have been processed.         *
  *                                                                            *
  ******************************************************************************/
-static void	hc_pop_items(zbx_vector_ptr_t *history_items)
+static void	hc_pop_items(zbx_hc_shard_t *shard, zbx_vector_ptr_t *history_items)
 {
 	zbx_binary_heap_elem_t	*elem;
 	zbx_hc_item_t		*item;
 
-	while (ZBX_HC_SYNC_MAX > history_items->values_num && FAIL == zbx_binary_heap_empty(&cache->history_queue))
+	while (ZBX_HC_SYNC_MAX > history_items->values_num && FAIL == zbx_binary_heap_empty(&shard->history_queue))
 	{
-		elem = zbx_binary_heap_find_min(&cache->history_queue);
+		elem = zbx_binary_heap_find_min(&shard->history_queue);
 		item = (zbx_hc_item_t *)elem->data;
 		zbx_vector_ptr_append(history_items, item);
 
-		zbx_binary_heap_remove_min(&cache->history_queue);
+		zbx_binary_heap_remove_min(&shard->history_queue);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: pops the next batch of history items from the first non-empty     *
+ *          history cache shard                                               *
+ *                                                                            *
+ * Parameters: history_items - [OUT] the locked history items                 *
+ *                                                                            *
+ * Return value: the shard history items were taken from or NULL if history   *
+ *               cache is empty                                               *
+ *                                                                            *
+ * Comments: Shards are checked in round-robin order, starting with shard     *
+ *           selected by process number, so that concurrent syncers start     *
+ *           with different shards.                                           *
+ *           The history_items must be returned back to the returned shard    *
+ *           with hc_push_items() function after they have been processed.    *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_hc_shard_t	*hc_pop_shard_items(zbx_vector_ptr_t *history_items)
+{
+	static int	shard_next = -1;
+	int		i;
+
+	if (-1 == shard_next || shard_next >= cache->shards_num)
+		shard_next = process_num % cache->shards_num;
+
+	for (i = 0; i < cache->shards_num; i++)
+	{
+		zbx_hc_shard_t	*shard = cache->shards[shard_next];
+
+		shard_next = (shard_next + 1) % cache->shards_num;
+
+		LOCK_SHARD(shard);
+		hc_pop_items(shard, history_items);
+		UNLOCK_SHARD(shard);
+
+		if (0 != history_items->values_num)
+			return shard;
 	}
+
+	return NULL;
 }
 
 /******************************************************************************
@@ -4506,7 +6049,9 @@ static void	hc_get_item_values(ZBX_DC_HISTORY *history, zbx_vector_ptr_t *histor
  *                                                                            *
  * Purpose: push back the processed history items into history cache          *
  *                                                                            *
- * Parameters: history_items - [IN] the history items containing processed    *
+ * Parameters: shard         - [IN] the history cache shard the items were    *
+ *                                  taken from                                *
+ *             history_items - [IN] the history items containing processed    *
  *                                  (available) and busy items                *
  *                                                                            *
  * Comments: This function removes processed value from history cache.        *
@@ -4514,7 +6059,7 @@ static void	hc_get_item_values(ZBX_DC_HISTORY *history, zbx_vector_ptr_t *histor
  *           removed from history index.                                      *
  *                                                                            *
  ******************************************************************************/
-void	hc_push_items(zbx_vector_ptr_t *history_items)
+static void	hc_push_items(zbx_hc_shard_t *shard, zbx_vector_ptr_t *history_items)
 {
 	int		i;
 	zbx_hc_item_t	*item;
@@ -4529,17 +6074,17 @@ void	hc_push_items(zbx_vector_ptr_t *history_items)
 			case ZBX_HC_ITEM_STATUS_BUSY:
 				/* reset item status before returning it to queue */
 				item->status = ZBX_HC_ITEM_STATUS_NORMAL;
-				hc_queue_item(item);
+				hc_queue_item(shard, item);
 				break;
 			case ZBX_HC_ITEM_STATUS_NORMAL:
 				item->values_num--;
 				data_free = item->tail;
 				item->tail = item->tail->next;
-				hc_free_data(data_free);
+				hc_free_data(shard, data_free);
 				if (NULL == item->tail)
-					zbx_hashset_remove(&cache->history_items, item);
+					zbx_hashset_remove(&shard->history_items, item);
 				else
-					hc_queue_item(item);
+					hc_queue_item(shard, item);
 				break;
 		}
 	}
@@ -4549,10 +6094,90 @@ void	hc_push_items(zbx_vector_ptr_t *history_items)
  *                                                                            *
  * Purpose: retrieve the size of history queue                                *
  *                                                                            *
+ * Comments: History cache shards must not be locked by the caller.           *
+ *           Values waiting in history rings are counted as queued, because   *
+ *           they are moved to the queue by the next history sync.            *
+ *                                                                            *
+ ******************************************************************************/
+static int	hc_queue_get_size(void)
+{
+	int	i, size = hc_rings_get_values_num();
+
+	for (i = 0; i < cache->shards_num; i++)
+	{
+		zbx_hc_shard_t	*shard = cache->shards[i];
+
+		LOCK_SHARD(shard);
+		size += shard->history_queue.elems_num;
+		UNLOCK_SHARD(shard);
+	}
+
+	return size;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: retrieve the number of values in history cache                    *
+ *                                                                            *
+ * Comments: History cache shards must not be locked by the caller.           *
+ *                                                                            *
+ ******************************************************************************/
+static int	hc_get_history_num(void)
+{
+	int	i, history_num = 0;
+
+	for (i = 0; i < cache->shards_num; i++)
+	{
+		zbx_hc_shard_t	*shard = cache->shards[i];
+
+		LOCK_SHARD(shard);
+		history_num += shard->history_num;
+		UNLOCK_SHARD(shard);
+	}
+
+	return history_num;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: retrieve history cache statistics summed over all shards          *
+ *                                                                            *
+ * Parameters: stats         - [OUT] the value counters                       *
+ *             history_free  - [OUT] the free history data memory             *
+ *             history_total - [OUT] the total history data memory            *
+ *             index_free    - [OUT] the free history index memory            *
+ *             index_total   - [OUT] the total history index memory           *
+ *                                                                            *
  ******************************************************************************/
-int	hc_queue_get_size(void)
+static void	hc_get_stats(ZBX_DC_STATS *stats, zbx_uint64_t *history_free, zbx_uint64_t *history_total,
+		zbx_uint64_t *index_free, zbx_uint64_t *index_total)
 {
-	return cache->history_queue.elems_num;
+	int	i;
+
+	memset(stats, 0, sizeof(ZBX_DC_STATS));
+	*history_free = *history_total = *index_free = *index_total = 0;
+
+	for (i = 0; i < cache->shards_num; i++)
+	{
+		zbx_hc_shard_t	*shard = cache->shards[i];
+
+		LOCK_SHARD(shard);
+
+		stats->history_counter += shard->stats.history_counter;
+		stats->history_float_counter += shard->stats.history_float_counter;
+		stats->history_uint_counter += shard->stats.history_uint_counter;
+		stats->history_str_counter += shard->stats.history_str_counter;
+		stats->history_log_counter += shard->stats.history_log_counter;
+		stats->history_text_counter += shard->stats.history_text_counter;
+		stats->notsupported_counter += shard->stats.notsupported_counter;
+
+		*history_free += hc_mems[i]->free_size;
+		*history_total += hc_mems[i]->total_size;
+		*index_free += hc_index_mems[i]->free_size;
+		*index_total += hc_index_mems[i]->total_size;
+
+		UNLOCK_SHARD(shard);
+	}
 }
 
 int	hc_get_history_compression_age(void)
@@ -4623,6 +6248,85 @@ out:
 	return ret;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: create history cache shard lock and shared memory segments        *
+ *                                                                            *
+ * Parameters: index - [IN] the shard index                                   *
+ *             error - [OUT] the error message                                *
+ *                                                                            *
+ * Return value: SUCCEED - the shard resources were created successfully      *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: The first shard uses ZBX_MUTEX_CACHE lock and keeps the original *
+ *           history cache segment names.                                     *
+ *                                                                            *
+ ******************************************************************************/
+static int	hc_shard_mem_create(int index, char **error)
+{
+	char		data_descr[MAX_STRING_LEN], index_descr[MAX_STRING_LEN];
+	zbx_uint64_t	data_size, index_size;
+	int		ret;
+
+	data_size = CONFIG_HISTORY_CACHE_SIZE / CONFIG_HISTORY_CACHE_SHARDS;
+	index_size = CONFIG_HISTORY_INDEX_CACHE_SIZE / CONFIG_HISTORY_CACHE_SHARDS;
+
+	if (0 == index)
+	{
+		hc_locks[0] = cache_lock;
+		zbx_strlcpy(data_descr, "history cache", sizeof(data_descr));
+		zbx_strlcpy(index_descr, "history index cache", sizeof(index_descr));
+	}
+	else
+	{
+		if (SUCCEED != (ret = zbx_mutex_create(&hc_locks[index],
+				(zbx_mutex_name_t)(ZBX_MUTEX_CACHE_SHARD + index - 1), error)))
+		{
+			return ret;
+		}
+
+		zbx_snprintf(data_descr, sizeof(data_descr), "history cache shard #%d", index + 1);
+		zbx_snprintf(index_descr, sizeof(index_descr), "history index cache shard #%d", index + 1);
+	}
+
+	if (SUCCEED != (ret = zbx_mem_create(&hc_mems[index], data_size, data_descr, "HistoryCacheSize", 1, error)))
+		return ret;
+
+	if (0 != CONFIG_CACHE_SLAB_ALLOCATOR)
+		zbx_mem_use_slabs(hc_mems[index]);
+
+	return zbx_mem_create(&hc_index_mems[index], index_size, index_descr, "HistoryIndexCacheSize", 0, error);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: create history cache shard in its index memory segment            *
+ *                                                                            *
+ * Parameters: index - [IN] the shard index                                   *
+ *                                                                            *
+ * Return value: the created shard                                            *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_hc_shard_t	*hc_shard_create(int index)
+{
+	zbx_hc_shard_t			*shard;
+	const zbx_hc_mem_funcs_t	*funcs = &hc_index_mem_funcs[index];
+
+	shard = (zbx_hc_shard_t *)funcs->malloc_func(NULL, sizeof(zbx_hc_shard_t));
+	memset(shard, 0, sizeof(zbx_hc_shard_t));
+
+	shard->index = index;
+
+	zbx_hashset_create_ext(&shard->history_items, ZBX_HC_ITEMS_INIT_SIZE / CONFIG_HISTORY_CACHE_SHARDS,
+			ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC, NULL,
+			funcs->malloc_func, funcs->realloc_func, funcs->free_func);
+
+	zbx_binary_heap_create_ext(&shard->history_queue, hc_queue_elem_compare_func, ZBX_BINARY_HEAP_OPTION_EMPTY,
+			funcs->malloc_func, funcs->realloc_func, funcs->free_func);
+
+	return shard;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: Allocate shared memory for database cache                         *
@@ -4630,7 +6334,8 @@ out:
  ******************************************************************************/
 int	init_database_cache(char **error)
 {
-	int	ret;
+	int				ret, i;
+	const zbx_hc_mem_funcs_t	*funcs = &hc_index_mem_funcs[0];
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -4640,44 +6345,56 @@ int	init_database_cache(char **error)
 		goto out;
 	}
 
-	if (SUCCEED != (ret = zbx_mutex_create(&cache_lock, ZBX_MUTEX_CACHE, error)))
-		goto out;
-
-	if (SUCCEED != (ret = zbx_mutex_create(&cache_ids_lock, ZBX_MUTEX_CACHE_IDS, error)))
+	if (ZBX_HC_SHARDS_MAX < CONFIG_HISTORY_CACHE_SHARDS || 1 > CONFIG_HISTORY_CACHE_SHARDS)
+	{
+		*error = zbx_dsprintf(*error, "invalid HistoryCacheShards value: %d", CONFIG_HISTORY_CACHE_SHARDS);
+		ret = FAIL;
 		goto out;
+	}
 
-	if (SUCCEED != (ret = zbx_mem_create(&hc_mem, CONFIG_HISTORY_CACHE_SIZE, "history cache",
-			"HistoryCacheSize", 1, error)))
+	if (ZBX_HC_SHARD_SIZE_MIN > CONFIG_HISTORY_CACHE_SIZE / CONFIG_HISTORY_CACHE_SHARDS ||
+			ZBX_HC_SHARD_SIZE_MIN > CONFIG_HISTORY_INDEX_CACHE_SIZE / CONFIG_HISTORY_CACHE_SHARDS)
 	{
+		*error = zbx_dsprintf(*error, "HistoryCacheSize and HistoryIndexCacheSize must be at least "
+				ZBX_FS_UI64 " bytes per each of %d history cache shards", ZBX_HC_SHARD_SIZE_MIN,
+				CONFIG_HISTORY_CACHE_SHARDS);
+		ret = FAIL;
 		goto out;
 	}
 
-	if (SUCCEED != (ret = zbx_mem_create(&hc_index_mem, CONFIG_HISTORY_INDEX_CACHE_SIZE, "history index cache",
-			"HistoryIndexCacheSize", 0, error)))
-	{
+	if (SUCCEED != (ret = zbx_mutex_create(&cache_lock, ZBX_MUTEX_CACHE, error)))
+		goto out;
+
+	if (SUCCEED != (ret = zbx_mutex_create(&cache_ids_lock, ZBX_MUTEX_CACHE_IDS, error)))
 		goto out;
+
+	for (i = 0; i < CONFIG_HISTORY_CACHE_SHARDS; i++)
+	{
+		if (SUCCEED != (ret = hc_shard_mem_create(i, error)))
+			goto out;
 	}
 
-	cache = (ZBX_DC_CACHE *)__hc_index_mem_malloc_func(NULL, sizeof(ZBX_DC_CACHE));
+	cache = (ZBX_DC_CACHE *)funcs->malloc_func(NULL, sizeof(ZBX_DC_CACHE));
 	memset(cache, 0, sizeof(ZBX_DC_CACHE));
 
-	ids = (ZBX_DC_IDS *)__hc_index_mem_malloc_func(NULL, sizeof(ZBX_DC_IDS));
+	ids = (ZBX_DC_IDS *)funcs->malloc_func(NULL, sizeof(ZBX_DC_IDS));
 	memset(ids, 0, sizeof(ZBX_DC_IDS));
 
-	zbx_hashset_create_ext(&cache->history_items, ZBX_HC_ITEMS_INIT_SIZE,
-			ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC, NULL,
-			__hc_index_mem_malloc_func, __hc_index_mem_realloc_func, __hc_index_mem_free_func);
+	cache->shards_num = CONFIG_HISTORY_CACHE_SHARDS;
 
-	zbx_binary_heap_create_ext(&cache->history_queue, hc_queue_elem_compare_func, ZBX_BINARY_HEAP_OPTION_EMPTY,
-			__hc_index_mem_malloc_func, __hc_index_mem_realloc_func, __hc_index_mem_free_func);
+	for (i = 0; i < cache->shards_num; i++)
+		cache->shards[i] = hc_shard_create(i);
+
+	if (SUCCEED != (ret = hc_rings_create(error)))
+		goto out;
 
 	if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
 	{
 		zbx_hashset_create_ext(&(cache->proxyqueue.index), ZBX_HC_SYNC_MAX,
 			ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC, NULL,
-			__hc_index_mem_malloc_func, __hc_index_mem_realloc_func, __hc_index_mem_free_func);
+			funcs->malloc_func, funcs->realloc_func, funcs->free_func);
 
-		zbx_list_create_ext(&(cache->proxyqueue.list), __hc_index_mem_malloc_func, __hc_index_mem_free_func);
+		zbx_list_create_ext(&(cache->proxyqueue.list), funcs->malloc_func, funcs->free_func);
 
 		cache->proxyqueue.state = ZBX_HC_PROXYQUEUE_STATE_NORMAL;
 
@@ -4721,6 +6438,8 @@ static void	DCsync_all(void)
  ******************************************************************************/
 void	free_database_cache(int sync)
 {
+	int	i;
+
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
 	if (ZBX_SYNC_ALL == sync)
@@ -4728,10 +6447,18 @@ void	free_database_cache(int sync)
 
 	cache = NULL;
 
-	zbx_mem_destroy(hc_mem);
-	hc_mem = NULL;
-	zbx_mem_destroy(hc_index_mem);
-	hc_index_mem = NULL;
+	for (i = 0; i < CONFIG_HISTORY_CACHE_SHARDS; i++)
+	{
+		zbx_mem_destroy(hc_mems[i]);
+		hc_mems[i] = NULL;
+		zbx_mem_destroy(hc_index_mems[i]);
+		hc_index_mems[i] = NULL;
+
+		if (0 != i)
+			zbx_mutex_destroy(&hc_locks[i]);
+	}
+
+	hc_rings_destroy();
 
 	zbx_mutex_destroy(&cache_lock);
 	zbx_mutex_destroy(&cache_ids_lock);
@@ -4851,17 +6578,108 @@ out:
  *                                                                            *
  * Purpose: get history cache diagnostics statistics                          *
  *                                                                            *
+ * Parameters: items_num  - [OUT] the number of cached items                  *
+ *             values_num - [OUT] the number of cached values                 *
+ *             shards     - [OUT] the per shard statistics, must have space   *
+ *                                for ZBX_HC_SHARDS_MAX elements (optional)   *
+ *             shards_num - [OUT] the number of history cache shards          *
+ *                                (optional)                                  *
+ *                                                                            *
  ******************************************************************************/
-void	zbx_hc_get_diag_stats(zbx_uint64_t *items_num, zbx_uint64_t *values_num)
+void	zbx_hc_get_diag_stats(zbx_uint64_t *items_num, zbx_uint64_t *values_num, zbx_hc_shard_stats_t *shards,
+		int *shards_num)
 {
-	LOCK_CACHE;
+	int	i;
+
+	*values_num = 0;
+	*items_num = 0;
+
+	for (i = 0; i < cache->shards_num; i++)
+	{
+		zbx_hc_shard_t	*shard = cache->shards[i];
+
+		LOCK_SHARD(shard);
+
+		*values_num += shard->history_num;
+		*items_num += shard->history_items.num_data;
+
+		if (NULL != shards)
+		{
+			shards[i].values_num = shard->history_num;
+			shards[i].items_num = shard->history_items.num_data;
+			shards[i].queue_num = shard->history_queue.elems_num;
+			shards[i].data_free = hc_mems[i]->free_size;
+			shards[i].data_total = hc_mems[i]->total_size;
+			shards[i].index_free = hc_index_mems[i]->free_size;
+			shards[i].index_total = hc_index_mems[i]->total_size;
+		}
+
+		UNLOCK_SHARD(shard);
+	}
 
-	*values_num = cache->history_num;
-	*items_num = cache->history_items.num_data;
+	if (NULL != shards_num)
+		*shards_num = cache->shards_num;
+}
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get history syncer statistics                                     *
+ *                                                                            *
+ * Parameters: stats - [OUT] the time spent in history sync stages since      *
+ *                           server start                                     *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_hc_get_sync_stats(zbx_hc_sync_stats_t *stats)
+{
+	LOCK_CACHE;
+	*stats = cache->sync_stats;
 	UNLOCK_CACHE;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: adds shared memory allocator statistics of a history cache shard  *
+ *          to the total statistics                                           *
+ *                                                                            *
+ ******************************************************************************/
+static void	hc_mem_stats_add(zbx_mem_stats_t *total, const zbx_mem_stats_t *stats, int first)
+{
+	int	i;
+
+	if (0 != first)
+	{
+		*total = *stats;
+		return;
+	}
+
+	total->free_size += stats->free_size;
+	total->used_size += stats->used_size;
+	total->overhead += stats->overhead;
+	total->free_chunks += stats->free_chunks;
+	total->used_chunks += stats->used_chunks;
+
+	if (stats->min_chunk_size < total->min_chunk_size)
+		total->min_chunk_size = stats->min_chunk_size;
+
+	if (stats->max_chunk_size > total->max_chunk_size)
+		total->max_chunk_size = stats->max_chunk_size;
+
+	total->fragmented_size += stats->fragmented_size;
+
+	for (i = 0; i < MEM_BUCKET_COUNT; i++)
+		total->chunks_num[i] += stats->chunks_num[i];
+
+	total->slabs_size += stats->slabs_size;
+	total->slabs_free_size += stats->slabs_free_size;
+
+	for (i = 0; i < MEM_SLAB_CLASS_COUNT; i++)
+	{
+		total->slabs_num[i] += stats->slabs_num[i];
+		total->slab_objects_num[i] += stats->slab_objects_num[i];
+		total->slab_objects_used[i] += stats->slab_objects_used[i];
+	}
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: get shared memory allocator statistics                            *
@@ -4869,15 +6687,29 @@ void	zbx_hc_get_diag_stats(zbx_uint64_t *items_num, zbx_uint64_t *values_num)
  ******************************************************************************/
 void	zbx_hc_get_mem_stats(zbx_mem_stats_t *data, zbx_mem_stats_t *index)
 {
-	LOCK_CACHE;
+	int		i;
+	zbx_mem_stats_t	stats;
+
+	for (i = 0; i < cache->shards_num; i++)
+	{
+		zbx_hc_shard_t	*shard = cache->shards[i];
 
-	if (NULL != data)
-		zbx_mem_get_stats(hc_mem, data);
+		LOCK_SHARD(shard);
 
-	if (NULL != index)
-		zbx_mem_get_stats(hc_index_mem, index);
+		if (NULL != data)
+		{
+			zbx_mem_get_stats(hc_mems[i], &stats);
+			hc_mem_stats_add(data, &stats, 0 == i);
+		}
 
-	UNLOCK_CACHE;
+		if (NULL != index)
+		{
+			zbx_mem_get_stats(hc_index_mems[i], &stats);
+			hc_mem_stats_add(index, &stats, 0 == i);
+		}
+
+		UNLOCK_SHARD(shard);
+	}
 }
 
 /******************************************************************************
@@ -4887,14 +6719,18 @@ void	zbx_hc_get_mem_stats(zbx_mem_stats_t *data, zbx_mem_stats_t *index)
  ******************************************************************************/
 int	zbx_hc_is_itemid_cached(zbx_uint64_t itemid)
 {
-	int	ret = FAIL;
+	int		ret = FAIL;
+	zbx_hc_shard_t	*shard = hc_get_shard(itemid);
 
-	LOCK_CACHE;
+	LOCK_SHARD(shard);
 
-	if (NULL != zbx_hashset_search(&cache->history_items, &itemid))
+	if (NULL != zbx_hashset_search(&shard->history_items, &itemid))
 		ret = SUCCEED;
 
-	UNLOCK_CACHE;
+	UNLOCK_SHARD(shard);
+
+	if (SUCCEED != ret)
+		ret = hc_rings_is_itemid_queued(itemid);
 
 	return ret;
 }
@@ -4908,19 +6744,25 @@ void	zbx_hc_get_items(zbx_vector_uint64_pair_t *items)
 {
 	zbx_hashset_iter_t	iter;
 	zbx_hc_item_t		*item;
+	int			i;
 
-	LOCK_CACHE;
+	for (i = 0; i < cache->shards_num; i++)
+	{
+		zbx_hc_shard_t	*shard = cache->shards[i];
 
-	zbx_vector_uint64_pair_reserve(items, cache->history_items.num_data);
+		LOCK_SHARD(shard);
 
-	zbx_hashset_iter_reset(&cache->history_items, &iter);
-	while (NULL != (item = (zbx_hc_item_t *)zbx_hashset_iter_next(&iter)))
-	{
-		zbx_uint64_pair_t	pair = {item->itemid, item->values_num};
-		zbx_vector_uint64_pair_append_ptr(items, &pair);
-	}
+		zbx_vector_uint64_pair_reserve(items, items->values_num + shard->history_items.num_data);
 
-	UNLOCK_CACHE;
+		zbx_hashset_iter_reset(&shard->history_items, &iter);
+		while (NULL != (item = (zbx_hc_item_t *)zbx_hashset_iter_next(&iter)))
+		{
+			zbx_uint64_pair_t	pair = {item->itemid, item->values_num};
+			zbx_vector_uint64_pair_append_ptr(items, &pair);
+		}
+
+		UNLOCK_SHARD(shard);
+	}
 }
 
 /******************************************************************************
@@ -5033,14 +6875,17 @@ static void	zbx_hc_proxyqueue_clear(void)
  ******************************************************************************/
 int	zbx_hc_check_proxy(zbx_uint64_t proxyid)
 {
-	double	hc_pused;
-	int	ret;
+	double		hc_pused;
+	int		ret;
+	ZBX_DC_STATS	stats;
+	zbx_uint64_t	history_free, history_total, index_free, index_total;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() proxyid:"ZBX_FS_UI64, __func__, proxyid);
 
-	LOCK_CACHE;
+	hc_get_stats(&stats, &history_free, &history_total, &index_free, &index_total);
+	hc_pused = 100 * (double)(history_total - history_free) / history_total;
 
-	hc_pused = 100 * (double)(hc_mem->total_size - hc_mem->free_size) / hc_mem->total_size;
+	LOCK_CACHE;
 
 	if (20 >= hc_pused)
 	{
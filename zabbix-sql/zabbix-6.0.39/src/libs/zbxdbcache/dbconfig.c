@@ -38,9 +38,20 @@
 
 int	sync_in_progress = 0;
 
-#define START_SYNC	WRLOCK_CACHE_CONFIG_HISTORY; WRLOCK_CACHE; sync_in_progress = 1
+/* time when configuration sync has write locked the cache, number of times the lock was yielded */
+/* and number of rows applied since the last lock time check                                    */
+static double	sync_lock_ts;
+static int	sync_yield_num, sync_yield_rows;
+
+#define START_SYNC	WRLOCK_CACHE_CONFIG_HISTORY; WRLOCK_CACHE; sync_in_progress = 1; sync_lock_ts = zbx_time()
 #define FINISH_SYNC	sync_in_progress = 0; UNLOCK_CACHE; UNLOCK_CACHE_CONFIG_HISTORY;
 
+/* The maximum time configuration sync can hold cache write lock before yielding it to */
+/* the waiting readers, and the number of rows applied between lock time checks.       */
+#define ZBX_DC_SYNC_LOCK_SLICE		0.1
+#define ZBX_DC_SYNC_YIELD_ROWS		1000
+#define ZBX_DC_SYNC_YIELD_SLEEP_NS	1000000
+
 #define ZBX_SNMP_OID_TYPE_NORMAL	0
 #define ZBX_SNMP_OID_TYPE_DYNAMIC	1
 #define ZBX_SNMP_OID_TYPE_MACRO		2
@@ -88,6 +99,7 @@ static zbx_mem_info_t	*config_mem;
 
 extern unsigned char	program_type;
 extern int		CONFIG_TIMER_FORKS;
+extern int		CONFIG_CACHE_SLAB_ALLOCATOR;
 
 ZBX_MEM_FUNC_IMPL(__config, config_mem)
 
@@ -235,11 +247,20 @@ static unsigned char	poller_by_item(unsigned char type, const char *key)
 			}
 			ZBX_FALLTHROUGH;
 		case ITEM_TYPE_ZABBIX:
+			if (ITEM_TYPE_ZABBIX == type && 0 != CONFIG_AGENTPOLLER_FORKS)
+				return ZBX_POLLER_TYPE_AGENT;
+			ZBX_FALLTHROUGH;
+		case ITEM_TYPE_HTTPAGENT:
+			if (ITEM_TYPE_HTTPAGENT == type && 0 != CONFIG_HTTPAGENT_POLLER_FORKS)
+				return ZBX_POLLER_TYPE_HTTPAGENT;
+			ZBX_FALLTHROUGH;
 		case ITEM_TYPE_SNMP:
+			if (ITEM_TYPE_SNMP == type && 0 != CONFIG_SNMPPOLLER_FORKS)
+				return ZBX_POLLER_TYPE_SNMP;
+			ZBX_FALLTHROUGH;
 		case ITEM_TYPE_EXTERNAL:
 		case ITEM_TYPE_SSH:
 		case ITEM_TYPE_TELNET:
-		case ITEM_TYPE_HTTPAGENT:
 		case ITEM_TYPE_SCRIPT:
 			if (0 == CONFIG_POLLER_FORKS)
 				break;
@@ -409,6 +430,50 @@ int	DCitem_nextcheck_update(ZBX_DC_ITEM *item, const ZBX_DC_INTERFACE *interface
 	return SUCCEED;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: check if asynchronous poller can process the item                 *
+ *                                                                            *
+ * Parameters: poller_type - [IN] the poller type                             *
+ *             dc_item     - [IN] the item                                    *
+ *             dc_host     - [IN] the item host                               *
+ *                                                                            *
+ * Return value: SUCCEED - the item can be processed by the poller            *
+ *               FAIL    - otherwise, the item must be processed by normal    *
+ *                         pollers                                            *
+ *                                                                            *
+ ******************************************************************************/
+static int	dc_poller_supports_item(unsigned char poller_type, const ZBX_DC_ITEM *dc_item,
+		const ZBX_DC_HOST *dc_host)
+{
+	const ZBX_DC_SNMPINTERFACE	*snmp;
+
+	switch (poller_type)
+	{
+		case ZBX_POLLER_TYPE_AGENT:
+			/* agent pollers support only unencrypted connections */
+			if (ZBX_TCP_SEC_UNENCRYPTED != dc_host->tls_connect)
+				return FAIL;
+			break;
+		case ZBX_POLLER_TYPE_SNMP:
+			/* SNMP pollers support only plain GET requests with SNMPv1/v2c */
+			if (0 != (ZBX_FLAG_DISCOVERY_RULE & dc_item->flags) ||
+					ZBX_SNMP_OID_TYPE_NORMAL != dc_item->itemtype.snmpitem->snmp_oid_type)
+			{
+				return FAIL;
+			}
+
+			if (NULL == (snmp = (const ZBX_DC_SNMPINTERFACE *)zbx_hashset_search(&config->interfaces_snmp,
+					&dc_item->interfaceid)) || ZBX_IF_SNMP_VERSION_3 == snmp->version)
+			{
+				return FAIL;
+			}
+			break;
+	}
+
+	return SUCCEED;
+}
+
 static void	DCitem_poller_type_update(ZBX_DC_ITEM *dc_item, const ZBX_DC_HOST *dc_host, int flags)
 {
 	unsigned char	poller_type;
@@ -421,6 +486,9 @@ static void	DCitem_poller_type_update(ZBX_DC_ITEM *dc_item, const ZBX_DC_HOST *d
 
 	poller_type = poller_by_item(dc_item->type, dc_item->key);
 
+	if (SUCCEED != dc_poller_supports_item(poller_type, dc_item, dc_host))
+		poller_type = (0 != CONFIG_POLLER_FORKS ? ZBX_POLLER_TYPE_NORMAL : ZBX_NO_POLLER);
+
 	if (0 != (flags & ZBX_HOST_UNREACHABLE))
 	{
 		if (ZBX_POLLER_TYPE_NORMAL == poller_type || ZBX_POLLER_TYPE_JAVA == poller_type)
@@ -900,6 +968,67 @@ clean:
 	zbx_free(path);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: checks if configuration sync should yield the write lock while    *
+ *          applying rows of a table                                          *
+ *                                                                            *
+ * Return value: SUCCEED - the lock has been held for too long                *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: The lock time is checked only every ZBX_DC_SYNC_YIELD_ROWS rows. *
+ *                                                                            *
+ ******************************************************************************/
+static int	dc_sync_yield_due(void)
+{
+	if (0 != ++sync_yield_rows % ZBX_DC_SYNC_YIELD_ROWS)
+		return FAIL;
+
+	if (0 == sync_in_progress || ZBX_DC_SYNC_LOCK_SLICE > zbx_time() - sync_lock_ts)
+		return FAIL;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: temporarily releases configuration cache write lock if it has     *
+ *          been held for too long during configuration sync                  *
+ *                                                                            *
+ * Comments: Called between tables whose cached objects and indexes do not    *
+ *           depend on the tables applied later in the same phase, and        *
+ *           between added or updated rows of items, functions and triggers   *
+ *           at the points where the objects referencing each other are       *
+ *           consistent:                                                      *
+ *             items     - dependent items applied so far are linked to       *
+ *                         their master items before yielding, new items      *
+ *                         are indexed and queued only at the end of pass;    *
+ *             functions - items of the applied functions have their trigger  *
+ *                         lists reset, the same as between the functions     *
+ *                         and triggers phases;                               *
+ *             triggers  - new triggers are not referenced by items until     *
+ *                         trigger links are updated at the end of phase.     *
+ *           Removed rows are applied without yielding, because other cached  *
+ *           objects (trigger dependencies) can still refer to them until the *
+ *           end of the pass.                                                 *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_sync_yield(void)
+{
+	struct timespec	ts = {0, ZBX_DC_SYNC_YIELD_SLEEP_NS};
+
+	if (0 == sync_in_progress || ZBX_DC_SYNC_LOCK_SLICE > zbx_time() - sync_lock_ts)
+		return;
+
+	FINISH_SYNC;
+
+	/* let the processes waiting for the lock to acquire it before locking again */
+	nanosleep(&ts, NULL);
+	sync_yield_num++;
+
+	START_SYNC;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: sets and validates global housekeeping option                     *
@@ -2618,6 +2747,30 @@ static void	DCsync_interfaces(zbx_dbsync_t *sync)
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: add item to interfaceid -> itemid index                           *
+ *                                                                            *
+ * Parameters: item - [IN] the item                                           *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_interface_snmpitems_add(ZBX_DC_ITEM *item)
+{
+	ZBX_DC_INTERFACE_ITEM	*ifitem;
+	int			found;
+
+	ifitem = (ZBX_DC_INTERFACE_ITEM *)DCfind_id(&config->interface_snmpitems, item->interfaceid,
+			sizeof(ZBX_DC_INTERFACE_ITEM), &found);
+
+	if (0 == found)
+	{
+		zbx_vector_uint64_create_ext(&ifitem->itemids, __config_mem_malloc_func, __config_mem_realloc_func,
+				__config_mem_free_func);
+	}
+
+	zbx_vector_uint64_append(&ifitem->itemids, item->itemid);
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: remove item from interfaceid -> itemid index                      *
@@ -3155,6 +3308,72 @@ static void	dc_item_value_type_update(int found, ZBX_DC_ITEM *item, zbx_item_val
 	}
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: adds item to the host and key index                               *
+ *                                                                            *
+ * Parameters: item   - [IN] the item                                         *
+ *             hostid - [IN] the item host identifier                         *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_item_hk_add(ZBX_DC_ITEM *item, zbx_uint64_t hostid)
+{
+	ZBX_DC_ITEM_HK	*item_hk, item_hk_local;
+
+	item_hk_local.hostid = hostid;
+	item_hk_local.key = item->key;
+	item_hk_local.item_ptr = NULL;
+
+	item_hk = (ZBX_DC_ITEM_HK *)zbx_hashset_insert(&config->items_hk, &item_hk_local, sizeof(ZBX_DC_ITEM_HK));
+
+	if (NULL == item_hk->item_ptr)
+		zbx_strpool_acquire(item->key);
+	item_hk->item_ptr = item;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: updates dependent item vectors within master items                *
+ *                                                                            *
+ * Parameters: dep_items - [IN/OUT] the dependent items with changed master   *
+ *                                  item, the vector is cleared               *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_masteritems_update(zbx_vector_ptr_t *dep_items)
+{
+	ZBX_DC_ITEM		*item;
+	ZBX_DC_MASTERITEM	*master;
+	int			i;
+
+	for (i = 0; i < dep_items->values_num; i++)
+	{
+		zbx_uint64_pair_t	pair;
+		ZBX_DC_DEPENDENTITEM	*depitem;
+
+		item = (ZBX_DC_ITEM *)dep_items->values[i];
+		depitem = item->itemtype.depitem;
+		dc_masteritem_remove_depitem(depitem->last_master_itemid, item->itemid);
+		pair.first = item->itemid;
+		pair.second = depitem->flags;
+
+		/* append item to dependent item vector of master item */
+		if (NULL == (master = (ZBX_DC_MASTERITEM *)zbx_hashset_search(&config->masteritems, &depitem->master_itemid)))
+		{
+			ZBX_DC_MASTERITEM	master_local;
+
+			master_local.itemid = depitem->master_itemid;
+			master = (ZBX_DC_MASTERITEM *)zbx_hashset_insert(&config->masteritems, &master_local, sizeof(master_local));
+
+			zbx_vector_uint64_pair_create_ext(&master->dep_itemids, __config_mem_malloc_func,
+					__config_mem_realloc_func, __config_mem_free_func);
+		}
+
+		zbx_vector_uint64_pair_append(&master->dep_itemids, pair);
+	}
+
+	zbx_vector_ptr_clear(dep_items);
+}
+
 static void	DCsync_items(zbx_dbsync_t *sync, int flags, zbx_vector_dc_item_ptr_t *new_items)
 {
 	char			**row;
@@ -3164,8 +3383,6 @@ static void	DCsync_items(zbx_dbsync_t *sync, int flags, zbx_vector_dc_item_ptr_t
 	ZBX_DC_HOST		*host = NULL;
 
 	ZBX_DC_ITEM		*item;
-	ZBX_DC_INTERFACE_ITEM	*interface_snmpitem;
-	ZBX_DC_MASTERITEM	*master;
 	ZBX_DC_PREPROCITEM	*preprocitem;
 	ZBX_DC_ITEM_HK		*item_hk, item_hk_local;
 	ZBX_DC_INTERFACE	*interface = NULL;
@@ -3173,13 +3390,14 @@ static void	DCsync_items(zbx_dbsync_t *sync, int flags, zbx_vector_dc_item_ptr_t
 	time_t			now;
 	zbx_hashset_uniq_t	uniq = ZBX_HASHSET_UNIQ_FALSE;
 	unsigned char		status, type, value_type, old_poller_type, item_flags;
-	int			found, ret, i, old_nextcheck;
+	int			found, item_found, ret, old_nextcheck, i;
 	zbx_uint64_t		itemid, hostid, interfaceid;
-	zbx_vector_ptr_t	dep_items;
+	zbx_vector_ptr_t	dep_items, added_items;
 	zbx_item_value_type_t	old_value_type;
 	zbx_item_type_t		old_type;
 
 	zbx_vector_ptr_create(&dep_items);
+	zbx_vector_ptr_create(&added_items);
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -3200,6 +3418,12 @@ static void	DCsync_items(zbx_dbsync_t *sync, int flags, zbx_vector_dc_item_ptr_t
 		if (ZBX_DBSYNC_ROW_REMOVE == tag)
 			break;
 
+		if (SUCCEED == dc_sync_yield_due())
+		{
+			dc_masteritems_update(&dep_items);
+			dc_sync_yield();
+		}
+
 		ZBX_STR2UINT64(itemid, row[0]);
 		ZBX_STR2UINT64(hostid, row[1]);
 		ZBX_STR2UCHAR(status, row[2]);
@@ -3221,6 +3445,7 @@ static void	DCsync_items(zbx_dbsync_t *sync, int flags, zbx_vector_dc_item_ptr_t
 		}
 
 		item = (ZBX_DC_ITEM *)DCfind_id_ext(&config->items, itemid, sizeof(ZBX_DC_ITEM), &found, uniq);
+		item_found = found;
 
 		/* template item */
 		ZBX_DBROW2UINT64(item->templateid, row[48]);
@@ -3254,16 +3479,9 @@ static void	DCsync_items(zbx_dbsync_t *sync, int flags, zbx_vector_dc_item_ptr_t
 			if (SUCCEED == DCstrpool_replace(found, &item->key, row[5]))
 				flags |= ZBX_ITEM_KEY_CHANGED;
 
-			item_hk_local.hostid = hostid;
-			item_hk_local.key = item->key;
-			item_hk_local.item_ptr = NULL;
-
-			item_hk = (ZBX_DC_ITEM_HK *)zbx_hashset_insert(&config->items_hk, &item_hk_local,
-					sizeof(ZBX_DC_ITEM_HK));
-
-			if (NULL == item_hk->item_ptr)
-				zbx_strpool_acquire(item->key);
-			item_hk->item_ptr = item;
+			/* new items are indexed at the end of pass, see below */
+			if (1 == found)
+				dc_item_hk_add(item, hostid);
 		}
 		else
 		{
@@ -3363,23 +3581,10 @@ static void	DCsync_items(zbx_dbsync_t *sync, int flags, zbx_vector_dc_item_ptr_t
 		if (SUCCEED == DCstrpool_replace(found, &item->delay, row[8]))
 			flags |= ZBX_ITEM_DELAY_CHANGED;
 
-		/* SNMP trap items for current server/proxy */
-
-		if (ITEM_TYPE_SNMPTRAP == item->type && 0 == host->proxy_hostid)
-		{
-			interface_snmpitem = (ZBX_DC_INTERFACE_ITEM *)DCfind_id(&config->interface_snmpitems,
-					item->interfaceid, sizeof(ZBX_DC_INTERFACE_ITEM), &found);
-
-			if (0 == found)
-			{
-				zbx_vector_uint64_create_ext(&interface_snmpitem->itemids,
-						__config_mem_malloc_func,
-						__config_mem_realloc_func,
-						__config_mem_free_func);
-			}
+		/* SNMP trap items for current server/proxy, new items are indexed at the end of pass */
 
-			zbx_vector_uint64_append(&interface_snmpitem->itemids, itemid);
-		}
+		if (ITEM_TYPE_SNMPTRAP == item->type && 0 == host->proxy_hostid && 1 == item_found)
+			dc_interface_snmpitems_add(item);
 
 		/* it is crucial to update type specific (config->snmpitems, config->ipmiitems, etc.) hashsets before */
 		/* attempting to requeue an item because type specific properties are used to arrange items in queues */
@@ -3421,37 +3626,14 @@ static void	DCsync_items(zbx_dbsync_t *sync, int flags, zbx_vector_dc_item_ptr_t
 			item->poller_type = ZBX_NO_POLLER;
 		}
 
-		DCupdate_item_queue(item, old_poller_type, old_nextcheck);
-	}
-
-	/* update dependent item vectors within master items */
-
-	for (i = 0; i < dep_items.values_num; i++)
-	{
-		zbx_uint64_pair_t	pair;
-		ZBX_DC_DEPENDENTITEM	*depitem;
-
-		item = (ZBX_DC_ITEM *)dep_items.values[i];
-		depitem = item->itemtype.depitem;
-		dc_masteritem_remove_depitem(depitem->last_master_itemid, item->itemid);
-		pair.first = item->itemid;
-		pair.second = depitem->flags;
-
-		/* append item to dependent item vector of master item */
-		if (NULL == (master = (ZBX_DC_MASTERITEM *)zbx_hashset_search(&config->masteritems, &depitem->master_itemid)))
-		{
-			ZBX_DC_MASTERITEM	master_local;
-
-			master_local.itemid = depitem->master_itemid;
-			master = (ZBX_DC_MASTERITEM *)zbx_hashset_insert(&config->masteritems, &master_local, sizeof(master_local));
-
-			zbx_vector_uint64_pair_create_ext(&master->dep_itemids, __config_mem_malloc_func,
-					__config_mem_realloc_func, __config_mem_free_func);
-		}
-
-		zbx_vector_uint64_pair_append(&master->dep_itemids, pair);
+		/* new items are queued at the end of pass, see below */
+		if (0 == item_found)
+			zbx_vector_ptr_append(&added_items, item);
+		else
+			DCupdate_item_queue(item, old_poller_type, old_nextcheck);
 	}
 
+	dc_masteritems_update(&dep_items);
 	zbx_vector_ptr_destroy(&dep_items);
 
 	/* remove deleted items from buffer */
@@ -3512,6 +3694,26 @@ static void	DCsync_items(zbx_dbsync_t *sync, int flags, zbx_vector_dc_item_ptr_t
 		zbx_hashset_remove_direct(&config->items, item);
 	}
 
+	/* The lock can be yielded while applying items. New items are indexed by key and queued only */
+	/* after all rows are applied, so trappers and pollers cannot process their values before the */
+	/* item preprocessing is synced in the same phase.                                            */
+	for (i = 0; i < added_items.values_num; i++)
+	{
+		item = (ZBX_DC_ITEM *)added_items.values[i];
+
+		dc_item_hk_add(item, item->hostid);
+
+		if (ITEM_TYPE_SNMPTRAP == item->type && NULL != (host = (ZBX_DC_HOST *)zbx_hashset_search(
+				&config->hosts, &item->hostid)) && 0 == host->proxy_hostid)
+		{
+			dc_interface_snmpitems_add(item);
+		}
+
+		DCupdate_item_queue(item, ZBX_NO_POLLER, 0);
+	}
+
+	zbx_vector_ptr_destroy(&added_items);
+
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
@@ -3663,6 +3865,9 @@ static void	DCsync_triggers(zbx_dbsync_t *sync)
 		if (ZBX_DBSYNC_ROW_REMOVE == tag)
 			break;
 
+		if (SUCCEED == dc_sync_yield_due())
+			dc_sync_yield();
+
 		ZBX_STR2UINT64(triggerid, row[0]);
 
 		trigger = (ZBX_DC_TRIGGER *)DCfind_id_ext(&config->triggers, triggerid, sizeof(ZBX_DC_TRIGGER),
@@ -4228,6 +4433,9 @@ static void	DCsync_functions(zbx_dbsync_t *sync)
 		if (ZBX_DBSYNC_ROW_REMOVE == tag)
 			break;
 
+		if (SUCCEED == dc_sync_yield_due())
+			dc_sync_yield();
+
 		ZBX_STR2UINT64(itemid, row[0]);
 		ZBX_STR2UINT64(functionid, row[1]);
 		ZBX_STR2UINT64(triggerid, row[4]);
@@ -6102,6 +6310,7 @@ void	DCsync_configuration(unsigned char mode)
 	double		autoreg_csec, autoreg_csec2;
 	zbx_dbsync_t	autoreg_config_sync;
 	zbx_uint64_t	update_flags = 0;
+	int		flush_changelog = FAIL;
 
 	zbx_hashset_t			trend_queue;
 	zbx_vector_dc_item_ptr_t	new_items, *pnew_items = NULL;
@@ -6109,9 +6318,13 @@ void	DCsync_configuration(unsigned char mode)
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
 	config->sync_start_ts = time(NULL);
+	sync_yield_num = 0;
 
 	zbx_dbsync_init_env(config);
 
+	if (FAIL == zbx_dbsync_env_prepare(mode))
+		zabbix_log(LOG_LEVEL_WARNING, "cannot read configuration changelog, performing full compare");
+
 	if (ZBX_DBSYNC_INIT == mode)
 	{
 		zbx_hashset_create(&trend_queue, 1000, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
@@ -6275,6 +6488,9 @@ void	DCsync_configuration(unsigned char mode)
 	DCsync_host_inventory(&hi_sync);
 	hisec2 = zbx_time() - sec;
 
+	/* hosts are applied, host groups and maintenances are updated and cached together after it */
+	dc_sync_yield();
+
 	sec = zbx_time();
 	DCsync_hostgroups(&hgroups_sync);
 	DCsync_hostgroup_hosts(&hgroup_host_sync);
@@ -6304,6 +6520,16 @@ void	DCsync_configuration(unsigned char mode)
 
 	FINISH_SYNC;
 
+	/* host, template and user macro changes can affect items, triggers and functions without */
+	/* changing their rows, so they cannot be compared by changelog only                      */
+	if (0 != hosts_sync.add_num + hosts_sync.update_num + hosts_sync.remove_num +
+			htmpl_sync.add_num + htmpl_sync.update_num + htmpl_sync.remove_num +
+			gmacro_sync.add_num + gmacro_sync.update_num + gmacro_sync.remove_num +
+			hmacro_sync.add_num + hmacro_sync.update_num + hmacro_sync.remove_num)
+	{
+		zbx_dbsync_env_force_full_compare();
+	}
+
 	/* sync item data to support item lookups when resolving macros during configuration sync */
 
 	sec = zbx_time();
@@ -6348,6 +6574,9 @@ void	DCsync_configuration(unsigned char mode)
 	DCsync_interfaces(&if_sync);
 	ifsec2 = zbx_time() - sec;
 
+	/* interfaces are applied, items relying on them are updated after it */
+	dc_sync_yield();
+
 	/* relies on hosts, proxies and interfaces, must be after DCsync_{hosts,interfaces}() */
 
 	sec = zbx_time();
@@ -6539,6 +6768,9 @@ void	DCsync_configuration(unsigned char mode)
 
 	update_sec = zbx_time() - sec;
 
+	/* configuration cache is in sync with database, processed changelog records can be removed */
+	flush_changelog = SUCCEED;
+
 	if (SUCCEED == ZBX_CHECK_LOG_LEVEL(LOG_LEVEL_DEBUG))
 	{
 		total = csec + hsec + hisec + htsec + gmsec + hmsec + ifsec + idsec + isec +  tisec + pisec + tsec + dsec + fsec + expr_sec +
@@ -6776,6 +7008,8 @@ void	DCsync_configuration(unsigned char mode)
 		zabbix_log(LOG_LEVEL_DEBUG, "%s() strings    : %d (%d slots)", __func__,
 				config->strpool.num_data, config->strpool.num_slots);
 
+		zabbix_log(LOG_LEVEL_DEBUG, "%s() lock yields: %d", __func__, sync_yield_num);
+
 		zbx_mem_dump_stats(LOG_LEVEL_DEBUG, config_mem);
 	}
 out:
@@ -6791,6 +7025,9 @@ out:
 
 	FINISH_SYNC;
 
+	if (SUCCEED == flush_changelog)
+		zbx_dbsync_env_flush_changelog();
+
 	zbx_dbsync_clear(&config_sync);
 	zbx_dbsync_clear(&autoreg_config_sync);
 	zbx_dbsync_clear(&hosts_sync);
@@ -7176,6 +7413,9 @@ int	init_configuration_cache(char **error)
 		goto out;
 	}
 
+	if (0 != CONFIG_CACHE_SLAB_ALLOCATOR)
+		zbx_mem_use_slabs(config_mem);
+
 	config = (ZBX_DC_CONFIG *)__config_mem_malloc_func(NULL, sizeof(ZBX_DC_CONFIG) +
 			CONFIG_TIMER_FORKS * sizeof(zbx_vector_ptr_t));
 
@@ -7275,6 +7515,9 @@ int	init_configuration_cache(char **error)
 						__config_mem_free_func);
 				break;
 		}
+
+		config->async_checks[i] = 0;
+		config->async_queued[i] = 0;
 	}
 
 	zbx_binary_heap_create_ext(&config->pqueue,
@@ -9361,25 +9604,18 @@ static void	dc_requeue_item_at(ZBX_DC_ITEM *dc_item, ZBX_DC_HOST *dc_host, int n
  * Purpose: Get array of items for selected poller                            *
  *                                                                            *
  * Parameters: poller_type - [IN] poller type (ZBX_POLLER_TYPE_...)           *
+ *             max_items   - [IN] the maximum number of items to get          *
  *             items       - [OUT] array of items                             *
  *                                                                            *
  * Return value: number of items in items array                               *
  *                                                                            *
- * Comments: Items leave the queue only through this function. Pollers must   *
- *           always return the items they have taken using DCrequeue_items()  *
- *           or DCpoller_requeue_items().                                     *
- *                                                                            *
- *           Currently batch polling is supported only for JMX, SNMP and      *
- *           icmpping* simple checks. In other cases only single item is      *
- *           retrieved.                                                       *
- *                                                                            *
- *           IPMI poller queue are handled by DCconfig_get_ipmi_poller_items()*
- *           function.                                                        *
+ * Comments: If more than one item can be returned the items array is         *
+ *           allocated by this function and must be freed by the caller.      *
  *                                                                            *
  ******************************************************************************/
-int	DCconfig_get_poller_items(unsigned char poller_type, DC_ITEM **items)
+static int	dc_config_get_poller_items(unsigned char poller_type, int max_items, DC_ITEM **items)
 {
-	int			now, num = 0, max_items;
+	int			now, num = 0;
 	zbx_binary_heap_t	*queue;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() poller_type:%d", __func__, (int)poller_type);
@@ -9388,18 +9624,6 @@ int	DCconfig_get_poller_items(unsigned char poller_type, DC_ITEM **items)
 
 	queue = &config->queues[poller_type];
 
-	switch (poller_type)
-	{
-		case ZBX_POLLER_TYPE_JAVA:
-			max_items = MAX_JAVA_ITEMS;
-			break;
-		case ZBX_POLLER_TYPE_PINGER:
-			max_items = MAX_PINGER_ITEMS;
-			break;
-		default:
-			max_items = 1;
-	}
-
 	WRLOCK_CACHE;
 
 	while (num < max_items && FAIL == zbx_binary_heap_empty(queue))
@@ -9442,6 +9666,14 @@ int	DCconfig_get_poller_items(unsigned char poller_type, DC_ITEM **items)
 		if (HOST_STATUS_MONITORED != dc_host->status)
 			continue;
 
+		if (SUCCEED != dc_poller_supports_item(poller_type, dc_item, dc_host))
+		{
+			/* host connection or item settings were changed after the item was queued */
+			DCitem_poller_type_update(dc_item, dc_host, ZBX_ITEM_COLLECTED);
+			DCupdate_item_queue(dc_item, poller_type, dc_item->nextcheck);
+			continue;
+		}
+
 		if (SUCCEED == DCin_maintenance_without_data_collection(dc_host, dc_item))
 		{
 			dc_requeue_item(dc_item, dc_host, dc_interface, ZBX_ITEM_COLLECTED, now);
@@ -9512,6 +9744,106 @@ int	DCconfig_get_poller_items(unsigned char poller_type, DC_ITEM **items)
 	return num;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: Get array of items for selected poller                            *
+ *                                                                            *
+ * Parameters: poller_type - [IN] poller type (ZBX_POLLER_TYPE_...)           *
+ *             items       - [OUT] array of items                             *
+ *                                                                            *
+ * Return value: number of items in items array                               *
+ *                                                                            *
+ * Comments: Items leave the queue only through this function. Pollers must   *
+ *           always return the items they have taken using DCrequeue_items()  *
+ *           or DCpoller_requeue_items().                                     *
+ *                                                                            *
+ *           Currently batch polling is supported only for JMX, SNMP and      *
+ *           icmpping* simple checks. In other cases only single item is      *
+ *           retrieved.                                                       *
+ *                                                                            *
+ *           IPMI poller queue are handled by DCconfig_get_ipmi_poller_items()*
+ *           function.                                                        *
+ *                                                                            *
+ ******************************************************************************/
+int	DCconfig_get_poller_items(unsigned char poller_type, DC_ITEM **items)
+{
+	int	max_items;
+
+	switch (poller_type)
+	{
+		case ZBX_POLLER_TYPE_JAVA:
+			max_items = MAX_JAVA_ITEMS;
+			break;
+		case ZBX_POLLER_TYPE_PINGER:
+			max_items = MAX_PINGER_ITEMS;
+			break;
+		default:
+			max_items = 1;
+	}
+
+	return dc_config_get_poller_items(poller_type, max_items, items);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: Get array of items for asynchronous poller                        *
+ *                                                                            *
+ * Parameters: poller_type - [IN] poller type (ZBX_POLLER_TYPE_...)           *
+ *             max_items   - [IN] the number of checks the poller can start   *
+ *             items       - [OUT] array of items                             *
+ *                                                                            *
+ * Return value: number of items in items array                               *
+ *                                                                            *
+ * Comments: Asynchronous pollers take items of different hosts in one batch, *
+ *           the items must be returned with DCpoller_requeue_items() after   *
+ *           their checks are finished.                                       *
+ *                                                                            *
+ ******************************************************************************/
+int	DCconfig_get_async_poller_items(unsigned char poller_type, int max_items, DC_ITEM **items)
+{
+	return dc_config_get_poller_items(poller_type, MIN(max_items, MAX_POLLER_ITEMS), items);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: update the number of checks in progress in asynchronous pollers   *
+ *                                                                            *
+ * Parameters: poller_type  - [IN] poller type (ZBX_POLLER_TYPE_...)          *
+ *             checks_delta - [IN] the change of checks in progress           *
+ *             queued_delta - [IN] the change of checks waiting for           *
+ *                                 connection                                 *
+ *                                                                            *
+ ******************************************************************************/
+void	DCupdate_async_poller_stats(unsigned char poller_type, int checks_delta, int queued_delta)
+{
+	WRLOCK_CACHE;
+
+	config->async_checks[poller_type] += checks_delta;
+	config->async_queued[poller_type] += queued_delta;
+
+	UNLOCK_CACHE;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get the number of checks in progress in asynchronous pollers      *
+ *                                                                            *
+ * Parameters: poller_type - [IN] poller type (ZBX_POLLER_TYPE_...)           *
+ *             checks      - [OUT] the number of checks in progress           *
+ *             queued      - [OUT] the number of checks waiting for           *
+ *                                 connection                                 *
+ *                                                                            *
+ ******************************************************************************/
+void	DCget_async_poller_stats(unsigned char poller_type, int *checks, int *queued)
+{
+	RDLOCK_CACHE;
+
+	*checks = config->async_checks[poller_type];
+	*queued = config->async_queued[poller_type];
+
+	UNLOCK_CACHE;
+}
+
 #ifdef HAVE_OPENIPMI
 /******************************************************************************
  *                                                                            *
@@ -891,6 +891,11 @@ typedef struct
 #endif
 	zbx_hashset_t		data_sessions;
 	zbx_binary_heap_t	queues[ZBX_POLLER_TYPE_COUNT];
+
+	/* the number of checks in progress and waiting for connection in asynchronous pollers */
+	int			async_checks[ZBX_POLLER_TYPE_COUNT];
+	int			async_queued[ZBX_POLLER_TYPE_COUNT];
+
 	zbx_binary_heap_t	pqueue;
 	zbx_binary_heap_t	trigger_queue;
 	ZBX_DC_CONFIG_TABLE	*config;
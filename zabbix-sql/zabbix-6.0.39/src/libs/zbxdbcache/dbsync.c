@@ -25,15 +25,49 @@
 #include "base64.h"
 #include "zbxeval.h"
 
+/* changelog object types, must match the values written by database triggers */
+#define ZBX_DBSYNC_OBJ_ITEM		1
+#define ZBX_DBSYNC_OBJ_TRIGGER		2
+#define ZBX_DBSYNC_OBJ_FUNCTION		3
+#define ZBX_DBSYNC_OBJ_COUNT		3
+
+#define ZBX_DBSYNC_OBJ_FLAG(object)	(1 << (object))
+#define ZBX_DBSYNC_OBJ_FLAG_ALL		(ZBX_DBSYNC_OBJ_FLAG(ZBX_DBSYNC_OBJ_ITEM) |		\
+					ZBX_DBSYNC_OBJ_FLAG(ZBX_DBSYNC_OBJ_TRIGGER) |		\
+					ZBX_DBSYNC_OBJ_FLAG(ZBX_DBSYNC_OBJ_FUNCTION))
+
+/* changelog operations */
+#define ZBX_DBSYNC_OPERATION_ADD	1
+#define ZBX_DBSYNC_OPERATION_UPDATE	2
+#define ZBX_DBSYNC_OPERATION_DELETE	3
+
 typedef struct
 {
-	zbx_hashset_t	strpool;
-	ZBX_DC_CONFIG	*cache;
+	zbx_hashset_t		strpool;
+	ZBX_DC_CONFIG		*cache;
+
+	/* the changelog records read during this synchronization */
+	zbx_vector_uint64_t	changelogids;
+
+	/* the identifiers of changed objects, indexed by changelog object type - 1 */
+	zbx_vector_uint64_t	changes[ZBX_DBSYNC_OBJ_COUNT];
+
+	/* the objects that must be compared with full table (ZBX_DBSYNC_OBJ_FLAG() flags) */
+	int			full_compare;
 }
 zbx_dbsync_env_t;
 
 static zbx_dbsync_env_t	dbsync_env;
 
+/* the changelog availability is checked until the table is found */
+static int	changelog_available = FAIL;
+
+/* the changelog triggers are checked until all of them are found */
+static int	changelog_triggers_available = FAIL;
+
+/* the time of the last full compare of objects tracked by changelog */
+static time_t	changelog_full_ts;
+
 /* string pool support */
 
 #define REFCOUNT_FIELD_SIZE	sizeof(zbx_uint32_t)
@@ -245,15 +279,237 @@ static char	**dbsync_preproc_row(zbx_dbsync_t *sync, char **row)
 
 void	zbx_dbsync_init_env(ZBX_DC_CONFIG *cache)
 {
+	int	i;
+
 	dbsync_env.cache = cache;
 	zbx_hashset_create(&dbsync_env.strpool, 100, dbsync_strpool_hash_func, dbsync_strpool_compare_func);
+
+	zbx_vector_uint64_create(&dbsync_env.changelogids);
+
+	for (i = 0; i < ZBX_DBSYNC_OBJ_COUNT; i++)
+		zbx_vector_uint64_create(&dbsync_env.changes[i]);
+
+	dbsync_env.full_compare = ZBX_DBSYNC_OBJ_FLAG_ALL;
 }
 
 void	zbx_dbsync_free_env(void)
 {
+	int	i;
+
+	for (i = 0; i < ZBX_DBSYNC_OBJ_COUNT; i++)
+		zbx_vector_uint64_destroy(&dbsync_env.changes[i]);
+
+	zbx_vector_uint64_destroy(&dbsync_env.changelogids);
+
 	zbx_hashset_destroy(&dbsync_env.strpool);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: checks if all changelog triggers exist                            *
+ *                                                                            *
+ * Return value: SUCCEED - the changelog records all changes                  *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: The triggers are created by schema extension patches, which are  *
+ *           skipped with a warning when database user is not allowed to      *
+ *           create triggers. Without any of the triggers the changes would   *
+ *           be missed, so full compare is used instead.                      *
+ *                                                                            *
+ ******************************************************************************/
+static int	dbsync_changelog_triggers_exist(void)
+{
+	const char	*tables[] = {"items", "triggers", "functions"};
+	const char	*operations[] = {"insert", "update", "delete"};
+	char		name[ZBX_TABLENAME_LEN_MAX];
+	size_t		i, j;
+
+	for (i = 0; i < ARRSIZE(tables); i++)
+	{
+		for (j = 0; j < ARRSIZE(operations); j++)
+		{
+			zbx_snprintf(name, sizeof(name), "%s_%s", tables[i], operations[j]);
+
+			if (SUCCEED != DBtrigger_exists(tables[i], name))
+				return FAIL;
+		}
+	}
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: reads configuration changes recorded by database triggers         *
+ *                                                                            *
+ * Parameters: mode - [IN] the synchronization mode (see ZBX_DBSYNC_* defines)*
+ *                                                                            *
+ * Return value: SUCCEED - the changelog was read or is not available         *
+ *               FAIL    - database error                                     *
+ *                                                                            *
+ * Comments: Items, triggers and functions are compared only by the changed   *
+ *           rows unless full compare is required. Full compare is done       *
+ *           during initial synchronization, every CacheFullUpdateFrequency   *
+ *           seconds and when rows were deleted - cascaded deletes do not     *
+ *           fire triggers on all databases.                                  *
+ *           The changelog is read also in initial synchronization mode so    *
+ *           the records can be flushed after the full load.                  *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_dbsync_env_prepare(unsigned char mode)
+{
+	DB_RESULT	result;
+	DB_ROW		row;
+	int		i, object, full_compare = 0;
+	zbx_uint64_t	changelogid, objectid;
+
+	if (SUCCEED != changelog_available && SUCCEED != (changelog_available = DBtable_exists("changelog")))
+		return SUCCEED;
+
+	/* the records of incomplete trigger set are only flushed */
+	if (SUCCEED != changelog_triggers_available)
+		changelog_triggers_available = dbsync_changelog_triggers_exist();
+
+	if (NULL == (result = DBselect("select changelogid,object,objectid,operation from changelog")))
+		return FAIL;
+
+	while (NULL != (row = DBfetch(result)))
+	{
+		ZBX_STR2UINT64(changelogid, row[0]);
+		zbx_vector_uint64_append(&dbsync_env.changelogids, changelogid);
+
+		object = atoi(row[1]);
+
+		if (ZBX_DBSYNC_OBJ_ITEM > object || ZBX_DBSYNC_OBJ_COUNT < object)
+			continue;
+
+		ZBX_STR2UINT64(objectid, row[2]);
+		zbx_vector_uint64_append(&dbsync_env.changes[object - 1], objectid);
+
+		if (ZBX_DBSYNC_OPERATION_DELETE == atoi(row[3]))
+		{
+			full_compare |= ZBX_DBSYNC_OBJ_FLAG(object);
+
+			/* functions are removed together with their items and triggers */
+			full_compare |= ZBX_DBSYNC_OBJ_FLAG(ZBX_DBSYNC_OBJ_FUNCTION);
+		}
+	}
+	DBfree_result(result);
+
+	for (i = 0; i < ZBX_DBSYNC_OBJ_COUNT; i++)
+	{
+		zbx_vector_uint64_sort(&dbsync_env.changes[i], ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+		zbx_vector_uint64_uniq(&dbsync_env.changes[i], ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	}
+
+	if (ZBX_DBSYNC_UPDATE == mode && SUCCEED == changelog_triggers_available &&
+			0 != CONFIG_CACHE_FULL_UPDATE_FREQUENCY &&
+			time(NULL) - changelog_full_ts < CONFIG_CACHE_FULL_UPDATE_FREQUENCY)
+	{
+		dbsync_env.full_compare = full_compare;
+	}
+
+	zabbix_log(LOG_LEVEL_DEBUG, "%s() changelog:%d items:%d triggers:%d functions:%d full:0x%x", __func__,
+			dbsync_env.changelogids.values_num, dbsync_env.changes[ZBX_DBSYNC_OBJ_ITEM - 1].values_num,
+			dbsync_env.changes[ZBX_DBSYNC_OBJ_TRIGGER - 1].values_num,
+			dbsync_env.changes[ZBX_DBSYNC_OBJ_FUNCTION - 1].values_num, dbsync_env.full_compare);
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: forces full compare of objects tracked by changelog               *
+ *                                                                            *
+ * Comments: Used when changes in other tables (hosts, templates, user        *
+ *           macros) can affect the cached objects without changing their     *
+ *           rows.                                                            *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_dbsync_env_force_full_compare(void)
+{
+	dbsync_env.full_compare = ZBX_DBSYNC_OBJ_FLAG_ALL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: removes the processed changelog records                           *
+ *                                                                            *
+ * Comments: Must be called only after the configuration cache was            *
+ *           successfully synchronized. The records are removed by their      *
+ *           identifiers, so changes committed after the changelog was read   *
+ *           are kept for the next synchronization.                           *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_dbsync_env_flush_changelog(void)
+{
+	if (ZBX_DBSYNC_OBJ_FLAG_ALL == dbsync_env.full_compare)
+		changelog_full_ts = time(NULL);
+
+	if (0 == dbsync_env.changelogids.values_num)
+		return;
+
+	zbx_vector_uint64_sort(&dbsync_env.changelogids, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+
+	if (SUCCEED != DBexecute_multiple_query("delete from changelog where", "changelogid",
+			&dbsync_env.changelogids))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot remove processed configuration changelog records");
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets the changed object identifiers for incremental compare       *
+ *                                                                            *
+ * Parameters: object      - [IN] the changelog object type                   *
+ *             objects_num - [IN] the number of cached objects                *
+ *                                                                            *
+ * Return value: the sorted changed object identifiers or NULL if the full    *
+ *               table must be compared                                       *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_vector_uint64_t	*dbsync_env_get_changes(int object, int objects_num)
+{
+	zbx_vector_uint64_t	*changes;
+
+	if (0 != (dbsync_env.full_compare & ZBX_DBSYNC_OBJ_FLAG(object)))
+		return NULL;
+
+	changes = &dbsync_env.changes[object - 1];
+
+	/* selecting large part of the table by identifiers is slower than full select */
+	if (changes->values_num > objects_num / 4)
+		return NULL;
+
+	return changes;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: adds removal rows for changed objects that were not selected      *
+ *                                                                            *
+ * Parameters: sync    - [OUT] the changeset                                  *
+ *             changes - [IN] the changed object identifiers                  *
+ *             ids     - [IN] the identifiers of selected rows                *
+ *             objects - [IN] the cached objects                              *
+ *                                                                            *
+ ******************************************************************************/
+static void	dbsync_remove_changed_rows(zbx_dbsync_t *sync, const zbx_vector_uint64_t *changes,
+		zbx_hashset_t *ids, zbx_hashset_t *objects)
+{
+	int	i;
+
+	for (i = 0; i < changes->values_num; i++)
+	{
+		if (NULL != zbx_hashset_search(ids, &changes->values[i]))
+			continue;
+
+		if (NULL != zbx_hashset_search(objects, &changes->values[i]))
+			dbsync_add_row(sync, changes->values[i], ZBX_DBSYNC_ROW_REMOVE, NULL);
+	}
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: initializes changeset                                             *
@@ -1816,6 +2072,14 @@ int	zbx_dbsync_compare_items(zbx_dbsync_t *sync)
 	char			**row;
 	char			*sql = NULL;
 	size_t			sql_alloc = 0, sql_offset = 0;
+	zbx_vector_uint64_t	*changes = NULL;
+
+	if (ZBX_DBSYNC_INIT != sync->mode && NULL != (changes = dbsync_env_get_changes(ZBX_DBSYNC_OBJ_ITEM,
+			dbsync_env.cache->items.num_data)) && 0 == changes->values_num)
+	{
+		dbsync_prepare(sync, 50, dbsync_item_preproc_row);
+		return SUCCEED;
+	}
 
 	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
 			"select i.itemid,i.hostid,i.status,i.type,i.value_type,i.key_,i.snmp_oid,i.ipmi_sensor,i.delay,"
@@ -1836,6 +2100,13 @@ int	zbx_dbsync_compare_items(zbx_dbsync_t *sync)
 			" where (h.status=%d or h.status=%d) and (i.flags=%d or i.flags=%d or i.flags=%d)",
 			HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED, ZBX_FLAG_DISCOVERY_NORMAL,
 			ZBX_FLAG_DISCOVERY_RULE, ZBX_FLAG_DISCOVERY_CREATED);
+
+		if (NULL != changes)
+		{
+			zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, " and");
+			DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "i.itemid", changes->values,
+					changes->values_num);
+		}
 	}
 
 	result = DBselect("%s", sql);
@@ -1852,8 +2123,8 @@ int	zbx_dbsync_compare_items(zbx_dbsync_t *sync)
 		return SUCCEED;
 	}
 
-	zbx_hashset_create(&ids, dbsync_env.cache->items.num_data, ZBX_DEFAULT_UINT64_HASH_FUNC,
-			ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	zbx_hashset_create(&ids, NULL == changes ? dbsync_env.cache->items.num_data : changes->values_num,
+			ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
 
 	while (NULL != (dbrow = DBfetch(result)))
 	{
@@ -1873,11 +2144,18 @@ int	zbx_dbsync_compare_items(zbx_dbsync_t *sync)
 			dbsync_add_row(sync, rowid, tag, row);
 	}
 
-	zbx_hashset_iter_reset(&dbsync_env.cache->items, &iter);
-	while (NULL != (item = (ZBX_DC_ITEM *)zbx_hashset_iter_next(&iter)))
+	if (NULL != changes)
 	{
-		if (NULL == zbx_hashset_search(&ids, &item->itemid))
-			dbsync_add_row(sync, item->itemid, ZBX_DBSYNC_ROW_REMOVE, NULL);
+		dbsync_remove_changed_rows(sync, changes, &ids, &dbsync_env.cache->items);
+	}
+	else
+	{
+		zbx_hashset_iter_reset(&dbsync_env.cache->items, &iter);
+		while (NULL != (item = (ZBX_DC_ITEM *)zbx_hashset_iter_next(&iter)))
+		{
+			if (NULL == zbx_hashset_search(&ids, &item->itemid))
+				dbsync_add_row(sync, item->itemid, ZBX_DBSYNC_ROW_REMOVE, NULL);
+		}
 	}
 
 	zbx_hashset_destroy(&ids);
@@ -2311,16 +2589,36 @@ int	zbx_dbsync_compare_triggers(zbx_dbsync_t *sync)
 	zbx_uint64_t		rowid;
 	ZBX_DC_TRIGGER		*trigger;
 	char			**row;
+	char			*sql = NULL;
+	size_t			sql_alloc = 0, sql_offset = 0;
+	zbx_vector_uint64_t	*changes = NULL;
 
-	if (NULL == (result = DBselect(
+	if (ZBX_DBSYNC_INIT != sync->mode && NULL != (changes = dbsync_env_get_changes(ZBX_DBSYNC_OBJ_TRIGGER,
+			dbsync_env.cache->triggers.num_data)) && 0 == changes->values_num)
+	{
+		dbsync_prepare(sync, 20, dbsync_trigger_preproc_row);
+		return SUCCEED;
+	}
+
+	zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset,
 			"select triggerid,description,expression,error,priority,type,value,state,lastchange,status,"
 			"recovery_mode,recovery_expression,correlation_mode,correlation_tag,opdata,event_name,null,"
 			"null,null,flags"
-			" from triggers")))
+			" from triggers");
+
+	if (NULL != changes)
 	{
-		return FAIL;
+		zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, " where");
+		DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "triggerid", changes->values,
+				changes->values_num);
 	}
 
+	result = DBselect("%s", sql);
+	zbx_free(sql);
+
+	if (NULL == result)
+		return FAIL;
+
 	dbsync_prepare(sync, 20, dbsync_trigger_preproc_row);
 
 	if (ZBX_DBSYNC_INIT == sync->mode)
@@ -2329,8 +2627,8 @@ int	zbx_dbsync_compare_triggers(zbx_dbsync_t *sync)
 		return SUCCEED;
 	}
 
-	zbx_hashset_create(&ids, dbsync_env.cache->triggers.num_data, ZBX_DEFAULT_UINT64_HASH_FUNC,
-			ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	zbx_hashset_create(&ids, NULL == changes ? dbsync_env.cache->triggers.num_data : changes->values_num,
+			ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
 
 	while (NULL != (dbrow = DBfetch(result)))
 	{
@@ -2350,11 +2648,18 @@ int	zbx_dbsync_compare_triggers(zbx_dbsync_t *sync)
 		}
 	}
 
-	zbx_hashset_iter_reset(&dbsync_env.cache->triggers, &iter);
-	while (NULL != (trigger = (ZBX_DC_TRIGGER *)zbx_hashset_iter_next(&iter)))
+	if (NULL != changes)
+	{
+		dbsync_remove_changed_rows(sync, changes, &ids, &dbsync_env.cache->triggers);
+	}
+	else
 	{
-		if (NULL == zbx_hashset_search(&ids, &trigger->triggerid))
-			dbsync_add_row(sync, trigger->triggerid, ZBX_DBSYNC_ROW_REMOVE, NULL);
+		zbx_hashset_iter_reset(&dbsync_env.cache->triggers, &iter);
+		while (NULL != (trigger = (ZBX_DC_TRIGGER *)zbx_hashset_iter_next(&iter)))
+		{
+			if (NULL == zbx_hashset_search(&ids, &trigger->triggerid))
+				dbsync_add_row(sync, trigger->triggerid, ZBX_DBSYNC_ROW_REMOVE, NULL);
+		}
 	}
 
 	zbx_hashset_destroy(&ids);
@@ -2523,8 +2828,31 @@ int	zbx_dbsync_compare_functions(zbx_dbsync_t *sync)
 	zbx_uint64_t		rowid, itemid;
 	ZBX_DC_FUNCTION		*function;
 	char			**row;
+	char			*sql = NULL;
+	size_t			sql_alloc = 0, sql_offset = 0;
+	zbx_vector_uint64_t	*changes = NULL;
+
+	if (ZBX_DBSYNC_INIT != sync->mode && NULL != (changes = dbsync_env_get_changes(ZBX_DBSYNC_OBJ_FUNCTION,
+			dbsync_env.cache->functions.num_data)) && 0 == changes->values_num)
+	{
+		dbsync_prepare(sync, 5, dbsync_function_preproc_row);
+		return SUCCEED;
+	}
+
+	zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset,
+			"select itemid,functionid,name,parameter,triggerid from functions");
+
+	if (NULL != changes)
+	{
+		zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, " where");
+		DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "functionid", changes->values,
+				changes->values_num);
+	}
+
+	result = DBselect("%s", sql);
+	zbx_free(sql);
 
-	if (NULL == (result = DBselect("select itemid,functionid,name,parameter,triggerid from functions")))
+	if (NULL == result)
 		return FAIL;
 
 	dbsync_prepare(sync, 5, dbsync_function_preproc_row);
@@ -2535,8 +2863,8 @@ int	zbx_dbsync_compare_functions(zbx_dbsync_t *sync)
 		return SUCCEED;
 	}
 
-	zbx_hashset_create(&ids, dbsync_env.cache->functions.num_data, ZBX_DEFAULT_UINT64_HASH_FUNC,
-			ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	zbx_hashset_create(&ids, NULL == changes ? dbsync_env.cache->functions.num_data : changes->values_num,
+			ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
 
 	while (NULL != (dbrow = DBfetch(result)))
 	{
@@ -2560,11 +2888,18 @@ int	zbx_dbsync_compare_functions(zbx_dbsync_t *sync)
 			dbsync_add_row(sync, rowid, tag, row);
 	}
 
-	zbx_hashset_iter_reset(&dbsync_env.cache->functions, &iter);
-	while (NULL != (function = (ZBX_DC_FUNCTION *)zbx_hashset_iter_next(&iter)))
+	if (NULL != changes)
 	{
-		if (NULL == zbx_hashset_search(&ids, &function->functionid))
-			dbsync_add_row(sync, function->functionid, ZBX_DBSYNC_ROW_REMOVE, NULL);
+		dbsync_remove_changed_rows(sync, changes, &ids, &dbsync_env.cache->functions);
+	}
+	else
+	{
+		zbx_hashset_iter_reset(&dbsync_env.cache->functions, &iter);
+		while (NULL != (function = (ZBX_DC_FUNCTION *)zbx_hashset_iter_next(&iter)))
+		{
+			if (NULL == zbx_hashset_search(&ids, &function->functionid))
+				dbsync_add_row(sync, function->functionid, ZBX_DBSYNC_ROW_REMOVE, NULL);
+		}
 	}
 
 	zbx_hashset_destroy(&ids);
@@ -109,6 +109,9 @@ struct zbx_dbsync
 
 void	zbx_dbsync_init_env(ZBX_DC_CONFIG *cache);
 void	zbx_dbsync_free_env(void);
+int	zbx_dbsync_env_prepare(unsigned char mode);
+void	zbx_dbsync_env_force_full_compare(void);
+void	zbx_dbsync_env_flush_changelog(void);
 
 void	zbx_dbsync_init(zbx_dbsync_t *sync, unsigned char mode);
 void	zbx_dbsync_clear(zbx_dbsync_t *sync);
@@ -23,6 +23,9 @@
 #include "dbcache.h"
 #include "vectorimpl.h"
 #include "mutexs.h"
+#include "vcaggr.h"
+#include "zbxatomic.h"
+#include "version.h"
 
 /*
  * The cache (zbx_vc_cache_t) is organized as a hashset of item records (zbx_vc_item_t).
@@ -48,6 +51,26 @@
  *
  * The low memory mode can't be turned off - it will persist until server is rebooted.
  * In low memory mode a warning message is written into log every 5 minutes.
+ *
+ * When ValueCacheCompression is enabled the full chunks of float and unsigned items are
+ * compressed once a newer (or older, when caching values from database) chunk is added.
+ * The timestamp seconds and unsigned values are stored as delta-of-delta, floating values
+ * as XOR with the previous value. Compressed chunks are decoded into process local buffers
+ * when accessed and are inflated back before the values are moved by out of order values.
+ * Chunks referenced by value cursors are not compressed.
+ *
+ * Locking:
+ *   1) the cache read-write lock (vc_lock) is locked in write mode only when items are
+ *      added to or removed from cache, when space is released and when item values are
+ *      read from database into cache.
+ *   2) item values are read and added at head while holding the cache lock in read mode
+ *      and the item stripe lock (vc_item_locks[itemid % ZBX_VC_ITEM_LOCKS_NUM]), so
+ *      history syncers and readers working with different items do not block each other.
+ *   3) while the cache is locked in read mode the shared memory allocator and the string
+ *      pool are protected by the memory lock (vc_mem_lock). Space is not released in read
+ *      mode - failing to allocate memory marks item for removal under write lock.
+ * The locks must be acquired in the listed order and a process holds at most one item
+ * stripe lock at a time.
  */
 
 /* the period of low memory warning messages */
@@ -62,16 +85,38 @@ static zbx_mem_info_t	*vc_mem = NULL;
 
 zbx_rwlock_t	vc_lock = ZBX_RWLOCK_NULL;
 
+/* protects shared memory allocator and string pool while cache is locked in read mode */
+static zbx_mutex_t	vc_mem_lock = ZBX_MUTEX_NULL;
+
+/* item lock stripes, protecting item data while cache is locked in read mode */
+static zbx_mutex_t	vc_item_locks[ZBX_VC_ITEM_LOCKS_NUM];
+
+/* the cache is locked in read mode by this process */
+static int	vc_lock_shared = 0;
+
+/* the item lock stripe held by this process or -1 */
+static int	vc_item_lock_index = -1;
+
 /* value cache enable/disable flags */
 #define ZBX_VC_DISABLED		0
 #define ZBX_VC_ENABLED		1
 
+/* the item is referenced by value cursors and will be removed when the last cursor is closed */
+#define ZBX_ITEM_STATE_REMOVE_PENDING	1
+
 /* value cache state, after initialization value cache is always disabled */
 static int	vc_state = ZBX_VC_DISABLED;
 
 /* the value cache size */
 extern zbx_uint64_t	CONFIG_VALUE_CACHE_SIZE;
 
+/* the value cache dump file and the maximum age of values restored from it */
+extern char	*CONFIG_VALUE_CACHE_DUMP_FILE;
+extern int	CONFIG_VALUE_CACHE_DUMP_MAX_AGE;
+
+/* compress the full chunks of numeric items */
+extern int	CONFIG_VALUE_CACHE_COMPRESSION;
+
 ZBX_MEM_FUNC_IMPL(__vc, vc_mem)
 
 #define VC_STRPOOL_INIT_SIZE	(1000)
@@ -86,7 +131,14 @@ ZBX_MEM_FUNC_IMPL(__vc, vc_mem)
 
 #define ZBX_VC_ITEM_EXPIRE_PERIOD	SEC_PER_DAY
 
-/* the data chunk used to store data fragment */
+/* The data chunk used to store data fragment.                                */
+/* Timestamps and values are stored in separate arrays (allocated together    */
+/* with the chunk) - timestamp lookups touch only the timestamp array and     */
+/* float/uint64 values form plain double/zbx_uint64_t arrays that can be      */
+/* processed without walking history records.                                 */
+/* Compressed chunks have no arrays, the encoded timestamps and values follow */
+/* the chunk header instead (see vch_chunk_get_data()). The head chunk is     */
+/* never compressed.                                                          */
 typedef struct zbx_vc_chunk
 {
 	/* a pointer to the previous chunk or NULL if this is the tail chunk */
@@ -104,8 +156,14 @@ typedef struct zbx_vc_chunk
 	/* the number of item value slots in chunk */
 	int			slots_num;
 
-	/* the item value data */
-	zbx_history_record_t	slots[1];
+	/* the item value timestamps, slots_num elements */
+	zbx_timespec_t		*timestamps;
+
+	/* the item values, slots_num elements */
+	history_value_t		*values;
+
+	/* the size of encoded timestamps and values, 0 if the chunk is not compressed */
+	int			data_size;
 }
 zbx_vc_chunk_t;
 
@@ -113,9 +171,10 @@ zbx_vc_chunk_t;
 
 #define ZBX_VC_MIN_CHUNK_RECORDS	2
 
+#define ZBX_VC_CHUNK_SLOT_SIZE		(sizeof(zbx_timespec_t) + sizeof(history_value_t))
+
 /* the maximum number is calculated so that the chunk size does not exceed 64KB */
-#define ZBX_VC_MAX_CHUNK_RECORDS	((64 * ZBX_KIBIBYTE - sizeof(zbx_vc_chunk_t)) / \
-		sizeof(zbx_history_record_t) + 1)
+#define ZBX_VC_MAX_CHUNK_RECORDS	((64 * ZBX_KIBIBYTE - sizeof(zbx_vc_chunk_t)) / ZBX_VC_CHUNK_SLOT_SIZE)
 
 /* the value cache item data */
 typedef struct
@@ -132,6 +191,14 @@ typedef struct
 	/* the hour when the current/global range sync was done       */
 	unsigned char	range_sync_hour;
 
+	/* the item state flags (ZBX_ITEM_STATE_*)                    */
+	unsigned char	state;
+
+	/* The number of open value cursors referencing item data.    */
+	/* Item data referenced by cursors is not modified or freed   */
+	/* except for appending new values.                           */
+	zbx_uint32_t	refcount;
+
 	/* The total number of item values in cache.                  */
 	/* Used to evaluate if the item must be dropped from cache    */
 	/* in low memory situation.                                   */
@@ -255,6 +322,8 @@ zbx_vc_item_update_t;
 ZBX_VECTOR_DECL(vc_itemupdate, zbx_vc_item_update_t)
 ZBX_VECTOR_IMPL(vc_itemupdate, zbx_vc_item_update_t)
 
+ZBX_VECTOR_IMPL(vc_range, zbx_vc_range_t)
+
 static zbx_vector_vc_itemupdate_t	vc_itemupdates;
 
 static void	vc_cache_item_update(zbx_uint64_t itemid, zbx_vc_item_update_type_t type, int arg1, int arg2)
@@ -274,12 +343,88 @@ static void	vc_cache_item_update(zbx_uint64_t itemid, zbx_vc_item_update_type_t
 /* the value cache */
 static zbx_vc_cache_t	*vc_cache = NULL;
 
-#define	RDLOCK_CACHE	zbx_rwlock_rdlock(vc_lock);
-#define	WRLOCK_CACHE	zbx_rwlock_wrlock(vc_lock);
-#define	UNLOCK_CACHE	zbx_rwlock_unlock(vc_lock);
+#define	RDLOCK_CACHE									\
+											\
+	do										\
+	{										\
+		zbx_rwlock_rdlock(vc_lock);						\
+		vc_lock_shared = 1;							\
+	}										\
+	while (0)
+
+#define	WRLOCK_CACHE	zbx_rwlock_wrlock(vc_lock)
+
+/* releasing the cache lock also releases the item stripe lock, so the item lock is */
+/* dropped together with the cache lock when reading values from database          */
+#define	UNLOCK_CACHE									\
+											\
+	do										\
+	{										\
+		vc_item_unlock();							\
+		vc_lock_shared = 0;							\
+		zbx_rwlock_unlock(vc_lock);						\
+	}										\
+	while (0)
+
+#define	LOCK_MEM									\
+											\
+	do										\
+	{										\
+		if (0 != vc_lock_shared)						\
+			zbx_mutex_lock(vc_mem_lock);					\
+	}										\
+	while (0)
+
+#define	UNLOCK_MEM									\
+											\
+	do										\
+	{										\
+		if (0 != vc_lock_shared)						\
+			zbx_mutex_unlock(vc_mem_lock);					\
+	}										\
+	while (0)
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: locks item stripe while cache is locked in read mode              *
+ *                                                                            *
+ * Parameters: itemid - [IN] the item identifier                              *
+ *                                                                            *
+ * Comments: Item stripes are not locked when cache is locked in write mode.  *
+ *                                                                            *
+ ******************************************************************************/
+static void	vc_item_lock(zbx_uint64_t itemid)
+{
+	if (0 == vc_lock_shared)
+		return;
+
+	if (-1 != vc_item_lock_index)
+	{
+		THIS_SHOULD_NEVER_HAPPEN;
+		return;
+	}
+
+	vc_item_lock_index = (int)(itemid % ZBX_VC_ITEM_LOCKS_NUM);
+	zbx_mutex_lock(vc_item_locks[vc_item_lock_index]);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: unlocks item stripe locked by this process                        *
+ *                                                                            *
+ ******************************************************************************/
+static void	vc_item_unlock(void)
+{
+	if (-1 == vc_item_lock_index)
+		return;
+
+	zbx_mutex_unlock(vc_item_locks[vc_item_lock_index]);
+	vc_item_lock_index = -1;
+}
 
 /* function prototypes */
-static void	vc_history_record_copy(zbx_history_record_t *dst, const zbx_history_record_t *src, int value_type);
+static void	vc_history_record_copy(zbx_history_record_t *dst, const zbx_timespec_t *ts,
+		const history_value_t *value, int value_type);
 static void	vc_history_record_vector_clean(zbx_vector_history_record_t *vector, int value_type);
 
 static size_t	vch_item_free_cache(zbx_vc_item_t *item);
@@ -751,7 +896,10 @@ static void	vc_warn_low_memory(void)
 	{
 		vc_cache->last_warning_time = now;
 		vc_dump_items_statistics();
+
+		LOCK_MEM;
 		zbx_mem_dump_stats(LOG_LEVEL_WARNING, vc_mem);
+		UNLOCK_MEM;
 
 		zabbix_log(LOG_LEVEL_WARNING, "value cache is fully used: please increase ValueCacheSize"
 				" configuration parameter");
@@ -785,7 +933,8 @@ static size_t	vc_release_unused_items(const zbx_vc_item_t *source_item)
 
 	while (NULL != (item = (zbx_vc_item_t *)zbx_hashset_iter_next(&iter)))
 	{
-		if (0 != item->last_accessed && item->last_accessed < timestamp && source_item != item)
+		if (0 != item->last_accessed && item->last_accessed < timestamp && source_item != item &&
+				0 == item->refcount)
 		{
 			freed += vch_item_free_cache(item) + sizeof(zbx_vc_item_t);
 			zbx_hashset_iter_remove(&iter);
@@ -860,7 +1009,7 @@ static void	vc_release_space(zbx_vc_item_t *source_item, size_t space)
 	{
 		/* don't remove the item that requested the space and also keep */
 		/* items currently being accessed                               */
-		if (item != source_item)
+		if (item != source_item && 0 == item->refcount)
 		{
 			zbx_vc_item_weight_t	weight = {.item = item};
 
@@ -888,49 +1037,52 @@ static void	vc_release_space(zbx_vc_item_t *source_item, size_t space)
  * Purpose: copies history value                                              *
  *                                                                            *
  * Parameters: dst        - [OUT] a pointer to the destination value          *
- *             src        - [IN] a pointer to the source value                *
+ *             ts         - [IN] the source value timestamp                   *
+ *             value      - [IN] the source value                             *
  *             value_type - [IN] the value type (see ITEM_VALUE_TYPE_* defs)  *
  *                                                                            *
  * Comments: Additional memory is allocated to store string, text and log     *
  *           value contents. This memory must be freed by the caller.         *
  *                                                                            *
  ******************************************************************************/
-static void	vc_history_record_copy(zbx_history_record_t *dst, const zbx_history_record_t *src, int value_type)
+static void	vc_history_record_copy(zbx_history_record_t *dst, const zbx_timespec_t *ts,
+		const history_value_t *value, int value_type)
 {
-	dst->timestamp = src->timestamp;
+	dst->timestamp = *ts;
 
 	switch (value_type)
 	{
 		case ITEM_VALUE_TYPE_STR:
 		case ITEM_VALUE_TYPE_TEXT:
-			dst->value.str = zbx_strdup(NULL, src->value.str);
+			dst->value.str = zbx_strdup(NULL, value->str);
 			break;
 		case ITEM_VALUE_TYPE_LOG:
-			dst->value.log = vc_history_logdup(src->value.log);
+			dst->value.log = vc_history_logdup(value->log);
 			break;
 		default:
-			dst->value = src->value;
+			dst->value = *value;
 	}
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: appends the specified value to value vector                       *
+ * Purpose: appends the specified chunk value to value vector                 *
  *                                                                            *
  * Parameters: vector     - [IN/OUT] the value vector                         *
  *             value_type - [IN] the type of value to append                  *
- *             value      - [IN] the value to append                          *
+ *             chunk      - [IN] the chunk containing the value               *
+ *             index      - [IN] the value index in chunk                     *
  *                                                                            *
  * Comments: Additional memory is allocated to store string, text and log     *
  *           value contents. This memory must be freed by the caller.         *
  *                                                                            *
  ******************************************************************************/
 static void	vc_history_record_vector_append(zbx_vector_history_record_t *vector, int value_type,
-		zbx_history_record_t *value)
+		const zbx_vc_chunk_t *chunk, int index)
 {
 	zbx_history_record_t	record;
 
-	vc_history_record_copy(&record, value, value_type);
+	vc_history_record_copy(&record, &chunk->timestamps[index], &chunk->values[index], value_type);
 	zbx_vector_history_record_append_ptr(vector, &record);
 }
 
@@ -947,12 +1099,22 @@ static void	vc_history_record_vector_append(zbx_vector_history_record_t *vector,
  * Comments: If allocation fails this function attempts to free the required  *
  *           space in cache by calling vc_free_space() and tries again. If it *
  *           still fails a NULL value is returned.                            *
+ *           Space is not freed while the cache is locked in read mode.       *
  *                                                                            *
  ******************************************************************************/
 static void	*vc_item_malloc(zbx_vc_item_t *item, size_t size)
 {
 	char	*ptr;
 
+	if (0 != vc_lock_shared)
+	{
+		zbx_mutex_lock(vc_mem_lock);
+		ptr = (char *)__vc_mem_malloc_func(NULL, size);
+		zbx_mutex_unlock(vc_mem_lock);
+
+		return ptr;
+	}
+
 	if (NULL == (ptr = (char *)__vc_mem_malloc_func(NULL, size)))
 	{
 		/* If failed to allocate required memory, try to free space in      */
@@ -992,19 +1154,27 @@ static char	*vc_item_strdup(zbx_vc_item_t *item, const char *str)
 
 	len = strlen(str) + 1;
 
+	LOCK_MEM;
+
 	while (NULL == (ptr = zbx_hashset_insert_ext(&vc_cache->strpool, str - REFCOUNT_FIELD_SIZE,
 			REFCOUNT_FIELD_SIZE + len, REFCOUNT_FIELD_SIZE, ZBX_HASHSET_UNIQ_FALSE)))
 	{
 		/* If there is not enough space - free enough to store string + hashset entry overhead */
 		/* and try inserting one more time. If it fails again, then fail the function.         */
-		if (0 == tries++)
-			vc_release_space(item, len + REFCOUNT_FIELD_SIZE + sizeof(ZBX_HASHSET_ENTRY_T));
-		else
+		/* Space cannot be released while the cache is locked in read mode.                    */
+		if (0 != tries++ || 0 != vc_lock_shared)
+		{
+			UNLOCK_MEM;
 			return NULL;
+		}
+
+		vc_release_space(item, len + REFCOUNT_FIELD_SIZE + sizeof(ZBX_HASHSET_ENTRY_T));
 	}
 
 	(*(zbx_uint32_t *)ptr)++;
 
+	UNLOCK_MEM;
+
 	return (char *)ptr + REFCOUNT_FIELD_SIZE;
 }
 
@@ -1031,11 +1201,15 @@ static size_t	vc_item_strfree(char *str)
 	{
 		void	*ptr = str - REFCOUNT_FIELD_SIZE;
 
+		LOCK_MEM;
+
 		if (0 == --(*(zbx_uint32_t *)ptr))
 		{
 			freed = strlen(str) + REFCOUNT_FIELD_SIZE + 1;
 			zbx_hashset_remove_direct(&vc_cache->strpool, ptr);
 		}
+
+		UNLOCK_MEM;
 	}
 
 	return freed;
@@ -1083,7 +1257,9 @@ static zbx_log_value_t	*vc_item_logdup(zbx_vc_item_t *item, const zbx_log_value_
 fail:
 	vc_item_strfree(plog->source);
 
+	LOCK_MEM;
 	__vc_mem_free_func(plog);
+	UNLOCK_MEM;
 
 	return NULL;
 }
@@ -1109,7 +1285,9 @@ static size_t	vc_item_logfree(zbx_log_value_t *log)
 		freed += vc_item_strfree(log->source);
 		freed += vc_item_strfree(log->value);
 
+		LOCK_MEM;
 		__vc_mem_free_func(log);
+		UNLOCK_MEM;
 		freed += sizeof(zbx_log_value_t);
 	}
 
@@ -1128,7 +1306,7 @@ static size_t	vc_item_logfree(zbx_log_value_t *log)
  * Return value: the number of bytes freed                                    *
  *                                                                            *
  ******************************************************************************/
-static size_t	vc_item_free_values(zbx_vc_item_t *item, zbx_history_record_t *values, int first, int last)
+static size_t	vc_item_free_values(zbx_vc_item_t *item, history_value_t *values, int first, int last)
 {
 	size_t	freed = 0;
 	int 	i;
@@ -1138,11 +1316,11 @@ static size_t	vc_item_free_values(zbx_vc_item_t *item, zbx_history_record_t *val
 		case ITEM_VALUE_TYPE_STR:
 		case ITEM_VALUE_TYPE_TEXT:
 			for (i = first; i <= last; i++)
-				freed += vc_item_strfree(values[i].value.str);
+				freed += vc_item_strfree(values[i].str);
 			break;
 		case ITEM_VALUE_TYPE_LOG:
 			for (i = first; i <= last; i++)
-				freed += vc_item_logfree(values[i].value.log);
+				freed += vc_item_logfree(values[i].log);
 			break;
 	}
 
@@ -1160,6 +1338,13 @@ static size_t	vc_item_free_values(zbx_vc_item_t *item, zbx_history_record_t *val
  ******************************************************************************/
 static void	vc_remove_item(zbx_vc_item_t *item)
 {
+	/* item data referenced by value cursors is freed when the last cursor is closed */
+	if (0 != item->refcount)
+	{
+		item->state |= ZBX_ITEM_STATE_REMOVE_PENDING;
+		return;
+	}
+
 	vch_item_free_cache(item);
 	zbx_hashset_remove_direct(&vc_cache->items, item);
 }
@@ -1178,8 +1363,7 @@ static void	vc_remove_item_by_id(zbx_uint64_t itemid)
 	if (NULL == (item = (zbx_vc_item_t *)zbx_hashset_search(&vc_cache->items, &itemid)))
 		return;
 
-	vch_item_free_cache(item);
-	zbx_hashset_remove_direct(&vc_cache->items, item);
+	vc_remove_item(item);
 }
 /******************************************************************************
  *                                                                            *
@@ -1324,13 +1508,15 @@ static int	vch_item_add_chunk(zbx_vc_item_t *item, int nslots, zbx_vc_chunk_t *i
 	zbx_vc_chunk_t	*chunk;
 	int		chunk_size;
 
-	chunk_size = sizeof(zbx_vc_chunk_t) + sizeof(zbx_history_record_t) * (nslots - 1);
+	chunk_size = sizeof(zbx_vc_chunk_t) + ZBX_VC_CHUNK_SLOT_SIZE * nslots;
 
 	if (NULL == (chunk = (zbx_vc_chunk_t *)vc_item_malloc(item, chunk_size)))
 		return FAIL;
 
 	memset(chunk, 0, sizeof(zbx_vc_chunk_t));
 	chunk->slots_num = nslots;
+	chunk->timestamps = (zbx_timespec_t *)(chunk + 1);
+	chunk->values = (history_value_t *)(chunk->timestamps + nslots);
 
 	chunk->next = insert_before;
 
@@ -1359,962 +1545,2523 @@ static int	vch_item_add_chunk(zbx_vc_item_t *item, int nslots, zbx_vc_chunk_t *i
 	return SUCCEED;
 }
 
+/* the compressed chunk bit stream */
+typedef struct
+{
+	unsigned char	*data;
+	size_t		alloc;
+	size_t		bits;
+}
+zbx_vc_bits_t;
+
+/* the process local buffer of decoded chunk */
+typedef struct
+{
+	zbx_vc_chunk_t	chunk;
+	int		slots_alloc;
+}
+zbx_vc_chunk_buf_t;
+
+/* the decoded chunk buffers, see vch_chunk_get_data() and vch_chunk_get_timestamp() */
+#define ZBX_VC_CHUNK_BUF_DATA		0
+#define ZBX_VC_CHUNK_BUF_TIMESTAMP	1
+#define ZBX_VC_CHUNK_BUF_NUM		2
+
+static zbx_vc_chunk_buf_t	vc_chunk_bufs[ZBX_VC_CHUNK_BUF_NUM];
+
+/* the process local buffer for encoding chunks */
+static zbx_vc_bits_t	vc_chunk_bits;
+
+/* the size of raw first value timestamp seconds and timestamp nanoseconds */
+#define ZBX_VC_BITS_SEC		32
+#define ZBX_VC_BITS_NS		30
+
 /******************************************************************************
  *                                                                            *
- * Purpose: find the index of the last value in chunk with timestamp less or  *
- *          equal to the specified timestamp.                                 *
- *                                                                            *
- * Parameters:  chunk - [IN] the chunk                                        *
- *              ts    - [IN] the target timestamp                             *
+ * Purpose: appends bits to bit stream                                        *
  *                                                                            *
- * Return value: The index of the last value in chunk with timestamp less or  *
- *               equal to the specified timestamp.                            *
- *               -1 is returned in the case of failure (meaning that all      *
- *               values have timestamps greater than the target timestamp).   *
+ * Parameters: bits  - [IN/OUT] the bit stream                                *
+ *             value - [IN] the value, the lowest num bits are written        *
+ *             num   - [IN] the number of bits to write (1-64)                *
  *                                                                            *
  ******************************************************************************/
-static int	vch_chunk_find_last_value_before(const zbx_vc_chunk_t *chunk, const zbx_timespec_t *ts)
+static void	vc_bits_write(zbx_vc_bits_t *bits, zbx_uint64_t value, int num)
 {
-	int	start = chunk->first_value, end = chunk->last_value, middle;
-
-	/* check if the last value timestamp is already greater or equal to the specified timestamp */
-	if (0 >= zbx_timespec_compare(&chunk->slots[end].timestamp, ts))
-		return end;
-
-	/* chunk contains only one value, which did not pass the above check, return failure */
-	if (start == end)
-		return -1;
-
-	/* perform value lookup using binary search */
-	while (start != end)
+	while (0 < num)
 	{
-		middle = start + (end - start) / 2;
+		size_t	byte = bits->bits >> 3;
+		int	free_bits = 8 - (int)(bits->bits & 7), n = MIN(free_bits, num);
 
-		if (0 < zbx_timespec_compare(&chunk->slots[middle].timestamp, ts))
+		if (byte >= bits->alloc)
 		{
-			end = middle;
-			continue;
+			bits->alloc = (0 == bits->alloc ? ZBX_KIBIBYTE : bits->alloc * 2);
+			bits->data = (unsigned char *)zbx_realloc(bits->data, bits->alloc);
 		}
 
-		if (0 >= zbx_timespec_compare(&chunk->slots[middle + 1].timestamp, ts))
-		{
-			start = middle;
-			continue;
-		}
+		if (8 == free_bits)
+			bits->data[byte] = 0;
 
-		return middle;
+		bits->data[byte] |= (unsigned char)(((value >> (num - n)) & ((1u << n) - 1)) << (free_bits - n));
+		bits->bits += n;
+		num -= n;
 	}
-
-	return -1;
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: gets the chunk and index of the last value with a timestamp less  *
- *          or equal to the specified timestamp                               *
- *                                                                            *
- * Parameters:  item          - [IN] the item                                 *
- *              ts            - [IN] the target timestamp                     *
- *                                   (NULL - current time)                    *
- *              pchunk        - [OUT] the chunk containing the target value   *
- *              pindex        - [OUT] the index of the target value           *
+ * Purpose: reads bits from bit stream                                        *
  *                                                                            *
- * Return value: SUCCEED - the last value was found successfully              *
- *               FAIL - all values in cache have timestamps greater than the  *
- *                      target (timeshift) timestamp.                         *
+ * Parameters: data - [IN] the bit stream data                                *
+ *             pos  - [IN/OUT] the bit position                               *
+ *             num  - [IN] the number of bits to read (1-64)                  *
  *                                                                            *
- * Comments: If end_timestamp value is 0, then simply the last item value in  *
- *           cache is returned.                                               *
+ * Return value: the read bits                                                *
  *                                                                            *
  ******************************************************************************/
-static int	vch_item_get_last_value(const zbx_vc_item_t *item, const zbx_timespec_t *ts, zbx_vc_chunk_t **pchunk,
-		int *pindex)
+static zbx_uint64_t	vc_bits_read(const unsigned char *data, size_t *pos, int num)
 {
-	zbx_vc_chunk_t	*chunk = item->head;
-	int		index;
+	zbx_uint64_t	value = 0;
 
-	if (NULL == chunk)
-		return FAIL;
-
-	index = chunk->last_value;
-
-	if (0 < zbx_timespec_compare(&chunk->slots[index].timestamp, ts))
+	while (0 < num)
 	{
-		while (0 < zbx_timespec_compare(&chunk->slots[chunk->first_value].timestamp, ts))
-		{
-			chunk = chunk->prev;
-			/* there are no values for requested range, return failure */
-			if (NULL == chunk)
-				return FAIL;
-		}
-		index = vch_chunk_find_last_value_before(chunk, ts);
-	}
+		int	avail = 8 - (int)(*pos & 7), n = MIN(avail, num);
 
-	*pchunk = chunk;
-	*pindex = index;
+		value = (value << n) | ((data[*pos >> 3] >> (avail - n)) & ((1u << n) - 1));
+		*pos += n;
+		num -= n;
+	}
 
-	return SUCCEED;
+	return value;
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: copies value in the specified item's chunk slot                   *
- *                                                                            *
- * Parameters: chunk        - [IN/OUT] the target chunk                       *
- *             index        - [IN] the target slot                            *
- *             source_value - [IN] the value to copy                          *
+ * Purpose: writes delta-of-delta to bit stream                               *
  *                                                                            *
- * Return value: SUCCEED - the value was copied successfully                  *
- *               FAIL    - the value copying failed (not enough space for     *
- *                         string, text or log type data)                     *
+ * Parameters: bits - [IN/OUT] the bit stream                                 *
+ *             dod  - [IN] the difference between current and previous delta  *
+ *                         (two's complement)                                 *
  *                                                                            *
- * Comments: This function is used to copy data to cache. The contents of     *
- *           str, text and log type values are stored in cache string pool.   *
+ * Comments: The signed value is zigzag encoded and written with 1-4 bit      *
+ *           prefix selecting 0, 7, 12, 20 or 64 bit long value.              *
  *                                                                            *
  ******************************************************************************/
-static int	vch_item_copy_value(zbx_vc_item_t *item, zbx_vc_chunk_t *chunk, int index,
-		const zbx_history_record_t *source_value)
+static void	vc_bits_write_dod(zbx_vc_bits_t *bits, zbx_uint64_t dod)
 {
-	zbx_history_record_t	*value;
-	int			ret = FAIL;
-
-	value = &chunk->slots[index];
+	zbx_uint64_t	zz = (dod << 1) ^ (0 - (dod >> 63));
 
-	switch (item->value_type)
+	if (0 == zz)
 	{
-		case ITEM_VALUE_TYPE_STR:
-		case ITEM_VALUE_TYPE_TEXT:
-			if (NULL == (value->value.str = vc_item_strdup(item, source_value->value.str)))
-				goto out;
-			break;
-		case ITEM_VALUE_TYPE_LOG:
-			if (NULL == (value->value.log = vc_item_logdup(item, source_value->value.log)))
-				goto out;
-			break;
-		default:
-			value->value = source_value->value;
+		vc_bits_write(bits, 0, 1);
+	}
+	else if (zz < (__UINT64_C(1) << 7))
+	{
+		vc_bits_write(bits, 2, 2);
+		vc_bits_write(bits, zz, 7);
+	}
+	else if (zz < (__UINT64_C(1) << 12))
+	{
+		vc_bits_write(bits, 6, 3);
+		vc_bits_write(bits, zz, 12);
+	}
+	else if (zz < (__UINT64_C(1) << 20))
+	{
+		vc_bits_write(bits, 14, 4);
+		vc_bits_write(bits, zz, 20);
+	}
+	else
+	{
+		vc_bits_write(bits, 15, 4);
+		vc_bits_write(bits, zz, 64);
 	}
-	value->timestamp = source_value->timestamp;
-
-	ret = SUCCEED;
-out:
-	return ret;
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: copies values at the beginning of item tail chunk                 *
- *                                                                            *
- * Parameters: item       - [IN/OUT] the target item                          *
- *             values     - [IN] the values to copy                           *
- *             values_num - [IN] the number of values to copy                 *
+ * Purpose: reads delta-of-delta from bit stream                              *
  *                                                                            *
- * Return value: SUCCEED - the values were copied successfully                *
- *               FAIL    - the value copying failed (not enough space for     *
- *                         string, text or log type data)                     *
+ * Parameters: data - [IN] the bit stream data                                *
+ *             pos  - [IN/OUT] the bit position                               *
  *                                                                            *
- * Comments: This function is used to copy data to cache. The contents of     *
- *           str, text and log type values are stored in cache string pool.   *
+ * Return value: the delta-of-delta (two's complement)                        *
  *                                                                            *
  ******************************************************************************/
-static int	vch_item_copy_values_at_tail(zbx_vc_item_t *item, const zbx_history_record_t *values, int values_num)
+static zbx_uint64_t	vc_bits_read_dod(const unsigned char *data, size_t *pos)
 {
-	int	i, ret = FAIL, first_value = item->tail->first_value;
-
-	switch (item->value_type)
-	{
-		case ITEM_VALUE_TYPE_STR:
-		case ITEM_VALUE_TYPE_TEXT:
-			for (i = values_num - 1; i >= 0; i--)
-			{
-				zbx_history_record_t	*value = &item->tail->slots[item->tail->first_value - 1];
-
-				if (NULL == (value->value.str = vc_item_strdup(item, values[i].value.str)))
-					goto out;
+	zbx_uint64_t	zz;
 
-				value->timestamp = values[i].timestamp;
-				item->tail->first_value--;
-			}
-			ret = SUCCEED;
-
-			break;
-		case ITEM_VALUE_TYPE_LOG:
-			for (i = values_num - 1; i >= 0; i--)
-			{
-				zbx_history_record_t	*value = &item->tail->slots[item->tail->first_value - 1];
-
-				if (NULL == (value->value.log = vc_item_logdup(item, values[i].value.log)))
-					goto out;
-
-				value->timestamp = values[i].timestamp;
-				item->tail->first_value--;
-			}
-			ret = SUCCEED;
+	if (0 == vc_bits_read(data, pos, 1))
+		return 0;
 
-			break;
-		default:
-			memcpy(&item->tail->slots[item->tail->first_value - values_num], values,
-					values_num * sizeof(zbx_history_record_t));
-			item->tail->first_value -= values_num;
-			ret = SUCCEED;
-	}
-out:
-	item->values_total += first_value - item->tail->first_value;
+	if (0 == vc_bits_read(data, pos, 1))
+		zz = vc_bits_read(data, pos, 7);
+	else if (0 == vc_bits_read(data, pos, 1))
+		zz = vc_bits_read(data, pos, 12);
+	else if (0 == vc_bits_read(data, pos, 1))
+		zz = vc_bits_read(data, pos, 20);
+	else
+		zz = vc_bits_read(data, pos, 64);
 
-	return ret;
+	return (zz >> 1) ^ (0 - (zz & 1));
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: frees chunk and all resources allocated to store its values       *
+ * Purpose: writes XOR of current and previous floating value to bit stream   *
  *                                                                            *
- * Parameters: item    - [IN] the chunk owner item                            *
- *             chunk   - [IN] the chunk to free                               *
+ * Parameters: bits  - [IN/OUT] the bit stream                                *
+ *             x     - [IN] the XOR of the value bits                         *
+ *             lead  - [IN/OUT] the leading zero bits of the last written     *
+ *                              meaningful bits window, -1 if none            *
+ *             trail - [IN/OUT] the trailing zero bits of the window          *
  *                                                                            *
- * Return value: the number of bytes freed                                    *
+ * Comments: Equal values are written as single 0 bit. Otherwise the          *
+ *           meaningful bits are written either within the previous window    *
+ *           (prefix 10) or with a new window (prefix 11, 5 bits of leading   *
+ *           zeros and 6 bits of meaningful bits length).                     *
  *                                                                            *
  ******************************************************************************/
-static size_t	vch_item_free_chunk(zbx_vc_item_t *item, zbx_vc_chunk_t *chunk)
+static void	vc_bits_write_xor(zbx_vc_bits_t *bits, zbx_uint64_t x, int *lead, int *trail)
 {
-	size_t	freed;
+	int	l = 0, t = 0;
+
+	if (0 == x)
+	{
+		vc_bits_write(bits, 0, 1);
+		return;
+	}
 
-	freed = sizeof(zbx_vc_chunk_t) + (chunk->slots_num - 1) * sizeof(zbx_history_record_t);
-	freed += vc_item_free_values(item, chunk->slots, chunk->first_value, chunk->last_value);
+	while (0 == (x & (__UINT64_C(1) << (63 - l))) && 31 > l)
+		l++;
 
-	__vc_mem_free_func(chunk);
+	while (0 == (x & (__UINT64_C(1) << t)))
+		t++;
 
-	return freed;
+	if (-1 != *lead && l >= *lead && t >= *trail)
+	{
+		vc_bits_write(bits, 2, 2);
+		vc_bits_write(bits, x >> *trail, 64 - *lead - *trail);
+		return;
+	}
+
+	*lead = l;
+	*trail = t;
+
+	vc_bits_write(bits, 3, 2);
+	vc_bits_write(bits, (zbx_uint64_t)l, 5);
+	vc_bits_write(bits, (zbx_uint64_t)(64 - l - t - 1), 6);
+	vc_bits_write(bits, x >> t, 64 - l - t);
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: removes item history data chunk                                   *
+ * Purpose: reads XOR of current and previous floating value from bit stream  *
  *                                                                            *
- * Parameters: item    - [IN ] the chunk owner item                           *
- *             chunk   - [IN] the chunk to remove                             *
+ * Parameters: data  - [IN] the bit stream data                               *
+ *             pos   - [IN/OUT] the bit position                              *
+ *             lead  - [IN/OUT] the leading zero bits of meaningful bits      *
+ *                              window                                        *
+ *             trail - [IN/OUT] the trailing zero bits of the window          *
+ *                                                                            *
+ * Return value: the XOR of the value bits                                    *
  *                                                                            *
  ******************************************************************************/
-static void	vch_item_remove_chunk(zbx_vc_item_t *item, zbx_vc_chunk_t *chunk)
+static zbx_uint64_t	vc_bits_read_xor(const unsigned char *data, size_t *pos, int *lead, int *trail)
 {
-	if (NULL != chunk->next)
-		chunk->next->prev = chunk->prev;
+	int	len;
 
-	if (NULL != chunk->prev)
-		chunk->prev->next = chunk->next;
-
-	if (chunk == item->head)
-		item->head = chunk->prev;
+	if (0 == vc_bits_read(data, pos, 1))
+		return 0;
 
-	if (chunk == item->tail)
-		item->tail = chunk->next;
+	if (0 != vc_bits_read(data, pos, 1))
+	{
+		*lead = (int)vc_bits_read(data, pos, 5);
+		len = (int)vc_bits_read(data, pos, 6) + 1;
+		*trail = 64 - *lead - len;
+	}
+	else
+		len = 64 - *lead - *trail;
 
-	vch_item_free_chunk(item, chunk);
+	return vc_bits_read(data, pos, len) << *trail;
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: removes item history data that are outside (older) the maximum    *
- *          request range                                                     *
+ * Purpose: encodes chunk timestamps and values                               *
  *                                                                            *
- * Parameters:  item   - [IN] the target item                                 *
+ * Parameters: value_type - [IN] the item value type (float or unsigned)      *
+ *             timestamps - [IN] the timestamps                               *
+ *             values     - [IN] the values                                   *
+ *             values_num - [IN] the number of values                         *
+ *             bits       - [OUT] the encoded data                            *
+ *                                                                            *
+ * Comments: The first timestamp and value are written as is. Then timestamp  *
+ *           seconds are written as delta-of-delta, nanoseconds as single 0   *
+ *           bit when matching the previous value or 1 bit followed by the    *
+ *           nanoseconds. Floating values are written as XOR with the         *
+ *           previous value and unsigned values as delta-of-delta.            *
  *                                                                            *
  ******************************************************************************/
-static void	vch_item_clean_cache(zbx_vc_item_t *item)
+static void	vc_chunk_encode(unsigned char value_type, const zbx_timespec_t *timestamps,
+		const history_value_t *values, int values_num, zbx_vc_bits_t *bits)
 {
-	zbx_vc_chunk_t	*next;
+	zbx_uint64_t	sec, sec_delta = 0, value, value_delta = 0;
+	int		i, lead = -1, trail = 0;
 
-	if (0 != item->active_range)
-	{
-		zbx_vc_chunk_t	*tail = item->tail;
-		zbx_vc_chunk_t	*chunk = tail;
-		int		timestamp;
+	bits->bits = 0;
 
-		timestamp = time(NULL) - item->active_range;
-
-		/* try to remove chunks with all history values older than maximum request range */
-		while (NULL != chunk && chunk->slots[chunk->last_value].timestamp.sec < timestamp &&
-				chunk->slots[chunk->last_value].timestamp.sec !=
-						item->head->slots[item->head->last_value].timestamp.sec)
-		{
-			/* don't remove the head chunk */
-			if (NULL == (next = chunk->next))
-				break;
-
-			/* Values with the same timestamps (seconds resolution) always should be either   */
-			/* kept in cache or removed together. There should not be a case when one of them */
-			/* is in cache and the second is dropped.                                         */
-			/* Here we are handling rare case, when the last value of first chunk has the     */
-			/* same timestamp (seconds resolution) as the first value in the second chunk.    */
-			/* In this case increase the first value index of the next chunk until the first  */
-			/* value timestamp is greater.                                                    */
-
-			if (next->slots[next->first_value].timestamp.sec != next->slots[next->last_value].timestamp.sec)
-			{
-				while (next->slots[next->first_value].timestamp.sec ==
-						chunk->slots[chunk->last_value].timestamp.sec)
-				{
-					vc_item_free_values(item, next->slots, next->first_value, next->first_value);
-					next->first_value++;
-				}
-			}
-
-			/* set the database cached from timestamp to the last (oldest) removed value timestamp + 1 */
-			item->db_cached_from = chunk->slots[chunk->last_value].timestamp.sec + 1;
+	vc_bits_write(bits, (zbx_uint32_t)timestamps[0].sec, ZBX_VC_BITS_SEC);
+	vc_bits_write(bits, (zbx_uint64_t)timestamps[0].ns, ZBX_VC_BITS_NS);
+	vc_bits_write(bits, values[0].ui64, 64);
 
-			vch_item_remove_chunk(item, chunk);
+	for (i = 1; i < values_num; i++)
+	{
+		sec = (zbx_uint64_t)timestamps[i].sec - (zbx_uint64_t)timestamps[i - 1].sec;
+		vc_bits_write_dod(bits, sec - sec_delta);
+		sec_delta = sec;
 
-			chunk = next;
+		if (timestamps[i].ns == timestamps[i - 1].ns)
+		{
+			vc_bits_write(bits, 0, 1);
+		}
+		else
+		{
+			vc_bits_write(bits, 1, 1);
+			vc_bits_write(bits, (zbx_uint64_t)timestamps[i].ns, ZBX_VC_BITS_NS);
 		}
 
-		/* reset the status flags if data was removed from cache */
-		if (tail != item->tail)
-			item->status = 0;
+		if (ITEM_VALUE_TYPE_FLOAT == value_type)
+		{
+			vc_bits_write_xor(bits, values[i].ui64 ^ values[i - 1].ui64, &lead, &trail);
+		}
+		else
+		{
+			value = values[i].ui64 - values[i - 1].ui64;
+			vc_bits_write_dod(bits, value - value_delta);
+			value_delta = value;
+		}
 	}
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: removes item history data that are older than the specified       *
- *          timestamp                                                         *
+ * Purpose: decodes timestamps and values of compressed chunk                 *
  *                                                                            *
- * Parameters:  item      - [IN] the target item                              *
- *              timestamp - [IN] the timestamp (number of seconds since the   *
- *                               Epoch)                                       *
+ * Parameters: value_type - [IN] the item value type (float or unsigned)      *
+ *             data       - [IN] the encoded data                             *
+ *             values_num - [IN] the number of values to decode, starting     *
+ *                               with the oldest                              *
+ *             timestamps - [OUT] the timestamps                              *
+ *             values     - [OUT] the values                                  *
  *                                                                            *
  ******************************************************************************/
-static void	vch_item_remove_values(zbx_vc_item_t *item, int timestamp)
+static void	vc_chunk_decode(unsigned char value_type, const unsigned char *data, int values_num,
+		zbx_timespec_t *timestamps, history_value_t *values)
 {
-	zbx_vc_chunk_t	*chunk = item->tail;
+	zbx_uint64_t	sec, sec_delta = 0, value_delta = 0;
+	size_t		pos = 0;
+	int		i, lead = 0, trail = 0;
 
-	if (ZBX_ITEM_STATUS_CACHED_ALL == item->status)
-		item->status = 0;
+	sec = vc_bits_read(data, &pos, ZBX_VC_BITS_SEC);
+	timestamps[0].sec = (int)(zbx_uint32_t)sec;
+	timestamps[0].ns = (int)vc_bits_read(data, &pos, ZBX_VC_BITS_NS);
+	values[0].ui64 = vc_bits_read(data, &pos, 64);
 
-	/* try to remove chunks with all history values older than the timestamp */
-	while (NULL != chunk && chunk->slots[chunk->first_value].timestamp.sec < timestamp)
+	for (i = 1; i < values_num; i++)
 	{
-		zbx_vc_chunk_t	*next;
+		sec_delta += vc_bits_read_dod(data, &pos);
+		timestamps[i].sec = (int)(zbx_uint32_t)((zbx_uint64_t)timestamps[i - 1].sec + sec_delta);
 
-		/* If chunk contains values with timestamp greater or equal - remove */
-		/* only the values with less timestamp. Otherwise remove the while   */
-		/* chunk and check next one.                                         */
-		if (chunk->slots[chunk->last_value].timestamp.sec >= timestamp)
-		{
-			while (chunk->slots[chunk->first_value].timestamp.sec < timestamp)
-			{
-				vc_item_free_values(item, chunk->slots, chunk->first_value, chunk->first_value);
-				chunk->first_value++;
-			}
+		if (0 == vc_bits_read(data, &pos, 1))
+			timestamps[i].ns = timestamps[i - 1].ns;
+		else
+			timestamps[i].ns = (int)vc_bits_read(data, &pos, ZBX_VC_BITS_NS);
 
-			break;
+		if (ITEM_VALUE_TYPE_FLOAT == value_type)
+		{
+			values[i].ui64 = values[i - 1].ui64 ^ vc_bits_read_xor(data, &pos, &lead, &trail);
+		}
+		else
+		{
+			value_delta += vc_bits_read_dod(data, &pos);
+			values[i].ui64 = values[i - 1].ui64 + value_delta;
 		}
-
-		next = chunk->next;
-		vch_item_remove_chunk(item, chunk);
-		chunk = next;
 	}
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: adds one item history value at the end of current item's history  *
- *          data                                                              *
- *                                                                            *
- * Parameters:  item   - [IN] the item to add history data to                 *
- *              value  - [IN] the item history data value                     *
+ * Purpose: decodes compressed chunk into process local buffer                *
  *                                                                            *
- * Return value: SUCCEED - the history data value was added successfully      *
- *               FAIL - failed to add history data value (not enough memory)  *
+ * Parameters: item       - [IN] the chunk owner item                         *
+ *             chunk      - [IN] the chunk                                    *
+ *             values_num - [IN] the number of values to decode               *
+ *             buf        - [IN] the buffer (ZBX_VC_CHUNK_BUF_*)              *
  *                                                                            *
- * Comments: In the case of failure the item will be removed from cache       *
- *           later.                                                           *
+ * Return value: the decoded chunk                                            *
  *                                                                            *
  ******************************************************************************/
-static int	vch_item_add_value_at_head(zbx_vc_item_t *item, const zbx_history_record_t *value)
+static const zbx_vc_chunk_t	*vch_chunk_decode(const zbx_vc_item_t *item, const zbx_vc_chunk_t *chunk,
+		int values_num, int buf)
 {
-	int		ret = FAIL, index, sindex, nslots = 0;
-	zbx_vc_chunk_t	*chunk, *schunk;
+	zbx_vc_chunk_buf_t	*chunk_buf = &vc_chunk_bufs[buf];
 
-	if (NULL != item->head &&
-			0 < zbx_history_record_compare_asc_func(&item->head->slots[item->head->last_value], value))
+	if (chunk_buf->slots_alloc < chunk->slots_num)
 	{
-		if (0 < zbx_history_record_compare_asc_func(&item->tail->slots[item->tail->first_value], value))
-		{
-			/* If the added value has the same or older timestamp as the first value in cache */
-			/* we can't add it to keep cache consistency. Additionally we must make sure no   */
-			/* values with matching timestamp seconds are kept in cache.                      */
-			vch_item_remove_values(item, value->timestamp.sec + 1);
-
-			/* empty items must be removed to avoid situation when a new value is added to cache */
-			/* while other values with matching timestamp seconds are not cached                 */
-			if (NULL == item->head)
-				goto out;
-
-			/* if the value is newer than the database cached from timestamp we must */
-			/* adjust the cached from timestamp to exclude this value                */
-			if (item->db_cached_from <= value->timestamp.sec)
-				item->db_cached_from = value->timestamp.sec + 1;
-
-			ret = SUCCEED;
-			goto out;
-		}
+		chunk_buf->slots_alloc = chunk->slots_num;
+		chunk_buf->chunk.timestamps = (zbx_timespec_t *)zbx_realloc(chunk_buf->chunk.timestamps,
+				sizeof(zbx_timespec_t) * (size_t)chunk_buf->slots_alloc);
+		chunk_buf->chunk.values = (history_value_t *)zbx_realloc(chunk_buf->chunk.values,
+				sizeof(history_value_t) * (size_t)chunk_buf->slots_alloc);
+	}
 
-		sindex = item->head->last_value;
-		schunk = item->head;
+	chunk_buf->chunk.prev = chunk->prev;
+	chunk_buf->chunk.next = chunk->next;
+	chunk_buf->chunk.first_value = chunk->first_value;
+	chunk_buf->chunk.last_value = chunk->last_value;
+	chunk_buf->chunk.slots_num = chunk->slots_num;
+	chunk_buf->chunk.data_size = chunk->data_size;
 
-		if (0 == item->head->slots_num - item->head->last_value - 1)
-		{
-			if (FAIL == vch_item_add_chunk(item, vch_item_chunk_slot_count(item, 1), NULL))
-				goto out;
-		}
-		else
-			item->head->last_value++;
+	vc_chunk_decode(item->value_type, (const unsigned char *)(chunk + 1), values_num,
+			chunk_buf->chunk.timestamps, chunk_buf->chunk.values);
 
-		item->values_total++;
+	return &chunk_buf->chunk;
+}
 
-		chunk = item->head;
-		index = item->head->last_value;
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets chunk with accessible timestamp and value arrays             *
+ *                                                                            *
+ * Parameters: item  - [IN] the chunk owner item                              *
+ *             chunk - [IN] the chunk                                         *
+ *                                                                            *
+ * Return value: the chunk itself or its decoded copy if it is compressed     *
+ *                                                                            *
+ * Comments: The decoded copy is valid until the next call of this function   *
+ *           and must not be modified.                                        *
+ *                                                                            *
+ ******************************************************************************/
+static const zbx_vc_chunk_t	*vch_chunk_get_data(const zbx_vc_item_t *item, const zbx_vc_chunk_t *chunk)
+{
+	if (0 == chunk->data_size)
+		return chunk;
 
-		do
-		{
-			chunk->slots[index] = schunk->slots[sindex];
+	return vch_chunk_decode(item, chunk, chunk->slots_num, ZBX_VC_CHUNK_BUF_DATA);
+}
 
-			chunk = schunk;
-			index = sindex;
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets timestamp of the specified chunk value                       *
+ *                                                                            *
+ * Parameters: item  - [IN] the chunk owner item                              *
+ *             chunk - [IN] the chunk                                         *
+ *             index - [IN] the value index                                   *
+ *                                                                            *
+ * Return value: the value timestamp                                          *
+ *                                                                            *
+ * Comments: Compressed chunks are decoded only up to the requested value.    *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_timespec_t	vch_chunk_get_timestamp(const zbx_vc_item_t *item, const zbx_vc_chunk_t *chunk, int index)
+{
+	if (0 == chunk->data_size)
+		return chunk->timestamps[index];
 
-			if (--sindex < schunk->first_value)
-			{
-				if (NULL == (schunk = schunk->prev))
-				{
-					memset(&chunk->slots[index], 0, sizeof(zbx_vc_chunk_t));
-					THIS_SHOULD_NEVER_HAPPEN;
+	return vch_chunk_decode(item, chunk, index + 1, ZBX_VC_CHUNK_BUF_TIMESTAMP)->timestamps[index];
+}
 
-					goto out;
-				}
+/******************************************************************************
+ *                                                                            *
+ * Purpose: replaces chunk in item chunk list                                 *
+ *                                                                            *
+ * Parameters: item  - [IN/OUT] the chunk owner item                          *
+ *             chunk - [IN] the chunk to replace                              *
+ *             dst   - [IN] the new chunk                                     *
+ *                                                                            *
+ ******************************************************************************/
+static void	vch_item_replace_chunk(zbx_vc_item_t *item, zbx_vc_chunk_t *chunk, zbx_vc_chunk_t *dst)
+{
+	dst->prev = chunk->prev;
+	dst->next = chunk->next;
 
-				sindex = schunk->last_value;
-			}
-		}
-		while (0 < zbx_timespec_compare(&schunk->slots[sindex].timestamp, &value->timestamp));
-	}
+	if (NULL != chunk->prev)
+		chunk->prev->next = dst;
 	else
-	{
-		/* find the number of free slots on the right side in last (head) chunk */
-		if (NULL != item->head)
-			nslots = item->head->slots_num - item->head->last_value - 1;
-
-		if (0 == nslots)
-		{
-			if (FAIL == vch_item_add_chunk(item, vch_item_chunk_slot_count(item, 1), NULL))
-				goto out;
-		}
-		else
-			item->head->last_value++;
-
-		item->values_total++;
-
-		chunk = item->head;
-		index = item->head->last_value;
-	}
+		item->tail = dst;
 
-	if (SUCCEED != vch_item_copy_value(item, chunk, index, value))
-		goto out;
+	if (NULL != chunk->next)
+		chunk->next->prev = dst;
+	else
+		item->head = dst;
 
-	ret = SUCCEED;
-out:
-	return ret;
+	LOCK_MEM;
+	__vc_mem_free_func(chunk);
+	UNLOCK_MEM;
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: adds item history values at the beginning of current item's       *
- *          history data                                                      *
- *                                                                            *
- * Parameters:  item   - [IN] the item to add history data to                 *
- *              values - [IN] the item history data values                    *
- *              num    - [IN] the number of history data values to add        *
+ * Purpose: compresses full item data chunk                                   *
  *                                                                            *
- * Return value: SUCCEED - the history data values were added successfully    *
- *               FAIL - failed to add history data values (not enough memory) *
+ * Parameters: item  - [IN/OUT] the chunk owner item                          *
+ *             chunk - [IN] the chunk to compress                             *
  *                                                                            *
- * Comments: In the case of failure the item is removed from cache.           *
- *           Overlapping values (by timestamp seconds) are ignored.           *
+ * Comments: The chunk is left uncompressed if compression is disabled, the   *
+ *           item is not numeric, it is referenced by cursors, compression    *
+ *           does not save space or there is not enough memory - space is not *
+ *           released to compress values.                                     *
  *                                                                            *
  ******************************************************************************/
-static int	vch_item_add_values_at_tail(zbx_vc_item_t *item, const zbx_history_record_t *values, int values_num)
+static void	vch_item_compress_chunk(zbx_vc_item_t *item, zbx_vc_chunk_t *chunk)
 {
-	int 	count = values_num, ret = FAIL;
+	zbx_vc_chunk_t	*dst;
+	int		values_num, data_size;
 
-	/* skip values already added to the item cache by another process */
-	if (NULL != item->tail)
+	if (0 == CONFIG_VALUE_CACHE_COMPRESSION || 0 != chunk->data_size || chunk == item->head ||
+			0 != item->refcount)
 	{
-		int	sec = item->tail->slots[item->tail->first_value].timestamp.sec;
-
-		while (--count >= 0 && values[count].timestamp.sec >= sec)
-			;
-		++count;
+		return;
 	}
 
-	while (0 != count)
-	{
-		int	copy_slots, nslots = 0;
+	if (ITEM_VALUE_TYPE_FLOAT != item->value_type && ITEM_VALUE_TYPE_UINT64 != item->value_type)
+		return;
 
-		/* find the number of free slots on the left side in first (tail) chunk */
-		if (NULL != item->tail)
-			nslots = item->tail->first_value;
+	values_num = chunk->last_value - chunk->first_value + 1;
 
-		if (0 == nslots)
-		{
-			nslots = vch_item_chunk_slot_count(item, count);
+	vc_chunk_encode(item->value_type, chunk->timestamps + chunk->first_value, chunk->values + chunk->first_value,
+			values_num, &vc_chunk_bits);
 
-			if (FAIL == vch_item_add_chunk(item, nslots, item->tail))
-				goto out;
+	data_size = (int)((vc_chunk_bits.bits + 7) >> 3);
 
-			item->tail->last_value = nslots - 1;
-			item->tail->first_value = nslots;
-		}
+	if ((size_t)data_size >= ZBX_VC_CHUNK_SLOT_SIZE * (size_t)chunk->slots_num)
+		return;
 
-		/* copy values to chunk */
-		copy_slots = MIN(nslots, count);
-		count -= copy_slots;
+	LOCK_MEM;
+	dst = (zbx_vc_chunk_t *)__vc_mem_malloc_func(NULL, sizeof(zbx_vc_chunk_t) + (size_t)data_size);
+	UNLOCK_MEM;
 
-		if (FAIL == vch_item_copy_values_at_tail(item, values + count, copy_slots))
-			goto out;
-	}
+	if (NULL == dst)
+		return;
 
-	ret = SUCCEED;
-out:
-	return ret;
+	memcpy(dst + 1, vc_chunk_bits.data, (size_t)data_size);
+	dst->first_value = 0;
+	dst->last_value = values_num - 1;
+	dst->slots_num = values_num;
+	dst->timestamps = NULL;
+	dst->values = NULL;
+	dst->data_size = data_size;
+
+	vch_item_replace_chunk(item, chunk, dst);
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: cache item history data for the specified time period             *
- *                                                                            *
- * Parameters: item        - [IN] the item                                    *
- *             range_start - [IN] the interval start time                     *
+ * Purpose: decompresses item data chunk                                      *
  *                                                                            *
- * Return value:  >=0    - the number of values read from database            *
- *                FAIL   - an error occurred while trying to cache values     *
+ * Parameters: item  - [IN/OUT] the chunk owner item                          *
+ *             chunk - [IN/OUT] the compressed chunk, replaced by the         *
+ *                              decompressed chunk                            *
  *                                                                            *
- * Comments: This function checks if the requested value range is cached and  *
- *           updates cache from database if necessary.                        *
+ * Return value: SUCCEED - the chunk was decompressed                         *
+ *               FAIL    - not enough memory                                  *
  *                                                                            *
  ******************************************************************************/
-static int	vch_item_cache_values_by_time(zbx_vc_item_t **item, int range_start)
+static int	vch_item_inflate_chunk(zbx_vc_item_t *item, zbx_vc_chunk_t **chunk)
 {
-	int				ret, range_end;
-	zbx_vector_history_record_t	records;
-	zbx_uint64_t			itemid;
-	unsigned char			value_type;
-
-	if (ZBX_ITEM_STATUS_CACHED_ALL == (*item)->status)
-		return SUCCEED;
-
-	/* check if the requested period is in the cached range */
-	if (0 != (*item)->db_cached_from && range_start >= (*item)->db_cached_from)
-		return SUCCEED;
+	zbx_vc_chunk_t	*dst;
+	int		nslots = (*chunk)->slots_num;
 
-	/* find if the cache should be updated to cover the required range */
-	if (NULL != (*item)->tail)
+	if (NULL == (dst = (zbx_vc_chunk_t *)vc_item_malloc(item, sizeof(zbx_vc_chunk_t) +
+			ZBX_VC_CHUNK_SLOT_SIZE * (size_t)nslots)))
 	{
-		/* we need to get item values before the first cached value, but not including it */
-		range_end = (*item)->tail->slots[(*item)->tail->first_value].timestamp.sec - 1;
+		return FAIL;
 	}
-	else
-		range_end = ZBX_JAN_2038;
 
-	/* update cache if necessary */
-	if (range_start >= range_end)
-		return SUCCEED;
+	dst->first_value = (*chunk)->first_value;
+	dst->last_value = (*chunk)->last_value;
+	dst->slots_num = nslots;
+	dst->timestamps = (zbx_timespec_t *)(dst + 1);
+	dst->values = (history_value_t *)(dst->timestamps + nslots);
+	dst->data_size = 0;
 
-	zbx_vector_history_record_create(&records);
-	itemid = (*item)->itemid;
-	value_type = (*item)->value_type;
+	vc_chunk_decode(item->value_type, (const unsigned char *)(*chunk + 1), nslots, dst->timestamps, dst->values);
 
-	UNLOCK_CACHE;
+	vch_item_replace_chunk(item, *chunk, dst);
+	*chunk = dst;
 
-	if (SUCCEED == (ret = vc_db_read_values_by_time(itemid, value_type, &records, range_start, range_end)))
-	{
-		zbx_vector_history_record_sort(&records,
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: find the index of the last value in chunk with timestamp less or  *
+ *          equal to the specified timestamp.                                 *
+ *                                                                            *
+ * Parameters:  chunk - [IN] the chunk                                        *
+ *              ts    - [IN] the target timestamp                             *
+ *                                                                            *
+ * Return value: The index of the last value in chunk with timestamp less or  *
+ *               equal to the specified timestamp.                            *
+ *               -1 is returned in the case of failure (meaning that all      *
+ *               values have timestamps greater than the target timestamp).   *
+ *                                                                            *
+ ******************************************************************************/
+static int	vch_chunk_find_last_value_before(const zbx_vc_chunk_t *chunk, const zbx_timespec_t *ts)
+{
+	int	start = chunk->first_value, end = chunk->last_value, middle;
+
+	/* check if the last value timestamp is already greater or equal to the specified timestamp */
+	if (0 >= zbx_timespec_compare(&chunk->timestamps[end], ts))
+		return end;
+
+	/* chunk contains only one value, which did not pass the above check, return failure */
+	if (start == end)
+		return -1;
+
+	/* perform value lookup using binary search */
+	while (start != end)
+	{
+		middle = start + (end - start) / 2;
+
+		if (0 < zbx_timespec_compare(&chunk->timestamps[middle], ts))
+		{
+			end = middle;
+			continue;
+		}
+
+		if (0 >= zbx_timespec_compare(&chunk->timestamps[middle + 1], ts))
+		{
+			start = middle;
+			continue;
+		}
+
+		return middle;
+	}
+
+	return -1;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets the chunk and index of the last value with a timestamp less  *
+ *          or equal to the specified timestamp                               *
+ *                                                                            *
+ * Parameters:  item          - [IN] the item                                 *
+ *              ts            - [IN] the target timestamp                     *
+ *                                   (NULL - current time)                    *
+ *              pchunk        - [OUT] the chunk containing the target value   *
+ *              pindex        - [OUT] the index of the target value           *
+ *                                                                            *
+ * Return value: SUCCEED - the last value was found successfully              *
+ *               FAIL - all values in cache have timestamps greater than the  *
+ *                      target (timeshift) timestamp.                         *
+ *                                                                            *
+ * Comments: If end_timestamp value is 0, then simply the last item value in  *
+ *           cache is returned.                                               *
+ *                                                                            *
+ ******************************************************************************/
+static int	vch_item_get_last_value(const zbx_vc_item_t *item, const zbx_timespec_t *ts, zbx_vc_chunk_t **pchunk,
+		int *pindex)
+{
+	zbx_vc_chunk_t	*chunk = item->head;
+	int		index;
+
+	if (NULL == chunk)
+		return FAIL;
+
+	index = chunk->last_value;
+
+	if (0 < zbx_timespec_compare(&chunk->timestamps[index], ts))
+	{
+		zbx_timespec_t	first_ts = vch_chunk_get_timestamp(item, chunk, chunk->first_value);
+
+		while (0 < zbx_timespec_compare(&first_ts, ts))
+		{
+			chunk = chunk->prev;
+			/* there are no values for requested range, return failure */
+			if (NULL == chunk)
+				return FAIL;
+
+			first_ts = vch_chunk_get_timestamp(item, chunk, chunk->first_value);
+		}
+		index = vch_chunk_find_last_value_before(vch_chunk_get_data(item, chunk), ts);
+	}
+
+	*pchunk = chunk;
+	*pindex = index;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: copies value in the specified item's chunk slot                   *
+ *                                                                            *
+ * Parameters: chunk        - [IN/OUT] the target chunk                       *
+ *             index        - [IN] the target slot                            *
+ *             source_value - [IN] the value to copy                          *
+ *                                                                            *
+ * Return value: SUCCEED - the value was copied successfully                  *
+ *               FAIL    - the value copying failed (not enough space for     *
+ *                         string, text or log type data)                     *
+ *                                                                            *
+ * Comments: This function is used to copy data to cache. The contents of     *
+ *           str, text and log type values are stored in cache string pool.   *
+ *                                                                            *
+ ******************************************************************************/
+static int	vch_item_copy_value(zbx_vc_item_t *item, zbx_vc_chunk_t *chunk, int index,
+		const zbx_history_record_t *source_value)
+{
+	history_value_t	*value;
+	int		ret = FAIL;
+
+	value = &chunk->values[index];
+
+	switch (item->value_type)
+	{
+		case ITEM_VALUE_TYPE_STR:
+		case ITEM_VALUE_TYPE_TEXT:
+			if (NULL == (value->str = vc_item_strdup(item, source_value->value.str)))
+				goto out;
+			break;
+		case ITEM_VALUE_TYPE_LOG:
+			if (NULL == (value->log = vc_item_logdup(item, source_value->value.log)))
+				goto out;
+			break;
+		default:
+			*value = source_value->value;
+	}
+	chunk->timestamps[index] = source_value->timestamp;
+
+	ret = SUCCEED;
+out:
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: copies values at the beginning of item tail chunk                 *
+ *                                                                            *
+ * Parameters: item       - [IN/OUT] the target item                          *
+ *             values     - [IN] the values to copy                           *
+ *             values_num - [IN] the number of values to copy                 *
+ *                                                                            *
+ * Return value: SUCCEED - the values were copied successfully                *
+ *               FAIL    - the value copying failed (not enough space for     *
+ *                         string, text or log type data)                     *
+ *                                                                            *
+ * Comments: This function is used to copy data to cache. The contents of     *
+ *           str, text and log type values are stored in cache string pool.   *
+ *                                                                            *
+ ******************************************************************************/
+static int	vch_item_copy_values_at_tail(zbx_vc_item_t *item, const zbx_history_record_t *values, int values_num)
+{
+	int		i, ret = FAIL, first_value = item->tail->first_value;
+	zbx_vc_chunk_t	*tail = item->tail;
+
+	switch (item->value_type)
+	{
+		case ITEM_VALUE_TYPE_STR:
+		case ITEM_VALUE_TYPE_TEXT:
+			for (i = values_num - 1; i >= 0; i--)
+			{
+				history_value_t	*value = &tail->values[tail->first_value - 1];
+
+				if (NULL == (value->str = vc_item_strdup(item, values[i].value.str)))
+					goto out;
+
+				tail->timestamps[--tail->first_value] = values[i].timestamp;
+			}
+			ret = SUCCEED;
+
+			break;
+		case ITEM_VALUE_TYPE_LOG:
+			for (i = values_num - 1; i >= 0; i--)
+			{
+				history_value_t	*value = &tail->values[tail->first_value - 1];
+
+				if (NULL == (value->log = vc_item_logdup(item, values[i].value.log)))
+					goto out;
+
+				tail->timestamps[--tail->first_value] = values[i].timestamp;
+			}
+			ret = SUCCEED;
+
+			break;
+		default:
+			for (i = values_num - 1; i >= 0; i--)
+			{
+				tail->first_value--;
+				tail->timestamps[tail->first_value] = values[i].timestamp;
+				tail->values[tail->first_value] = values[i].value;
+			}
+			ret = SUCCEED;
+	}
+out:
+	item->values_total += first_value - item->tail->first_value;
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: frees chunk and all resources allocated to store its values       *
+ *                                                                            *
+ * Parameters: item    - [IN] the chunk owner item                            *
+ *             chunk   - [IN] the chunk to free                               *
+ *                                                                            *
+ * Return value: the number of bytes freed                                    *
+ *                                                                            *
+ ******************************************************************************/
+static size_t	vch_item_free_chunk(zbx_vc_item_t *item, zbx_vc_chunk_t *chunk)
+{
+	size_t	freed;
+
+	if (0 != chunk->data_size)
+	{
+		/* compressed chunks hold only numeric values, there is nothing to free in string pool */
+		freed = sizeof(zbx_vc_chunk_t) + (size_t)chunk->data_size;
+	}
+	else
+	{
+		freed = sizeof(zbx_vc_chunk_t) + chunk->slots_num * ZBX_VC_CHUNK_SLOT_SIZE;
+		freed += vc_item_free_values(item, chunk->values, chunk->first_value, chunk->last_value);
+	}
+
+	LOCK_MEM;
+	__vc_mem_free_func(chunk);
+	UNLOCK_MEM;
+
+	return freed;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: removes item history data chunk                                   *
+ *                                                                            *
+ * Parameters: item    - [IN ] the chunk owner item                           *
+ *             chunk   - [IN] the chunk to remove                             *
+ *                                                                            *
+ ******************************************************************************/
+static void	vch_item_remove_chunk(zbx_vc_item_t *item, zbx_vc_chunk_t *chunk)
+{
+	if (NULL != chunk->next)
+		chunk->next->prev = chunk->prev;
+
+	if (NULL != chunk->prev)
+		chunk->prev->next = chunk->next;
+
+	if (chunk == item->head)
+		item->head = chunk->prev;
+
+	if (chunk == item->tail)
+		item->tail = chunk->next;
+
+	vch_item_free_chunk(item, chunk);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: removes item history data that are outside (older) the maximum    *
+ *          request range                                                     *
+ *                                                                            *
+ * Parameters:  item   - [IN] the target item                                 *
+ *                                                                            *
+ ******************************************************************************/
+static void	vch_item_clean_cache(zbx_vc_item_t *item)
+{
+	zbx_vc_chunk_t		*next;
+	const zbx_vc_chunk_t	*data;
+
+	if (0 != item->active_range)
+	{
+		zbx_vc_chunk_t	*tail = item->tail;
+		zbx_vc_chunk_t	*chunk = tail;
+		int		timestamp, last_sec;
+
+		timestamp = time(NULL) - item->active_range;
+
+		/* try to remove chunks with all history values older than maximum request range */
+		while (NULL != chunk && (last_sec = vch_chunk_get_timestamp(item, chunk, chunk->last_value).sec) <
+				timestamp && last_sec != item->head->timestamps[item->head->last_value].sec)
+		{
+			/* don't remove the head chunk */
+			if (NULL == (next = chunk->next))
+				break;
+
+			/* Values with the same timestamps (seconds resolution) always should be either   */
+			/* kept in cache or removed together. There should not be a case when one of them */
+			/* is in cache and the second is dropped.                                         */
+			/* Here we are handling rare case, when the last value of first chunk has the     */
+			/* same timestamp (seconds resolution) as the first value in the second chunk.    */
+			/* In this case increase the first value index of the next chunk until the first  */
+			/* value timestamp is greater.                                                    */
+
+			data = vch_chunk_get_data(item, next);
+
+			if (data->timestamps[next->first_value].sec != data->timestamps[next->last_value].sec)
+			{
+				while (data->timestamps[next->first_value].sec == last_sec)
+				{
+					vc_item_free_values(item, next->values, next->first_value, next->first_value);
+					next->first_value++;
+				}
+			}
+
+			/* set the database cached from timestamp to the last (oldest) removed value timestamp + 1 */
+			item->db_cached_from = last_sec + 1;
+
+			vch_item_remove_chunk(item, chunk);
+
+			chunk = next;
+		}
+
+		/* reset the status flags if data was removed from cache */
+		if (tail != item->tail)
+			item->status = 0;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: removes item history data that are older than the specified       *
+ *          timestamp                                                         *
+ *                                                                            *
+ * Parameters:  item      - [IN] the target item                              *
+ *              timestamp - [IN] the timestamp (number of seconds since the   *
+ *                               Epoch)                                       *
+ *                                                                            *
+ ******************************************************************************/
+static void	vch_item_remove_values(zbx_vc_item_t *item, int timestamp)
+{
+	zbx_vc_chunk_t	*chunk = item->tail;
+
+	if (ZBX_ITEM_STATUS_CACHED_ALL == item->status)
+		item->status = 0;
+
+	/* try to remove chunks with all history values older than the timestamp */
+	while (NULL != chunk && vch_chunk_get_timestamp(item, chunk, chunk->first_value).sec < timestamp)
+	{
+		zbx_vc_chunk_t	*next;
+
+		/* If chunk contains values with timestamp greater or equal - remove */
+		/* only the values with less timestamp. Otherwise remove the while   */
+		/* chunk and check next one.                                         */
+		if (vch_chunk_get_timestamp(item, chunk, chunk->last_value).sec >= timestamp)
+		{
+			const zbx_vc_chunk_t	*data = vch_chunk_get_data(item, chunk);
+
+			while (data->timestamps[chunk->first_value].sec < timestamp)
+			{
+				vc_item_free_values(item, chunk->values, chunk->first_value, chunk->first_value);
+				chunk->first_value++;
+			}
+
+			break;
+		}
+
+		next = chunk->next;
+		vch_item_remove_chunk(item, chunk);
+		chunk = next;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: adds one item history value at the end of current item's history  *
+ *          data                                                              *
+ *                                                                            *
+ * Parameters:  item   - [IN] the item to add history data to                 *
+ *              value  - [IN] the item history data value                     *
+ *                                                                            *
+ * Return value: SUCCEED - the history data value was added successfully      *
+ *               FAIL - failed to add history data value (not enough memory)  *
+ *                                                                            *
+ * Comments: In the case of failure the item will be removed from cache       *
+ *           later.                                                           *
+ *                                                                            *
+ ******************************************************************************/
+static int	vch_item_add_value_at_head(zbx_vc_item_t *item, const zbx_history_record_t *value)
+{
+	int		ret = FAIL, index, sindex, nslots = 0;
+	zbx_vc_chunk_t	*chunk, *schunk, *sealed = NULL;
+
+	if (NULL != item->head &&
+			0 < zbx_timespec_compare(&item->head->timestamps[item->head->last_value], &value->timestamp))
+	{
+		zbx_timespec_t	first_ts = vch_chunk_get_timestamp(item, item->tail, item->tail->first_value);
+
+		if (0 < zbx_timespec_compare(&first_ts, &value->timestamp))
+		{
+			/* If the added value has the same or older timestamp as the first value in cache */
+			/* we can't add it to keep cache consistency. Additionally we must make sure no   */
+			/* values with matching timestamp seconds are kept in cache.                      */
+			vch_item_remove_values(item, value->timestamp.sec + 1);
+
+			/* empty items must be removed to avoid situation when a new value is added to cache */
+			/* while other values with matching timestamp seconds are not cached                 */
+			if (NULL == item->head)
+				goto out;
+
+			/* if the value is newer than the database cached from timestamp we must */
+			/* adjust the cached from timestamp to exclude this value                */
+			if (item->db_cached_from <= value->timestamp.sec)
+				item->db_cached_from = value->timestamp.sec + 1;
+
+			ret = SUCCEED;
+			goto out;
+		}
+
+		sindex = item->head->last_value;
+		schunk = item->head;
+
+		if (0 == item->head->slots_num - item->head->last_value - 1)
+		{
+			if (FAIL == vch_item_add_chunk(item, vch_item_chunk_slot_count(item, 1), NULL))
+				goto out;
+
+			sealed = schunk;
+		}
+		else
+			item->head->last_value++;
+
+		item->values_total++;
+
+		chunk = item->head;
+		index = item->head->last_value;
+
+		do
+		{
+			chunk->timestamps[index] = schunk->timestamps[sindex];
+			chunk->values[index] = schunk->values[sindex];
+
+			chunk = schunk;
+			index = sindex;
+
+			if (--sindex < schunk->first_value)
+			{
+				if (NULL == (schunk = schunk->prev))
+				{
+					memset(&chunk->timestamps[index], 0, sizeof(zbx_timespec_t));
+					memset(&chunk->values[index], 0, sizeof(history_value_t));
+					THIS_SHOULD_NEVER_HAPPEN;
+
+					goto out;
+				}
+
+				/* the values are moved through compressed chunks after decompressing them */
+				if (0 != schunk->data_size && SUCCEED != vch_item_inflate_chunk(item, &schunk))
+					goto out;
+
+				sindex = schunk->last_value;
+			}
+		}
+		while (0 < zbx_timespec_compare(&schunk->timestamps[sindex], &value->timestamp));
+	}
+	else
+	{
+		/* find the number of free slots on the right side in last (head) chunk */
+		if (NULL != item->head)
+			nslots = item->head->slots_num - item->head->last_value - 1;
+
+		if (0 == nslots)
+		{
+			sealed = item->head;
+
+			if (FAIL == vch_item_add_chunk(item, vch_item_chunk_slot_count(item, 1), NULL))
+				goto out;
+		}
+		else
+			item->head->last_value++;
+
+		item->values_total++;
+
+		chunk = item->head;
+		index = item->head->last_value;
+	}
+
+	if (SUCCEED != vch_item_copy_value(item, chunk, index, value))
+		goto out;
+
+	/* the previous head chunk is full and will not receive new values */
+	if (NULL != sealed)
+		vch_item_compress_chunk(item, sealed);
+
+	ret = SUCCEED;
+out:
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: adds item history values at the beginning of current item's       *
+ *          history data                                                      *
+ *                                                                            *
+ * Parameters:  item   - [IN] the item to add history data to                 *
+ *              values - [IN] the item history data values                    *
+ *              num    - [IN] the number of history data values to add        *
+ *                                                                            *
+ * Return value: SUCCEED - the history data values were added successfully    *
+ *               FAIL - failed to add history data values (not enough memory) *
+ *                                                                            *
+ * Comments: In the case of failure the item is removed from cache.           *
+ *           Overlapping values (by timestamp seconds) are ignored.           *
+ *                                                                            *
+ ******************************************************************************/
+static int	vch_item_add_values_at_tail(zbx_vc_item_t *item, const zbx_history_record_t *values, int values_num)
+{
+	int 	count = values_num, ret = FAIL;
+
+	/* skip values already added to the item cache by another process */
+	if (NULL != item->tail)
+	{
+		int	sec = vch_chunk_get_timestamp(item, item->tail, item->tail->first_value).sec;
+
+		while (--count >= 0 && values[count].timestamp.sec >= sec)
+			;
+		++count;
+	}
+
+	while (0 != count)
+	{
+		int		copy_slots, nslots = 0;
+		zbx_vc_chunk_t	*sealed = item->tail;
+
+		/* find the number of free slots on the left side in first (tail) chunk, */
+		/* values cannot be added to compressed chunk                           */
+		if (NULL != item->tail && 0 == item->tail->data_size)
+			nslots = item->tail->first_value;
+
+		if (0 == nslots)
+		{
+			nslots = vch_item_chunk_slot_count(item, count);
+
+			if (FAIL == vch_item_add_chunk(item, nslots, item->tail))
+				goto out;
+
+			item->tail->last_value = nslots - 1;
+			item->tail->first_value = nslots;
+
+			/* the previous tail chunk is full and will not receive older values */
+			if (NULL != sealed)
+				vch_item_compress_chunk(item, sealed);
+		}
+
+		/* copy values to chunk */
+		copy_slots = MIN(nslots, count);
+		count -= copy_slots;
+
+		if (FAIL == vch_item_copy_values_at_tail(item, values + count, copy_slots))
+			goto out;
+	}
+
+	ret = SUCCEED;
+out:
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: cache item history data for the specified time period             *
+ *                                                                            *
+ * Parameters: item        - [IN] the item                                    *
+ *             range_start - [IN] the interval start time                     *
+ *                                                                            *
+ * Return value:  >=0    - the number of values read from database            *
+ *                FAIL   - an error occurred while trying to cache values     *
+ *                                                                            *
+ * Comments: This function checks if the requested value range is cached and  *
+ *           updates cache from database if necessary.                        *
+ *                                                                            *
+ ******************************************************************************/
+static int	vch_item_cache_values_by_time(zbx_vc_item_t **item, int range_start)
+{
+	int				ret, range_end;
+	zbx_vector_history_record_t	records;
+	zbx_uint64_t			itemid;
+	unsigned char			value_type;
+
+	if (ZBX_ITEM_STATUS_CACHED_ALL == (*item)->status)
+		return SUCCEED;
+
+	/* check if the requested period is in the cached range */
+	if (0 != (*item)->db_cached_from && range_start >= (*item)->db_cached_from)
+		return SUCCEED;
+
+	/* find if the cache should be updated to cover the required range */
+	if (NULL != (*item)->tail)
+	{
+		/* we need to get item values before the first cached value, but not including it */
+		range_end = vch_chunk_get_timestamp(*item, (*item)->tail, (*item)->tail->first_value).sec - 1;
+	}
+	else
+		range_end = ZBX_JAN_2038;
+
+	/* update cache if necessary */
+	if (range_start >= range_end)
+		return SUCCEED;
+
+	zbx_vector_history_record_create(&records);
+	itemid = (*item)->itemid;
+	value_type = (*item)->value_type;
+
+	UNLOCK_CACHE;
+
+	if (SUCCEED == (ret = vc_db_read_values_by_time(itemid, value_type, &records, range_start, range_end)))
+	{
+		zbx_vector_history_record_sort(&records,
+				(zbx_compare_func_t)zbx_history_record_compare_asc_func);
+	}
+
+	WRLOCK_CACHE;
+
+	if (SUCCEED != ret)
+		goto out;
+
+	if (NULL == (*item = (zbx_vc_item_t *)zbx_hashset_search(&vc_cache->items, &itemid)))
+	{
+		zbx_vc_item_t	new_item = {.itemid = itemid, .value_type = value_type};
+
+		if (NULL == (*item = (zbx_vc_item_t *)zbx_hashset_insert(&vc_cache->items, &new_item, sizeof(new_item))))
+		{
+			ret = FAIL;
+			goto out;
+		}
+	}
+	else if (0 != ((*item)->state & ZBX_ITEM_STATE_REMOVE_PENDING))
+	{
+		/* the item was removed while reading values from database, but is still referenced by cursors */
+		ret = FAIL;
+		goto out;
+	}
+
+	/* when updating cache with time based request we can always reset status flags */
+	/* flag even if the requested period contains no data                           */
+	(*item)->status = 0;
+
+	if (0 < records.values_num)
+	{
+		if (SUCCEED != (ret = vch_item_add_values_at_tail(*item, records.values, records.values_num)))
+			goto out;
+	}
+
+	ret = records.values_num;
+	vc_item_update_db_cached_from(*item, range_start);
+out:
+	zbx_history_record_vector_destroy(&records, value_type);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: cache the specified number of history data values for time period *
+ *          since timestamp                                                   *
+ *                                                                            *
+ * Parameters: item        - [IN] the item                                    *
+ *             range_start - [IN] the interval start time                     *
+ *             count       - [IN] the number of history values to retrieve    *
+ *             ts          - [IN] the target timestamp                        *
+ *                                                                            *
+ * Return value:  >=0    - the number of values read from database            *
+ *                FAIL   - an error occurred while trying to cache values     *
+ *                                                                            *
+ * Comments: This function checks if the requested number of values is cached *
+ *           and updates cache from database if necessary.                    *
+ *                                                                            *
+ ******************************************************************************/
+static int	vch_item_cache_values_by_time_and_count(zbx_vc_item_t **item, int range_start, int count,
+		const zbx_timespec_t *ts)
+{
+	int				ret = SUCCEED, cached_records = 0, range_end, records_offset;
+	zbx_vector_history_record_t	records;
+	zbx_uint64_t			itemid;
+	unsigned char			value_type;
+
+	if (ZBX_ITEM_STATUS_CACHED_ALL == (*item)->status)
+		return SUCCEED;
+
+	/* check if the requested period is in the cached range */
+	if (0 != (*item)->db_cached_from && range_start >= (*item)->db_cached_from)
+		return SUCCEED;
+
+	/* find if the cache should be updated to cover the required count */
+	if (NULL != (*item)->head)
+	{
+		zbx_vc_chunk_t	*chunk;
+		int		index;
+
+		if (SUCCEED == vch_item_get_last_value(*item, ts, &chunk, &index))
+		{
+			cached_records = index - chunk->first_value + 1;
+
+			while (NULL != (chunk = chunk->prev) && cached_records < count)
+				cached_records += chunk->last_value - chunk->first_value + 1;
+		}
+	}
+
+	/* update cache if necessary */
+	if (cached_records >= count)
+		return SUCCEED;
+
+	/* get the end timestamp to which (including) the values should be cached */
+	if (NULL != (*item)->head)
+		range_end = vch_chunk_get_timestamp(*item, (*item)->tail, (*item)->tail->first_value).sec - 1;
+	else
+		range_end = ZBX_JAN_2038;
+
+	itemid = (*item)->itemid;
+	value_type = (*item)->value_type;
+	UNLOCK_CACHE;
+
+	zbx_vector_history_record_create(&records);
+
+	if (range_end > ts->sec)
+	{
+		ret = vc_db_read_values_by_time(itemid, value_type, &records, ts->sec + 1, range_end);
+		range_end = ts->sec;
+	}
+
+	records_offset = records.values_num;
+
+	if (SUCCEED == ret && SUCCEED == (ret = vc_db_read_values_by_time_and_count(itemid, value_type, &records,
+			range_start, count - cached_records, range_end, ts)))
+	{
+		zbx_vector_history_record_sort(&records,
 				(zbx_compare_func_t)zbx_history_record_compare_asc_func);
 	}
 
-	WRLOCK_CACHE;
+	WRLOCK_CACHE;
+
+	if (SUCCEED != ret)
+		goto out;
+
+	if (NULL == (*item = (zbx_vc_item_t *)zbx_hashset_search(&vc_cache->items, &itemid)))
+	{
+		zbx_vc_item_t	new_item = {.itemid = itemid, .value_type = value_type};
+
+		if (NULL == (*item = (zbx_vc_item_t *)zbx_hashset_insert(&vc_cache->items, &new_item, sizeof(new_item))))
+		{
+			ret = FAIL;
+			goto out;
+		}
+	}
+	else if (0 != ((*item)->state & ZBX_ITEM_STATE_REMOVE_PENDING))
+	{
+		/* the item was removed while reading values from database, but is still referenced by cursors */
+		ret = FAIL;
+		goto out;
+	}
+
+	if (0 < records.values_num)
+		ret = vch_item_add_values_at_tail(*item, records.values, records.values_num);
+
+	if (SUCCEED != ret)
+		goto out;
+
+	ret = records.values_num;
+
+	if (0 == range_start && count - cached_records > records.values_num - records_offset)
+	{
+		(*item)->active_range = 0;
+		(*item)->daily_range = 0;
+		(*item)->status = ZBX_ITEM_STATUS_CACHED_ALL;
+	}
+
+	if ((count <= records.values_num || 0 == range_start) && 0 != records.values_num)
+	{
+		vc_item_update_db_cached_from(*item,
+				vch_chunk_get_timestamp(*item, (*item)->tail, (*item)->tail->first_value).sec);
+	}
+	else if (0 != range_start)
+		vc_item_update_db_cached_from(*item, range_start);
+
+out:
+	zbx_history_record_vector_destroy(&records, value_type);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: retrieves item history data from cache                            *
+ *                                                                            *
+ * Parameters: item      - [IN] the item                                      *
+ *             values    - [OUT] the item history data stored time/value      *
+ *                         pairs in undefined order                           *
+ *             seconds   - [IN] the time period to retrieve data for          *
+ *             ts        - [IN] the requested period end timestamp            *
+ *                                                                            *
+ ******************************************************************************/
+static void	vch_item_get_values_by_time(const zbx_vc_item_t *item, zbx_vector_history_record_t *values, int seconds,
+		const zbx_timespec_t *ts)
+{
+	int		index, now;
+	zbx_timespec_t	start = {ts->sec - seconds, ts->ns};
+	zbx_vc_chunk_t	*chunk;
+
+	now = time(NULL);
+	/* add another second to include nanosecond shifts */
+	vc_cache_item_update(item->itemid, ZBX_VC_UPDATE_RANGE, seconds + now - ts->sec + 1, now);
+
+	if (FAIL == vch_item_get_last_value(item, ts, &chunk, &index))
+	{
+		/* Cache does not contain records for the specified timeshift & seconds range. */
+		/* Return empty vector with success.                                           */
+		return;
+	}
+
+	/* fill the values vector with item history values until the start timestamp is reached */
+	while (1)
+	{
+		const zbx_vc_chunk_t	*data = vch_chunk_get_data(item, chunk);
+
+		if (0 >= zbx_timespec_compare(&data->timestamps[chunk->last_value], &start))
+			break;
+
+		while (index >= chunk->first_value && 0 < zbx_timespec_compare(&data->timestamps[index], &start))
+			vc_history_record_vector_append(values, item->value_type, data, index--);
+
+		if (NULL == (chunk = chunk->prev))
+			break;
+
+		index = chunk->last_value;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: retrieves item history data from cache                            *
+ *                                                                            *
+ * Parameters: item      - [IN] the item                                      *
+ *             values    - [OUT] the item history data stored time/value      *
+ *                         pairs in undefined order, optional                 *
+ *                         If null then cache is updated if necessary, but no *
+ *                         values are returned. Used to ensure that cache     *
+ *                         contains a value of the specified timestamp.       *
+ *             seconds   - [IN] the time period                               *
+ *             count     - [IN] the number of history values to retrieve      *
+ *             timestamp - [IN] the target timestamp                          *
+ *                                                                            *
+ ******************************************************************************/
+static void	vch_item_get_values_by_time_and_count(zbx_vc_item_t *item, zbx_vector_history_record_t *values,
+		int seconds, int count, const zbx_timespec_t *ts)
+{
+	int		index, now, range_timestamp;
+	zbx_vc_chunk_t	*chunk;
+	zbx_timespec_t	start;
+
+	/* set start timestamp of the requested time period */
+	if (0 != seconds)
+	{
+		start.sec = ts->sec - seconds;
+		start.ns = ts->ns;
+	}
+	else
+	{
+		start.sec = 0;
+		start.ns = 0;
+	}
+
+	if (FAIL == vch_item_get_last_value(item, ts, &chunk, &index))
+	{
+		/* return empty vector with success */
+		goto out;
+	}
+
+	/* fill the values vector with item history values until the <count> values are read    */
+	/* or no more values within specified time period                                       */
+	/* fill the values vector with item history values until the start timestamp is reached */
+	while (1)
+	{
+		const zbx_vc_chunk_t	*data = vch_chunk_get_data(item, chunk);
+
+		if (0 >= zbx_timespec_compare(&data->timestamps[chunk->last_value], &start))
+			break;
+
+		while (index >= chunk->first_value && 0 < zbx_timespec_compare(&data->timestamps[index], &start))
+		{
+			vc_history_record_vector_append(values, item->value_type, data, index--);
+
+			if (values->values_num == count)
+				goto out;
+		}
+
+		if (NULL == (chunk = chunk->prev))
+			break;
+
+		index = chunk->last_value;
+	}
+out:
+	if (count > values->values_num)
+	{
+		if (0 == seconds)
+			return;
+
+		/* set the range equal to the period plus one second to include nanosecond shifts */
+		range_timestamp = ts->sec - seconds;
+	}
+	else
+	{
+		/* the requested number of values was retrieved, set the range to the oldest value timestamp */
+		range_timestamp = values->values[values->values_num - 1].timestamp.sec - 1;
+	}
+
+	now = time(NULL);
+	vc_cache_item_update(item->itemid, ZBX_VC_UPDATE_RANGE, now - range_timestamp, now);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get item values for the specified range                           *
+ *                                                                            *
+ * Parameters: item      - [IN] the item                                      *
+ *             values    - [OUT] the item history data stored time/value      *
+ *                         pairs in undefined order, optional                 *
+ *                         If null then cache is updated if necessary, but no *
+ *                         values are returned. Used to ensure that cache     *
+ *                         contains a value of the specified timestamp.       *
+ *             seconds   - [IN] the time period to retrieve data for          *
+ *             count     - [IN] the number of history values to retrieve      *
+ *             ts        - [IN] the target timestamp                          *
+ *                                                                            *
+ * Return value:  SUCCEED - the item history data was retrieved successfully  *
+ *                FAIL    - the item history data was not retrieved           *
+ *                                                                            *
+ * Comments: This function returns data from cache if necessary updating it   *
+ *           from DB. If cache update was required and failed (not enough     *
+ *           memory to cache DB values), then this function also fails.       *
+ *                                                                            *
+ *           If <count> is set then value range is defined as <count> values  *
+ *           before <timestamp>. Otherwise the range is defined as <seconds>  *
+ *           seconds before <timestamp>.                                      *
+ *                                                                            *
+ ******************************************************************************/
+static int	vch_item_get_values(zbx_vc_item_t *item, zbx_vector_history_record_t *values, int seconds,
+		int count, const zbx_timespec_t *ts)
+{
+	int	ret, records_read, hits, misses, range_start;
+
+	zbx_vector_history_record_clear(values);
+
+	if (0 == count)
+	{
+		if (0 > (range_start = ts->sec - seconds))
+			range_start = 0;
+
+		if (FAIL == (ret = vch_item_cache_values_by_time(&item, range_start)))
+			goto out;
+
+		records_read = ret;
+
+		vch_item_get_values_by_time(item, values, seconds, ts);
+
+		if (records_read > values->values_num)
+			records_read = values->values_num;
+	}
+	else
+	{
+		range_start = (0 == seconds ? 0 : ts->sec - seconds);
+
+		if (FAIL == (ret = vch_item_cache_values_by_time_and_count(&item, range_start, count, ts)))
+			goto out;
+
+		records_read = ret;
+
+		vch_item_get_values_by_time_and_count(item, values, seconds, count, ts);
+
+		if (records_read > values->values_num)
+			records_read = values->values_num;
+	}
+
+	hits = values->values_num - records_read;
+	misses = records_read;
+
+	vc_cache_item_update(item->itemid, ZBX_VC_UPDATE_STATS, hits, misses);
+
+	ret = SUCCEED;
+out:
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: finds the oldest chunk value with timestamp greater than the      *
+ *          specified timestamp                                               *
+ *                                                                            *
+ * Parameters: chunk - [IN] the chunk                                         *
+ *             last  - [IN] the index of the newest value to check            *
+ *             start - [IN] the timestamp                                     *
+ *                                                                            *
+ * Return value: the index of the found value or last + 1 if all values up to *
+ *               the last are older or equal to the specified timestamp       *
+ *                                                                            *
+ ******************************************************************************/
+static int	vch_chunk_find_first_value_after(const zbx_vc_chunk_t *chunk, int last, const zbx_timespec_t *start)
+{
+	int	first = chunk->first_value, end = last + 1, middle;
+
+	if (0 < zbx_timespec_compare(&chunk->timestamps[first], start))
+		return first;
+
+	/* timestamps[first] <= start < timestamps[end] (end being virtual upper bound) */
+	while (1 < end - first)
+	{
+		middle = first + (end - first) / 2;
+
+		if (0 < zbx_timespec_compare(&chunk->timestamps[middle], start))
+			end = middle;
+		else
+			first = middle;
+	}
+
+	return end;
+}
+
+/* the callback processing a range of chunk values, called from the newest to the oldest range - */
+/* compressed chunks are passed decoded, see vch_chunk_get_data()                               */
+typedef void (*vc_range_func_t)(const zbx_vc_item_t *item, const zbx_vc_chunk_t *chunk, int first, int last,
+		void *data);
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: walks cached item values for the specified time period            *
+ *                                                                            *
+ * Parameters: item      - [IN] the item                                      *
+ *             seconds   - [IN] the time period                               *
+ *             ts        - [IN] the requested period end timestamp            *
+ *             func      - [IN] the callback processing value ranges          *
+ *             data      - [IN] the callback data                             *
+ *                                                                            *
+ * Return value: the number of walked values                                  *
+ *                                                                            *
+ * Comments: This function walks the same values as                           *
+ *           vch_item_get_values_by_time(), but passes chunk value ranges to  *
+ *           the callback instead of copying values to a vector.              *
+ *                                                                            *
+ ******************************************************************************/
+static int	vch_item_walk_by_time(const zbx_vc_item_t *item, int seconds, const zbx_timespec_t *ts,
+		vc_range_func_t func, void *data)
+{
+	int		index, first, now, values_num = 0;
+	zbx_timespec_t	start = {ts->sec - seconds, ts->ns};
+	zbx_vc_chunk_t	*chunk;
+
+	now = time(NULL);
+	/* add another second to include nanosecond shifts */
+	vc_cache_item_update(item->itemid, ZBX_VC_UPDATE_RANGE, seconds + now - ts->sec + 1, now);
+
+	if (FAIL == vch_item_get_last_value(item, ts, &chunk, &index))
+		return 0;
+
+	while (1)
+	{
+		const zbx_vc_chunk_t	*chunk_data = vch_chunk_get_data(item, chunk);
+
+		if (index < (first = vch_chunk_find_first_value_after(chunk_data, index, &start)))
+			break;
+
+		func(item, chunk_data, first, index, data);
+		values_num += index - first + 1;
+
+		/* the start timestamp was reached inside chunk */
+		if (first != chunk->first_value || NULL == (chunk = chunk->prev))
+			break;
+
+		index = chunk->last_value;
+	}
+
+	return values_num;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: walks cached item values for the specified time period and number *
+ *          of values                                                         *
+ *                                                                            *
+ * Parameters: item      - [IN] the item                                      *
+ *             seconds   - [IN] the time period                               *
+ *             count     - [IN] the number of values                          *
+ *             ts        - [IN] the target timestamp                          *
+ *             func      - [IN] the callback processing value ranges          *
+ *             data      - [IN] the callback data                             *
+ *                                                                            *
+ * Return value: the number of walked values                                  *
+ *                                                                            *
+ * Comments: This function walks the same values as                           *
+ *           vch_item_get_values_by_time_and_count(), but passes chunk value  *
+ *           ranges to the callback instead of copying values to a vector.    *
+ *                                                                            *
+ ******************************************************************************/
+static int	vch_item_walk_by_time_and_count(zbx_vc_item_t *item, int seconds, int count,
+		const zbx_timespec_t *ts, vc_range_func_t func, void *data)
+{
+	int		index, first, now, range_timestamp, oldest_sec = 0, values_num = 0;
+	zbx_vc_chunk_t	*chunk;
+	zbx_timespec_t	start = {0, 0};
+
+	/* set start timestamp of the requested time period */
+	if (0 != seconds)
+	{
+		start.sec = ts->sec - seconds;
+		start.ns = ts->ns;
+	}
+
+	if (FAIL == vch_item_get_last_value(item, ts, &chunk, &index))
+		goto out;
+
+	while (1)
+	{
+		const zbx_vc_chunk_t	*chunk_data = vch_chunk_get_data(item, chunk);
+
+		if (index < (first = vch_chunk_find_first_value_after(chunk_data, index, &start)))
+			break;
+
+		if (index - first + 1 > count - values_num)
+			first = index - (count - values_num) + 1;
+
+		func(item, chunk_data, first, index, data);
+		values_num += index - first + 1;
+		oldest_sec = chunk_data->timestamps[first].sec;
+
+		if (values_num == count || first != chunk->first_value || NULL == (chunk = chunk->prev))
+			break;
+
+		index = chunk->last_value;
+	}
+out:
+	if (count > values_num)
+	{
+		if (0 == seconds)
+			return values_num;
+
+		/* set the range equal to the period plus one second to include nanosecond shifts */
+		range_timestamp = ts->sec - seconds;
+	}
+	else
+	{
+		/* the requested number of values was walked, set the range to the oldest value timestamp */
+		range_timestamp = oldest_sec - 1;
+	}
+
+	now = time(NULL);
+	vc_cache_item_update(item->itemid, ZBX_VC_UPDATE_RANGE, now - range_timestamp, now);
+
+	return values_num;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: walks item values for the specified range                         *
+ *                                                                            *
+ * Parameters: item      - [IN/OUT] the item, updated if item was added to    *
+ *                                  cache when caching values                 *
+ *             seconds   - [IN] the time period to retrieve data for          *
+ *             count     - [IN] the number of history values to retrieve      *
+ *             ts        - [IN] the target timestamp                          *
+ *             func      - [IN] the callback processing value ranges          *
+ *             data      - [IN] the callback data                             *
+ *                                                                            *
+ * Return value:  SUCCEED - the item values were walked successfully          *
+ *                FAIL    - the item history data was not cached              *
+ *                                                                            *
+ * Comments: The range is defined in the same way as in vch_item_get_values() *
+ *           and the cache is updated from DB if necessary.                   *
+ *                                                                            *
+ ******************************************************************************/
+static int	vch_item_walk_values(zbx_vc_item_t **item, int seconds, int count, const zbx_timespec_t *ts,
+		vc_range_func_t func, void *data)
+{
+	int	ret, records_read, range_start, values_num;
+
+	if (0 == count)
+	{
+		if (0 > (range_start = ts->sec - seconds))
+			range_start = 0;
+
+		if (FAIL == (ret = vch_item_cache_values_by_time(item, range_start)))
+			goto out;
+
+		records_read = ret;
+
+		values_num = vch_item_walk_by_time(*item, seconds, ts, func, data);
+	}
+	else
+	{
+		range_start = (0 == seconds ? 0 : ts->sec - seconds);
+
+		if (FAIL == (ret = vch_item_cache_values_by_time_and_count(item, range_start, count, ts)))
+			goto out;
+
+		records_read = ret;
+
+		values_num = vch_item_walk_by_time_and_count(*item, seconds, count, ts, func, data);
+	}
+
+	if (records_read > values_num)
+		records_read = values_num;
+
+	vc_cache_item_update((*item)->itemid, ZBX_VC_UPDATE_STATS, values_num - records_read, records_read);
+
+	ret = SUCCEED;
+out:
+	return ret;
+}
+
+/* the values gathered for ZBX_VC_AGGR_PERCENTILE during zbx_vc_get_aggregate() call */
+static history_value_t	*vc_aggr_values = NULL;
+static int		vc_aggr_values_alloc = 0;
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: adds a range of chunk values to the aggregates                    *
+ *                                                                            *
+ * Parameters: item  - [IN] the item                                          *
+ *             chunk - [IN] the chunk                                         *
+ *             first - [IN] the index of the first (oldest) value of range    *
+ *             last  - [IN] the index of the last (newest) value of range     *
+ *             data  - [IN/OUT] the aggregates (zbx_vc_aggr_t)                *
+ *                                                                            *
+ * Comments: The history_value_t union is 8 bytes wide, so float and unsigned *
+ *           chunk values form plain double and zbx_uint64_t arrays.          *
+ *                                                                            *
+ ******************************************************************************/
+static void	vc_aggr_add_range(const zbx_vc_item_t *item, const zbx_vc_chunk_t *chunk, int first, int last,
+		void *data)
+{
+	zbx_vc_aggr_t			*aggr = (zbx_vc_aggr_t *)data;
+	const zbx_vc_aggr_kernels_t	*kernels = zbx_vc_aggr_get_kernels();
+	int				values_num = last - first + 1;
+
+	if (ITEM_VALUE_TYPE_FLOAT == item->value_type)
+	{
+		const double	*dbl = (const double *)&chunk->values[first];
+		double		min, max;
 
-	if (SUCCEED != ret)
-		goto out;
+		if (0 != (aggr->flags & (ZBX_VC_AGGR_SUM | ZBX_VC_AGGR_AVG)))
+		{
+			aggr->sum.dbl += kernels->sum_dbl(dbl, values_num);
+			aggr->sum_dbl = aggr->sum.dbl;
+		}
 
-	if (NULL == (*item = (zbx_vc_item_t *)zbx_hashset_search(&vc_cache->items, &itemid)))
+		if (0 != (aggr->flags & (ZBX_VC_AGGR_MIN | ZBX_VC_AGGR_MAX)))
+		{
+			kernels->minmax_dbl(dbl, values_num, &min, &max);
+
+			if (0 == aggr->values_num || min < aggr->min.dbl)
+				aggr->min.dbl = min;
+
+			if (0 == aggr->values_num || max > aggr->max.dbl)
+				aggr->max.dbl = max;
+		}
+
+		if (0 != (aggr->flags & ZBX_VC_AGGR_COUNT))
+			aggr->count += kernels->count_dbl(dbl, values_num, aggr->op, aggr->pattern.dbl);
+	}
+	else
 	{
-		zbx_vc_item_t	new_item = {.itemid = itemid, .value_type = value_type};
+		const zbx_uint64_t	*ui64 = (const zbx_uint64_t *)&chunk->values[first];
+		zbx_uint64_t		min, max;
 
-		if (NULL == (*item = (zbx_vc_item_t *)zbx_hashset_insert(&vc_cache->items, &new_item, sizeof(new_item))))
+		if (0 != (aggr->flags & ZBX_VC_AGGR_SUM))
+			aggr->sum.ui64 += kernels->sum_ui64(ui64, values_num);
+
+		if (0 != (aggr->flags & ZBX_VC_AGGR_AVG))
+			aggr->sum_dbl += kernels->sum_ui64_dbl(ui64, values_num);
+
+		if (0 != (aggr->flags & (ZBX_VC_AGGR_MIN | ZBX_VC_AGGR_MAX)))
 		{
-			ret = FAIL;
-			goto out;
+			kernels->minmax_ui64(ui64, values_num, &min, &max);
+
+			if (0 == aggr->values_num || min < aggr->min.ui64)
+				aggr->min.ui64 = min;
+
+			if (0 == aggr->values_num || max > aggr->max.ui64)
+				aggr->max.ui64 = max;
 		}
-	}
 
-	/* when updating cache with time based request we can always reset status flags */
-	/* flag even if the requested period contains no data                           */
-	(*item)->status = 0;
+		if (0 != (aggr->flags & ZBX_VC_AGGR_COUNT))
+		{
+			aggr->count += kernels->count_ui64(ui64, values_num, aggr->op, aggr->pattern.ui64,
+					aggr->mask);
+		}
+	}
 
-	if (0 < records.values_num)
+	/* the percentile is selected from the gathered values after the cache is unlocked */
+	if (0 != (aggr->flags & ZBX_VC_AGGR_PERCENTILE))
 	{
-		if (SUCCEED != (ret = vch_item_add_values_at_tail(*item, records.values, records.values_num)))
-			goto out;
+		if (aggr->values_num + values_num > vc_aggr_values_alloc)
+		{
+			if (0 == vc_aggr_values_alloc)
+				vc_aggr_values_alloc = (int)ZBX_VC_MAX_CHUNK_RECORDS;
+
+			while (aggr->values_num + values_num > vc_aggr_values_alloc)
+				vc_aggr_values_alloc *= 2;
+
+			vc_aggr_values = (history_value_t *)zbx_realloc(vc_aggr_values,
+					sizeof(history_value_t) * (size_t)vc_aggr_values_alloc);
+		}
+
+		memcpy(vc_aggr_values + aggr->values_num, &chunk->values[first],
+				sizeof(history_value_t) * (size_t)values_num);
 	}
 
-	ret = records.values_num;
-	vc_item_update_db_cached_from(*item, range_start);
-out:
-	zbx_history_record_vector_destroy(&records, value_type);
+	aggr->values_num += values_num;
+}
 
-	return ret;
+/******************************************************************************
+ *                                                                            *
+ * Purpose: adds a range of chunk values to value cursor                      *
+ *                                                                            *
+ * Parameters: item  - [IN] the item                                          *
+ *             chunk - [IN] the chunk                                         *
+ *             first - [IN] the index of the first (oldest) value of range    *
+ *             last  - [IN] the index of the last (newest) value of range     *
+ *             data  - [IN/OUT] the value cursor (zbx_vc_cursor_t)            *
+ *                                                                            *
+ ******************************************************************************/
+static void	vc_cursor_add_range(const zbx_vc_item_t *item, const zbx_vc_chunk_t *chunk, int first, int last,
+		void *data)
+{
+	zbx_vc_cursor_t	*cursor = (zbx_vc_cursor_t *)data;
+	zbx_vc_range_t	range = {&chunk->timestamps[first], &chunk->values[first], last - first + 1, NULL};
+
+	ZBX_UNUSED(item);
+
+	/* the decoded values of compressed chunk are valid only while processing the range, copy them */
+	if (0 != chunk->data_size)
+	{
+		size_t	timestamps_size = sizeof(zbx_timespec_t) * (size_t)range.values_num;
+
+		range.data = zbx_malloc(NULL, timestamps_size + sizeof(history_value_t) * (size_t)range.values_num);
+		memcpy(range.data, range.timestamps, timestamps_size);
+		memcpy((char *)range.data + timestamps_size, range.values,
+				sizeof(history_value_t) * (size_t)range.values_num);
+
+		range.timestamps = (const zbx_timespec_t *)range.data;
+		range.values = (const history_value_t *)((char *)range.data + timestamps_size);
+	}
+
+	zbx_vector_vc_range_append(&cursor->ranges, range);
+	cursor->values_num += range.values_num;
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: cache the specified number of history data values for time period *
- *          since timestamp                                                   *
+ * Purpose: frees resources allocated for item history data                   *
  *                                                                            *
- * Parameters: item        - [IN] the item                                    *
- *             range_start - [IN] the interval start time                     *
- *             count       - [IN] the number of history values to retrieve    *
- *             ts          - [IN] the target timestamp                        *
+ * Parameters: item    - [IN] the item                                        *
  *                                                                            *
- * Return value:  >=0    - the number of values read from database            *
- *                FAIL   - an error occurred while trying to cache values     *
+ * Return value: the size of freed memory (bytes)                             *
  *                                                                            *
- * Comments: This function checks if the requested number of values is cached *
- *           and updates cache from database if necessary.                    *
+ ******************************************************************************/
+static size_t	vch_item_free_cache(zbx_vc_item_t *item)
+{
+	size_t	freed = 0;
+
+	zbx_vc_chunk_t	*chunk = item->tail;
+
+	while (NULL != chunk)
+	{
+		zbx_vc_chunk_t	*next = chunk->next;
+
+		freed += vch_item_free_chunk(item, chunk);
+		chunk = next;
+	}
+	item->values_total = 0;
+	item->head = NULL;
+	item->tail = NULL;
+
+	return freed;
+}
+
+/******************************************************************************************************************
+ *                                                                                                                *
+ * Value cache dump                                                                                               *
+ *                                                                                                                *
+ ******************************************************************************************************************/
+/*
+ * On shutdown the cached items are written to the dump file and loaded back
+ * during the next startup, so requests do not have to read the cached history
+ * again from database:
+ *
+ *   header  - zbx_vc_dump_header_t
+ *   item    - zbx_vc_dump_item_t, followed by values_num values in ascending
+ *             order. Every value is stored as zbx_timespec_t timestamp and:
+ *               float, unsigned - 8 byte value
+ *               str, text       - string
+ *               log             - timestamp, logeventid, severity (int),
+ *                                 source and value strings
+ *
+ * Strings are stored as 4 byte length (ZBX_VC_DUMP_NULL for NULL strings)
+ * followed by string contents without terminating zero.
+ */
+
+#define ZBX_VC_DUMP_MAGIC	"ZBXVCDMP"
+#define ZBX_VC_DUMP_VERSION	1
+#define ZBX_VC_DUMP_BUILD	ZABBIX_VERSION " (revision " ZABBIX_REVISION ")"
+#define ZBX_VC_DUMP_NULL	0xffffffff
+
+/* the value cache dump file header */
+typedef struct
+{
+	char		magic[8];
+	zbx_uint32_t	version;
+	zbx_uint32_t	reserved;
+	char		build[64];
+	zbx_uint64_t	clock;
+	zbx_uint64_t	hits;
+	zbx_uint64_t	misses;
+	zbx_uint64_t	items_num;
+}
+zbx_vc_dump_header_t;
+
+/* the value cache dump item */
+typedef struct
+{
+	zbx_uint64_t	itemid;
+	zbx_uint64_t	hits;
+	unsigned char	value_type;
+	unsigned char	status;
+	unsigned char	range_sync_hour;
+	unsigned char	reserved;
+	int		values_num;
+	int		last_accessed;
+	int		active_range;
+	int		daily_range;
+	int		db_cached_from;
+	int		last_hourly_num;
+	int		hourly_num;
+	int		hour;
+}
+zbx_vc_dump_item_t;
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: writes string into value cache dump                               *
+ *                                                                            *
+ * Parameters: file - [IN] the dump file                                      *
+ *             str  - [IN] the string to write, can be NULL                   *
+ *                                                                            *
+ * Return value: SUCCEED - the string was written                             *
+ *               FAIL    - otherwise                                          *
  *                                                                            *
  ******************************************************************************/
-static int	vch_item_cache_values_by_time_and_count(zbx_vc_item_t **item, int range_start, int count,
-		const zbx_timespec_t *ts)
+static int	vc_dump_write_str(FILE *file, const char *str)
 {
-	int				ret = SUCCEED, cached_records = 0, range_end, records_offset;
-	zbx_vector_history_record_t	records;
-	zbx_uint64_t			itemid;
-	unsigned char			value_type;
+	zbx_uint32_t	len;
 
-	if (ZBX_ITEM_STATUS_CACHED_ALL == (*item)->status)
-		return SUCCEED;
+	if (NULL == str)
+	{
+		len = ZBX_VC_DUMP_NULL;
+		return 1 == fwrite(&len, sizeof(len), 1, file) ? SUCCEED : FAIL;
+	}
 
-	/* check if the requested period is in the cached range */
-	if (0 != (*item)->db_cached_from && range_start >= (*item)->db_cached_from)
-		return SUCCEED;
+	len = (zbx_uint32_t)strlen(str);
 
-	/* find if the cache should be updated to cover the required count */
-	if (NULL != (*item)->head)
+	if (1 != fwrite(&len, sizeof(len), 1, file) || (0 != len && 1 != fwrite(str, len, 1, file)))
+		return FAIL;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: writes item and its values into value cache dump                  *
+ *                                                                            *
+ * Parameters: file - [IN] the dump file                                      *
+ *             item - [IN] the item                                           *
+ *                                                                            *
+ * Return value: SUCCEED - the item was written                               *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	vc_dump_write_item(FILE *file, const zbx_vc_item_t *item)
+{
+	zbx_vc_dump_item_t	ditem;
+	const zbx_vc_chunk_t	*chunk;
+	const zbx_log_value_t	*log;
+	int			i, data[3];
+
+	memset(&ditem, 0, sizeof(ditem));
+	ditem.itemid = item->itemid;
+	ditem.hits = item->hits;
+	ditem.value_type = item->value_type;
+	ditem.status = item->status;
+	ditem.range_sync_hour = item->range_sync_hour;
+	ditem.last_accessed = item->last_accessed;
+	ditem.active_range = item->active_range;
+	ditem.daily_range = item->daily_range;
+	ditem.db_cached_from = item->db_cached_from;
+	ditem.last_hourly_num = item->last_hourly_num;
+	ditem.hourly_num = item->hourly_num;
+	ditem.hour = item->hour;
+
+	for (chunk = item->tail; NULL != chunk; chunk = chunk->next)
+		ditem.values_num += chunk->last_value - chunk->first_value + 1;
+
+	if (1 != fwrite(&ditem, sizeof(ditem), 1, file))
+		return FAIL;
+
+	for (chunk = item->tail; NULL != chunk; chunk = chunk->next)
 	{
-		zbx_vc_chunk_t	*chunk;
-		int		index;
+		const zbx_vc_chunk_t	*chunk_data = vch_chunk_get_data(item, chunk);
 
-		if (SUCCEED == vch_item_get_last_value(*item, ts, &chunk, &index))
+		for (i = chunk->first_value; i <= chunk->last_value; i++)
 		{
-			cached_records = index - chunk->first_value + 1;
+			if (1 != fwrite(&chunk_data->timestamps[i], sizeof(zbx_timespec_t), 1, file))
+				return FAIL;
 
-			while (NULL != (chunk = chunk->prev) && cached_records < count)
-				cached_records += chunk->last_value - chunk->first_value + 1;
+			switch (item->value_type)
+			{
+				case ITEM_VALUE_TYPE_STR:
+				case ITEM_VALUE_TYPE_TEXT:
+					if (SUCCEED != vc_dump_write_str(file, chunk_data->values[i].str))
+						return FAIL;
+					break;
+				case ITEM_VALUE_TYPE_LOG:
+					log = chunk_data->values[i].log;
+					data[0] = log->timestamp;
+					data[1] = log->logeventid;
+					data[2] = log->severity;
+
+					if (1 != fwrite(data, sizeof(data), 1, file) ||
+							SUCCEED != vc_dump_write_str(file, log->source) ||
+							SUCCEED != vc_dump_write_str(file, log->value))
+					{
+						return FAIL;
+					}
+					break;
+				default:
+					if (1 != fwrite(&chunk_data->values[i].ui64, sizeof(zbx_uint64_t), 1, file))
+						return FAIL;
+			}
 		}
 	}
 
-	/* update cache if necessary */
-	if (cached_records >= count)
-		return SUCCEED;
+	return SUCCEED;
+}
 
-	/* get the end timestamp to which (including) the values should be cached */
-	if (NULL != (*item)->head)
-		range_end = (*item)->tail->slots[(*item)->tail->first_value].timestamp.sec - 1;
-	else
-		range_end = ZBX_JAN_2038;
+/******************************************************************************
+ *                                                                            *
+ * Purpose: writes value cache contents into dump file                        *
+ *                                                                            *
+ * Parameters: path - [IN] the dump file path                                 *
+ *                                                                            *
+ * Comments: The dump is written into temporary file which replaces the dump  *
+ *           file when all items are written.                                 *
+ *           Items pending removal are not written.                           *
+ *                                                                            *
+ ******************************************************************************/
+static void	vc_dump_save(const char *path)
+{
+	zbx_vc_dump_header_t	header;
+	zbx_hashset_iter_t	iter;
+	zbx_vc_item_t		*item;
+	zbx_uint64_t		values_num = 0;
+	FILE			*file;
+	char			*tmp;
+	int			ret = FAIL;
 
-	itemid = (*item)->itemid;
-	value_type = (*item)->value_type;
-	UNLOCK_CACHE;
+	tmp = zbx_dsprintf(NULL, "%s.tmp", path);
 
-	zbx_vector_history_record_create(&records);
+	if (NULL == (file = fopen(tmp, "w")))
+		goto out;
 
-	if (range_end > ts->sec)
+	setvbuf(file, NULL, _IOFBF, ZBX_KIBIBYTE * 64);
+
+	/* the header is rewritten with the number of items when all items are written */
+	memset(&header, 0, sizeof(header));
+
+	if (1 != fwrite(&header, sizeof(header), 1, file))
+		goto out;
+
+	zbx_hashset_iter_reset(&vc_cache->items, &iter);
+
+	while (NULL != (item = (zbx_vc_item_t *)zbx_hashset_iter_next(&iter)))
 	{
-		ret = vc_db_read_values_by_time(itemid, value_type, &records, ts->sec + 1, range_end);
-		range_end = ts->sec;
+		if (0 != (item->state & ZBX_ITEM_STATE_REMOVE_PENDING))
+			continue;
+
+		if (SUCCEED != vc_dump_write_item(file, item))
+			goto out;
+
+		header.items_num++;
+		values_num += (zbx_uint64_t)item->values_total;
 	}
 
-	records_offset = records.values_num;
+	memcpy(header.magic, ZBX_VC_DUMP_MAGIC, sizeof(header.magic));
+	header.version = ZBX_VC_DUMP_VERSION;
+	zbx_strlcpy(header.build, ZBX_VC_DUMP_BUILD, sizeof(header.build));
+	header.clock = (zbx_uint64_t)time(NULL);
+	header.hits = vc_cache->hits;
+	header.misses = vc_cache->misses;
 
-	if (SUCCEED == ret && SUCCEED == (ret = vc_db_read_values_by_time_and_count(itemid, value_type, &records,
-			range_start, count - cached_records, range_end, ts)))
+	if (0 != fseek(file, 0, SEEK_SET) || 1 != fwrite(&header, sizeof(header), 1, file) || 0 != fflush(file) ||
+			0 != fsync(fileno(file)))
 	{
-		zbx_vector_history_record_sort(&records,
-				(zbx_compare_func_t)zbx_history_record_compare_asc_func);
+		goto out;
 	}
 
-	WRLOCK_CACHE;
+	if (0 != fclose(file))
+	{
+		file = NULL;
+		goto out;
+	}
 
-	if (SUCCEED != ret)
+	file = NULL;
+
+	if (0 != rename(tmp, path))
 		goto out;
 
-	if (NULL == (*item = (zbx_vc_item_t *)zbx_hashset_search(&vc_cache->items, &itemid)))
+	zabbix_log(LOG_LEVEL_INFORMATION, "written value cache dump \"%s\" with " ZBX_FS_UI64 " items and "
+			ZBX_FS_UI64 " values", path, header.items_num, values_num);
+
+	ret = SUCCEED;
+out:
+	if (SUCCEED != ret)
 	{
-		zbx_vc_item_t	new_item = {.itemid = itemid, .value_type = value_type};
+		zabbix_log(LOG_LEVEL_WARNING, "cannot write value cache dump \"%s\": %s", tmp, zbx_strerror(errno));
 
-		if (NULL == (*item = (zbx_vc_item_t *)zbx_hashset_insert(&vc_cache->items, &new_item, sizeof(new_item))))
-		{
-			ret = FAIL;
-			goto out;
-		}
+		if (NULL != file)
+			fclose(file);
+
+		unlink(tmp);
 	}
 
-	if (0 < records.values_num)
-		ret = vch_item_add_values_at_tail(*item, records.values, records.values_num);
+	zbx_free(tmp);
+}
 
-	if (SUCCEED != ret)
-		goto out;
+/******************************************************************************
+ *                                                                            *
+ * Purpose: reads string from value cache dump                                *
+ *                                                                            *
+ * Parameters: file - [IN] the dump file                                      *
+ *             size - [IN] the dump file size, used to validate string length *
+ *             str  - [OUT] the string, NULL for NULL strings                 *
+ *                                                                            *
+ * Return value: SUCCEED - the string was read                                *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	vc_dump_read_str(FILE *file, zbx_uint64_t size, char **str)
+{
+	zbx_uint32_t	len;
 
-	ret = records.values_num;
+	if (1 != fread(&len, sizeof(len), 1, file))
+		return FAIL;
 
-	if (0 == range_start && count - cached_records > records.values_num - records_offset)
+	if (ZBX_VC_DUMP_NULL == len)
 	{
-		(*item)->active_range = 0;
-		(*item)->daily_range = 0;
-		(*item)->status = ZBX_ITEM_STATUS_CACHED_ALL;
+		*str = NULL;
+		return SUCCEED;
 	}
 
-	if ((count <= records.values_num || 0 == range_start) && 0 != records.values_num)
+	if (len >= size)
+		return FAIL;
+
+	*str = (char *)zbx_malloc(NULL, len + 1);
+
+	if (0 != len && 1 != fread(*str, len, 1, file))
 	{
-		vc_item_update_db_cached_from(*item,
-				(*item)->tail->slots[(*item)->tail->first_value].timestamp.sec);
+		zbx_free(*str);
+		return FAIL;
 	}
-	else if (0 != range_start)
-		vc_item_update_db_cached_from(*item, range_start);
 
-out:
-	zbx_history_record_vector_destroy(&records, value_type);
+	(*str)[len] = '\0';
 
-	return ret;
+	return SUCCEED;
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: retrieves item history data from cache                            *
+ * Purpose: reads item value from value cache dump                            *
  *                                                                            *
- * Parameters: item      - [IN] the item                                      *
- *             values    - [OUT] the item history data stored time/value      *
- *                         pairs in undefined order                           *
- *             seconds   - [IN] the time period to retrieve data for          *
- *             ts        - [IN] the requested period end timestamp            *
+ * Parameters: file       - [IN] the dump file                                *
+ *             size       - [IN] the dump file size                           *
+ *             value_type - [IN] the item value type                          *
+ *             record     - [OUT] the value                                   *
+ *                                                                            *
+ * Return value: SUCCEED - the value was read                                 *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: On failure no memory is left allocated for the value.            *
  *                                                                            *
  ******************************************************************************/
-static void	vch_item_get_values_by_time(const zbx_vc_item_t *item, zbx_vector_history_record_t *values, int seconds,
-		const zbx_timespec_t *ts)
+static int	vc_dump_read_value(FILE *file, zbx_uint64_t size, unsigned char value_type,
+		zbx_history_record_t *record)
 {
-	int		index, now;
-	zbx_timespec_t	start = {ts->sec - seconds, ts->ns};
-	zbx_vc_chunk_t	*chunk;
+	zbx_log_value_t	*log;
+	int		data[3];
 
-	now = time(NULL);
-	/* add another second to include nanosecond shifts */
-	vc_cache_item_update(item->itemid, ZBX_VC_UPDATE_RANGE, seconds + now - ts->sec + 1, now);
+	if (1 != fread(&record->timestamp, sizeof(zbx_timespec_t), 1, file))
+		return FAIL;
 
-	if (FAIL == vch_item_get_last_value(item, ts, &chunk, &index))
+	switch (value_type)
 	{
-		/* Cache does not contain records for the specified timeshift & seconds range. */
-		/* Return empty vector with success.                                           */
-		return;
-	}
+		case ITEM_VALUE_TYPE_STR:
+		case ITEM_VALUE_TYPE_TEXT:
+			if (SUCCEED != vc_dump_read_str(file, size, &record->value.str))
+				return FAIL;
 
-	/* fill the values vector with item history values until the start timestamp is reached */
-	while (0 < zbx_timespec_compare(&chunk->slots[chunk->last_value].timestamp, &start))
-	{
-		while (index >= chunk->first_value && 0 < zbx_timespec_compare(&chunk->slots[index].timestamp, &start))
-			vc_history_record_vector_append(values, item->value_type, &chunk->slots[index--]);
+			return NULL != record->value.str ? SUCCEED : FAIL;
+		case ITEM_VALUE_TYPE_LOG:
+			if (1 != fread(data, sizeof(data), 1, file))
+				return FAIL;
 
-		if (NULL == (chunk = chunk->prev))
-			break;
+			log = (zbx_log_value_t *)zbx_malloc(NULL, sizeof(zbx_log_value_t));
+			log->timestamp = data[0];
+			log->logeventid = data[1];
+			log->severity = data[2];
+			log->source = NULL;
+			log->value = NULL;
 
-		index = chunk->last_value;
+			if (SUCCEED != vc_dump_read_str(file, size, &log->source) ||
+					SUCCEED != vc_dump_read_str(file, size, &log->value) || NULL == log->value)
+			{
+				record->value.log = log;
+				zbx_history_record_clear(record, value_type);
+				return FAIL;
+			}
+
+			record->value.log = log;
+			return SUCCEED;
+		default:
+			return 1 == fread(&record->value.ui64, sizeof(zbx_uint64_t), 1, file) ? SUCCEED : FAIL;
 	}
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: retrieves item history data from cache                            *
+ * Purpose: estimates value cache memory required to store item               *
  *                                                                            *
- * Parameters: item      - [IN] the item                                      *
- *             values    - [OUT] the item history data stored time/value      *
- *                         pairs in undefined order, optional                 *
- *                         If null then cache is updated if necessary, but no *
- *                         values are returned. Used to ensure that cache     *
- *                         contains a value of the specified timestamp.       *
- *             seconds   - [IN] the time period                               *
- *             count     - [IN] the number of history values to retrieve      *
- *             timestamp - [IN] the target timestamp                          *
+ * Parameters: item       - [IN] the item                                     *
+ *             values     - [IN] the item values                              *
+ *             values_num - [IN] the number of values                         *
+ *                                                                            *
+ * Return value: the estimated size in bytes                                  *
+ *                                                                            *
+ * Comments: The estimate does not include memory allocator overhead and      *
+ *           ignores strings shared through string pool.                      *
  *                                                                            *
  ******************************************************************************/
-static void	vch_item_get_values_by_time_and_count(zbx_vc_item_t *item, zbx_vector_history_record_t *values,
-		int seconds, int count, const zbx_timespec_t *ts)
+static size_t	vc_dump_item_size(zbx_vc_item_t *item, const zbx_history_record_t *values, int values_num)
 {
-	int		index, now, range_timestamp;
-	zbx_vc_chunk_t	*chunk;
-	zbx_timespec_t	start;
-
-	/* set start timestamp of the requested time period */
-	if (0 != seconds)
-	{
-		start.sec = ts->sec - seconds;
-		start.ns = ts->ns;
-	}
-	else
-	{
-		start.sec = 0;
-		start.ns = 0;
-	}
-
-	if (FAIL == vch_item_get_last_value(item, ts, &chunk, &index))
-	{
-		/* return empty vector with success */
-		goto out;
-	}
+	size_t	size, str_entry = REFCOUNT_FIELD_SIZE + sizeof(ZBX_HASHSET_ENTRY_T) + 1;
+	int	i, nslots, chunks_num;
 
-	/* fill the values vector with item history values until the <count> values are read    */
-	/* or no more values within specified time period                                       */
-	/* fill the values vector with item history values until the start timestamp is reached */
-	while (0 < zbx_timespec_compare(&chunk->slots[chunk->last_value].timestamp, &start))
-	{
-		while (index >= chunk->first_value && 0 < zbx_timespec_compare(&chunk->slots[index].timestamp, &start))
-		{
-			vc_history_record_vector_append(values, item->value_type, &chunk->slots[index--]);
+	size = sizeof(zbx_vc_item_t) + sizeof(ZBX_HASHSET_ENTRY_T);
 
-			if (values->values_num == count)
-				goto out;
-		}
+	if (0 == values_num)
+		return size;
 
-		if (NULL == (chunk = chunk->prev))
-			break;
+	nslots = vch_item_chunk_slot_count(item, values_num);
+	chunks_num = (values_num + nslots - 1) / nslots;
+	size += chunks_num * (sizeof(zbx_vc_chunk_t) + ZBX_VC_CHUNK_SLOT_SIZE * nslots);
 
-		index = chunk->last_value;
-	}
-out:
-	if (count > values->values_num)
+	switch (item->value_type)
 	{
-		if (0 == seconds)
-			return;
+		case ITEM_VALUE_TYPE_STR:
+		case ITEM_VALUE_TYPE_TEXT:
+			for (i = 0; i < values_num; i++)
+				size += str_entry + strlen(values[i].value.str);
+			break;
+		case ITEM_VALUE_TYPE_LOG:
+			for (i = 0; i < values_num; i++)
+			{
+				size += sizeof(zbx_log_value_t) + str_entry + strlen(values[i].value.log->value);
 
-		/* set the range equal to the period plus one second to include nanosecond shifts */
-		range_timestamp = ts->sec - seconds;
-	}
-	else
-	{
-		/* the requested number of values was retrieved, set the range to the oldest value timestamp */
-		range_timestamp = values->values[values->values_num - 1].timestamp.sec - 1;
+				if (NULL != values[i].value.log->source)
+					size += str_entry + strlen(values[i].value.log->source);
+			}
+			break;
 	}
 
-	now = time(NULL);
-	vc_cache_item_update(item->itemid, ZBX_VC_UPDATE_RANGE, now - range_timestamp, now);
+	return size;
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: get item values for the specified range                           *
- *                                                                            *
- * Parameters: item      - [IN] the item                                      *
- *             values    - [OUT] the item history data stored time/value      *
- *                         pairs in undefined order, optional                 *
- *                         If null then cache is updated if necessary, but no *
- *                         values are returned. Used to ensure that cache     *
- *                         contains a value of the specified timestamp.       *
- *             seconds   - [IN] the time period to retrieve data for          *
- *             count     - [IN] the number of history values to retrieve      *
- *             ts        - [IN] the target timestamp                          *
+ * Purpose: adds item read from value cache dump to cache                     *
  *                                                                            *
- * Return value:  SUCCEED - the item history data was retrieved successfully  *
- *                FAIL    - the item history data was not retrieved           *
+ * Parameters: ditem   - [IN] the dumped item                                 *
+ *             values  - [IN] the item values in ascending order              *
+ *             horizon - [IN] the oldest value timestamp to restore           *
  *                                                                            *
- * Comments: This function returns data from cache if necessary updating it   *
- *           from DB. If cache update was required and failed (not enough     *
- *           memory to cache DB values), then this function also fails.       *
+ * Return value: >=0  - the number of restored values                         *
+ *               FAIL - not enough space in value cache                       *
  *                                                                            *
- *           If <count> is set then value range is defined as <count> values  *
- *           before <timestamp>. Otherwise the range is defined as <seconds>  *
- *           seconds before <timestamp>.                                      *
+ * Comments: Values older than horizon are skipped and the item data is       *
+ *           marked as cached from horizon.                                   *
+ *           Items are added only while cache has at least min_free_request   *
+ *           bytes left, so the restored data does not switch cache to low    *
+ *           memory mode.                                                     *
  *                                                                            *
  ******************************************************************************/
-static int	vch_item_get_values(zbx_vc_item_t *item, zbx_vector_history_record_t *values, int seconds,
-		int count, const zbx_timespec_t *ts)
+static int	vc_dump_restore_item(const zbx_vc_dump_item_t *ditem, const zbx_vector_history_record_t *values,
+		int horizon)
 {
-	int	ret, records_read, hits, misses, range_start;
-
-	zbx_vector_history_record_clear(values);
-
-	if (0 == count)
+	zbx_vc_item_t	item_local, *item;
+	int		first;
+
+	for (first = 0; first < values->values_num && values->values[first].timestamp.sec < horizon; first++)
+		;
+
+	memset(&item_local, 0, sizeof(item_local));
+	item_local.itemid = ditem->itemid;
+	item_local.value_type = ditem->value_type;
+	item_local.status = ditem->status;
+	item_local.range_sync_hour = ditem->range_sync_hour;
+	item_local.last_accessed = ditem->last_accessed;
+	item_local.active_range = ditem->active_range;
+	item_local.daily_range = ditem->daily_range;
+	item_local.db_cached_from = ditem->db_cached_from;
+	item_local.last_hourly_num = ditem->last_hourly_num;
+	item_local.hourly_num = ditem->hourly_num;
+	item_local.hour = ditem->hour;
+	item_local.hits = ditem->hits;
+
+	if (0 != first)
 	{
-		if (0 > (range_start = ts->sec - seconds))
-			range_start = 0;
+		item_local.status &= ~ZBX_ITEM_STATUS_CACHED_ALL;
 
-		if (FAIL == (ret = vch_item_cache_values_by_time(&item, range_start)))
-			goto out;
-
-		records_read = ret;
-
-		vch_item_get_values_by_time(item, values, seconds, ts);
-
-		if (records_read > values->values_num)
-			records_read = values->values_num;
+		if (item_local.db_cached_from < horizon)
+			item_local.db_cached_from = horizon;
 	}
-	else
-	{
-		range_start = (0 == seconds ? 0 : ts->sec - seconds);
-
-		if (FAIL == (ret = vch_item_cache_values_by_time_and_count(&item, range_start, count, ts)))
-			goto out;
-
-		records_read = ret;
-
-		vch_item_get_values_by_time_and_count(item, values, seconds, count, ts);
 
-		if (records_read > values->values_num)
-			records_read = values->values_num;
+	if (vc_mem->free_size < vc_dump_item_size(&item_local, values->values + first, values->values_num - first) +
+			vc_cache->min_free_request)
+	{
+		return FAIL;
 	}
 
-	hits = values->values_num - records_read;
-	misses = records_read;
+	if (NULL == (item = (zbx_vc_item_t *)zbx_hashset_insert(&vc_cache->items, &item_local, sizeof(item_local))))
+		return FAIL;
 
-	vc_cache_item_update(item->itemid, ZBX_VC_UPDATE_STATS, hits, misses);
+	if (first != values->values_num &&
+			SUCCEED != vch_item_add_values_at_tail(item, values->values + first, values->values_num - first))
+	{
+		vc_remove_item(item);
+		return FAIL;
+	}
 
-	ret = SUCCEED;
-out:
-	return ret;
+	return item->values_total;
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: frees resources allocated for item history data                   *
+ * Purpose: loads value cache contents from dump file                         *
  *                                                                            *
- * Parameters: item    - [IN] the item                                        *
+ * Parameters: path    - [IN] the dump file path                              *
+ *             max_age - [IN] the maximum age of restored values in seconds   *
  *                                                                            *
- * Return value: the size of freed memory (bytes)                             *
+ * Comments: The dump file is removed after loading, so the same contents are *
+ *           not loaded again if server is not stopped properly and the dump  *
+ *           is not rewritten.                                                *
  *                                                                            *
  ******************************************************************************/
-static size_t	vch_item_free_cache(zbx_vc_item_t *item)
+static void	vc_dump_load(const char *path, int max_age)
 {
-	size_t	freed = 0;
+	zbx_vc_dump_header_t		header;
+	zbx_vc_dump_item_t		ditem;
+	zbx_vector_history_record_t	values;
+	zbx_history_record_t		record;
+	zbx_uint64_t			i, items_num = 0, values_num = 0;
+	zbx_stat_t			st;
+	FILE				*file;
+	const char			*error = NULL;
+	int				j, horizon, restored;
+
+	if (NULL == (file = fopen(path, "r")))
+	{
+		if (ENOENT != errno)
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "cannot open value cache dump \"%s\": %s", path,
+					zbx_strerror(errno));
+		}
 
-	zbx_vc_chunk_t	*chunk = item->tail;
+		return;
+	}
 
-	while (NULL != chunk)
+	memset(&ditem, 0, sizeof(ditem));
+	zbx_history_record_vector_create(&values);
+
+	if (0 != zbx_fstat(fileno(file), &st))
 	{
-		zbx_vc_chunk_t	*next = chunk->next;
+		error = zbx_strerror(errno);
+		goto out;
+	}
 
-		freed += vch_item_free_chunk(item, chunk);
-		chunk = next;
+	if (1 != fread(&header, sizeof(header), 1, file) ||
+			0 != memcmp(header.magic, ZBX_VC_DUMP_MAGIC, sizeof(header.magic)) ||
+			ZBX_VC_DUMP_VERSION != header.version)
+	{
+		error = "unsupported file format";
+		goto out;
 	}
-	item->values_total = 0;
-	item->head = NULL;
-	item->tail = NULL;
 
-	return freed;
+	if (0 != strncmp(header.build, ZBX_VC_DUMP_BUILD, sizeof(header.build)))
+	{
+		error = "file was created by different Zabbix build";
+		goto out;
+	}
+
+	horizon = (int)time(NULL) - max_age;
+
+	if (header.clock < (zbx_uint64_t)horizon)
+	{
+		error = "file is too old";
+		goto out;
+	}
+
+	for (i = 0; i < header.items_num; i++)
+	{
+		if (1 != fread(&ditem, sizeof(ditem), 1, file) || ITEM_VALUE_TYPE_MAX <= ditem.value_type ||
+				0 > ditem.values_num || (zbx_uint64_t)ditem.values_num > (zbx_uint64_t)st.st_size)
+		{
+			error = "file is corrupted";
+			goto out;
+		}
+
+		zbx_vector_history_record_reserve(&values, (size_t)ditem.values_num);
+
+		for (j = 0; j < ditem.values_num; j++)
+		{
+			if (SUCCEED != vc_dump_read_value(file, (zbx_uint64_t)st.st_size, ditem.value_type, &record))
+			{
+				error = "file is corrupted";
+				goto out;
+			}
+
+			zbx_vector_history_record_append_ptr(&values, &record);
+		}
+
+		if (FAIL == (restored = vc_dump_restore_item(&ditem, &values, horizon)))
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "not enough space in value cache to restore " ZBX_FS_UI64
+					" items from dump", header.items_num - i);
+			break;
+		}
+
+		items_num++;
+		values_num += (zbx_uint64_t)restored;
+		zbx_history_record_vector_clean(&values, ditem.value_type);
+	}
+
+	vc_cache->hits = header.hits;
+	vc_cache->misses = header.misses;
+
+	zabbix_log(LOG_LEVEL_INFORMATION, "restored " ZBX_FS_UI64 " items with " ZBX_FS_UI64 " values from value"
+			" cache dump \"%s\"", items_num, values_num, path);
+out:
+	if (NULL != error)
+		zabbix_log(LOG_LEVEL_WARNING, "cannot load value cache dump \"%s\": %s", path, error);
+
+	zbx_history_record_vector_destroy(&values, ditem.value_type);
+	fclose(file);
+
+	if (0 != unlink(path))
+		zabbix_log(LOG_LEVEL_WARNING, "cannot remove value cache dump \"%s\": %s", path, zbx_strerror(errno));
 }
 
 /******************************************************************************************************************
@@ -2331,7 +4078,7 @@ static size_t	vch_item_free_cache(zbx_vc_item_t *item)
 int	zbx_vc_init(char **error)
 {
 	zbx_uint64_t	size_reserved;
-	int		ret = FAIL;
+	int		ret = FAIL, i;
 
 	if (0 == CONFIG_VALUE_CACHE_SIZE)
 		return SUCCEED;
@@ -2341,6 +4088,18 @@ int	zbx_vc_init(char **error)
 	if (SUCCEED != (ret = zbx_rwlock_create(&vc_lock, ZBX_RWLOCK_VALUECACHE, error)))
 		goto out;
 
+	if (SUCCEED != (ret = zbx_mutex_create(&vc_mem_lock, ZBX_MUTEX_VALUECACHE, error)))
+		goto out;
+
+	for (i = 0; i < ZBX_VC_ITEM_LOCKS_NUM; i++)
+	{
+		if (SUCCEED != (ret = zbx_mutex_create(&vc_item_locks[i],
+				(zbx_mutex_name_t)(ZBX_MUTEX_VALUECACHE_ITEM + i), error)))
+		{
+			goto out;
+		}
+	}
+
 	size_reserved = zbx_mem_required_size(1, "value cache size", "ValueCacheSize");
 
 	if (SUCCEED != zbx_mem_create(&vc_mem, CONFIG_VALUE_CACHE_SIZE, "value cache size", "ValueCacheSize", 1, error))
@@ -2385,6 +4144,11 @@ int	zbx_vc_init(char **error)
 	zbx_vector_vc_itemupdate_create(&vc_itemupdates);
 	zbx_vector_vc_itemupdate_reserve(&vc_itemupdates, 256);
 
+	zabbix_log(LOG_LEVEL_DEBUG, "value cache aggregates use %s kernels", zbx_vc_aggr_get_kernels()->name);
+
+	if (NULL != CONFIG_VALUE_CACHE_DUMP_FILE)
+		vc_dump_load(CONFIG_VALUE_CACHE_DUMP_FILE, CONFIG_VALUE_CACHE_DUMP_MAX_AGE);
+
 	ret = SUCCEED;
 out:
 	zbx_vc_disable();
@@ -2398,6 +4162,9 @@ out:
  *                                                                            *
  * Purpose: destroys value cache                                              *
  *                                                                            *
+ * Comments: If value cache dump file is configured, the cache contents are   *
+ *           written to it before cache is destroyed.                         *
+ *                                                                            *
  ******************************************************************************/
 void	zbx_vc_destroy(void)
 {
@@ -2405,6 +4172,11 @@ void	zbx_vc_destroy(void)
 
 	if (NULL != vc_cache)
 	{
+		int	i;
+
+		if (NULL != CONFIG_VALUE_CACHE_DUMP_FILE)
+			vc_dump_save(CONFIG_VALUE_CACHE_DUMP_FILE);
+
 		zbx_vector_vc_itemupdate_destroy(&vc_itemupdates);
 
 		zbx_hashset_destroy(&vc_cache->items);
@@ -2415,6 +4187,11 @@ void	zbx_vc_destroy(void)
 
 		zbx_mem_destroy(vc_mem);
 		vc_mem = NULL;
+
+		for (i = 0; i < ZBX_VC_ITEM_LOCKS_NUM; i++)
+			zbx_mutex_destroy(&vc_item_locks[i]);
+
+		zbx_mutex_destroy(&vc_mem_lock);
 		zbx_rwlock_destroy(&vc_lock);
 	}
 
@@ -2443,6 +4220,12 @@ void	zbx_vc_reset(void)
 		zbx_hashset_iter_reset(&vc_cache->items, &iter);
 		while (NULL != (item = (zbx_vc_item_t *)zbx_hashset_iter_next(&iter)))
 		{
+			if (0 != item->refcount)
+			{
+				item->state |= ZBX_ITEM_STATE_REMOVE_PENDING;
+				continue;
+			}
+
 			vch_item_free_cache(item);
 			zbx_hashset_iter_remove(&iter);
 		}
@@ -2462,32 +4245,148 @@ void	zbx_vc_reset(void)
 
 /******************************************************************************
  *                                                                            *
- * Purpose: adds item values to the history and value cache                   *
+ * Purpose: adds history value to cached item                                 *
+ *                                                                            *
+ * Parameters: item             - [IN] the item                               *
+ *             h                - [IN] the history value                      *
+ *             expire_timestamp - [IN] the item expiration timestamp          *
+ *                                                                            *
+ * Return value: SUCCEED - the value was added or the item was removed        *
+ *               FAIL    - the value was not added, because item must be      *
+ *                         removed from cache, but the cache is locked in     *
+ *                         read mode                                          *
+ *                                                                            *
+ * Comments: While cache is locked in read mode items failing to store new    *
+ *           value are marked for removal and the caller must remove them     *
+ *           after locking cache in write mode.                               *
+ *                                                                            *
+ ******************************************************************************/
+static int	vc_item_add_value(zbx_vc_item_t *item, const ZBX_DC_HISTORY *h, time_t expire_timestamp)
+{
+	zbx_history_record_t	record = {h->ts, h->value};
+	zbx_vc_chunk_t		*head = item->head;
+
+	/* values referenced by cursors cannot be moved, so out of order values */
+	/* can be added only to items without open cursors                      */
+	if (0 != item->refcount && NULL != item->head &&
+			0 < zbx_timespec_compare(&item->head->timestamps[item->head->last_value], &record.timestamp))
+	{
+		goto remove;
+	}
+
+	/* If the new value type does not match the item's type in cache remove it, */
+	/* so it's cached with the correct type from correct tables when accessed   */
+	/* next time.                                                               */
+	if (item->value_type != h->value_type || item->last_accessed < expire_timestamp)
+		goto remove;
+
+	/* Also remove item if the value adding failed. In this case we             */
+	/* won't have the latest data in cache - so the requests must go directly   */
+	/* to the database.                                                         */
+	if (FAIL == vch_item_add_value_at_head(item, &record))
+	{
+		/* item data might be inconsistent, hide it from other processes */
+		if (0 != vc_lock_shared)
+			item->state |= ZBX_ITEM_STATE_REMOVE_PENDING;
+
+		goto remove;
+	}
+
+	/* try to remove old (unused) chunks if a new chunk was added */
+	if (head != item->head && 0 == item->refcount)
+		vch_item_clean_cache(item);
+
+	return SUCCEED;
+remove:
+	if (0 != vc_lock_shared)
+		return FAIL;
+
+	vc_remove_item(item);
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: adds item values to the value cache                               *
  *                                                                            *
  * Parameters: history - [IN] item history values                             *
  *                                                                            *
- * Return value: SUCCEED - the values were added successfully                 *
- *               FAIL    - otherwise                                          *
+ * Comments: Values of cached items are added while holding the cache lock in *
+ *           read mode and the item stripe locks. The cache is locked in      *
+ *           write mode starting with the first value requiring item to be    *
+ *           added to or removed from cache.                                  *
+ *           The values must be already written to history storage, otherwise *
+ *           items cached later from database would miss them.                *
  *                                                                            *
  ******************************************************************************/
-int	zbx_vc_add_values(zbx_vector_ptr_t *history, int *ret_flush)
+void	zbx_vc_add_values(zbx_vector_ptr_t *history)
 {
 	zbx_vc_item_t		*item;
-	int			i;
+	int			i = 0, j;
 	ZBX_DC_HISTORY		*h;
 	time_t			expire_timestamp;
-
-	if (SUCCEED != zbx_history_add_values(history, ret_flush))
-		return FAIL;
+	size_t			free_size;
+	zbx_vector_uint64_t	itemids;
 
 	if (ZBX_VC_DISABLED == vc_state)
-		return SUCCEED;
+		return;
 
 	expire_timestamp = time(NULL) - ZBX_VC_ITEM_EXPIRE_PERIOD;
 
+	zbx_vector_uint64_create(&itemids);
+
+	RDLOCK_CACHE;
+
+	LOCK_MEM;
+	free_size = vc_mem->free_size;
+	UNLOCK_MEM;
+
+	/* space cannot be released in read mode, so add values in write mode when cache is running low on memory */
+	if (ZBX_VC_MODE_NORMAL != vc_cache->mode || free_size < vc_cache->min_free_request)
+		goto write;
+
+	for (; i < history->values_num; i++)
+	{
+		h = (ZBX_DC_HISTORY *)history->values[i];
+
+		if (NULL == (item = (zbx_vc_item_t *)zbx_hashset_search(&vc_cache->items, &h->itemid)))
+		{
+			/* new items can be added only in write mode */
+			if (0 != (h->flags & ZBX_DC_FLAG_HASTRIGGER))
+				break;
+
+			continue;
+		}
+
+		vc_item_lock(h->itemid);
+
+		if (0 == (item->state & ZBX_ITEM_STATE_REMOVE_PENDING) &&
+				FAIL == vc_item_add_value(item, h, expire_timestamp))
+		{
+			if (0 == (item->state & ZBX_ITEM_STATE_REMOVE_PENDING))
+			{
+				vc_item_unlock();
+				break;
+			}
+
+			/* the value was not added, the item must be removed */
+			zbx_vector_uint64_append(&itemids, h->itemid);
+		}
+
+		vc_item_unlock();
+	}
+
+	if (i == history->values_num && 0 == itemids.values_num)
+		goto out;
+write:
+	UNLOCK_CACHE;
 	WRLOCK_CACHE;
 
-	for (i = 0; i < history->values_num; i++)
+	for (j = 0; j < itemids.values_num; j++)
+		vc_remove_item_by_id(itemids.values[j]);
+
+	for (; i < history->values_num; i++)
 	{
 		h = (ZBX_DC_HISTORY *)history->values[i];
 
@@ -2505,33 +4404,13 @@ int	zbx_vc_add_values(zbx_vector_ptr_t *history, int *ret_flush)
 			item = (zbx_vc_item_t *)zbx_hashset_insert(&vc_cache->items, &item_local, sizeof(item_local));
 		}
 
-		if (NULL != item)
-		{
-			zbx_history_record_t	record = {h->ts, h->value};
-			zbx_vc_chunk_t		*head = item->head;
-
-			/* If the new value type does not match the item's type in cache remove it, */
-			/* so it's cached with the correct type from correct tables when accessed   */
-			/* next time.                                                               */
-			/* Also remove item if the value adding failed. In this case we             */
-			/* won't have the latest data in cache - so the requests must go directly   */
-			/* to the database.                                                         */
-			if (item->value_type != h->value_type || item->last_accessed < expire_timestamp ||
-					FAIL == vch_item_add_value_at_head(item, &record))
-			{
-				vc_remove_item(item);
-				continue;
-			}
-
-			/* try to remove old (unused) chunks if a new chunk was added */
-			if (head != item->head)
-				vch_item_clean_cache(item);
-		}
+		if (NULL != item && 0 == (item->state & ZBX_ITEM_STATE_REMOVE_PENDING))
+			vc_item_add_value(item, h, expire_timestamp);
 	}
-
+out:
 	UNLOCK_CACHE;
 
-	return SUCCEED;
+	zbx_vector_uint64_destroy(&itemids);
 }
 
 /******************************************************************************
@@ -2584,7 +4463,10 @@ int	zbx_vc_get_values(zbx_uint64_t itemid, int value_type, zbx_vector_history_re
 		new_item.value_type = value_type;
 		item = &new_item;
 	}
-	else if (item->value_type != value_type)
+
+	vc_item_lock(itemid);
+
+	if (item->value_type != value_type || 0 != (item->state & ZBX_ITEM_STATE_REMOVE_PENDING))
 		goto out;
 
 	ret = vch_item_get_values(item, values, seconds, count, ts);
@@ -2612,6 +4494,373 @@ out:
 	return ret;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: calculates aggregates of numeric item history values over the     *
+ *          specified period without copying the values                       *
+ *                                                                            *
+ * Parameters: itemid     - [IN] the item id                                  *
+ *             value_type - [IN] the item value type                          *
+ *             seconds    - [IN] the time period to retrieve data for         *
+ *             count      - [IN] the number of history values to retrieve     *
+ *             ts         - [IN] the period end timestamp                     *
+ *             aggr       - [IN/OUT] the aggregates to calculate (flags,      *
+ *                                   filter) and the calculated results       *
+ *                                                                            *
+ * Return value:  SUCCEED - the aggregates were calculated                    *
+ *                FAIL    - the aggregates cannot be calculated from cache,   *
+ *                          zbx_vc_get_values() must be used instead          *
+ *                                                                            *
+ * Comments: The range is defined in the same way as in zbx_vc_get_values().  *
+ *           Values missing in cache are read from DB into the cache first,   *
+ *           then the aggregates are calculated by SIMD kernels over chunk    *
+ *           value arrays while holding the cache read lock. When the values  *
+ *           cannot be cached (low memory mode, cache full or the item being  *
+ *           removed) FAIL is returned and the caller must use                *
+ *           zbx_vc_get_values(), which reads the history from DB directly.   *
+ *           For percentile the values are copied from chunks into a plain    *
+ *           array and the percentile is selected after the cache is          *
+ *           unlocked.                                                        *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_vc_get_aggregate(zbx_uint64_t itemid, int value_type, int seconds, int count, const zbx_timespec_t *ts,
+		zbx_vc_aggr_t *aggr)
+{
+	zbx_vc_item_t	*item, new_item;
+	int		ret = FAIL;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() itemid:" ZBX_FS_UI64 " value_type:%d count:%d period:%d end_timestamp"
+			" '%s' flags:0x%x", __func__, itemid, value_type, count, seconds, zbx_timespec_str(ts),
+			(unsigned int)aggr->flags);
+
+	if (ITEM_VALUE_TYPE_FLOAT != value_type && ITEM_VALUE_TYPE_UINT64 != value_type)
+		goto finish;
+
+	RDLOCK_CACHE;
+
+	if (ZBX_VC_DISABLED == vc_state)
+		goto out;
+
+	if (ZBX_VC_MODE_LOWMEM == vc_cache->mode)
+		vc_warn_low_memory();
+
+	if (NULL == (item = (zbx_vc_item_t *)zbx_hashset_search(&vc_cache->items, &itemid)))
+	{
+		if (ZBX_VC_MODE_NORMAL != vc_cache->mode)
+			goto out;
+
+		memset(&new_item, 0, sizeof(new_item));
+		new_item.itemid = itemid;
+		new_item.value_type = value_type;
+		item = &new_item;
+	}
+
+	vc_item_lock(itemid);
+
+	if (item->value_type != value_type || 0 != (item->state & ZBX_ITEM_STATE_REMOVE_PENDING))
+		goto out;
+
+	aggr->values_num = 0;
+	aggr->count = 0;
+	aggr->sum.ui64 = 0;
+	aggr->sum_dbl = 0;
+	aggr->min.ui64 = 0;
+	aggr->max.ui64 = 0;
+
+	if (ITEM_VALUE_TYPE_FLOAT == value_type)
+	{
+		aggr->sum.dbl = 0;
+		aggr->min.dbl = 0;
+		aggr->max.dbl = 0;
+	}
+
+	ret = vch_item_walk_values(&item, seconds, count, ts, vc_aggr_add_range, aggr);
+out:
+	if (FAIL == ret && ZBX_VC_DISABLED != vc_state)
+	{
+		/* drop the item so the following zbx_vc_get_values() call reads history from DB directly */
+		UNLOCK_CACHE;
+		WRLOCK_CACHE;
+
+		if (ZBX_VC_DISABLED != vc_state)
+			vc_remove_item_by_id(itemid);
+	}
+
+	UNLOCK_CACHE;
+
+	if (0 != (aggr->flags & ZBX_VC_AGGR_PERCENTILE))
+	{
+		if (SUCCEED == ret && 0 < aggr->values_num)
+		{
+			int	index;
+
+			if (0 == aggr->percentage)
+				index = 1;
+			else
+				index = (int)ceil(aggr->values_num * (aggr->percentage / 100));
+
+			if (ITEM_VALUE_TYPE_FLOAT == value_type)
+			{
+				aggr->percentile.dbl = zbx_vc_aggr_select_dbl(&vc_aggr_values->dbl, aggr->values_num,
+						index - 1);
+			}
+			else
+			{
+				aggr->percentile.ui64 = zbx_vc_aggr_select_ui64(&vc_aggr_values->ui64,
+						aggr->values_num, index - 1);
+			}
+		}
+
+		zbx_free(vc_aggr_values);
+		vc_aggr_values_alloc = 0;
+	}
+finish:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s values:%d", __func__, zbx_result_string(ret),
+			SUCCEED == ret ? aggr->values_num : 0);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: removes value cursor ranges, freeing the copied values            *
+ *                                                                            *
+ * Parameters: cursor - [IN/OUT] the value cursor                             *
+ *                                                                            *
+ ******************************************************************************/
+static void	vc_cursor_clear_ranges(zbx_vc_cursor_t *cursor)
+{
+	int	i;
+
+	for (i = 0; i < cursor->ranges.values_num; i++)
+		zbx_free(cursor->ranges.values[i].data);
+
+	zbx_vector_vc_range_clear(&cursor->ranges);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: opens value cursor for item history values over the specified     *
+ *          period                                                            *
+ *                                                                            *
+ * Parameters: cursor     - [OUT] the value cursor                            *
+ *             itemid     - [IN] the item id                                  *
+ *             value_type - [IN] the item value type                          *
+ *             seconds    - [IN] the time period to retrieve data for         *
+ *             count      - [IN] the number of history values to retrieve     *
+ *             ts         - [IN] the period end timestamp                     *
+ *                                                                            *
+ * Return value:  SUCCEED - the cursor was opened successfully                *
+ *                FAIL    - the item history data was not retrieved           *
+ *                                                                            *
+ * Comments: The range is defined in the same way as in zbx_vc_get_values().  *
+ *           The cursor references item values in cache (the item reference   *
+ *           counter is increased), so no values are copied. If the values    *
+ *           cannot be cached they are copied with zbx_vc_get_values().       *
+ *           The cursor must be closed with zbx_vc_cursor_close() even if     *
+ *           opening it failed.                                               *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_vc_cursor_open(zbx_vc_cursor_t *cursor, zbx_uint64_t itemid, int value_type, int seconds, int count,
+		const zbx_timespec_t *ts)
+{
+	int	ret = FAIL;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() itemid:" ZBX_FS_UI64 " value_type:%d count:%d period:%d end_timestamp"
+			" '%s'", __func__, itemid, value_type, count, seconds, zbx_timespec_str(ts));
+
+	cursor->itemid = itemid;
+	cursor->value_type = value_type;
+	cursor->values_num = 0;
+	cursor->item = NULL;
+	cursor->range = 0;
+	cursor->index = -1;
+	zbx_vector_vc_range_create(&cursor->ranges);
+	zbx_history_record_vector_create(&cursor->records);
+
+#if defined(HAVE_ATOMIC_BUILTINS)
+	{
+		zbx_vc_item_t	*item, new_item;
+
+		RDLOCK_CACHE;
+
+		if (ZBX_VC_DISABLED == vc_state)
+			goto out;
+
+		if (ZBX_VC_MODE_LOWMEM == vc_cache->mode)
+			vc_warn_low_memory();
+
+		if (NULL == (item = (zbx_vc_item_t *)zbx_hashset_search(&vc_cache->items, &itemid)))
+		{
+			if (ZBX_VC_MODE_NORMAL != vc_cache->mode)
+				goto out;
+
+			memset(&new_item, 0, sizeof(new_item));
+			new_item.itemid = itemid;
+			new_item.value_type = value_type;
+			item = &new_item;
+		}
+
+		vc_item_lock(itemid);
+
+		if (item->value_type != value_type || 0 != (item->state & ZBX_ITEM_STATE_REMOVE_PENDING))
+			goto out;
+
+		if (SUCCEED != (ret = vch_item_walk_values(&item, seconds, count, ts, vc_cursor_add_range, cursor)))
+			goto out;
+
+		/* Items are added to cache together with their values, so the item is cached if     */
+		/* there are values. Concurrent readers might be holding the read lock, so reference */
+		/* counter must be updated atomically.                                              */
+		if (0 != cursor->ranges.values_num)
+		{
+			zbx_atomic_fetch_add(&item->refcount, 1);
+			cursor->item = item;
+		}
+out:
+		if (FAIL == ret && ZBX_VC_DISABLED != vc_state)
+		{
+			/* drop the item so the following zbx_vc_get_values() call reads history from DB directly */
+			UNLOCK_CACHE;
+			WRLOCK_CACHE;
+
+			if (ZBX_VC_DISABLED != vc_state)
+				vc_remove_item_by_id(itemid);
+		}
+
+		UNLOCK_CACHE;
+	}
+
+	if (SUCCEED == ret)
+		goto finish;
+
+	vc_cursor_clear_ranges(cursor);
+	cursor->values_num = 0;
+#endif
+	/* copy the values if they cannot be referenced in cache */
+	if (SUCCEED == (ret = zbx_vc_get_values(itemid, value_type, &cursor->records, seconds, count, ts)))
+		cursor->values_num = cursor->records.values_num;
+#if defined(HAVE_ATOMIC_BUILTINS)
+finish:
+#endif
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s values:%d referenced:%d", __func__, zbx_result_string(ret),
+			cursor->values_num, NULL != cursor->item);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets the next (older) value from value cursor                     *
+ *                                                                            *
+ * Parameters: cursor - [IN/OUT] the value cursor                             *
+ *             ts     - [OUT] the value timestamp (optional)                  *
+ *             value  - [OUT] the value (optional)                            *
+ *                                                                            *
+ * Return value:  SUCCEED - the next value was returned                       *
+ *                FAIL    - there are no more values                          *
+ *                                                                            *
+ * Comments: The values are returned in descending order (starting with the   *
+ *           newest value) and are valid until the cursor is closed.          *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_vc_cursor_next(zbx_vc_cursor_t *cursor, const zbx_timespec_t **ts, const history_value_t **value)
+{
+	const zbx_vc_range_t	*range;
+
+	if (NULL == cursor->item)
+	{
+		zbx_history_record_t	*record;
+
+		if (++cursor->index >= cursor->records.values_num)
+		{
+			cursor->index = cursor->records.values_num;
+			return FAIL;
+		}
+
+		record = &cursor->records.values[cursor->index];
+
+		if (NULL != ts)
+			*ts = &record->timestamp;
+
+		if (NULL != value)
+			*value = &record->value;
+
+		return SUCCEED;
+	}
+
+	while (1)
+	{
+		if (cursor->range >= cursor->ranges.values_num)
+			return FAIL;
+
+		range = &cursor->ranges.values[cursor->range];
+
+		/* ranges are iterated from the newest (last) value */
+		if (-1 == cursor->index)
+			cursor->index = range->values_num;
+
+		if (0 <= --cursor->index)
+			break;
+
+		cursor->range++;
+	}
+
+	if (NULL != ts)
+		*ts = &range->timestamps[cursor->index];
+
+	if (NULL != value)
+		*value = &range->values[cursor->index];
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: closes value cursor, releasing the referenced item                *
+ *                                                                            *
+ * Parameters: cursor - [IN] the value cursor                                 *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_vc_cursor_close(zbx_vc_cursor_t *cursor)
+{
+#if defined(HAVE_ATOMIC_BUILTINS)
+	if (NULL != cursor->item)
+	{
+		zbx_vc_item_t	*item = (zbx_vc_item_t *)cursor->item;
+		int		remove = 0;
+
+		RDLOCK_CACHE;
+
+		if (1 == zbx_atomic_fetch_sub(&item->refcount, 1) && 0 != (item->state & ZBX_ITEM_STATE_REMOVE_PENDING))
+			remove = 1;
+
+		UNLOCK_CACHE;
+
+		/* remove the item if it was removed from cache while being referenced by cursors */
+		if (0 != remove)
+		{
+			WRLOCK_CACHE;
+
+			if (ZBX_VC_DISABLED != vc_state &&
+					NULL != (item = (zbx_vc_item_t *)zbx_hashset_search(&vc_cache->items,
+					&cursor->itemid)) && 0 == item->refcount &&
+					0 != (item->state & ZBX_ITEM_STATE_REMOVE_PENDING))
+			{
+				vc_remove_item(item);
+			}
+
+			UNLOCK_CACHE;
+		}
+
+		cursor->item = NULL;
+	}
+#endif
+	vc_cursor_clear_ranges(cursor);
+	zbx_vector_vc_range_destroy(&cursor->ranges);
+	zbx_history_record_vector_destroy(&cursor->records, cursor->value_type);
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: get the last history value with a timestamp less or equal to the  *
@@ -2674,8 +4923,10 @@ int	zbx_vc_get_statistics(zbx_vc_stats_t *stats)
 	stats->misses = vc_cache->misses;
 	stats->mode = vc_cache->mode;
 
+	LOCK_MEM;
 	stats->total_size = vc_mem->total_size;
 	stats->free_size = vc_mem->free_size;
+	UNLOCK_MEM;
 
 	UNLOCK_CACHE;
 
@@ -2748,7 +4999,9 @@ void	zbx_vc_get_mem_stats(zbx_mem_stats_t *mem)
 	}
 
 	RDLOCK_CACHE;
+	LOCK_MEM;
 	zbx_mem_get_stats(vc_mem, mem);
+	UNLOCK_MEM;
 	UNLOCK_CACHE;
 }
 
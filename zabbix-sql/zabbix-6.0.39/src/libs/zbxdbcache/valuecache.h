@@ -50,6 +50,12 @@
  *   either zbx_history_record_vector_destroy() function (free the zbx_vc_get_values()
  *   call output) or zbx_history_record_clear() function (free the zbx_vc_get_value() call output).
  *
+ *   Read-only access without copying the values is provided by value cursors. The cursor
+ *   opened with zbx_vc_cursor_open() references the item values in cache, the values are
+ *   iterated with zbx_vc_cursor_next() and the cursor must be closed with
+ *   zbx_vc_cursor_close() as soon as possible - while the cursor is open the referenced
+ *   values cannot be freed, so the item cannot be updated with out of order values.
+ *
  * Locking
  *
  *   The cache ensures synchronization between processes by using automatic locks whenever
@@ -92,6 +98,96 @@ typedef struct
 }
 zbx_vc_item_stats_t;
 
+/* value cache aggregates, see zbx_vc_get_aggregate() */
+#define ZBX_VC_AGGR_SUM		0x01
+#define ZBX_VC_AGGR_AVG		0x02
+#define ZBX_VC_AGGR_MIN		0x04
+#define ZBX_VC_AGGR_MAX		0x08
+#define ZBX_VC_AGGR_COUNT	0x10
+#define ZBX_VC_AGGR_PERCENTILE	0x20
+
+/* the value filter operators of ZBX_VC_AGGR_COUNT aggregate */
+#define ZBX_VC_AGGR_OP_EQ	0
+#define ZBX_VC_AGGR_OP_NE	1
+#define ZBX_VC_AGGR_OP_GT	2
+#define ZBX_VC_AGGR_OP_GE	3
+#define ZBX_VC_AGGR_OP_LT	4
+#define ZBX_VC_AGGR_OP_LE	5
+#define ZBX_VC_AGGR_OP_BITAND	6
+
+/* numeric item aggregates calculated directly over cached values */
+typedef struct
+{
+	/* [IN] the aggregates to calculate, see ZBX_VC_AGGR_* defines */
+	int		flags;
+
+	/* [IN] the ZBX_VC_AGGR_COUNT value filter - operator, pattern and bit mask (ZBX_VC_AGGR_OP_BITAND) */
+	int		op;
+	history_value_t	pattern;
+	zbx_uint64_t	mask;
+
+	/* [IN] ZBX_VC_AGGR_PERCENTILE - the percentage (0-100) */
+	double		percentage;
+
+	/* [OUT] the number of values in the requested range */
+	int		values_num;
+
+	/* [OUT] ZBX_VC_AGGR_COUNT - the number of values matching the filter */
+	int		count;
+
+	/* [OUT] ZBX_VC_AGGR_SUM - the sum of values in item value type, unsigned sum wraps around */
+	history_value_t	sum;
+
+	/* [OUT] ZBX_VC_AGGR_AVG - the sum of values as double */
+	double		sum_dbl;
+
+	/* [OUT] ZBX_VC_AGGR_MIN, ZBX_VC_AGGR_MAX - the minimum and maximum values */
+	history_value_t	min;
+	history_value_t	max;
+
+	/* [OUT] ZBX_VC_AGGR_PERCENTILE - the value below which the specified percentage of values falls */
+	history_value_t	percentile;
+}
+zbx_vc_aggr_t;
+
+/* a range of item values stored in value cache, accessed from the newest (values_num - 1) to the oldest (0) */
+typedef struct
+{
+	const zbx_timespec_t	*timestamps;
+	const history_value_t	*values;
+	int			values_num;
+
+	/* the values copied from compressed chunk, NULL if the values are referenced in cache */
+	void			*data;
+}
+zbx_vc_range_t;
+
+ZBX_VECTOR_DECL(vc_range, zbx_vc_range_t)
+
+/* value cursor, provides read-only access to item values stored in value cache without copying them */
+typedef struct
+{
+	zbx_uint64_t			itemid;
+	int				value_type;
+
+	/* the total number of values */
+	int				values_num;
+
+	/* the referenced value cache item, NULL if values were copied */
+	void				*item;
+
+	/* the value ranges of referenced item, from the newest to the oldest range */
+	zbx_vector_vc_range_t		ranges;
+
+	/* the values copied when they cannot be referenced in cache, in descending order */
+	zbx_vector_history_record_t	records;
+
+	/* the current range and value index */
+	int				range;
+	int				index;
+}
+zbx_vc_cursor_t;
+
 int	zbx_vc_init(char **error);
 
 void	zbx_vc_destroy(void);
@@ -106,8 +202,14 @@ int	zbx_vc_get_values(zbx_uint64_t itemid, int value_type, zbx_vector_history_re
 		int count, const zbx_timespec_t *ts);
 
 int	zbx_vc_get_value(zbx_uint64_t itemid, int value_type, const zbx_timespec_t *ts, zbx_history_record_t *value);
-
-int	zbx_vc_add_values(zbx_vector_ptr_t *history, int *ret_flush);
+int	zbx_vc_cursor_open(zbx_vc_cursor_t *cursor, zbx_uint64_t itemid, int value_type, int seconds, int count,
+		const zbx_timespec_t *ts);
+int	zbx_vc_cursor_next(zbx_vc_cursor_t *cursor, const zbx_timespec_t **ts, const history_value_t **value);
+void	zbx_vc_cursor_close(zbx_vc_cursor_t *cursor);
+int	zbx_vc_get_aggregate(zbx_uint64_t itemid, int value_type, int seconds, int count, const zbx_timespec_t *ts,
+		zbx_vc_aggr_t *aggr);
+
+void	zbx_vc_add_values(zbx_vector_ptr_t *history);
 
 int	zbx_vc_get_statistics(zbx_vc_stats_t *stats);
 
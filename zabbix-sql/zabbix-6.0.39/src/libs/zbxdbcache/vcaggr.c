@@ -0,0 +1,1084 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2025 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "vcaggr.h"
+
+#include "common.h"
+#include "valuecache.h"
+
+#if defined(HAVE_X86_SIMD)
+#	include <immintrin.h>
+#	define ZBX_TARGET_SSE42	__attribute__((target("sse4.2")))
+#	define ZBX_TARGET_AVX2	__attribute__((target("avx2")))
+#endif
+
+/*
+ * The kernels below calculate aggregates over plain double/zbx_uint64_t arrays.
+ *
+ * The floating point comparisons must match count_one_dbl() in evalfunc.c - the
+ * difference between value and pattern is compared with ZBX_DOUBLE_EPSILON.
+ * Unsigned sums wrap around in the same way as the sequential sum does. Floating
+ * point sums are calculated in several lanes, so the last digits of the result can
+ * differ from the sequential sum.
+ */
+
+/******************************************************************************
+ *                                                                            *
+ * Scalar kernels, used when SIMD instructions are not available              *
+ *                                                                            *
+ ******************************************************************************/
+
+static double	vc_aggr_sum_dbl(const double *values, int values_num)
+{
+	double	sum = 0;
+	int	i;
+
+	for (i = 0; i < values_num; i++)
+		sum += values[i];
+
+	return sum;
+}
+
+static zbx_uint64_t	vc_aggr_sum_ui64(const zbx_uint64_t *values, int values_num)
+{
+	zbx_uint64_t	sum = 0;
+	int		i;
+
+	for (i = 0; i < values_num; i++)
+		sum += values[i];
+
+	return sum;
+}
+
+static double	vc_aggr_sum_ui64_dbl(const zbx_uint64_t *values, int values_num)
+{
+	double	sum = 0;
+	int	i;
+
+	for (i = 0; i < values_num; i++)
+		sum += (double)values[i];
+
+	return sum;
+}
+
+static void	vc_aggr_minmax_dbl(const double *values, int values_num, double *min, double *max)
+{
+	int	i;
+
+	*min = *max = values[0];
+
+	for (i = 1; i < values_num; i++)
+	{
+		if (values[i] < *min)
+			*min = values[i];
+
+		if (values[i] > *max)
+			*max = values[i];
+	}
+}
+
+static void	vc_aggr_minmax_ui64(const zbx_uint64_t *values, int values_num, zbx_uint64_t *min, zbx_uint64_t *max)
+{
+	int	i;
+
+	*min = *max = values[0];
+
+	for (i = 1; i < values_num; i++)
+	{
+		if (values[i] < *min)
+			*min = values[i];
+
+		if (values[i] > *max)
+			*max = values[i];
+	}
+}
+
+static int	vc_aggr_count_dbl(const double *values, int values_num, int op, double pattern)
+{
+	int	i, count = 0;
+
+	for (i = 0; i < values_num; i++)
+	{
+		switch (op)
+		{
+			case ZBX_VC_AGGR_OP_EQ:
+				if (fabs(values[i] - pattern) <= ZBX_DOUBLE_EPSILON)
+					count++;
+				break;
+			case ZBX_VC_AGGR_OP_NE:
+				if (!(fabs(values[i] - pattern) <= ZBX_DOUBLE_EPSILON))
+					count++;
+				break;
+			case ZBX_VC_AGGR_OP_GT:
+				if (values[i] - pattern > ZBX_DOUBLE_EPSILON)
+					count++;
+				break;
+			case ZBX_VC_AGGR_OP_GE:
+				if (values[i] - pattern >= -ZBX_DOUBLE_EPSILON)
+					count++;
+				break;
+			case ZBX_VC_AGGR_OP_LT:
+				if (pattern - values[i] > ZBX_DOUBLE_EPSILON)
+					count++;
+				break;
+			case ZBX_VC_AGGR_OP_LE:
+				if (pattern - values[i] >= -ZBX_DOUBLE_EPSILON)
+					count++;
+				break;
+		}
+	}
+
+	return count;
+}
+
+static int	vc_aggr_count_ui64(const zbx_uint64_t *values, int values_num, int op, zbx_uint64_t pattern,
+		zbx_uint64_t mask)
+{
+	int	i, count = 0;
+
+	for (i = 0; i < values_num; i++)
+	{
+		switch (op)
+		{
+			case ZBX_VC_AGGR_OP_EQ:
+				if (values[i] == pattern)
+					count++;
+				break;
+			case ZBX_VC_AGGR_OP_NE:
+				if (values[i] != pattern)
+					count++;
+				break;
+			case ZBX_VC_AGGR_OP_GT:
+				if (values[i] > pattern)
+					count++;
+				break;
+			case ZBX_VC_AGGR_OP_GE:
+				if (values[i] >= pattern)
+					count++;
+				break;
+			case ZBX_VC_AGGR_OP_LT:
+				if (values[i] < pattern)
+					count++;
+				break;
+			case ZBX_VC_AGGR_OP_LE:
+				if (values[i] <= pattern)
+					count++;
+				break;
+			case ZBX_VC_AGGR_OP_BITAND:
+				if ((values[i] & mask) == pattern)
+					count++;
+				break;
+		}
+	}
+
+	return count;
+}
+
+static void	vc_aggr_partition_dbl(double *values, int values_num, double pivot, double *dst, int *lt_num,
+		int *gt_num)
+{
+	int	i, lt = 0, gt = 0;
+
+	for (i = 0; i < values_num; i++)
+	{
+		if (values[i] < pivot)
+			dst[lt++] = values[i];
+		else if (values[i] > pivot)
+			values[gt++] = values[i];
+	}
+
+	*lt_num = lt;
+	*gt_num = gt;
+}
+
+static void	vc_aggr_partition_ui64(zbx_uint64_t *values, int values_num, zbx_uint64_t pivot, zbx_uint64_t *dst,
+		int *lt_num, int *gt_num)
+{
+	int	i, lt = 0, gt = 0;
+
+	for (i = 0; i < values_num; i++)
+	{
+		if (values[i] < pivot)
+			dst[lt++] = values[i];
+		else if (values[i] > pivot)
+			values[gt++] = values[i];
+	}
+
+	*lt_num = lt;
+	*gt_num = gt;
+}
+
+static const zbx_vc_aggr_kernels_t	vc_aggr_kernels_scalar = {
+	"scalar",
+	vc_aggr_sum_dbl,
+	vc_aggr_sum_ui64,
+	vc_aggr_sum_ui64_dbl,
+	vc_aggr_minmax_dbl,
+	vc_aggr_minmax_ui64,
+	vc_aggr_count_dbl,
+	vc_aggr_count_ui64,
+	vc_aggr_partition_dbl,
+	vc_aggr_partition_ui64
+};
+
+#if defined(HAVE_X86_SIMD)
+
+/* sign bit of 64-bit integer, used to compare unsigned values with signed comparison instructions */
+#define VC_AGGR_SIGN_BIT	((long long)__UINT64_C(0x8000000000000000))
+
+/* uint64 to double conversion constants: 2^52, 2^84 and 2^84 + 2^52 */
+#define VC_AGGR_EXP52		0x4330000000000000LL
+#define VC_AGGR_EXP84		0x4530000000000000LL
+#define VC_AGGR_EXP84_52	19342813118337666422669312.0
+
+/******************************************************************************
+ *                                                                            *
+ * SSE4.2 kernels, processing 2 values per instruction                        *
+ *                                                                            *
+ ******************************************************************************/
+
+ZBX_TARGET_SSE42 static double	vc_aggr_sum_dbl_sse42(const double *values, int values_num)
+{
+	__m128d	acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+	double	lanes[2], sum;
+	int	i;
+
+	for (i = 0; i + 4 <= values_num; i += 4)
+	{
+		acc0 = _mm_add_pd(acc0, _mm_loadu_pd(values + i));
+		acc1 = _mm_add_pd(acc1, _mm_loadu_pd(values + i + 2));
+	}
+
+	_mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+	sum = lanes[0] + lanes[1];
+
+	for (; i < values_num; i++)
+		sum += values[i];
+
+	return sum;
+}
+
+ZBX_TARGET_SSE42 static zbx_uint64_t	vc_aggr_sum_ui64_sse42(const zbx_uint64_t *values, int values_num)
+{
+	__m128i		acc = _mm_setzero_si128();
+	zbx_uint64_t	lanes[2], sum;
+	int		i;
+
+	for (i = 0; i + 2 <= values_num; i += 2)
+		acc = _mm_add_epi64(acc, _mm_loadu_si128((const __m128i *)(values + i)));
+
+	_mm_storeu_si128((__m128i *)lanes, acc);
+	sum = lanes[0] + lanes[1];
+
+	for (; i < values_num; i++)
+		sum += values[i];
+
+	return sum;
+}
+
+ZBX_TARGET_SSE42 static double	vc_aggr_sum_ui64_dbl_sse42(const zbx_uint64_t *values, int values_num)
+{
+	__m128i	lo_mask = _mm_set1_epi64x(0xffffffffLL), exp52 = _mm_set1_epi64x(VC_AGGR_EXP52),
+		exp84 = _mm_set1_epi64x(VC_AGGR_EXP84);
+	__m128d	acc = _mm_setzero_pd(), bias = _mm_set1_pd(VC_AGGR_EXP84_52);
+	double	lanes[2], sum;
+	int	i;
+
+	for (i = 0; i + 2 <= values_num; i += 2)
+	{
+		__m128i	v = _mm_loadu_si128((const __m128i *)(values + i));
+		__m128d	lo, hi;
+
+		lo = _mm_castsi128_pd(_mm_or_si128(_mm_and_si128(v, lo_mask), exp52));
+		hi = _mm_castsi128_pd(_mm_or_si128(_mm_srli_epi64(v, 32), exp84));
+		acc = _mm_add_pd(acc, _mm_add_pd(_mm_sub_pd(hi, bias), lo));
+	}
+
+	_mm_storeu_pd(lanes, acc);
+	sum = lanes[0] + lanes[1];
+
+	for (; i < values_num; i++)
+		sum += (double)values[i];
+
+	return sum;
+}
+
+ZBX_TARGET_SSE42 static void	vc_aggr_minmax_dbl_sse42(const double *values, int values_num, double *min,
+		double *max)
+{
+	__m128d	vmin, vmax;
+	double	lanes_min[2], lanes_max[2];
+	int	i;
+
+	if (2 > values_num)
+	{
+		vc_aggr_minmax_dbl(values, values_num, min, max);
+		return;
+	}
+
+	vmin = vmax = _mm_loadu_pd(values);
+
+	for (i = 2; i + 2 <= values_num; i += 2)
+	{
+		__m128d	v = _mm_loadu_pd(values + i);
+
+		vmin = _mm_min_pd(vmin, v);
+		vmax = _mm_max_pd(vmax, v);
+	}
+
+	_mm_storeu_pd(lanes_min, vmin);
+	_mm_storeu_pd(lanes_max, vmax);
+
+	*min = (lanes_min[0] < lanes_min[1] ? lanes_min[0] : lanes_min[1]);
+	*max = (lanes_max[0] > lanes_max[1] ? lanes_max[0] : lanes_max[1]);
+
+	for (; i < values_num; i++)
+	{
+		if (values[i] < *min)
+			*min = values[i];
+
+		if (values[i] > *max)
+			*max = values[i];
+	}
+}
+
+ZBX_TARGET_SSE42 static void	vc_aggr_minmax_ui64_sse42(const zbx_uint64_t *values, int values_num,
+		zbx_uint64_t *min, zbx_uint64_t *max)
+{
+	__m128i		vmin, vmax, sign = _mm_set1_epi64x(VC_AGGR_SIGN_BIT);
+	zbx_uint64_t	lanes_min[2], lanes_max[2];
+	int		i;
+
+	if (2 > values_num)
+	{
+		vc_aggr_minmax_ui64(values, values_num, min, max);
+		return;
+	}
+
+	/* values are kept with flipped sign bit so signed comparison gives unsigned order */
+	vmin = vmax = _mm_xor_si128(_mm_loadu_si128((const __m128i *)values), sign);
+
+	for (i = 2; i + 2 <= values_num; i += 2)
+	{
+		__m128i	v = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(values + i)), sign);
+
+		vmin = _mm_blendv_epi8(vmin, v, _mm_cmpgt_epi64(vmin, v));
+		vmax = _mm_blendv_epi8(vmax, v, _mm_cmpgt_epi64(v, vmax));
+	}
+
+	_mm_storeu_si128((__m128i *)lanes_min, _mm_xor_si128(vmin, sign));
+	_mm_storeu_si128((__m128i *)lanes_max, _mm_xor_si128(vmax, sign));
+
+	*min = (lanes_min[0] < lanes_min[1] ? lanes_min[0] : lanes_min[1]);
+	*max = (lanes_max[0] > lanes_max[1] ? lanes_max[0] : lanes_max[1]);
+
+	for (; i < values_num; i++)
+	{
+		if (values[i] < *min)
+			*min = values[i];
+
+		if (values[i] > *max)
+			*max = values[i];
+	}
+}
+
+ZBX_TARGET_SSE42 static int	vc_aggr_count_dbl_sse42(const double *values, int values_num, int op,
+		double pattern)
+{
+	__m128d	p = _mm_set1_pd(pattern), eps = _mm_set1_pd(ZBX_DOUBLE_EPSILON),
+		neps = _mm_set1_pd(-ZBX_DOUBLE_EPSILON), abs_mask = _mm_castsi128_pd(_mm_set1_epi64x(~VC_AGGR_SIGN_BIT));
+	int	i, count = 0;
+
+	for (i = 0; i + 2 <= values_num; i += 2)
+	{
+		__m128d	v = _mm_loadu_pd(values + i), m;
+
+		switch (op)
+		{
+			case ZBX_VC_AGGR_OP_EQ:
+				m = _mm_cmple_pd(_mm_and_pd(_mm_sub_pd(v, p), abs_mask), eps);
+				break;
+			case ZBX_VC_AGGR_OP_NE:
+				m = _mm_cmpnle_pd(_mm_and_pd(_mm_sub_pd(v, p), abs_mask), eps);
+				break;
+			case ZBX_VC_AGGR_OP_GT:
+				m = _mm_cmpgt_pd(_mm_sub_pd(v, p), eps);
+				break;
+			case ZBX_VC_AGGR_OP_GE:
+				m = _mm_cmpge_pd(_mm_sub_pd(v, p), neps);
+				break;
+			case ZBX_VC_AGGR_OP_LT:
+				m = _mm_cmpgt_pd(_mm_sub_pd(p, v), eps);
+				break;
+			case ZBX_VC_AGGR_OP_LE:
+				m = _mm_cmpge_pd(_mm_sub_pd(p, v), neps);
+				break;
+			default:
+				return 0;
+		}
+
+		count += __builtin_popcount(_mm_movemask_pd(m));
+	}
+
+	return count + vc_aggr_count_dbl(values + i, values_num - i, op, pattern);
+}
+
+ZBX_TARGET_SSE42 static int	vc_aggr_count_ui64_sse42(const zbx_uint64_t *values, int values_num, int op,
+		zbx_uint64_t pattern, zbx_uint64_t mask)
+{
+	__m128i	sign = _mm_set1_epi64x(VC_AGGR_SIGN_BIT), p = _mm_set1_epi64x((long long)pattern),
+		sp = _mm_xor_si128(p, sign), vmask = _mm_set1_epi64x((long long)mask);
+	int	i, count = 0, matched;
+
+	for (i = 0; i + 2 <= values_num; i += 2)
+	{
+		__m128i	v = _mm_loadu_si128((const __m128i *)(values + i)), sv = _mm_xor_si128(v, sign);
+
+		switch (op)
+		{
+			case ZBX_VC_AGGR_OP_EQ:
+				matched = __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(v, p))));
+				break;
+			case ZBX_VC_AGGR_OP_NE:
+				matched = 2 - __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(
+						_mm_cmpeq_epi64(v, p))));
+				break;
+			case ZBX_VC_AGGR_OP_GT:
+				matched = __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(sv, sp))));
+				break;
+			case ZBX_VC_AGGR_OP_GE:
+				matched = 2 - __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(
+						_mm_cmpgt_epi64(sp, sv))));
+				break;
+			case ZBX_VC_AGGR_OP_LT:
+				matched = __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(sp, sv))));
+				break;
+			case ZBX_VC_AGGR_OP_LE:
+				matched = 2 - __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(
+						_mm_cmpgt_epi64(sv, sp))));
+				break;
+			case ZBX_VC_AGGR_OP_BITAND:
+				matched = __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(
+						_mm_cmpeq_epi64(_mm_and_si128(v, vmask), p))));
+				break;
+			default:
+				return 0;
+		}
+
+		count += matched;
+	}
+
+	return count + vc_aggr_count_ui64(values + i, values_num - i, op, pattern, mask);
+}
+
+ZBX_TARGET_SSE42 static void	vc_aggr_partition_dbl_sse42(double *values, int values_num, double pivot,
+		double *dst, int *lt_num, int *gt_num)
+{
+	__m128d	p = _mm_set1_pd(pivot);
+	int	i, lt = 0, gt = 0;
+
+	/* the values greater than pivot overwrite the values already loaded, gt never exceeds i */
+	for (i = 0; i + 2 <= values_num; i += 2)
+	{
+		__m128d	v = _mm_loadu_pd(values + i);
+		int	lt_mask = _mm_movemask_pd(_mm_cmplt_pd(v, p)), gt_mask = _mm_movemask_pd(_mm_cmpgt_pd(v, p));
+
+		/* when only the second value matches move it to the first lane, the rest is overwritten later */
+		_mm_storeu_pd(dst + lt, 2 == lt_mask ? _mm_unpackhi_pd(v, v) : v);
+		_mm_storeu_pd(values + gt, 2 == gt_mask ? _mm_unpackhi_pd(v, v) : v);
+
+		lt += __builtin_popcount(lt_mask);
+		gt += __builtin_popcount(gt_mask);
+	}
+
+	for (; i < values_num; i++)
+	{
+		if (values[i] < pivot)
+			dst[lt++] = values[i];
+		else if (values[i] > pivot)
+			values[gt++] = values[i];
+	}
+
+	*lt_num = lt;
+	*gt_num = gt;
+}
+
+ZBX_TARGET_SSE42 static void	vc_aggr_partition_ui64_sse42(zbx_uint64_t *values, int values_num,
+		zbx_uint64_t pivot, zbx_uint64_t *dst, int *lt_num, int *gt_num)
+{
+	__m128i	sign = _mm_set1_epi64x(VC_AGGR_SIGN_BIT), sp = _mm_xor_si128(_mm_set1_epi64x((long long)pivot), sign);
+	int	i, lt = 0, gt = 0;
+
+	for (i = 0; i + 2 <= values_num; i += 2)
+	{
+		__m128i	v = _mm_loadu_si128((const __m128i *)(values + i)), sv = _mm_xor_si128(v, sign);
+		int	lt_mask = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(sp, sv))),
+			gt_mask = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(sv, sp)));
+
+		_mm_storeu_si128((__m128i *)(dst + lt), 2 == lt_mask ? _mm_unpackhi_epi64(v, v) : v);
+		_mm_storeu_si128((__m128i *)(values + gt), 2 == gt_mask ? _mm_unpackhi_epi64(v, v) : v);
+
+		lt += __builtin_popcount(lt_mask);
+		gt += __builtin_popcount(gt_mask);
+	}
+
+	for (; i < values_num; i++)
+	{
+		if (values[i] < pivot)
+			dst[lt++] = values[i];
+		else if (values[i] > pivot)
+			values[gt++] = values[i];
+	}
+
+	*lt_num = lt;
+	*gt_num = gt;
+}
+
+static const zbx_vc_aggr_kernels_t	vc_aggr_kernels_sse42 = {
+	"sse4.2",
+	vc_aggr_sum_dbl_sse42,
+	vc_aggr_sum_ui64_sse42,
+	vc_aggr_sum_ui64_dbl_sse42,
+	vc_aggr_minmax_dbl_sse42,
+	vc_aggr_minmax_ui64_sse42,
+	vc_aggr_count_dbl_sse42,
+	vc_aggr_count_ui64_sse42,
+	vc_aggr_partition_dbl_sse42,
+	vc_aggr_partition_ui64_sse42
+};
+
+/******************************************************************************
+ *                                                                            *
+ * AVX2 kernels, processing 4 values per instruction                          *
+ *                                                                            *
+ ******************************************************************************/
+
+/* 32-bit lane permutations moving the 64-bit lanes selected by 4-bit mask to the beginning of vector */
+static const int	vc_aggr_compress_avx2[16][8] = {
+	{0, 0, 0, 0, 0, 0, 0, 0},
+	{0, 1, 0, 0, 0, 0, 0, 0},
+	{2, 3, 0, 0, 0, 0, 0, 0},
+	{0, 1, 2, 3, 0, 0, 0, 0},
+	{4, 5, 0, 0, 0, 0, 0, 0},
+	{0, 1, 4, 5, 0, 0, 0, 0},
+	{2, 3, 4, 5, 0, 0, 0, 0},
+	{0, 1, 2, 3, 4, 5, 0, 0},
+	{6, 7, 0, 0, 0, 0, 0, 0},
+	{0, 1, 6, 7, 0, 0, 0, 0},
+	{2, 3, 6, 7, 0, 0, 0, 0},
+	{0, 1, 2, 3, 6, 7, 0, 0},
+	{4, 5, 6, 7, 0, 0, 0, 0},
+	{0, 1, 4, 5, 6, 7, 0, 0},
+	{2, 3, 4, 5, 6, 7, 0, 0},
+	{0, 1, 2, 3, 4, 5, 6, 7}
+};
+
+ZBX_TARGET_AVX2 static __m256i	vc_aggr_compress_epi64_avx2(__m256i v, int mask)
+{
+	return _mm256_permutevar8x32_epi32(v, _mm256_loadu_si256((const __m256i *)vc_aggr_compress_avx2[mask]));
+}
+
+ZBX_TARGET_AVX2 static double	vc_aggr_sum_dbl_avx2(const double *values, int values_num)
+{
+	__m256d	acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+	double	lanes[4], sum;
+	int	i;
+
+	for (i = 0; i + 8 <= values_num; i += 8)
+	{
+		acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(values + i));
+		acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(values + i + 4));
+	}
+
+	_mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+	sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+
+	for (; i < values_num; i++)
+		sum += values[i];
+
+	return sum;
+}
+
+ZBX_TARGET_AVX2 static zbx_uint64_t	vc_aggr_sum_ui64_avx2(const zbx_uint64_t *values, int values_num)
+{
+	__m256i		acc = _mm256_setzero_si256();
+	zbx_uint64_t	lanes[4], sum;
+	int		i;
+
+	for (i = 0; i + 4 <= values_num; i += 4)
+		acc = _mm256_add_epi64(acc, _mm256_loadu_si256((const __m256i *)(values + i)));
+
+	_mm256_storeu_si256((__m256i *)lanes, acc);
+	sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+	for (; i < values_num; i++)
+		sum += values[i];
+
+	return sum;
+}
+
+ZBX_TARGET_AVX2 static double	vc_aggr_sum_ui64_dbl_avx2(const zbx_uint64_t *values, int values_num)
+{
+	__m256i	lo_mask = _mm256_set1_epi64x(0xffffffffLL), exp52 = _mm256_set1_epi64x(VC_AGGR_EXP52),
+		exp84 = _mm256_set1_epi64x(VC_AGGR_EXP84);
+	__m256d	acc = _mm256_setzero_pd(), bias = _mm256_set1_pd(VC_AGGR_EXP84_52);
+	double	lanes[4], sum;
+	int	i;
+
+	for (i = 0; i + 4 <= values_num; i += 4)
+	{
+		__m256i	v = _mm256_loadu_si256((const __m256i *)(values + i));
+		__m256d	lo, hi;
+
+		lo = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(v, lo_mask), exp52));
+		hi = _mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(v, 32), exp84));
+		acc = _mm256_add_pd(acc, _mm256_add_pd(_mm256_sub_pd(hi, bias), lo));
+	}
+
+	_mm256_storeu_pd(lanes, acc);
+	sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+
+	for (; i < values_num; i++)
+		sum += (double)values[i];
+
+	return sum;
+}
+
+ZBX_TARGET_AVX2 static void	vc_aggr_minmax_dbl_avx2(const double *values, int values_num, double *min,
+		double *max)
+{
+	__m256d	vmin, vmax;
+	double	lanes_min[4], lanes_max[4];
+	int	i, j;
+
+	if (4 > values_num)
+	{
+		vc_aggr_minmax_dbl(values, values_num, min, max);
+		return;
+	}
+
+	vmin = vmax = _mm256_loadu_pd(values);
+
+	for (i = 4; i + 4 <= values_num; i += 4)
+	{
+		__m256d	v = _mm256_loadu_pd(values + i);
+
+		vmin = _mm256_min_pd(vmin, v);
+		vmax = _mm256_max_pd(vmax, v);
+	}
+
+	_mm256_storeu_pd(lanes_min, vmin);
+	_mm256_storeu_pd(lanes_max, vmax);
+
+	*min = lanes_min[0];
+	*max = lanes_max[0];
+
+	for (j = 1; j < 4; j++)
+	{
+		if (lanes_min[j] < *min)
+			*min = lanes_min[j];
+
+		if (lanes_max[j] > *max)
+			*max = lanes_max[j];
+	}
+
+	for (; i < values_num; i++)
+	{
+		if (values[i] < *min)
+			*min = values[i];
+
+		if (values[i] > *max)
+			*max = values[i];
+	}
+}
+
+ZBX_TARGET_AVX2 static void	vc_aggr_minmax_ui64_avx2(const zbx_uint64_t *values, int values_num,
+		zbx_uint64_t *min, zbx_uint64_t *max)
+{
+	__m256i		vmin, vmax, sign = _mm256_set1_epi64x(VC_AGGR_SIGN_BIT);
+	zbx_uint64_t	lanes_min[4], lanes_max[4];
+	int		i, j;
+
+	if (4 > values_num)
+	{
+		vc_aggr_minmax_ui64(values, values_num, min, max);
+		return;
+	}
+
+	/* values are kept with flipped sign bit so signed comparison gives unsigned order */
+	vmin = vmax = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)values), sign);
+
+	for (i = 4; i + 4 <= values_num; i += 4)
+	{
+		__m256i	v = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(values + i)), sign);
+
+		vmin = _mm256_blendv_epi8(vmin, v, _mm256_cmpgt_epi64(vmin, v));
+		vmax = _mm256_blendv_epi8(vmax, v, _mm256_cmpgt_epi64(v, vmax));
+	}
+
+	_mm256_storeu_si256((__m256i *)lanes_min, _mm256_xor_si256(vmin, sign));
+	_mm256_storeu_si256((__m256i *)lanes_max, _mm256_xor_si256(vmax, sign));
+
+	*min = lanes_min[0];
+	*max = lanes_max[0];
+
+	for (j = 1; j < 4; j++)
+	{
+		if (lanes_min[j] < *min)
+			*min = lanes_min[j];
+
+		if (lanes_max[j] > *max)
+			*max = lanes_max[j];
+	}
+
+	for (; i < values_num; i++)
+	{
+		if (values[i] < *min)
+			*min = values[i];
+
+		if (values[i] > *max)
+			*max = values[i];
+	}
+}
+
+ZBX_TARGET_AVX2 static int	vc_aggr_count_dbl_avx2(const double *values, int values_num, int op,
+		double pattern)
+{
+	__m256d	p = _mm256_set1_pd(pattern), eps = _mm256_set1_pd(ZBX_DOUBLE_EPSILON),
+		neps = _mm256_set1_pd(-ZBX_DOUBLE_EPSILON),
+		abs_mask = _mm256_castsi256_pd(_mm256_set1_epi64x(~VC_AGGR_SIGN_BIT));
+	int	i, count = 0;
+
+	for (i = 0; i + 4 <= values_num; i += 4)
+	{
+		__m256d	v = _mm256_loadu_pd(values + i), m;
+
+		switch (op)
+		{
+			case ZBX_VC_AGGR_OP_EQ:
+				m = _mm256_cmp_pd(_mm256_and_pd(_mm256_sub_pd(v, p), abs_mask), eps, _CMP_LE_OQ);
+				break;
+			case ZBX_VC_AGGR_OP_NE:
+				m = _mm256_cmp_pd(_mm256_and_pd(_mm256_sub_pd(v, p), abs_mask), eps, _CMP_NLE_UQ);
+				break;
+			case ZBX_VC_AGGR_OP_GT:
+				m = _mm256_cmp_pd(_mm256_sub_pd(v, p), eps, _CMP_GT_OQ);
+				break;
+			case ZBX_VC_AGGR_OP_GE:
+				m = _mm256_cmp_pd(_mm256_sub_pd(v, p), neps, _CMP_GE_OQ);
+				break;
+			case ZBX_VC_AGGR_OP_LT:
+				m = _mm256_cmp_pd(_mm256_sub_pd(p, v), eps, _CMP_GT_OQ);
+				break;
+			case ZBX_VC_AGGR_OP_LE:
+				m = _mm256_cmp_pd(_mm256_sub_pd(p, v), neps, _CMP_GE_OQ);
+				break;
+			default:
+				return 0;
+		}
+
+		count += __builtin_popcount(_mm256_movemask_pd(m));
+	}
+
+	return count + vc_aggr_count_dbl(values + i, values_num - i, op, pattern);
+}
+
+ZBX_TARGET_AVX2 static int	vc_aggr_count_ui64_avx2(const zbx_uint64_t *values, int values_num, int op,
+		zbx_uint64_t pattern, zbx_uint64_t mask)
+{
+	__m256i	sign = _mm256_set1_epi64x(VC_AGGR_SIGN_BIT), p = _mm256_set1_epi64x((long long)pattern),
+		sp = _mm256_xor_si256(p, sign), vmask = _mm256_set1_epi64x((long long)mask);
+	int	i, count = 0, matched;
+
+	for (i = 0; i + 4 <= values_num; i += 4)
+	{
+		__m256i	v = _mm256_loadu_si256((const __m256i *)(values + i)), sv = _mm256_xor_si256(v, sign);
+
+		switch (op)
+		{
+			case ZBX_VC_AGGR_OP_EQ:
+				matched = __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(
+						_mm256_cmpeq_epi64(v, p))));
+				break;
+			case ZBX_VC_AGGR_OP_NE:
+				matched = 4 - __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(
+						_mm256_cmpeq_epi64(v, p))));
+				break;
+			case ZBX_VC_AGGR_OP_GT:
+				matched = __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(
+						_mm256_cmpgt_epi64(sv, sp))));
+				break;
+			case ZBX_VC_AGGR_OP_GE:
+				matched = 4 - __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(
+						_mm256_cmpgt_epi64(sp, sv))));
+				break;
+			case ZBX_VC_AGGR_OP_LT:
+				matched = __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(
+						_mm256_cmpgt_epi64(sp, sv))));
+				break;
+			case ZBX_VC_AGGR_OP_LE:
+				matched = 4 - __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(
+						_mm256_cmpgt_epi64(sv, sp))));
+				break;
+			case ZBX_VC_AGGR_OP_BITAND:
+				matched = __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(
+						_mm256_cmpeq_epi64(_mm256_and_si256(v, vmask), p))));
+				break;
+			default:
+				return 0;
+		}
+
+		count += matched;
+	}
+
+	return count + vc_aggr_count_ui64(values + i, values_num - i, op, pattern, mask);
+}
+
+ZBX_TARGET_AVX2 static void	vc_aggr_partition_dbl_avx2(double *values, int values_num, double pivot,
+		double *dst, int *lt_num, int *gt_num)
+{
+	__m256d	p = _mm256_set1_pd(pivot);
+	int	i, lt = 0, gt = 0;
+
+	/* the values greater than pivot overwrite the values already loaded, gt never exceeds i */
+	for (i = 0; i + 4 <= values_num; i += 4)
+	{
+		__m256i	v = _mm256_loadu_si256((const __m256i *)(values + i));
+		int	lt_mask = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_castsi256_pd(v), p, _CMP_LT_OQ)),
+			gt_mask = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_castsi256_pd(v), p, _CMP_GT_OQ));
+
+		/* only the first popcount(mask) lanes are valid, the rest is overwritten later */
+		_mm256_storeu_si256((__m256i *)(dst + lt), vc_aggr_compress_epi64_avx2(v, lt_mask));
+		_mm256_storeu_si256((__m256i *)(values + gt), vc_aggr_compress_epi64_avx2(v, gt_mask));
+
+		lt += __builtin_popcount(lt_mask);
+		gt += __builtin_popcount(gt_mask);
+	}
+
+	for (; i < values_num; i++)
+	{
+		if (values[i] < pivot)
+			dst[lt++] = values[i];
+		else if (values[i] > pivot)
+			values[gt++] = values[i];
+	}
+
+	*lt_num = lt;
+	*gt_num = gt;
+}
+
+ZBX_TARGET_AVX2 static void	vc_aggr_partition_ui64_avx2(zbx_uint64_t *values, int values_num,
+		zbx_uint64_t pivot, zbx_uint64_t *dst, int *lt_num, int *gt_num)
+{
+	__m256i	sign = _mm256_set1_epi64x(VC_AGGR_SIGN_BIT),
+		sp = _mm256_xor_si256(_mm256_set1_epi64x((long long)pivot), sign);
+	int	i, lt = 0, gt = 0;
+
+	for (i = 0; i + 4 <= values_num; i += 4)
+	{
+		__m256i	v = _mm256_loadu_si256((const __m256i *)(values + i)), sv = _mm256_xor_si256(v, sign);
+		int	lt_mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(sp, sv))),
+			gt_mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(sv, sp)));
+
+		_mm256_storeu_si256((__m256i *)(dst + lt), vc_aggr_compress_epi64_avx2(v, lt_mask));
+		_mm256_storeu_si256((__m256i *)(values + gt), vc_aggr_compress_epi64_avx2(v, gt_mask));
+
+		lt += __builtin_popcount(lt_mask);
+		gt += __builtin_popcount(gt_mask);
+	}
+
+	for (; i < values_num; i++)
+	{
+		if (values[i] < pivot)
+			dst[lt++] = values[i];
+		else if (values[i] > pivot)
+			values[gt++] = values[i];
+	}
+
+	*lt_num = lt;
+	*gt_num = gt;
+}
+
+static const zbx_vc_aggr_kernels_t	vc_aggr_kernels_avx2 = {
+	"avx2",
+	vc_aggr_sum_dbl_avx2,
+	vc_aggr_sum_ui64_avx2,
+	vc_aggr_sum_ui64_dbl_avx2,
+	vc_aggr_minmax_dbl_avx2,
+	vc_aggr_minmax_ui64_avx2,
+	vc_aggr_count_dbl_avx2,
+	vc_aggr_count_ui64_avx2,
+	vc_aggr_partition_dbl_avx2,
+	vc_aggr_partition_ui64_avx2
+};
+
+#endif
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: returns aggregate kernels best suited for the current CPU         *
+ *                                                                            *
+ * Comments: The kernels are selected during the first call.                  *
+ *                                                                            *
+ ******************************************************************************/
+const zbx_vc_aggr_kernels_t	*zbx_vc_aggr_get_kernels(void)
+{
+	static const zbx_vc_aggr_kernels_t	*kernels = NULL;
+
+	if (NULL != kernels)
+		return kernels;
+
+	kernels = &vc_aggr_kernels_scalar;
+#if defined(HAVE_X86_SIMD)
+	__builtin_cpu_init();
+
+	if (0 != __builtin_cpu_supports("avx2"))
+		kernels = &vc_aggr_kernels_avx2;
+	else if (0 != __builtin_cpu_supports("sse4.2"))
+		kernels = &vc_aggr_kernels_sse42;
+#endif
+	return kernels;
+}
+
+/* the number of values sorted instead of partitioning further */
+#define VC_AGGR_SELECT_SORT_MAX		16
+
+/* the number of partitioning steps after which the rest is sorted, protects from unlucky pivots */
+#define VC_AGGR_SELECT_STEPS_MAX	64
+
+static int	vc_aggr_compare_dbl(const void *d1, const void *d2)
+{
+	ZBX_RETURN_IF_NOT_EQUAL(*(const double *)d1, *(const double *)d2);
+
+	return 0;
+}
+
+static double	vc_aggr_median3_dbl(double a, double b, double c)
+{
+	if (a < b)
+		return b < c ? b : (a < c ? c : a);
+
+	return a < c ? a : (b < c ? c : b);
+}
+
+static zbx_uint64_t	vc_aggr_median3_ui64(zbx_uint64_t a, zbx_uint64_t b, zbx_uint64_t c)
+{
+	if (a < b)
+		return b < c ? b : (a < c ? c : a);
+
+	return a < c ? a : (b < c ? c : b);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: finds the value at the specified position of sorted values        *
+ *                                                                            *
+ * Parameters: values     - [IN/OUT] the values, reordered by the function    *
+ *             values_num - [IN] the number of values                         *
+ *             k          - [IN] the position (0 - the smallest value)        *
+ *                                                                            *
+ * Return value: the k-th smallest value                                      *
+ *                                                                            *
+ * Comments: Quickselect with the partitioning done by the partition kernels. *
+ *           The values equal to pivot are dropped at each step, so the       *
+ *           range shrinks by at least one value even if all values match.    *
+ *           The partitions alternate between the values and a scratch        *
+ *           buffer of the same size.                                         *
+ *                                                                            *
+ ******************************************************************************/
+double	zbx_vc_aggr_select_dbl(double *values, int values_num, int k)
+{
+	const zbx_vc_aggr_kernels_t	*kernels = zbx_vc_aggr_get_kernels();
+	double				*scratch, *dst, *tmp, pivot;
+	int				lt, gt, steps = 0;
+
+	dst = scratch = (double *)zbx_malloc(NULL, sizeof(double) * (size_t)values_num);
+
+	while (VC_AGGR_SELECT_SORT_MAX < values_num && VC_AGGR_SELECT_STEPS_MAX > steps++)
+	{
+		pivot = vc_aggr_median3_dbl(values[0], values[values_num / 2], values[values_num - 1]);
+		kernels->partition_dbl(values, values_num, pivot, dst, &lt, &gt);
+
+		if (k < lt)
+		{
+			tmp = values;
+			values = dst;
+			dst = tmp;
+			values_num = lt;
+		}
+		else if (k >= values_num - gt)
+		{
+			k -= values_num - gt;
+			values_num = gt;
+		}
+		else
+			goto out;
+	}
+
+	qsort(values, (size_t)values_num, sizeof(double), vc_aggr_compare_dbl);
+	pivot = values[k];
+out:
+	zbx_free(scratch);
+
+	return pivot;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: finds the value at the specified position of sorted values        *
+ *                                                                            *
+ * Comments: See zbx_vc_aggr_select_dbl().                                    *
+ *                                                                            *
+ ******************************************************************************/
+zbx_uint64_t	zbx_vc_aggr_select_ui64(zbx_uint64_t *values, int values_num, int k)
+{
+	const zbx_vc_aggr_kernels_t	*kernels = zbx_vc_aggr_get_kernels();
+	zbx_uint64_t			*scratch, *dst, *tmp, pivot;
+	int				lt, gt, steps = 0;
+
+	dst = scratch = (zbx_uint64_t *)zbx_malloc(NULL, sizeof(zbx_uint64_t) * (size_t)values_num);
+
+	while (VC_AGGR_SELECT_SORT_MAX < values_num && VC_AGGR_SELECT_STEPS_MAX > steps++)
+	{
+		pivot = vc_aggr_median3_ui64(values[0], values[values_num / 2], values[values_num - 1]);
+		kernels->partition_ui64(values, values_num, pivot, dst, &lt, &gt);
+
+		if (k < lt)
+		{
+			tmp = values;
+			values = dst;
+			dst = tmp;
+			values_num = lt;
+		}
+		else if (k >= values_num - gt)
+		{
+			k -= values_num - gt;
+			values_num = gt;
+		}
+		else
+			goto out;
+	}
+
+	qsort(values, (size_t)values_num, sizeof(zbx_uint64_t), ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	pivot = values[k];
+out:
+	zbx_free(scratch);
+
+	return pivot;
+}
@@ -0,0 +1,56 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2025 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#ifndef ZABBIX_VCAGGR_H
+#define ZABBIX_VCAGGR_H
+
+#include "zbxtypes.h"
+
+/* Aggregate kernels working over contiguous value arrays of value cache chunks. */
+/* The implementation is selected at runtime depending on CPU features.          */
+typedef struct
+{
+	/* the implementation name, used for logging */
+	const char	*name;
+
+	double		(*sum_dbl)(const double *values, int values_num);
+	zbx_uint64_t	(*sum_ui64)(const zbx_uint64_t *values, int values_num);
+	double		(*sum_ui64_dbl)(const zbx_uint64_t *values, int values_num);
+	void		(*minmax_dbl)(const double *values, int values_num, double *min, double *max);
+	void		(*minmax_ui64)(const zbx_uint64_t *values, int values_num, zbx_uint64_t *min,
+			zbx_uint64_t *max);
+	int		(*count_dbl)(const double *values, int values_num, int op, double pattern);
+	int		(*count_ui64)(const zbx_uint64_t *values, int values_num, int op, zbx_uint64_t pattern,
+			zbx_uint64_t mask);
+
+	/* Writes values less than pivot to dst and values greater than pivot to the beginning of values, */
+	/* values equal to pivot are dropped. The dst must have space for values_num values.              */
+	void		(*partition_dbl)(double *values, int values_num, double pivot, double *dst, int *lt_num,
+			int *gt_num);
+	void		(*partition_ui64)(zbx_uint64_t *values, int values_num, zbx_uint64_t pivot, zbx_uint64_t *dst,
+			int *lt_num, int *gt_num);
+}
+zbx_vc_aggr_kernels_t;
+
+const zbx_vc_aggr_kernels_t	*zbx_vc_aggr_get_kernels(void);
+
+double		zbx_vc_aggr_select_dbl(double *values, int values_num, int k);
+zbx_uint64_t	zbx_vc_aggr_select_ui64(zbx_uint64_t *values, int values_num, int k);
+
+#endif
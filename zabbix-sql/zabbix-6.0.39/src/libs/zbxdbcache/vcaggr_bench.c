@@ -0,0 +1,396 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2025 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+/*
+ * Microbenchmark of value cache aggregate kernels.
+ *
+ * Compares the aggregate kernels working over chunk value arrays with the path
+ * used before them - values copied into history records (as zbx_vc_get_values()
+ * does) and aggregated record by record (as evaluate_SUM/MIN/MAX/COUNT() do).
+ * Percentile is measured separately - sorted history records (as
+ * evaluate_PERCENTILE() did) against selection with the partition kernels.
+ * Only the in-memory part is measured, value cache locking and DB reads are the
+ * same for both paths.
+ *
+ * Built on demand with 'make vcaggr_bench' in this directory:
+ *
+ *   ./vcaggr_bench [values_num ...]
+ *
+ * The default windows are 10000, 100000 and 1000000 values.
+ */
+
+#include "common.h"
+#include "valuecache.h"
+#include "vcaggr.h"
+
+const char	*progname = "vcaggr_bench";
+const char	title_message[] = "vcaggr_bench";
+const char	syslog_app_name[] = "vcaggr_bench";
+const char	*usage_message[] = {"[values_num ...]", NULL, NULL};
+const char	*help_message[] = {NULL};
+unsigned char	program_type = 0;
+
+#define BENCH_VALUES_TOTAL	200000000	/* the number of values aggregated by each path and window */
+#define BENCH_COUNT_PATTERN	7
+#define BENCH_SORT_VALUES_TOTAL	20000000	/* the number of values sorted or selected for percentile */
+#define BENCH_PERCENTAGE	95
+
+typedef struct
+{
+	double		sum;
+	zbx_uint64_t	sum_ui64;
+	history_value_t	min;
+	history_value_t	max;
+	int		count;
+}
+bench_result_t;
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: copies values into history records like zbx_vc_get_values()      *
+ *                                                                            *
+ ******************************************************************************/
+static void	bench_copy_records(zbx_history_record_t *records, const zbx_timespec_t *timestamps,
+		const history_value_t *values, int values_num)
+{
+	int	i;
+
+	for (i = 0; i < values_num; i++)
+	{
+		records[i].timestamp = timestamps[i];
+		records[i].value = values[i];
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: fills the window with the same pseudo-random values for each run  *
+ *                                                                            *
+ ******************************************************************************/
+static void	bench_generate_values(int value_type, zbx_timespec_t *timestamps, history_value_t *values,
+		int values_num)
+{
+	int	i;
+
+	srand(values_num);
+
+	for (i = 0; i < values_num; i++)
+	{
+		timestamps[i].sec = 1600000000 + i;
+		timestamps[i].ns = 0;
+
+		if (ITEM_VALUE_TYPE_FLOAT == value_type)
+			values[i].dbl = (double)(rand() % 1000) / 8;
+		else
+			values[i].ui64 = (zbx_uint64_t)(rand() % 1000);
+	}
+}
+
+static void	bench_records_dbl(const zbx_history_record_t *records, int values_num, bench_result_t *result)
+{
+	int	i;
+
+	result->sum = 0;
+	result->min.dbl = result->max.dbl = records[0].value.dbl;
+	result->count = 0;
+
+	for (i = 0; i < values_num; i++)
+		result->sum += records[i].value.dbl;
+
+	for (i = 1; i < values_num; i++)
+	{
+		if (records[i].value.dbl < result->min.dbl)
+			result->min.dbl = records[i].value.dbl;
+	}
+
+	for (i = 1; i < values_num; i++)
+	{
+		if (records[i].value.dbl > result->max.dbl)
+			result->max.dbl = records[i].value.dbl;
+	}
+
+	for (i = 0; i < values_num; i++)
+	{
+		if (SUCCEED == zbx_double_compare(records[i].value.dbl, BENCH_COUNT_PATTERN))
+			result->count++;
+	}
+}
+
+static void	bench_records_ui64(const zbx_history_record_t *records, int values_num, bench_result_t *result)
+{
+	int	i;
+
+	result->sum_ui64 = 0;
+	result->min.ui64 = result->max.ui64 = records[0].value.ui64;
+	result->count = 0;
+
+	for (i = 0; i < values_num; i++)
+		result->sum_ui64 += records[i].value.ui64;
+
+	for (i = 1; i < values_num; i++)
+	{
+		if (records[i].value.ui64 < result->min.ui64)
+			result->min.ui64 = records[i].value.ui64;
+	}
+
+	for (i = 1; i < values_num; i++)
+	{
+		if (records[i].value.ui64 > result->max.ui64)
+			result->max.ui64 = records[i].value.ui64;
+	}
+
+	for (i = 0; i < values_num; i++)
+	{
+		if (BENCH_COUNT_PATTERN == records[i].value.ui64)
+			result->count++;
+	}
+}
+
+static void	bench_kernels_dbl(const zbx_vc_aggr_kernels_t *kernels, const double *values, int values_num,
+		bench_result_t *result)
+{
+	result->sum = kernels->sum_dbl(values, values_num);
+	kernels->minmax_dbl(values, values_num, &result->min.dbl, &result->max.dbl);
+	result->count = kernels->count_dbl(values, values_num, ZBX_VC_AGGR_OP_EQ, BENCH_COUNT_PATTERN);
+}
+
+static void	bench_kernels_ui64(const zbx_vc_aggr_kernels_t *kernels, const zbx_uint64_t *values, int values_num,
+		bench_result_t *result)
+{
+	result->sum_ui64 = kernels->sum_ui64(values, values_num);
+	kernels->minmax_ui64(values, values_num, &result->min.ui64, &result->max.ui64);
+	result->count = kernels->count_ui64(values, values_num, ZBX_VC_AGGR_OP_EQ, BENCH_COUNT_PATTERN, 0);
+}
+
+static int	bench_record_compare_dbl(const void *d1, const void *d2)
+{
+	ZBX_RETURN_IF_NOT_EQUAL(((const zbx_history_record_t *)d1)->value.dbl,
+			((const zbx_history_record_t *)d2)->value.dbl);
+
+	return 0;
+}
+
+static int	bench_record_compare_ui64(const void *d1, const void *d2)
+{
+	ZBX_RETURN_IF_NOT_EQUAL(((const zbx_history_record_t *)d1)->value.ui64,
+			((const zbx_history_record_t *)d2)->value.ui64);
+
+	return 0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: measures both percentile paths for a window of the specified      *
+ *          value type                                                        *
+ *                                                                            *
+ * Return value: SUCCEED - both paths returned the same percentile            *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	bench_percentile_window(int value_type, int values_num)
+{
+	zbx_timespec_t		*timestamps;
+	history_value_t		*values, *copy, res_records, res_kernels;
+	zbx_history_record_t	*records;
+	int			j, loops, index;
+	double			sec, records_sec, kernels_sec;
+
+	timestamps = (zbx_timespec_t *)zbx_malloc(NULL, sizeof(zbx_timespec_t) * (size_t)values_num);
+	values = (history_value_t *)zbx_malloc(NULL, sizeof(history_value_t) * (size_t)values_num);
+	copy = (history_value_t *)zbx_malloc(NULL, sizeof(history_value_t) * (size_t)values_num);
+	records = (zbx_history_record_t *)zbx_malloc(NULL, sizeof(zbx_history_record_t) * (size_t)values_num);
+
+	res_records.ui64 = res_kernels.ui64 = 0;
+	bench_generate_values(value_type, timestamps, values, values_num);
+	index = (int)ceil(values_num * (BENCH_PERCENTAGE / 100.0));
+
+	if (0 == (loops = BENCH_SORT_VALUES_TOTAL / values_num))
+		loops = 1;
+
+	sec = zbx_time();
+
+	for (j = 0; j < loops; j++)
+	{
+		bench_copy_records(records, timestamps, values, values_num);
+		qsort(records, (size_t)values_num, sizeof(zbx_history_record_t),
+				ITEM_VALUE_TYPE_FLOAT == value_type ? bench_record_compare_dbl :
+				bench_record_compare_ui64);
+		res_records = records[index - 1].value;
+	}
+
+	records_sec = zbx_time() - sec;
+	sec = zbx_time();
+
+	for (j = 0; j < loops; j++)
+	{
+		memcpy(copy, values, sizeof(history_value_t) * (size_t)values_num);
+
+		if (ITEM_VALUE_TYPE_FLOAT == value_type)
+			res_kernels.dbl = zbx_vc_aggr_select_dbl(&copy->dbl, values_num, index - 1);
+		else
+			res_kernels.ui64 = zbx_vc_aggr_select_ui64(&copy->ui64, values_num, index - 1);
+	}
+
+	kernels_sec = zbx_time() - sec;
+
+	printf("%-7s %8d %6d %12.3f %12.3f %8.2fx %s\n", ITEM_VALUE_TYPE_FLOAT == value_type ? "float" : "uint",
+			values_num, loops, records_sec * 1e9 / loops / values_num,
+			kernels_sec * 1e9 / loops / values_num, 0 != kernels_sec ? records_sec / kernels_sec : 0,
+			res_records.ui64 == res_kernels.ui64 ? "ok" : "MISMATCH");
+
+	zbx_free(records);
+	zbx_free(copy);
+	zbx_free(values);
+	zbx_free(timestamps);
+
+	return res_records.ui64 == res_kernels.ui64 ? SUCCEED : FAIL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: measures both paths for a window of the specified value type      *
+ *                                                                            *
+ * Return value: SUCCEED - both paths returned the same aggregates            *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	bench_window(const zbx_vc_aggr_kernels_t *kernels, int value_type, int values_num)
+{
+	zbx_timespec_t		*timestamps;
+	history_value_t		*values;
+	zbx_history_record_t	*records;
+	bench_result_t		res_records, res_kernels;
+	int			j, loops, ret;
+	double			sec, records_sec, kernels_sec;
+
+	timestamps = (zbx_timespec_t *)zbx_malloc(NULL, sizeof(zbx_timespec_t) * (size_t)values_num);
+	values = (history_value_t *)zbx_malloc(NULL, sizeof(history_value_t) * (size_t)values_num);
+	records = (zbx_history_record_t *)zbx_malloc(NULL, sizeof(zbx_history_record_t) * (size_t)values_num);
+
+	memset(&res_records, 0, sizeof(res_records));
+	memset(&res_kernels, 0, sizeof(res_kernels));
+	bench_generate_values(value_type, timestamps, values, values_num);
+
+	if (0 == (loops = BENCH_VALUES_TOTAL / values_num))
+		loops = 1;
+
+	sec = zbx_time();
+
+	for (j = 0; j < loops; j++)
+	{
+		bench_copy_records(records, timestamps, values, values_num);
+
+		if (ITEM_VALUE_TYPE_FLOAT == value_type)
+			bench_records_dbl(records, values_num, &res_records);
+		else
+			bench_records_ui64(records, values_num, &res_records);
+	}
+
+	records_sec = zbx_time() - sec;
+	sec = zbx_time();
+
+	/* history_value_t is 8 bytes wide, so the values form plain double and zbx_uint64_t arrays */
+	for (j = 0; j < loops; j++)
+	{
+		if (ITEM_VALUE_TYPE_FLOAT == value_type)
+			bench_kernels_dbl(kernels, &values->dbl, values_num, &res_kernels);
+		else
+			bench_kernels_ui64(kernels, &values->ui64, values_num, &res_kernels);
+	}
+
+	kernels_sec = zbx_time() - sec;
+
+	if (ITEM_VALUE_TYPE_FLOAT == value_type)
+	{
+		/* the kernels add floating point values in several lanes */
+		ret = (fabs(res_records.sum - res_kernels.sum) <= fabs(res_records.sum) * 1e-9 &&
+				res_records.min.dbl == res_kernels.min.dbl &&
+				res_records.max.dbl == res_kernels.max.dbl &&
+				res_records.count == res_kernels.count ? SUCCEED : FAIL);
+	}
+	else
+	{
+		ret = (res_records.sum_ui64 == res_kernels.sum_ui64 &&
+				res_records.min.ui64 == res_kernels.min.ui64 &&
+				res_records.max.ui64 == res_kernels.max.ui64 &&
+				res_records.count == res_kernels.count ? SUCCEED : FAIL);
+	}
+
+	printf("%-7s %8d %6d %12.3f %12.3f %8.2fx %s\n", ITEM_VALUE_TYPE_FLOAT == value_type ? "float" : "uint",
+			values_num, loops, records_sec * 1e9 / loops / values_num,
+			kernels_sec * 1e9 / loops / values_num, 0 != kernels_sec ? records_sec / kernels_sec : 0,
+			SUCCEED == ret ? "ok" : "MISMATCH");
+
+	zbx_free(records);
+	zbx_free(values);
+	zbx_free(timestamps);
+
+	return ret;
+}
+
+int	main(int argc, char **argv)
+{
+	const zbx_vc_aggr_kernels_t	*kernels = zbx_vc_aggr_get_kernels();
+	int				windows[] = {10000, 100000, 1000000}, *values_nums = windows,
+					values_nums_num = (int)ARRSIZE(windows), i, ret = SUCCEED;
+
+	if (1 < argc)
+	{
+		values_nums = (int *)zbx_malloc(NULL, sizeof(int) * (size_t)(argc - 1));
+
+		for (values_nums_num = 0; values_nums_num < argc - 1; values_nums_num++)
+		{
+			if (0 >= (values_nums[values_nums_num] = atoi(argv[values_nums_num + 1])))
+			{
+				zbx_error("invalid number of values \"%s\"", argv[values_nums_num + 1]);
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+
+	printf("aggregate kernels: %s\n", kernels->name);
+	printf("sum, min, max and count over each window, nanoseconds per value\n\n");
+	printf("%-7s %8s %6s %12s %12s %9s\n", "type", "values", "loops", "records", "kernels", "speedup");
+
+	for (i = 0; i < values_nums_num; i++)
+	{
+		if (SUCCEED != bench_window(kernels, ITEM_VALUE_TYPE_FLOAT, values_nums[i]))
+			ret = FAIL;
+
+		if (SUCCEED != bench_window(kernels, ITEM_VALUE_TYPE_UINT64, values_nums[i]))
+			ret = FAIL;
+	}
+
+	printf("\n%d%% percentile of each window, nanoseconds per value\n\n", BENCH_PERCENTAGE);
+	printf("%-7s %8s %6s %12s %12s %9s\n", "type", "values", "loops", "sorted", "selected", "speedup");
+
+	for (i = 0; i < values_nums_num; i++)
+	{
+		if (SUCCEED != bench_percentile_window(ITEM_VALUE_TYPE_FLOAT, values_nums[i]))
+			ret = FAIL;
+
+		if (SUCCEED != bench_percentile_window(ITEM_VALUE_TYPE_UINT64, values_nums[i]))
+			ret = FAIL;
+	}
+
+	if (values_nums != windows)
+		zbx_free(values_nums);
+
+	return SUCCEED == ret ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -44,6 +44,7 @@ zbx_autoreg_host_t;
 
 #if defined(HAVE_POSTGRESQL)
 extern char	ZBX_PG_ESCAPE_BACKSLASH;
+extern int	CONFIG_DOUBLE_PRECISION;
 #endif
 
 static int	connection_failure;
@@ -240,6 +241,33 @@ int	DBconnect(int flag)
 	return err;
 }
 
+#if defined(HAVE_POSTGRESQL)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: open secondary database connection for pipelined writes           *
+ *                                                                            *
+ * Return value: ZBX_DB_OK - successfully connected                           *
+ *               ZBX_DB_DOWN - database is down                               *
+ *               ZBX_DB_FAIL - failed to connect                              *
+ *                                                                            *
+ * Comments: unlike DBconnect() the connection is attempted only once, the    *
+ *           caller decides whether to retry or to write synchronously        *
+ *                                                                            *
+ ******************************************************************************/
+int	DBconnect_async(void)
+{
+	return zbx_db_async_connect(CONFIG_DBHOST, CONFIG_DBUSER, CONFIG_DBPASSWORD, CONFIG_DBNAME, CONFIG_DBSCHEMA,
+			CONFIG_DBSOCKET, CONFIG_DBPORT, CONFIG_DB_TLS_CONNECT, CONFIG_DB_TLS_CERT_FILE,
+			CONFIG_DB_TLS_KEY_FILE, CONFIG_DB_TLS_CA_FILE, CONFIG_DB_TLS_CIPHER, CONFIG_DB_TLS_CIPHER_13,
+			CONFIG_DBREAD_ONLY_RECOVERABLE);
+}
+
+void	DBclose_async(void)
+{
+	zbx_db_async_close();
+}
+#endif
+
 int	DBinit(char **error)
 {
 	return zbx_db_init(CONFIG_DBNAME, db_schema, error);
@@ -538,6 +566,42 @@ DB_RESULT	DBselectN(const char *query, int n)
 	return rc;
 }
 
+#if defined(HAVE_POSTGRESQL)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: execute a select statement with parameters using cached prepared  *
+ *          statement                                                         *
+ *                                                                            *
+ * Parameters: sql        - [IN] the query with $1, $2, ... placeholders      *
+ *             params_num - [IN] the number of parameters                     *
+ *             params     - [IN] the parameter values in text format          *
+ *                                                                            *
+ * Comments: retry until DB is up                                             *
+ *                                                                            *
+ ******************************************************************************/
+DB_RESULT	DBselect_prepared(const char *sql, int params_num, const char * const *params)
+{
+	DB_RESULT	rc;
+
+	rc = zbx_db_select_prepared(sql, params_num, params);
+
+	while ((DB_RESULT)ZBX_DB_DOWN == rc)
+	{
+		DBclose();
+		DBconnect(ZBX_DB_CONNECT_NORMAL);
+
+		if ((DB_RESULT)ZBX_DB_DOWN == (rc = zbx_db_select_prepared(sql, params_num, params)))
+		{
+			zabbix_log(LOG_LEVEL_ERR, "database is down: retrying in %d seconds", ZBX_DB_WAIT_DOWN);
+			connection_failure = 1;
+			sleep(ZBX_DB_WAIT_DOWN);
+		}
+	}
+
+	return rc;
+}
+#endif
+
 int	DBget_row_count(const char *table_name)
 {
 	int		count = 0;
@@ -3051,6 +3115,7 @@ void	zbx_db_insert_prepare_dyn(zbx_db_insert_t *self, const ZBX_TABLE *table, co
 	}
 
 	self->autoincrement = -1;
+	self->copy = 0;
 
 	zbx_vector_ptr_create(&self->fields);
 	zbx_vector_ptr_create(&self->rows);
@@ -3152,7 +3217,13 @@ void	zbx_db_insert_add_values_dyn(zbx_db_insert_t *self, const zbx_db_value_t **
 #ifdef HAVE_ORACLE
 				row[i].str = DBdyn_escape_field_len(field, value->str, ESCAPE_SEQUENCE_OFF);
 #else
-				row[i].str = DBdyn_escape_field_len(field, value->str, ESCAPE_SEQUENCE_ON);
+				if (0 != self->copy)
+				{
+					row[i].str = zbx_strdup(NULL, value->str);
+					row[i].str[zbx_db_strlen_n(row[i].str, get_string_field_chars(field))] = '\0';
+				}
+				else
+					row[i].str = DBdyn_escape_field_len(field, value->str, ESCAPE_SEQUENCE_ON);
 #endif
 				break;
 			default:
@@ -3230,6 +3301,404 @@ void	zbx_db_insert_add_values(zbx_db_insert_t *self, ...)
 	zbx_vector_ptr_destroy(&values);
 }
 
+#ifndef HAVE_ORACLE
+/******************************************************************************
+ *                                                                            *
+ * Purpose: format single row of bulk insert values                           *
+ *                                                                            *
+ * Parameters: self       - [IN] the bulk insert data                         *
+ *             values     - [IN] the row values                               *
+ *             sql        - [IN/OUT] the sql buffer                           *
+ *             sql_alloc  - [IN/OUT] the sql buffer size                      *
+ *             sql_offset - [IN/OUT] the sql buffer offset                    *
+ *                                                                            *
+ * Comments: The row is formatted as '(value1,value2,...' without the closing *
+ *           bracket.                                                         *
+ *                                                                            *
+ ******************************************************************************/
+static void	db_insert_format_row(const zbx_db_insert_t *self, const zbx_db_value_t *values, char **sql,
+		size_t *sql_alloc, size_t *sql_offset)
+{
+	int		j;
+	char		delim[2] = {',', '('};
+	const ZBX_FIELD	*field;
+
+	for (j = 0; j < self->fields.values_num; j++)
+	{
+		const zbx_db_value_t	*value = &values[j];
+
+		field = (const ZBX_FIELD *)self->fields.values[j];
+
+		zbx_chrcpy_alloc(sql, sql_alloc, sql_offset, delim[0 == j]);
+
+		switch (field->type)
+		{
+			case ZBX_TYPE_CHAR:
+			case ZBX_TYPE_TEXT:
+			case ZBX_TYPE_SHORTTEXT:
+			case ZBX_TYPE_LONGTEXT:
+			case ZBX_TYPE_CUID:
+				zbx_chrcpy_alloc(sql, sql_alloc, sql_offset, '\'');
+
+				if (0 != self->copy)
+				{
+					char	*str_esc;
+
+					str_esc = DBdyn_escape_string(value->str);
+					zbx_strcpy_alloc(sql, sql_alloc, sql_offset, str_esc);
+					zbx_free(str_esc);
+				}
+				else
+					zbx_strcpy_alloc(sql, sql_alloc, sql_offset, value->str);
+
+				zbx_chrcpy_alloc(sql, sql_alloc, sql_offset, '\'');
+				break;
+			case ZBX_TYPE_INT:
+				zbx_snprintf_alloc(sql, sql_alloc, sql_offset, "%d", value->i32);
+				break;
+			case ZBX_TYPE_FLOAT:
+				zbx_snprintf_alloc(sql, sql_alloc, sql_offset, ZBX_FS_DBL64_SQL, value->dbl);
+				break;
+			case ZBX_TYPE_UINT:
+				zbx_snprintf_alloc(sql, sql_alloc, sql_offset, ZBX_FS_UI64, value->ui64);
+				break;
+			case ZBX_TYPE_ID:
+				zbx_strcpy_alloc(sql, sql_alloc, sql_offset, DBsql_id_ins(value->ui64));
+				break;
+			default:
+				THIS_SHOULD_NEVER_HAPPEN;
+				exit(EXIT_FAILURE);
+		}
+	}
+}
+#endif
+
+#if defined(HAVE_POSTGRESQL)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: format bulk insert data as a single multi-row insert statement    *
+ *                                                                            *
+ * Parameters: self       - [IN] the bulk insert data                         *
+ *             sql        - [IN/OUT] the sql buffer                           *
+ *             sql_alloc  - [IN/OUT] the sql buffer size                      *
+ *             sql_offset - [IN/OUT] the sql buffer offset                    *
+ *                                                                            *
+ * Comments: The statement is appended to the buffer without the terminating  *
+ *           semicolon, allowing the caller to add conflict clauses.          *
+ *           Auto increment fields are not supported.                         *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_db_insert_format(const zbx_db_insert_t *self, char **sql, size_t *sql_alloc, size_t *sql_offset)
+{
+	int		i;
+	char		delim[2] = {',', '('};
+	const ZBX_FIELD	*field;
+
+	if (0 == self->rows.values_num)
+		return;
+
+	if (-1 != self->autoincrement)
+	{
+		THIS_SHOULD_NEVER_HAPPEN;
+		return;
+	}
+
+	zbx_snprintf_alloc(sql, sql_alloc, sql_offset, "insert into %s ", self->table->table);
+
+	for (i = 0; i < self->fields.values_num; i++)
+	{
+		field = (const ZBX_FIELD *)self->fields.values[i];
+
+		zbx_chrcpy_alloc(sql, sql_alloc, sql_offset, delim[0 == i]);
+		zbx_strcpy_alloc(sql, sql_alloc, sql_offset, field->name);
+	}
+
+	zbx_strcpy_alloc(sql, sql_alloc, sql_offset, ") values ");
+
+	for (i = 0; i < self->rows.values_num; i++)
+	{
+		if (0 != i)
+			zbx_chrcpy_alloc(sql, sql_alloc, sql_offset, ',');
+
+		db_insert_format_row(self, (const zbx_db_value_t *)self->rows.values[i], sql, sql_alloc, sql_offset);
+		zbx_chrcpy_alloc(sql, sql_alloc, sql_offset, ')');
+	}
+}
+#endif
+
+#if defined(HAVE_POSTGRESQL)
+/* bulk inserts with less rows are faster done with insert statements */
+#define ZBX_DB_COPY_ROWS_MIN	100
+
+/* COPY binary format signature, flags field and header extension area length */
+#define ZBX_DB_COPY_SIGNATURE		"PGCOPY\n\377\r\n"
+#define ZBX_DB_COPY_SIGNATURE_LEN	11
+
+/* numeric binary format - sign values and the number of decimal digits in one base 10000 digit */
+#define ZBX_DB_COPY_NUMERIC_POS		0x0000
+#define ZBX_DB_COPY_NUMERIC_NEG		0x4000
+#define ZBX_DB_COPY_NUMERIC_DEC_DIGITS	4
+
+/* the maximum length of numeric value in decimal notation */
+#define ZBX_DB_COPY_NUMERIC_LEN		(ZBX_MAX_DOUBLE_LEN * 2)
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: append binary data to COPY data buffer                            *
+ *                                                                            *
+ ******************************************************************************/
+static void	db_copy_append(char **data, size_t *data_alloc, size_t *data_offset, const void *src, size_t size)
+{
+	if (*data_offset + size > *data_alloc)
+	{
+		while (*data_offset + size > *data_alloc)
+			*data_alloc *= 2;
+
+		*data = (char *)zbx_realloc(*data, *data_alloc);
+	}
+
+	memcpy(*data + *data_offset, src, size);
+	*data_offset += size;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: append integer in network byte order to COPY data buffer          *
+ *                                                                            *
+ * Parameters: data        - [IN/OUT] the COPY data buffer                    *
+ *             data_alloc  - [IN/OUT] the buffer size                         *
+ *             data_offset - [IN/OUT] the data size                           *
+ *             value       - [IN] the value                                   *
+ *             size        - [IN] the integer size in bytes (2, 4 or 8)       *
+ *                                                                            *
+ ******************************************************************************/
+static void	db_copy_append_int(char **data, size_t *data_alloc, size_t *data_offset, zbx_uint64_t value,
+		size_t size)
+{
+	unsigned char	buf[sizeof(zbx_uint64_t)];
+	size_t		i;
+
+	for (i = size; 0 != i; i--)
+	{
+		buf[i - 1] = (unsigned char)(value & 0xff);
+		value >>= 8;
+	}
+
+	db_copy_append(data, data_alloc, data_offset, buf, size);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: append numeric field in COPY binary format                        *
+ *                                                                            *
+ * Parameters: data        - [IN/OUT] the COPY data buffer                    *
+ *             data_alloc  - [IN/OUT] the buffer size                         *
+ *             data_offset - [IN/OUT] the data size                           *
+ *             str         - [IN] the value in decimal notation without       *
+ *                                exponent, shorter than                      *
+ *                                ZBX_DB_COPY_NUMERIC_LEN                     *
+ *                                                                            *
+ * Comments: The value is sent as the number of base 10000 digits, the weight *
+ *           of the first digit, sign, display scale and the digits           *
+ *           themselves, leading and trailing zero digits are stripped.       *
+ *                                                                            *
+ ******************************************************************************/
+static void	db_copy_append_numeric(char **data, size_t *data_alloc, size_t *data_offset, const char *str)
+{
+	char		dec[ZBX_DB_COPY_NUMERIC_LEN + ZBX_DB_COPY_NUMERIC_DEC_DIGITS * 2];
+	int		digits[sizeof(dec) / ZBX_DB_COPY_NUMERIC_DEC_DIGITS], digits_num = 0, first, last, weight,
+			sign = ZBX_DB_COPY_NUMERIC_POS, i, j;
+	size_t		int_len, frac_len = 0, dec_len, pad;
+	const char	*frac;
+
+	if ('-' == *str)
+	{
+		sign = ZBX_DB_COPY_NUMERIC_NEG;
+		str++;
+	}
+
+	if (NULL != (frac = strchr(str, '.')))
+	{
+		int_len = (size_t)(frac - str);
+		frac_len = strlen(++frac);
+	}
+	else
+		int_len = strlen(str);
+
+	/* align the integer part to the left and the fractional part to the right of base 10000 digits */
+	pad = (ZBX_DB_COPY_NUMERIC_DEC_DIGITS - int_len % ZBX_DB_COPY_NUMERIC_DEC_DIGITS) %
+			ZBX_DB_COPY_NUMERIC_DEC_DIGITS;
+	memset(dec, '0', pad);
+	memcpy(dec + pad, str, int_len);
+	dec_len = pad + int_len;
+	weight = (int)(dec_len / ZBX_DB_COPY_NUMERIC_DEC_DIGITS) - 1;
+
+	if (0 != frac_len)
+	{
+		memcpy(dec + dec_len, frac, frac_len);
+		dec_len += frac_len;
+		pad = (ZBX_DB_COPY_NUMERIC_DEC_DIGITS - frac_len % ZBX_DB_COPY_NUMERIC_DEC_DIGITS) %
+				ZBX_DB_COPY_NUMERIC_DEC_DIGITS;
+		memset(dec + dec_len, '0', pad);
+		dec_len += pad;
+	}
+
+	for (i = 0; i < (int)dec_len; i += ZBX_DB_COPY_NUMERIC_DEC_DIGITS)
+	{
+		digits[digits_num] = 0;
+
+		for (j = 0; j < ZBX_DB_COPY_NUMERIC_DEC_DIGITS; j++)
+			digits[digits_num] = digits[digits_num] * 10 + dec[i + j] - '0';
+
+		digits_num++;
+	}
+
+	for (first = 0; first < digits_num && 0 == digits[first]; first++)
+		weight--;
+
+	for (last = digits_num - 1; last >= first && 0 == digits[last]; last--)
+		;
+
+	if (first > last)
+	{
+		/* zero has no digits and is always positive */
+		first = 0;
+		last = -1;
+		weight = 0;
+		sign = ZBX_DB_COPY_NUMERIC_POS;
+	}
+
+	db_copy_append_int(data, data_alloc, data_offset, (zbx_uint64_t)(4 * 2 + (last - first + 1) * 2), 4);
+	db_copy_append_int(data, data_alloc, data_offset, (zbx_uint64_t)(last - first + 1), 2);
+	db_copy_append_int(data, data_alloc, data_offset, (zbx_uint64_t)(zbx_uint32_t)weight, 2);
+	db_copy_append_int(data, data_alloc, data_offset, (zbx_uint64_t)sign, 2);
+	db_copy_append_int(data, data_alloc, data_offset, (zbx_uint64_t)frac_len, 2);
+
+	for (i = first; i <= last; i++)
+		db_copy_append_int(data, data_alloc, data_offset, (zbx_uint64_t)digits[i], 2);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: load bulk insert rows with COPY FROM STDIN                        *
+ *                                                                            *
+ * Parameters: self - [IN] the bulk insert data                               *
+ *                                                                            *
+ * Return value: SUCCEED - the rows were loaded                               *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: Binary format is used, so values are neither formatted as text   *
+ *           nor parsed by the server. Each row is the number of fields       *
+ *           followed by the length and data of each field (-1 length for     *
+ *           NULL). Unsigned values are stored in numeric(20) columns and are *
+ *           sent as numeric. Float values are sent as double precision,      *
+ *           or as numeric if the database has not been upgraded to double    *
+ *           precision float columns yet.                                     *
+ *                                                                            *
+ ******************************************************************************/
+static int	db_insert_copy(const zbx_db_insert_t *self)
+{
+	int		i, j, rc;
+	char		*sql = NULL, *data, buffer[ZBX_DB_COPY_NUMERIC_LEN];
+	size_t		sql_alloc = 0, sql_offset = 0, data_alloc = 16 * ZBX_KIBIBYTE, data_offset = 0;
+	const ZBX_FIELD	*field;
+	zbx_uint64_t	u64;
+
+	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, "copy %s (", self->table->table);
+
+	for (i = 0; i < self->fields.values_num; i++)
+	{
+		field = (const ZBX_FIELD *)self->fields.values[i];
+
+		if (0 != i)
+			zbx_chrcpy_alloc(&sql, &sql_alloc, &sql_offset, ',');
+
+		zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, field->name);
+	}
+
+	zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, ") from stdin (format binary)");
+
+	data = (char *)zbx_malloc(NULL, data_alloc);
+
+	db_copy_append(&data, &data_alloc, &data_offset, ZBX_DB_COPY_SIGNATURE, ZBX_DB_COPY_SIGNATURE_LEN);
+	db_copy_append_int(&data, &data_alloc, &data_offset, 0, 4);
+	db_copy_append_int(&data, &data_alloc, &data_offset, 0, 4);
+
+	for (i = 0; i < self->rows.values_num; i++)
+	{
+		const zbx_db_value_t	*values = (const zbx_db_value_t *)self->rows.values[i];
+
+		db_copy_append_int(&data, &data_alloc, &data_offset, (zbx_uint64_t)self->fields.values_num, 2);
+
+		for (j = 0; j < self->fields.values_num; j++)
+		{
+			const zbx_db_value_t	*value = &values[j];
+			size_t			len;
+
+			field = (const ZBX_FIELD *)self->fields.values[j];
+
+			switch (field->type)
+			{
+				case ZBX_TYPE_CHAR:
+				case ZBX_TYPE_TEXT:
+				case ZBX_TYPE_SHORTTEXT:
+				case ZBX_TYPE_LONGTEXT:
+				case ZBX_TYPE_CUID:
+					len = strlen(value->str);
+					db_copy_append_int(&data, &data_alloc, &data_offset, (zbx_uint64_t)len, 4);
+					db_copy_append(&data, &data_alloc, &data_offset, value->str, len);
+					break;
+				case ZBX_TYPE_INT:
+					db_copy_append_int(&data, &data_alloc, &data_offset, 4, 4);
+					db_copy_append_int(&data, &data_alloc, &data_offset,
+							(zbx_uint64_t)(zbx_uint32_t)value->i32, 4);
+					break;
+				case ZBX_TYPE_FLOAT:
+					if (ZBX_DB_DBL_PRECISION_ENABLED != CONFIG_DOUBLE_PRECISION)
+					{
+						zbx_snprintf(buffer, sizeof(buffer), "%.4f", value->dbl);
+						db_copy_append_numeric(&data, &data_alloc, &data_offset, buffer);
+						break;
+					}
+
+					memcpy(&u64, &value->dbl, sizeof(u64));
+					db_copy_append_int(&data, &data_alloc, &data_offset, 8, 4);
+					db_copy_append_int(&data, &data_alloc, &data_offset, u64, 8);
+					break;
+				case ZBX_TYPE_UINT:
+					zbx_snprintf(buffer, sizeof(buffer), ZBX_FS_UI64, value->ui64);
+					db_copy_append_numeric(&data, &data_alloc, &data_offset, buffer);
+					break;
+				case ZBX_TYPE_ID:
+					if (0 == value->ui64)
+					{
+						db_copy_append_int(&data, &data_alloc, &data_offset,
+								(zbx_uint64_t)(zbx_uint32_t)-1, 4);
+						break;
+					}
+
+					db_copy_append_int(&data, &data_alloc, &data_offset, 8, 4);
+					db_copy_append_int(&data, &data_alloc, &data_offset, value->ui64, 8);
+					break;
+				default:
+					THIS_SHOULD_NEVER_HAPPEN;
+					exit(EXIT_FAILURE);
+			}
+		}
+	}
+
+	/* file trailer - field count of -1 */
+	db_copy_append_int(&data, &data_alloc, &data_offset, 0xffff, 2);
+
+	rc = zbx_db_copy(sql, data, data_offset);
+
+	zbx_free(data);
+	zbx_free(sql);
+
+	return (ZBX_DB_OK <= rc ? SUCCEED : FAIL);
+}
+#endif
+
 /******************************************************************************
  *                                                                            *
  * Purpose: executes the prepared database bulk insert operation              *
@@ -3242,7 +3711,7 @@ void	zbx_db_insert_add_values(zbx_db_insert_t *self, ...)
  ******************************************************************************/
 int	zbx_db_insert_execute(zbx_db_insert_t *self)
 {
-	int		ret = FAIL, i, j;
+	int		ret = FAIL, i;
 	const ZBX_FIELD	*field;
 	char		*sql_command, delim[2] = {',', '('};
 	size_t		sql_command_alloc = 512, sql_command_offset = 0;
@@ -3257,7 +3726,7 @@ int	zbx_db_insert_execute(zbx_db_insert_t *self)
 #	endif
 #else
 	zbx_db_bind_context_t	*contexts;
-	int			rc, tries = 0;
+	int			j, rc, tries = 0;
 #endif
 
 	if (0 == self->rows.values_num)
@@ -3278,6 +3747,12 @@ int	zbx_db_insert_execute(zbx_db_insert_t *self)
 		}
 	}
 
+#if defined(HAVE_POSTGRESQL)
+	/* fall back to insert statements if rows cannot be loaded with COPY */
+	if (0 != self->copy && ZBX_DB_COPY_ROWS_MIN <= self->rows.values_num && SUCCEED == db_insert_copy(self))
+		return SUCCEED;
+#endif
+
 #ifndef HAVE_ORACLE
 	sql = (char *)zbx_malloc(NULL, sql_alloc);
 #endif
@@ -3398,44 +3873,7 @@ retry_oracle:
 #	else
 		zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, sql_command);
 #	endif
-		for (j = 0; j < self->fields.values_num; j++)
-		{
-			const zbx_db_value_t	*value = &values[j];
-
-			field = (const ZBX_FIELD *)self->fields.values[j];
-
-			zbx_chrcpy_alloc(&sql, &sql_alloc, &sql_offset, delim[0 == j]);
-
-			switch (field->type)
-			{
-				case ZBX_TYPE_CHAR:
-				case ZBX_TYPE_TEXT:
-				case ZBX_TYPE_SHORTTEXT:
-				case ZBX_TYPE_LONGTEXT:
-				case ZBX_TYPE_CUID:
-					zbx_chrcpy_alloc(&sql, &sql_alloc, &sql_offset, '\'');
-					zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, value->str);
-					zbx_chrcpy_alloc(&sql, &sql_alloc, &sql_offset, '\'');
-					break;
-				case ZBX_TYPE_INT:
-					zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, "%d", value->i32);
-					break;
-				case ZBX_TYPE_FLOAT:
-					zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, ZBX_FS_DBL64_SQL, value->dbl);
-					break;
-				case ZBX_TYPE_UINT:
-					zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, ZBX_FS_UI64,
-							value->ui64);
-					break;
-				case ZBX_TYPE_ID:
-					zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset,
-							DBsql_id_ins(value->ui64));
-					break;
-				default:
-					THIS_SHOULD_NEVER_HAPPEN;
-					exit(EXIT_FAILURE);
-			}
-		}
+		db_insert_format_row(self, values, &sql, &sql_alloc, &sql_offset);
 #	ifdef HAVE_MYSQL
 		if (NULL != sql_values)
 			zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, sql_values);
@@ -3504,6 +3942,33 @@ void	zbx_db_insert_autoincrement(zbx_db_insert_t *self, const char *field_name)
 	exit(EXIT_FAILURE);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: load bulk insert rows with COPY instead of insert statements      *
+ *                                                                            *
+ * Parameters: self - [IN] the bulk insert data                               *
+ *                                                                            *
+ * Comments: This function must be called before adding values. COPY is       *
+ *           supported only by PostgreSQL, with other databases the function  *
+ *           does nothing. If COPY fails the rows are inserted with regular   *
+ *           insert statements.                                               *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_db_insert_use_copy(zbx_db_insert_t *self)
+{
+#if defined(HAVE_POSTGRESQL)
+	if (0 != self->rows.values_num)
+	{
+		THIS_SHOULD_NEVER_HAPPEN;
+		return;
+	}
+
+	self->copy = 1;
+#else
+	ZBX_UNUSED(self);
+#endif
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: determine is it a server or a proxy database                      *
@@ -0,0 +1,328 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2025 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+/*
+ * Benchmark of bulk insert paths on PostgreSQL.
+ *
+ * Loads batches of rows into history and trends tables with multi-row insert
+ * statements and with COPY, both through zbx_db_insert_execute() as the history
+ * syncer does, and reports rows per second for each path. Every batch is loaded
+ * in its own transaction, which is rolled back, so the database is not changed.
+ * Only the time spent in zbx_db_insert_execute() is measured.
+ *
+ * Built on demand with 'make dbcopy_bench' in this directory:
+ *
+ *   ./dbcopy_bench <dbname> [batch_rows ...]
+ *
+ * The database must have Zabbix schema. Other connection parameters are taken
+ * from libpq environment variables (PGHOST, PGPORT, PGUSER, PGPASSWORD).
+ * The default batch sizes are 1000 and 10000 rows.
+ */
+
+#include "common.h"
+#include "db.h"
+#include "dbcache.h"
+#include "log.h"
+
+const char	*progname = "dbcopy_bench";
+const char	title_message[] = "dbcopy_bench";
+const char	syslog_app_name[] = "dbcopy_bench";
+const char	*usage_message[] = {"<dbname> [batch_rows ...]", NULL, NULL};
+const char	*help_message[] = {NULL};
+unsigned char	program_type = 0;
+
+char	*CONFIG_DBHOST			= NULL;
+char	*CONFIG_DBNAME			= NULL;
+char	*CONFIG_DBSCHEMA		= NULL;
+char	*CONFIG_DBUSER			= NULL;
+char	*CONFIG_DBPASSWORD		= NULL;
+char	*CONFIG_DBSOCKET		= NULL;
+char	*CONFIG_DB_TLS_CONNECT		= NULL;
+char	*CONFIG_DB_TLS_CERT_FILE	= NULL;
+char	*CONFIG_DB_TLS_KEY_FILE		= NULL;
+char	*CONFIG_DB_TLS_CA_FILE		= NULL;
+char	*CONFIG_DB_TLS_CIPHER		= NULL;
+char	*CONFIG_DB_TLS_CIPHER_13	= NULL;
+int	CONFIG_DBPORT			= 0;
+int	CONFIG_DBREAD_ONLY_RECOVERABLE	= 0;
+int	CONFIG_LOG_SLOW_QUERIES		= 0;
+int	CONFIG_DOUBLE_PRECISION		= ZBX_DB_DBL_PRECISION_ENABLED;
+
+#define BENCH_ROWS_TOTAL	200000	/* the number of rows loaded by each path and batch size */
+
+/* the rows are loaded far in the past, so they do not collide with collected history */
+#define BENCH_CLOCK		1
+#define BENCH_ITEMID		1
+
+#define BENCH_PATH_INSERT	0
+#define BENCH_PATH_COPY		1
+
+/* the benchmarked code paths do not generate events or use configuration cache */
+
+DB_EVENT	*zbx_add_event(unsigned char source, unsigned char object, zbx_uint64_t objectid,
+		const zbx_timespec_t *timespec, int value, const char *trigger_description,
+		const char *trigger_expression, const char *trigger_recovery_expression, unsigned char trigger_priority,
+		unsigned char trigger_type, const zbx_vector_ptr_t *trigger_tags,
+		unsigned char trigger_correlation_mode, const char *trigger_correlation_tag,
+		unsigned char trigger_value, const char *trigger_opdata, const char *event_name, const char *error)
+{
+	ZBX_UNUSED(source);
+	ZBX_UNUSED(object);
+	ZBX_UNUSED(objectid);
+	ZBX_UNUSED(timespec);
+	ZBX_UNUSED(value);
+	ZBX_UNUSED(trigger_description);
+	ZBX_UNUSED(trigger_expression);
+	ZBX_UNUSED(trigger_recovery_expression);
+	ZBX_UNUSED(trigger_priority);
+	ZBX_UNUSED(trigger_type);
+	ZBX_UNUSED(trigger_tags);
+	ZBX_UNUSED(trigger_correlation_mode);
+	ZBX_UNUSED(trigger_correlation_tag);
+	ZBX_UNUSED(trigger_value);
+	ZBX_UNUSED(trigger_opdata);
+	ZBX_UNUSED(event_name);
+	ZBX_UNUSED(error);
+
+	THIS_SHOULD_NEVER_HAPPEN;
+
+	return NULL;
+}
+
+int	zbx_process_events(zbx_vector_ptr_t *trigger_diff, zbx_vector_uint64_t *triggerids_lock)
+{
+	ZBX_UNUSED(trigger_diff);
+	ZBX_UNUSED(triggerids_lock);
+
+	THIS_SHOULD_NEVER_HAPPEN;
+	return 0;
+}
+
+void	zbx_clean_events(void)
+{
+	THIS_SHOULD_NEVER_HAPPEN;
+}
+
+zbx_uint64_t	DCget_nextid(const char *table_name, int num)
+{
+	ZBX_UNUSED(table_name);
+	ZBX_UNUSED(num);
+
+	THIS_SHOULD_NEVER_HAPPEN;
+	exit(EXIT_FAILURE);
+}
+
+void	zbx_config_get(zbx_config_t *cfg, zbx_uint64_t flags)
+{
+	ZBX_UNUSED(cfg);
+	ZBX_UNUSED(flags);
+
+	THIS_SHOULD_NEVER_HAPPEN;
+	exit(EXIT_FAILURE);
+}
+
+int	zbx_interface_availability_is_set(const zbx_interface_availability_t *ia)
+{
+	ZBX_UNUSED(ia);
+
+	THIS_SHOULD_NEVER_HAPPEN;
+	return FAIL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: prepares bulk insert of a batch into the specified table          *
+ *                                                                            *
+ * Parameters: db_insert - [OUT] the bulk insert                              *
+ *             table     - [IN] the table name                                *
+ *             path      - [IN] the benchmarked path                          *
+ *             rows      - [IN] the number of rows in batch                   *
+ *                                                                            *
+ ******************************************************************************/
+static void	bench_prepare_batch(zbx_db_insert_t *db_insert, const char *table, int path, int rows)
+{
+	int		i;
+	zbx_uint64_t	itemid;
+	char		buffer[MAX_STRING_LEN];
+
+	if (0 == strcmp(table, "trends"))
+	{
+		zbx_db_insert_prepare(db_insert, table, "itemid", "clock", "num", "value_min", "value_avg",
+				"value_max", (char *)NULL);
+	}
+	else if (0 == strcmp(table, "history_log"))
+	{
+		zbx_db_insert_prepare(db_insert, table, "itemid", "clock", "ns", "timestamp", "source", "severity",
+				"value", "logeventid", (char *)NULL);
+	}
+	else
+		zbx_db_insert_prepare(db_insert, table, "itemid", "clock", "ns", "value", (char *)NULL);
+
+	if (BENCH_PATH_COPY == path)
+		zbx_db_insert_use_copy(db_insert);
+
+	for (i = 0; i < rows; i++)
+	{
+		itemid = BENCH_ITEMID + (zbx_uint64_t)i;
+
+		if (0 == strcmp(table, "history"))
+		{
+			zbx_db_insert_add_values(db_insert, itemid, BENCH_CLOCK, i, (double)(i % 1000) / 8);
+		}
+		else if (0 == strcmp(table, "history_uint"))
+		{
+			zbx_db_insert_add_values(db_insert, itemid, BENCH_CLOCK, i, (zbx_uint64_t)(i % 1000));
+		}
+		else if (0 == strcmp(table, "history_str"))
+		{
+			zbx_snprintf(buffer, sizeof(buffer), "value '%d'\twith characters to escape\\", i);
+			zbx_db_insert_add_values(db_insert, itemid, BENCH_CLOCK, i, buffer);
+		}
+		else if (0 == strcmp(table, "history_log"))
+		{
+			zbx_snprintf(buffer, sizeof(buffer), "2024-01-01 00:00:00 host app[%d]: connection from"
+					" 'client' closed\n", i);
+			zbx_db_insert_add_values(db_insert, itemid, BENCH_CLOCK, i, 0, "", 0, buffer, 0);
+		}
+		else
+		{
+			zbx_db_insert_add_values(db_insert, itemid, BENCH_CLOCK, 60, (double)(i % 1000) / 8,
+					(double)(i % 1000) / 4, (double)(i % 1000) / 2);
+		}
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: measures rows per second of the specified path, table and batch   *
+ *          size                                                              *
+ *                                                                            *
+ * Return value: the number of rows per second or -1 if loading failed        *
+ *                                                                            *
+ ******************************************************************************/
+static double	bench_path(const char *table, int path, int rows)
+{
+	zbx_db_insert_t	db_insert;
+	int		j, loops, ret = SUCCEED;
+	double		sec, total_sec = 0;
+
+	if (0 == (loops = BENCH_ROWS_TOTAL / rows))
+		loops = 1;
+
+	for (j = 0; j < loops && SUCCEED == ret; j++)
+	{
+		bench_prepare_batch(&db_insert, table, path, rows);
+
+		DBbegin();
+
+		sec = zbx_time();
+		ret = zbx_db_insert_execute(&db_insert);
+		total_sec += zbx_time() - sec;
+
+		DBrollback();
+
+		zbx_db_insert_clean(&db_insert);
+	}
+
+	if (SUCCEED != ret)
+		return -1;
+
+	return 0 != total_sec ? (double)rows * loops / total_sec : 0;
+}
+
+int	main(int argc, char **argv)
+{
+	const char	*bench_tables[] = {"history", "history_uint", "history_str", "history_log", "trends"};
+	int		batches[] = {1000, 10000}, *batch_rows = batches, batch_rows_num = (int)ARRSIZE(batches), i,
+			j, ret = SUCCEED;
+	double		insert_rate, copy_rate;
+	char		*error = NULL;
+
+	if (2 > argc)
+	{
+		zbx_error("usage: %s %s", progname, usage_message[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	CONFIG_DBNAME = argv[1];
+
+	if (2 < argc)
+	{
+		batch_rows = (int *)zbx_malloc(NULL, sizeof(int) * (size_t)(argc - 2));
+
+		for (batch_rows_num = 0; batch_rows_num < argc - 2; batch_rows_num++)
+		{
+			if (0 >= (batch_rows[batch_rows_num] = atoi(argv[batch_rows_num + 2])))
+			{
+				zbx_error("invalid number of rows \"%s\"", argv[batch_rows_num + 2]);
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+
+	if (SUCCEED != zabbix_open_log(LOG_TYPE_CONSOLE, LOG_LEVEL_WARNING, NULL, &error))
+	{
+		zbx_error("cannot open log: %s", error);
+		exit(EXIT_FAILURE);
+	}
+
+	if (SUCCEED != DBinit(&error))
+	{
+		zbx_error("cannot initialize database: %s", error);
+		exit(EXIT_FAILURE);
+	}
+
+	if (ZBX_DB_OK != DBconnect(ZBX_DB_CONNECT_ONCE))
+	{
+		zbx_error("cannot connect to database \"%s\"", CONFIG_DBNAME);
+		exit(EXIT_FAILURE);
+	}
+
+	printf("rows per second loaded by zbx_db_insert_execute()\n\n");
+	printf("%-13s %8s %12s %12s %9s\n", "table", "rows", "insert", "copy", "speedup");
+
+	for (i = 0; i < (int)ARRSIZE(bench_tables); i++)
+	{
+		for (j = 0; j < batch_rows_num; j++)
+		{
+			insert_rate = bench_path(bench_tables[i], BENCH_PATH_INSERT, batch_rows[j]);
+			copy_rate = bench_path(bench_tables[i], BENCH_PATH_COPY, batch_rows[j]);
+
+			if (0 > insert_rate || 0 > copy_rate)
+			{
+				printf("%-13s %8d %12s\n", bench_tables[i], batch_rows[j], "FAILED");
+				ret = FAIL;
+				continue;
+			}
+
+			printf("%-13s %8d %12.0f %12.0f %8.2fx\n", bench_tables[i], batch_rows[j], insert_rate, copy_rate,
+					0 != insert_rate ? copy_rate / insert_rate : 0);
+		}
+	}
+
+	DBclose();
+	DBdeinit();
+
+	if (batch_rows != batches)
+		zbx_free(batch_rows);
+
+	zabbix_close_log();
+
+	return SUCCEED == ret ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1271,6 +1271,54 @@ ZBX_TABLE	tables[] = {
 		},
 		NULL
 	},
+	{"trends_day",	"itemid,clock",	0,
+		{
+		{"itemid",	NULL,	"items",	"itemid",	0,	ZBX_TYPE_ID,	ZBX_NOTNULL,	ZBX_FK_CASCADE_DELETE},
+		{"clock",	"0",	NULL,	NULL,	0,	ZBX_TYPE_INT,	ZBX_NOTNULL,	0},
+		{"num",	"0",	NULL,	NULL,	0,	ZBX_TYPE_INT,	ZBX_NOTNULL,	0},
+		{"value_min",	"0.0000",	NULL,	NULL,	0,	ZBX_TYPE_FLOAT,	ZBX_NOTNULL,	0},
+		{"value_avg",	"0.0000",	NULL,	NULL,	0,	ZBX_TYPE_FLOAT,	ZBX_NOTNULL,	0},
+		{"value_max",	"0.0000",	NULL,	NULL,	0,	ZBX_TYPE_FLOAT,	ZBX_NOTNULL,	0},
+		{0}
+		},
+		NULL
+	},
+	{"trends_uint_day",	"itemid,clock",	0,
+		{
+		{"itemid",	NULL,	"items",	"itemid",	0,	ZBX_TYPE_ID,	ZBX_NOTNULL,	ZBX_FK_CASCADE_DELETE},
+		{"clock",	"0",	NULL,	NULL,	0,	ZBX_TYPE_INT,	ZBX_NOTNULL,	0},
+		{"num",	"0",	NULL,	NULL,	0,	ZBX_TYPE_INT,	ZBX_NOTNULL,	0},
+		{"value_min",	"0",	NULL,	NULL,	0,	ZBX_TYPE_UINT,	ZBX_NOTNULL,	0},
+		{"value_avg",	"0.0000",	NULL,	NULL,	0,	ZBX_TYPE_FLOAT,	ZBX_NOTNULL,	0},
+		{"value_max",	"0",	NULL,	NULL,	0,	ZBX_TYPE_UINT,	ZBX_NOTNULL,	0},
+		{0}
+		},
+		NULL
+	},
+	{"trends_month",	"itemid,clock",	0,
+		{
+		{"itemid",	NULL,	"items",	"itemid",	0,	ZBX_TYPE_ID,	ZBX_NOTNULL,	ZBX_FK_CASCADE_DELETE},
+		{"clock",	"0",	NULL,	NULL,	0,	ZBX_TYPE_INT,	ZBX_NOTNULL,	0},
+		{"num",	"0",	NULL,	NULL,	0,	ZBX_TYPE_INT,	ZBX_NOTNULL,	0},
+		{"value_min",	"0.0000",	NULL,	NULL,	0,	ZBX_TYPE_FLOAT,	ZBX_NOTNULL,	0},
+		{"value_avg",	"0.0000",	NULL,	NULL,	0,	ZBX_TYPE_FLOAT,	ZBX_NOTNULL,	0},
+		{"value_max",	"0.0000",	NULL,	NULL,	0,	ZBX_TYPE_FLOAT,	ZBX_NOTNULL,	0},
+		{0}
+		},
+		NULL
+	},
+	{"trends_uint_month",	"itemid,clock",	0,
+		{
+		{"itemid",	NULL,	"items",	"itemid",	0,	ZBX_TYPE_ID,	ZBX_NOTNULL,	ZBX_FK_CASCADE_DELETE},
+		{"clock",	"0",	NULL,	NULL,	0,	ZBX_TYPE_INT,	ZBX_NOTNULL,	0},
+		{"num",	"0",	NULL,	NULL,	0,	ZBX_TYPE_INT,	ZBX_NOTNULL,	0},
+		{"value_min",	"0",	NULL,	NULL,	0,	ZBX_TYPE_UINT,	ZBX_NOTNULL,	0},
+		{"value_avg",	"0.0000",	NULL,	NULL,	0,	ZBX_TYPE_FLOAT,	ZBX_NOTNULL,	0},
+		{"value_max",	"0",	NULL,	NULL,	0,	ZBX_TYPE_UINT,	ZBX_NOTNULL,	0},
+		{0}
+		},
+		NULL
+	},
 	{"acknowledges",	"acknowledgeid",	0,
 		{
 		{"acknowledgeid",	NULL,	NULL,	NULL,	0,	ZBX_TYPE_ID,	ZBX_NOTNULL,	0},
@@ -2395,6 +2443,17 @@ ZBX_TABLE	tables[] = {
 		},
 		NULL
 	},
+	{"changelog",	"changelogid",	0,
+		{
+		{"changelogid",	NULL,	NULL,	NULL,	0,	ZBX_TYPE_UINT,	ZBX_NOTNULL,	0},
+		{"object",	"0",	NULL,	NULL,	0,	ZBX_TYPE_INT,	ZBX_NOTNULL,	0},
+		{"objectid",	NULL,	NULL,	NULL,	0,	ZBX_TYPE_ID,	ZBX_NOTNULL,	0},
+		{"operation",	"0",	NULL,	NULL,	0,	ZBX_TYPE_INT,	ZBX_NOTNULL,	0},
+		{"clock",	"0",	NULL,	NULL,	0,	ZBX_TYPE_INT,	ZBX_NOTNULL,	0},
+		{0}
+		},
+		NULL
+	},
 	{"dbversion",	"dbversionid",	0,
 		{
 		{"dbversionid",	NULL,	NULL,	NULL,	0,	ZBX_TYPE_ID,	ZBX_NOTNULL,	0},
@@ -3564,6 +3623,42 @@ value_avg bigint DEFAULT '0' NOT NULL,\n\
 value_max bigint DEFAULT '0' NOT NULL,\n\
 PRIMARY KEY (itemid,clock)\n\
 );\n\
+CREATE TABLE trends_day (\n\
+itemid bigint  NOT NULL,\n\
+clock integer DEFAULT '0' NOT NULL,\n\
+num integer DEFAULT '0' NOT NULL,\n\
+value_min DOUBLE PRECISION DEFAULT '0.0000' NOT NULL,\n\
+value_avg DOUBLE PRECISION DEFAULT '0.0000' NOT NULL,\n\
+value_max DOUBLE PRECISION DEFAULT '0.0000' NOT NULL,\n\
+PRIMARY KEY (itemid,clock)\n\
+);\n\
+CREATE TABLE trends_uint_day (\n\
+itemid bigint  NOT NULL,\n\
+clock integer DEFAULT '0' NOT NULL,\n\
+num integer DEFAULT '0' NOT NULL,\n\
+value_min bigint DEFAULT '0' NOT NULL,\n\
+value_avg DOUBLE PRECISION DEFAULT '0.0000' NOT NULL,\n\
+value_max bigint DEFAULT '0' NOT NULL,\n\
+PRIMARY KEY (itemid,clock)\n\
+);\n\
+CREATE TABLE trends_month (\n\
+itemid bigint  NOT NULL,\n\
+clock integer DEFAULT '0' NOT NULL,\n\
+num integer DEFAULT '0' NOT NULL,\n\
+value_min DOUBLE PRECISION DEFAULT '0.0000' NOT NULL,\n\
+value_avg DOUBLE PRECISION DEFAULT '0.0000' NOT NULL,\n\
+value_max DOUBLE PRECISION DEFAULT '0.0000' NOT NULL,\n\
+PRIMARY KEY (itemid,clock)\n\
+);\n\
+CREATE TABLE trends_uint_month (\n\
+itemid bigint  NOT NULL,\n\
+clock integer DEFAULT '0' NOT NULL,\n\
+num integer DEFAULT '0' NOT NULL,\n\
+value_min bigint DEFAULT '0' NOT NULL,\n\
+value_avg DOUBLE PRECISION DEFAULT '0.0000' NOT NULL,\n\
+value_max bigint DEFAULT '0' NOT NULL,\n\
+PRIMARY KEY (itemid,clock)\n\
+);\n\
 CREATE TABLE acknowledges (\n\
 acknowledgeid bigint  NOT NULL,\n\
 userid bigint  NOT NULL REFERENCES users (userid) ON DELETE CASCADE,\n\
@@ -4524,6 +4619,13 @@ value varchar(255) DEFAULT '' NOT NULL,\n\
 PRIMARY KEY (sla_service_tagid)\n\
 );\n\
 CREATE INDEX sla_service_tag_1 ON sla_service_tag (slaid);\n\
+CREATE TABLE changelog (\n\
+changelogid integer  NOT NULL PRIMARY KEY AUTOINCREMENT,\n\
+object integer DEFAULT '0' NOT NULL,\n\
+objectid bigint  NOT NULL,\n\
+operation integer DEFAULT '0' NOT NULL,\n\
+clock integer DEFAULT '0' NOT NULL\n\
+);\n\
 CREATE TABLE dbversion (\n\
 dbversionid bigint  NOT NULL,\n\
 mandatory integer DEFAULT '0' NOT NULL,\n\
@@ -4531,6 +4633,51 @@ optional integer DEFAULT '0' NOT NULL,\n\
 PRIMARY KEY (dbversionid)\n\
 );\n\
 INSERT INTO dbversion VALUES ('1','6000000','6000054');\n\
+create trigger items_insert after insert on items for each row\n\
+begin\n\
+insert into changelog (object,objectid,operation,clock)\n\
+values (1,new.itemid,1,cast(strftime('%s','now') as integer));\n\
+end;\n\
+create trigger items_update after update on items for each row\n\
+begin\n\
+insert into changelog (object,objectid,operation,clock)\n\
+values (1,new.itemid,2,cast(strftime('%s','now') as integer));\n\
+end;\n\
+create trigger items_delete after delete on items for each row\n\
+begin\n\
+insert into changelog (object,objectid,operation,clock)\n\
+values (1,old.itemid,3,cast(strftime('%s','now') as integer));\n\
+end;\n\
+create trigger triggers_insert after insert on triggers for each row\n\
+begin\n\
+insert into changelog (object,objectid,operation,clock)\n\
+values (2,new.triggerid,1,cast(strftime('%s','now') as integer));\n\
+end;\n\
+create trigger triggers_update after update of description,expression,priority,type,status,recovery_mode,recovery_expression,correlation_mode,correlation_tag,opdata,event_name,flags on triggers for each row\n\
+begin\n\
+insert into changelog (object,objectid,operation,clock)\n\
+values (2,new.triggerid,2,cast(strftime('%s','now') as integer));\n\
+end;\n\
+create trigger triggers_delete after delete on triggers for each row\n\
+begin\n\
+insert into changelog (object,objectid,operation,clock)\n\
+values (2,old.triggerid,3,cast(strftime('%s','now') as integer));\n\
+end;\n\
+create trigger functions_insert after insert on functions for each row\n\
+begin\n\
+insert into changelog (object,objectid,operation,clock)\n\
+values (3,new.functionid,1,cast(strftime('%s','now') as integer));\n\
+end;\n\
+create trigger functions_update after update on functions for each row\n\
+begin\n\
+insert into changelog (object,objectid,operation,clock)\n\
+values (3,new.functionid,2,cast(strftime('%s','now') as integer));\n\
+end;\n\
+create trigger functions_delete after delete on functions for each row\n\
+begin\n\
+insert into changelog (object,objectid,operation,clock)\n\
+values (3,old.functionid,3,cast(strftime('%s','now') as integer));\n\
+end;\n\
 ";
 const char	*const db_schema_fkeys[] = {
 	NULL
@@ -1370,6 +1370,10 @@ void	DBdelete_items(zbx_vector_uint64_t *itemids)
 	{
 		zbx_vector_str_append(&hk_history, "trends");
 		zbx_vector_str_append(&hk_history, "trends_uint");
+		zbx_vector_str_append(&hk_history, "trends_day");
+		zbx_vector_str_append(&hk_history, "trends_uint_day");
+		zbx_vector_str_append(&hk_history, "trends_month");
+		zbx_vector_str_append(&hk_history, "trends_uint_month");
 	}
 
 	if (0 != hk_history.values_num)
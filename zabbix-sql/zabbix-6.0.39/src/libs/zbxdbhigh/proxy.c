@@ -133,6 +133,26 @@ typedef struct
 }
 zbx_keys_path_t;
 
+/* locations of history data row values in JSON, NULL if the tag is not present */
+typedef struct
+{
+	const char	*host;
+	const char	*key;
+	const char	*itemid;
+	const char	*clock;
+	const char	*ns;
+	const char	*state;
+	const char	*lastlogsize;
+	const char	*mtime;
+	const char	*value;
+	const char	*timestamp;
+	const char	*source;
+	const char	*severity;
+	const char	*logeventid;
+	const char	*id;
+}
+zbx_history_row_t;
+
 /******************************************************************************
  *                                                                            *
  * Purpose: check proxy connection permissions (encryption configuration and  *
@@ -3035,6 +3055,7 @@ int	process_history_data(zbx_history_recv_item_t *items, zbx_agent_value_t *valu
 		zbx_dc_items_update_nextcheck(items, values, errcodes, values_num);
 
 	zbx_preprocessor_flush();
+	zbx_lld_flush();
 	dc_flush_history();
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() processed:%d", __func__, processed_num);
@@ -3113,11 +3134,88 @@ static void	log_client_timediff(int level, struct zbx_json_parse *jp, const zbx_
 	}
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: locates values of history data json row tags                      *
+ *                                                                            *
+ * Parameters: jp_row - [IN] JSON with history data row                       *
+ *             row    - [OUT] the value locations                             *
+ *                                                                            *
+ * Comments: The row is scanned once instead of searching it from the start   *
+ *           for every tag. When a tag is duplicated the first value is used  *
+ *           as it would be found by zbx_json_value_by_name().                *
+ *                                                                            *
+ ******************************************************************************/
+static void	parse_history_data_row(const struct zbx_json_parse *jp_row, zbx_history_row_t *row)
+{
+	char		name[MAX_STRING_LEN];
+	const char	*p = NULL, **pvalue;
+
+	memset(row, 0, sizeof(zbx_history_row_t));
+
+	while (NULL != (p = zbx_json_pair_next(jp_row, p, name, sizeof(name))))
+	{
+		if (0 == strcmp(name, ZBX_PROTO_TAG_VALUE))
+			pvalue = &row->value;
+		else if (0 == strcmp(name, ZBX_PROTO_TAG_CLOCK))
+			pvalue = &row->clock;
+		else if (0 == strcmp(name, ZBX_PROTO_TAG_NS))
+			pvalue = &row->ns;
+		else if (0 == strcmp(name, ZBX_PROTO_TAG_ID))
+			pvalue = &row->id;
+		else if (0 == strcmp(name, ZBX_PROTO_TAG_ITEMID))
+			pvalue = &row->itemid;
+		else if (0 == strcmp(name, ZBX_PROTO_TAG_HOST))
+			pvalue = &row->host;
+		else if (0 == strcmp(name, ZBX_PROTO_TAG_KEY))
+			pvalue = &row->key;
+		else if (0 == strcmp(name, ZBX_PROTO_TAG_STATE))
+			pvalue = &row->state;
+		else if (0 == strcmp(name, ZBX_PROTO_TAG_LASTLOGSIZE))
+			pvalue = &row->lastlogsize;
+		else if (0 == strcmp(name, ZBX_PROTO_TAG_MTIME))
+			pvalue = &row->mtime;
+		else if (0 == strcmp(name, ZBX_PROTO_TAG_LOGTIMESTAMP))
+			pvalue = &row->timestamp;
+		else if (0 == strcmp(name, ZBX_PROTO_TAG_LOGSOURCE))
+			pvalue = &row->source;
+		else if (0 == strcmp(name, ZBX_PROTO_TAG_LOGSEVERITY))
+			pvalue = &row->severity;
+		else if (0 == strcmp(name, ZBX_PROTO_TAG_LOGEVENTID))
+			pvalue = &row->logeventid;
+		else
+			continue;
+
+		if (NULL == *pvalue)
+			*pvalue = p;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: decodes history data row value                                    *
+ *                                                                            *
+ * Parameters: p            - [IN] the value location in JSON, can be NULL    *
+ *             string       - [IN/OUT] the decoded value                      *
+ *             string_alloc - [IN/OUT] the decoded value buffer size          *
+ *                                                                            *
+ * Return value:  SUCCEED - the value was decoded successfully                *
+ *                FAIL    - the value is missing or is not a primitive value  *
+ *                                                                            *
+ ******************************************************************************/
+static int	parse_history_data_row_decode(const char *p, char **string, size_t *string_alloc)
+{
+	if (NULL == p || NULL == zbx_json_decodevalue_dyn(p, string, string_alloc, NULL))
+		return FAIL;
+
+	return SUCCEED;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: parses agent value from history data json row                     *
  *                                                                            *
- * Parameters: jp_row       - [IN] JSON with history data row                 *
+ * Parameters: row          - [IN] the history data row value locations       *
  *             unique_shift - [IN/OUT] auto increment nanoseconds to ensure   *
  *                                     unique value of timestamps             *
  *             av           - [OUT] the agent value                           *
@@ -3126,7 +3224,7 @@ static void	log_client_timediff(int level, struct zbx_json_parse *jp, const zbx_
  *                FAIL    - otherwise                                         *
  *                                                                            *
  ******************************************************************************/
-static int	parse_history_data_row_value(const struct zbx_json_parse *jp_row, zbx_timespec_t *unique_shift,
+static int	parse_history_data_row_value(const zbx_history_row_t *row, zbx_timespec_t *unique_shift,
 		zbx_agent_value_t *av)
 {
 	char	*tmp = NULL;
@@ -3135,12 +3233,12 @@ static int	parse_history_data_row_value(const struct zbx_json_parse *jp_row, zbx
 
 	memset(av, 0, sizeof(zbx_agent_value_t));
 
-	if (SUCCEED == zbx_json_value_by_name_dyn(jp_row, ZBX_PROTO_TAG_CLOCK, &tmp, &tmp_alloc, NULL))
+	if (SUCCEED == parse_history_data_row_decode(row->clock, &tmp, &tmp_alloc))
 	{
 		if (FAIL == is_uint31(tmp, &av->ts.sec))
 			goto out;
 
-		if (SUCCEED == zbx_json_value_by_name_dyn(jp_row, ZBX_PROTO_TAG_NS, &tmp, &tmp_alloc, NULL))
+		if (SUCCEED == parse_history_data_row_decode(row->ns, &tmp, &tmp_alloc))
 		{
 			if (FAIL == is_uint_n_range(tmp, tmp_alloc, &av->ts.ns, sizeof(av->ts.ns),
 				0LL, 999999999LL))
@@ -3165,40 +3263,40 @@ static int	parse_history_data_row_value(const struct zbx_json_parse *jp_row, zbx
 	else
 		zbx_timespec(&av->ts);
 
-	if (SUCCEED == zbx_json_value_by_name_dyn(jp_row, ZBX_PROTO_TAG_STATE, &tmp, &tmp_alloc, NULL))
+	if (SUCCEED == parse_history_data_row_decode(row->state, &tmp, &tmp_alloc))
 		av->state = (unsigned char)atoi(tmp);
 
 	/* Unsupported item meta information must be ignored for backwards compatibility. */
 	/* New agents will not send meta information for items in unsupported state.      */
 	if (ITEM_STATE_NOTSUPPORTED != av->state)
 	{
-		if (SUCCEED == zbx_json_value_by_name_dyn(jp_row, ZBX_PROTO_TAG_LASTLOGSIZE, &tmp, &tmp_alloc, NULL))
+		if (SUCCEED == parse_history_data_row_decode(row->lastlogsize, &tmp, &tmp_alloc))
 		{
 			av->meta = 1;	/* contains meta information */
 
 			is_uint64(tmp, &av->lastlogsize);
 
-			if (SUCCEED == zbx_json_value_by_name_dyn(jp_row, ZBX_PROTO_TAG_MTIME, &tmp, &tmp_alloc, NULL))
+			if (SUCCEED == parse_history_data_row_decode(row->mtime, &tmp, &tmp_alloc))
 				av->mtime = atoi(tmp);
 		}
 	}
 
-	if (SUCCEED == zbx_json_value_by_name_dyn(jp_row, ZBX_PROTO_TAG_VALUE, &tmp, &tmp_alloc, NULL))
+	if (SUCCEED == parse_history_data_row_decode(row->value, &tmp, &tmp_alloc))
 		av->value = zbx_strdup(av->value, tmp);
 
-	if (SUCCEED == zbx_json_value_by_name_dyn(jp_row, ZBX_PROTO_TAG_LOGTIMESTAMP, &tmp, &tmp_alloc, NULL))
+	if (SUCCEED == parse_history_data_row_decode(row->timestamp, &tmp, &tmp_alloc))
 		av->timestamp = atoi(tmp);
 
-	if (SUCCEED == zbx_json_value_by_name_dyn(jp_row, ZBX_PROTO_TAG_LOGSOURCE, &tmp, &tmp_alloc, NULL))
+	if (SUCCEED == parse_history_data_row_decode(row->source, &tmp, &tmp_alloc))
 		av->source = zbx_strdup(av->source, tmp);
 
-	if (SUCCEED == zbx_json_value_by_name_dyn(jp_row, ZBX_PROTO_TAG_LOGSEVERITY, &tmp, &tmp_alloc, NULL))
+	if (SUCCEED == parse_history_data_row_decode(row->severity, &tmp, &tmp_alloc))
 		av->severity = atoi(tmp);
 
-	if (SUCCEED == zbx_json_value_by_name_dyn(jp_row, ZBX_PROTO_TAG_LOGEVENTID, &tmp, &tmp_alloc, NULL))
+	if (SUCCEED == parse_history_data_row_decode(row->logeventid, &tmp, &tmp_alloc))
 		av->logeventid = atoi(tmp);
 
-	if (SUCCEED != zbx_json_value_by_name_dyn(jp_row, ZBX_PROTO_TAG_ID, &tmp, &tmp_alloc, NULL) ||
+	if (SUCCEED != parse_history_data_row_decode(row->id, &tmp, &tmp_alloc) ||
 			SUCCEED != is_uint64(tmp, &av->id))
 	{
 		av->id = 0;
@@ -3215,18 +3313,18 @@ out:
  *                                                                            *
  * Purpose: parses item identifier from history data json row                 *
  *                                                                            *
- * Parameters: jp_row - [IN] JSON with history data row                       *
+ * Parameters: row    - [IN] the history data row value locations             *
  *             itemid - [OUT] the item identifier                             *
  *                                                                            *
  * Return value:  SUCCEED - the item identifier was parsed successfully       *
  *                FAIL    - otherwise                                         *
  *                                                                            *
  ******************************************************************************/
-static int	parse_history_data_row_itemid(const struct zbx_json_parse *jp_row, zbx_uint64_t *itemid)
+static int	parse_history_data_row_itemid(const zbx_history_row_t *row, zbx_uint64_t *itemid)
 {
 	char	buffer[MAX_ID_LEN + 1];
 
-	if (SUCCEED != zbx_json_value_by_name(jp_row, ZBX_PROTO_TAG_ITEMID, buffer, sizeof(buffer), NULL))
+	if (NULL == row->itemid || NULL == zbx_json_decodevalue(row->itemid, buffer, sizeof(buffer), NULL))
 		return FAIL;
 
 	if (SUCCEED != is_uint64(buffer, itemid))
@@ -3238,27 +3336,27 @@ static int	parse_history_data_row_itemid(const struct zbx_json_parse *jp_row, zb
  *                                                                            *
  * Purpose: parses host,key pair from history data json row                   *
  *                                                                            *
- * Parameters: jp_row - [IN] JSON with history data row                       *
- *             hk     - [OUT] the host,key pair                               *
+ * Parameters: row - [IN] the history data row value locations                *
+ *             hk  - [OUT] the host,key pair                                  *
  *                                                                            *
  * Return value:  SUCCEED - the host,key pair was parsed successfully         *
  *                FAIL    - otherwise                                         *
  *                                                                            *
  ******************************************************************************/
-static int	parse_history_data_row_hostkey(const struct zbx_json_parse *jp_row, zbx_host_key_t *hk)
+static int	parse_history_data_row_hostkey(const zbx_history_row_t *row, zbx_host_key_t *hk)
 {
 	size_t str_alloc;
 
 	str_alloc = 0;
 	zbx_free(hk->host);
 
-	if (SUCCEED != zbx_json_value_by_name_dyn(jp_row, ZBX_PROTO_TAG_HOST, &hk->host, &str_alloc, NULL))
+	if (SUCCEED != parse_history_data_row_decode(row->host, &hk->host, &str_alloc))
 		return FAIL;
 
 	str_alloc = 0;
 	zbx_free(hk->key);
 
-	if (SUCCEED != zbx_json_value_by_name_dyn(jp_row, ZBX_PROTO_TAG_KEY, &hk->key, &str_alloc, NULL))
+	if (SUCCEED != parse_history_data_row_decode(row->key, &hk->key, &str_alloc))
 	{
 		zbx_free(hk->host);
 		return FAIL;
@@ -3291,6 +3389,7 @@ static int	parse_history_data(struct zbx_json_parse *jp_data, const char **pnext
 		zbx_host_key_t *hostkeys, int *values_num, int *parsed_num, zbx_timespec_t *unique_shift)
 {
 	struct zbx_json_parse	jp_row;
+	zbx_history_row_t	row;
 	int			ret = FAIL;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
@@ -3316,12 +3415,17 @@ static int	parse_history_data(struct zbx_json_parse *jp_data, const char **pnext
 			goto out;
 		}
 
+		/* the next row is searched from the end of current one instead of scanning it again */
+		*pnext = jp_row.end + 1;
+
 		(*parsed_num)++;
 
-		if (SUCCEED != parse_history_data_row_hostkey(&jp_row, &hostkeys[*values_num]))
+		parse_history_data_row(&jp_row, &row);
+
+		if (SUCCEED != parse_history_data_row_hostkey(&row, &hostkeys[*values_num]))
 			continue;
 
-		if (SUCCEED != parse_history_data_row_value(&jp_row, unique_shift, &values[*values_num]))
+		if (SUCCEED != parse_history_data_row_value(&row, unique_shift, &values[*values_num]))
 			continue;
 
 		(*values_num)++;
@@ -3366,6 +3470,7 @@ static int	parse_history_data_by_itemids(struct zbx_json_parse *jp_data, const c
 		zbx_timespec_t *unique_shift, char **error)
 {
 	struct zbx_json_parse	jp_row;
+	zbx_history_row_t	row;
 	int			ret = FAIL;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
@@ -3391,12 +3496,17 @@ static int	parse_history_data_by_itemids(struct zbx_json_parse *jp_data, const c
 			goto out;
 		}
 
+		/* the next row is searched from the end of current one instead of scanning it again */
+		*pnext = jp_row.end + 1;
+
 		(*parsed_num)++;
 
-		if (SUCCEED != parse_history_data_row_itemid(&jp_row, &itemids[*values_num]))
+		parse_history_data_row(&jp_row, &row);
+
+		if (SUCCEED != parse_history_data_row_itemid(&row, &itemids[*values_num]))
 			continue;
 
-		if (SUCCEED != parse_history_data_row_value(&jp_row, unique_shift, &values[*values_num]))
+		if (SUCCEED != parse_history_data_row_value(&row, unique_shift, &values[*values_num]))
 			continue;
 
 		(*values_num)++;
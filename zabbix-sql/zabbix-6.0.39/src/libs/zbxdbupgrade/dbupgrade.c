@@ -26,8 +26,9 @@
 
 typedef struct
 {
-	zbx_dbpatch_t	*patches;
-	const char	*description;
+	zbx_dbpatch_t		*patches;
+	const char		*description;
+	zbx_dbpatch_ext_t	*ext_patches;
 }
 zbx_db_version_t;
 
@@ -783,6 +784,8 @@ extern zbx_dbpatch_t	DBPATCH_VERSION(5040)[];
 extern zbx_dbpatch_t	DBPATCH_VERSION(5050)[];
 extern zbx_dbpatch_t	DBPATCH_VERSION(6000)[];
 
+extern zbx_dbpatch_ext_t	DBPATCH_EXT_VERSION(6000)[];
+
 static zbx_db_version_t dbversions[] = {
 	{DBPATCH_VERSION(2010), "2.2 development"},
 	{DBPATCH_VERSION(2020), "2.2 maintenance"},
@@ -807,7 +810,7 @@ static zbx_db_version_t dbversions[] = {
 	{DBPATCH_VERSION(5030), "5.4 development"},
 	{DBPATCH_VERSION(5040), "5.4 maintenance"},
 	{DBPATCH_VERSION(5050), "6.0 development"},
-	{DBPATCH_VERSION(6000), "6.0 maintenance"},
+	{DBPATCH_VERSION(6000), "6.0 maintenance", DBPATCH_EXT_VERSION(6000)},
 	{NULL}
 };
 
@@ -835,6 +838,48 @@ static void	DBget_version(int *mandatory, int *optional)
 	}
 }
 
+#ifndef HAVE_SQLITE3
+/******************************************************************************
+ *                                                                            *
+ * Purpose: applies schema extension patches of all versions                  *
+ *                                                                            *
+ * Comments: The database version row is locked during each patch, so nodes   *
+ *           starting at the same time do not apply the same patch twice.     *
+ *           A failed patch is rolled back and skipped with a warning, for    *
+ *           example MySQL with binary logging does not allow creating        *
+ *           triggers without SUPER privilege. Configuration cache then uses  *
+ *           full compare instead of changelog (see zbx_dbsync_env_prepare()).*
+ *                                                                            *
+ ******************************************************************************/
+static void	DBpatch_extensions(void)
+{
+	zbx_db_version_t	*dbversion;
+	zbx_dbpatch_ext_t	*patch;
+
+	for (dbversion = dbversions; NULL != dbversion->patches; dbversion++)
+	{
+		if (NULL == dbversion->ext_patches)
+			continue;
+
+		for (patch = dbversion->ext_patches; NULL != patch->name; patch++)
+		{
+			DB_RESULT	result;
+
+			DBbegin();
+
+			result = DBselect("select optional from dbversion" ZBX_FOR_UPDATE);
+			DBfree_result(result);
+
+			if (SUCCEED != DBend(patch->function()))
+			{
+				zabbix_log(LOG_LEVEL_WARNING, "cannot apply schema extension patch \"%s\" of %s,"
+						" continuing without it", patch->name, dbversion->description);
+			}
+		}
+	}
+}
+#endif
+
 int	DBcheck_version(void)
 {
 #define ZBX_DB_WAIT_UPGRADE	10
@@ -929,7 +974,7 @@ int	DBcheck_version(void)
 
 #ifndef HAVE_SQLITE3
 	if (0 == total)
-		goto out;
+		goto extensions;
 
 	if (0 != optional_num)
 		zabbix_log(LOG_LEVEL_INFORMATION, "optional patches were found");
@@ -1012,6 +1057,9 @@ int	DBcheck_version(void)
 				patches[i].version, ZBX_DB_WAIT_UPGRADE);
 		sleep(ZBX_DB_WAIT_UPGRADE);
 	}
+extensions:
+	if (SUCCEED == ret)
+		DBpatch_extensions();
 #endif	/* not HAVE_SQLITE3 */
 
 out:
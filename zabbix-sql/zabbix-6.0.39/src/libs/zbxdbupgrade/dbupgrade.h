@@ -37,13 +37,30 @@ zbx_dbpatch_t;
 #define DBPATCH_START(zabbix_version)			zbx_dbpatch_t	DBPATCH_VERSION(zabbix_version)[] = {
 #define DBPATCH_END()					{NULL}};
 
+/* Schema extension patches are not numbered, so they do not take the version numbers of  */
+/* future upstream patches. They are applied after the numbered patches on every start,   */
+/* are not recorded in the database version and must skip the changes that already exist. */
+typedef struct
+{
+	int		(*function)(void);
+	const char	*name;
+}
+zbx_dbpatch_ext_t;
+
+#define DBPATCH_EXT_VERSION(zabbix_version)		zbx_dbpatches_ext_##zabbix_version
+
+#define DBPATCH_EXT_START(zabbix_version)		zbx_dbpatch_ext_t	DBPATCH_EXT_VERSION(zabbix_version)[] = {
+#define DBPATCH_EXT_END()				{NULL}};
+
 #ifdef HAVE_SQLITE3
 
 #define DBPATCH_ADD(version, duplicates, mandatory)	{NULL, version, duplicates, mandatory},
+#define DBPATCH_EXT_ADD(name)				{NULL, #name},
 
 #else
 
 #define DBPATCH_ADD(version, duplicates, mandatory)	{DBpatch_##version, version, duplicates, mandatory},
+#define DBPATCH_EXT_ADD(name)				{DBpatch_ext_##name, #name},
 
 #ifdef HAVE_MYSQL
 #define ZBX_FS_SQL_NAME "`%s`"
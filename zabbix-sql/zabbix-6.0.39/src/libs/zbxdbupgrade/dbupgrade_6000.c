@@ -691,6 +691,255 @@ static int	DBpatch_6000054(void)
 	return DBcreate_index("dashboard", "dashboard_3", "uuid", 0);
 }
 
+static int	DBpatch_ext_changelog(void)
+{
+	if (SUCCEED == DBtable_exists("changelog"))
+		return SUCCEED;
+#if defined(HAVE_MYSQL)
+	if (ZBX_DB_OK > DBexecute(
+			"create table changelog ("
+				"changelogid bigint unsigned not null auto_increment,"
+				"object integer default '0' not null,"
+				"objectid bigint unsigned not null,"
+				"operation integer default '0' not null,"
+				"clock integer default '0' not null,"
+				"primary key (changelogid)"
+			") engine=innodb"))
+	{
+		return FAIL;
+	}
+#elif defined(HAVE_POSTGRESQL)
+	if (ZBX_DB_OK > DBexecute(
+			"create table changelog ("
+				"changelogid bigserial not null,"
+				"object integer default '0' not null,"
+				"objectid bigint not null,"
+				"operation integer default '0' not null,"
+				"clock integer default '0' not null,"
+				"primary key (changelogid)"
+			")"))
+	{
+		return FAIL;
+	}
+#elif defined(HAVE_ORACLE)
+	if (ZBX_DB_OK > DBexecute(
+			"create table changelog ("
+				"changelogid number(20) not null,"
+				"object number(10) default '0' not null,"
+				"objectid number(20) not null,"
+				"operation number(10) default '0' not null,"
+				"clock number(10) default '0' not null,"
+				"primary key (changelogid)"
+			")"))
+	{
+		return FAIL;
+	}
+
+	if (ZBX_DB_OK > DBexecute("create sequence changelog_seq start with 1 increment by 1 nomaxvalue"))
+		return FAIL;
+
+	if (ZBX_DB_OK > DBexecute(
+			"create trigger changelog_tr\n"
+			"before insert on changelog for each row\n"
+			"begin\n"
+				"select changelog_seq.nextval into :new.changelogid from dual;\n"
+			"end;"))
+	{
+		return FAIL;
+	}
+#endif
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: creates triggers recording table changes into changelog table     *
+ *                                                                            *
+ * Parameters: table_name - [IN] the table name                               *
+ *             idname     - [IN] the table identifier field name              *
+ *             object     - [IN] the changelog object type (1 - item,         *
+ *                               2 - trigger, 3 - function)                   *
+ *             columns    - [IN] comma separated list of fields to track      *
+ *                               updates of, NULL to track all updates        *
+ *                                                                            *
+ * Return value: SUCCEED - the triggers were created or already exist         *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	DBpatch_add_changelog_triggers(const char *table_name, const char *idname, int object,
+		const char *columns)
+{
+#define CHANGELOG_OPERATION_NUM	3
+	const char	*operations[CHANGELOG_OPERATION_NUM] = {"insert", "update", "delete"};
+	int		i, ret = SUCCEED;
+
+	/* triggers without the table would fail all changes of configuration */
+	if (SUCCEED != DBtable_exists("changelog"))
+		return FAIL;
+
+	for (i = 0; i < CHANGELOG_OPERATION_NUM && SUCCEED == ret; i++)
+	{
+		char		*sql = NULL;
+		size_t		sql_alloc = 0, sql_offset = 0;
+		const char	*ref = (2 == i ? "old" : "new");
+
+		sql = zbx_dsprintf(sql, "%s_%s", table_name, operations[i]);
+
+		if (SUCCEED == DBtrigger_exists(table_name, sql))
+		{
+			zbx_free(sql);
+			continue;
+		}
+
+		zbx_free(sql);
+#if defined(HAVE_MYSQL)
+		zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
+				"create trigger %s_%s after %s on %s for each row\n",
+				table_name, operations[i], operations[i], table_name);
+
+		/* MySQL does not support update triggers for the specified columns */
+		if (1 == i && NULL != columns)
+		{
+			const char	*column, *next;
+
+			zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, "begin\nif not (");
+
+			for (column = columns; NULL != column; column = (NULL != next ? next + 1 : NULL))
+			{
+				int	len;
+
+				if (NULL != (next = strchr(column, ',')))
+					len = (int)(next - column);
+				else
+					len = (int)strlen(column);
+
+				zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, "%snew.%.*s<=>old.%.*s",
+						column == columns ? "" : " and ", len, column, len, column);
+			}
+
+			zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, ")\nthen\n");
+		}
+
+		zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
+				"insert into changelog (object,objectid,operation,clock)\n"
+				"values (%d,%s.%s,%d,unix_timestamp())",
+				object, ref, idname, i + 1);
+
+		if (1 == i && NULL != columns)
+			zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, ";\nend if;\nend");
+#elif defined(HAVE_POSTGRESQL)
+		zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
+				"create or replace function changelog_%s_%s()\n"
+				"returns trigger language plpgsql as $func$\n"
+				"begin\n"
+					"insert into changelog (object,objectid,operation,clock)\n"
+					"values (%d,%s.%s,%d,cast(extract(epoch from now()) as int));\n"
+					"return null;\n"
+				"end $func$;\n"
+
+				"create trigger %s_%s after %s%s%s\n"
+					"on %s\n"
+					"for each row execute function changelog_%s_%s();",
+				table_name, operations[i], object, ref, idname, i + 1,
+				table_name, operations[i], operations[i], (1 == i && NULL != columns ? " of " : ""),
+				(1 == i && NULL != columns ? columns : ""), table_name, table_name, operations[i]);
+#elif defined(HAVE_ORACLE)
+		zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
+				"create trigger %s_%s\n"
+				"after %s%s%s on %s for each row\n"
+				"begin\n"
+					"insert into changelog (object,objectid,operation,clock)\n"
+					"values (%d,:%s.%s,%d,"
+						"(cast(sys_extract_utc(systimestamp) as date)-date'1970-01-01')*86400);\n"
+				"end;",
+				table_name, operations[i], operations[i], (1 == i && NULL != columns ? " of " : ""),
+				(1 == i && NULL != columns ? columns : ""), table_name, object, ref, idname, i + 1);
+#endif
+		if (ZBX_DB_OK > DBexecute("%s", sql))
+			ret = FAIL;
+
+		zbx_free(sql);
+	}
+
+	return ret;
+#undef CHANGELOG_OPERATION_NUM
+}
+
+static int	DBpatch_ext_changelog_items(void)
+{
+	return DBpatch_add_changelog_triggers("items", "itemid", 1, NULL);
+}
+
+static int	DBpatch_ext_changelog_triggers(void)
+{
+	return DBpatch_add_changelog_triggers("triggers", "triggerid", 2, "description,expression,priority,type,"
+			"status,recovery_mode,recovery_expression,correlation_mode,correlation_tag,opdata,event_name,"
+			"flags");
+}
+
+static int	DBpatch_ext_changelog_functions(void)
+{
+	return DBpatch_add_changelog_triggers("functions", "functionid", 3, NULL);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: creates trends rollup table                                       *
+ *                                                                            *
+ * Parameters: table_name - [IN] the table name                               *
+ *             value_type - [IN] the item value type of the rolled up trends  *
+ *                                                                            *
+ * Return value: SUCCEED - the table was created or already exists            *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: Average of unsigned trends is rolled up as floating value to     *
+ *           avoid accumulating rounding errors.                              *
+ *                                                                            *
+ ******************************************************************************/
+static int	DBpatch_add_trends_rollup_table(const char *table_name, unsigned char value_type)
+{
+	const char	*value_default = (ITEM_VALUE_TYPE_FLOAT == value_type ? "0.0000" : "0");
+	unsigned char	field_type = (ITEM_VALUE_TYPE_FLOAT == value_type ? ZBX_TYPE_FLOAT : ZBX_TYPE_UINT);
+	const ZBX_TABLE	table =
+			{table_name, "itemid,clock", 0,
+				{
+					{"itemid", NULL, NULL, NULL, 0, ZBX_TYPE_ID, ZBX_NOTNULL, 0},
+					{"clock", "0", NULL, NULL, 0, ZBX_TYPE_INT, ZBX_NOTNULL, 0},
+					{"num", "0", NULL, NULL, 0, ZBX_TYPE_INT, ZBX_NOTNULL, 0},
+					{"value_min", value_default, NULL, NULL, 0, field_type, ZBX_NOTNULL, 0},
+					{"value_avg", "0.0000", NULL, NULL, 0, ZBX_TYPE_FLOAT, ZBX_NOTNULL, 0},
+					{"value_max", value_default, NULL, NULL, 0, field_type, ZBX_NOTNULL, 0},
+					{0}
+				},
+				NULL
+			};
+
+	if (SUCCEED == DBtable_exists(table_name))
+		return SUCCEED;
+
+	return DBcreate_table(&table);
+}
+
+static int	DBpatch_ext_trends_day(void)
+{
+	return DBpatch_add_trends_rollup_table("trends_day", ITEM_VALUE_TYPE_FLOAT);
+}
+
+static int	DBpatch_ext_trends_uint_day(void)
+{
+	return DBpatch_add_trends_rollup_table("trends_uint_day", ITEM_VALUE_TYPE_UINT64);
+}
+
+static int	DBpatch_ext_trends_month(void)
+{
+	return DBpatch_add_trends_rollup_table("trends_month", ITEM_VALUE_TYPE_FLOAT);
+}
+
+static int	DBpatch_ext_trends_uint_month(void)
+{
+	return DBpatch_add_trends_rollup_table("trends_uint_month", ITEM_VALUE_TYPE_UINT64);
+}
+
 #endif
 
 DBPATCH_START(6000)
@@ -754,3 +1003,16 @@ DBPATCH_ADD(6000053, 0, 0)
 DBPATCH_ADD(6000054, 0, 0)
 
 DBPATCH_END()
+
+DBPATCH_EXT_START(6000)
+
+DBPATCH_EXT_ADD(changelog)
+DBPATCH_EXT_ADD(changelog_items)
+DBPATCH_EXT_ADD(changelog_triggers)
+DBPATCH_EXT_ADD(changelog_functions)
+DBPATCH_EXT_ADD(trends_day)
+DBPATCH_EXT_ADD(trends_uint_day)
+DBPATCH_EXT_ADD(trends_month)
+DBPATCH_EXT_ADD(trends_uint_month)
+
+DBPATCH_EXT_END()
@@ -152,6 +152,10 @@ void	diag_add_mem_stats(struct zbx_json *json, const char *name, const zbx_mem_s
 	zbx_json_adduint64(json, "used", stats->used_size);
 	zbx_json_close(json);
 
+	/* percentage of free memory outside of the largest free chunk */
+	zbx_json_addfloat(json, "fragmentation", 0 == stats->free_size ? 0 :
+			(double)stats->fragmented_size * 100 / (double)stats->free_size);
+
 	zbx_json_addobject(json, "chunks");
 	zbx_json_adduint64(json, "free", stats->free_chunks);
 	zbx_json_adduint64(json, "used", stats->used_chunks);
@@ -176,6 +180,32 @@ void	diag_add_mem_stats(struct zbx_json *json, const char *name, const zbx_mem_s
 
 	zbx_json_close(json);
 	zbx_json_close(json);
+
+	if (0 != stats->slabs_size)
+	{
+		zbx_json_addobject(json, "slabs");
+		zbx_json_adduint64(json, "size", stats->slabs_size);
+		zbx_json_adduint64(json, "free", stats->slabs_free_size);
+
+		zbx_json_addarray(json, "classes");
+
+		for (i = 0; i < MEM_SLAB_CLASS_COUNT; i++)
+		{
+			if (0 == stats->slabs_num[i])
+				continue;
+
+			zbx_json_addobject(json, NULL);
+			zbx_json_adduint64(json, "size", MEM_MIN_ALLOC + 8 * i);
+			zbx_json_adduint64(json, "slabs", stats->slabs_num[i]);
+			zbx_json_adduint64(json, "objects", stats->slab_objects_num[i]);
+			zbx_json_adduint64(json, "used", stats->slab_objects_used[i]);
+			zbx_json_close(json);
+		}
+
+		zbx_json_close(json);
+		zbx_json_close(json);
+	}
+
 	zbx_json_close(json);
 }
 
@@ -219,6 +249,61 @@ static void	diag_historycache_add_items(struct zbx_json *json, const char *field
 	zbx_json_close(json);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: add history cache shard diagnostic statistics to json             *
+ *                                                                            *
+ ******************************************************************************/
+static void	diag_historycache_add_shards(struct zbx_json *json, const zbx_hc_shard_stats_t *shards,
+		int shards_num)
+{
+	int	i;
+
+	zbx_json_addarray(json, "shards");
+
+	for (i = 0; i < shards_num; i++)
+	{
+		zbx_json_addobject(json, NULL);
+		zbx_json_addint64(json, "items", shards[i].items_num);
+		zbx_json_addint64(json, "values", shards[i].values_num);
+		zbx_json_addint64(json, "queue", shards[i].queue_num);
+
+		zbx_json_addobject(json, "memory");
+		zbx_json_addobject(json, "data");
+		zbx_json_adduint64(json, "free", shards[i].data_free);
+		zbx_json_adduint64(json, "used", shards[i].data_total - shards[i].data_free);
+		zbx_json_close(json);
+		zbx_json_addobject(json, "index");
+		zbx_json_adduint64(json, "free", shards[i].index_free);
+		zbx_json_adduint64(json, "used", shards[i].index_total - shards[i].index_free);
+		zbx_json_close(json);
+		zbx_json_close(json);
+
+		zbx_json_close(json);
+	}
+
+	zbx_json_close(json);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: add history syncer stage timings to json                          *
+ *                                                                            *
+ ******************************************************************************/
+static void	diag_historycache_add_timings(struct zbx_json *json, const zbx_hc_sync_stats_t *stats)
+{
+	zbx_json_addobject(json, "timings");
+	zbx_json_adduint64(json, "batches", stats->batches_num);
+	zbx_json_addfloat(json, "prepare", stats->prepare);
+	zbx_json_addfloat(json, "history", stats->history);
+	zbx_json_addfloat(json, "trends", stats->trends);
+	zbx_json_addfloat(json, "items", stats->items);
+	zbx_json_addfloat(json, "wait", stats->wait);
+	zbx_json_addfloat(json, "triggers", stats->triggers);
+	zbx_json_addfloat(json, "export", stats->export);
+	zbx_json_close(json);
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: add requested history cache diagnostic information to json data   *
@@ -238,12 +323,15 @@ int	diag_add_historycache_info(const struct zbx_json_parse *jp, struct zbx_json
 	double			time1, time2, time_total = 0;
 	zbx_uint64_t		fields;
 	zbx_diag_map_t		field_map[] = {
-					{"", ZBX_DIAG_HISTORYCACHE_SIMPLE | ZBX_DIAG_HISTORYCACHE_MEMORY},
+					{"", ZBX_DIAG_HISTORYCACHE_SIMPLE | ZBX_DIAG_HISTORYCACHE_MEMORY |
+							ZBX_DIAG_HISTORYCACHE_TIMINGS},
 					{"items", ZBX_DIAG_HISTORYCACHE_ITEMS},
 					{"values", ZBX_DIAG_HISTORYCACHE_VALUES},
 					{"memory", ZBX_DIAG_HISTORYCACHE_MEMORY},
 					{"memory.data", ZBX_DIAG_HISTORYCACHE_MEMORY_DATA},
 					{"memory.index", ZBX_DIAG_HISTORYCACHE_MEMORY_INDEX},
+					{"shards", ZBX_DIAG_HISTORYCACHE_SHARDS},
+					{"timings", ZBX_DIAG_HISTORYCACHE_TIMINGS},
 					{NULL, 0}
 					};
 
@@ -257,10 +345,12 @@ int	diag_add_historycache_info(const struct zbx_json_parse *jp, struct zbx_json
 
 		if (0 != (fields & ZBX_DIAG_HISTORYCACHE_SIMPLE))
 		{
-			zbx_uint64_t	values_num, items_num;
+			zbx_uint64_t		values_num, items_num;
+			zbx_hc_shard_stats_t	shards[ZBX_HC_SHARDS_MAX];
+			int			shards_num;
 
 			time1 = zbx_time();
-			zbx_hc_get_diag_stats(&items_num, &values_num);
+			zbx_hc_get_diag_stats(&items_num, &values_num, shards, &shards_num);
 			time2 = zbx_time();
 			time_total += time2 - time1;
 
@@ -268,6 +358,8 @@ int	diag_add_historycache_info(const struct zbx_json_parse *jp, struct zbx_json
 				zbx_json_addint64(json, "items", items_num);
 			if (0 != (fields & ZBX_DIAG_HISTORYCACHE_VALUES))
 				zbx_json_addint64(json, "values", values_num);
+			if (0 != (fields & ZBX_DIAG_HISTORYCACHE_SHARDS) && 1 < shards_num)
+				diag_historycache_add_shards(json, shards, shards_num);
 		}
 
 		if (0 != (fields & ZBX_DIAG_HISTORYCACHE_MEMORY))
@@ -288,6 +380,18 @@ int	diag_add_historycache_info(const struct zbx_json_parse *jp, struct zbx_json
 			zbx_json_close(json);
 		}
 
+		if (0 != (fields & ZBX_DIAG_HISTORYCACHE_TIMINGS))
+		{
+			zbx_hc_sync_stats_t	sync_stats;
+
+			time1 = zbx_time();
+			zbx_hc_get_sync_stats(&sync_stats);
+			time2 = zbx_time();
+			time_total += time2 - time1;
+
+			diag_historycache_add_timings(json, &sync_stats);
+		}
+
 		if (0 != tops.values_num)
 		{
 			zbx_json_addobject(json, "top");
@@ -498,13 +602,13 @@ void	diag_add_locks_info(struct zbx_json *json)
 {
 	int		i;
 #ifdef HAVE_VMINFO_T_UPDATES
-	const char	*names[ZBX_MUTEX_COUNT] = {"ZBX_MUTEX_LOG", "ZBX_MUTEX_CACHE", "ZBX_MUTEX_TRENDS",
+	const char	*names[ZBX_MUTEX_CACHE_SHARD] = {"ZBX_MUTEX_LOG", "ZBX_MUTEX_CACHE", "ZBX_MUTEX_TRENDS",
 				"ZBX_MUTEX_CACHE_IDS", "ZBX_MUTEX_SELFMON", "ZBX_MUTEX_CPUSTATS", "ZBX_MUTEX_DISKSTATS",
 				"ZBX_MUTEX_VALUECACHE", "ZBX_MUTEX_VMWARE", "ZBX_MUTEX_SQLITE3",
 				"ZBX_MUTEX_PROCSTAT", "ZBX_MUTEX_PROXY_HISTORY", "ZBX_MUTEX_KSTAT", "ZBX_MUTEX_MODBUS",
 				"ZBX_MUTEX_TREND_FUNC"};
 #else
-	const char	*names[ZBX_MUTEX_COUNT] = {"ZBX_MUTEX_LOG", "ZBX_MUTEX_CACHE", "ZBX_MUTEX_TRENDS",
+	const char	*names[ZBX_MUTEX_CACHE_SHARD] = {"ZBX_MUTEX_LOG", "ZBX_MUTEX_CACHE", "ZBX_MUTEX_TRENDS",
 				"ZBX_MUTEX_CACHE_IDS", "ZBX_MUTEX_SELFMON", "ZBX_MUTEX_CPUSTATS", "ZBX_MUTEX_DISKSTATS",
 				"ZBX_MUTEX_VALUECACHE", "ZBX_MUTEX_VMWARE", "ZBX_MUTEX_SQLITE3",
 				"ZBX_MUTEX_PROCSTAT", "ZBX_MUTEX_PROXY_HISTORY", "ZBX_MUTEX_MODBUS",
@@ -512,13 +616,35 @@ void	diag_add_locks_info(struct zbx_json *json)
 #endif
 	zbx_json_addarray(json, ZBX_DIAG_LOCKS);
 
-	for (i = 0; i < ZBX_MUTEX_COUNT; i++)
+	for (i = 0; i < ZBX_MUTEX_CACHE_SHARD; i++)
 	{
 		zbx_json_addobject(json, NULL);
 		zbx_json_addhex(json, names[i], (zbx_uint64_t)zbx_mutex_addr_get(i));
 		zbx_json_close(json);
 	}
 
+	for (i = ZBX_MUTEX_CACHE_SHARD; i <= ZBX_MUTEX_CACHE_SHARD_LAST; i++)
+	{
+		char	name[MAX_STRING_LEN];
+
+		zbx_snprintf(name, sizeof(name), "ZBX_MUTEX_CACHE_SHARD_%d", i - ZBX_MUTEX_CACHE_SHARD + 1);
+
+		zbx_json_addobject(json, NULL);
+		zbx_json_addhex(json, name, (zbx_uint64_t)zbx_mutex_addr_get(i));
+		zbx_json_close(json);
+	}
+
+	for (i = ZBX_MUTEX_VALUECACHE_ITEM; i <= ZBX_MUTEX_VALUECACHE_ITEM_LAST; i++)
+	{
+		char	name[MAX_STRING_LEN];
+
+		zbx_snprintf(name, sizeof(name), "ZBX_MUTEX_VALUECACHE_ITEM_%d", i - ZBX_MUTEX_VALUECACHE_ITEM + 1);
+
+		zbx_json_addobject(json, NULL);
+		zbx_json_addhex(json, name, (zbx_uint64_t)zbx_mutex_addr_get(i));
+		zbx_json_close(json);
+	}
+
 	zbx_json_addobject(json, NULL);
 	zbx_json_addhex(json, "ZBX_RWLOCK_CONFIG", (zbx_uint64_t)zbx_rwlock_addr_get(ZBX_RWLOCK_CONFIG));
 	zbx_json_close(json);
@@ -680,8 +806,9 @@ static void	diag_get_simple_values(const struct zbx_json_parse *jp, char **msg)
 static void	diag_log_memory_info(struct zbx_json_parse *jp, const char *field, const char *path, char **out,
 		size_t *out_alloc, size_t *out_offset)
 {
-	struct zbx_json_parse	jp_memory, jp_size, jp_chunks;
+	struct zbx_json_parse	jp_memory, jp_size, jp_chunks, jp_slabs;
 	char			*msg = NULL;
+	size_t			msg_alloc = 0;
 
 	if (FAIL == zbx_json_open_path(jp, path, &jp_memory))
 		return;
@@ -694,6 +821,13 @@ static void	diag_log_memory_info(struct zbx_json_parse *jp, const char *field, c
 		zbx_free(msg);
 	}
 
+	if (SUCCEED == zbx_json_value_by_name_dyn(&jp_memory, "fragmentation", &msg, &msg_alloc, NULL))
+	{
+		zbx_strlog_alloc(LOG_LEVEL_INFORMATION, out, out_alloc, out_offset, "  fragmentation: %s%%", msg);
+		zbx_free(msg);
+		msg_alloc = 0;
+	}
+
 	if (SUCCEED == zbx_json_brackets_by_name(&jp_memory, "chunks", &jp_chunks))
 	{
 		struct zbx_json_parse	jp_buckets, jp_bucket;
@@ -720,6 +854,33 @@ static void	diag_log_memory_info(struct zbx_json_parse *jp, const char *field, c
 			}
 		}
 	}
+
+	if (SUCCEED == zbx_json_brackets_by_name(&jp_memory, "slabs", &jp_slabs))
+	{
+		struct zbx_json_parse	jp_classes, jp_class;
+
+		diag_get_simple_values(&jp_slabs, &msg);
+		zbx_strlog_alloc(LOG_LEVEL_INFORMATION, out, out_alloc, out_offset, "  slabs: %s", msg);
+		zbx_free(msg);
+
+		if (SUCCEED == zbx_json_brackets_by_name(&jp_slabs, "classes", &jp_classes))
+		{
+			const char	*pnext;
+
+			zbx_strlog_alloc(LOG_LEVEL_INFORMATION, out, out_alloc, out_offset, "    classes:");
+
+			for (pnext = NULL; NULL != (pnext = zbx_json_next(&jp_classes, pnext));)
+			{
+				if (SUCCEED == zbx_json_brackets_open(pnext, &jp_class))
+				{
+					diag_get_simple_values(&jp_class, &msg);
+					zbx_strlog_alloc(LOG_LEVEL_INFORMATION, out, out_alloc, out_offset, "      %s",
+							msg);
+					zbx_free(msg);
+				}
+			}
+		}
+	}
 }
 
 /******************************************************************************
@@ -768,7 +929,8 @@ static void	diag_log_top_view(struct zbx_json_parse *jp, const char *field, cons
  ******************************************************************************/
 static void	diag_log_history_cache(struct zbx_json_parse *jp, char **out, size_t *out_alloc, size_t *out_offset)
 {
-	char	*msg = NULL;
+	char			*msg = NULL;
+	struct zbx_json_parse	jp_timings;
 
 	zbx_strlog_alloc(LOG_LEVEL_INFORMATION, out, out_alloc, out_offset, "== history cache diagnostic information ==");
 
@@ -779,6 +941,13 @@ static void	diag_log_history_cache(struct zbx_json_parse *jp, char **out, size_t
 	diag_log_memory_info(jp, "memory.data", "$.memory.data", out, out_alloc, out_offset);
 	diag_log_memory_info(jp, "memory.index", "$.memory.index", out, out_alloc, out_offset);
 
+	if (SUCCEED == zbx_json_open_path(jp, "$.timings", &jp_timings))
+	{
+		diag_get_simple_values(&jp_timings, &msg);
+		zbx_strlog_alloc(LOG_LEVEL_INFORMATION, out, out_alloc, out_offset, "timings: %s", msg);
+		zbx_free(msg);
+	}
+
 	diag_log_top_view(jp, "top.values", "$.top.values", out, out_alloc, out_offset);
 
 	zbx_strlog_alloc(LOG_LEVEL_INFORMATION, out, out_alloc, out_offset, "==");
@@ -31,9 +31,12 @@
 #define ZBX_DIAG_HISTORYCACHE_VALUES		0x00000002
 #define ZBX_DIAG_HISTORYCACHE_MEMORY_DATA	0x00000004
 #define ZBX_DIAG_HISTORYCACHE_MEMORY_INDEX	0x00000008
+#define ZBX_DIAG_HISTORYCACHE_SHARDS		0x00000010
+#define ZBX_DIAG_HISTORYCACHE_TIMINGS		0x00000020
 
 #define ZBX_DIAG_HISTORYCACHE_SIMPLE	(ZBX_DIAG_HISTORYCACHE_ITEMS | \
-					ZBX_DIAG_HISTORYCACHE_VALUES)
+					ZBX_DIAG_HISTORYCACHE_VALUES | \
+					ZBX_DIAG_HISTORYCACHE_SHARDS)
 
 #define ZBX_DIAG_HISTORYCACHE_MEMORY	(ZBX_DIAG_HISTORYCACHE_MEMORY_DATA | \
 					ZBX_DIAG_HISTORYCACHE_MEMORY_INDEX)
@@ -127,6 +127,23 @@ int	zbx_history_add_values(const zbx_vector_ptr_t *history, int *ret_flush)
 	return (FLUSH_SUCCEED == *ret_flush ? SUCCEED : FAIL);
 }
 
+/************************************************************************************
+ *                                                                                  *
+ * Purpose: waits until history values sent by zbx_history_add_values() are         *
+ *          written to the storage                                                  *
+ *                                                                                  *
+ * Return value: SUCCEED - the values were written                                  *
+ *               FAIL    - the values were rejected by the storage                  *
+ *                                                                                  *
+ * Comments: Only SQL storage can write values asynchronously, see                  *
+ *           HistorySyncPipeline configuration parameter.                           *
+ *                                                                                  *
+ ************************************************************************************/
+int	zbx_history_wait(void)
+{
+	return zbx_history_sql_wait();
+}
+
 /************************************************************************************
  *                                                                                  *
  * Purpose: gets item values from history storage                                   *
@@ -54,6 +54,7 @@ struct zbx_history_iface
 
 /* SQL hist */
 int	zbx_history_sql_init(zbx_history_iface_t *hist, unsigned char value_type, char **error);
+int	zbx_history_sql_wait(void);
 
 /* elastic hist */
 int	zbx_history_elastic_init(zbx_history_iface_t *hist, unsigned char value_type, char **error);
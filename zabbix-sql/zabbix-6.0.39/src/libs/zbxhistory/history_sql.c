@@ -18,6 +18,7 @@
 **/
 
 #include "common.h"
+#include "log.h"
 #include "zbxalgo.h"
 #include "db.h"
 #include "dbcache.h"
@@ -34,6 +35,28 @@ zbx_sql_writer_t;
 
 static zbx_sql_writer_t	writer;
 
+#if defined(HAVE_POSTGRESQL)
+extern int	CONFIG_HISTORY_SYNC_PIPELINE;
+
+/* history values sent over the pipelined write connection and not confirmed yet */
+typedef struct
+{
+	unsigned char	connected;
+	unsigned char	pending;
+	int		rows_num;
+	char		*sql;
+	size_t		sql_alloc;
+	size_t		sql_offset;
+
+	/* the statement end offsets in sql buffer, there is one insert statement per value type */
+	size_t		stmt_ends[ITEM_VALUE_TYPE_MAX];
+	int		stmt_num;
+}
+zbx_sql_pipeline_t;
+
+static zbx_sql_pipeline_t	pipeline;
+#endif
+
 typedef void (*vc_str2value_func_t)(history_value_t *value, DB_ROW row);
 
 /* history table data */
@@ -145,6 +168,203 @@ static void	sql_writer_add_dbinsert(zbx_db_insert_t *db_insert)
 	zbx_vector_ptr_append(&writer.dbinserts, db_insert);
 }
 
+#if defined(HAVE_POSTGRESQL)
+/************************************************************************************
+ *                                                                                  *
+ * Purpose: sends the pending statements over the pipelined write connection,       *
+ *          reconnecting if necessary                                               *
+ *                                                                                  *
+ * Return value: ZBX_DB_OK   - the statements were sent                             *
+ *               ZBX_DB_FAIL - failed to connect or to send the statements          *
+ *                                                                                  *
+ * Comments: Retries until database is available again, like the synchronous        *
+ *           writes do. The main connection is not used, as the history syncer      *
+ *           waits for the result with its own transaction open.                    *
+ *                                                                                  *
+ ************************************************************************************/
+static int	sql_pipeline_resend(void)
+{
+	int	rc;
+
+	while (ZBX_DB_DOWN == (rc = zbx_db_async_send(pipeline.sql)))
+	{
+		DBclose_async();
+		pipeline.connected = 0;
+
+		while (ZBX_DB_DOWN == (rc = DBconnect_async()))
+		{
+			zabbix_log(LOG_LEVEL_ERR, "database is down: reconnecting pipelined history write connection"
+					" in %d seconds", ZBX_DB_WAIT_DOWN);
+			sleep(ZBX_DB_WAIT_DOWN);
+		}
+
+		if (ZBX_DB_OK != rc)
+			return ZBX_DB_FAIL;
+
+		pipeline.connected = 1;
+	}
+
+	return rc;
+}
+
+/************************************************************************************
+ *                                                                                  *
+ * Purpose: gets the result of the pending statements, resending them if the        *
+ *          pipelined write connection was lost                                     *
+ *                                                                                  *
+ * Parameters: rows - [OUT] the number of inserted rows                             *
+ *                                                                                  *
+ * Return value: ZBX_DB_OK   - the statements were executed successfully            *
+ *               ZBX_DB_FAIL - the statements failed                                *
+ *                                                                                  *
+ ************************************************************************************/
+static int	sql_pipeline_result(int *rows)
+{
+	int	rc;
+
+	while (ZBX_DB_DOWN == (rc = zbx_db_async_wait(pipeline.sql, rows)))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "pipelined history write failed, resending %d history values",
+				pipeline.rows_num);
+
+		if (ZBX_DB_OK != (rc = sql_pipeline_resend()))
+			break;
+	}
+
+	return rc;
+}
+
+/************************************************************************************
+ *                                                                                  *
+ * Purpose: adds conflict clauses to the pending statements, so the values already  *
+ *          stored in database are skipped                                          *
+ *                                                                                  *
+ ************************************************************************************/
+static void	sql_pipeline_skip_duplicates(void)
+{
+	char	*sql = NULL;
+	size_t	sql_alloc = 0, sql_offset = 0, stmt_start = 0;
+	int	i;
+
+	for (i = 0; i < pipeline.stmt_num; i++)
+	{
+		zbx_strncpy_alloc(&sql, &sql_alloc, &sql_offset, pipeline.sql + stmt_start,
+				pipeline.stmt_ends[i] - stmt_start);
+		zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, " on conflict do nothing;\n");
+		stmt_start = pipeline.stmt_ends[i] + ZBX_CONST_STRLEN(";\n");
+	}
+
+	zbx_free(pipeline.sql);
+	pipeline.sql = sql;
+	pipeline.sql_alloc = sql_alloc;
+	pipeline.sql_offset = sql_offset;
+}
+
+/************************************************************************************
+ *                                                                                  *
+ * Purpose: waits for the previously sent history values to be written              *
+ *                                                                                  *
+ * Return value: SUCCEED - the values were written or nothing was pending           *
+ *               FAIL    - the values were rejected by database                     *
+ *                                                                                  *
+ * Comments: If some of the values are already stored in database the whole batch   *
+ *           is rejected. Then like with synchronous writes the duplicates are      *
+ *           skipped, the rest of values are written again and the number of        *
+ *           skipped values is logged.                                              *
+ *                                                                                  *
+ ************************************************************************************/
+static int	sql_pipeline_wait(void)
+{
+	int	rc, rows, ret = SUCCEED;
+
+	if (0 == pipeline.pending)
+		return SUCCEED;
+
+	rc = sql_pipeline_result(&rows);
+
+	if (ZBX_DB_FAIL == rc && ERR_Z3008 == zbx_db_last_errcode())
+	{
+		sql_pipeline_skip_duplicates();
+
+		if (ZBX_DB_OK == (rc = sql_pipeline_resend()) && ZBX_DB_OK == (rc = sql_pipeline_result(&rows)))
+			zabbix_log(LOG_LEVEL_WARNING, "skipped %d duplicates", pipeline.rows_num - rows);
+	}
+
+	if (ZBX_DB_OK != rc)
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot write %d history values", pipeline.rows_num);
+		ret = FAIL;
+	}
+
+	pipeline.pending = 0;
+	pipeline.rows_num = 0;
+	pipeline.sql_offset = 0;
+	pipeline.stmt_num = 0;
+
+	return ret;
+}
+
+/************************************************************************************
+ *                                                                                  *
+ * Purpose: sends bulk insert data over the pipelined write connection without      *
+ *          waiting for the result                                                  *
+ *                                                                                  *
+ * Return value: SUCCEED - the data was sent                                        *
+ *               FAIL    - pipelined write connection is not available, the data    *
+ *                         must be flushed synchronously                            *
+ *                                                                                  *
+ * Comments: The result must be collected with sql_pipeline_wait() before anything  *
+ *           derived from the values is committed. The history syncer prepares its  *
+ *           item updates while the history is being written.                       *
+ *                                                                                  *
+ ************************************************************************************/
+static int	sql_pipeline_send(void)
+{
+	int	i;
+
+	sql_pipeline_wait();
+
+	if (0 == pipeline.connected)
+	{
+		if (ZBX_DB_OK != DBconnect_async())
+			return FAIL;
+
+		pipeline.connected = 1;
+	}
+
+	for (i = 0; i < writer.dbinserts.values_num; i++)
+	{
+		zbx_db_insert_t	*db_insert = (zbx_db_insert_t *)writer.dbinserts.values[i];
+
+		if (0 == db_insert->rows.values_num)
+			continue;
+
+		zbx_db_insert_format(db_insert, &pipeline.sql, &pipeline.sql_alloc, &pipeline.sql_offset);
+		pipeline.stmt_ends[pipeline.stmt_num++] = pipeline.sql_offset;
+		zbx_strcpy_alloc(&pipeline.sql, &pipeline.sql_alloc, &pipeline.sql_offset, ";\n");
+		pipeline.rows_num += db_insert->rows.values_num;
+	}
+
+	if (0 == pipeline.sql_offset)
+		return SUCCEED;
+
+	if (ZBX_DB_OK != zbx_db_async_send(pipeline.sql))
+	{
+		DBclose_async();
+		pipeline.connected = 0;
+		pipeline.rows_num = 0;
+		pipeline.sql_offset = 0;
+		pipeline.stmt_num = 0;
+
+		return FAIL;
+	}
+
+	pipeline.pending = 1;
+
+	return SUCCEED;
+}
+#endif
+
 /************************************************************************************
  *                                                                                  *
  * Purpose: flushes bulk insert data into database                                  *
@@ -159,6 +379,14 @@ static int	sql_writer_flush(void)
 	if (0 == writer.initialized)
 		return SUCCEED;
 
+#if defined(HAVE_POSTGRESQL)
+	if (0 != CONFIG_HISTORY_SYNC_PIPELINE && SUCCEED == sql_pipeline_send())
+	{
+		sql_writer_release();
+		return FLUSH_SUCCEED;
+	}
+#endif
+
 	do
 	{
 		DBbegin();
@@ -199,6 +427,7 @@ static void	add_history_dbl(const zbx_vector_ptr_t *history)
 
 	db_insert = (zbx_db_insert_t *)zbx_malloc(NULL, sizeof(zbx_db_insert_t));
 	zbx_db_insert_prepare(db_insert, "history", "itemid", "clock", "ns", "value", (char *)NULL);
+	zbx_db_insert_use_copy(db_insert);
 
 	for (i = 0; i < history->values_num; i++)
 	{
@@ -220,6 +449,7 @@ static void	add_history_uint(const zbx_vector_ptr_t *history)
 
 	db_insert = (zbx_db_insert_t *)zbx_malloc(NULL, sizeof(zbx_db_insert_t));
 	zbx_db_insert_prepare(db_insert, "history_uint", "itemid", "clock", "ns", "value", (char *)NULL);
+	zbx_db_insert_use_copy(db_insert);
 
 	for (i = 0; i < history->values_num; i++)
 	{
@@ -241,6 +471,7 @@ static void	add_history_str(const zbx_vector_ptr_t *history)
 
 	db_insert = (zbx_db_insert_t *)zbx_malloc(NULL, sizeof(zbx_db_insert_t));
 	zbx_db_insert_prepare(db_insert, "history_str", "itemid", "clock", "ns", "value", (char *)NULL);
+	zbx_db_insert_use_copy(db_insert);
 
 	for (i = 0; i < history->values_num; i++)
 	{
@@ -262,6 +493,7 @@ static void	add_history_text(const zbx_vector_ptr_t *history)
 
 	db_insert = (zbx_db_insert_t *)zbx_malloc(NULL, sizeof(zbx_db_insert_t));
 	zbx_db_insert_prepare(db_insert, "history_text", "itemid", "clock", "ns", "value", (char *)NULL);
+	zbx_db_insert_use_copy(db_insert);
 
 	for (i = 0; i < history->values_num; i++)
 	{
@@ -284,6 +516,7 @@ static void	add_history_log(const zbx_vector_ptr_t *history)
 	db_insert = (zbx_db_insert_t *)zbx_malloc(NULL, sizeof(zbx_db_insert_t));
 	zbx_db_insert_prepare(db_insert, "history_log", "itemid", "clock", "ns", "timestamp", "source", "severity",
 			"value", "logeventid", (char *)NULL);
+	zbx_db_insert_use_copy(db_insert);
 
 	for (i = 0; i < history->values_num; i++)
 	{
@@ -308,6 +541,51 @@ static void	add_history_log(const zbx_vector_ptr_t *history)
  *                                                                                                                *
  ******************************************************************************************************************/
 
+#if defined(HAVE_POSTGRESQL)
+/*********************************************************************************
+ *                                                                               *
+ * Purpose: selects item values from database using prepared statement           *
+ *                                                                               *
+ * Parameters:  table      - [IN] the history table                              *
+ *              itemid     - [IN] the itemid                                     *
+ *              clock_from - [IN] the period start (exclusive)                   *
+ *              clock_to   - [IN] the period end (inclusive)                     *
+ *              count      - [IN] the number of latest values to select,         *
+ *                                0 - select all values                          *
+ *                                                                               *
+ * Return value: query result, NULL on error                                     *
+ *                                                                               *
+ *********************************************************************************/
+static DB_RESULT	db_select_values_prepared(const zbx_vc_history_table_t *table, zbx_uint64_t itemid,
+		int clock_from, int clock_to, int count)
+{
+	char		sql[MAX_STRING_LEN], itemid_str[MAX_ID_LEN + 1], clock_from_str[MAX_ID_LEN + 1],
+			clock_to_str[MAX_ID_LEN + 1], count_str[MAX_ID_LEN + 1];
+	const char	*params[4];
+
+	zbx_snprintf(sql, sizeof(sql),
+			"select clock,ns,%s"
+			" from %s"
+			" where itemid=$1"
+				" and clock>$2"
+				" and clock<=$3"
+			"%s",
+			table->fields, table->name, 0 == count ? "" : " order by clock desc limit $4");
+
+	zbx_snprintf(itemid_str, sizeof(itemid_str), ZBX_FS_UI64, itemid);
+	zbx_snprintf(clock_from_str, sizeof(clock_from_str), "%d", clock_from);
+	zbx_snprintf(clock_to_str, sizeof(clock_to_str), "%d", clock_to);
+	zbx_snprintf(count_str, sizeof(count_str), "%d", count);
+
+	params[0] = itemid_str;
+	params[1] = clock_from_str;
+	params[2] = clock_to_str;
+	params[3] = count_str;
+
+	return DBselect_prepared(sql, 0 == count ? 3 : 4, params);
+}
+#endif
+
 /*********************************************************************************
  *                                                                               *
  * Purpose: reads item history data from database                                *
@@ -328,12 +606,24 @@ static void	add_history_log(const zbx_vector_ptr_t *history)
 static int	db_read_values_by_time(zbx_uint64_t itemid, int value_type, zbx_vector_history_record_t *values,
 		int seconds, int end_timestamp)
 {
-	char			*sql = NULL;
-	size_t			sql_alloc = 0, sql_offset = 0;
 	DB_RESULT		result;
 	DB_ROW			row;
 	zbx_vc_history_table_t	*table = &vc_history_tables[value_type];
 	int			time_from;
+#if defined(HAVE_POSTGRESQL)
+	time_from = end_timestamp - seconds;
+
+	zbx_recalc_time_period(&time_from, ZBX_RECALC_TIME_PERIOD_HISTORY);
+
+	/* reading values of a single second is limited to the history storage period */
+	if (ZBX_JAN_2038 != end_timestamp && 1 == seconds && time_from != end_timestamp - seconds)
+		goto out;
+
+	/* clock<=ZBX_JAN_2038 is always true, so the same statement is used to read values up to now */
+	result = db_select_values_prepared(table, itemid, time_from, end_timestamp, 0);
+#else
+	char			*sql = NULL;
+	size_t			sql_alloc = 0, sql_offset = 0;
 
 	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
 			"select clock,ns,%s"
@@ -368,7 +658,7 @@ static int	db_read_values_by_time(zbx_uint64_t itemid, int value_type, zbx_vecto
 	result = DBselect("%s", sql);
 
 	zbx_free(sql);
-
+#endif
 	if (NULL == result)
 		goto out;
 
@@ -413,8 +703,10 @@ out:
 static int	db_read_values_by_count(zbx_uint64_t itemid, int value_type, zbx_vector_history_record_t *values,
 		int count, int end_timestamp)
 {
+#if !defined(HAVE_POSTGRESQL)
 	char			*sql = NULL;
 	size_t			sql_alloc = 0, sql_offset;
+#endif
 	int			clock_to, clock_from, step = 0, ret = FAIL;
 	DB_RESULT		result;
 	DB_ROW			row;
@@ -433,6 +725,14 @@ static int	db_read_values_by_count(zbx_uint64_t itemid, int value_type, zbx_vect
 			step = ARRSIZE(periods) - 1;
 		}
 
+#if defined(HAVE_POSTGRESQL)
+		if (clock_from != clock_to)
+			zbx_recalc_time_period(&clock_from, ZBX_RECALC_TIME_PERIOD_HISTORY);
+		else
+			clock_from = INT_MIN;	/* read all values up to clock_to */
+
+		result = db_select_values_prepared(table, itemid, clock_from, clock_to, count);
+#else
 		sql_offset = 0;
 		zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
 				"select clock,ns,%s"
@@ -450,6 +750,7 @@ static int	db_read_values_by_count(zbx_uint64_t itemid, int value_type, zbx_vect
 		zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, " order by clock desc");
 
 		result = DBselectN(sql, count);
+#endif
 
 		if (NULL == result)
 			goto out;
@@ -491,8 +792,9 @@ static int	db_read_values_by_count(zbx_uint64_t itemid, int value_type, zbx_vect
 
 	ret = db_read_values_by_time(itemid, value_type, values, 1, end_timestamp);
 out:
+#if !defined(HAVE_POSTGRESQL)
 	zbx_free(sql);
-
+#endif
 	return ret;
 }
 
@@ -677,6 +979,23 @@ static int	sql_flush(zbx_history_iface_t *hist)
 	return sql_writer_flush();
 }
 
+/************************************************************************************
+ *                                                                                  *
+ * Purpose: waits until pipelined history writes are completed                      *
+ *                                                                                  *
+ * Return value: SUCCEED - the values were written or nothing was pending           *
+ *               FAIL    - the values were rejected by database                     *
+ *                                                                                  *
+ ************************************************************************************/
+int	zbx_history_sql_wait(void)
+{
+#if defined(HAVE_POSTGRESQL)
+	return sql_pipeline_wait();
+#else
+	return SUCCEED;
+#endif
+}
+
 /************************************************************************************
  *                                                                                  *
  * Purpose: initializes history storage interface                                   *
@@ -18,6 +18,7 @@
 **/
 
 #include "zbxicmpping.h"
+#include "icmpping_native.h"
 
 #include "threads.h"
 #include "comms.h"
@@ -31,6 +32,7 @@ extern char	*CONFIG_FPING_LOCATION;
 extern char	*CONFIG_FPING6_LOCATION;
 #endif
 extern char	*CONFIG_TMPDIR;
+extern int	CONFIG_NATIVE_PINGER;
 
 /* old official fping (2.4b2_to_ipv6) did not support source IP address */
 /* old patched versions (2.4b2_to_ipv6) provided either -I or -S options */
@@ -826,7 +828,9 @@ out:
  * Return value: SUCCEED - successfully processed hosts                       *
  *               NOTSUPPORTED - otherwise                                     *
  *                                                                            *
- * Comments: use external binary 'fping' to avoid superuser privileges        *
+ * Comments: Hosts are pinged by the process itself when NativePinger is      *
+ *           enabled and system allows to open ICMP sockets, otherwise        *
+ *           external binary 'fping' is used to avoid superuser privileges.   *
  *                                                                            *
  ******************************************************************************/
 int	zbx_ping(ZBX_FPING_HOST *hosts, int hosts_count, int count, int period, int size, int timeout,
@@ -836,9 +840,15 @@ int	zbx_ping(ZBX_FPING_HOST *hosts, int hosts_count, int count, int period, int
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() hosts_count:%d", __func__, hosts_count);
 
+	if (0 != CONFIG_NATIVE_PINGER && SUCCEED == (ret = zbx_ping_native(hosts, hosts_count, count, period, size,
+			timeout, error, max_error_len)))
+	{
+		goto out;
+	}
+
 	if (NOTSUPPORTED == (ret = process_ping(hosts, hosts_count, count, period, size, timeout, error, max_error_len)))
 		zabbix_log(LOG_LEVEL_ERR, "%s", error);
-
+out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
 
 	return ret;
@@ -0,0 +1,675 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2025 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "icmpping_native.h"
+
+#include "log.h"
+
+extern char	*CONFIG_SOURCE_IP;
+
+/*
+ * Native ICMP pinger
+ * ==================
+ *
+ * Echo requests to all hosts are sent from the pinger process itself, using unprivileged ICMP datagram
+ * sockets where the system allows them and raw sockets otherwise. One socket per address family is kept
+ * open for the process lifetime. Every request carries a per-call cookie, the host index and the packet
+ * index in its data, so replies are matched to requests without any lookups, and replies coming from other
+ * addresses than the pinged one are ignored like in fping.
+ *
+ * Packets are sent in rounds - the n-th packet to all hosts at start + n * period - and round trip time is
+ * measured from kernel receive timestamps where available. The parameter defaults follow fping.
+ */
+
+#define ZBX_ICMP_ECHO_REPLY		0
+#define ZBX_ICMP_ECHO_REQUEST		8
+#define ZBX_ICMP6_ECHO_REQUEST		128
+#define ZBX_ICMP6_ECHO_REPLY		129
+
+#define ZBX_ICMP_HEADER_LEN		8
+#define ZBX_ICMP_IP_HEADER_LEN_MIN	20
+
+#define ZBX_ICMP_DEFAULT_SIZE		56	/* bytes, fping option -b default */
+#define ZBX_ICMP_DEFAULT_PERIOD		1000	/* milliseconds, fping option -p default */
+#define ZBX_ICMP_DEFAULT_TIMEOUT_MAX	2000	/* milliseconds, fping limit of default timeout in count mode */
+
+#define ZBX_ICMP_RECV_BUFFER_SIZE	ZBX_MEBIBYTE
+#define ZBX_ICMP_SEND_RETRIES		10	/* retries of sending when socket buffer is full */
+#define ZBX_ICMP_RECV_INTERVAL		256	/* receive queued replies after every so many sent packets */
+#define ZBX_ICMP_RETRY_PERIOD		SEC_PER_HOUR
+
+typedef struct
+{
+	zbx_uint32_t	cookie;
+	zbx_uint32_t	host;
+	zbx_uint32_t	packet;
+}
+zbx_icmp_payload_t;
+
+typedef struct
+{
+	int		fd;
+	int		family;
+	unsigned char	raw;
+}
+zbx_icmp_socket_t;
+
+typedef struct
+{
+	struct sockaddr_storage	addr;
+	socklen_t		addr_len;
+
+	/* NULL if the host name could not be resolved */
+	zbx_icmp_socket_t	*sock;
+
+	/* the send time of every packet, 0 if the packet was not sent or the reply was received */
+	double			*sent;
+}
+zbx_icmp_target_t;
+
+typedef struct
+{
+	ZBX_FPING_HOST		*hosts;
+	zbx_icmp_target_t	*targets;
+	int			hosts_count;
+
+	/* the number of packets sent to each host */
+	int			count;
+
+	/* the reply timeout in seconds */
+	double			timeout;
+
+	/* the cookie identifying requests of this ping */
+	zbx_uint32_t		cookie;
+
+	/* the number of sent requests without reply */
+	int			outstanding;
+}
+zbx_icmp_ping_t;
+
+static zbx_icmp_socket_t	icmp_sockets[] = {
+	{-1, AF_INET, 0},
+#ifdef HAVE_IPV6
+	{-1, AF_INET6, 0},
+#endif
+};
+
+/* the time when ICMP sockets could not be opened, fping is used until the retry period expires */
+static time_t	icmp_failed_at;
+
+static unsigned short	icmp_checksum(const unsigned char *data, size_t len)
+{
+	zbx_uint32_t	sum = 0;
+
+	for (; 1 < len; data += 2, len -= 2)
+		sum += (zbx_uint32_t)data[0] << 8 | data[1];
+
+	if (1 == len)
+		sum += (zbx_uint32_t)data[0] << 8;
+
+	while (0 != (sum >> 16))
+		sum = (sum & 0xffff) + (sum >> 16);
+
+	return (unsigned short)~sum;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: open ICMP socket of the specified address family                  *
+ *                                                                            *
+ * Comments: Unprivileged ICMP datagram sockets are preferred, raw sockets    *
+ *           require superuser privileges or CAP_NET_RAW capability.          *
+ *                                                                            *
+ ******************************************************************************/
+static int	icmp_socket_open(zbx_icmp_socket_t *sock, char *error, size_t max_error_len)
+{
+	int		protocol = IPPROTO_ICMP, rcvbuf = ZBX_ICMP_RECV_BUFFER_SIZE, flags;
+	const char	*family = "IPv4";
+#ifdef SO_TIMESTAMP
+	int		on = 1;
+#endif
+
+#ifdef HAVE_IPV6
+	if (AF_INET6 == sock->family)
+	{
+		protocol = IPPROTO_ICMPV6;
+		family = "IPv6";
+	}
+#endif
+	if (-1 != (sock->fd = socket(sock->family, SOCK_DGRAM, protocol)))
+	{
+		sock->raw = 0;
+	}
+	else if (-1 != (sock->fd = socket(sock->family, SOCK_RAW, protocol)))
+	{
+		sock->raw = 1;
+	}
+	else
+	{
+		zbx_snprintf(error, max_error_len, "cannot create %s ICMP socket: %s", family, zbx_strerror(errno));
+		return FAIL;
+	}
+
+	if (NULL != CONFIG_SOURCE_IP)
+	{
+		struct addrinfo	hints, *ai = NULL;
+
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = sock->family;
+		hints.ai_flags = AI_NUMERICHOST;
+
+		/* source address of other family is used for the other socket */
+		if (0 == getaddrinfo(CONFIG_SOURCE_IP, NULL, &hints, &ai))
+		{
+			int	rc = bind(sock->fd, ai->ai_addr, ai->ai_addrlen);
+
+			freeaddrinfo(ai);
+
+			if (-1 == rc)
+			{
+				zbx_snprintf(error, max_error_len, "cannot bind %s ICMP socket to \"%s\": %s", family,
+						CONFIG_SOURCE_IP, zbx_strerror(errno));
+				goto fail;
+			}
+		}
+	}
+
+	if (-1 == (flags = fcntl(sock->fd, F_GETFL, 0)) || -1 == fcntl(sock->fd, F_SETFL, flags | O_NONBLOCK))
+	{
+		zbx_snprintf(error, max_error_len, "cannot set %s ICMP socket to non-blocking mode: %s", family,
+				zbx_strerror(errno));
+		goto fail;
+	}
+
+	/* replies to large batches can arrive faster than they are read */
+	(void)setsockopt(sock->fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+#ifdef SO_TIMESTAMP
+	(void)setsockopt(sock->fd, SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on));
+#endif
+	zabbix_log(LOG_LEVEL_DEBUG, "opened %s %s ICMP socket", family, 0 != sock->raw ? "raw" : "datagram");
+
+	return SUCCEED;
+fail:
+	close(sock->fd);
+	sock->fd = -1;
+
+	return FAIL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: resolve host address and select the socket to ping it             *
+ *                                                                            *
+ * Comments: IPv4 address is preferred for host names having both address     *
+ *           families, like fping does.                                       *
+ *                                                                            *
+ ******************************************************************************/
+static int	icmp_target_init(zbx_icmp_target_t *target, const char *host, char *error, size_t max_error_len)
+{
+	struct addrinfo		hints, *ai = NULL, *res, *found = NULL;
+	size_t			i;
+
+	memset(&hints, 0, sizeof(hints));
+#ifdef HAVE_IPV6
+	hints.ai_family = PF_UNSPEC;
+#else
+	hints.ai_family = PF_INET;
+#endif
+	hints.ai_socktype = SOCK_DGRAM;
+
+	if (0 != getaddrinfo(host, NULL, &hints, &ai))
+		return SUCCEED;
+
+	for (res = ai; NULL != res; res = res->ai_next)
+	{
+		if (AF_INET == res->ai_family)
+		{
+			found = res;
+			break;
+		}
+
+		if (NULL == found && (size_t)res->ai_addrlen <= sizeof(target->addr))
+			found = res;
+	}
+
+	if (NULL == found)
+		goto out;
+
+	for (i = 0; i < ARRSIZE(icmp_sockets); i++)
+	{
+		if (icmp_sockets[i].family != found->ai_family)
+			continue;
+
+		if (-1 == icmp_sockets[i].fd && SUCCEED != icmp_socket_open(&icmp_sockets[i], error, max_error_len))
+		{
+			freeaddrinfo(ai);
+			return FAIL;
+		}
+
+		memcpy(&target->addr, found->ai_addr, found->ai_addrlen);
+		target->addr_len = (socklen_t)found->ai_addrlen;
+		target->sock = &icmp_sockets[i];
+		break;
+	}
+out:
+	freeaddrinfo(ai);
+
+	return SUCCEED;
+}
+
+static int	icmp_addr_equal(const struct sockaddr_storage *addr, const struct sockaddr_storage *from)
+{
+	if (addr->ss_family != from->ss_family)
+		return FAIL;
+
+	if (AF_INET == addr->ss_family)
+	{
+		return 0 == memcmp(&((const struct sockaddr_in *)addr)->sin_addr,
+				&((const struct sockaddr_in *)from)->sin_addr, sizeof(struct in_addr)) ? SUCCEED : FAIL;
+	}
+#ifdef HAVE_IPV6
+	if (AF_INET6 == addr->ss_family)
+	{
+		return 0 == memcmp(&((const struct sockaddr_in6 *)addr)->sin6_addr,
+				&((const struct sockaddr_in6 *)from)->sin6_addr, sizeof(struct in6_addr)) ? SUCCEED : FAIL;
+	}
+#endif
+	return FAIL;
+}
+
+static int	icmp_send(const zbx_icmp_target_t *target, const unsigned char *buf, size_t len)
+{
+	int	i;
+
+	for (i = 0;; i++)
+	{
+		struct timeval	tv = {0, 1000};
+
+		if (-1 != sendto(target->sock->fd, buf, len, 0, (const struct sockaddr *)&target->addr,
+				target->addr_len))
+		{
+			return SUCCEED;
+		}
+
+		if ((EAGAIN != errno && EWOULDBLOCK != errno && ENOBUFS != errno) || ZBX_ICMP_SEND_RETRIES == i)
+		{
+			zabbix_log(LOG_LEVEL_DEBUG, "cannot send ICMP packet: %s", zbx_strerror(errno));
+			return FAIL;
+		}
+
+		/* socket send buffer is full, give the system time to transmit queued packets */
+		(void)select(0, NULL, NULL, NULL, &tv);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: read all queued echo replies from socket                          *
+ *                                                                            *
+ ******************************************************************************/
+static void	icmp_recv(zbx_icmp_ping_t *ping, const zbx_icmp_socket_t *sock)
+{
+	unsigned char	buf[ZBX_KIBIBYTE], reply_type;
+
+	reply_type = (AF_INET == sock->family ? ZBX_ICMP_ECHO_REPLY : ZBX_ICMP6_ECHO_REPLY);
+
+	for (;;)
+	{
+		struct sockaddr_storage	from;
+		struct msghdr		msg;
+		struct iovec		iov;
+		char			control[256];
+		const unsigned char	*p = buf;
+		ssize_t			n;
+		double			now, sec;
+		zbx_icmp_payload_t	payload;
+		zbx_icmp_target_t	*target;
+		ZBX_FPING_HOST		*host;
+#ifdef SO_TIMESTAMP
+		struct cmsghdr		*cmsg;
+#endif
+		iov.iov_base = buf;
+		iov.iov_len = sizeof(buf);
+
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_name = &from;
+		msg.msg_namelen = sizeof(from);
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+
+		if (-1 == (n = recvmsg(sock->fd, &msg, 0)))
+		{
+			if (EINTR == errno)
+				continue;
+
+			break;
+		}
+
+		now = zbx_time();
+#ifdef SO_TIMESTAMP
+		for (cmsg = CMSG_FIRSTHDR(&msg); NULL != cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+		{
+			if (SOL_SOCKET == cmsg->cmsg_level && SCM_TIMESTAMP == cmsg->cmsg_type)
+			{
+				struct timeval	tv;
+
+				memcpy(&tv, CMSG_DATA(cmsg), sizeof(tv));
+				now = tv.tv_sec + tv.tv_usec / 1e6;
+				break;
+			}
+		}
+#endif
+		/* IPv4 raw sockets and datagram sockets on some systems return the IP header too, */
+		/* it's told apart from echo reply by the IP version in the first byte             */
+		if (AF_INET == sock->family && ZBX_ICMP_IP_HEADER_LEN_MIN <= n && 4 == (p[0] >> 4))
+		{
+			size_t	header_len = (size_t)(p[0] & 0x0f) * 4;
+
+			if ((size_t)n < header_len)
+				continue;
+
+			p += header_len;
+			n -= (ssize_t)header_len;
+		}
+
+		if ((size_t)n < ZBX_ICMP_HEADER_LEN + sizeof(payload) || reply_type != p[0])
+			continue;
+
+		memcpy(&payload, p + ZBX_ICMP_HEADER_LEN, sizeof(payload));
+
+		if (ping->cookie != payload.cookie || (zbx_uint32_t)ping->hosts_count <= payload.host ||
+				(zbx_uint32_t)ping->count <= payload.packet)
+		{
+			continue;
+		}
+
+		target = &ping->targets[payload.host];
+
+		/* ignore replies from other addresses, for example when pinging broadcast address */
+		if (target->sock != sock || SUCCEED != icmp_addr_equal(&target->addr, &from))
+			continue;
+
+		/* ignore duplicates */
+		if (0 == target->sent[payload.packet])
+			continue;
+
+		sec = now - target->sent[payload.packet];
+		target->sent[payload.packet] = 0;
+		ping->outstanding--;
+
+		/* late replies are counted as lost */
+		if (sec > ping->timeout)
+			continue;
+
+		if (0 > sec)
+			sec = 0;
+
+		host = &ping->hosts[payload.host];
+
+		if (0 == host->rcv || host->min > sec)
+			host->min = sec;
+		if (0 == host->rcv || host->max < sec)
+			host->max = sec;
+		host->sum += sec;
+		host->rcv++;
+	}
+}
+
+static void	icmp_recv_all(zbx_icmp_ping_t *ping)
+{
+	size_t	i;
+
+	for (i = 0; i < ARRSIZE(icmp_sockets); i++)
+	{
+		if (-1 != icmp_sockets[i].fd)
+			icmp_recv(ping, &icmp_sockets[i]);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: send echo request with the specified index to all hosts           *
+ *                                                                            *
+ * Parameters: ping   - [IN/OUT] the ping data                                *
+ *             packet - [IN] the packet index                                 *
+ *             buf    - [IN/OUT] the packet buffer                            *
+ *             len    - [IN] the packet length                                *
+ *                                                                            *
+ ******************************************************************************/
+static void	icmp_send_packets(zbx_icmp_ping_t *ping, int packet, unsigned char *buf, size_t len)
+{
+	zbx_icmp_payload_t	payload;
+	unsigned short		id = (unsigned short)(getpid() & 0xffff);
+	int			i, sent_num = 0;
+
+	for (i = 0; i < ping->hosts_count; i++)
+	{
+		zbx_icmp_target_t	*target = &ping->targets[i];
+		double			sent;
+
+		if (NULL == target->sock)
+			continue;
+
+		buf[0] = (AF_INET == target->sock->family ? ZBX_ICMP_ECHO_REQUEST : ZBX_ICMP6_ECHO_REQUEST);
+		buf[1] = 0;
+		buf[2] = buf[3] = 0;
+		buf[4] = (unsigned char)(id >> 8);
+		buf[5] = (unsigned char)(id & 0xff);
+		buf[6] = (unsigned char)(packet >> 8);
+		buf[7] = (unsigned char)(packet & 0xff);
+
+		payload.cookie = ping->cookie;
+		payload.host = (zbx_uint32_t)i;
+		payload.packet = (zbx_uint32_t)packet;
+		memcpy(buf + ZBX_ICMP_HEADER_LEN, &payload, sizeof(payload));
+
+		/* ICMPv6 checksum is calculated by the system */
+		if (AF_INET == target->sock->family)
+		{
+			unsigned short	checksum = icmp_checksum(buf, len);
+
+			buf[2] = (unsigned char)(checksum >> 8);
+			buf[3] = (unsigned char)(checksum & 0xff);
+		}
+
+		sent = zbx_time();
+
+		if (SUCCEED == icmp_send(target, buf, len))
+		{
+			target->sent[packet] = sent;
+			ping->outstanding++;
+		}
+
+		/* read replies while sending to large number of hosts, so they are timestamped */
+		/* without delay on systems not supporting receive timestamps                   */
+		if (0 == ++sent_num % ZBX_ICMP_RECV_INTERVAL)
+			icmp_recv_all(ping);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: wait for echo replies and read them                               *
+ *                                                                            *
+ * Parameters: ping - [IN/OUT] the ping data                                  *
+ *             wait - [IN] the maximum time to wait in seconds                *
+ *                                                                            *
+ * Return value: SUCCEED - the replies were read or waiting timed out         *
+ *               FAIL    - waiting failed                                     *
+ *                                                                            *
+ ******************************************************************************/
+static int	icmp_wait(zbx_icmp_ping_t *ping, double wait)
+{
+	struct timeval	tv;
+	fd_set		fdset;
+	int		fd_max = -1, rc;
+	size_t		i;
+
+	tv.tv_sec = (time_t)wait;
+	tv.tv_usec = (suseconds_t)((wait - (double)tv.tv_sec) * 1000000);
+
+	FD_ZERO(&fdset);
+
+	for (i = 0; i < ARRSIZE(icmp_sockets); i++)
+	{
+		if (-1 == icmp_sockets[i].fd)
+			continue;
+
+		FD_SET(icmp_sockets[i].fd, &fdset);
+		fd_max = MAX(fd_max, icmp_sockets[i].fd);
+	}
+
+	if (-1 == (rc = select(fd_max + 1, &fdset, NULL, NULL, &tv)))
+	{
+		if (EINTR == errno)
+			return SUCCEED;
+
+		zabbix_log(LOG_LEVEL_WARNING, "cannot wait for ICMP replies: %s", zbx_strerror(errno));
+		return FAIL;
+	}
+
+	if (0 < rc)
+		icmp_recv_all(ping);
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: ping hosts with ICMP sockets of the process                       *
+ *                                                                            *
+ * Parameters: hosts         - [IN/OUT] the hosts to ping                     *
+ *             hosts_count   - [IN] the number of hosts                       *
+ *             count         - [IN] the number of packets sent to each host   *
+ *             period        - [IN] the interval between packets to one host  *
+ *                                  in milliseconds, 0 - default              *
+ *             size          - [IN] the packet data size in bytes,            *
+ *                                  0 - default                               *
+ *             timeout       - [IN] the reply timeout in milliseconds,        *
+ *                                  0 - default                               *
+ *             error         - [OUT] the error message                        *
+ *             max_error_len - [IN] the size of error message buffer          *
+ *                                                                            *
+ * Return value: SUCCEED - the hosts were pinged                              *
+ *               FAIL    - ICMP sockets cannot be used, the hosts must be     *
+ *                         pinged with fping                                  *
+ *                                                                            *
+ * Comments: The parameters and results have the same meaning as in fping.    *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_ping_native(ZBX_FPING_HOST *hosts, int hosts_count, int count, int period, int size, int timeout,
+		char *error, size_t max_error_len)
+{
+	static zbx_uint32_t	calls;
+
+	zbx_icmp_ping_t		ping;
+	unsigned char		*buf;
+	size_t			len;
+	double			start, now, next, last = 0;
+	int			i, packet, ret = FAIL;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() hosts_count:%d count:%d period:%d size:%d timeout:%d", __func__,
+			hosts_count, count, period, size, timeout);
+
+	if (0 != icmp_failed_at && ZBX_ICMP_RETRY_PERIOD > time(NULL) - icmp_failed_at)
+	{
+		zbx_strlcpy(error, "ICMP sockets are not available", max_error_len);
+		goto out;
+	}
+
+	if (0 == period)
+		period = ZBX_ICMP_DEFAULT_PERIOD;
+
+	if (0 == size)
+		size = ZBX_ICMP_DEFAULT_SIZE;
+
+	if (0 == timeout)
+		timeout = MIN(period, ZBX_ICMP_DEFAULT_TIMEOUT_MAX);
+
+	ping.hosts = hosts;
+	ping.hosts_count = hosts_count;
+	ping.count = count;
+	ping.timeout = timeout / 1000.0;
+	ping.outstanding = 0;
+	ping.targets = (zbx_icmp_target_t *)zbx_calloc(NULL, (size_t)hosts_count, sizeof(zbx_icmp_target_t));
+
+	for (i = 0; i < hosts_count; i++)
+	{
+		if (SUCCEED != icmp_target_init(&ping.targets[i], hosts[i].addr, error, max_error_len))
+		{
+			icmp_failed_at = time(NULL);
+			zabbix_log(LOG_LEVEL_WARNING, "%s, using fping to ping hosts", error);
+			goto clean;
+		}
+
+		if (NULL != ping.targets[i].sock)
+			ping.targets[i].sent = (double *)zbx_calloc(NULL, (size_t)count, sizeof(double));
+	}
+
+	icmp_failed_at = 0;
+
+	len = ZBX_ICMP_HEADER_LEN + (size_t)MAX(size, (int)sizeof(zbx_icmp_payload_t));
+	buf = (unsigned char *)zbx_malloc(NULL, len);
+
+	for (i = ZBX_ICMP_HEADER_LEN; i < (int)len; i++)
+		buf[i] = (unsigned char)i;
+
+	start = zbx_time();
+	ping.cookie = (zbx_uint32_t)getpid() ^ (zbx_uint32_t)(start * 1000000) ^ ++calls;
+
+	for (packet = 0, next = start;;)
+	{
+		now = zbx_time();
+
+		if (packet < count && now >= next)
+		{
+			icmp_send_packets(&ping, packet, buf, len);
+
+			last = zbx_time();
+			next = start + ++packet * period / 1000.0;
+			continue;
+		}
+
+		if (packet == count && (0 == ping.outstanding || now >= last + ping.timeout))
+			break;
+
+		if (SUCCEED != icmp_wait(&ping, (packet < count ? next : last + ping.timeout) - now))
+			break;
+	}
+
+	for (i = 0; i < hosts_count; i++)
+	{
+		if (NULL != ping.targets[i].sock)
+			hosts[i].cnt += count;
+	}
+
+	zbx_free(buf);
+	ret = SUCCEED;
+clean:
+	for (i = 0; i < hosts_count; i++)
+		zbx_free(ping.targets[i].sent);
+
+	zbx_free(ping.targets);
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
+
+	return ret;
+}
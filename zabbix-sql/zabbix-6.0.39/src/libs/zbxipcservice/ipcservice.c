@@ -25,10 +25,13 @@
 #	include <event.h>
 #endif
 
+#include <sys/uio.h>
+
 #include "zbxtypes.h"
 #include "zbxalgo.h"
 #include "log.h"
 #include "zbxipcservice.h"
+#include "zbxatomic.h"
 
 #define ZBX_IPC_PATH_MAX	sizeof(((struct sockaddr_un *)0)->sun_path)
 
@@ -44,6 +47,79 @@ static size_t	ipc_path_root_len = 0;
 #define ZBX_IPC_ASYNC_SOCKET_STATE_TIMEOUT	1
 #define ZBX_IPC_ASYNC_SOCKET_STATE_ERROR	2
 
+/* the message sent by client to switch connection to shared memory ring transport */
+#define ZBX_IPC_SHM_ATTACH		0xffff0001
+
+/* the size of buffer used to coalesce small outgoing messages */
+#define ZBX_IPC_COALESCE_BUFFER_SIZE	(ZBX_IPC_SOCKET_BUFFER_SIZE * 4)
+
+/* the maximum number of messages written with a single writev() call */
+#define ZBX_IPC_WRITEV_MESSAGES_MAX	64
+
+/* the shared memory ring size, must be power of two */
+#define ZBX_IPC_SHM_RING_SIZE		(256 * ZBX_KIBIBYTE)
+
+#define ZBX_CACHE_LINE_SIZE		64
+
+/* the time client waits for service to attach shared memory ring, seconds */
+#define ZBX_IPC_SHM_ATTACH_TIMEOUT	1
+
+/* the maximum time writer sleeps waiting for free space in full ring, milliseconds */
+#define ZBX_IPC_SHM_WAIT_TIMEOUT	1000
+
+/* shared memory ring attach handshake states */
+#define ZBX_IPC_SHM_STATE_PENDING	0
+#define ZBX_IPC_SHM_STATE_ATTACHED	1
+#define ZBX_IPC_SHM_STATE_ABANDONED	2
+
+#if defined(__linux__) && defined(SYS_futex)
+#	define IPC_SHM_FUTEX_SUPPORT
+#endif
+
+/* futex operations, as defined in linux/futex.h */
+#define IPC_FUTEX_WAIT		0
+#define IPC_FUTEX_WAKE		1
+
+/* Single producer/single consumer byte ring in shared memory, used to send messages from  */
+/* client to service. The messages are written in the same format as to socket. The socket */
+/* connection is kept for wakeup notifications and for detecting disconnected peers.      */
+struct zbx_ipc_shm_ring
+{
+	int		shmid;
+	zbx_uint32_t	size;
+
+	/* set when either side has detached from ring */
+	zbx_uint32_t	closed;
+
+	/* set by writer when wakeup notification was sent, reset by reader before reading ring */
+	zbx_uint32_t	signaled;
+
+	/* the attach handshake state, changed from pending either by service (attached) or by */
+	/* client after attach timeout (abandoned)                                             */
+	zbx_uint32_t	state;
+
+	/* set by writer before waiting for free space, reset by reader when waking up writer */
+	zbx_uint32_t	waiting;
+	unsigned char	pad1[ZBX_CACHE_LINE_SIZE - sizeof(int) - sizeof(zbx_uint32_t) * 5];
+
+	/* the read position, updated by reader */
+	zbx_uint32_t	head;
+	unsigned char	pad2[ZBX_CACHE_LINE_SIZE - sizeof(zbx_uint32_t)];
+
+	/* the write position, updated by writer */
+	zbx_uint32_t	tail;
+	unsigned char	pad3[ZBX_CACHE_LINE_SIZE - sizeof(zbx_uint32_t)];
+};
+
+#define IPC_SHM_RING_DATA(ring)	((unsigned char *)(ring) + sizeof(zbx_ipc_shm_ring_t))
+
+#if defined(HAVE_ATOMIC_BUILTINS)
+/* comma separated list of services using shared memory transport */
+static const char	*ipc_shm_services = NULL;
+#endif
+
+static zbx_ipc_stats_t	ipc_stats;
+
 extern unsigned char	program_type;
 
 /* IPC client, providing nonblocking connections through socket */
@@ -106,6 +182,9 @@ static void	event_free(struct event *event)
 
 static void	ipc_client_read_event_cb(evutil_socket_t fd, short what, void *arg);
 static void	ipc_client_write_event_cb(evutil_socket_t fd, short what, void *arg);
+static int	ipc_socket_open(zbx_ipc_socket_t *csocket, const char *service_name, int timeout, int transport,
+		char **error);
+static int	ipc_socket_flush_buffer(zbx_ipc_socket_t *csocket);
 
 static const char	*ipc_get_path(void)
 {
@@ -228,6 +307,51 @@ static int	ipc_write_data(int fd, const unsigned char *data, zbx_uint32_t size,
 	return ret;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: writes data vector to a blocking socket                           *
+ *                                                                            *
+ * Parameters: fd     - [IN] the socket file descriptor                       *
+ *             iov    - [IN/OUT] the data vector, modified during partial     *
+ *                               writes                                       *
+ *             iovcnt - [IN] the number of data vector elements               *
+ *                                                                            *
+ * Return value: SUCCEED - the data was written                               *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	ipc_writev_data(int fd, struct iovec *iov, int iovcnt)
+{
+	ssize_t	n;
+
+	while (0 < iovcnt)
+	{
+		if (-1 == (n = writev(fd, iov, iovcnt)))
+		{
+			if (EINTR == errno)
+				continue;
+
+			zabbix_log(LOG_LEVEL_WARNING, "cannot write to IPC socket: %s", strerror(errno));
+			return FAIL;
+		}
+
+		while (0 < iovcnt && (size_t)n >= iov->iov_len)
+		{
+			n -= (ssize_t)iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+
+		if (0 < iovcnt)
+		{
+			iov->iov_base = (char *)iov->iov_base + n;
+			iov->iov_len -= (size_t)n;
+		}
+	}
+
+	return SUCCEED;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: reads data from a socket                                          *
@@ -361,6 +485,315 @@ static int	ipc_socket_write_message(zbx_ipc_socket_t *csocket, zbx_uint32_t code
 	return ret;
 }
 
+#if defined(HAVE_ATOMIC_BUILTINS)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: checks if service must be connected with shared memory transport  *
+ *                                                                            *
+ * Parameters: service_name - [IN] the service name                           *
+ *                                                                            *
+ * Return value: SUCCEED - shared memory transport must be used               *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: The service names with numeric suffix (multiple service          *
+ *           instances) are matched by the base name.                         *
+ *                                                                            *
+ ******************************************************************************/
+static int	ipc_shm_service_enabled(const char *service_name)
+{
+	const char	*ptr, *next, *suffix;
+	size_t		len;
+
+	if (NULL == ipc_shm_services)
+		return FAIL;
+
+	for (ptr = ipc_shm_services; '\0' != *ptr; ptr = next)
+	{
+		if (NULL == (next = strchr(ptr, ',')))
+			next = ptr + strlen(ptr);
+
+		len = (size_t)(next - ptr);
+
+		if (0 != len && 0 == strncmp(ptr, service_name, len))
+		{
+			for (suffix = service_name + len; 0 != isdigit((unsigned char)*suffix); suffix++)
+				;
+
+			if ('\0' == *suffix)
+				return SUCCEED;
+		}
+
+		if (',' == *next)
+			next++;
+	}
+
+	return FAIL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: waits until the value at the specified shared memory ring         *
+ *          location changes or the timeout expires                           *
+ *                                                                            *
+ * Parameters: addr    - [IN] the location in shared memory ring              *
+ *             value   - [IN] the expected value                              *
+ *             timeout - [IN] the timeout in milliseconds                     *
+ *                                                                            *
+ * Comments: Spurious wakeups are possible, the caller must check the value   *
+ *           again after returning.                                           *
+ *           Without futex support the waiting is emulated with short sleep.  *
+ *                                                                            *
+ ******************************************************************************/
+static void	ipc_shm_wait(zbx_uint32_t *addr, zbx_uint32_t value, int timeout)
+{
+	struct timespec	ts;
+
+#if defined(IPC_SHM_FUTEX_SUPPORT)
+	ts.tv_sec = timeout / 1000;
+	ts.tv_nsec = (timeout % 1000) * 1000000;
+
+	/* the ring is shared between processes, so private futex operations cannot be used */
+	(void)syscall(SYS_futex, addr, IPC_FUTEX_WAIT, value, &ts, NULL, 0);
+#else
+	ZBX_UNUSED(addr);
+	ZBX_UNUSED(value);
+	ZBX_UNUSED(timeout);
+
+	ts.tv_sec = 0;
+	ts.tv_nsec = 100000;
+	nanosleep(&ts, NULL);
+#endif
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: wakes up process waiting in ipc_shm_wait() for the specified      *
+ *          shared memory ring location                                       *
+ *                                                                            *
+ * Parameters: addr - [IN] the location in shared memory ring                 *
+ *                                                                            *
+ ******************************************************************************/
+static void	ipc_shm_wake(zbx_uint32_t *addr)
+{
+#if defined(IPC_SHM_FUTEX_SUPPORT)
+	(void)syscall(SYS_futex, addr, IPC_FUTEX_WAKE, 1, NULL, NULL, 0);
+#else
+	ZBX_UNUSED(addr);
+#endif
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: creates shared memory ring and switches socket to shared memory   *
+ *          transport                                                         *
+ *                                                                            *
+ * Parameters: csocket - [IN] the connected IPC socket                        *
+ *                                                                            *
+ * Comments: On failure the socket transport is used.                         *
+ *           The client waits until service has attached the ring and marks   *
+ *           the segment for removal as soon as the handshake has completed,  *
+ *           timed out or failed, so it is destroyed when the last side       *
+ *           detaches. If service does not attach the ring in time the ring   *
+ *           is abandoned and service keeps reading the socket.               *
+ *                                                                            *
+ ******************************************************************************/
+static void	ipc_socket_open_shm(zbx_ipc_socket_t *csocket)
+{
+	int			shmid;
+	zbx_ipc_shm_ring_t	*ring;
+	zbx_uint32_t		tx_size, state = ZBX_IPC_SHM_STATE_PENDING;
+	double			time_start;
+
+	if (-1 == (shmid = shmget(IPC_PRIVATE, sizeof(zbx_ipc_shm_ring_t) + ZBX_IPC_SHM_RING_SIZE, 0600)))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot allocate shared memory for IPC ring: %s", zbx_strerror(errno));
+		return;
+	}
+
+	if ((void *)(-1) == (ring = (zbx_ipc_shm_ring_t *)shmat(shmid, NULL, 0)))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot attach shared memory for IPC ring: %s", zbx_strerror(errno));
+		(void)shmctl(shmid, IPC_RMID, NULL);
+		return;
+	}
+
+	memset(ring, 0, sizeof(zbx_ipc_shm_ring_t));
+	ring->shmid = shmid;
+	ring->size = ZBX_IPC_SHM_RING_SIZE;
+
+	if (SUCCEED != ipc_socket_write_message(csocket, ZBX_IPC_SHM_ATTACH, (const unsigned char *)&shmid,
+			sizeof(shmid), &tx_size) || ZBX_IPC_HEADER_SIZE + sizeof(shmid) != tx_size)
+	{
+		(void)shmctl(shmid, IPC_RMID, NULL);
+		(void)shmdt(ring);
+		return;
+	}
+
+	time_start = zbx_time();
+
+	while (ZBX_IPC_SHM_STATE_PENDING == (state = zbx_atomic_load(&ring->state)))
+	{
+		if (ZBX_IPC_SHM_ATTACH_TIMEOUT <= zbx_time() - time_start)
+		{
+			/* if service attaches the ring at the same time the state is updated to attached */
+			if (0 != zbx_atomic_cas(&ring->state, &state, ZBX_IPC_SHM_STATE_ABANDONED))
+				state = ZBX_IPC_SHM_STATE_ABANDONED;
+			break;
+		}
+
+		ipc_shm_wait(&ring->state, ZBX_IPC_SHM_STATE_PENDING, 100);
+	}
+
+	(void)shmctl(shmid, IPC_RMID, NULL);
+
+	if (ZBX_IPC_SHM_STATE_ATTACHED != state)
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "IPC service did not attach shared memory ring, using socket transport");
+		(void)shmdt(ring);
+		return;
+	}
+
+	csocket->ring = ring;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: wakes up reader if it has not been notified since the last read   *
+ *                                                                            *
+ * Parameters: csocket - [IN] the IPC socket                                  *
+ *                                                                            *
+ * Return value: SUCCEED - the reader was notified or is being notified       *
+ *               FAIL    - socket error                                       *
+ *                                                                            *
+ ******************************************************************************/
+static int	ipc_shm_notify(zbx_ipc_socket_t *csocket)
+{
+	unsigned char	byte = 0;
+	zbx_uint32_t	size_sent;
+
+	/* order the ring write position update before checking reader notification state */
+	zbx_atomic_fence();
+
+	if (0 != zbx_atomic_exchange(&csocket->ring->signaled, 1))
+		return SUCCEED;
+
+	if (SUCCEED != ipc_write_data(csocket->fd, &byte, 1, &size_sent) || 1 != size_sent)
+		return FAIL;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: writes data to shared memory ring                                 *
+ *                                                                            *
+ * Parameters: csocket - [IN] the IPC socket                                  *
+ *             data    - [IN] the data                                        *
+ *             size    - [IN] the data size                                   *
+ *                                                                            *
+ * Return value: SUCCEED - the data was written                               *
+ *               FAIL    - the reader has detached or socket error            *
+ *                                                                            *
+ * Comments: If the ring is full the reader is notified and the writer sleeps *
+ *           until the reader frees space and wakes it up.                    *
+ *                                                                            *
+ ******************************************************************************/
+static int	ipc_shm_write_data(zbx_ipc_socket_t *csocket, const unsigned char *data, zbx_uint32_t size)
+{
+	zbx_ipc_shm_ring_t	*ring = csocket->ring;
+	zbx_uint32_t		head, tail, free_size, offset, len;
+
+	tail = zbx_atomic_load_relaxed(&ring->tail);
+
+	while (0 != size)
+	{
+		head = zbx_atomic_load(&ring->head);
+
+		if (0 == (free_size = ring->size - (tail - head)))
+		{
+			if (0 != zbx_atomic_load(&ring->closed) || SUCCEED != ipc_shm_notify(csocket))
+				return FAIL;
+
+			/* the reader checks waiting flag after updating read position, so either the */
+			/* reader wakes up writer or the read position differs and wait returns at once */
+			zbx_atomic_exchange(&ring->waiting, 1);
+			ipc_shm_wait(&ring->head, head, ZBX_IPC_SHM_WAIT_TIMEOUT);
+			ipc_stats.shm_waits++;
+
+			continue;
+		}
+
+		offset = tail & (ring->size - 1);
+		len = MIN(MIN(free_size, size), ring->size - offset);
+
+		memcpy(IPC_SHM_RING_DATA(ring) + offset, data, len);
+		tail += len;
+		data += len;
+		size -= len;
+
+		zbx_atomic_store(&ring->tail, tail);
+	}
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: writes IPC message to shared memory ring                          *
+ *                                                                            *
+ * Parameters: csocket - [IN] the IPC socket                                  *
+ *             code    - [IN] the message code                                *
+ *             data    - [IN] the data                                        *
+ *             size    - [IN] the data size                                   *
+ *                                                                            *
+ * Return value: SUCCEED - the message was written                            *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: The reader must be notified with ipc_shm_notify() after writing  *
+ *           messages.                                                        *
+ *                                                                            *
+ ******************************************************************************/
+static int	ipc_shm_write_message(zbx_ipc_socket_t *csocket, zbx_uint32_t code, const unsigned char *data,
+		zbx_uint32_t size)
+{
+	zbx_uint32_t	header[2];
+
+	if (0 != zbx_atomic_load(&csocket->ring->closed))
+		return FAIL;
+
+	header[ZBX_IPC_MESSAGE_CODE] = code;
+	header[ZBX_IPC_MESSAGE_SIZE] = size;
+
+	if (SUCCEED != ipc_shm_write_data(csocket, (const unsigned char *)header, ZBX_IPC_HEADER_SIZE))
+		return FAIL;
+
+	if (0 != size && SUCCEED != ipc_shm_write_data(csocket, data, size))
+		return FAIL;
+
+	return SUCCEED;
+}
+#endif
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: detaches shared memory ring from IPC socket                       *
+ *                                                                            *
+ * Parameters: csocket - [IN] the IPC socket                                  *
+ *                                                                            *
+ ******************************************************************************/
+static void	ipc_socket_close_shm(zbx_ipc_socket_t *csocket)
+{
+#if defined(HAVE_ATOMIC_BUILTINS)
+	zbx_atomic_store(&csocket->ring->closed, 1);
+
+	/* wake up writer waiting for free space, so it notices the closed ring */
+	zbx_atomic_fence();
+	ipc_shm_wake(&csocket->ring->head);
+#endif
+	(void)shmdt(csocket->ring);
+	csocket->ring = NULL;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: reads message header and data from buffer                         *
@@ -579,7 +1012,9 @@ static void	ipc_client_free(zbx_ipc_client_t *client)
  ******************************************************************************/
 static void	ipc_client_push_rx_message(zbx_ipc_client_t *client)
 {
-	zbx_ipc_message_t	*message;
+	zbx_ipc_message_t		*message;
+
+	zbx_ipc_transport_stats_t	*stats;
 
 	message = (zbx_ipc_message_t *)zbx_malloc(NULL, sizeof(zbx_ipc_message_t));
 	message->code = client->rx_header[ZBX_IPC_MESSAGE_CODE];
@@ -587,6 +1022,10 @@ static void	ipc_client_push_rx_message(zbx_ipc_client_t *client)
 	message->data = client->rx_data;
 	zbx_queue_ptr_push(&client->rx_queue, message);
 
+	stats = &ipc_stats.received[NULL == client->csocket.ring ? ZBX_IPC_TRANSPORT_SOCKET : ZBX_IPC_TRANSPORT_SHM];
+	stats->messages++;
+	stats->bytes += message->size;
+
 	client->rx_data = NULL;
 	client->rx_bytes = 0;
 }
@@ -615,6 +1054,136 @@ static void	ipc_client_pop_tx_message(zbx_ipc_client_t *client)
 	zbx_free(message);
 }
 
+#if defined(HAVE_ATOMIC_BUILTINS)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: attaches shared memory ring created by IPC service client         *
+ *                                                                            *
+ * Parameters: client - [IN] the client                                       *
+ *                                                                            *
+ * Return value: SUCCEED - the client was switched to shared memory transport *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: On failure the client times out waiting for the ring to be       *
+ *           attached and continues with socket transport.                    *
+ *                                                                            *
+ ******************************************************************************/
+static int	ipc_client_attach_shm(zbx_ipc_client_t *client)
+{
+	int			shmid;
+	zbx_ipc_shm_ring_t	*ring;
+	zbx_uint32_t		state = ZBX_IPC_SHM_STATE_PENDING;
+
+	if (sizeof(shmid) != client->rx_header[ZBX_IPC_MESSAGE_SIZE])
+	{
+		THIS_SHOULD_NEVER_HAPPEN;
+		zbx_free(client->rx_data);
+		client->rx_bytes = 0;
+		return FAIL;
+	}
+
+	memcpy(&shmid, client->rx_data, sizeof(shmid));
+
+	zbx_free(client->rx_data);
+	client->rx_bytes = 0;
+
+	if ((void *)(-1) == (ring = (zbx_ipc_shm_ring_t *)shmat(shmid, NULL, 0)))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot attach IPC client shared memory ring: %s", zbx_strerror(errno));
+		return FAIL;
+	}
+
+	/* the segment will be destroyed after both sides have detached, also if client has exited already */
+	(void)shmctl(shmid, IPC_RMID, NULL);
+
+	if (ZBX_IPC_SHM_RING_SIZE != ring->size)
+	{
+		THIS_SHOULD_NEVER_HAPPEN;
+		(void)shmdt(ring);
+		return FAIL;
+	}
+
+	if (0 == zbx_atomic_cas(&ring->state, &state, ZBX_IPC_SHM_STATE_ATTACHED))
+	{
+		/* the client has timed out waiting and continues with socket transport */
+		(void)shmdt(ring);
+		return FAIL;
+	}
+
+	ipc_shm_wake(&ring->state);
+
+	client->csocket.ring = ring;
+
+	/* the rest of socket data are wakeup notifications */
+	client->csocket.rx_buffer_bytes = 0;
+	client->csocket.rx_buffer_offset = 0;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: reads messages from IPC service client shared memory ring         *
+ *                                                                            *
+ * Parameters: client - [IN] the client to read                               *
+ *                                                                            *
+ * Return value:  FAIL - connection was closed                                *
+ *                                                                            *
+ ******************************************************************************/
+static int	ipc_client_read_shm(zbx_ipc_client_t *client)
+{
+	zbx_ipc_shm_ring_t	*ring = client->csocket.ring;
+	zbx_uint32_t		head, tail, offset, len, read_size;
+	unsigned char		buffer[ZBX_CACHE_LINE_SIZE];
+	int			ret = SUCCEED;
+
+	/* consume wakeup notifications */
+	do
+	{
+		if (FAIL == ipc_read_data(client->csocket.fd, buffer, sizeof(buffer), &read_size))
+		{
+			/* read the messages written before connection was closed */
+			ret = FAIL;
+			break;
+		}
+	}
+	while (0 != read_size);
+
+	/* messages written after this point will trigger a new notification */
+	zbx_atomic_exchange(&ring->signaled, 0);
+	zbx_atomic_fence();
+
+	head = zbx_atomic_load_relaxed(&ring->head);
+	tail = zbx_atomic_load(&ring->tail);
+
+	while (head != tail)
+	{
+		offset = head & (ring->size - 1);
+		len = MIN(tail - head, ring->size - offset);
+
+		if (SUCCEED == ipc_read_buffer(client->rx_header, &client->rx_data, client->rx_bytes,
+				IPC_SHM_RING_DATA(ring) + offset, len, &read_size))
+		{
+			client->rx_bytes += read_size;
+			ipc_client_push_rx_message(client);
+		}
+		else
+			client->rx_bytes += read_size;
+
+		head += read_size;
+		zbx_atomic_store(&ring->head, head);
+	}
+
+	/* order the ring read position update before checking writer waiting state */
+	zbx_atomic_fence();
+
+	if (0 != zbx_atomic_load_relaxed(&ring->waiting) && 0 != zbx_atomic_exchange(&ring->waiting, 0))
+		ipc_shm_wake(&ring->head);
+
+	return ret;
+}
+#endif
+
 /******************************************************************************
  *                                                                            *
  * Purpose: reads data from IPC service client                                *
@@ -631,6 +1200,10 @@ static int	ipc_client_read(zbx_ipc_client_t *client)
 {
 	int	rc;
 
+#if defined(HAVE_ATOMIC_BUILTINS)
+	if (NULL != client->csocket.ring)
+		return ipc_client_read_shm(client);
+#endif
 	do
 	{
 		if (FAIL == ipc_socket_read_message(&client->csocket, client->rx_header, &client->rx_data,
@@ -642,7 +1215,19 @@ static int	ipc_client_read(zbx_ipc_client_t *client)
 		}
 
 		if (SUCCEED == (rc = ipc_message_is_completed(client->rx_header, client->rx_bytes)))
+		{
+#if defined(HAVE_ATOMIC_BUILTINS)
+			if (ZBX_IPC_SHM_ATTACH == client->rx_header[ZBX_IPC_MESSAGE_CODE])
+			{
+				if (SUCCEED == ipc_client_attach_shm(client))
+					return ipc_client_read_shm(client);
+
+				/* the client has not switched to shared memory transport */
+				continue;
+			}
+#endif
 			ipc_client_push_rx_message(client);
+		}
 	}
 
 	while (SUCCEED == rc);
@@ -741,11 +1326,49 @@ static void	ipc_service_push_client(zbx_ipc_service_t *service, zbx_ipc_client_t
 	if (ZBX_IPC_CLIENT_STATE_QUEUED == client->state)
 		return;
 
-	if (0 == zbx_queue_ptr_values_num(&client->rx_queue) && NULL != client->rx_event)
-		return;
+	if (0 == zbx_queue_ptr_values_num(&client->rx_queue) && NULL != client->rx_event)
+		return;
+
+	client->state = ZBX_IPC_CLIENT_STATE_QUEUED;
+	zbx_queue_ptr_push(&service->clients_recv, client);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: pops the next received message from service clients               *
+ *                                                                            *
+ * Parameters: service - [IN] the IPC service                                 *
+ *             client  - [OUT] the client that sent the message               *
+ *             message - [OUT] the received message or NULL if the client     *
+ *                             connection was closed                          *
+ *                                                                            *
+ * Return value: SUCCEED - a client with message/closed connection was popped *
+ *               FAIL    - there are no clients with pending messages         *
+ *                                                                            *
+ ******************************************************************************/
+static int	ipc_service_pop_message(zbx_ipc_service_t *service, zbx_ipc_client_t **client,
+		zbx_ipc_message_t **message)
+{
+	if (NULL == (*client = ipc_service_pop_client(service)))
+		return FAIL;
+
+	if (NULL != (*message = (zbx_ipc_message_t *)zbx_queue_ptr_pop(&(*client)->rx_queue)))
+	{
+		if (SUCCEED == ZBX_CHECK_LOG_LEVEL(LOG_LEVEL_TRACE))
+		{
+			char	*data = NULL;
 
-	client->state = ZBX_IPC_CLIENT_STATE_QUEUED;
-	zbx_queue_ptr_push(&service->clients_recv, client);
+			zbx_ipc_message_format(*message, &data);
+			zabbix_log(LOG_LEVEL_DEBUG, "%s() %s", __func__, data);
+
+			zbx_free(data);
+		}
+
+		ipc_service_push_client(service, *client);
+		zbx_ipc_client_addref(*client);
+	}
+
+	return SUCCEED;
 }
 
 /******************************************************************************
@@ -1097,7 +1720,7 @@ static int	ipc_check_running_service(const char *service_name)
 	int			ret;
 	char			*error = NULL;
 
-	if (SUCCEED == (ret = zbx_ipc_socket_open(&csocket, service_name, 0, &error)))
+	if (SUCCEED == (ret = ipc_socket_open(&csocket, service_name, 0, ZBX_IPC_TRANSPORT_SOCKET, &error)))
 		zbx_ipc_socket_close(&csocket);
 	else
 		zbx_free(error);
@@ -1105,10 +1728,6 @@ static int	ipc_check_running_service(const char *service_name)
 	return ret;
 }
 
-/*
- * Public client API
- */
-
 /******************************************************************************
  *                                                                            *
  * Purpose: opens socket to an IPC service listening on the specified path    *
@@ -1116,13 +1735,15 @@ static int	ipc_check_running_service(const char *service_name)
  * Parameters: csocket      - [OUT] the IPC socket to the service             *
  *             service_name - [IN] the IPC service name                       *
  *             timeout      - [IN] the connection timeout                     *
+ *             transport    - [IN] the requested transport                    *
  *             error        - [OUT] the error message                         *
  *                                                                            *
  * Return value: SUCCEED - the socket was successfully opened                 *
  *               FAIL    - otherwise                                          *
  *                                                                            *
  ******************************************************************************/
-int	zbx_ipc_socket_open(zbx_ipc_socket_t *csocket, const char *service_name, int timeout, char **error)
+static int	ipc_socket_open(zbx_ipc_socket_t *csocket, const char *service_name, int timeout, int transport,
+		char **error)
 {
 	struct sockaddr_un	addr;
 	time_t			start;
@@ -1132,6 +1753,10 @@ int	zbx_ipc_socket_open(zbx_ipc_socket_t *csocket, const char *service_name, int
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
+	csocket->ring = NULL;
+	csocket->tx_buffer = NULL;
+	csocket->tx_buffer_bytes = 0;
+
 	if (NULL == (socket_path = ipc_make_path(service_name, error)))
 		goto out;
 
@@ -1163,12 +1788,43 @@ int	zbx_ipc_socket_open(zbx_ipc_socket_t *csocket, const char *service_name, int
 	csocket->rx_buffer_bytes = 0;
 	csocket->rx_buffer_offset = 0;
 
+#if defined(HAVE_ATOMIC_BUILTINS)
+	if (ZBX_IPC_TRANSPORT_SHM == transport && SUCCEED == ipc_shm_service_enabled(service_name))
+		ipc_socket_open_shm(csocket);
+#else
+	ZBX_UNUSED(transport);
+#endif
 	ret = SUCCEED;
 out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
 	return ret;
 }
 
+/*
+ * Public client API
+ */
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: opens socket to an IPC service listening on the specified path    *
+ *                                                                            *
+ * Parameters: csocket      - [OUT] the IPC socket to the service             *
+ *             service_name - [IN] the IPC service name                       *
+ *             timeout      - [IN] the connection timeout                     *
+ *             error        - [OUT] the error message                         *
+ *                                                                            *
+ * Return value: SUCCEED - the socket was successfully opened                 *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: Shared memory transport is used for services configured with     *
+ *           zbx_ipc_set_shm_services().                                      *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_ipc_socket_open(zbx_ipc_socket_t *csocket, const char *service_name, int timeout, char **error)
+{
+	return ipc_socket_open(csocket, service_name, timeout, ZBX_IPC_TRANSPORT_SHM, error);
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: closes socket to an IPC service                                   *
@@ -1180,6 +1836,17 @@ void	zbx_ipc_socket_close(zbx_ipc_socket_t *csocket)
 {
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
+	if (NULL != csocket->tx_buffer)
+	{
+		if (-1 != csocket->fd && SUCCEED != ipc_socket_flush_buffer(csocket))
+			zabbix_log(LOG_LEVEL_WARNING, "cannot write coalesced messages to IPC service");
+
+		zbx_free(csocket->tx_buffer);
+	}
+
+	if (NULL != csocket->ring)
+		ipc_socket_close_shm(csocket);
+
 	if (-1 != csocket->fd)
 	{
 		close(csocket->fd);
@@ -1189,6 +1856,100 @@ void	zbx_ipc_socket_close(zbx_ipc_socket_t *csocket)
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: updates sent message statistics                                   *
+ *                                                                            *
+ * Parameters: csocket    - [IN] the IPC socket                               *
+ *             messages   - [IN] the number of sent messages                  *
+ *             bytes      - [IN] the number of sent data bytes                *
+ *             time_start - [IN] the time when writing started                *
+ *                                                                            *
+ ******************************************************************************/
+static void	ipc_socket_update_stats(const zbx_ipc_socket_t *csocket, int messages, zbx_uint64_t bytes,
+		double time_start)
+{
+	zbx_ipc_transport_stats_t	*stats;
+
+	stats = &ipc_stats.sent[NULL == csocket->ring ? ZBX_IPC_TRANSPORT_SOCKET : ZBX_IPC_TRANSPORT_SHM];
+	stats->messages += (zbx_uint64_t)messages;
+	stats->bytes += bytes;
+	stats->time += zbx_time() - time_start;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: writes a message to IPC service bypassing coalescing buffer       *
+ *                                                                            *
+ * Parameters: csocket - [IN] an opened IPC socket to the service             *
+ *             code    - [IN] the message code                                *
+ *             data    - [IN] the data                                        *
+ *             size    - [IN] the data size                                   *
+ *                                                                            *
+ * Return value: SUCCEED - the message was successfully written               *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	ipc_socket_write_direct(zbx_ipc_socket_t *csocket, zbx_uint32_t code, const unsigned char *data,
+		zbx_uint32_t size)
+{
+	zbx_uint32_t	size_sent;
+
+#if defined(HAVE_ATOMIC_BUILTINS)
+	if (NULL != csocket->ring)
+	{
+		if (SUCCEED != ipc_shm_write_message(csocket, code, data, size))
+			return FAIL;
+
+		return ipc_shm_notify(csocket);
+	}
+#endif
+	if (SUCCEED != ipc_socket_write_message(csocket, code, data, size, &size_sent) ||
+			size_sent != size + ZBX_IPC_HEADER_SIZE)
+	{
+		return FAIL;
+	}
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: writes coalesced messages to IPC service                          *
+ *                                                                            *
+ * Parameters: csocket - [IN] an opened IPC socket to the service             *
+ *                                                                            *
+ * Return value: SUCCEED - the messages were successfully written             *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	ipc_socket_flush_buffer(zbx_ipc_socket_t *csocket)
+{
+	zbx_uint32_t	size_sent, size = csocket->tx_buffer_bytes;
+
+	if (0 == size)
+		return SUCCEED;
+
+	csocket->tx_buffer_bytes = 0;
+
+#if defined(HAVE_ATOMIC_BUILTINS)
+	if (NULL != csocket->ring)
+	{
+		if (0 != zbx_atomic_load(&csocket->ring->closed) ||
+				SUCCEED != ipc_shm_write_data(csocket, csocket->tx_buffer, size))
+		{
+			return FAIL;
+		}
+
+		return ipc_shm_notify(csocket);
+	}
+#endif
+	if (SUCCEED != ipc_write_data(csocket->fd, csocket->tx_buffer, size, &size_sent) || size_sent != size)
+		return FAIL;
+
+	return SUCCEED;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: writes a message to IPC service                                   *
@@ -1201,27 +1962,193 @@ void	zbx_ipc_socket_close(zbx_ipc_socket_t *csocket)
  * Return value: SUCCEED - the message was successfully written               *
  *               FAIL    - otherwise                                          *
  *                                                                            *
+ * Comments: If coalescing is enabled small messages are buffered and written *
+ *           together once the coalescing window since the first buffered     *
+ *           message has passed, the buffer is full, a larger message is      *
+ *           written or the socket is read, flushed or closed.                *
+ *                                                                            *
  ******************************************************************************/
 int	zbx_ipc_socket_write(zbx_ipc_socket_t *csocket, zbx_uint32_t code, const unsigned char *data, zbx_uint32_t size)
 {
 	int		ret;
-	zbx_uint32_t	size_sent;
+	double		time_start;
+	zbx_uint32_t	header[2];
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
-	if (SUCCEED == ipc_socket_write_message(csocket, code, data, size, &size_sent) &&
-			size_sent == size + ZBX_IPC_HEADER_SIZE)
+	time_start = zbx_time();
+
+	if (NULL == csocket->tx_buffer || ZBX_IPC_SOCKET_BUFFER_SIZE < size + ZBX_IPC_HEADER_SIZE)
 	{
-		ret = SUCCEED;
+		if (SUCCEED == (ret = ipc_socket_flush_buffer(csocket)))
+			ret = ipc_socket_write_direct(csocket, code, data, size);
+
+		goto out;
+	}
+
+	if (ZBX_IPC_COALESCE_BUFFER_SIZE < csocket->tx_buffer_bytes + ZBX_IPC_HEADER_SIZE + size &&
+			SUCCEED != (ret = ipc_socket_flush_buffer(csocket)))
+	{
+		goto out;
+	}
+
+	if (0 == csocket->tx_buffer_bytes)
+		csocket->tx_time = time_start;
+
+	header[ZBX_IPC_MESSAGE_CODE] = code;
+	header[ZBX_IPC_MESSAGE_SIZE] = size;
+
+	memcpy(csocket->tx_buffer + csocket->tx_buffer_bytes, header, ZBX_IPC_HEADER_SIZE);
+	csocket->tx_buffer_bytes += ZBX_IPC_HEADER_SIZE;
+
+	if (0 != size)
+	{
+		memcpy(csocket->tx_buffer + csocket->tx_buffer_bytes, data, size);
+		csocket->tx_buffer_bytes += size;
 	}
+
+	if (csocket->tx_window <= time_start - csocket->tx_time)
+		ret = ipc_socket_flush_buffer(csocket);
 	else
-		ret = FAIL;
+		ret = SUCCEED;
+out:
+	if (SUCCEED == ret)
+		ipc_socket_update_stats(csocket, 1, size, time_start);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: writes multiple messages to IPC service                           *
+ *                                                                            *
+ * Parameters: csocket      - [IN] an opened IPC socket to the service        *
+ *             messages     - [IN] the messages to write                      *
+ *             messages_num - [IN] the number of messages                     *
+ *                                                                            *
+ * Return value: SUCCEED - the messages were successfully written             *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: Messages are written with a single system call per up to         *
+ *           ZBX_IPC_WRITEV_MESSAGES_MAX messages.                            *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_ipc_socket_write_batch(zbx_ipc_socket_t *csocket, const zbx_ipc_message_t *messages, int messages_num)
+{
+	int		i, j, num, ret = FAIL;
+	double		time_start;
+	zbx_uint64_t	bytes = 0;
+	zbx_uint32_t	headers[ZBX_IPC_WRITEV_MESSAGES_MAX][2];
+	struct iovec	iov[ZBX_IPC_WRITEV_MESSAGES_MAX * 2];
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() messages:%d", __func__, messages_num);
+
+	time_start = zbx_time();
+
+	if (SUCCEED != ipc_socket_flush_buffer(csocket))
+		goto out;
+
+#if defined(HAVE_ATOMIC_BUILTINS)
+	if (NULL != csocket->ring)
+	{
+		for (i = 0; i < messages_num; i++)
+		{
+			if (SUCCEED != ipc_shm_write_message(csocket, messages[i].code, messages[i].data,
+					messages[i].size))
+			{
+				goto out;
+			}
+
+			bytes += messages[i].size;
+		}
+
+		if (SUCCEED != ipc_shm_notify(csocket))
+			goto out;
+
+		ret = SUCCEED;
+		goto out;
+	}
+#endif
+	for (i = 0; i < messages_num; i += num)
+	{
+		num = MIN(messages_num - i, ZBX_IPC_WRITEV_MESSAGES_MAX);
+
+		for (j = 0; j < num; j++)
+		{
+			headers[j][ZBX_IPC_MESSAGE_CODE] = messages[i + j].code;
+			headers[j][ZBX_IPC_MESSAGE_SIZE] = messages[i + j].size;
+
+			iov[j * 2].iov_base = headers[j];
+			iov[j * 2].iov_len = ZBX_IPC_HEADER_SIZE;
+			iov[j * 2 + 1].iov_base = messages[i + j].data;
+			iov[j * 2 + 1].iov_len = messages[i + j].size;
+
+			bytes += messages[i + j].size;
+		}
+
+		if (SUCCEED != ipc_writev_data(csocket->fd, iov, num * 2))
+			goto out;
+	}
+
+	ret = SUCCEED;
+out:
+	if (SUCCEED == ret)
+		ipc_socket_update_stats(csocket, messages_num, bytes, time_start);
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
 
 	return ret;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: enables or disables coalescing of small outgoing messages         *
+ *                                                                            *
+ * Parameters: csocket   - [IN] an opened IPC socket to the service           *
+ *             window_us - [IN] the coalescing window in microseconds,        *
+ *                              0 - disable coalescing                        *
+ *                                                                            *
+ * Comments: The coalesced messages are written only during subsequent socket *
+ *           operations, so socket owner must call zbx_ipc_socket_flush()     *
+ *           when it has finished writing a series of messages.               *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_ipc_socket_set_coalesce(zbx_ipc_socket_t *csocket, int window_us)
+{
+	if (0 >= window_us)
+	{
+		(void)ipc_socket_flush_buffer(csocket);
+		zbx_free(csocket->tx_buffer);
+		return;
+	}
+
+	if (NULL == csocket->tx_buffer)
+	{
+		csocket->tx_buffer = (unsigned char *)zbx_malloc(NULL, ZBX_IPC_COALESCE_BUFFER_SIZE);
+		csocket->tx_buffer_bytes = 0;
+	}
+
+	csocket->tx_window = window_us / 1000000.0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: writes coalesced messages to IPC service                          *
+ *                                                                            *
+ * Parameters: csocket - [IN] an opened IPC socket to the service             *
+ *                                                                            *
+ * Return value: SUCCEED - the messages were successfully written or there    *
+ *                         were no coalesced messages                         *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_ipc_socket_flush(zbx_ipc_socket_t *csocket)
+{
+	return ipc_socket_flush_buffer(csocket);
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: reads a message from IPC service                                  *
@@ -1244,6 +2171,10 @@ int	zbx_ipc_socket_read(zbx_ipc_socket_t *csocket, zbx_ipc_message_t *message)
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
+	/* the response might depend on coalesced messages */
+	if (SUCCEED != ipc_socket_flush_buffer(csocket))
+		goto out;
+
 	if (SUCCEED != ipc_socket_read_message(csocket, header, &data, &rx_bytes))
 		goto out;
 
@@ -1460,6 +2391,41 @@ void	zbx_ipc_service_free_env(void)
 	ipc_service_free_libevent();
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: sets services to be connected with shared memory ring transport   *
+ *                                                                            *
+ * Parameters: services - [IN] comma separated service names or NULL          *
+ *                                                                            *
+ * Comments: The list must be set before forking processes and must stay      *
+ *           allocated while processes are running.                           *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_ipc_set_shm_services(const char *services)
+{
+#if defined(HAVE_ATOMIC_BUILTINS)
+	ipc_shm_services = services;
+#else
+	if (NULL != services)
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "shared memory IPC transport is not supported by this build,"
+				" using socket transport");
+	}
+#endif
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets IPC statistics of the current process                        *
+ *                                                                            *
+ * Parameters: stats - [OUT] the IPC statistics                               *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_ipc_get_stats(zbx_ipc_stats_t *stats)
+{
+	*stats = ipc_stats;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: starts IPC service on the specified path                          *
@@ -1575,7 +2541,9 @@ void	zbx_ipc_service_close(zbx_ipc_service_t *service)
 	event_free(service->ev_listener);
 	event_base_free(service->ev);
 
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() received socket messages:" ZBX_FS_UI64 " shared memory messages:"
+			ZBX_FS_UI64, __func__, ipc_stats.received[ZBX_IPC_TRANSPORT_SOCKET].messages,
+			ipc_stats.received[ZBX_IPC_TRANSPORT_SHM].messages);
 }
 
 /******************************************************************************
@@ -1625,24 +2593,8 @@ int	zbx_ipc_service_recv(zbx_ipc_service_t *service, const zbx_timespec_t *timeo
 
 	event_base_loop(service->ev, flags);
 
-	if (NULL != (*client = ipc_service_pop_client(service)))
+	if (SUCCEED == ipc_service_pop_message(service, client, message))
 	{
-		if (NULL != (*message = (zbx_ipc_message_t *)zbx_queue_ptr_pop(&(*client)->rx_queue)))
-		{
-			if (SUCCEED == ZBX_CHECK_LOG_LEVEL(LOG_LEVEL_TRACE))
-			{
-				char	*data = NULL;
-
-				zbx_ipc_message_format(*message, &data);
-				zabbix_log(LOG_LEVEL_DEBUG, "%s() %s", __func__, data);
-
-				zbx_free(data);
-			}
-
-			ipc_service_push_client(service, *client);
-			zbx_ipc_client_addref(*client);
-		}
-
 		ret = (EVLOOP_NONBLOCK == flags ? ZBX_IPC_RECV_IMMEDIATE : ZBX_IPC_RECV_WAIT);
 	}
 	else
@@ -1658,6 +2610,57 @@ int	zbx_ipc_service_recv(zbx_ipc_service_t *service, const zbx_timespec_t *timeo
 	return ret;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: receives multiple ipc messages from connected clients             *
+ *                                                                            *
+ * Parameters: service      - [IN] the IPC service                            *
+ *             timeout      - [IN] the timeout to wait for the first message, *
+ *                                 see zbx_ipc_service_recv()                 *
+ *             clients      - [OUT] the clients that sent the messages, must  *
+ *                                  be released by caller with                *
+ *                                  zbx_ipc_client_release() function         *
+ *             messages     - [OUT] the received messages, NULL entries mark  *
+ *                                  closed client connections. The messages   *
+ *                                  must be freed by caller with              *
+ *                                  zbx_ipc_message_free() function.          *
+ *             messages_num - [IN/OUT] the size of clients and messages       *
+ *                                     arrays/the number of received messages *
+ *                                                                            *
+ * Return value: ZBX_IPC_RECV_IMMEDIATE - returned immediately without        *
+ *                                        waiting for socket events           *
+ *               ZBX_IPC_RECV_WAIT      - returned after receiving socket     *
+ *                                        event                               *
+ *               ZBX_IPC_RECV_TIMEOUT   - returned after timeout expired      *
+ *                                                                            *
+ * Comments: After the first message has been received the messages already   *
+ *           available are returned without waiting, so a service loop        *
+ *           handles all pending messages with a single wakeup.               *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_ipc_service_recv_batch(zbx_ipc_service_t *service, const zbx_timespec_t *timeout,
+		zbx_ipc_client_t **clients, zbx_ipc_message_t **messages, int *messages_num)
+{
+	int	ret, num = 1;
+
+	if (ZBX_IPC_RECV_TIMEOUT == (ret = zbx_ipc_service_recv(service, timeout, &clients[0], &messages[0])))
+	{
+		*messages_num = 0;
+		return ret;
+	}
+
+	/* collect data from sockets that became readable while processing the first event */
+	if (num < *messages_num && SUCCEED == zbx_queue_ptr_empty(&service->clients_recv))
+		event_base_loop(service->ev, EVLOOP_NONBLOCK);
+
+	while (num < *messages_num && SUCCEED == ipc_service_pop_message(service, &clients[num], &messages[num]))
+		num++;
+
+	*messages_num = num;
+
+	return ret;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: Sends IPC message to client                                       *
@@ -1783,7 +2786,9 @@ int	zbx_ipc_async_socket_open(zbx_ipc_async_socket_t *asocket, const char *servi
 	asocket->client = (zbx_ipc_client_t *)zbx_malloc(NULL, sizeof(zbx_ipc_client_t));
 	memset(asocket->client, 0, sizeof(zbx_ipc_client_t));
 
-	if (SUCCEED != zbx_ipc_socket_open(&asocket->client->csocket, service_name, timeout, error))
+	/* asynchronous sockets write directly to socket and do not support shared memory transport */
+	if (SUCCEED != ipc_socket_open(&asocket->client->csocket, service_name, timeout, ZBX_IPC_TRANSPORT_SOCKET,
+			error))
 	{
 		zbx_free(asocket->client);
 		goto out;
@@ -112,12 +112,94 @@ static void	__mem_free(zbx_mem_info_t *info, void *ptr);
 
 #define MEM_FLG_USED		((__UINT64_C(1))<<63)
 
+#define MEM_FLG_SLAB		((__UINT64_C(1))<<62)
+
 #define FREE_CHUNK(ptr)		(((*(zbx_uint64_t *)(ptr)) & MEM_FLG_USED) == 0)
 #define CHUNK_SIZE(ptr)		((*(zbx_uint64_t *)(ptr)) & ~MEM_FLG_USED)
 
+#define SLAB_OBJECT(ptr)	(((*(zbx_uint64_t *)(ptr)) & MEM_FLG_SLAB) != 0)
+#define SLAB_OBJECT_OFFSET(ptr)	((*(zbx_uint64_t *)(ptr)) & ~(MEM_FLG_USED | MEM_FLG_SLAB))
+
 #define MEM_MIN_SIZE		__UINT64_C(128)
 #define MEM_MAX_SIZE		__UINT64_C(0x1000000000)	/* 64 GB */
 
+#if defined(__linux__) && defined(SYS_mbind) && defined(SYS_get_mempolicy)
+#	define MEM_NUMA_SUPPORT
+#endif
+
+/* memory policy modes and flags, as defined in linux/mempolicy.h */
+#define MEM_MPOL_BIND		2
+#define MEM_MPOL_INTERLEAVE	3
+#define MEM_MPOL_F_NODE		(1 << 0)
+#define MEM_MPOL_F_ADDR		(1 << 1)
+
+#define MEM_NUMA_NODES_MAX	256
+#define MEM_NUMA_NODES_WORDS	(MEM_NUMA_NODES_MAX / (8 * sizeof(unsigned long)))
+
+typedef struct
+{
+	char		*param;		/* shared memory size parameter or "*" for all segments */
+	char		*nodes_str;
+	int		mode;
+	unsigned long	nodes[MEM_NUMA_NODES_WORDS];
+}
+zbx_mem_numa_policy_t;
+
+static int			mem_huge_pages = 0;
+static zbx_mem_numa_policy_t	*mem_numa_policies = NULL;
+static int			mem_numa_policies_num = 0;
+
+/******************************************************************************
+ *                                                                            *
+ *                         Some information on slabs                          *
+ *                       -----------------------------                        *
+ *                                                                            *
+ * When enabled with zbx_mem_use_slabs(), allocations of up to                *
+ * MEM_SLAB_MAX_SIZE bytes are served from slabs. Slab is a used chunk of     *
+ * MEM_SLAB_SIZE bytes divided into objects of the same size class. Classes   *
+ * go in 8 byte steps starting with MEM_MIN_ALLOC, like the free chunk        *
+ * buckets. Free objects are marked in slab bitmap, so objects are allocated  *
+ * and freed in constant time without searching and merging free chunks.      *
+ *                                                                            *
+ *   +------------------------- slab (used chunk) --------------------------+ *
+ *   |                                                                      | *
+ *   v                                                                      v *
+ *   |----|--- slab header ---|----|-object-|----|-object-|...|----|-object-| *
+ *                              ^                                             *
+ *                              |                                             *
+ *         object size field: MEM_FLG_USED | MEM_FLG_SLAB | offset in slab    *
+ *                                                                            *
+ * Slabs with free objects are kept in per class doubly-linked lists. Slab    *
+ * that becomes empty is freed unless it is the only one of its class with    *
+ * free objects. Larger allocations are done from free chunks as usual.       *
+ *                                                                            *
+ ******************************************************************************/
+
+#define MEM_SLAB_SIZE		(16 * ZBX_KIBIBYTE)
+#define MEM_SLAB_BITMAP_SIZE	(MEM_SLAB_SIZE / (MEM_MIN_ALLOC + MEM_SIZE_FIELD) / 64 + 1)
+
+typedef struct zbx_mem_slab
+{
+	struct zbx_mem_slab	*prev;
+	struct zbx_mem_slab	*next;
+	zbx_uint32_t		class_index;
+	zbx_uint32_t		used_num;
+	zbx_uint64_t		free_bits[MEM_SLAB_BITMAP_SIZE];	/* set bits mark free objects */
+}
+zbx_mem_slab_t;
+
+typedef struct
+{
+	zbx_mem_slab_t	*partial;	/* slabs with free objects */
+	zbx_uint32_t	object_size;	/* object size including size field */
+	zbx_uint32_t	objects_num;	/* number of objects in slab */
+	zbx_uint32_t	slabs_num;
+	zbx_uint32_t	used_num;
+}
+zbx_mem_slab_class_t;
+
+#define MEM_SLAB_OBJECTS_OFFSET	((sizeof(zbx_mem_slab_t) + 7) & ~(size_t)7)
+
 /* helper functions */
 
 static void	*ALIGN4(void *ptr)
@@ -524,13 +606,427 @@ static void	__mem_free(zbx_mem_info_t *info, void *ptr)
 	}
 }
 
+/* slab functions */
+
+static void	mem_slab_link(zbx_mem_slab_class_t *slab_class, zbx_mem_slab_t *slab)
+{
+	slab->prev = NULL;
+	slab->next = slab_class->partial;
+
+	if (NULL != slab_class->partial)
+		slab_class->partial->prev = slab;
+
+	slab_class->partial = slab;
+}
+
+static void	mem_slab_unlink(zbx_mem_slab_class_t *slab_class, zbx_mem_slab_t *slab)
+{
+	if (NULL != slab->prev)
+		slab->prev->next = slab->next;
+	else
+		slab_class->partial = slab->next;
+
+	if (NULL != slab->next)
+		slab->next->prev = slab->prev;
+}
+
+static void	mem_slabs_init(zbx_mem_info_t *info, void *slabs)
+{
+	int			i;
+	zbx_mem_slab_class_t	*slab_class;
+
+	info->slabs = slabs;
+
+	for (i = 0; i < MEM_SLAB_CLASS_COUNT; i++)
+	{
+		slab_class = (zbx_mem_slab_class_t *)info->slabs + i;
+
+		slab_class->partial = NULL;
+		slab_class->object_size = MEM_MIN_ALLOC + 8 * i + MEM_SIZE_FIELD;
+		slab_class->objects_num = (MEM_SLAB_SIZE - MEM_SLAB_OBJECTS_OFFSET) / slab_class->object_size;
+		slab_class->slabs_num = 0;
+		slab_class->used_num = 0;
+	}
+}
+
+static void	*mem_slab_malloc(zbx_mem_info_t *info, zbx_uint64_t size)
+{
+	zbx_uint32_t		index, i;
+	zbx_uint64_t		offset;
+	zbx_mem_slab_class_t	*slab_class;
+	zbx_mem_slab_t		*slab;
+	void			*chunk;
+
+	index = (zbx_uint32_t)((size - MEM_MIN_ALLOC) >> 3);
+	slab_class = (zbx_mem_slab_class_t *)info->slabs + index;
+
+	if (NULL == (slab = slab_class->partial))
+	{
+		if (NULL == (chunk = __mem_malloc(info, MEM_SLAB_SIZE)))
+			return NULL;
+
+		slab = (zbx_mem_slab_t *)((char *)chunk + MEM_SIZE_FIELD);
+		slab->class_index = index;
+		slab->used_num = 0;
+		memset(slab->free_bits, 0, sizeof(slab->free_bits));
+
+		for (i = 0; i < slab_class->objects_num; i++)
+			slab->free_bits[i >> 6] |= __UINT64_C(1) << (i & 63);
+
+		mem_slab_link(slab_class, slab);
+		slab_class->slabs_num++;
+	}
+
+	for (i = 0; 0 == slab->free_bits[i >> 6]; i += 64)
+		;
+
+	while (0 == (slab->free_bits[i >> 6] & (__UINT64_C(1) << (i & 63))))
+		i++;
+
+	slab->free_bits[i >> 6] &= ~(__UINT64_C(1) << (i & 63));
+
+	if (++slab->used_num == slab_class->objects_num)
+		mem_slab_unlink(slab_class, slab);
+
+	slab_class->used_num++;
+
+	offset = MEM_SLAB_OBJECTS_OFFSET + (zbx_uint64_t)i * slab_class->object_size;
+	chunk = (char *)slab + offset;
+	*(zbx_uint64_t *)chunk = MEM_FLG_USED | MEM_FLG_SLAB | offset;
+
+	return chunk;
+}
+
+static void	mem_slab_free(zbx_mem_info_t *info, void *chunk)
+{
+	zbx_uint32_t		i;
+	zbx_uint64_t		offset;
+	zbx_mem_slab_class_t	*slab_class;
+	zbx_mem_slab_t		*slab;
+
+	offset = SLAB_OBJECT_OFFSET(chunk);
+	slab = (zbx_mem_slab_t *)((char *)chunk - offset);
+	slab_class = (zbx_mem_slab_class_t *)info->slabs + slab->class_index;
+
+	i = (zbx_uint32_t)((offset - MEM_SLAB_OBJECTS_OFFSET) / slab_class->object_size);
+	slab->free_bits[i >> 6] |= __UINT64_C(1) << (i & 63);
+
+	if (slab->used_num-- == slab_class->objects_num)
+		mem_slab_link(slab_class, slab);
+
+	slab_class->used_num--;
+
+	/* keep the last slab with free objects to avoid allocating it again with the next object */
+	if (0 == slab->used_num && (NULL != slab->prev || NULL != slab->next))
+	{
+		mem_slab_unlink(slab_class, slab);
+		slab_class->slabs_num--;
+
+		__mem_free(info, slab);
+	}
+}
+
+static zbx_uint64_t	mem_slab_object_size(const zbx_mem_info_t *info, void *chunk)
+{
+	const zbx_mem_slab_t	*slab;
+
+	slab = (const zbx_mem_slab_t *)((char *)chunk - SLAB_OBJECT_OFFSET(chunk));
+
+	return ((const zbx_mem_slab_class_t *)info->slabs)[slab->class_index].object_size - MEM_SIZE_FIELD;
+}
+
+/* allocation functions choosing between slabs and free chunks */
+
+static void	*mem_malloc(zbx_mem_info_t *info, zbx_uint64_t size)
+{
+	void	*chunk;
+
+	size = mem_proper_alloc_size(size);
+
+	/* when no memory is left for new slab the object can still fit in a free chunk */
+	if (NULL != info->slabs && MEM_SLAB_MAX_SIZE >= size && NULL != (chunk = mem_slab_malloc(info, size)))
+		return chunk;
+
+	return __mem_malloc(info, size);
+}
+
+static void	*mem_realloc(zbx_mem_info_t *info, void *old, zbx_uint64_t size)
+{
+	void		*chunk, *new_chunk;
+	zbx_uint64_t	chunk_size;
+
+	chunk = (void *)((char *)old - MEM_SIZE_FIELD);
+
+	if (!SLAB_OBJECT(chunk))
+		return __mem_realloc(info, old, size);
+
+	chunk_size = mem_slab_object_size(info, chunk);
+
+	/* do not reallocate if not much is freed, same as with chunks */
+	if (size <= chunk_size && size > chunk_size / 4)
+		return chunk;
+
+	if (NULL == (new_chunk = mem_malloc(info, size)))
+		return NULL;
+
+	memcpy((char *)new_chunk + MEM_SIZE_FIELD, old, MIN(chunk_size, size));
+	mem_slab_free(info, chunk);
+
+	return new_chunk;
+}
+
+static void	mem_free(zbx_mem_info_t *info, void *ptr)
+{
+	void	*chunk;
+
+	chunk = (void *)((char *)ptr - MEM_SIZE_FIELD);
+
+	if (SLAB_OBJECT(chunk))
+		mem_slab_free(info, chunk);
+	else
+		__mem_free(info, ptr);
+}
+
+/* huge page and NUMA policy functions */
+
+#if defined(SHM_HUGETLB)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets default huge page size                                       *
+ *                                                                            *
+ * Return value: huge page size in bytes or 0 if huge pages are not available *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_uint64_t	mem_get_huge_page_size(void)
+{
+	FILE		*f;
+	char		line[MAX_STRING_LEN];
+	zbx_uint64_t	size = 0;
+
+	if (NULL == (f = fopen("/proc/meminfo", "r")))
+		return 0;
+
+	while (NULL != fgets(line, sizeof(line), f))
+	{
+		if (1 == sscanf(line, "Hugepagesize: " ZBX_FS_UI64 " kB", &size))
+		{
+			size *= ZBX_KIBIBYTE;
+			break;
+		}
+	}
+
+	zbx_fclose(f);
+
+	return size;
+}
+#endif
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: parses NUMA node list                                             *
+ *                                                                            *
+ * Parameters: str   - [IN] comma separated node numbers and ranges, for      *
+ *                          example "0-3,6"                                   *
+ *             nodes - [OUT] the node mask                                    *
+ *                                                                            *
+ * Return value: SUCCEED - the node list was parsed successfully              *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	mem_parse_numa_nodes(const char *str, unsigned long *nodes)
+{
+	const char	*ptr = str;
+	char		*end;
+	unsigned long	from, to, node;
+
+	memset(nodes, 0, MEM_NUMA_NODES_WORDS * sizeof(unsigned long));
+
+	do
+	{
+		if (0 == isdigit((unsigned char)*ptr))
+			return FAIL;
+
+		from = to = strtoul(ptr, &end, 10);
+
+		if ('-' == *end)
+		{
+			if (0 == isdigit((unsigned char)end[1]))
+				return FAIL;
+
+			to = strtoul(end + 1, &end, 10);
+		}
+
+		if (from > to || MEM_NUMA_NODES_MAX <= to)
+			return FAIL;
+
+		for (node = from; node <= to; node++)
+			nodes[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+
+		ptr = end + 1;
+	}
+	while (',' == *end);
+
+	return '\0' == *end ? SUCCEED : FAIL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: finds NUMA policy of shared memory segment                        *
+ *                                                                            *
+ * Parameters: param - [IN] the segment size configuration parameter          *
+ *                                                                            *
+ * Return value: the policy or NULL if the default policy must be used        *
+ *                                                                            *
+ ******************************************************************************/
+static const zbx_mem_numa_policy_t	*mem_get_numa_policy(const char *param)
+{
+	int				i;
+	const zbx_mem_numa_policy_t	*policy = NULL;
+
+	for (i = 0; i < mem_numa_policies_num; i++)
+	{
+		if (0 == strcmp(mem_numa_policies[i].param, param))
+			return &mem_numa_policies[i];
+
+		if (0 == strcmp(mem_numa_policies[i].param, "*"))
+			policy = &mem_numa_policies[i];
+	}
+
+	return policy;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: applies NUMA policy to shared memory segment                      *
+ *                                                                            *
+ * Parameters: base   - [IN] the segment address                              *
+ *             size   - [IN] the segment size                                 *
+ *             descr  - [IN] the segment description                          *
+ *             policy - [IN] the policy                                       *
+ *                                                                            *
+ * Comments: The policy must be applied before the segment pages are touched, *
+ *           otherwise the already touched pages stay where they are.         *
+ *                                                                            *
+ ******************************************************************************/
+static void	mem_set_numa_policy(void *base, zbx_uint64_t size, const char *descr,
+		const zbx_mem_numa_policy_t *policy)
+{
+#if defined(MEM_NUMA_SUPPORT)
+	if (0 != syscall(SYS_mbind, base, (unsigned long)size, policy->mode, policy->nodes,
+			(unsigned long)MEM_NUMA_NODES_MAX + 1, 0U))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot set NUMA policy of %s: %s", descr, zbx_strerror(errno));
+	}
+#else
+	ZBX_UNUSED(base);
+	ZBX_UNUSED(size);
+	ZBX_UNUSED(descr);
+	ZBX_UNUSED(policy);
+#endif
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets NUMA node of the memory page                                 *
+ *                                                                            *
+ * Parameters: ptr - [IN] address within an already touched page              *
+ *                                                                            *
+ * Return value: the node number or -1 if it cannot be determined             *
+ *                                                                            *
+ ******************************************************************************/
+static int	mem_get_numa_node(void *ptr)
+{
+#if defined(MEM_NUMA_SUPPORT)
+	int	node;
+
+	if (0 != syscall(SYS_get_mempolicy, &node, NULL, 0UL, ptr, (unsigned long)(MEM_MPOL_F_NODE | MEM_MPOL_F_ADDR)))
+		return -1;
+
+	return node;
+#else
+	ZBX_UNUSED(ptr);
+
+	return -1;
+#endif
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: sets page size and NUMA placement policies of shared memory       *
+ *          segments created later                                            *
+ *                                                                            *
+ * Parameters: huge_pages    - [IN] 1 - try to allocate segments with huge    *
+ *                                      pages, 0 - use regular pages          *
+ *             numa_policies - [IN] NULL terminated list of policies in       *
+ *                                  format <parameter>:<mode>:<nodes>         *
+ *             error         - [OUT] the error message                        *
+ *                                                                            *
+ * Return value: SUCCEED - the policies were set                              *
+ *               FAIL    - invalid policy or not supported on this platform   *
+ *                                                                            *
+ * Comments: The policies are kept in process memory and must be set in the   *
+ *           main process before shared memory segments are created.          *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_mem_set_policies(int huge_pages, char **numa_policies, char **error)
+{
+	char			**ptr;
+	zbx_mem_numa_policy_t	*policy;
+
+#if !defined(SHM_HUGETLB)
+	if (0 != huge_pages)
+	{
+		*error = zbx_strdup(*error, "huge pages are not supported on this platform");
+		return FAIL;
+	}
+#endif
+	mem_huge_pages = huge_pages;
+
+	for (ptr = numa_policies; NULL != ptr && NULL != *ptr; ptr++)
+	{
+		char	*mode, *nodes;
+
+#if !defined(MEM_NUMA_SUPPORT)
+		*error = zbx_strdup(*error, "NUMA policies are not supported on this platform");
+		return FAIL;
+#endif
+		if (NULL == (mode = strchr(*ptr, ':')) || NULL == (nodes = strchr(mode + 1, ':')))
+			goto fail;
+
+		mem_numa_policies = (zbx_mem_numa_policy_t *)zbx_realloc(mem_numa_policies,
+				sizeof(zbx_mem_numa_policy_t) * (size_t)(mem_numa_policies_num + 1));
+		policy = &mem_numa_policies[mem_numa_policies_num];
+
+		if (0 == strncmp(mode + 1, "interleave:", ZBX_CONST_STRLEN("interleave:")))
+			policy->mode = MEM_MPOL_INTERLEAVE;
+		else if (0 == strncmp(mode + 1, "bind:", ZBX_CONST_STRLEN("bind:")))
+			policy->mode = MEM_MPOL_BIND;
+		else
+			goto fail;
+
+		if (mode == *ptr || SUCCEED != mem_parse_numa_nodes(nodes + 1, policy->nodes))
+			goto fail;
+
+		policy->param = zbx_dsprintf(NULL, "%.*s", (int)(mode - *ptr), *ptr);
+		policy->nodes_str = zbx_strdup(NULL, nodes + 1);
+		mem_numa_policies_num++;
+	}
+
+	return SUCCEED;
+fail:
+	*error = zbx_dsprintf(*error, "invalid NUMA policy \"%s\"", *ptr);
+	return FAIL;
+}
+
 /* public memory interface */
 
 int	zbx_mem_create(zbx_mem_info_t **info, zbx_uint64_t size, const char *descr, const char *param, int allow_oom,
 		char **error)
 {
-	int	shm_id, index, ret = FAIL;
-	void	*base;
+	int				shm_id = -1, index, ret = FAIL;
+	void				*base;
+	zbx_uint64_t			shm_size = size, page_size = 0;
+	const zbx_mem_numa_policy_t	*policy;
 
 	descr = ZBX_NULL2STR(descr);
 	param = ZBX_NULL2STR(param);
@@ -553,11 +1049,30 @@ int	zbx_mem_create(zbx_mem_info_t **info, zbx_uint64_t size, const char *descr,
 		goto out;
 	}
 
-	if (-1 == (shm_id = shmget(IPC_PRIVATE, size, 0600)))
+#if defined(SHM_HUGETLB)
+	if (0 != mem_huge_pages && 0 != (page_size = mem_get_huge_page_size()))
 	{
-		*error = zbx_dsprintf(*error, "cannot get private shared memory of size " ZBX_FS_SIZE_T " for %s: %s",
-				(zbx_fs_size_t)size, descr, zbx_strerror(errno));
-		goto out;
+		shm_size = (size + page_size - 1) / page_size * page_size;
+
+		if (-1 == (shm_id = shmget(IPC_PRIVATE, shm_size, 0600 | SHM_HUGETLB)))
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "cannot get huge page backed shared memory of size " ZBX_FS_UI64
+					" for %s: %s, falling back to regular pages", shm_size, descr,
+					zbx_strerror(errno));
+			shm_size = size;
+		}
+	}
+#endif
+	if (-1 == shm_id)
+	{
+		page_size = (zbx_uint64_t)sysconf(_SC_PAGESIZE);
+
+		if (-1 == (shm_id = shmget(IPC_PRIVATE, size, 0600)))
+		{
+			*error = zbx_dsprintf(*error, "cannot get private shared memory of size " ZBX_FS_SIZE_T
+					" for %s: %s", (zbx_fs_size_t)size, descr, zbx_strerror(errno));
+			goto out;
+		}
 	}
 
 	if ((void *)(-1) == (base = shmat(shm_id, NULL, 0)))
@@ -569,6 +1084,9 @@ int	zbx_mem_create(zbx_mem_info_t **info, zbx_uint64_t size, const char *descr,
 	if (-1 == shmctl(shm_id, IPC_RMID, NULL))
 		zbx_error("cannot mark shared memory %d for destruction: %s", shm_id, zbx_strerror(errno));
 
+	if (NULL != (policy = mem_get_numa_policy(param)))
+		mem_set_numa_policy(base, shm_size, descr, policy);
+
 	ret = SUCCEED;
 
 	/* allocate zbx_mem_info_t structure, its buckets, and description inside shared memory */
@@ -581,6 +1099,7 @@ int	zbx_mem_create(zbx_mem_info_t **info, zbx_uint64_t size, const char *descr,
 
 	base = (void *)(*info + 1);
 
+	(*info)->slabs = NULL;
 	(*info)->buckets = (void **)ALIGNPTR(base);
 	memset((*info)->buckets, 0, MEM_BUCKET_COUNT * ZBX_PTR_SIZE);
 	size -= (char *)((*info)->buckets + MEM_BUCKET_COUNT) - (char *)base;
@@ -618,6 +1137,15 @@ int	zbx_mem_create(zbx_mem_info_t **info, zbx_uint64_t size, const char *descr,
 			(void *)((char *)(*info)->lo_bound + MEM_SIZE_FIELD),
 			(void *)((char *)(*info)->hi_bound - MEM_SIZE_FIELD),
 			(zbx_fs_size_t)(*info)->total_size);
+
+	if (0 != mem_huge_pages || NULL != policy)
+	{
+		zabbix_log(LOG_LEVEL_INFORMATION, "%s: " ZBX_FS_UI64 " bytes in " ZBX_FS_UI64 " kB pages, NUMA policy:"
+				" %s%s%s, first page on node %d", descr, shm_size, page_size / ZBX_KIBIBYTE,
+				NULL == policy ? "default" : (MEM_MPOL_BIND == policy->mode ? "bind" : "interleave"),
+				NULL == policy ? "" : " nodes ", NULL == policy ? "" : policy->nodes_str,
+				mem_get_numa_node((*info)->base));
+	}
 out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 
@@ -629,6 +1157,31 @@ void	zbx_mem_destroy(zbx_mem_info_t *info)
 	(void)shmdt(info->base);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: serve small allocations from slabs                                *
+ *                                                                            *
+ * Parameters: info - [IN] the shared memory                                  *
+ *                                                                            *
+ * Comments: Must be called right after the shared memory is created.         *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_mem_use_slabs(zbx_mem_info_t *info)
+{
+	void	*chunk;
+
+	if (NULL != info->slabs)
+		return;
+
+	if (NULL == (chunk = __mem_malloc(info, sizeof(zbx_mem_slab_class_t) * MEM_SLAB_CLASS_COUNT)))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot use slabs for %s: out of memory", info->mem_descr);
+		return;
+	}
+
+	mem_slabs_init(info, (char *)chunk + MEM_SIZE_FIELD);
+}
+
 void	*__zbx_mem_malloc(const char *file, int line, zbx_mem_info_t *info, const void *old, size_t size)
 {
 	void	*chunk;
@@ -647,7 +1200,7 @@ void	*__zbx_mem_malloc(const char *file, int line, zbx_mem_info_t *info, const v
 		exit(EXIT_FAILURE);
 	}
 
-	chunk = __mem_malloc(info, size);
+	chunk = mem_malloc(info, size);
 
 	if (NULL == chunk)
 	{
@@ -680,9 +1233,9 @@ void	*__zbx_mem_realloc(const char *file, int line, zbx_mem_info_t *info, void *
 	}
 
 	if (NULL == old)
-		chunk = __mem_malloc(info, size);
+		chunk = mem_malloc(info, size);
 	else
-		chunk = __mem_realloc(info, old, size);
+		chunk = mem_realloc(info, old, size);
 
 	if (NULL == chunk)
 	{
@@ -711,7 +1264,7 @@ void	__zbx_mem_free(const char *file, int line, zbx_mem_info_t *info, void *ptr)
 		exit(EXIT_FAILURE);
 	}
 
-	__mem_free(info, ptr);
+	mem_free(info, ptr);
 }
 
 void	zbx_mem_clear(zbx_mem_info_t *info)
@@ -729,6 +1282,12 @@ void	zbx_mem_clear(zbx_mem_info_t *info)
 	info->used_size = 0;
 	info->free_size = info->total_size;
 
+	if (NULL != info->slabs)
+	{
+		info->slabs = NULL;
+		zbx_mem_use_slabs(info);
+	}
+
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
@@ -763,6 +1322,33 @@ void	zbx_mem_get_stats(const zbx_mem_info_t *info, zbx_mem_stats_t *stats)
 	stats->used_chunks = stats->overhead / (2 * MEM_SIZE_FIELD) + 1 - stats->free_chunks;
 	stats->free_size = info->free_size;
 	stats->used_size = info->used_size;
+	stats->fragmented_size = (0 != stats->free_chunks ? stats->free_size - stats->max_chunk_size : 0);
+
+	stats->slabs_size = 0;
+	stats->slabs_free_size = 0;
+
+	for (i = 0; i < MEM_SLAB_CLASS_COUNT; i++)
+	{
+		const zbx_mem_slab_class_t	*slab_class;
+
+		if (NULL == info->slabs)
+		{
+			stats->slabs_num[i] = 0;
+			stats->slab_objects_num[i] = 0;
+			stats->slab_objects_used[i] = 0;
+			continue;
+		}
+
+		slab_class = (const zbx_mem_slab_class_t *)info->slabs + i;
+
+		stats->slabs_num[i] = slab_class->slabs_num;
+		stats->slab_objects_num[i] = slab_class->slabs_num * slab_class->objects_num;
+		stats->slab_objects_used[i] = slab_class->used_num;
+
+		stats->slabs_size += (zbx_uint64_t)slab_class->slabs_num * MEM_SLAB_SIZE;
+		stats->slabs_free_size += (zbx_uint64_t)(stats->slab_objects_num[i] - slab_class->used_num) *
+				(slab_class->object_size - MEM_SIZE_FIELD);
+	}
 }
 
 void	zbx_mem_dump_stats(int level, zbx_mem_info_t *info)
@@ -796,6 +1382,22 @@ void	zbx_mem_dump_stats(int level, zbx_mem_info_t *info)
 	zabbix_log(level, "of those, %10llu bytes are used by allocation overhead",
 			(unsigned long long)stats.overhead);
 
+	if (NULL != info->slabs)
+	{
+		zabbix_log(level, "slabs take %llu bytes, of those %llu bytes are free",
+				(unsigned long long)stats.slabs_size, (unsigned long long)stats.slabs_free_size);
+
+		for (i = 0; i < MEM_SLAB_CLASS_COUNT; i++)
+		{
+			if (0 == stats.slabs_num[i])
+				continue;
+
+			zabbix_log(level, "slab objects of size %3d bytes: %8u used of %8u in %6u slabs",
+					MEM_MIN_ALLOC + 8 * i, stats.slab_objects_used[i], stats.slab_objects_num[i],
+					stats.slabs_num[i]);
+		}
+	}
+
 	zabbix_log(level, "================================");
 }
 
@@ -125,6 +125,9 @@ extern int	CONFIG_SERVICEMAN_FORKS;
 extern int	CONFIG_TRIGGERHOUSEKEEPER_FORKS;
 extern int	CONFIG_ODBCPOLLER_FORKS;
 extern int	CONFIG_HAMANAGER_FORKS;
+extern int	CONFIG_AGENTPOLLER_FORKS;
+extern int	CONFIG_HTTPAGENT_POLLER_FORKS;
+extern int	CONFIG_SNMPPOLLER_FORKS;
 
 extern ZBX_THREAD_LOCAL unsigned char	process_type;
 extern ZBX_THREAD_LOCAL int		process_num;
@@ -216,6 +219,12 @@ int	get_process_type_forks(unsigned char proc_type)
 			return CONFIG_ODBCPOLLER_FORKS;
 		case ZBX_PROCESS_TYPE_HA_MANAGER:
 			return CONFIG_HAMANAGER_FORKS;
+		case ZBX_PROCESS_TYPE_AGENT_POLLER:
+			return CONFIG_AGENTPOLLER_FORKS;
+		case ZBX_PROCESS_TYPE_HTTPAGENT_POLLER:
+			return CONFIG_HTTPAGENT_POLLER_FORKS;
+		case ZBX_PROCESS_TYPE_SNMP_POLLER:
+			return CONFIG_SNMPPOLLER_FORKS;
 	}
 
 	return get_component_process_type_forks(proc_type);
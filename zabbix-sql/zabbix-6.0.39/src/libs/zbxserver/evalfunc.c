@@ -688,27 +688,29 @@ out:
  *             parameters - [IN] the parameter string with #sec|num/timeshift *
  *                          in first parameter                                *
  *             ts         - [IN] the starting timestamp                       *
+ *             cursor     - [OUT] the value cursor referencing the value      *
  *             value      - [OUT] the Nth value                               *
  *             error      - [OUT] the error message                           *
  *                                                                            *
- * Return value: SUCCEED - value was found successfully copied                *
+ * Return value: SUCCEED - value was found                                    *
  *               FAIL    - otherwise                                          *
  *                                                                            *
+ * Comments: The value is not copied and stays valid until the cursor is      *
+ *           closed with zbx_vc_cursor_close(). The cursor must be closed by  *
+ *           the caller only if the value was found.                          *
+ *                                                                            *
  ******************************************************************************/
 static int	get_last_n_value(const DC_EVALUATE_ITEM *item, const char *parameters, const zbx_timespec_t *ts,
-		zbx_history_record_t *value, char **error)
+		zbx_vc_cursor_t *cursor, const history_value_t **value, char **error)
 {
-	int				arg1 = 1, ret = FAIL, time_shift;
-	zbx_value_type_t		arg1_type = ZBX_VALUE_NVALUES;
-	zbx_vector_history_record_t	values;
-	zbx_timespec_t			ts_end = *ts;
-
-	zbx_history_record_vector_create(&values);
+	int			arg1 = 1, ret = FAIL, time_shift;
+	zbx_value_type_t	arg1_type = ZBX_VALUE_NVALUES;
+	zbx_timespec_t		ts_end = *ts;
 
 	if (SUCCEED != get_function_parameter_hist_range(ts->sec, parameters, 1, &arg1, &arg1_type, &time_shift))
 	{
 		*error = zbx_strdup(*error, "invalid second parameter");
-		goto out;
+		return FAIL;
 	}
 
 	if (ZBX_VALUE_NVALUES != arg1_type)
@@ -716,22 +718,24 @@ static int	get_last_n_value(const DC_EVALUATE_ITEM *item, const char *parameters
 
 	ts_end.sec -= time_shift;
 
-	if (SUCCEED != zbx_vc_get_values(item->itemid, item->value_type, &values, 0, arg1, &ts_end))
+	if (SUCCEED != zbx_vc_cursor_open(cursor, item->itemid, item->value_type, 0, arg1, &ts_end))
 	{
 		*error = zbx_strdup(*error, "cannot get values from value cache");
 		goto out;
 	}
 
-	if (arg1 <= values.values_num)
+	if (arg1 <= cursor->values_num)
 	{
-		*value = values.values[arg1 - 1];
-		zbx_vector_history_record_remove(&values, arg1 - 1);
+		while (0 < arg1-- && SUCCEED == zbx_vc_cursor_next(cursor, NULL, value))
+			;
+
 		ret = SUCCEED;
 	}
 	else
 		*error = zbx_strdup(*error, "not enough data");
 out:
-	zbx_history_record_vector_destroy(&values, item->value_type);
+	if (SUCCEED != ret)
+		zbx_vc_cursor_close(cursor);
 
 	return ret;
 }
@@ -756,7 +760,8 @@ static int	evaluate_LOGEVENTID(zbx_variant_t *value, DC_EVALUATE_ITEM *item, con
 	char			*pattern = NULL;
 	int			ret = FAIL, nparams;
 	zbx_vector_ptr_t	regexps;
-	zbx_history_record_t	vc_value;
+	zbx_vc_cursor_t		cursor;
+	const history_value_t	*vc_value;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -797,12 +802,12 @@ static int	evaluate_LOGEVENTID(zbx_variant_t *value, DC_EVALUATE_ITEM *item, con
 	else
 		pattern = zbx_strdup(NULL, "");
 
-	if (SUCCEED == get_last_n_value(item, parameters, ts, &vc_value, error))
+	if (SUCCEED == get_last_n_value(item, parameters, ts, &cursor, &vc_value, error))
 	{
 		char	logeventid[16];
 		int	regexp_ret;
 
-		zbx_snprintf(logeventid, sizeof(logeventid), "%d", vc_value.value.log->logeventid);
+		zbx_snprintf(logeventid, sizeof(logeventid), "%d", vc_value->log->logeventid);
 
 		if (FAIL == (regexp_ret = regexp_match_ex(&regexps, logeventid, pattern, ZBX_CASE_SENSITIVE)))
 		{
@@ -818,7 +823,7 @@ static int	evaluate_LOGEVENTID(zbx_variant_t *value, DC_EVALUATE_ITEM *item, con
 			ret = SUCCEED;
 		}
 
-		zbx_history_record_clear(&vc_value, item->value_type);
+		zbx_vc_cursor_close(&cursor);
 	}
 	else
 		zabbix_log(LOG_LEVEL_DEBUG, "result for LOGEVENTID is empty");
@@ -853,7 +858,8 @@ static int	evaluate_LOGSOURCE(zbx_variant_t *value, DC_EVALUATE_ITEM *item, cons
 	char			*pattern = NULL;
 	int			ret = FAIL, nparams;
 	zbx_vector_ptr_t	regexps;
-	zbx_history_record_t	vc_value;
+	zbx_vc_cursor_t		cursor;
+	const history_value_t	*vc_value;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -894,9 +900,9 @@ static int	evaluate_LOGSOURCE(zbx_variant_t *value, DC_EVALUATE_ITEM *item, cons
 	else
 		pattern = zbx_strdup(NULL, "");
 
-	if (SUCCEED == get_last_n_value(item, parameters, ts, &vc_value, error))
+	if (SUCCEED == get_last_n_value(item, parameters, ts, &cursor, &vc_value, error))
 	{
-		switch (regexp_match_ex(&regexps, vc_value.value.log->source, pattern, ZBX_CASE_SENSITIVE))
+		switch (regexp_match_ex(&regexps, vc_value->log->source, pattern, ZBX_CASE_SENSITIVE))
 		{
 			case ZBX_REGEXP_MATCH:
 				zbx_variant_set_dbl(value, 1);
@@ -910,7 +916,7 @@ static int	evaluate_LOGSOURCE(zbx_variant_t *value, DC_EVALUATE_ITEM *item, cons
 				*error = zbx_dsprintf(*error, "invalid regular expression");
 		}
 
-		zbx_history_record_clear(&vc_value, item->value_type);
+		zbx_vc_cursor_close(&cursor);
 	}
 	else
 		zabbix_log(LOG_LEVEL_DEBUG, "result for LOGSOURCE is empty");
@@ -943,7 +949,8 @@ static int	evaluate_LOGSEVERITY(zbx_variant_t *value, DC_EVALUATE_ITEM *item, co
 		const zbx_timespec_t *ts, char **error)
 {
 	int			ret = FAIL;
-	zbx_history_record_t	vc_value;
+	zbx_vc_cursor_t		cursor;
+	const history_value_t	*vc_value;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -959,10 +966,10 @@ static int	evaluate_LOGSEVERITY(zbx_variant_t *value, DC_EVALUATE_ITEM *item, co
 		goto out;
 	}
 
-	if (SUCCEED == get_last_n_value(item, parameters, ts, &vc_value, error))
+	if (SUCCEED == get_last_n_value(item, parameters, ts, &cursor, &vc_value, error))
 	{
-		zbx_variant_set_dbl(value, vc_value.value.log->severity);
-		zbx_history_record_clear(&vc_value, item->value_type);
+		zbx_variant_set_dbl(value, vc_value->log->severity);
+		zbx_vc_cursor_close(&cursor);
 
 		ret = SUCCEED;
 	}
@@ -1137,6 +1144,40 @@ static void	count_one_dbl(int *count, int op, double value, double pattern)
 	}
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: converts numeric count() operator to value cache aggregate        *
+ *          filter operator                                                   *
+ *                                                                            *
+ * Parameters: op - [IN] the count() operator (OP_* defines)                  *
+ *                                                                            *
+ * Return value: the value cache filter operator (ZBX_VC_AGGR_OP_* defines)   *
+ *               or FAIL if the operator is not supported                     *
+ *                                                                            *
+ ******************************************************************************/
+static int	count_op_to_vc_aggr_op(int op)
+{
+	switch (op)
+	{
+		case OP_EQ:
+			return ZBX_VC_AGGR_OP_EQ;
+		case OP_NE:
+			return ZBX_VC_AGGR_OP_NE;
+		case OP_GT:
+			return ZBX_VC_AGGR_OP_GT;
+		case OP_GE:
+			return ZBX_VC_AGGR_OP_GE;
+		case OP_LT:
+			return ZBX_VC_AGGR_OP_LT;
+		case OP_LE:
+			return ZBX_VC_AGGR_OP_LE;
+		case OP_BITAND:
+			return ZBX_VC_AGGR_OP_BITAND;
+		default:
+			return FAIL;
+	}
+}
+
 static void	count_one_str(int *count, int op, const char *value, const char *pattern, zbx_vector_ptr_t *regexps)
 {
 	int	res;
@@ -1169,6 +1210,62 @@ static void	count_one_str(int *count, int op, const char *value, const char *pat
 	}
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: matches one history value for count() function                    *
+ *                                                                            *
+ * Parameters: count          - [IN/OUT] the number of matching values, FAIL  *
+ *                                       if regular expression is invalid     *
+ *             value_type     - [IN] the item value type                      *
+ *             op             - [IN] the count() operator (OP_* defines)      *
+ *             numeric_search - [IN] non-zero if numeric values are compared  *
+ *                                   as numbers                               *
+ *             value          - [IN] the value to match                       *
+ *             pattern_ui64   - [IN] the unsigned pattern                     *
+ *             mask_ui64      - [IN] the unsigned bit mask (OP_BITAND)        *
+ *             pattern_dbl    - [IN] the float pattern                        *
+ *             pattern        - [IN] the string pattern                       *
+ *             regexps        - [IN] the global regular expressions           *
+ *                                                                            *
+ ******************************************************************************/
+static void	count_one_value(int *count, unsigned char value_type, int op, int numeric_search,
+		const history_value_t *value, zbx_uint64_t pattern_ui64, zbx_uint64_t mask_ui64, double pattern_dbl,
+		const char *pattern, zbx_vector_ptr_t *regexps)
+{
+	char	buf[ZBX_MAX_UINT64_LEN];
+
+	switch (value_type)
+	{
+		case ITEM_VALUE_TYPE_UINT64:
+			if (0 != numeric_search)
+			{
+				count_one_ui64(count, op, value->ui64, pattern_ui64, mask_ui64);
+			}
+			else
+			{
+				zbx_snprintf(buf, sizeof(buf), ZBX_FS_UI64, value->ui64);
+				count_one_str(count, op, buf, pattern, regexps);
+			}
+			break;
+		case ITEM_VALUE_TYPE_FLOAT:
+			if (0 != numeric_search)
+			{
+				count_one_dbl(count, op, value->dbl, pattern_dbl);
+			}
+			else
+			{
+				zbx_snprintf(buf, sizeof(buf), ZBX_FS_DBL_EXT(4), value->dbl);
+				count_one_str(count, op, buf, pattern, regexps);
+			}
+			break;
+		case ITEM_VALUE_TYPE_LOG:
+			count_one_str(count, op, value->log->value, pattern, regexps);
+			break;
+		default:
+			count_one_str(count, op, value->str, pattern, regexps);
+	}
+}
+
 /* flags for evaluate_COUNT() */
 #define COUNT_ALL	0
 #define COUNT_UNIQUE	1
@@ -1204,14 +1301,16 @@ static int	evaluate_COUNT(zbx_variant_t *value, DC_EVALUATE_ITEM *item, const ch
 		const zbx_timespec_t *ts, int limit, int unique, char **error)
 {
 	int				arg1, op = OP_UNKNOWN, numeric_search, nparams, count = 0, i, ret = FAIL;
-	int				seconds = 0, nvalues = 0, time_shift;
-	char				*operator = NULL, *pattern2 = NULL, *pattern = NULL, buf[ZBX_MAX_UINT64_LEN];
-	double				arg3_dbl;
+	int				seconds = 0, nvalues = 0, time_shift, match_values;
+	char				*operator = NULL, *pattern2 = NULL, *pattern = NULL;
+	double				arg3_dbl = 0;
 	zbx_uint64_t			pattern_ui64, pattern2_ui64;
 	zbx_value_type_t		arg1_type;
 	zbx_vector_ptr_t		regexps;
 	zbx_vector_history_record_t	values;
 	zbx_timespec_t			ts_end = *ts;
+	zbx_vc_aggr_t			aggr;
+	zbx_vc_cursor_t			cursor;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -1391,14 +1490,75 @@ static int	evaluate_COUNT(zbx_variant_t *value, DC_EVALUATE_ITEM *item, const ch
 			THIS_SHOULD_NEVER_HAPPEN;
 	}
 
-	if (FAIL == zbx_vc_get_values(item->itemid, item->value_type, &values, seconds, nvalues, &ts_end))
+	/* values are counted one by one unless both pattern and operator are empty or "" is searched in text values */
+	match_values = ((NULL != pattern && '\0' != *pattern) || (NULL != operator && '\0' != *operator &&
+			OP_LIKE != op && OP_REGEXP != op && OP_IREGEXP != op));
+
+	/* numeric values are matched by value cache aggregates without copying them */
+	if (COUNT_ALL == unique && (0 == match_values || 0 != numeric_search))
 	{
-		*error = zbx_strdup(*error, "cannot get values from value cache");
-		goto out;
+		aggr.flags = 0;
+
+		if (0 != match_values)
+		{
+			aggr.flags = ZBX_VC_AGGR_COUNT;
+			aggr.op = count_op_to_vc_aggr_op(op);
+
+			if (ITEM_VALUE_TYPE_UINT64 == item->value_type)
+			{
+				aggr.pattern.ui64 = pattern_ui64;
+				aggr.mask = pattern2_ui64;
+			}
+			else
+				aggr.pattern.dbl = arg3_dbl;
+		}
+
+		if ((0 == match_values || FAIL != aggr.op) && SUCCEED == zbx_vc_get_aggregate(item->itemid,
+				item->value_type, seconds, nvalues, &ts_end, &aggr))
+		{
+			if ((count = (0 != match_values ? aggr.count : aggr.values_num)) > limit)
+				count = limit;
+
+			zbx_variant_set_dbl(value, count);
+			ret = SUCCEED;
+			goto out;
+		}
 	}
 
-	if (COUNT_UNIQUE == unique)
+	if (COUNT_ALL == unique)
+	{
+		/* values are matched in place, without copying them from value cache */
+		if (SUCCEED != zbx_vc_cursor_open(&cursor, item->itemid, item->value_type, seconds, nvalues, &ts_end))
+		{
+			zbx_vc_cursor_close(&cursor);
+			*error = zbx_strdup(*error, "cannot get values from value cache");
+			goto out;
+		}
+
+		if (0 != match_values)
+		{
+			const history_value_t	*history_value;
+
+			while (FAIL != count && count < limit &&
+					SUCCEED == zbx_vc_cursor_next(&cursor, NULL, &history_value))
+			{
+				count_one_value(&count, item->value_type, op, numeric_search, history_value, pattern_ui64,
+						pattern2_ui64, arg3_dbl, pattern, &regexps);
+			}
+		}
+		else
+			count = cursor.values_num;
+
+		zbx_vc_cursor_close(&cursor);
+	}
+	else
 	{
+		if (FAIL == zbx_vc_get_values(item->itemid, item->value_type, &values, seconds, nvalues, &ts_end))
+		{
+			*error = zbx_strdup(*error, "cannot get values from value cache");
+			goto out;
+		}
+
 		switch (item->value_type)
 		{
 			case ITEM_VALUE_TYPE_UINT64:
@@ -1425,70 +1585,28 @@ static int	evaluate_COUNT(zbx_variant_t *value, DC_EVALUATE_ITEM *item, const ch
 				zbx_vector_history_record_str_uniq(&values,
 						(zbx_compare_func_t)history_record_str_compare);
 		}
-	}
-
-	/* skip counting values one by one if both pattern and operator are empty or "" is searched in text values */
-	if ((NULL != pattern && '\0' != *pattern) || (NULL != operator && '\0' != *operator &&
-			OP_LIKE != op && OP_REGEXP != op && OP_IREGEXP != op))
-	{
-		switch (item->value_type)
-		{
-			case ITEM_VALUE_TYPE_UINT64:
-				if (0 != numeric_search)
-				{
-					for (i = 0; i < values.values_num && count < limit; i++)
-					{
-						count_one_ui64(&count, op, values.values[i].value.ui64, pattern_ui64,
-								pattern2_ui64);
-					}
-				}
-				else
-				{
-					for (i = 0; i < values.values_num && FAIL != count && count < limit; i++)
-					{
-						zbx_snprintf(buf, sizeof(buf), ZBX_FS_UI64,
-								values.values[i].value.ui64);
-						count_one_str(&count, op, buf, pattern, &regexps);
-					}
-				}
-				break;
-			case ITEM_VALUE_TYPE_FLOAT:
-				if (0 != numeric_search)
-				{
-					for (i = 0; i < values.values_num && count < limit; i++)
-						count_one_dbl(&count, op, values.values[i].value.dbl, arg3_dbl);
-				}
-				else
-				{
-					for (i = 0; i < values.values_num && FAIL != count && count < limit; i++)
-					{
-						zbx_snprintf(buf, sizeof(buf), ZBX_FS_DBL_EXT(4),
-								values.values[i].value.dbl);
-						count_one_str(&count, op, buf, pattern, &regexps);
-					}
-				}
-				break;
-			case ITEM_VALUE_TYPE_LOG:
-				for (i = 0; i < values.values_num && FAIL != count && count < limit; i++)
-					count_one_str(&count, op, values.values[i].value.log->value, pattern, &regexps);
-				break;
-			default:
-				for (i = 0; i < values.values_num && FAIL != count && count < limit; i++)
-					count_one_str(&count, op, values.values[i].value.str, pattern, &regexps);
-		}
 
-		if (FAIL == count)
+		if (0 != match_values)
 		{
-			*error = zbx_strdup(*error, "invalid regular expression");
-			goto out;
+			for (i = 0; i < values.values_num && FAIL != count && count < limit; i++)
+			{
+				count_one_value(&count, item->value_type, op, numeric_search, &values.values[i].value,
+						pattern_ui64, pattern2_ui64, arg3_dbl, pattern, &regexps);
+			}
 		}
+		else
+			count = values.values_num;
 	}
-	else
+
+	if (FAIL == count)
 	{
-		if ((count = values.values_num) > limit)
-			count = limit;
+		*error = zbx_strdup(*error, "invalid regular expression");
+		goto out;
 	}
 
+	if (count > limit)
+		count = limit;
+
 	zbx_variant_set_dbl(value, count);
 
 	ret = SUCCEED;
@@ -1541,6 +1659,7 @@ static int	evaluate_SUM(zbx_variant_t *value, DC_EVALUATE_ITEM *item, const char
 	zbx_vector_history_record_t	values;
 	history_value_t			result;
 	zbx_timespec_t			ts_end = *ts;
+	zbx_vc_aggr_t			aggr;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -1579,6 +1698,15 @@ static int	evaluate_SUM(zbx_variant_t *value, DC_EVALUATE_ITEM *item, const char
 			THIS_SHOULD_NEVER_HAPPEN;
 	}
 
+	aggr.flags = ZBX_VC_AGGR_SUM;
+
+	if (SUCCEED == zbx_vc_get_aggregate(item->itemid, item->value_type, seconds, nvalues, &ts_end, &aggr))
+	{
+		zbx_history_value2variant(&aggr.sum, item->value_type, value);
+		ret = SUCCEED;
+		goto out;
+	}
+
 	if (FAIL == zbx_vc_get_values(item->itemid, item->value_type, &values, seconds, nvalues, &ts_end))
 	{
 		*error = zbx_strdup(*error, "cannot get values from value cache");
@@ -1632,6 +1760,7 @@ static int	evaluate_AVG(zbx_variant_t *value, DC_EVALUATE_ITEM *item, const char
 	zbx_value_type_t		arg1_type;
 	zbx_vector_history_record_t	values;
 	zbx_timespec_t			ts_end = *ts;
+	zbx_vc_aggr_t			aggr;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -1670,6 +1799,26 @@ static int	evaluate_AVG(zbx_variant_t *value, DC_EVALUATE_ITEM *item, const char
 			THIS_SHOULD_NEVER_HAPPEN;
 	}
 
+	aggr.flags = ZBX_VC_AGGR_AVG;
+
+	/* the sum of float values might overflow, fall back to the running average of copied values then */
+	if (SUCCEED == zbx_vc_get_aggregate(item->itemid, item->value_type, seconds, nvalues, &ts_end, &aggr) &&
+			(0 == aggr.values_num || 0 != isfinite(aggr.sum_dbl)))
+	{
+		if (0 < aggr.values_num)
+		{
+			zbx_variant_set_dbl(value, aggr.sum_dbl / aggr.values_num);
+			ret = SUCCEED;
+		}
+		else
+		{
+			zabbix_log(LOG_LEVEL_DEBUG, "result for AVG is empty");
+			*error = zbx_strdup(*error, "not enough data");
+		}
+
+		goto out;
+	}
+
 	if (FAIL == zbx_vc_get_values(item->itemid, item->value_type, &values, seconds, nvalues, &ts_end))
 	{
 		*error = zbx_strdup(*error, "cannot get values from value cache");
@@ -1727,14 +1876,15 @@ static int	evaluate_LAST(zbx_variant_t *value, DC_EVALUATE_ITEM *item, const cha
 		char **error)
 {
 	int			ret;
-	zbx_history_record_t	vc_value;
+	zbx_vc_cursor_t		cursor;
+	const history_value_t	*vc_value;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
-	if (SUCCEED == (ret = get_last_n_value(item, parameters, ts, &vc_value, error)))
+	if (SUCCEED == (ret = get_last_n_value(item, parameters, ts, &cursor, &vc_value, error)))
 	{
-		zbx_history_value2variant(&vc_value.value, item->value_type, value);
-		zbx_history_record_clear(&vc_value, item->value_type);
+		zbx_history_value2variant(vc_value, item->value_type, value);
+		zbx_vc_cursor_close(&cursor);
 	}
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
@@ -1776,6 +1926,7 @@ static int	evaluate_MIN_or_MAX(zbx_variant_t *value, const DC_EVALUATE_ITEM *ite
 	zbx_value_type_t		arg1_type;
 	zbx_vector_history_record_t	values;
 	zbx_timespec_t			ts_end = *ts;
+	zbx_vc_aggr_t			aggr;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -1814,6 +1965,25 @@ static int	evaluate_MIN_or_MAX(zbx_variant_t *value, const DC_EVALUATE_ITEM *ite
 			THIS_SHOULD_NEVER_HAPPEN;
 	}
 
+	aggr.flags = (EVALUATE_MIN == min_or_max ? ZBX_VC_AGGR_MIN : ZBX_VC_AGGR_MAX);
+
+	if (SUCCEED == zbx_vc_get_aggregate(item->itemid, item->value_type, seconds, nvalues, &ts_end, &aggr))
+	{
+		if (0 < aggr.values_num)
+		{
+			zbx_history_value2variant(EVALUATE_MIN == min_or_max ? &aggr.min : &aggr.max,
+					item->value_type, value);
+			ret = SUCCEED;
+		}
+		else
+		{
+			zabbix_log(LOG_LEVEL_DEBUG, "result for MIN or MAX is empty");
+			*error = zbx_strdup(*error, "not enough data");
+		}
+
+		goto out;
+	}
+
 	if (FAIL == zbx_vc_get_values(item->itemid, item->value_type, &values, seconds, nvalues, &ts_end))
 	{
 		*error = zbx_strdup(*error, "cannot get values from value cache");
@@ -1887,6 +2057,7 @@ static int	evaluate_PERCENTILE(zbx_variant_t  *value, DC_EVALUATE_ITEM *item, co
 	double				percentage;
 	zbx_vector_history_record_t	values;
 	zbx_timespec_t			ts_end = *ts;
+	zbx_vc_aggr_t			aggr;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -1932,6 +2103,25 @@ static int	evaluate_PERCENTILE(zbx_variant_t  *value, DC_EVALUATE_ITEM *item, co
 		goto out;
 	}
 
+	aggr.flags = ZBX_VC_AGGR_PERCENTILE;
+	aggr.percentage = percentage;
+
+	if (SUCCEED == zbx_vc_get_aggregate(item->itemid, item->value_type, seconds, nvalues, &ts_end, &aggr))
+	{
+		if (0 < aggr.values_num)
+		{
+			zbx_history_value2variant(&aggr.percentile, item->value_type, value);
+			ret = SUCCEED;
+		}
+		else
+		{
+			zabbix_log(LOG_LEVEL_DEBUG, "result for PERCENTILE is empty");
+			*error = zbx_strdup(*error, "not enough data");
+		}
+
+		goto out;
+	}
+
 	if (FAIL == zbx_vc_get_values(item->itemid, item->value_type, &values, seconds, nvalues, &ts_end))
 	{
 		*error = zbx_strdup(*error, "cannot get values from value cache");
@@ -1984,17 +2174,15 @@ out:
  ******************************************************************************/
 static int	evaluate_NODATA(zbx_variant_t *value, DC_EVALUATE_ITEM *item, const char *parameters, char **error)
 {
-	int				arg1, num, period, lazy = 1, ret = FAIL;
-	zbx_value_type_t		arg1_type;
-	zbx_vector_history_record_t	values;
-	zbx_timespec_t			ts;
-	char				*arg2 = NULL;
-	zbx_proxy_suppress_t		nodata_win;
+	int			arg1, num, period, lazy = 1, ret = FAIL, values_ret, values_num;
+	zbx_value_type_t	arg1_type;
+	zbx_vc_cursor_t		cursor;
+	zbx_timespec_t		ts;
+	char			*arg2 = NULL;
+	zbx_proxy_suppress_t	nodata_win;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
-	zbx_history_record_vector_create(&values);
-
 	if (2 < (num = num_param(parameters)))
 	{
 		*error = zbx_strdup(*error, "invalid number of parameters");
@@ -2033,8 +2221,12 @@ static int	evaluate_NODATA(zbx_variant_t *value, DC_EVALUATE_ITEM *item, const c
 	else
 		period = arg1;
 
-	if (SUCCEED == zbx_vc_get_values(item->itemid, item->value_type, &values, period, 1, &ts) &&
-			1 == values.values_num)
+	/* only the presence of a value is checked, so it's not copied */
+	values_ret = zbx_vc_cursor_open(&cursor, item->itemid, item->value_type, period, 1, &ts);
+	values_num = cursor.values_num;
+	zbx_vc_cursor_close(&cursor);
+
+	if (SUCCEED == values_ret && 1 == values_num)
 	{
 		zbx_variant_set_dbl(value, 0);
 	}
@@ -2073,7 +2265,6 @@ static int	evaluate_NODATA(zbx_variant_t *value, DC_EVALUATE_ITEM *item, const c
 
 	ret = SUCCEED;
 out:
-	zbx_history_record_vector_destroy(&values, item->value_type);
 	zbx_free(arg2);
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
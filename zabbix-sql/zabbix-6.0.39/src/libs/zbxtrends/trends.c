@@ -31,6 +31,37 @@ static char	*trends_errors[ZBX_TREND_STATE_COUNT] = {
 		"value is too large"
 };
 
+/* trends rollup table with records aggregating values of a day or month */
+typedef struct
+{
+	const char	*suffix;
+	zbx_time_unit_t	unit;
+}
+zbx_trends_rollup_t;
+
+/* trends rollups from the coarsest to the finest resolution */
+static const zbx_trends_rollup_t	trends_rollups[] = {
+		{"month", ZBX_TIME_UNIT_MONTH},
+		{"day", ZBX_TIME_UNIT_DAY}
+};
+
+/* trends function evaluation data */
+typedef struct
+{
+	zbx_trend_function_t	function;
+
+	/* the rollup table field with function value of the record */
+	const char		*field;
+
+	/* the hourly trends table fields with number of values and function value */
+	const char		*hourly_fields;
+
+	double			value;
+	double			num;
+	int			records_num;
+}
+zbx_trends_eval_t;
+
 /******************************************************************************
  *                                                                            *
  * Purpose: parse largest period base from function parameters                *
@@ -409,191 +440,372 @@ int	zbx_trends_parse_nextcheck(time_t from, const char *period_shift, time_t *ne
 
 /******************************************************************************
  *                                                                            *
- * Purpose: evaluate expression with trends data                              *
+ * Purpose: calculate start of trends rollup period                           *
  *                                                                            *
- * Parameters: table       - [IN] the trends table name                       *
- *             itemid      - [IN] the itemid                                  *
- *             start       - [OUT] the period start time in seconds since     *
- *                                  Epoch                                     *
- *             end         - [OUT] the period end time in seconds since       *
- *                                  Epoch                                     *
- *             eval_single - [IN] sql expression to evaluate for single       *
- *                                 record                                     *
- *             eval_multi  - [IN] sql expression to evaluate for multiple     *
- *                                 records                                    *
- *             value       - [OUT] the evaluation result                      *
+ * Parameters: clock - [IN] the timestamp                                     *
+ *             shift - [IN] the number of periods to shift the result by      *
+ *             unit  - [IN] the rollup period unit (day or month)             *
  *                                                                            *
- * Return value: Trend value state of the specified period and function.      *
+ * Return value: The start of local time day or month containing the clock,   *
+ *               shifted by the specified number of periods.                  *
+ *                                                                            *
+ * Comments: Rollup rows are identified by the start of their period, the     *
+ *           same boundaries must be used when writing and reading them.      *
  *                                                                            *
  ******************************************************************************/
-static zbx_trend_state_t	trends_eval(const char *table, zbx_uint64_t itemid, int start, int end,
-		const char *eval_single, const char *eval_multi, double *value)
+int	zbx_trends_rollup_clock(int clock, int shift, zbx_time_unit_t unit)
 {
-	DB_RESULT		result;
-	DB_ROW			row;
-	char			*sql = NULL;
-	size_t			sql_alloc = 0, sql_offset = 0;
-	zbx_trend_state_t	state;
-
-	zbx_recalc_time_period(&start, ZBX_RECALC_TIME_PERIOD_TRENDS);
+	struct tm	tm;
+	time_t		time_tmp = (time_t)clock;
 
-	if (start > end)
-		return ZBX_TREND_STATE_NODATA;
+	localtime_r(&time_tmp, &tm);
 
-	if (start != end)
+	if (ZBX_TIME_UNIT_MONTH == unit)
 	{
-		zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
-				"select %s from %s"
-				" where itemid=" ZBX_FS_UI64
-					" and clock>=%d"
-					" and clock<=%d",
-				eval_multi, table, itemid, start, end);
+		tm.tm_mday = 1;
+		tm.tm_mon += shift;
 	}
 	else
+		tm.tm_mday += shift;
+
+	tm.tm_hour = 0;
+	tm.tm_min = 0;
+	tm.tm_sec = 0;
+	tm.tm_isdst = -1;
+
+	return (int)mktime(&tm);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: add trends record to the function evaluation                      *
+ *                                                                            *
+ * Parameters: eval  - [IN/OUT] the function evaluation data                  *
+ *             num   - [IN] the number of values aggregated by the record     *
+ *             value - [IN] the record value of the evaluated function        *
+ *                                                                            *
+ ******************************************************************************/
+static void	trends_eval_add(zbx_trends_eval_t *eval, double num, double value)
+{
+	switch (eval->function)
 	{
-		zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
-				"select %s from %s"
-				" where itemid=" ZBX_FS_UI64
-					" and clock=%d",
-				eval_single, table, itemid, start);
+		case ZBX_TREND_FUNCTION_AVG:
+			if (0 == eval->records_num)
+				eval->value = value;
+			else
+				eval->value = eval->value / (eval->num + num) * eval->num + value / (eval->num + num) * num;
+			break;
+		case ZBX_TREND_FUNCTION_COUNT:
+			eval->value += value;
+			break;
+		case ZBX_TREND_FUNCTION_MAX:
+			if (0 == eval->records_num || value > eval->value)
+				eval->value = value;
+			break;
+		case ZBX_TREND_FUNCTION_MIN:
+			if (0 == eval->records_num || value < eval->value)
+				eval->value = value;
+			break;
+		case ZBX_TREND_FUNCTION_SUM:
+			eval->value += value * num;
+			break;
+		default:
+			THIS_SHOULD_NEVER_HAPPEN;
 	}
 
-	result = DBselect("%s", sql);
-	zbx_free(sql);
+	eval->num += num;
+	eval->records_num++;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: add clock ranges condition to sql query                           *
+ *                                                                            *
+ * Parameters: sql        - [IN/OUT] the sql query                            *
+ *             sql_alloc  - [IN/OUT] the sql query buffer size                *
+ *             sql_offset - [IN/OUT] the sql query length                     *
+ *             ranges     - [IN] the clock ranges, the range start is         *
+ *                               inclusive and the range end exclusive        *
+ *                                                                            *
+ ******************************************************************************/
+static void	trends_add_ranges_condition(char **sql, size_t *sql_alloc, size_t *sql_offset,
+		const zbx_vector_uint64_pair_t *ranges)
+{
+	int		i;
+	const char	*separator = "";
+
+	zbx_strcpy_alloc(sql, sql_alloc, sql_offset, " and (");
 
-	if (NULL != (row = DBfetch(result)) && SUCCEED != DBis_null(row[0]))
+	for (i = 0; i < ranges->values_num; i++)
 	{
-		*value = atof(row[0]);
-		state = ZBX_TREND_STATE_NORMAL;
-	}
-	else
-		state = ZBX_TREND_STATE_NODATA;
+		if (ranges->values[i].first == ranges->values[i].second)
+			continue;
 
-	DBfree_result(result);
+		zbx_snprintf_alloc(sql, sql_alloc, sql_offset, "%s(clock>=%d and clock<%d)", separator,
+				(int)ranges->values[i].first, (int)ranges->values[i].second);
+		separator = " or ";
+	}
 
-	return state;
+	zbx_chrcpy_alloc(sql, sql_alloc, sql_offset, ')');
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: evaluate avg function with trends data                            *
+ * Purpose: evaluate function with trends rollup data                         *
  *                                                                            *
- * Parameters: table       - [IN] the trends table name                       *
- *             itemid      - [IN] the itemid                                  *
- *             start       - [OUT] the period start time in seconds since     *
- *                                  Epoch                                     *
- *             end         - [OUT] the period end time in seconds since       *
- *                                  Epoch                                     *
- *             value       - [OUT] the evaluation result                      *
+ * Parameters: table  - [IN] the trends table name                            *
+ *             itemid - [IN] the itemid                                       *
+ *             rollup - [IN] the trends rollup                                *
+ *             ranges - [IN/OUT] the clock ranges to evaluate, on return the  *
+ *                               ranges not covered by rollup data            *
+ *             eval   - [IN/OUT] the function evaluation data                 *
  *                                                                            *
- * Return value: Trend value state of the specified period and function.      *
+ * Comments: Only whole rollup periods inside the ranges are evaluated with   *
+ *           rollup data. The rest of ranges and periods without rollup rows  *
+ *           are left for evaluation with finer resolution data.              *
  *                                                                            *
  ******************************************************************************/
-static zbx_trend_state_t	trends_eval_avg(const char *table, zbx_uint64_t itemid, int start, int end,
-		double *value)
+static void	trends_eval_rollup(const char *table, zbx_uint64_t itemid, const zbx_trends_rollup_t *rollup,
+		zbx_vector_uint64_pair_t *ranges, zbx_trends_eval_t *eval)
 {
-	DB_RESULT		result;
-	DB_ROW			row;
-	char			*sql = NULL;
-	size_t			sql_alloc = 0, sql_offset = 0;
-	zbx_trend_state_t	state;
-	double			avg, num, num2, avg2;
+	DB_RESULT			result;
+	DB_ROW				row;
+	char				*sql = NULL;
+	size_t				sql_alloc = 0, sql_offset = 0;
+	int				i, clock, next;
+	zbx_vector_uint64_pair_t	periods, uncovered;
+	zbx_vector_uint64_t		clocks;
+
+	zbx_vector_uint64_pair_create(&periods);
+	zbx_vector_uint64_pair_reserve(&periods, ranges->values_num);
+
+	/* find whole rollup periods inside each range, empty if there are none */
+	for (i = 0; i < ranges->values_num; i++)
+	{
+		zbx_uint64_pair_t	pair;
 
-	zbx_recalc_time_period(&start, ZBX_RECALC_TIME_PERIOD_TRENDS);
+		if ((int)ranges->values[i].first != (clock = zbx_trends_rollup_clock(ranges->values[i].first, 0,
+				rollup->unit)))
+		{
+			clock = zbx_trends_rollup_clock(ranges->values[i].first, 1, rollup->unit);
+		}
 
-	if (start > end)
-		return ZBX_TREND_STATE_NODATA;
+		pair.first = pair.second = clock;
 
-	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, "select value_avg,num from %s where itemid=" ZBX_FS_UI64,
-			table, itemid);
+		while ((int)ranges->values[i].second >= (next = zbx_trends_rollup_clock(clock, 1, rollup->unit)))
+			pair.second = clock = next;
+
+		zbx_vector_uint64_pair_append(&periods, pair);
+	}
 
-	if (start != end)
+	for (i = 0; i < periods.values_num; i++)
 	{
-		zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, " and clock>=%d and clock<=%d", start, end);
+		if (periods.values[i].first != periods.values[i].second)
+			break;
 	}
-	else
-		zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, " and clock=%d", start);
+
+	if (i == periods.values_num)
+		goto out;
+
+	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, "select clock,num,%s from %s_%s where itemid=" ZBX_FS_UI64,
+			eval->field, table, rollup->suffix, itemid);
+	trends_add_ranges_condition(&sql, &sql_alloc, &sql_offset, &periods);
 
 	result = DBselect("%s", sql);
 	zbx_free(sql);
 
-	if (NULL != (row = DBfetch(result)))
+	zbx_vector_uint64_create(&clocks);
+
+	while (NULL != (row = DBfetch(result)))
+	{
+		clock = atoi(row[0]);
+
+		/* skip rows not aligned to the current period boundaries, for example after timezone change */
+		if (clock != zbx_trends_rollup_clock(clock, 0, rollup->unit))
+			continue;
+
+		trends_eval_add(eval, atof(row[1]), atof(row[2]));
+		zbx_vector_uint64_append(&clocks, (zbx_uint64_t)clock);
+	}
+
+	DBfree_result(result);
+
+	zbx_vector_uint64_sort(&clocks, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+
+	/* leave only the ranges not covered by rollup rows */
+	zbx_vector_uint64_pair_create(&uncovered);
+
+	for (i = 0; i < ranges->values_num; i++)
 	{
-		avg = atof(row[0]);
-		num = atof(row[1]);
+		zbx_uint64_pair_t	pair;
+
+		pair.first = ranges->values[i].first;
 
-		while (NULL != (row = DBfetch(result)))
+		for (clock = periods.values[i].first; clock < (int)periods.values[i].second; clock = next)
 		{
-			avg2 = atof(row[0]);
-			num2 = atof(row[1]);
-			avg = avg / (num + num2) * num + avg2 / (num + num2) * num2;
-			num += num2;
+			next = zbx_trends_rollup_clock(clock, 1, rollup->unit);
+
+			if (FAIL == zbx_vector_uint64_bsearch(&clocks, (zbx_uint64_t)clock,
+					ZBX_DEFAULT_UINT64_COMPARE_FUNC))
+			{
+				continue;
+			}
+
+			if ((int)pair.first < clock)
+			{
+				pair.second = clock;
+				zbx_vector_uint64_pair_append(&uncovered, pair);
+			}
+
+			pair.first = next;
 		}
 
-		*value = avg;
-		state = ZBX_TREND_STATE_NORMAL;
+		if (pair.first < ranges->values[i].second)
+		{
+			pair.second = ranges->values[i].second;
+			zbx_vector_uint64_pair_append(&uncovered, pair);
+		}
 	}
-	else
-		state = ZBX_TREND_STATE_NODATA;
 
-	DBfree_result(result);
+	zbx_vector_uint64_pair_clear(ranges);
+	zbx_vector_uint64_pair_append_array(ranges, uncovered.values, uncovered.values_num);
 
-	return state;
+	zbx_vector_uint64_pair_destroy(&uncovered);
+	zbx_vector_uint64_destroy(&clocks);
+out:
+	zbx_vector_uint64_pair_destroy(&periods);
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: evaluate sum function with trends data                            *
+ * Purpose: evaluate function with hourly trends data                         *
  *                                                                            *
- * Parameters: table       - [IN] the trends table name                       *
- *             itemid      - [IN] the itemid                                  *
- *             start       - [OUT] the period start time in seconds since     *
- *                                  Epoch                                     *
- *             end         - [OUT] the period end time in seconds since       *
- *                                  Epoch                                     *
- *             value       - [OUT] the evaluation result                      *
- *                                                                            *
- * Return value: Trend value state of the specified period and function.      *
+ * Parameters: table  - [IN] the trends table name                            *
+ *             itemid - [IN] the itemid                                       *
+ *             ranges - [IN] the clock ranges to evaluate                     *
+ *             eval   - [IN/OUT] the function evaluation data                 *
  *                                                                            *
  ******************************************************************************/
-static zbx_trend_state_t	trends_eval_sum(const char *table, zbx_uint64_t itemid, int start, int end,
-		double *value)
+static void	trends_eval_hourly(const char *table, zbx_uint64_t itemid, const zbx_vector_uint64_pair_t *ranges,
+		zbx_trends_eval_t *eval)
 {
 	DB_RESULT	result;
 	DB_ROW		row;
 	char		*sql = NULL;
 	size_t		sql_alloc = 0, sql_offset = 0;
-	double		sum = 0;
+
+	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, "select %s from %s where itemid=" ZBX_FS_UI64,
+			eval->hourly_fields, table, itemid);
+	trends_add_ranges_condition(&sql, &sql_alloc, &sql_offset, ranges);
+
+	result = DBselect("%s", sql);
+	zbx_free(sql);
+
+	while (NULL != (row = DBfetch(result)))
+	{
+		if (SUCCEED == DBis_null(row[1]))
+			continue;
+
+		trends_eval_add(eval, atof(row[0]), atof(row[1]));
+	}
+
+	DBfree_result(result);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: evaluate function with trends data                                *
+ *                                                                            *
+ * Parameters: table    - [IN] the trends table name                          *
+ *             itemid   - [IN] the itemid                                     *
+ *             start    - [IN] the period start time in seconds since Epoch   *
+ *             end      - [IN] the period end time (clock of the last hourly  *
+ *                             trends record) in seconds since Epoch          *
+ *             function - [IN] the function to evaluate                       *
+ *             value    - [OUT] the evaluation result                         *
+ *                                                                            *
+ * Return value: Trend value state of the specified period and function.      *
+ *                                                                            *
+ * Comments: The whole months and days of the period are evaluated with the   *
+ *           monthly and daily rollup tables, falling back to the hourly      *
+ *           trends for the rest of the period and for the months and days    *
+ *           without rollup rows. This limits the number of queries to three  *
+ *           and the number of rows read for a year to about a hundred.       *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_trend_state_t	trends_eval(const char *table, zbx_uint64_t itemid, int start, int end,
+		zbx_trend_function_t function, double *value)
+{
+	zbx_trends_eval_t		eval;
+	zbx_vector_uint64_pair_t	ranges;
+	zbx_uint64_pair_t		pair;
+	size_t				i;
+	zbx_trend_state_t		state;
 
 	zbx_recalc_time_period(&start, ZBX_RECALC_TIME_PERIOD_TRENDS);
 
 	if (start > end)
 		return ZBX_TREND_STATE_NODATA;
 
-	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, "select value_avg,num from %s where itemid=" ZBX_FS_UI64,
-			table, itemid);
+	memset(&eval, 0, sizeof(eval));
+	eval.function = function;
 
-	if (start != end)
+	switch (function)
 	{
-		zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, " and clock>=%d and clock<=%d", start, end);
+		case ZBX_TREND_FUNCTION_AVG:
+		case ZBX_TREND_FUNCTION_SUM:
+			eval.field = "value_avg";
+			eval.hourly_fields = "num,value_avg";
+			break;
+		case ZBX_TREND_FUNCTION_COUNT:
+			eval.field = "num";
+			eval.hourly_fields = "sum(num),sum(num)";
+			break;
+		case ZBX_TREND_FUNCTION_MAX:
+			eval.field = "value_max";
+			eval.hourly_fields = "sum(num),max(value_max)";
+			break;
+		case ZBX_TREND_FUNCTION_MIN:
+			eval.field = "value_min";
+			eval.hourly_fields = "sum(num),min(value_min)";
+			break;
+		default:
+			THIS_SHOULD_NEVER_HAPPEN;
+			return ZBX_TREND_STATE_UNKNOWN;
 	}
-	else
-		zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, " and clock=%d", start);
 
-	result = DBselect("%s", sql);
-	zbx_free(sql);
+	zbx_vector_uint64_pair_create(&ranges);
 
-	while (NULL != (row = DBfetch(result)))
-		sum += atof(row[0]) * atof(row[1]);
+	/* trends clock refers to the beginning of the hourly interval - the range must */
+	/* include the whole last hour to match it against rollup periods               */
+	pair.first = start;
+	pair.second = end - end % SEC_PER_HOUR + SEC_PER_HOUR;
+	zbx_vector_uint64_pair_append(&ranges, pair);
 
-	DBfree_result(result);
+	for (i = 0; i < ARRSIZE(trends_rollups) && 0 != ranges.values_num; i++)
+		trends_eval_rollup(table, itemid, &trends_rollups[i], &ranges, &eval);
 
-	if (ZBX_INFINITY == sum)
-		return ZBX_TREND_STATE_OVERFLOW;
+	if (0 != ranges.values_num)
+		trends_eval_hourly(table, itemid, &ranges, &eval);
 
-	*value = sum;
+	zbx_vector_uint64_pair_destroy(&ranges);
 
-	return ZBX_TREND_STATE_NORMAL;
+	switch (function)
+	{
+		case ZBX_TREND_FUNCTION_COUNT:
+			state = ZBX_TREND_STATE_NORMAL;
+			break;
+		case ZBX_TREND_FUNCTION_SUM:
+			state = (ZBX_INFINITY == eval.value ? ZBX_TREND_STATE_OVERFLOW : ZBX_TREND_STATE_NORMAL);
+			break;
+		default:
+			state = (0 != eval.records_num ? ZBX_TREND_STATE_NORMAL : ZBX_TREND_STATE_NODATA);
+	}
+
+	if (ZBX_TREND_STATE_NORMAL == state)
+		*value = eval.value;
+
+	return state;
 }
 
 int	zbx_trends_eval_avg(const char *table, zbx_uint64_t itemid, int start, int end, double *value, char **error)
@@ -602,7 +814,7 @@ int	zbx_trends_eval_avg(const char *table, zbx_uint64_t itemid, int start, int e
 
 	if (FAIL == zbx_tfc_get_value(itemid, start, end, ZBX_TREND_FUNCTION_AVG, value, &state))
 	{
-		state = trends_eval_avg(table, itemid, start, end, value);
+		state = trends_eval(table, itemid, start, end, ZBX_TREND_FUNCTION_AVG, value);
 		zbx_tfc_put_value(itemid, start, end, ZBX_TREND_FUNCTION_AVG, *value, state);
 	}
 
@@ -623,7 +835,8 @@ int	zbx_trends_eval_count(const char *table, zbx_uint64_t itemid, int start, int
 
 	if (FAIL == zbx_tfc_get_value(itemid, start, end, ZBX_TREND_FUNCTION_COUNT, value, &state))
 	{
-		if (ZBX_TREND_STATE_NORMAL != (state = trends_eval(table, itemid, start, end, "num", "sum(num)", value)))
+		if (ZBX_TREND_STATE_NORMAL != (state = trends_eval(table, itemid, start, end, ZBX_TREND_FUNCTION_COUNT,
+				value)))
 		{
 			state = ZBX_TREND_STATE_NORMAL;
 			*value = 0;
@@ -641,7 +854,7 @@ int	zbx_trends_eval_max(const char *table, zbx_uint64_t itemid, int start, int e
 
 	if (FAIL == zbx_tfc_get_value(itemid, start, end, ZBX_TREND_FUNCTION_MAX, value, &state))
 	{
-		state = trends_eval(table, itemid, start, end, "value_max", "max(value_max)", value);
+		state = trends_eval(table, itemid, start, end, ZBX_TREND_FUNCTION_MAX, value);
 		zbx_tfc_put_value(itemid, start, end, ZBX_TREND_FUNCTION_MAX, *value, state);
 	}
 
@@ -660,7 +873,7 @@ int	zbx_trends_eval_min(const char *table, zbx_uint64_t itemid, int start, int e
 
 	if (FAIL == zbx_tfc_get_value(itemid, start, end, ZBX_TREND_FUNCTION_MIN, value, &state))
 	{
-		state = trends_eval(table, itemid, start, end, "value_min", "min(value_min)", value);
+		state = trends_eval(table, itemid, start, end, ZBX_TREND_FUNCTION_MIN, value);
 		zbx_tfc_put_value(itemid, start, end, ZBX_TREND_FUNCTION_MIN, *value, state);
 	}
 
@@ -679,7 +892,7 @@ int	zbx_trends_eval_sum(const char *table, zbx_uint64_t itemid, int start, int e
 
 	if (FAIL == zbx_tfc_get_value(itemid, start, end, ZBX_TREND_FUNCTION_SUM, value, &state))
 	{
-		state = trends_eval_sum(table, itemid, start, end, value);
+		state = trends_eval(table, itemid, start, end, ZBX_TREND_FUNCTION_SUM, value);
 		zbx_tfc_put_value(itemid, start, end, ZBX_TREND_FUNCTION_SUM, *value, state);
 	}
 
@@ -698,7 +911,7 @@ zbx_trend_state_t	zbx_trends_get_avg(const char *table, zbx_uint64_t itemid, int
 
 	if (FAIL == zbx_tfc_get_value(itemid, start, end, ZBX_TREND_FUNCTION_AVG, value, &state))
 	{
-		state = trends_eval_avg(table, itemid, start, end, value);
+		state = trends_eval(table, itemid, start, end, ZBX_TREND_FUNCTION_AVG, value);
 		zbx_tfc_put_value(itemid, start, end, ZBX_TREND_FUNCTION_AVG, *value, state);
 	}
 
@@ -25,6 +25,7 @@
 #include "log.h"
 #include "zbxgetopt.h"
 #include "mutexs.h"
+#include "memalloc.h"
 
 #include "sysinfo.h"
 #include "zbxmodules.h"
@@ -39,6 +40,7 @@
 #include "housekeeper/housekeeper.h"
 #include "../zabbix_server/pinger/pinger.h"
 #include "../zabbix_server/poller/poller.h"
+#include "../zabbix_server/poller/async_poller.h"
 #include "../zabbix_server/trapper/trapper.h"
 #include "../zabbix_server/trapper/proxydata.h"
 #include "../zabbix_server/snmptrapper/snmptrapper.h"
@@ -204,6 +206,19 @@ int	CONFIG_AVAILMAN_FORKS		= 1;
 int	CONFIG_SERVICEMAN_FORKS		= 0;
 int	CONFIG_TRIGGERHOUSEKEEPER_FORKS	= 0;
 int	CONFIG_ODBCPOLLER_FORKS		= 1;
+int	CONFIG_AGENTPOLLER_FORKS	= 1;
+#ifdef HAVE_LIBCURL
+int	CONFIG_HTTPAGENT_POLLER_FORKS	= 1;
+#else
+int	CONFIG_HTTPAGENT_POLLER_FORKS	= 0;
+#endif
+#ifdef HAVE_NETSNMP
+int	CONFIG_SNMPPOLLER_FORKS		= 1;
+#else
+int	CONFIG_SNMPPOLLER_FORKS		= 0;
+#endif
+int	CONFIG_MAX_CONCURRENT_CHECKS_PER_POLLER		= 1000;
+int	CONFIG_MAX_CONCURRENT_CHECKS_PER_INTERFACE	= 3;
 int	CONFIG_HAMANAGER_FORKS		= 0;
 
 int	CONFIG_LISTEN_PORT		= ZBX_DEFAULT_SERVER_PORT;
@@ -230,11 +245,20 @@ int	CONFIG_VMWARE_PERF_FREQUENCY	= 60;
 int	CONFIG_VMWARE_TIMEOUT		= 10;
 
 zbx_uint64_t	CONFIG_CONF_CACHE_SIZE		= 8 * ZBX_MEBIBYTE;
+int		CONFIG_CACHE_FULL_UPDATE_FREQUENCY	= SEC_PER_HOUR;
+int		CONFIG_CACHE_SLAB_ALLOCATOR	= 0;
+int		CONFIG_CACHE_HUGE_PAGES		= 0;
+char		**CONFIG_CACHE_NUMA_POLICY	= NULL;
 zbx_uint64_t	CONFIG_HISTORY_CACHE_SIZE	= 16 * ZBX_MEBIBYTE;
 zbx_uint64_t	CONFIG_HISTORY_INDEX_CACHE_SIZE	= 4 * ZBX_MEBIBYTE;
+int		CONFIG_HISTORY_CACHE_SHARDS	= 1;
+zbx_uint64_t	CONFIG_HISTORY_RING_SIZE	= 0;
 zbx_uint64_t	CONFIG_TRENDS_CACHE_SIZE	= 0;
 zbx_uint64_t	CONFIG_TREND_FUNC_CACHE_SIZE	= 0;
 zbx_uint64_t	CONFIG_VALUE_CACHE_SIZE		= 0;
+char		*CONFIG_VALUE_CACHE_DUMP_FILE	= NULL;	/* not used in proxy */
+int		CONFIG_VALUE_CACHE_DUMP_MAX_AGE	= SEC_PER_DAY;	/* not used in proxy */
+int		CONFIG_VALUE_CACHE_COMPRESSION	= 0;		/* not used in proxy */
 zbx_uint64_t	CONFIG_VMWARE_CACHE_SIZE	= 8 * ZBX_MEBIBYTE;
 zbx_uint64_t	CONFIG_EXPORT_FILE_SIZE;
 
@@ -247,6 +271,7 @@ char	*CONFIG_EXTERNALSCRIPTS		= NULL;
 char	*CONFIG_TMPDIR			= NULL;
 char	*CONFIG_FPING_LOCATION		= NULL;
 char	*CONFIG_FPING6_LOCATION		= NULL;
+int	CONFIG_NATIVE_PINGER		= 1;
 char	*CONFIG_DBHOST			= NULL;
 char	*CONFIG_DBNAME			= NULL;
 char	*CONFIG_DBSCHEMA		= NULL;
@@ -322,10 +347,12 @@ char	*CONFIG_TLS_CIPHER_CMD13	= NULL;	/* not used in proxy, defined for linking
 char	*CONFIG_TLS_CIPHER_CMD		= NULL;	/* not used in proxy, defined for linking with tls.c */
 
 static char	*CONFIG_SOCKET_PATH	= NULL;
+static char	*CONFIG_IPC_SHM_SERVICES	= NULL;
 
 char	*CONFIG_HISTORY_STORAGE_URL		= NULL;
 char	*CONFIG_HISTORY_STORAGE_OPTS		= NULL;
 int	CONFIG_HISTORY_STORAGE_PIPELINES	= 0;
+int	CONFIG_HISTORY_SYNC_PIPELINE		= 0;
 
 char	*CONFIG_STATS_ALLOWED_IP	= NULL;
 int	CONFIG_TCP_MAX_BACKLOG_SIZE	= SOMAXCONN;
@@ -470,6 +497,21 @@ int	get_process_info_by_thread(int local_server_num, unsigned char *local_proces
 		*local_process_type = ZBX_PROCESS_TYPE_ODBCPOLLER;
 		*local_process_num = local_server_num - server_count + CONFIG_ODBCPOLLER_FORKS;
 	}
+	else if (local_server_num <= (server_count += CONFIG_AGENTPOLLER_FORKS))
+	{
+		*local_process_type = ZBX_PROCESS_TYPE_AGENT_POLLER;
+		*local_process_num = local_server_num - server_count + CONFIG_AGENTPOLLER_FORKS;
+	}
+	else if (local_server_num <= (server_count += CONFIG_HTTPAGENT_POLLER_FORKS))
+	{
+		*local_process_type = ZBX_PROCESS_TYPE_HTTPAGENT_POLLER;
+		*local_process_num = local_server_num - server_count + CONFIG_HTTPAGENT_POLLER_FORKS;
+	}
+	else if (local_server_num <= (server_count += CONFIG_SNMPPOLLER_FORKS))
+	{
+		*local_process_type = ZBX_PROCESS_TYPE_SNMP_POLLER;
+		*local_process_num = local_server_num - server_count + CONFIG_SNMPPOLLER_FORKS;
+	}
 	else
 		return FAIL;
 
@@ -610,6 +652,13 @@ static void	zbx_validate_config(ZBX_TASK_EX *task)
 		err = 1;
 	}
 
+	if (CONFIG_PREPROCESSOR_FORKS < CONFIG_PREPROCMAN_FORKS)
+	{
+		zabbix_log(LOG_LEVEL_CRIT, "\"StartPreprocessors\" configuration parameter must not be less than"
+				" \"StartPreprocessingManagers\"");
+		err = 1;
+	}
+
 	if ((NULL == CONFIG_JAVA_GATEWAY || '\0' == *CONFIG_JAVA_GATEWAY) && 0 < CONFIG_JAVAPOLLER_FORKS)
 	{
 		zabbix_log(LOG_LEVEL_CRIT, "\"JavaGateway\" configuration parameter is not specified or empty");
@@ -652,6 +701,11 @@ static void	zbx_validate_config(ZBX_TASK_EX *task)
 	err |= (FAIL == check_cfg_feature_str("SSLKeyLocation", CONFIG_SSL_KEY_LOCATION, "cURL library"));
 	err |= (FAIL == check_cfg_feature_str("VaultToken", CONFIG_VAULTTOKEN, "cURL library"));
 	err |= (FAIL == check_cfg_feature_str("VaultDBPath", CONFIG_VAULTDBPATH, "cURL library"));
+	err |= (FAIL == check_cfg_feature_int("StartHTTPAgentPollers", CONFIG_HTTPAGENT_POLLER_FORKS,
+			"cURL library"));
+#endif
+#if !defined(HAVE_NETSNMP)
+	err |= (FAIL == check_cfg_feature_int("StartSNMPPollers", CONFIG_SNMPPOLLER_FORKS, "SNMP support"));
 #endif
 #if !defined(HAVE_LIBXML2) || !defined(HAVE_LIBCURL)
 	err |= (FAIL == check_cfg_feature_int("StartVMwareCollectors", CONFIG_VMWARE_FORKS, "VMware support"));
@@ -757,10 +811,22 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	0,			1},
 		{"CacheSize",			&CONFIG_CONF_CACHE_SIZE,		TYPE_UINT64,
 			PARM_OPT,	128 * ZBX_KIBIBYTE,	__UINT64_C(64) * ZBX_GIBIBYTE},
+		{"CacheFullUpdateFrequency",	&CONFIG_CACHE_FULL_UPDATE_FREQUENCY,	TYPE_INT,
+			PARM_OPT,	0,			SEC_PER_DAY},
+		{"CacheSlabAllocator",		&CONFIG_CACHE_SLAB_ALLOCATOR,		TYPE_INT,
+			PARM_OPT,	0,			1},
+		{"CacheHugePages",		&CONFIG_CACHE_HUGE_PAGES,		TYPE_INT,
+			PARM_OPT,	0,			1},
+		{"CacheNUMAPolicy",		&CONFIG_CACHE_NUMA_POLICY,		TYPE_MULTISTRING,
+			PARM_OPT,	0,			0},
 		{"HistoryCacheSize",		&CONFIG_HISTORY_CACHE_SIZE,		TYPE_UINT64,
 			PARM_OPT,	128 * ZBX_KIBIBYTE,	__UINT64_C(2) * ZBX_GIBIBYTE},
 		{"HistoryIndexCacheSize",	&CONFIG_HISTORY_INDEX_CACHE_SIZE,	TYPE_UINT64,
 			PARM_OPT,	128 * ZBX_KIBIBYTE,	__UINT64_C(2) * ZBX_GIBIBYTE},
+		{"HistoryCacheShards",		&CONFIG_HISTORY_CACHE_SHARDS,		TYPE_INT,
+			PARM_OPT,	1,			ZBX_HC_SHARDS_MAX},
+		{"HistoryRingSize",		&CONFIG_HISTORY_RING_SIZE,		TYPE_UINT64,
+			PARM_OPT,	0,			__UINT64_C(1) * ZBX_GIBIBYTE},
 		{"HousekeepingFrequency",	&CONFIG_HOUSEKEEPING_FREQUENCY,		TYPE_INT,
 			PARM_OPT,	0,			24},
 		{"ProxyLocalBuffer",		&CONFIG_PROXY_LOCAL_BUFFER,		TYPE_INT,
@@ -779,6 +845,8 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	0,			0},
 		{"Fping6Location",		&CONFIG_FPING6_LOCATION,		TYPE_STRING,
 			PARM_OPT,	0,			0},
+		{"NativePinger",		&CONFIG_NATIVE_PINGER,			TYPE_INT,
+			PARM_OPT,	0,			1},
 		{"Timeout",			&CONFIG_TIMEOUT,			TYPE_INT,
 			PARM_OPT,	1,			30},
 		{"TrapperTimeout",		&CONFIG_TRAPPER_TIMEOUT,		TYPE_INT,
@@ -903,6 +971,8 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	0,			0},
 		{"SocketDir",			&CONFIG_SOCKET_PATH,			TYPE_STRING,
 			PARM_OPT,	0,			0},
+		{"IPCSharedMemoryServices",	&CONFIG_IPC_SHM_SERVICES,		TYPE_STRING_LIST,
+			PARM_OPT,	0,			0},
 		{"EnableRemoteCommands",	&CONFIG_ENABLE_REMOTE_COMMANDS,		TYPE_INT,
 			PARM_OPT,	0,			1},
 		{"LogRemoteCommands",		&CONFIG_LOG_REMOTE_COMMANDS,		TYPE_INT,
@@ -911,17 +981,30 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	0,			0},
 		{"StartPreprocessors",		&CONFIG_PREPROCESSOR_FORKS,		TYPE_INT,
 			PARM_OPT,	1,			1000},
+		{"StartPreprocessingManagers",	&CONFIG_PREPROCMAN_FORKS,		TYPE_INT,
+			PARM_OPT,	1,			ZBX_PREPROCESSING_MANAGERS_MAX},
 		{"StartHistoryPollers",		&CONFIG_HISTORYPOLLER_FORKS,		TYPE_INT,
 			PARM_OPT,	0,			1000},
 		{"ListenBacklog",		&CONFIG_TCP_MAX_BACKLOG_SIZE,		TYPE_INT,
 			PARM_OPT,	0,			INT_MAX},
 		{"StartODBCPollers",		&CONFIG_ODBCPOLLER_FORKS,		TYPE_INT,
 			PARM_OPT,	0,			1000},
+		{"StartAgentPollers",		&CONFIG_AGENTPOLLER_FORKS,		TYPE_INT,
+			PARM_OPT,	0,			1000},
+		{"StartHTTPAgentPollers",	&CONFIG_HTTPAGENT_POLLER_FORKS,		TYPE_INT,
+			PARM_OPT,	0,			1000},
+		{"StartSNMPPollers",		&CONFIG_SNMPPOLLER_FORKS,		TYPE_INT,
+			PARM_OPT,	0,			1000},
+		{"MaxConcurrentChecksPerPoller",	&CONFIG_MAX_CONCURRENT_CHECKS_PER_POLLER,	TYPE_INT,
+			PARM_OPT,	1,			1000},
+		{"MaxConcurrentChecksPerInterface",	&CONFIG_MAX_CONCURRENT_CHECKS_PER_INTERFACE,	TYPE_INT,
+			PARM_OPT,	1,			1000},
 		{NULL}
 	};
 
 	/* initialize multistrings */
 	zbx_strarr_init(&CONFIG_LOAD_MODULE);
+	zbx_strarr_init(&CONFIG_CACHE_NUMA_POLICY);
 
 	parse_cfg_file(CONFIG_FILE, cfg, ZBX_CFG_FILE_REQUIRED, ZBX_CFG_STRICT, ZBX_CFG_EXIT_FAILURE);
 
@@ -961,6 +1044,7 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 static void	zbx_free_config(void)
 {
 	zbx_strarr_free(&CONFIG_LOAD_MODULE);
+	zbx_strarr_free(&CONFIG_CACHE_NUMA_POLICY);
 }
 
 /******************************************************************************
@@ -1113,6 +1197,8 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 		exit(EXIT_FAILURE);
 	}
 
+	zbx_ipc_set_shm_services(CONFIG_IPC_SHM_SERVICES);
+
 	if (SUCCEED != zbx_locks_create(&error))
 	{
 		zbx_error("cannot create locks: %s", error);
@@ -1192,6 +1278,13 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 		exit(EXIT_FAILURE);
 	}
 #endif
+	if (SUCCEED != zbx_mem_set_policies(CONFIG_CACHE_HUGE_PAGES, CONFIG_CACHE_NUMA_POLICY, &error))
+	{
+		zabbix_log(LOG_LEVEL_CRIT, "cannot set shared memory policies: %s", error);
+		zbx_free(error);
+		exit(EXIT_FAILURE);
+	}
+
 	if (FAIL == zbx_load_modules(CONFIG_LOAD_MODULE_PATH, CONFIG_LOAD_MODULE, CONFIG_TIMEOUT, 1))
 	{
 		zabbix_log(LOG_LEVEL_CRIT, "loading modules failed, exiting...");
@@ -1300,7 +1393,8 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 			+ CONFIG_JAVAPOLLER_FORKS + CONFIG_SNMPTRAPPER_FORKS + CONFIG_SELFMON_FORKS
 			+ CONFIG_VMWARE_FORKS + CONFIG_IPMIMANAGER_FORKS + CONFIG_TASKMANAGER_FORKS
 			+ CONFIG_PREPROCMAN_FORKS + CONFIG_PREPROCESSOR_FORKS + CONFIG_HISTORYPOLLER_FORKS
-			+ CONFIG_AVAILMAN_FORKS + CONFIG_ODBCPOLLER_FORKS;
+			+ CONFIG_AVAILMAN_FORKS + CONFIG_ODBCPOLLER_FORKS
+			+ CONFIG_AGENTPOLLER_FORKS + CONFIG_HTTPAGENT_POLLER_FORKS + CONFIG_SNMPPOLLER_FORKS;
 
 	threads = (pid_t *)zbx_calloc(threads, (size_t)threads_num, sizeof(pid_t));
 	threads_flags = (int *)zbx_calloc(threads_flags, (size_t)threads_num, sizeof(int));
@@ -1427,6 +1521,21 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 				thread_args.args = &poller_type;
 				zbx_thread_start(poller_thread, &thread_args, &threads[i]);
 				break;
+			case ZBX_PROCESS_TYPE_AGENT_POLLER:
+				poller_type = ZBX_POLLER_TYPE_AGENT;
+				thread_args.args = &poller_type;
+				zbx_thread_start(async_poller_thread, &thread_args, &threads[i]);
+				break;
+			case ZBX_PROCESS_TYPE_HTTPAGENT_POLLER:
+				poller_type = ZBX_POLLER_TYPE_HTTPAGENT;
+				thread_args.args = &poller_type;
+				zbx_thread_start(async_poller_thread, &thread_args, &threads[i]);
+				break;
+			case ZBX_PROCESS_TYPE_SNMP_POLLER:
+				poller_type = ZBX_POLLER_TYPE_SNMP;
+				thread_args.args = &poller_type;
+				zbx_thread_start(async_poller_thread, &thread_args, &threads[i]);
+				break;
 		}
 	}
 
@@ -29,3 +29,7 @@ void	zbx_lld_process_agent_result(zbx_uint64_t itemid, zbx_uint64_t hostid, AGEN
 	ZBX_UNUSED(ts);
 	ZBX_UNUSED(error);
 }
+
+void	zbx_lld_flush(void)
+{
+}
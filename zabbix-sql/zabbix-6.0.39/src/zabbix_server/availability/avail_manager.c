@@ -51,9 +51,9 @@ ZBX_THREAD_ENTRY(availability_manager_thread, args)
 {
 	zbx_ipc_service_t		service;
 	char				*error = NULL;
-	zbx_ipc_client_t		*client;
-	zbx_ipc_message_t		*message;
-	int				ret, processed_num = 0;
+	zbx_ipc_client_t		*clients[ZBX_IPC_RECV_BATCH_SIZE];
+	zbx_ipc_message_t		*messages[ZBX_IPC_RECV_BATCH_SIZE];
+	int				ret, processed_num = 0, i, messages_num;
 	double				time_stat, time_idle = 0, time_now, time_flush, sec;
 	zbx_vector_availability_ptr_t	interface_availabilities;
 	zbx_timespec_t			timeout = {ZBX_AVAILABILITY_MANAGER_DELAY, 0};
@@ -106,7 +106,8 @@ ZBX_THREAD_ENTRY(availability_manager_thread, args)
 		}
 
 		update_selfmon_counter(ZBX_PROCESS_STATE_IDLE);
-		ret = zbx_ipc_service_recv(&service, &timeout, &client, &message);
+		messages_num = ZBX_IPC_RECV_BATCH_SIZE;
+		ret = zbx_ipc_service_recv_batch(&service, &timeout, clients, messages, &messages_num);
 		update_selfmon_counter(ZBX_PROCESS_STATE_BUSY);
 		sec = zbx_time();
 		zbx_update_env(get_process_type_string(process_type), sec);
@@ -114,15 +115,18 @@ ZBX_THREAD_ENTRY(availability_manager_thread, args)
 		if (ZBX_IPC_RECV_IMMEDIATE != ret)
 			time_idle += sec - time_now;
 
-		if (NULL != message)
+		for (i = 0; i < messages_num; i++)
 		{
-			zbx_availability_deserialize(message->data, message->size, &interface_availabilities);
-			zbx_ipc_message_free(message);
+			if (NULL != messages[i])
+			{
+				zbx_availability_deserialize(messages[i]->data, messages[i]->size,
+						&interface_availabilities);
+				zbx_ipc_message_free(messages[i]);
+			}
+
+			zbx_ipc_client_release(clients[i]);
 		}
 
-		if (NULL != client)
-			zbx_ipc_client_release(client);
-
 		if (ZBX_AVAILABILITY_MANAGER_FLUSH_DELAY_SEC < time_now - time_flush)
 		{
 			time_flush = time_now;
@@ -106,6 +106,10 @@ static zbx_hk_cleanup_table_t	hk_cleanup_tables[] = {
 	{"history_uint",	&cfg.hk.history_mode,	&cfg.hk.history_global},
 	{"trends",		&cfg.hk.trends_mode,	&cfg.hk.trends_global},
 	{"trends_uint",		&cfg.hk.trends_mode,	&cfg.hk.trends_global},
+	{"trends_day",		&cfg.hk.trends_mode,	&cfg.hk.trends_global},
+	{"trends_uint_day",	&cfg.hk.trends_mode,	&cfg.hk.trends_global},
+	{"trends_month",	&cfg.hk.trends_mode,	&cfg.hk.trends_global},
+	{"trends_uint_month",	&cfg.hk.trends_mode,	&cfg.hk.trends_global},
 	/* force events housekeeping mode on to perform problem cleanup when events housekeeping is disabled */
 	{"events",		&poption_mode_regular,	&poption_global_disabled},
 	{NULL}
@@ -116,6 +120,9 @@ static zbx_hk_cleanup_table_t	hk_cleanup_tables[] = {
 #define HK_UPDATE_CACHE_OFFSET_TREND_UINT	(HK_UPDATE_CACHE_OFFSET_TREND_FLOAT + 1)
 #define HK_UPDATE_CACHE_TREND_COUNT		2
 
+/* number of trends resolutions (hourly, daily and monthly) following each other in the rules */
+#define HK_UPDATE_CACHE_TREND_LEVELS		3
+
 /* the oldest record timestamp cache for items in history tables */
 typedef struct
 {
@@ -156,6 +163,9 @@ typedef struct
 	/* type for checking which values are sent to the history storage */
 	unsigned char		type;
 
+	/* the table holds trends rollups, which are not partitioned */
+	unsigned char		rollup;
+
 	/* the oldest item record timestamp cache for target table */
 	zbx_hashset_t		item_cache;
 
@@ -188,6 +198,18 @@ static zbx_hk_history_rule_t	hk_history_rules[] = {
 	{.table = "trends_uint",	.history = "trends",	.poption_mode = &cfg.hk.trends_mode,
 			.poption_global = &cfg.hk.trends_global,	.poption = &cfg.hk.trends,
 			.type = ITEM_VALUE_TYPE_UINT64},
+	{.table = "trends_day",		.history = "trends",	.poption_mode = &cfg.hk.trends_mode,
+			.poption_global = &cfg.hk.trends_global,	.poption = &cfg.hk.trends,
+			.type = ITEM_VALUE_TYPE_FLOAT,	.rollup = 1},
+	{.table = "trends_uint_day",	.history = "trends",	.poption_mode = &cfg.hk.trends_mode,
+			.poption_global = &cfg.hk.trends_global,	.poption = &cfg.hk.trends,
+			.type = ITEM_VALUE_TYPE_UINT64,	.rollup = 1},
+	{.table = "trends_month",	.history = "trends",	.poption_mode = &cfg.hk.trends_mode,
+			.poption_global = &cfg.hk.trends_global,	.poption = &cfg.hk.trends,
+			.type = ITEM_VALUE_TYPE_FLOAT,	.rollup = 1},
+	{.table = "trends_uint_month",	.history = "trends",	.poption_mode = &cfg.hk.trends_mode,
+			.poption_global = &cfg.hk.trends_global,	.poption = &cfg.hk.trends,
+			.type = ITEM_VALUE_TYPE_UINT64,	.rollup = 1},
 	{NULL}
 };
 
@@ -388,7 +410,7 @@ static void	hk_history_update(zbx_hk_history_rule_t *rules, int now)
 	while (NULL != (row = DBfetch(result)))
 	{
 		zbx_uint64_t		itemid, hostid;
-		int			history, trends, value_type;
+		int			history, trends, value_type, i;
 		zbx_hk_history_rule_t	*rule, *rule_add;
 
 		ZBX_STR2UINT64(itemid, row[0]);
@@ -462,8 +484,15 @@ static void	hk_history_update(zbx_hk_history_rule_t *rules, int now)
 		if (0 != trends && ZBX_HK_OPTION_DISABLED != *rule->poption_global)
 			trends = *rule->poption;
 
-		hk_history_item_update(rules + HK_UPDATE_CACHE_OFFSET_TREND_FLOAT, HK_UPDATE_CACHE_TREND_COUNT,
-				rule_add, now, itemid, trends);
+		/* trends rollups are kept for the same period as hourly trends */
+		for (i = 0; i < HK_UPDATE_CACHE_TREND_LEVELS; i++)
+		{
+			int	offset = i * HK_UPDATE_CACHE_TREND_COUNT;
+
+			hk_history_item_update(rules + HK_UPDATE_CACHE_OFFSET_TREND_FLOAT + offset,
+					HK_UPDATE_CACHE_TREND_COUNT, (NULL != rule_add ? rule_add + offset : NULL), now,
+					itemid, trends);
+		}
 	}
 	DBfree_result(result);
 
@@ -586,6 +615,48 @@ out:
 #endif
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: delete expired records from trends rollup table when hourly       *
+ *          trends are partitioned                                            *
+ *                                                                            *
+ * Parameters: rule - [IN/OUT] the trends rollup housekeeping rule            *
+ *             now  - [IN] the current timestamp                              *
+ *                                                                            *
+ * Return value: the number of deleted records                                *
+ *                                                                            *
+ * Comments: Rollup tables are not partitioned and are small enough to be     *
+ *           cleaned by period start time with a single query.                *
+ *                                                                            *
+ ******************************************************************************/
+static int	hk_delete_rollup_for_rule(zbx_hk_history_rule_t *rule, int now)
+{
+	int	history_seconds, rc, deleted = 0;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() table:%s now:%d", __func__, rule->table, now);
+
+	history_seconds = *rule->poption;
+
+	if (0 == history_seconds)
+	{
+		rc = DBexecute("delete from %s", rule->table);
+	}
+	else if (ZBX_HK_TRENDS_MIN > history_seconds || ZBX_HK_PERIOD_MAX < history_seconds)
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "invalid history storage period for table '%s'", rule->table);
+		goto out;
+	}
+	else
+		rc = DBexecute("delete from %s where clock<%d", rule->table, now - history_seconds);
+
+	if (ZBX_DB_OK < rc)
+		deleted = rc;
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%d", __func__, deleted);
+
+	return deleted;
+}
+
 #if defined(HAVE_POSTGRESQL)
 static void	hk_update_dbversion_status(void)
 {
@@ -642,7 +713,11 @@ static int	housekeeping_history_and_trends(int now)
 		/* 3. config.db.extension must be set to "timescaledb" */
 		if (ZBX_HK_MODE_PARTITION == *rule->poption_mode)
 		{
-			hk_drop_partition_for_rule(rule, now);
+			if (0 != rule->rollup)
+				deleted += hk_delete_rollup_for_rule(rule, now);
+			else
+				hk_drop_partition_for_rule(rule, now);
+
 			goto skip;
 		}
 
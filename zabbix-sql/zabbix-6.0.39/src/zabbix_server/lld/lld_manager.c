@@ -531,12 +531,12 @@ ZBX_THREAD_ENTRY(lld_manager_thread, args)
 
 	zbx_ipc_service_t	lld_service;
 	char			*error = NULL;
-	zbx_ipc_client_t	*client;
-	zbx_ipc_message_t	*message;
+	zbx_ipc_client_t	*client, *clients[ZBX_IPC_RECV_BATCH_SIZE];
+	zbx_ipc_message_t	*message, *messages[ZBX_IPC_RECV_BATCH_SIZE];
 	double			time_stat, time_now, sec, time_idle = 0;
 	zbx_lld_manager_t	manager;
 	zbx_uint64_t		processed_num = 0;
-	int			ret;
+	int			ret, i, messages_num, queued;
 	zbx_timespec_t		timeout = {1, 0};
 
 	process_type = ((zbx_thread_args_t *)args)->process_type;
@@ -581,7 +581,8 @@ ZBX_THREAD_ENTRY(lld_manager_thread, args)
 		}
 
 		update_selfmon_counter(ZBX_PROCESS_STATE_IDLE);
-		ret = zbx_ipc_service_recv(&lld_service, &timeout, &client, &message);
+		messages_num = ZBX_IPC_RECV_BATCH_SIZE;
+		ret = zbx_ipc_service_recv_batch(&lld_service, &timeout, clients, messages, &messages_num);
 		update_selfmon_counter(ZBX_PROCESS_STATE_BUSY);
 
 		sec = zbx_time();
@@ -590,39 +591,49 @@ ZBX_THREAD_ENTRY(lld_manager_thread, args)
 		if (ZBX_IPC_RECV_IMMEDIATE != ret)
 			time_idle += sec - time_now;
 
-		if (NULL != message)
+		/* queue all received values before dispatching them to workers */
+		for (i = 0, queued = 0; i < messages_num; i++)
 		{
-			switch (message->code)
+			client = clients[i];
+			message = messages[i];
+
+			if (NULL != message)
 			{
-				case ZBX_IPC_LLD_REGISTER:
-					lld_register_worker(&manager, client, message);
-					break;
-				case ZBX_IPC_LLD_REQUEST:
-					lld_queue_request(&manager, message);
-					lld_process_queue(&manager);
-					break;
-				case ZBX_IPC_LLD_DONE:
-					lld_process_result(&manager, client);
-					processed_num++;
-					manager.queued_num--;
-					break;
-				case ZBX_IPC_LLD_QUEUE:
-					zbx_ipc_client_send(client, message->code, (unsigned char *)&manager.queued_num,
-							sizeof(zbx_uint64_t));
-					break;
-				case ZBX_IPC_LLD_DIAG_STATS:
-					lld_process_diag_stats(&manager, client);
-					break;
-				case ZBX_IPC_LLD_TOP_ITEMS:
-					lld_process_top_items(&manager, client, message);
-					break;
+				switch (message->code)
+				{
+					case ZBX_IPC_LLD_REGISTER:
+						lld_register_worker(&manager, client, message);
+						break;
+					case ZBX_IPC_LLD_REQUEST:
+						lld_queue_request(&manager, message);
+						queued = 1;
+						break;
+					case ZBX_IPC_LLD_DONE:
+						lld_process_result(&manager, client);
+						processed_num++;
+						manager.queued_num--;
+						break;
+					case ZBX_IPC_LLD_QUEUE:
+						zbx_ipc_client_send(client, message->code, (unsigned char *)&manager.queued_num,
+								sizeof(zbx_uint64_t));
+						break;
+					case ZBX_IPC_LLD_DIAG_STATS:
+						lld_process_diag_stats(&manager, client);
+						break;
+					case ZBX_IPC_LLD_TOP_ITEMS:
+						lld_process_top_items(&manager, client, message);
+						break;
+				}
+
+				zbx_ipc_message_free(message);
 			}
 
-			zbx_ipc_message_free(message);
+			if (NULL != client)
+				zbx_ipc_client_release(client);
 		}
 
-		if (NULL != client)
-			zbx_ipc_client_release(client);
+		if (0 != queued)
+			lld_process_queue(&manager);
 	}
 
 	zbx_setproctitle("%s #%d [terminated]", get_process_type_string(process_type), process_num);
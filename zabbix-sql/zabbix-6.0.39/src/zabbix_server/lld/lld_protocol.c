@@ -25,6 +25,11 @@
 #include "zbxipcservice.h"
 #include "sysinfo.h"
 
+extern int	CONFIG_IPC_COALESCE_WINDOW;
+
+/* connection used to send LLD values to manager, small values are coalesced */
+static zbx_ipc_socket_t	lld_value_socket;
+
 zbx_uint32_t	zbx_lld_serialize_item_value(unsigned char **data, zbx_uint64_t itemid, zbx_uint64_t hostid,
 		const char *value, const zbx_timespec_t *ts, unsigned char meta, zbx_uint64_t lastlogsize, int mtime,
 		const char *error)
@@ -187,21 +192,25 @@ static void	zbx_lld_deserialize_top_items_result(const unsigned char *data, zbx_
 void	zbx_lld_process_value(zbx_uint64_t itemid, zbx_uint64_t hostid, const char *value, const zbx_timespec_t *ts,
 		unsigned char meta, zbx_uint64_t lastlogsize, int mtime, const char *error)
 {
-	static zbx_ipc_socket_t	socket;
-	char			*errmsg = NULL;
-	unsigned char		*data;
-	zbx_uint32_t		data_len;
+	char		*errmsg = NULL;
+	unsigned char	*data;
+	zbx_uint32_t	data_len;
 
 	/* each process has a permanent connection to manager */
-	if (0 == socket.fd && FAIL == zbx_ipc_socket_open(&socket, ZBX_IPC_SERVICE_LLD, SEC_PER_MIN, &errmsg))
+	if (0 == lld_value_socket.fd)
 	{
-		zabbix_log(LOG_LEVEL_CRIT, "cannot connect to LLD manager service: %s", errmsg);
-		exit(EXIT_FAILURE);
+		if (FAIL == zbx_ipc_socket_open(&lld_value_socket, ZBX_IPC_SERVICE_LLD, SEC_PER_MIN, &errmsg))
+		{
+			zabbix_log(LOG_LEVEL_CRIT, "cannot connect to LLD manager service: %s", errmsg);
+			exit(EXIT_FAILURE);
+		}
+
+		zbx_ipc_socket_set_coalesce(&lld_value_socket, CONFIG_IPC_COALESCE_WINDOW);
 	}
 
 	data_len = zbx_lld_serialize_item_value(&data, itemid, hostid, value, ts, meta, lastlogsize, mtime, error);
 
-	if (FAIL == zbx_ipc_socket_write(&socket, ZBX_IPC_LLD_REQUEST, data, data_len))
+	if (FAIL == zbx_ipc_socket_write(&lld_value_socket, ZBX_IPC_LLD_REQUEST, data, data_len))
 	{
 		zabbix_log(LOG_LEVEL_CRIT, "cannot send data to LLD manager service");
 		exit(EXIT_FAILURE);
@@ -210,6 +219,23 @@ void	zbx_lld_process_value(zbx_uint64_t itemid, zbx_uint64_t hostid, const char
 	zbx_free(data);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: send LLD values coalesced in the connection buffer to manager     *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_lld_flush(void)
+{
+	if (0 == lld_value_socket.fd)
+		return;
+
+	if (FAIL == zbx_ipc_socket_flush(&lld_value_socket))
+	{
+		zabbix_log(LOG_LEVEL_CRIT, "cannot send data to LLD manager service");
+		exit(EXIT_FAILURE);
+	}
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: process low level discovery agent result                          *
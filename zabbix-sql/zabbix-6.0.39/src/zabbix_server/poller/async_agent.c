@@ -0,0 +1,554 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2025 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "async_agent.h"
+#include "checks_agent.h"
+
+#include "log.h"
+#include "comms.h"
+#include "zbxcompress.h"
+
+#include <event.h>
+#include <event2/dns.h>
+
+#define ZBX_ASYNC_AGENT_STATE_RESOLVE	0
+#define ZBX_ASYNC_AGENT_STATE_CONNECT	1
+#define ZBX_ASYNC_AGENT_STATE_SEND	2
+#define ZBX_ASYNC_AGENT_STATE_RECV	3
+#define ZBX_ASYNC_AGENT_STATE_DONE	4
+
+/* protocol header - signature, flags, data length and reserved (uncompressed data length) fields */
+#define ZBX_ASYNC_AGENT_HEADER_SIZE	(ZBX_TCP_HEADER_LEN + 1 + sizeof(zbx_uint32_t) * 2)
+
+typedef struct
+{
+	zbx_async_check_t			*check;
+	unsigned char				state;
+
+	/* set while the check is being started, the check data must not be freed */
+	/* by callbacks invoked directly from zbx_async_check_agent() function    */
+	unsigned char				starting;
+
+	int					fd;
+	struct event				*ev_io;
+	struct event				*ev_timeout;
+	struct evdns_getaddrinfo_request	*dns_req;
+
+	/* the request */
+	char					*out;
+	size_t					out_len;
+	size_t					out_offset;
+
+	/* the response */
+	char					*in;
+	size_t					in_alloc;
+	size_t					in_offset;
+	size_t					in_expected;	/* response size including header, 0 - unknown */
+	unsigned char				in_flags;
+	zbx_uint32_t				in_reserved;
+}
+zbx_async_agent_t;
+
+static void	async_agent_io_cb(evutil_socket_t fd, short what, void *arg);
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: release check resources and pass it back to poller                *
+ *                                                                            *
+ ******************************************************************************/
+static void	async_agent_finish(zbx_async_agent_t *agent)
+{
+	zbx_async_check_t	*check = agent->check;
+
+	if (NULL != agent->ev_io)
+		event_free(agent->ev_io);
+
+	if (NULL != agent->ev_timeout)
+		event_free(agent->ev_timeout);
+
+	if (-1 != agent->fd)
+		close(agent->fd);
+
+	zbx_free(agent->out);
+	zbx_free(agent->in);
+
+	agent->state = ZBX_ASYNC_AGENT_STATE_DONE;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "%s() itemid:" ZBX_FS_UI64 " key:'%s' %s", __func__, check->item.itemid,
+			check->item.key, zbx_result_string(check->errcode));
+
+	zbx_async_poller_check_done(check);
+
+	if (0 == agent->starting)
+		zbx_free(agent);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: finish check with the specified error                             *
+ *                                                                            *
+ ******************************************************************************/
+static void	async_agent_fail(zbx_async_agent_t *agent, int errcode, const char *fmt, ...)
+{
+	va_list	args;
+	char	*error;
+
+	va_start(args, fmt);
+	error = zbx_dvsprintf(NULL, fmt, args);
+	va_end(args);
+
+	SET_MSG_RESULT(&agent->check->result, zbx_dsprintf(NULL, "Get value from agent failed: %s", error));
+	agent->check->errcode = errcode;
+	zbx_free(error);
+
+	async_agent_finish(agent);
+}
+
+static void	async_agent_timeout_cb(evutil_socket_t fd, short what, void *arg)
+{
+	zbx_async_agent_t	*agent = (zbx_async_agent_t *)arg;
+	zbx_async_check_t	*check = agent->check;
+	const char		*action;
+
+	ZBX_UNUSED(fd);
+	ZBX_UNUSED(what);
+
+	switch (agent->state)
+	{
+		case ZBX_ASYNC_AGENT_STATE_RESOLVE:
+			action = "resolving agent address";
+			break;
+		case ZBX_ASYNC_AGENT_STATE_CONNECT:
+			action = "connecting to agent";
+			break;
+		case ZBX_ASYNC_AGENT_STATE_SEND:
+			action = "sending request";
+			break;
+		default:
+			action = "waiting for response";
+	}
+
+	SET_MSG_RESULT(&check->result, zbx_dsprintf(NULL, "Get value from agent failed: timeout while %s",
+			action));
+	check->errcode = TIMEOUT_ERROR;
+
+	if (ZBX_ASYNC_AGENT_STATE_RESOLVE == agent->state && NULL != agent->dns_req)
+	{
+		/* the check is finished by resolve callback invoked with cancel status */
+		evdns_getaddrinfo_cancel(agent->dns_req);
+		return;
+	}
+
+	async_agent_finish(agent);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: bind socket to the configured source address                      *
+ *                                                                            *
+ ******************************************************************************/
+static int	async_agent_bind(int fd, int family, char **error)
+{
+	struct addrinfo	hints, *ai = NULL;
+	int		ret = FAIL, rc;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = family;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_NUMERICHOST;
+
+	if (0 != (rc = getaddrinfo(CONFIG_SOURCE_IP, NULL, &hints, &ai)))
+	{
+		*error = zbx_dsprintf(*error, "invalid source IP address \"%s\": %s", CONFIG_SOURCE_IP,
+				gai_strerror(rc));
+		goto out;
+	}
+
+	if (0 != bind(fd, ai->ai_addr, ai->ai_addrlen))
+	{
+		*error = zbx_dsprintf(*error, "cannot bind socket to \"%s\": %s", CONFIG_SOURCE_IP,
+				zbx_strerror(errno));
+		goto out;
+	}
+
+	ret = SUCCEED;
+out:
+	if (NULL != ai)
+		freeaddrinfo(ai);
+
+	return ret;
+}
+
+static void	async_agent_connect(zbx_async_agent_t *agent, const struct evutil_addrinfo *ai)
+{
+	DC_ITEM	*item = &agent->check->item;
+	char	*error = NULL;
+
+	if (-1 == (agent->fd = socket(ai->ai_family, SOCK_STREAM, IPPROTO_TCP)))
+	{
+		async_agent_fail(agent, NETWORK_ERROR, "cannot create socket: %s", zbx_strerror(errno));
+		return;
+	}
+
+	evutil_make_socket_nonblocking(agent->fd);
+	evutil_make_socket_closeonexec(agent->fd);
+
+	if (NULL != CONFIG_SOURCE_IP && SUCCEED != async_agent_bind(agent->fd, ai->ai_family, &error))
+	{
+		async_agent_fail(agent, NETWORK_ERROR, "%s", error);
+		zbx_free(error);
+		return;
+	}
+
+	if (0 != connect(agent->fd, ai->ai_addr, ai->ai_addrlen) && EINPROGRESS != errno)
+	{
+		async_agent_fail(agent, NETWORK_ERROR, "cannot connect to [[%s]:%hu]: %s", item->interface.addr,
+				item->interface.port, zbx_strerror(errno));
+		return;
+	}
+
+	/* the connection result is reported when socket becomes writable */
+	agent->state = ZBX_ASYNC_AGENT_STATE_CONNECT;
+	agent->ev_io = event_new(zbx_async_poller_get_base(agent->check->poller), agent->fd, EV_WRITE,
+			async_agent_io_cb, agent);
+	event_add(agent->ev_io, NULL);
+}
+
+static void	async_agent_resolve_cb(int result, struct evutil_addrinfo *ai, void *arg)
+{
+	zbx_async_agent_t	*agent = (zbx_async_agent_t *)arg;
+
+	agent->dns_req = NULL;
+
+	if (EVUTIL_EAI_CANCEL == result)
+	{
+		/* error was already set by timeout callback */
+		async_agent_finish(agent);
+		return;
+	}
+
+	if (0 != result)
+	{
+		async_agent_fail(agent, NETWORK_ERROR, "cannot resolve [%s]: %s", agent->check->item.interface.addr,
+				evutil_gai_strerror(result));
+		return;
+	}
+
+	async_agent_connect(agent, ai);
+	evutil_freeaddrinfo(ai);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: parse response protocol header                                    *
+ *                                                                            *
+ * Return value: SUCCEED - the header was parsed or more data is needed       *
+ *               FAIL    - invalid header, the check was finished             *
+ *                                                                            *
+ ******************************************************************************/
+static int	async_agent_parse_header(zbx_async_agent_t *agent)
+{
+	zbx_uint32_t	len32_le;
+	zbx_uint64_t	expected_len;
+	size_t		offset = ZBX_TCP_HEADER_LEN;
+
+	if (0 != memcmp(agent->in, ZBX_TCP_HEADER_DATA, MIN(agent->in_offset, ZBX_TCP_HEADER_LEN)))
+	{
+		async_agent_fail(agent, NETWORK_ERROR, "message is missing header");
+		return FAIL;
+	}
+
+	if (ZBX_ASYNC_AGENT_HEADER_SIZE > agent->in_offset)
+		return SUCCEED;
+
+	agent->in_flags = (unsigned char)agent->in[offset++];
+
+	if (0 == (agent->in_flags & ZBX_TCP_PROTOCOL) || agent->in_flags > (ZBX_TCP_PROTOCOL | ZBX_TCP_COMPRESS))
+	{
+		async_agent_fail(agent, NETWORK_ERROR, "message is using unsupported protocol version \"%d\"",
+				(int)agent->in_flags);
+		return FAIL;
+	}
+
+	memcpy(&len32_le, agent->in + offset, sizeof(len32_le));
+	offset += sizeof(len32_le);
+	expected_len = zbx_letoh_uint32(len32_le);
+
+	memcpy(&len32_le, agent->in + offset, sizeof(len32_le));
+	agent->in_reserved = zbx_letoh_uint32(len32_le);
+
+	if (ZBX_MAX_RECV_DATA_SIZE < expected_len || ZBX_MAX_RECV_DATA_SIZE < agent->in_reserved)
+	{
+		async_agent_fail(agent, NETWORK_ERROR, "message size exceeds the maximum size");
+		return FAIL;
+	}
+
+	agent->in_expected = ZBX_ASYNC_AGENT_HEADER_SIZE + expected_len;
+
+	if (agent->in_alloc < agent->in_expected + 1)
+	{
+		agent->in_alloc = agent->in_expected + 1;
+		agent->in = (char *)zbx_realloc(agent->in, agent->in_alloc);
+	}
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: convert received response to item value and finish the check      *
+ *                                                                            *
+ ******************************************************************************/
+static void	async_agent_complete(zbx_async_agent_t *agent)
+{
+	zbx_async_check_t	*check = agent->check;
+	char			*data, *uncompressed = NULL;
+	size_t			data_len;
+
+	if (0 == agent->in_offset)
+	{
+		*agent->in = '\0';
+		check->errcode = zbx_agent_process_response(agent->in, 0, 0, check->item.interface.addr,
+				&check->result);
+		async_agent_finish(agent);
+		return;
+	}
+
+	if (0 == agent->in_expected)
+	{
+		async_agent_fail(agent, NETWORK_ERROR, "message is missing data length");
+		return;
+	}
+
+	if (agent->in_offset != agent->in_expected)
+	{
+		async_agent_fail(agent, NETWORK_ERROR, "message length does not match expected length");
+		return;
+	}
+
+	data = agent->in + ZBX_ASYNC_AGENT_HEADER_SIZE;
+	data_len = agent->in_expected - ZBX_ASYNC_AGENT_HEADER_SIZE;
+
+	if (0 != (agent->in_flags & ZBX_TCP_COMPRESS))
+	{
+		size_t	out_size = agent->in_reserved;
+
+		uncompressed = (char *)zbx_malloc(NULL, (size_t)agent->in_reserved + 1);
+
+		if (FAIL == zbx_uncompress(data, data_len, uncompressed, &out_size) || out_size != agent->in_reserved)
+		{
+			zbx_free(uncompressed);
+			async_agent_fail(agent, NETWORK_ERROR, "cannot uncompress data: %s", zbx_compress_strerror());
+			return;
+		}
+
+		data = uncompressed;
+		data_len = out_size;
+	}
+
+	data[data_len] = '\0';
+	check->errcode = zbx_agent_process_response(data, data_len, agent->in_offset, check->item.interface.addr,
+			&check->result);
+
+	zbx_free(uncompressed);
+	async_agent_finish(agent);
+}
+
+static void	async_agent_send(zbx_async_agent_t *agent)
+{
+	ssize_t	n;
+
+	while (agent->out_offset < agent->out_len)
+	{
+		if (-1 == (n = write(agent->fd, agent->out + agent->out_offset, agent->out_len - agent->out_offset)))
+		{
+			if (EINTR == errno)
+				continue;
+
+			if (EAGAIN == errno || EWOULDBLOCK == errno)
+			{
+				event_add(agent->ev_io, NULL);
+				return;
+			}
+
+			async_agent_fail(agent, NETWORK_ERROR, "cannot send request: %s", zbx_strerror(errno));
+			return;
+		}
+
+		agent->out_offset += (size_t)n;
+	}
+
+	agent->state = ZBX_ASYNC_AGENT_STATE_RECV;
+	event_assign(agent->ev_io, zbx_async_poller_get_base(agent->check->poller), agent->fd, EV_READ,
+			async_agent_io_cb, agent);
+	event_add(agent->ev_io, NULL);
+}
+
+static void	async_agent_recv(zbx_async_agent_t *agent)
+{
+	ssize_t	n;
+
+	while (1)
+	{
+		if (agent->in_offset == agent->in_alloc)
+		{
+			agent->in_alloc *= 2;
+			agent->in = (char *)zbx_realloc(agent->in, agent->in_alloc);
+		}
+
+		if (-1 == (n = read(agent->fd, agent->in + agent->in_offset, agent->in_alloc - agent->in_offset)))
+		{
+			if (EINTR == errno)
+				continue;
+
+			if (EAGAIN == errno || EWOULDBLOCK == errno)
+			{
+				event_add(agent->ev_io, NULL);
+				return;
+			}
+
+			async_agent_fail(agent, NETWORK_ERROR, "cannot read response: %s", zbx_strerror(errno));
+			return;
+		}
+
+		/* agent closed connection */
+		if (0 == n)
+			break;
+
+		agent->in_offset += (size_t)n;
+
+		if (0 == agent->in_expected && SUCCEED != async_agent_parse_header(agent))
+			return;
+
+		if (0 != agent->in_expected && agent->in_offset >= agent->in_expected)
+			break;
+	}
+
+	async_agent_complete(agent);
+}
+
+static void	async_agent_io_cb(evutil_socket_t fd, short what, void *arg)
+{
+	zbx_async_agent_t	*agent = (zbx_async_agent_t *)arg;
+	int			err = 0;
+	socklen_t		err_len = sizeof(err);
+
+	ZBX_UNUSED(what);
+
+	switch (agent->state)
+	{
+		case ZBX_ASYNC_AGENT_STATE_CONNECT:
+			if (0 != getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &err_len))
+				err = errno;
+
+			if (0 != err)
+			{
+				async_agent_fail(agent, NETWORK_ERROR, "cannot connect to [[%s]:%hu]: %s",
+						agent->check->item.interface.addr, agent->check->item.interface.port,
+						zbx_strerror(err));
+				return;
+			}
+
+			zabbix_log(LOG_LEVEL_DEBUG, "Sending [%s]", agent->check->item.key);
+			agent->state = ZBX_ASYNC_AGENT_STATE_SEND;
+			ZBX_FALLTHROUGH;
+		case ZBX_ASYNC_AGENT_STATE_SEND:
+			async_agent_send(agent);
+			break;
+		case ZBX_ASYNC_AGENT_STATE_RECV:
+			async_agent_recv(agent);
+			break;
+		default:
+			THIS_SHOULD_NEVER_HAPPEN;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: start asynchronous Zabbix agent check                             *
+ *                                                                            *
+ * Parameters: check   - [IN] the check to start                              *
+ *             timeout - [IN] the check timeout in seconds                    *
+ *                                                                            *
+ * Comments: The check is passed back to poller with                          *
+ *           zbx_async_poller_check_done() when it's finished, which can      *
+ *           also happen before this function returns.                        *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_async_check_agent(zbx_async_check_t *check, int timeout)
+{
+	zbx_async_agent_t			*agent;
+	struct evutil_addrinfo			hints;
+	struct evdns_getaddrinfo_request	*req;
+	struct timeval				tv = {timeout, 0};
+	zbx_uint32_t				len32_le;
+	size_t					key_len;
+	char					service[MAX_STRING_LEN];
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() host:'%s' addr:'%s' key:'%s'", __func__, check->item.host.host,
+			check->item.interface.addr, check->item.key);
+
+	agent = (zbx_async_agent_t *)zbx_malloc(NULL, sizeof(zbx_async_agent_t));
+	memset(agent, 0, sizeof(zbx_async_agent_t));
+	agent->check = check;
+	agent->fd = -1;
+
+	key_len = strlen(check->item.key);
+	agent->out_len = ZBX_ASYNC_AGENT_HEADER_SIZE + key_len;
+	agent->out = (char *)zbx_malloc(NULL, agent->out_len);
+	memcpy(agent->out, ZBX_TCP_HEADER_DATA, ZBX_TCP_HEADER_LEN);
+	agent->out[ZBX_TCP_HEADER_LEN] = ZBX_TCP_PROTOCOL;
+	len32_le = zbx_htole_uint32((zbx_uint32_t)key_len);
+	memcpy(agent->out + ZBX_TCP_HEADER_LEN + 1, &len32_le, sizeof(len32_le));
+	len32_le = 0;
+	memcpy(agent->out + ZBX_TCP_HEADER_LEN + 1 + sizeof(len32_le), &len32_le, sizeof(len32_le));
+	memcpy(agent->out + ZBX_ASYNC_AGENT_HEADER_SIZE, check->item.key, key_len);
+
+	agent->in_alloc = ZBX_STAT_BUF_LEN;
+	agent->in = (char *)zbx_malloc(NULL, agent->in_alloc);
+
+	agent->ev_timeout = evtimer_new(zbx_async_poller_get_base(check->poller), async_agent_timeout_cb, agent);
+	evtimer_add(agent->ev_timeout, &tv);
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+	zbx_snprintf(service, sizeof(service), "%hu", check->item.interface.port);
+
+	agent->state = ZBX_ASYNC_AGENT_STATE_RESOLVE;
+	agent->starting = 1;
+
+	req = evdns_getaddrinfo(zbx_async_poller_get_dnsbase(check->poller), check->item.interface.addr, service,
+			&hints, async_agent_resolve_cb, agent);
+
+	/* numeric and local addresses are resolved before evdns_getaddrinfo() returns */
+	if (ZBX_ASYNC_AGENT_STATE_DONE == agent->state)
+	{
+		zbx_free(agent);
+		goto out;
+	}
+
+	agent->starting = 0;
+
+	if (ZBX_ASYNC_AGENT_STATE_RESOLVE == agent->state)
+		agent->dns_req = req;
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+}
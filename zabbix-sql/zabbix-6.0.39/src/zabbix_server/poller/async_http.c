@@ -0,0 +1,292 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2025 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "async_http.h"
+
+#ifdef HAVE_LIBCURL
+
+#include "checks_http.h"
+#include "log.h"
+
+#include <event.h>
+
+/* Requests of all checks are executed by single cURL multi handle, so connections are kept */
+/* in its connection cache and reused by following checks of the same host. TLS sessions    */
+/* and resolved host names are shared between requests with cURL share handle.             */
+struct zbx_async_http
+{
+	struct event_base	*base;
+	struct event		*ev_timeout;
+	CURLM			*multi;
+	CURLSH			*share;
+};
+
+typedef struct
+{
+	zbx_async_check_t	*check;
+	zbx_http_context_t	context;
+}
+zbx_async_http_request_t;
+
+static void	async_http_request_free(zbx_async_http_request_t *request)
+{
+	zbx_http_context_clean(&request->context);
+	zbx_free(request);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: convert finished requests to item values and pass checks back to  *
+ *          poller                                                            *
+ *                                                                            *
+ ******************************************************************************/
+static void	async_http_process_messages(zbx_async_http_t *http)
+{
+	CURLMsg	*msg;
+	int	msgs_left;
+
+	while (NULL != (msg = curl_multi_info_read(http->multi, &msgs_left)))
+	{
+		CURL				*easyhandle;
+		CURLcode			err;
+		zbx_async_http_request_t	*request;
+		zbx_async_check_t		*check;
+
+		if (CURLMSG_DONE != msg->msg)
+			continue;
+
+		/* message data is not valid after the handle is removed from multi handle */
+		easyhandle = msg->easy_handle;
+		err = msg->data.result;
+
+		curl_easy_getinfo(easyhandle, CURLINFO_PRIVATE, (char **)&request);
+		curl_multi_remove_handle(http->multi, easyhandle);
+
+		check = request->check;
+		check->errcode = zbx_http_context_process_result(&request->context, &check->item, err,
+				&check->result);
+
+		zabbix_log(LOG_LEVEL_DEBUG, "%s() itemid:" ZBX_FS_UI64 " key:'%s' %s", __func__, check->item.itemid,
+				check->item.key, zbx_result_string(check->errcode));
+
+		async_http_request_free(request);
+		zbx_async_poller_check_done(check);
+	}
+}
+
+static void	async_http_event_cb(evutil_socket_t fd, short what, void *arg)
+{
+	zbx_async_http_t	*http = (zbx_async_http_t *)arg;
+	int			action = 0, running;
+
+	if (0 != (what & EV_READ))
+		action |= CURL_CSELECT_IN;
+
+	if (0 != (what & EV_WRITE))
+		action |= CURL_CSELECT_OUT;
+
+	curl_multi_socket_action(http->multi, fd, action, &running);
+	async_http_process_messages(http);
+}
+
+static void	async_http_timeout_cb(evutil_socket_t fd, short what, void *arg)
+{
+	zbx_async_http_t	*http = (zbx_async_http_t *)arg;
+	int			running;
+
+	ZBX_UNUSED(fd);
+	ZBX_UNUSED(what);
+
+	curl_multi_socket_action(http->multi, CURL_SOCKET_TIMEOUT, 0, &running);
+	async_http_process_messages(http);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: update socket events monitored for cURL                           *
+ *                                                                            *
+ ******************************************************************************/
+static int	async_http_socket_cb(CURL *easyhandle, curl_socket_t s, int what, void *userp, void *socketp)
+{
+	zbx_async_http_t	*http = (zbx_async_http_t *)userp;
+	struct event		*ev = (struct event *)socketp;
+	short			events = EV_PERSIST;
+
+	ZBX_UNUSED(easyhandle);
+
+	if (CURL_POLL_REMOVE == what)
+	{
+		if (NULL != ev)
+			event_free(ev);
+
+		return 0;
+	}
+
+	if (0 != (what & CURL_POLL_IN))
+		events |= EV_READ;
+
+	if (0 != (what & CURL_POLL_OUT))
+		events |= EV_WRITE;
+
+	if (NULL == ev)
+	{
+		ev = event_new(http->base, s, events, async_http_event_cb, http);
+		curl_multi_assign(http->multi, s, ev);
+	}
+	else
+	{
+		event_del(ev);
+		event_assign(ev, http->base, s, events, async_http_event_cb, http);
+	}
+
+	event_add(ev, NULL);
+
+	return 0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: schedule cURL timeout processing                                  *
+ *                                                                            *
+ ******************************************************************************/
+static int	async_http_timer_cb(CURLM *multi, long timeout_ms, void *userp)
+{
+	zbx_async_http_t	*http = (zbx_async_http_t *)userp;
+	struct timeval		tv;
+
+	ZBX_UNUSED(multi);
+
+	if (-1 == timeout_ms)
+	{
+		evtimer_del(http->ev_timeout);
+		return 0;
+	}
+
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+	evtimer_add(http->ev_timeout, &tv);
+
+	return 0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: create HTTP agent request executor                                *
+ *                                                                            *
+ * Parameters: base            - [IN] the poller event base                   *
+ *             max_connections - [IN] the maximum number of cached            *
+ *                                    connections                             *
+ *             error           - [OUT] the error message                      *
+ *                                                                            *
+ * Return value: the request executor or NULL on error                        *
+ *                                                                            *
+ ******************************************************************************/
+zbx_async_http_t	*zbx_async_http_create(struct event_base *base, int max_connections, char **error)
+{
+	zbx_async_http_t	*http;
+	CURLcode		err;
+
+	if (CURLE_OK != (err = curl_global_init(CURL_GLOBAL_ALL)))
+	{
+		*error = zbx_dsprintf(*error, "cannot initialize cURL library: %s", curl_easy_strerror(err));
+		return NULL;
+	}
+
+	http = (zbx_async_http_t *)zbx_malloc(NULL, sizeof(zbx_async_http_t));
+	http->base = base;
+
+	if (NULL == (http->multi = curl_multi_init()))
+	{
+		*error = zbx_strdup(*error, "cannot initialize cURL multi handle");
+		zbx_free(http);
+		return NULL;
+	}
+
+	if (NULL == (http->share = curl_share_init()))
+	{
+		*error = zbx_strdup(*error, "cannot initialize cURL share handle");
+		curl_multi_cleanup(http->multi);
+		zbx_free(http);
+		return NULL;
+	}
+
+	/* requests are executed by single thread, locking callbacks are not needed */
+	curl_share_setopt(http->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+	curl_share_setopt(http->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+
+	http->ev_timeout = evtimer_new(base, async_http_timeout_cb, http);
+
+	curl_multi_setopt(http->multi, CURLMOPT_SOCKETFUNCTION, async_http_socket_cb);
+	curl_multi_setopt(http->multi, CURLMOPT_SOCKETDATA, http);
+	curl_multi_setopt(http->multi, CURLMOPT_TIMERFUNCTION, async_http_timer_cb);
+	curl_multi_setopt(http->multi, CURLMOPT_TIMERDATA, http);
+	curl_multi_setopt(http->multi, CURLMOPT_MAXCONNECTS, (long)max_connections);
+
+	return http;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: start asynchronous HTTP agent check                               *
+ *                                                                            *
+ * Parameters: http  - [IN] the request executor                              *
+ *             check - [IN] the check to start                                *
+ *                                                                            *
+ * Comments: The check is passed back to poller with                          *
+ *           zbx_async_poller_check_done() when it's finished, which can      *
+ *           also happen before this function returns.                        *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_async_check_http(zbx_async_http_t *http, zbx_async_check_t *check)
+{
+	zbx_async_http_request_t	*request;
+	CURLMcode			merr;
+	DC_ITEM				*item = &check->item;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() itemid:" ZBX_FS_UI64 " URL '%s%s'", __func__, item->itemid, item->url,
+			item->query_fields);
+
+	request = (zbx_async_http_request_t *)zbx_malloc(NULL, sizeof(zbx_async_http_request_t));
+	request->check = check;
+
+	if (SUCCEED != (check->errcode = zbx_http_context_prepare(&request->context, item, &check->result)))
+		goto fail;
+
+	curl_easy_setopt(request->context.easyhandle, CURLOPT_PRIVATE, request);
+	curl_easy_setopt(request->context.easyhandle, CURLOPT_SHARE, http->share);
+
+	if (CURLM_OK != (merr = curl_multi_add_handle(http->multi, request->context.easyhandle)))
+	{
+		SET_MSG_RESULT(&check->result, zbx_dsprintf(NULL, "Cannot start request: %s",
+				curl_multi_strerror(merr)));
+		check->errcode = NOTSUPPORTED;
+		goto fail;
+	}
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+
+	return;
+fail:
+	async_http_request_free(request);
+	zbx_async_poller_check_done(check);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(check->errcode));
+}
+
+#endif
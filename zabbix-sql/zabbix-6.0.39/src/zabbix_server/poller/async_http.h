@@ -0,0 +1,34 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2025 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#ifndef ZABBIX_ASYNC_HTTP_H
+#define ZABBIX_ASYNC_HTTP_H
+
+#include "config.h"
+
+#ifdef HAVE_LIBCURL
+#include "async_poller.h"
+
+typedef struct zbx_async_http	zbx_async_http_t;
+
+zbx_async_http_t	*zbx_async_http_create(struct event_base *base, int max_connections, char **error);
+void	zbx_async_check_http(zbx_async_http_t *http, zbx_async_check_t *check);
+#endif
+
+#endif
@@ -0,0 +1,566 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2025 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "async_poller.h"
+#include "async_agent.h"
+#include "async_http.h"
+#include "async_snmp.h"
+#include "poller.h"
+
+#include "daemon.h"
+#include "zbxserver.h"
+#include "zbxself.h"
+#include "preproc.h"
+#include "zbxrtc.h"
+#include "log.h"
+#include "zbxavailability.h"
+
+#include <event.h>
+#include <event2/dns.h>
+
+extern ZBX_THREAD_LOCAL unsigned char	process_type;
+extern unsigned char			program_type;
+extern ZBX_THREAD_LOCAL int		server_num, process_num;
+
+/* interface with checks in progress */
+typedef struct
+{
+	zbx_uint64_t	interfaceid;
+
+	/* the number of running checks */
+	int		checks_num;
+
+	/* checks waiting for free connection slot */
+	zbx_list_t	checks;
+}
+zbx_async_interface_t;
+
+struct zbx_async_poller
+{
+	unsigned char		poller_type;
+
+	struct event_base	*base;
+	struct evdns_base	*dnsbase;
+	struct event		*ev_timer;
+
+	zbx_hashset_t		interfaces;
+
+	/* the number of checks waiting for free interface connection slot */
+	int			queued_num;
+
+	/* the values last reported to configuration cache */
+	int			checks_reported;
+	int			queued_reported;
+
+#ifdef HAVE_LIBCURL
+	zbx_async_http_t	*http;
+#endif
+#ifdef HAVE_NETSNMP
+	zbx_async_snmp_t	*snmp;
+#endif
+	/* finished checks waiting to be processed */
+	zbx_vector_ptr_t	checks_done;
+
+	/* the number of checks taken from configuration cache and not yet returned */
+	int			checks_num;
+	int			checks_max;
+};
+
+struct event_base	*zbx_async_poller_get_base(zbx_async_poller_t *poller)
+{
+	return poller->base;
+}
+
+struct evdns_base	*zbx_async_poller_get_dnsbase(zbx_async_poller_t *poller)
+{
+	return poller->dnsbase;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: pass finished check back to poller                                *
+ *                                                                            *
+ * Comments: The check results are processed in batches by poller main loop.  *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_async_poller_check_done(zbx_async_check_t *check)
+{
+	zbx_timespec(&check->ts);
+	zbx_vector_ptr_append(&check->poller->checks_done, check);
+}
+
+static void	async_poller_start_check(zbx_async_poller_t *poller, zbx_async_check_t *check)
+{
+	if (SUCCEED != check->errcode)
+	{
+		/* item preparation failed */
+		zbx_async_poller_check_done(check);
+		return;
+	}
+
+	switch (poller->poller_type)
+	{
+		case ZBX_POLLER_TYPE_AGENT:
+			zbx_async_check_agent(check, CONFIG_TIMEOUT);
+			break;
+#ifdef HAVE_LIBCURL
+		case ZBX_POLLER_TYPE_HTTPAGENT:
+			zbx_async_check_http(poller->http, check);
+			break;
+#endif
+#ifdef HAVE_NETSNMP
+		case ZBX_POLLER_TYPE_SNMP:
+			zbx_async_check_snmp(poller->snmp, check);
+			break;
+#endif
+		default:
+			THIS_SHOULD_NEVER_HAPPEN;
+			SET_MSG_RESULT(&check->result, zbx_dsprintf(NULL, "Not supported item type:%d",
+					check->item.type));
+			check->errcode = CONFIG_ERROR;
+			zbx_async_poller_check_done(check);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: check if the number of concurrent interface checks is limited     *
+ *                                                                            *
+ ******************************************************************************/
+static int	async_poller_interface_limited(const zbx_async_poller_t *poller, zbx_uint64_t interfaceid)
+{
+	/* checks without interface (HTTP agent items) are not limited */
+	if (0 == interfaceid)
+		return FAIL;
+
+	/* SNMP checks of one interface are combined in requests sent one at a time */
+	if (ZBX_POLLER_TYPE_SNMP == poller->poller_type)
+		return FAIL;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: start check or queue it until interface has free connection slot  *
+ *                                                                            *
+ ******************************************************************************/
+static void	async_poller_queue_check(zbx_async_poller_t *poller, zbx_async_check_t *check)
+{
+	zbx_async_interface_t	*interface;
+
+	if (SUCCEED != async_poller_interface_limited(poller, check->item.interface.interfaceid))
+	{
+		async_poller_start_check(poller, check);
+		return;
+	}
+
+	if (NULL == (interface = (zbx_async_interface_t *)zbx_hashset_search(&poller->interfaces,
+			&check->item.interface.interfaceid)))
+	{
+		zbx_async_interface_t	interface_local = {.interfaceid = check->item.interface.interfaceid};
+
+		interface = (zbx_async_interface_t *)zbx_hashset_insert(&poller->interfaces, &interface_local,
+				sizeof(interface_local));
+		zbx_list_create(&interface->checks);
+	}
+
+	if (interface->checks_num >= CONFIG_MAX_CONCURRENT_CHECKS_PER_INTERFACE)
+	{
+		zbx_list_append(&interface->checks, check, NULL);
+		poller->queued_num++;
+		return;
+	}
+
+	interface->checks_num++;
+	async_poller_start_check(poller, check);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: release interface connection slot and start the next check        *
+ *          waiting for it                                                    *
+ *                                                                            *
+ ******************************************************************************/
+static void	async_poller_release_interface(zbx_async_poller_t *poller, zbx_uint64_t interfaceid)
+{
+	zbx_async_interface_t	*interface;
+	zbx_async_check_t	*check;
+
+	if (SUCCEED != async_poller_interface_limited(poller, interfaceid))
+		return;
+
+	if (NULL == (interface = (zbx_async_interface_t *)zbx_hashset_search(&poller->interfaces, &interfaceid)))
+	{
+		THIS_SHOULD_NEVER_HAPPEN;
+		return;
+	}
+
+	if (SUCCEED == zbx_list_pop(&interface->checks, (void **)&check))
+	{
+		poller->queued_num--;
+		async_poller_start_check(poller, check);
+		return;
+	}
+
+	if (0 == --interface->checks_num)
+	{
+		zbx_list_destroy(&interface->checks);
+		zbx_hashset_remove_direct(&poller->interfaces, interface);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: take items scheduled for checking from configuration cache and    *
+ *          start their checks                                                *
+ *                                                                            *
+ * Return value: the number of started checks                                 *
+ *                                                                            *
+ ******************************************************************************/
+static int	async_poller_get_items(zbx_async_poller_t *poller)
+{
+	DC_ITEM		item, *items;
+	AGENT_RESULT	results[MAX_POLLER_ITEMS];
+	int		errcodes[MAX_POLLER_ITEMS], i, num, total = 0;
+
+	while (poller->checks_num < poller->checks_max)
+	{
+		items = &item;
+
+		if (0 == (num = DCconfig_get_async_poller_items(poller->poller_type,
+				poller->checks_max - poller->checks_num, &items)))
+		{
+			break;
+		}
+
+		zbx_prepare_items(items, errcodes, num, results, MACRO_EXPAND_YES);
+
+		for (i = 0; i < num; i++)
+		{
+			zbx_async_check_t	*check;
+
+			check = (zbx_async_check_t *)zbx_malloc(NULL, sizeof(zbx_async_check_t));
+			check->item = items[i];
+			check->result = results[i];
+			check->errcode = errcodes[i];
+			check->poller = poller;
+
+			poller->checks_num++;
+			async_poller_queue_check(poller, check);
+		}
+
+		if (items != &item)
+			zbx_free(items);
+
+		total += num;
+	}
+
+	return total;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: process finished checks and return their items to queue           *
+ *                                                                            *
+ * Parameters: poller    - [IN] the poller                                    *
+ *             nextcheck - [OUT] the next scheduled check in poller queue     *
+ *                                                                            *
+ * Return value: the number of processed checks                               *
+ *                                                                            *
+ ******************************************************************************/
+static int	async_poller_process_results(zbx_async_poller_t *poller, int *nextcheck)
+{
+	zbx_vector_ptr_t	checks;
+	zbx_uint64_t		*itemids;
+	int			*lastclocks, *errcodes, i;
+	unsigned char		*data = NULL;
+	size_t			data_alloc = 0, data_offset = 0;
+
+	if (0 == poller->checks_done.values_num)
+		return 0;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() checks:%d", __func__, poller->checks_done.values_num);
+
+	/* checks finished while releasing interface slots are processed during next call */
+	zbx_vector_ptr_create(&checks);
+	zbx_vector_ptr_append_array(&checks, poller->checks_done.values, poller->checks_done.values_num);
+	zbx_vector_ptr_clear(&poller->checks_done);
+
+	itemids = (zbx_uint64_t *)zbx_malloc(NULL, sizeof(zbx_uint64_t) * (size_t)checks.values_num);
+	lastclocks = (int *)zbx_malloc(NULL, sizeof(int) * (size_t)checks.values_num);
+	errcodes = (int *)zbx_malloc(NULL, sizeof(int) * (size_t)checks.values_num);
+
+	for (i = 0; i < checks.values_num; i++)
+	{
+		zbx_async_check_t	*check = (zbx_async_check_t *)checks.values[i];
+		DC_ITEM			*item = &check->item;
+
+		if (SUCCEED != check->errcode && !ISSET_MSG(&check->result))
+			SET_MSG_RESULT(&check->result, zbx_strdup(NULL, ZBX_NOTSUPPORTED_MSG));
+
+		switch (check->errcode)
+		{
+			case SUCCEED:
+			case NOTSUPPORTED:
+			case AGENT_ERROR:
+				zbx_activate_item_interface(&check->ts, item, &data, &data_alloc, &data_offset);
+				break;
+			case NETWORK_ERROR:
+			case GATEWAY_ERROR:
+			case TIMEOUT_ERROR:
+				zbx_deactivate_item_interface(&check->ts, item, &data, &data_alloc, &data_offset,
+						check->result.msg);
+				break;
+			case CONFIG_ERROR:
+				/* nothing to do */
+				break;
+			default:
+				zbx_error("unknown response code returned: %d", check->errcode);
+				THIS_SHOULD_NEVER_HAPPEN;
+		}
+
+		if (SUCCEED == check->errcode)
+		{
+			item->state = ITEM_STATE_NORMAL;
+			zbx_preprocess_item_value(item->itemid, item->host.hostid, item->value_type, item->flags,
+					&check->result, &check->ts, item->state, NULL);
+		}
+		else if (NOTSUPPORTED == check->errcode || AGENT_ERROR == check->errcode ||
+				CONFIG_ERROR == check->errcode)
+		{
+			item->state = ITEM_STATE_NOTSUPPORTED;
+			zbx_preprocess_item_value(item->itemid, item->host.hostid, item->value_type, item->flags,
+					NULL, &check->ts, item->state, check->result.msg);
+		}
+
+		itemids[i] = item->itemid;
+		lastclocks[i] = check->ts.sec;
+		errcodes[i] = check->errcode;
+	}
+
+	DCpoller_requeue_items(itemids, lastclocks, errcodes, (size_t)checks.values_num, poller->poller_type,
+			nextcheck);
+
+	zbx_preprocessor_flush();
+
+	if (NULL != data)
+	{
+		zbx_availability_flush(data, data_offset);
+		zbx_free(data);
+	}
+
+	for (i = 0; i < checks.values_num; i++)
+	{
+		zbx_async_check_t	*check = (zbx_async_check_t *)checks.values[i];
+
+		async_poller_release_interface(poller, check->item.interface.interfaceid);
+
+		zbx_clean_items(&check->item, 1, &check->result);
+		DCconfig_clean_items(&check->item, NULL, 1);
+		zbx_free(check);
+	}
+
+	poller->checks_num -= checks.values_num;
+
+	zbx_free(errcodes);
+	zbx_free(lastclocks);
+	zbx_free(itemids);
+
+	i = checks.values_num;
+	zbx_vector_ptr_destroy(&checks);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%d", __func__, i);
+
+	return i;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: update the number of checks in progress and waiting for           *
+ *          connection slot in configuration cache                            *
+ *                                                                            *
+ ******************************************************************************/
+static void	async_poller_update_stats(zbx_async_poller_t *poller)
+{
+	int	checks;
+
+	checks = poller->checks_num - poller->queued_num;
+
+	if (checks == poller->checks_reported && poller->queued_num == poller->queued_reported)
+		return;
+
+	DCupdate_async_poller_stats(poller->poller_type, checks - poller->checks_reported,
+			poller->queued_num - poller->queued_reported);
+
+	poller->checks_reported = checks;
+	poller->queued_reported = poller->queued_num;
+}
+
+static void	async_poller_timer_cb(evutil_socket_t fd, short what, void *arg)
+{
+	ZBX_UNUSED(fd);
+	ZBX_UNUSED(what);
+	ZBX_UNUSED(arg);
+
+	/* the timer only interrupts event loop to check item queue */
+}
+
+static void	async_poller_init(zbx_async_poller_t *poller, unsigned char poller_type)
+{
+	poller->poller_type = poller_type;
+	poller->checks_num = 0;
+	poller->checks_max = CONFIG_MAX_CONCURRENT_CHECKS_PER_POLLER;
+	poller->queued_num = 0;
+	poller->checks_reported = 0;
+	poller->queued_reported = 0;
+
+	if (NULL == (poller->base = event_base_new()))
+	{
+		zabbix_log(LOG_LEVEL_CRIT, "cannot initialize event base");
+		exit(EXIT_FAILURE);
+	}
+
+	if (NULL == (poller->dnsbase = evdns_base_new(poller->base, EVDNS_BASE_INITIALIZE_NAMESERVERS)))
+	{
+		zabbix_log(LOG_LEVEL_CRIT, "cannot initialize asynchronous DNS resolver");
+		exit(EXIT_FAILURE);
+	}
+
+	poller->ev_timer = evtimer_new(poller->base, async_poller_timer_cb, NULL);
+
+#ifdef HAVE_LIBCURL
+	if (ZBX_POLLER_TYPE_HTTPAGENT == poller_type)
+	{
+		char	*error = NULL;
+
+		if (NULL == (poller->http = zbx_async_http_create(poller->base, poller->checks_max, &error)))
+		{
+			zabbix_log(LOG_LEVEL_CRIT, "%s", error);
+			zbx_free(error);
+			exit(EXIT_FAILURE);
+		}
+	}
+	else
+		poller->http = NULL;
+#endif
+#ifdef HAVE_NETSNMP
+	if (ZBX_POLLER_TYPE_SNMP == poller_type)
+		poller->snmp = zbx_async_snmp_create(poller->base);
+	else
+		poller->snmp = NULL;
+#endif
+
+	zbx_hashset_create(&poller->interfaces, 100, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	zbx_vector_ptr_create(&poller->checks_done);
+}
+
+ZBX_THREAD_ENTRY(async_poller_thread, args)
+{
+	zbx_async_poller_t	poller;
+	int			nextcheck = FAIL, sleeptime, processed = 0;
+	double			sec, time_stat, time_update_stats = 0;
+	unsigned char		poller_type;
+	zbx_ipc_async_socket_t	rtc;
+
+#define	STAT_INTERVAL	5	/* if a process is busy and does not sleep then update status not faster than */
+				/* once in STAT_INTERVAL seconds */
+
+	poller_type = *(unsigned char *)((zbx_thread_args_t *)args)->args;
+	process_type = ((zbx_thread_args_t *)args)->process_type;
+	server_num = ((zbx_thread_args_t *)args)->server_num;
+	process_num = ((zbx_thread_args_t *)args)->process_num;
+
+	zabbix_log(LOG_LEVEL_INFORMATION, "%s #%d started [%s #%d]", get_program_type_string(program_type),
+			server_num, get_process_type_string(process_type), process_num);
+
+	update_selfmon_counter(ZBX_PROCESS_STATE_BUSY);
+
+	async_poller_init(&poller, poller_type);
+
+	zbx_setproctitle("%s #%d started", get_process_type_string(process_type), process_num);
+	time_stat = zbx_time();
+
+	zbx_rtc_subscribe(&rtc, process_type, process_num);
+
+	while (ZBX_IS_RUNNING())
+	{
+		zbx_uint32_t	rtc_cmd;
+		unsigned char	*rtc_data;
+		struct timeval	tv;
+
+		sec = zbx_time();
+		zbx_update_env(get_process_type_string(process_type), sec);
+
+		processed += async_poller_process_results(&poller, &nextcheck);
+
+		if (poller.checks_num < poller.checks_max)
+		{
+			async_poller_get_items(&poller);
+
+			if (poller.checks_num < poller.checks_max)
+				nextcheck = DCconfig_get_poller_nextcheck(poller_type);
+		}
+
+		if (0 != poller.checks_done.values_num)
+			sleeptime = 0;
+		else if (poller.checks_num < poller.checks_max)
+			sleeptime = calculate_sleeptime(nextcheck, POLLER_DELAY);
+		else
+			sleeptime = POLLER_DELAY;
+
+		if (1 <= sec - time_update_stats)
+		{
+			async_poller_update_stats(&poller);
+			time_update_stats = sec;
+		}
+
+		if (STAT_INTERVAL <= sec - time_stat)
+		{
+			zbx_setproctitle("%s #%d [got %d values in " ZBX_FS_DBL " sec, %d checks in progress,"
+					" %d queued]", get_process_type_string(process_type), process_num, processed,
+					sec - time_stat, poller.checks_num - poller.queued_num, poller.queued_num);
+
+			processed = 0;
+			time_stat = sec;
+		}
+
+		tv.tv_sec = sleeptime;
+		tv.tv_usec = 0;
+		evtimer_add(poller.ev_timer, &tv);
+
+		update_selfmon_counter(ZBX_PROCESS_STATE_IDLE);
+		event_base_loop(poller.base, EVLOOP_ONCE);
+		update_selfmon_counter(ZBX_PROCESS_STATE_BUSY);
+
+		evtimer_del(poller.ev_timer);
+
+		if (SUCCEED == zbx_rtc_wait(&rtc, &rtc_cmd, &rtc_data, 0) && 0 != rtc_cmd)
+		{
+			if (ZBX_RTC_SHUTDOWN == rtc_cmd)
+				break;
+		}
+	}
+
+	zbx_setproctitle("%s #%d [terminated]", get_process_type_string(process_type), process_num);
+
+	while (1)
+		zbx_sleep(SEC_PER_MIN);
+#undef STAT_INTERVAL
+}
@@ -0,0 +1,51 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2025 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#ifndef ZABBIX_ASYNC_POLLER_H
+#define ZABBIX_ASYNC_POLLER_H
+
+#include "threads.h"
+#include "dbcache.h"
+
+extern int	CONFIG_MAX_CONCURRENT_CHECKS_PER_POLLER;
+extern int	CONFIG_MAX_CONCURRENT_CHECKS_PER_INTERFACE;
+
+typedef struct zbx_async_poller	zbx_async_poller_t;
+
+/* check executed by asynchronous poller */
+typedef struct
+{
+	DC_ITEM			item;
+	AGENT_RESULT		result;
+	int			errcode;
+
+	/* the time when check was finished */
+	zbx_timespec_t		ts;
+
+	zbx_async_poller_t	*poller;
+}
+zbx_async_check_t;
+
+struct event_base	*zbx_async_poller_get_base(zbx_async_poller_t *poller);
+struct evdns_base	*zbx_async_poller_get_dnsbase(zbx_async_poller_t *poller);
+void	zbx_async_poller_check_done(zbx_async_check_t *check);
+
+ZBX_THREAD_ENTRY(async_poller_thread, args);
+
+#endif
@@ -0,0 +1,640 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2025 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "async_snmp.h"
+
+#ifdef HAVE_NETSNMP
+
+#define SNMP_NO_DEBUGGING		/* disabling debugging messages from Net-SNMP library */
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+
+#include "checks_snmp.h"
+#include "log.h"
+
+#include <event.h>
+
+/*
+ * Asynchronous SNMP checks
+ * ========================
+ *
+ * Checks are grouped by interface. Each interface has one SNMP session and at most one GET request in
+ * progress, checks arriving meanwhile are queued and sent in the next request, so devices are not flooded
+ * with parallel requests. Requests of all interfaces are sent without waiting for responses of other
+ * interfaces, responses and timeouts are processed by the poller event loop.
+ *
+ * The number of variables in one request is based on configuration cache suggestion. When device does not
+ * handle the request (tooBig error, timeout or response not matching the request), the request is split like
+ * in synchronous checks - first in halves and then sending variables one by one. The largest successful and
+ * the smallest failed request sizes are reported back to configuration cache when the interface becomes idle.
+ */
+
+typedef struct
+{
+	zbx_async_check_t	*check;
+	oid			name[MAX_OID_LEN];
+	size_t			name_len;
+}
+zbx_async_snmp_check_t;
+
+typedef struct
+{
+	zbx_uint64_t		interfaceid;
+	zbx_async_snmp_t	*snmp;
+
+	void			*sessp;
+	struct event		*ev_read;
+	struct event		*ev_timeout;
+
+	/* checks waiting to be sent */
+	zbx_vector_ptr_t	queue;
+
+	/* checks of the request in progress */
+	zbx_vector_ptr_t	request;
+
+	/* the identifier of request in progress, 0 if there is no request */
+	int			reqid;
+
+	/* set when the interface is waiting in send queue */
+	unsigned char		scheduled;
+
+	/* set when the interface failed with network error */
+	unsigned char		failed;
+
+	/* bulk request adaptation */
+	int			bulk;
+	int			max_vars;
+	int			level;
+	int			max_succeed;
+	int			min_fail;
+}
+zbx_async_snmp_interface_t;
+
+struct zbx_async_snmp
+{
+	struct event_base	*base;
+	zbx_hashset_t		interfaces;
+
+	/* interfaces with checks to send, requests are sent when all started checks are queued */
+	zbx_vector_uint64_t	send_queue;
+	struct event		*ev_send;
+};
+
+static void	async_snmp_finish_check(zbx_async_snmp_check_t *scheck, int errcode)
+{
+	zbx_async_check_t	*check = scheck->check;
+
+	check->errcode = errcode;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "%s() itemid:" ZBX_FS_UI64 " key:'%s' %s", __func__, check->item.itemid,
+			check->item.key, zbx_result_string(check->errcode));
+
+	zbx_free(scheck);
+	zbx_async_poller_check_done(check);
+}
+
+static void	async_snmp_fail_checks(zbx_vector_ptr_t *checks, int errcode, const char *error)
+{
+	int	i;
+
+	for (i = 0; i < checks->values_num; i++)
+	{
+		zbx_async_snmp_check_t	*scheck = (zbx_async_snmp_check_t *)checks->values[i];
+
+		SET_MSG_RESULT(&scheck->check->result, zbx_strdup(NULL, error));
+		async_snmp_finish_check(scheck, errcode);
+	}
+
+	zbx_vector_ptr_clear(checks);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: return checks of the failed request to the front of send queue    *
+ *                                                                            *
+ ******************************************************************************/
+static void	async_snmp_requeue(zbx_async_snmp_interface_t *iface)
+{
+	zbx_vector_ptr_t	tmp;
+
+	zbx_vector_ptr_append_array(&iface->request, iface->queue.values, iface->queue.values_num);
+	zbx_vector_ptr_clear(&iface->queue);
+
+	tmp = iface->queue;
+	iface->queue = iface->request;
+	iface->request = tmp;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: reduce request size after device failed to handle the request     *
+ *                                                                            *
+ ******************************************************************************/
+static void	async_snmp_halve(zbx_async_snmp_interface_t *iface)
+{
+	int	num = iface->request.values_num;
+
+	if (iface->min_fail > num)
+		iface->min_fail = num;
+
+	/* split request in halves first and then resort to querying variables one by one */
+	iface->max_vars = (0 == iface->level++ ? num / 2 : 1);
+
+	async_snmp_requeue(iface);
+}
+
+static void	async_snmp_close(zbx_async_snmp_interface_t *iface)
+{
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() interfaceid:" ZBX_FS_UI64, __func__, iface->interfaceid);
+
+	if (0 == iface->failed && SNMP_BULK_ENABLED == iface->bulk &&
+			(0 != iface->max_succeed || MAX_SNMP_ITEMS + 1 != iface->min_fail))
+	{
+		DCconfig_update_interface_snmp_stats(iface->interfaceid, iface->max_succeed, iface->min_fail);
+	}
+
+	if (NULL != iface->ev_read)
+		event_free(iface->ev_read);
+
+	if (NULL != iface->ev_timeout)
+		event_free(iface->ev_timeout);
+
+	if (NULL != iface->sessp)
+		zbx_snmp_sess_close(iface->sessp);
+
+	zbx_vector_ptr_destroy(&iface->request);
+	zbx_vector_ptr_destroy(&iface->queue);
+
+	zbx_hashset_remove_direct(&iface->snmp->interfaces, iface);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: set values of request checks from response variables              *
+ *                                                                            *
+ * Return value: SUCCEED - the values were set                                *
+ *               FAIL    - the response does not match request, the checks    *
+ *                         were queued for smaller request or failed          *
+ *                                                                            *
+ ******************************************************************************/
+static int	async_snmp_process_vars(zbx_async_snmp_interface_t *iface, const struct snmp_pdu *response)
+{
+	const struct variable_list	*var;
+	zbx_async_snmp_check_t		*scheck;
+	int				i, num = iface->request.values_num;
+	unsigned char			val_type;
+	const char			*host = ((zbx_async_snmp_check_t *)iface->request.values[0])->check->item.host.host;
+
+	/* validate the whole response before setting values, the request can be split and sent again */
+	for (i = 0, var = response->variables;; i++, var = var->next_variable)
+	{
+		if (i == num)
+		{
+			if (NULL != var)
+			{
+				zabbix_log(LOG_LEVEL_WARNING, "SNMP response from host \"%s\" contains too many"
+						" variable bindings", host);
+
+				if (1 != num)	/* give device a chance to handle a smaller request */
+					async_snmp_halve(iface);
+				else
+					async_snmp_fail_checks(&iface->request, NOTSUPPORTED,
+							"Invalid SNMP response: too many variable bindings.");
+
+				return FAIL;
+			}
+
+			break;
+		}
+
+		if (NULL == var)
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "SNMP response from host \"%s\" contains too few"
+					" variable bindings", host);
+
+			if (1 != num)	/* give device a chance to handle a smaller request */
+				async_snmp_halve(iface);
+			else
+				async_snmp_fail_checks(&iface->request, NOTSUPPORTED,
+						"Invalid SNMP response: too few variable bindings.");
+
+			return FAIL;
+		}
+
+		scheck = (zbx_async_snmp_check_t *)iface->request.values[i];
+
+		if (scheck->name_len != var->name_length || 0 != memcmp(scheck->name, var->name,
+				scheck->name_len * sizeof(oid)))
+		{
+			zabbix_log(1 != num ? LOG_LEVEL_WARNING : LOG_LEVEL_DEBUG, "SNMP response from host \"%s\""
+					" contains variable bindings that do not match the request", host);
+
+			if (1 != num)	/* give device a chance to handle a smaller request */
+			{
+				async_snmp_halve(iface);
+				return FAIL;
+			}
+		}
+	}
+
+	for (i = 0, var = response->variables; i < num; i++, var = var->next_variable)
+	{
+		int	errcode;
+
+		scheck = (zbx_async_snmp_check_t *)iface->request.values[i];
+		errcode = zbx_snmp_set_result(var, &scheck->check->result, &val_type);
+
+		if (ISSET_TEXT(&scheck->check->result) && ZBX_SNMP_STR_HEX == val_type)
+			zbx_remove_chars(scheck->check->result.text, "\r\n");
+
+		async_snmp_finish_check(scheck, errcode);
+	}
+
+	zbx_vector_ptr_clear(&iface->request);
+
+	if (iface->max_succeed < num)
+		iface->max_succeed = num;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: process result of the request in progress                         *
+ *                                                                            *
+ * Comments: Follows zbx_snmp_get_values() logic of synchronous checks.       *
+ *                                                                            *
+ ******************************************************************************/
+static void	async_snmp_process_response(zbx_async_snmp_interface_t *iface, const struct snmp_session *ss,
+		int status, const struct snmp_pdu *response)
+{
+	zbx_async_snmp_check_t	*scheck = (zbx_async_snmp_check_t *)iface->request.values[0];
+	char			error[MAX_STRING_LEN];
+	int			i, ret, num = iface->request.values_num;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() interfaceid:" ZBX_FS_UI64 " status:%d s_snmp_errno:%d errstat:%ld"
+			" num:%d", __func__, iface->interfaceid, status, ss->s_snmp_errno,
+			NULL == response ? (long)-1 : response->errstat, num);
+
+	if (STAT_SUCCESS == status && SNMP_ERR_NOERROR == response->errstat)
+	{
+		(void)async_snmp_process_vars(iface, response);
+		goto out;
+	}
+
+	if (STAT_SUCCESS == status && SNMP_ERR_NOSUCHNAME == response->errstat && 0 != response->errindex)
+	{
+		/* the request contains bad variable, remove it and send the remaining variables again */
+
+		i = response->errindex - 1;
+
+		if (0 > i || i >= num)
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "SNMP response from host \"%s\" contains an out of bounds error"
+					" index: %ld", scheck->check->item.host.host, response->errindex);
+
+			async_snmp_fail_checks(&iface->request, NOTSUPPORTED,
+					"Invalid SNMP response: error index out of bounds.");
+			goto out;
+		}
+
+		scheck = (zbx_async_snmp_check_t *)iface->request.values[i];
+		zbx_vector_ptr_remove(&iface->request, i);
+
+		ret = zbx_get_snmp_response_error(ss, &scheck->check->item.interface, status, response, error,
+				sizeof(error));
+		SET_MSG_RESULT(&scheck->check->result, zbx_strdup(NULL, error));
+		async_snmp_finish_check(scheck, ret);
+
+		async_snmp_requeue(iface);
+		goto out;
+	}
+
+	if (1 < num && ((STAT_SUCCESS == status && SNMP_ERR_TOOBIG == response->errstat) || STAT_TIMEOUT == status ||
+			(STAT_ERROR == status && SNMPERR_TOO_LONG == ss->s_snmp_errno)))
+	{
+		/* see zbx_snmp_get_values() for explanation */
+		async_snmp_halve(iface);
+		goto out;
+	}
+
+	ret = zbx_get_snmp_response_error(ss, &scheck->check->item.interface, status, response, error,
+			sizeof(error));
+
+	async_snmp_fail_checks(&iface->request, ret, error);
+
+	/* device is not reachable, do not wait for timeouts of the queued checks */
+	if (NETWORK_ERROR == ret)
+	{
+		async_snmp_fail_checks(&iface->queue, ret, error);
+		iface->failed = 1;
+	}
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+}
+
+static int	async_snmp_response_cb(int operation, netsnmp_session *ss, int reqid, netsnmp_pdu *pdu, void *magic)
+{
+	zbx_async_snmp_interface_t	*iface = (zbx_async_snmp_interface_t *)magic;
+	int				status;
+
+	if (reqid != iface->reqid)
+		return 1;
+
+	iface->reqid = 0;
+	evtimer_del(iface->ev_timeout);
+
+	switch (operation)
+	{
+		case NETSNMP_CALLBACK_OP_RECEIVED_MESSAGE:
+			status = STAT_SUCCESS;
+			break;
+		case NETSNMP_CALLBACK_OP_TIMED_OUT:
+			status = STAT_TIMEOUT;
+			break;
+		default:
+			status = STAT_ERROR;
+	}
+
+	/* the response is freed by Net-SNMP library after callback returns */
+	async_snmp_process_response(iface, ss, status, STAT_SUCCESS == status ? pdu : NULL);
+
+	return 1;
+}
+
+static void	async_snmp_arm_timeout(zbx_async_snmp_interface_t *iface)
+{
+	/* Net-SNMP checks request expiration with microsecond precision, add some slack to avoid */
+	/* checking timeouts just before the request expires                                      */
+	struct timeval	tv = {CONFIG_TIMEOUT, 10000};
+
+	evtimer_add(iface->ev_timeout, &tv);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: send queued checks in one request                                 *
+ *                                                                            *
+ ******************************************************************************/
+static void	async_snmp_send(zbx_async_snmp_interface_t *iface)
+{
+	struct snmp_pdu		*pdu;
+	netsnmp_session		*ss;
+	int			i, num;
+	char			error[MAX_STRING_LEN];
+
+	num = MIN(iface->queue.values_num, iface->max_vars);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() interfaceid:" ZBX_FS_UI64 " num:%d level:%d", __func__,
+			iface->interfaceid, num, iface->level);
+
+	if (NULL == (pdu = snmp_pdu_create(SNMP_MSG_GET)))
+	{
+		async_snmp_fail_checks(&iface->queue, CONFIG_ERROR, "snmp_pdu_create(): cannot create PDU object.");
+		goto out;
+	}
+
+	for (i = 0; i < num; i++)
+	{
+		zbx_async_snmp_check_t	*scheck = (zbx_async_snmp_check_t *)iface->queue.values[i];
+
+		snmp_add_null_var(pdu, scheck->name, scheck->name_len);
+		zbx_vector_ptr_append(&iface->request, scheck);
+	}
+
+	memmove(iface->queue.values, iface->queue.values + num, sizeof(void *) * (iface->queue.values_num - num));
+	iface->queue.values_num -= num;
+
+	ss = snmp_sess_session(iface->sessp);
+	ss->retries = (1 == num && 0 == iface->level ? 1 : 0);
+
+	if (0 == (iface->reqid = snmp_sess_async_send(iface->sessp, pdu, async_snmp_response_cb, iface)))
+	{
+		snmp_free_pdu(pdu);
+
+		(void)zbx_get_snmp_response_error(ss, &((zbx_async_snmp_check_t *)iface->request.values[0])->
+				check->item.interface, STAT_ERROR, NULL, error, sizeof(error));
+
+		async_snmp_fail_checks(&iface->request, NETWORK_ERROR, error);
+		async_snmp_fail_checks(&iface->queue, NETWORK_ERROR, error);
+		iface->failed = 1;
+		goto out;
+	}
+
+	async_snmp_arm_timeout(iface);
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: send next request or close idle interface                         *
+ *                                                                            *
+ * Comments: Must not be called from Net-SNMP callbacks.                      *
+ *                                                                            *
+ ******************************************************************************/
+static void	async_snmp_update(zbx_async_snmp_interface_t *iface)
+{
+	if (0 != iface->reqid)
+		return;
+
+	if (0 != iface->queue.values_num)
+		async_snmp_send(iface);
+
+	if (0 == iface->reqid && 0 == iface->queue.values_num && 0 == iface->scheduled)
+		async_snmp_close(iface);
+}
+
+static void	async_snmp_read_cb(evutil_socket_t fd, short what, void *arg)
+{
+	zbx_async_snmp_interface_t	*iface = (zbx_async_snmp_interface_t *)arg;
+	netsnmp_large_fd_set		fdset;
+
+	ZBX_UNUSED(what);
+
+	netsnmp_large_fd_set_init(&fdset, fd + 1);
+	NETSNMP_LARGE_FD_SET(fd, &fdset);
+	snmp_sess_read2(iface->sessp, &fdset);
+	netsnmp_large_fd_set_cleanup(&fdset);
+
+	async_snmp_update(iface);
+}
+
+static void	async_snmp_timeout_cb(evutil_socket_t fd, short what, void *arg)
+{
+	zbx_async_snmp_interface_t	*iface = (zbx_async_snmp_interface_t *)arg;
+
+	ZBX_UNUSED(fd);
+	ZBX_UNUSED(what);
+
+	/* resends the request if retries are left or reports timeout through response callback */
+	snmp_sess_timeout(iface->sessp);
+
+	if (0 != iface->reqid)
+		async_snmp_arm_timeout(iface);
+	else
+		async_snmp_update(iface);
+}
+
+static void	async_snmp_send_cb(evutil_socket_t fd, short what, void *arg)
+{
+	zbx_async_snmp_t		*snmp = (zbx_async_snmp_t *)arg;
+	zbx_async_snmp_interface_t	*iface;
+	int				i;
+
+	ZBX_UNUSED(fd);
+	ZBX_UNUSED(what);
+
+	for (i = 0; i < snmp->send_queue.values_num; i++)
+	{
+		if (NULL == (iface = (zbx_async_snmp_interface_t *)zbx_hashset_search(&snmp->interfaces,
+				&snmp->send_queue.values[i])))
+		{
+			continue;
+		}
+
+		iface->scheduled = 0;
+		async_snmp_update(iface);
+	}
+
+	zbx_vector_uint64_clear(&snmp->send_queue);
+}
+
+static zbx_async_snmp_interface_t	*async_snmp_open(zbx_async_snmp_t *snmp, const DC_ITEM *item, char *error,
+		size_t max_error_len)
+{
+	zbx_async_snmp_interface_t	iface_local, *iface;
+	void				*sessp;
+	netsnmp_transport		*transport;
+
+	zbx_init_snmp();	/* avoid high CPU usage by only initializing SNMP once used */
+
+	if (NULL == (sessp = zbx_snmp_sess_open(item, error, max_error_len)))
+		return NULL;
+
+	if (NULL == (transport = snmp_sess_transport(sessp)))
+	{
+		zbx_snmp_sess_close(sessp);
+		zbx_strlcpy(error, "Cannot get SNMP session transport", max_error_len);
+		return NULL;
+	}
+
+	memset(&iface_local, 0, sizeof(iface_local));
+	iface_local.interfaceid = item->interface.interfaceid;
+	iface = (zbx_async_snmp_interface_t *)zbx_hashset_insert(&snmp->interfaces, &iface_local,
+			sizeof(iface_local));
+
+	iface->snmp = snmp;
+	iface->sessp = sessp;
+	zbx_vector_ptr_create(&iface->queue);
+	zbx_vector_ptr_create(&iface->request);
+
+	iface->max_vars = DCconfig_get_suggested_snmp_vars(iface->interfaceid, &iface->bulk);
+	iface->min_fail = MAX_SNMP_ITEMS + 1;
+
+	iface->ev_read = event_new(snmp->base, transport->sock, EV_READ | EV_PERSIST, async_snmp_read_cb, iface);
+	event_add(iface->ev_read, NULL);
+	iface->ev_timeout = evtimer_new(snmp->base, async_snmp_timeout_cb, iface);
+
+	return iface;
+}
+
+zbx_async_snmp_t	*zbx_async_snmp_create(struct event_base *base)
+{
+	zbx_async_snmp_t	*snmp;
+
+	snmp = (zbx_async_snmp_t *)zbx_malloc(NULL, sizeof(zbx_async_snmp_t));
+	snmp->base = base;
+	zbx_hashset_create(&snmp->interfaces, 100, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	zbx_vector_uint64_create(&snmp->send_queue);
+	snmp->ev_send = evtimer_new(base, async_snmp_send_cb, snmp);
+
+	return snmp;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: start asynchronous SNMP check                                     *
+ *                                                                            *
+ * Parameters: snmp  - [IN] the asynchronous SNMP checks                      *
+ *             check - [IN] the check to start                                *
+ *                                                                            *
+ * Comments: Only SNMPv1/v2c items with plain OIDs are supported.             *
+ *           The check is passed back to poller with                          *
+ *           zbx_async_poller_check_done() when it's finished, which can      *
+ *           also happen before this function returns.                        *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_async_check_snmp(zbx_async_snmp_t *snmp, zbx_async_check_t *check)
+{
+	zbx_async_snmp_check_t		*scheck;
+	zbx_async_snmp_interface_t	*iface;
+	char				oid_translated[ITEM_SNMP_OID_LEN_MAX], error[MAX_STRING_LEN];
+	DC_ITEM				*item = &check->item;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() host:'%s' addr:'%s' oid:'%s'", __func__, item->host.host,
+			item->interface.addr, item->snmp_oid);
+
+	scheck = (zbx_async_snmp_check_t *)zbx_malloc(NULL, sizeof(zbx_async_snmp_check_t));
+	scheck->check = check;
+
+	if (0 != num_key_param(item->snmp_oid))
+	{
+		SET_MSG_RESULT(&check->result, zbx_dsprintf(NULL, "OID \"%s\" contains unsupported parameters.",
+				item->snmp_oid));
+		async_snmp_finish_check(scheck, CONFIG_ERROR);
+		goto out;
+	}
+
+	zbx_snmp_translate(oid_translated, item->snmp_oid, sizeof(oid_translated));
+	scheck->name_len = MAX_OID_LEN;
+
+	if (NULL == snmp_parse_oid(oid_translated, scheck->name, &scheck->name_len))
+	{
+		SET_MSG_RESULT(&check->result, zbx_dsprintf(NULL, "snmp_parse_oid(): cannot parse OID \"%s\".",
+				oid_translated));
+		async_snmp_finish_check(scheck, CONFIG_ERROR);
+		goto out;
+	}
+
+	if (NULL == (iface = (zbx_async_snmp_interface_t *)zbx_hashset_search(&snmp->interfaces,
+			&item->interface.interfaceid)) &&
+			NULL == (iface = async_snmp_open(snmp, item, error, sizeof(error))))
+	{
+		SET_MSG_RESULT(&check->result, zbx_strdup(NULL, error));
+		async_snmp_finish_check(scheck, NETWORK_ERROR);
+		goto out;
+	}
+
+	zbx_vector_ptr_append(&iface->queue, scheck);
+
+	/* the request is sent after all checks started by poller are queued */
+	if (0 == iface->reqid && 0 == iface->scheduled)
+	{
+		struct timeval	tv = {0, 0};
+
+		zbx_vector_uint64_append(&snmp->send_queue, iface->interfaceid);
+		iface->scheduled = 1;
+		evtimer_add(snmp->ev_send, &tv);
+	}
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+}
+
+#endif
@@ -25,6 +25,57 @@
 extern unsigned char	program_type;
 #endif
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: convert Zabbix agent response to item value                       *
+ *                                                                            *
+ * Parameters: buffer       - [IN] the response data                          *
+ *             read_bytes   - [IN] the response data size                     *
+ *             received_len - [IN] the number of bytes received, including    *
+ *                                 protocol header                            *
+ *             addr         - [IN] the agent address                          *
+ *             result       - [OUT] the item value or error message           *
+ *                                                                            *
+ * Return value: SUCCEED - the value was stored in result                     *
+ *               NOTSUPPORTED - item not supported by the agent               *
+ *               AGENT_ERROR - uncritical error on agent side occurred        *
+ *               NETWORK_ERROR - empty response was received                  *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_agent_process_response(char *buffer, size_t read_bytes, size_t received_len, const char *addr,
+		AGENT_RESULT *result)
+{
+	zabbix_log(LOG_LEVEL_DEBUG, "get value from agent result: '%s'", buffer);
+
+	if (0 == strcmp(buffer, ZBX_NOTSUPPORTED))
+	{
+		/* 'ZBX_NOTSUPPORTED\0<error message>' */
+		if (sizeof(ZBX_NOTSUPPORTED) < read_bytes)
+			SET_MSG_RESULT(result, zbx_dsprintf(NULL, "%s", buffer + sizeof(ZBX_NOTSUPPORTED)));
+		else
+			SET_MSG_RESULT(result, zbx_strdup(NULL, "Not supported by Zabbix Agent"));
+
+		return NOTSUPPORTED;
+	}
+
+	if (0 == strcmp(buffer, ZBX_ERROR))
+	{
+		SET_MSG_RESULT(result, zbx_strdup(NULL, "Zabbix Agent non-critical error"));
+		return AGENT_ERROR;
+	}
+
+	if (0 == received_len)
+	{
+		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Received empty response from Zabbix Agent at [%s]."
+				" Assuming that agent dropped connection because of access permissions.", addr));
+		return NETWORK_ERROR;
+	}
+
+	set_result_type(result, ITEM_VALUE_TYPE_TEXT, buffer);
+
+	return SUCCEED;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: retrieve data from Zabbix agent                                   *
@@ -100,34 +151,7 @@ int	get_value_agent(const DC_ITEM *item, AGENT_RESULT *result)
 		ret = NETWORK_ERROR;
 
 	if (SUCCEED == ret)
-	{
-		zabbix_log(LOG_LEVEL_DEBUG, "get value from agent result: '%s'", s.buffer);
-
-		if (0 == strcmp(s.buffer, ZBX_NOTSUPPORTED))
-		{
-			/* 'ZBX_NOTSUPPORTED\0<error message>' */
-			if (sizeof(ZBX_NOTSUPPORTED) < s.read_bytes)
-				SET_MSG_RESULT(result, zbx_dsprintf(NULL, "%s", s.buffer + sizeof(ZBX_NOTSUPPORTED)));
-			else
-				SET_MSG_RESULT(result, zbx_strdup(NULL, "Not supported by Zabbix Agent"));
-
-			ret = NOTSUPPORTED;
-		}
-		else if (0 == strcmp(s.buffer, ZBX_ERROR))
-		{
-			SET_MSG_RESULT(result, zbx_strdup(NULL, "Zabbix Agent non-critical error"));
-			ret = AGENT_ERROR;
-		}
-		else if (0 == received_len)
-		{
-			SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Received empty response from Zabbix Agent at [%s]."
-					" Assuming that agent dropped connection because of access permissions.",
-					item->interface.addr));
-			ret = NETWORK_ERROR;
-		}
-		else
-			set_result_type(result, ITEM_VALUE_TYPE_TEXT, s.buffer);
-	}
+		ret = zbx_agent_process_response(s.buffer, s.read_bytes, received_len, item->interface.addr, result);
 	else
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Get value from agent failed: %s", zbx_socket_strerror()));
 
@@ -181,28 +181,37 @@ static void	http_output_json(unsigned char retrieve_mode, char **buffer, zbx_htt
 	zbx_json_free(&json);
 }
 
-int	get_value_http(const DC_ITEM *item, AGENT_RESULT *result)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: prepare cURL easy handle for HTTP agent item request              *
+ *                                                                            *
+ * Parameters: context - [OUT] the request context                            *
+ *             item    - [IN] the HTTP agent item                             *
+ *             result  - [OUT] the error message                              *
+ *                                                                            *
+ * Return value: SUCCEED - the request was prepared                           *
+ *               NOTSUPPORTED - otherwise                                     *
+ *                                                                            *
+ * Comments: The item must not be freed until the request is finished, the    *
+ *           context must be released with zbx_http_context_clean() also if   *
+ *           preparation failed.                                              *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_http_context_prepare(zbx_http_context_t *context, const DC_ITEM *item, AGENT_RESULT *result)
 {
-	CURL			*easyhandle;
-	CURLcode		err;
-	char			url[ITEM_URL_LEN_MAX], errbuf[CURL_ERROR_SIZE], *error = NULL, *headers, *line, *buffer;
-	int			ret = NOTSUPPORTED, timeout_seconds, found = FAIL;
-	long			response_code;
-	struct curl_slist	*headers_slist = NULL;
-	struct zbx_json		json;
-	zbx_http_response_t	body = {0}, header = {0};
-	zbx_curl_cb_t		curl_body_cb;
-	char			application_json[] = {"Content-Type: application/json"};
-	char			application_xml[] = {"Content-Type: application/xml"};
+	CURLcode	err;
+	char		url[ITEM_URL_LEN_MAX], *error = NULL, *headers, *line;
+	int		timeout_seconds, found = FAIL;
+	zbx_curl_cb_t	curl_body_cb;
+	char		application_json[] = {"Content-Type: application/json"};
+	char		application_xml[] = {"Content-Type: application/xml"};
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() request method '%s' URL '%s%s' headers '%s' message body '%s'",
-			__func__, zbx_request_string(item->request_method), item->url, item->query_fields,
-			item->headers, item->posts);
+	memset(context, 0, sizeof(zbx_http_context_t));
 
-	if (NULL == (easyhandle = curl_easy_init()))
+	if (NULL == (context->easyhandle = curl_easy_init()))
 	{
 		SET_MSG_RESULT(result, zbx_strdup(NULL, "Cannot initialize cURL library"));
-		goto clean;
+		return NOTSUPPORTED;
 	}
 
 	switch (item->retrieve_mode)
@@ -217,72 +226,73 @@ int	get_value_http(const DC_ITEM *item, AGENT_RESULT *result)
 		default:
 			THIS_SHOULD_NEVER_HAPPEN;
 			SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Invalid retrieve mode"));
-			goto clean;
+			return NOTSUPPORTED;
 	}
 
-	if (SUCCEED != zbx_http_prepare_callbacks(easyhandle, &header, &body, zbx_curl_write_cb, curl_body_cb, errbuf,
-			&error))
+	if (SUCCEED != zbx_http_prepare_callbacks(context->easyhandle, &context->header, &context->body,
+			zbx_curl_write_cb, curl_body_cb, context->errbuf, &error))
 	{
 		SET_MSG_RESULT(result, error);
-		goto clean;
+		return NOTSUPPORTED;
 	}
 
-	if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_PROXY, item->http_proxy)))
+	if (CURLE_OK != (err = curl_easy_setopt(context->easyhandle, CURLOPT_PROXY, item->http_proxy)))
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot set proxy: %s", curl_easy_strerror(err)));
-		goto clean;
+		return NOTSUPPORTED;
 	}
 
-	if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_FOLLOWLOCATION,
+	if (CURLE_OK != (err = curl_easy_setopt(context->easyhandle, CURLOPT_FOLLOWLOCATION,
 			0 == item->follow_redirects ? 0L : 1L)))
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot set follow redirects: %s", curl_easy_strerror(err)));
-		goto clean;
+		return NOTSUPPORTED;
 	}
 
-	if (0 != item->follow_redirects &&
-			CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_MAXREDIRS, ZBX_CURLOPT_MAXREDIRS)))
+	if (0 != item->follow_redirects && CURLE_OK != (err = curl_easy_setopt(context->easyhandle,
+			CURLOPT_MAXREDIRS, ZBX_CURLOPT_MAXREDIRS)))
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot set number of redirects allowed: %s",
 				curl_easy_strerror(err)));
-		goto clean;
+		return NOTSUPPORTED;
 	}
 
 	if (FAIL == is_time_suffix(item->timeout, &timeout_seconds, strlen(item->timeout)))
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Invalid timeout: %s", item->timeout));
-		goto clean;
+		return NOTSUPPORTED;
 	}
 
-	if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_TIMEOUT, (long)timeout_seconds)))
+	if (CURLE_OK != (err = curl_easy_setopt(context->easyhandle, CURLOPT_TIMEOUT, (long)timeout_seconds)))
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot specify timeout: %s", curl_easy_strerror(err)));
-		goto clean;
+		return NOTSUPPORTED;
 	}
 
-	if (SUCCEED != zbx_http_prepare_ssl(easyhandle, item->ssl_cert_file, item->ssl_key_file, item->ssl_key_password,
-			item->verify_peer, item->verify_host, &error))
+	if (SUCCEED != zbx_http_prepare_ssl(context->easyhandle, item->ssl_cert_file, item->ssl_key_file,
+			item->ssl_key_password, item->verify_peer, item->verify_host, &error))
 	{
 		SET_MSG_RESULT(result, error);
-		goto clean;
+		return NOTSUPPORTED;
 	}
 
-	if (SUCCEED != zbx_http_prepare_auth(easyhandle, item->authtype, item->username, item->password, &error))
+	if (SUCCEED != zbx_http_prepare_auth(context->easyhandle, item->authtype, item->username, item->password,
+			&error))
 	{
 		SET_MSG_RESULT(result, error);
-		goto clean;
+		return NOTSUPPORTED;
 	}
 
-	if (SUCCEED != http_prepare_request(easyhandle, item->posts, item->request_method, &error))
+	if (SUCCEED != http_prepare_request(context->easyhandle, item->posts, item->request_method, &error))
 	{
 		SET_MSG_RESULT(result, error);
-		goto clean;
+		return NOTSUPPORTED;
 	}
 
 	headers = item->headers;
 	while (NULL != (line = zbx_http_parse_header(&headers)))
 	{
-		headers_slist = curl_slist_append(headers_slist, line);
+		context->headers_slist = curl_slist_append(context->headers_slist, line);
 
 		if (FAIL == found && 0 == strncmp(line, "Content-Type:", ZBX_CONST_STRLEN("Content-Type:")))
 			found = SUCCEED;
@@ -293,55 +303,80 @@ int	get_value_http(const DC_ITEM *item, AGENT_RESULT *result)
 	if (FAIL == found)
 	{
 		if (ZBX_POSTTYPE_JSON == item->post_type)
-			headers_slist = curl_slist_append(headers_slist, application_json);
+			context->headers_slist = curl_slist_append(context->headers_slist, application_json);
 		else if (ZBX_POSTTYPE_XML == item->post_type)
-			headers_slist = curl_slist_append(headers_slist, application_xml);
+			context->headers_slist = curl_slist_append(context->headers_slist, application_xml);
 	}
 
-	if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_HTTPHEADER, headers_slist)))
+	if (CURLE_OK != (err = curl_easy_setopt(context->easyhandle, CURLOPT_HTTPHEADER, context->headers_slist)))
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot specify headers: %s", curl_easy_strerror(err)));
-		goto clean;
+		return NOTSUPPORTED;
 	}
 
 #if LIBCURL_VERSION_NUM >= 0x071304
 	/* CURLOPT_PROTOCOLS is supported starting with version 7.19.4 (0x071304) */
 	/* CURLOPT_PROTOCOLS was deprecated in favor of CURLOPT_PROTOCOLS_STR starting with version 7.85.0 (0x075500) */
 #	if LIBCURL_VERSION_NUM >= 0x075500
-	if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_PROTOCOLS_STR, "HTTP,HTTPS")))
+	if (CURLE_OK != (err = curl_easy_setopt(context->easyhandle, CURLOPT_PROTOCOLS_STR, "HTTP,HTTPS")))
 #	else
-	if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_PROTOCOLS, CURLPROTO_HTTP | CURLPROTO_HTTPS)))
+	if (CURLE_OK != (err = curl_easy_setopt(context->easyhandle, CURLOPT_PROTOCOLS,
+			CURLPROTO_HTTP | CURLPROTO_HTTPS)))
 #	endif
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot set allowed protocols: %s", curl_easy_strerror(err)));
-		goto clean;
+		return NOTSUPPORTED;
 	}
 #endif
 
 	zbx_snprintf(url, sizeof(url),"%s%s", item->url, item->query_fields);
-	if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_URL, url)))
+	if (CURLE_OK != (err = curl_easy_setopt(context->easyhandle, CURLOPT_URL, url)))
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot specify URL: %s", curl_easy_strerror(err)));
-		goto clean;
+		return NOTSUPPORTED;
 	}
 
-	if (CURLE_OK != (err = curl_easy_setopt(easyhandle, ZBX_CURLOPT_ACCEPT_ENCODING, "")))
+	if (CURLE_OK != (err = curl_easy_setopt(context->easyhandle, ZBX_CURLOPT_ACCEPT_ENCODING, "")))
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot set cURL encoding option: %s",
 				curl_easy_strerror(err)));
-		goto clean;
+		return NOTSUPPORTED;
 	}
 
-	if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_COOKIEFILE, "")))
+	if (CURLE_OK != (err = curl_easy_setopt(context->easyhandle, CURLOPT_COOKIEFILE, "")))
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot enable cURL cookie engine: %s",
 				curl_easy_strerror(err)));
-		goto clean;
+		return NOTSUPPORTED;
 	}
 
-	*errbuf = '\0';
+	*context->errbuf = '\0';
 
-	if (CURLE_OK != (err = curl_easy_perform(easyhandle)))
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: convert finished HTTP agent request to item value                 *
+ *                                                                            *
+ * Parameters: context - [IN/OUT] the request context                         *
+ *             item    - [IN] the HTTP agent item                             *
+ *             err     - [IN] the request result code                         *
+ *             result  - [OUT] the item value or error message                *
+ *                                                                            *
+ * Return value: SUCCEED - the value was stored in result                     *
+ *               NOTSUPPORTED - otherwise                                     *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_http_context_process_result(zbx_http_context_t *context, const DC_ITEM *item, CURLcode err,
+		AGENT_RESULT *result)
+{
+	char			*headers, *line, *buffer;
+	long			response_code;
+	struct zbx_json		json;
+	zbx_http_response_t	*body = &context->body, *header = &context->header;
+
+	if (CURLE_OK != err)
 	{
 		if (CURLE_WRITE_ERROR == err)
 		{
@@ -350,53 +385,53 @@ int	get_value_http(const DC_ITEM *item, AGENT_RESULT *result)
 		else
 		{
 			SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot perform request: %s",
-					'\0' == *errbuf ? curl_easy_strerror(err) : errbuf));
+					'\0' == *context->errbuf ? curl_easy_strerror(err) : context->errbuf));
 		}
-		goto clean;
+		return NOTSUPPORTED;
 	}
 
-	if (CURLE_OK != (err = curl_easy_getinfo(easyhandle, CURLINFO_RESPONSE_CODE, &response_code)))
+	if (CURLE_OK != (err = curl_easy_getinfo(context->easyhandle, CURLINFO_RESPONSE_CODE, &response_code)))
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot get the response code: %s", curl_easy_strerror(err)));
-		goto clean;
+		return NOTSUPPORTED;
 	}
 
 	if ('\0' != *item->status_codes && FAIL == int_in_list(item->status_codes, response_code))
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Response code \"%ld\" did not match any of the"
 				" required status codes \"%s\"", response_code, item->status_codes));
-		goto clean;
+		return NOTSUPPORTED;
 	}
 
-	if (NULL == header.data)
+	if (NULL == header->data)
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Server returned empty header"));
-		goto clean;
+		return NOTSUPPORTED;
 	}
 
 	switch (item->retrieve_mode)
 	{
 		case ZBX_RETRIEVE_MODE_CONTENT:
-			zbx_http_convert_to_utf8(easyhandle, &body.data, &body.offset, &body.allocated);
+			zbx_http_convert_to_utf8(context->easyhandle, &body->data, &body->offset, &body->allocated);
 
 			if (HTTP_STORE_JSON == item->output_format)
 			{
-				http_output_json(item->retrieve_mode, &buffer, &header, &body);
+				http_output_json(item->retrieve_mode, &buffer, header, body);
 				SET_TEXT_RESULT(result, buffer);
 			}
 			else
 			{
-				SET_TEXT_RESULT(result, body.data);
-				body.data = NULL;
+				SET_TEXT_RESULT(result, body->data);
+				body->data = NULL;
 			}
 			break;
 		case ZBX_RETRIEVE_MODE_HEADERS:
-			zbx_replace_invalid_utf8(header.data);
+			zbx_replace_invalid_utf8(header->data);
 			if (HTTP_STORE_JSON == item->output_format)
 			{
 				zbx_json_init(&json, ZBX_JSON_STAT_BUF_LEN);
 				zbx_json_addobject(&json, "header");
-				headers = header.data;
+				headers = header->data;
 				while (NULL != (line = zbx_http_parse_header(&headers)))
 				{
 					http_add_json_header(&json, line);
@@ -407,35 +442,62 @@ int	get_value_http(const DC_ITEM *item, AGENT_RESULT *result)
 			}
 			else
 			{
-				SET_TEXT_RESULT(result, header.data);
-				header.data = NULL;
+				SET_TEXT_RESULT(result, header->data);
+				header->data = NULL;
 			}
 			break;
 		case ZBX_RETRIEVE_MODE_BOTH:
-			zbx_replace_invalid_utf8(header.data);
-			zbx_http_convert_to_utf8(easyhandle, &body.data, &body.offset, &body.allocated);
+			zbx_replace_invalid_utf8(header->data);
+			zbx_http_convert_to_utf8(context->easyhandle, &body->data, &body->offset, &body->allocated);
 
 			if (HTTP_STORE_JSON == item->output_format)
 			{
-				http_output_json(item->retrieve_mode, &buffer, &header, &body);
+				http_output_json(item->retrieve_mode, &buffer, header, body);
 				SET_TEXT_RESULT(result, buffer);
 			}
 			else
 			{
-				zbx_strncpy_alloc(&header.data, &header.allocated, &header.offset,
-						body.data, body.offset);
-				SET_TEXT_RESULT(result, header.data);
-				header.data = NULL;
+				zbx_strncpy_alloc(&header->data, &header->allocated, &header->offset,
+						body->data, body->offset);
+				SET_TEXT_RESULT(result, header->data);
+				header->data = NULL;
 			}
 			break;
 	}
 
-	ret = SUCCEED;
-clean:
-	curl_slist_free_all(headers_slist);	/* must be called after curl_easy_perform() */
-	curl_easy_cleanup(easyhandle);
-	zbx_free(body.data);
-	zbx_free(header.data);
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: release HTTP agent request resources                              *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_http_context_clean(zbx_http_context_t *context)
+{
+	curl_slist_free_all(context->headers_slist);	/* must be called after request is finished */
+	curl_easy_cleanup(context->easyhandle);
+	zbx_free(context->body.data);
+	zbx_free(context->header.data);
+}
+
+int	get_value_http(const DC_ITEM *item, AGENT_RESULT *result)
+{
+	zbx_http_context_t	context;
+	int			ret;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() request method '%s' URL '%s%s' headers '%s' message body '%s'",
+			__func__, zbx_request_string(item->request_method), item->url, item->query_fields,
+			item->headers, item->posts);
+
+	if (SUCCEED == (ret = zbx_http_context_prepare(&context, item, result)))
+	{
+		ret = zbx_http_context_process_result(&context, item, curl_easy_perform(context.easyhandle),
+				result);
+	}
+
+	zbx_http_context_clean(&context);
+
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
 
 	return ret;
@@ -585,6 +585,28 @@ int	get_value_internal(const DC_ITEM *item, AGENT_RESULT *result)
 				goto out;
 			}
 		}
+		else if (0 == strcmp(tmp, "ring"))
+		{
+			if (NULL == tmp1 || '\0' == *tmp1 || 0 == strcmp(tmp1, "pfree"))
+				SET_DBL_RESULT(result, *(double *)DCget_stats(ZBX_STATS_HISTORY_RING_PFREE));
+			else if (0 == strcmp(tmp1, "total"))
+				SET_UI64_RESULT(result, *(zbx_uint64_t *)DCget_stats(ZBX_STATS_HISTORY_RING_TOTAL));
+			else if (0 == strcmp(tmp1, "used"))
+				SET_UI64_RESULT(result, *(zbx_uint64_t *)DCget_stats(ZBX_STATS_HISTORY_RING_USED));
+			else if (0 == strcmp(tmp1, "free"))
+				SET_UI64_RESULT(result, *(zbx_uint64_t *)DCget_stats(ZBX_STATS_HISTORY_RING_FREE));
+			else if (0 == strcmp(tmp1, "pused"))
+				SET_DBL_RESULT(result, *(double *)DCget_stats(ZBX_STATS_HISTORY_RING_PUSED));
+			else if (0 == strcmp(tmp1, "values"))
+				SET_UI64_RESULT(result, *(zbx_uint64_t *)DCget_stats(ZBX_STATS_HISTORY_RING_VALUES));
+			else if (0 == strcmp(tmp1, "overflow"))
+				SET_UI64_RESULT(result, *(zbx_uint64_t *)DCget_stats(ZBX_STATS_HISTORY_RING_OVERFLOW));
+			else
+			{
+				SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid third parameter."));
+				goto out;
+			}
+		}
 		else
 		{
 			SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid second parameter."));
@@ -796,6 +818,49 @@ int	get_value_internal(const DC_ITEM *item, AGENT_RESULT *result)
 
 		SET_UI64_RESULT(result, zbx_preprocessor_get_queue_size());
 	}
+	else if (0 == strcmp(tmp, "async_checks"))		/* zabbix[async_checks,<type>,<mode>] */
+	{
+		unsigned char	poller_type;
+		int		checks, queued;
+
+		if (2 > nparams || 3 < nparams)
+		{
+			SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid number of parameters."));
+			goto out;
+		}
+
+		tmp = get_rparam(&request, 1);
+
+		if (0 == strcmp(tmp, "agent"))
+			poller_type = ZBX_POLLER_TYPE_AGENT;
+		else if (0 == strcmp(tmp, "http agent"))
+			poller_type = ZBX_POLLER_TYPE_HTTPAGENT;
+		else if (0 == strcmp(tmp, "snmp"))
+			poller_type = ZBX_POLLER_TYPE_SNMP;
+		else
+		{
+			SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid second parameter."));
+			goto out;
+		}
+
+		DCget_async_poller_stats(poller_type, &checks, &queued);
+
+		tmp = get_rparam(&request, 2);
+
+		if (NULL == tmp || '\0' == *tmp || 0 == strcmp(tmp, "inflight"))
+		{
+			SET_UI64_RESULT(result, checks);
+		}
+		else if (0 == strcmp(tmp, "queued"))
+		{
+			SET_UI64_RESULT(result, queued);
+		}
+		else
+		{
+			SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid third parameter."));
+			goto out;
+		}
+	}
 	else if (0 == strcmp(tmp, "tcache"))			/* zabbix[tcache,cache,<parameter>] */
 	{
 		char		*error = NULL;
@@ -405,7 +405,7 @@ static char	*zbx_get_snmp_type_error(u_char type)
 	}
 }
 
-static int	zbx_get_snmp_response_error(const struct snmp_session *ss, const DC_INTERFACE *interface, int status,
+int	zbx_get_snmp_response_error(const struct snmp_session *ss, const DC_INTERFACE *interface, int status,
 		const struct snmp_pdu *response, char *error, size_t max_error_len)
 {
 	int	ret;
@@ -437,17 +437,28 @@ static int	zbx_get_snmp_response_error(const struct snmp_session *ss, const DC_I
 	return ret;
 }
 
-static struct snmp_session	*zbx_snmp_open_session(const DC_ITEM *item, char *error, size_t max_error_len)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: initialize SNMP session parameters of the item                    *
+ *                                                                            *
+ * Parameters: item          - [IN] the item                                  *
+ *             session       - [OUT] the session parameters                   *
+ *             addr          - [OUT] the buffer for peer name                 *
+ *             addr_len      - [IN] the size of peer name buffer              *
+ *             error         - [OUT] the error message                        *
+ *             max_error_len - [IN] the size of error message buffer          *
+ *                                                                            *
+ * Return value: SUCCEED - the session parameters were initialized            *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	zbx_snmp_init_session(const DC_ITEM *item, struct snmp_session *session, char *addr, size_t addr_len,
+		char *error, size_t max_error_len)
 {
-	struct snmp_session	session, *ss = NULL;
-	char			addr[128];
 #ifdef HAVE_IPV6
-	int			family;
+	int	family;
 #endif
-
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
-
-	snmp_sess_init(&session);
+	snmp_sess_init(session);
 
 	/* Allow using sub-OIDs higher than MAX_INT, like in 'snmpwalk -Ir'. */
 	/* Disables the validation of varbind values against the MIB definition for the relevant OID. */
@@ -461,109 +472,109 @@ static struct snmp_session	*zbx_snmp_open_session(const DC_ITEM *item, char *err
 	switch (item->snmp_version)
 	{
 		case ZBX_IF_SNMP_VERSION_1:
-			session.version = SNMP_VERSION_1;
+			session->version = SNMP_VERSION_1;
 			break;
 		case ZBX_IF_SNMP_VERSION_2:
-			session.version = SNMP_VERSION_2c;
+			session->version = SNMP_VERSION_2c;
 			break;
 		case ZBX_IF_SNMP_VERSION_3:
-			session.version = SNMP_VERSION_3;
+			session->version = SNMP_VERSION_3;
 			break;
 		default:
 			THIS_SHOULD_NEVER_HAPPEN;
 			break;
 	}
 
-	session.timeout = CONFIG_TIMEOUT * 1000 * 1000;	/* timeout of one attempt in microseconds */
+	session->timeout = CONFIG_TIMEOUT * 1000 * 1000;	/* timeout of one attempt in microseconds */
 							/* (net-snmp default = 1 second) */
 
 #ifdef HAVE_IPV6
 	if (SUCCEED != get_address_family(item->interface.addr, &family, error, max_error_len))
-		goto end;
+		return FAIL;
 
 	if (PF_INET == family)
 	{
-		zbx_snprintf(addr, sizeof(addr), "%s:%hu", item->interface.addr, item->interface.port);
+		zbx_snprintf(addr, addr_len, "%s:%hu", item->interface.addr, item->interface.port);
 	}
 	else
 	{
 		if (item->interface.useip)
-			zbx_snprintf(addr, sizeof(addr), "udp6:[%s]:%hu", item->interface.addr, item->interface.port);
+			zbx_snprintf(addr, addr_len, "udp6:[%s]:%hu", item->interface.addr, item->interface.port);
 		else
-			zbx_snprintf(addr, sizeof(addr), "udp6:%s:%hu", item->interface.addr, item->interface.port);
+			zbx_snprintf(addr, addr_len, "udp6:%s:%hu", item->interface.addr, item->interface.port);
 	}
 #else
-	zbx_snprintf(addr, sizeof(addr), "%s:%hu", item->interface.addr, item->interface.port);
+	zbx_snprintf(addr, addr_len, "%s:%hu", item->interface.addr, item->interface.port);
 #endif
-	session.peername = addr;
+	session->peername = addr;
 
-	if (SNMP_VERSION_1 == session.version || SNMP_VERSION_2c == session.version)
+	if (SNMP_VERSION_1 == session->version || SNMP_VERSION_2c == session->version)
 	{
-		session.community = (u_char *)item->snmp_community;
-		session.community_len = strlen((char *)session.community);
-		zabbix_log(LOG_LEVEL_DEBUG, "SNMP [%s@%s]", session.community, session.peername);
+		session->community = (u_char *)item->snmp_community;
+		session->community_len = strlen((char *)session->community);
+		zabbix_log(LOG_LEVEL_DEBUG, "SNMP [%s@%s]", session->community, session->peername);
 	}
-	else if (SNMP_VERSION_3 == session.version)
+	else if (SNMP_VERSION_3 == session->version)
 	{
 		/* set the SNMPv3 user name */
-		session.securityName = item->snmpv3_securityname;
-		session.securityNameLen = strlen(session.securityName);
+		session->securityName = item->snmpv3_securityname;
+		session->securityNameLen = strlen(session->securityName);
 
 		/* set the SNMPv3 context if specified */
 		if ('\0' != *item->snmpv3_contextname)
 		{
-			session.contextName = item->snmpv3_contextname;
-			session.contextNameLen = strlen(session.contextName);
+			session->contextName = item->snmpv3_contextname;
+			session->contextNameLen = strlen(session->contextName);
 		}
 
 		/* set the security level to authenticated, but not encrypted */
 		switch (item->snmpv3_securitylevel)
 		{
 			case ITEM_SNMPV3_SECURITYLEVEL_NOAUTHNOPRIV:
-				session.securityLevel = SNMP_SEC_LEVEL_NOAUTH;
+				session->securityLevel = SNMP_SEC_LEVEL_NOAUTH;
 				break;
 			case ITEM_SNMPV3_SECURITYLEVEL_AUTHNOPRIV:
-				session.securityLevel = SNMP_SEC_LEVEL_AUTHNOPRIV;
+				session->securityLevel = SNMP_SEC_LEVEL_AUTHNOPRIV;
 
-				if (FAIL == zbx_snmpv3_set_auth_protocol(item, &session))
+				if (FAIL == zbx_snmpv3_set_auth_protocol(item, session))
 				{
 					zbx_snprintf(error, max_error_len, "Unsupported authentication protocol [%d]",
 							item->snmpv3_authprotocol);
-					goto end;
+					return FAIL;
 				}
 
-				session.securityAuthKeyLen = USM_AUTH_KU_LEN;
+				session->securityAuthKeyLen = USM_AUTH_KU_LEN;
 
-				if (SNMPERR_SUCCESS != generate_Ku(session.securityAuthProto,
-						session.securityAuthProtoLen, (u_char *)item->snmpv3_authpassphrase,
-						strlen(item->snmpv3_authpassphrase), session.securityAuthKey,
-						&session.securityAuthKeyLen))
+				if (SNMPERR_SUCCESS != generate_Ku(session->securityAuthProto,
+						session->securityAuthProtoLen, (u_char *)item->snmpv3_authpassphrase,
+						strlen(item->snmpv3_authpassphrase), session->securityAuthKey,
+						&session->securityAuthKeyLen))
 				{
 					zbx_strlcpy(error, "Error generating Ku from authentication pass phrase",
 							max_error_len);
-					goto end;
+					return FAIL;
 				}
 				break;
 			case ITEM_SNMPV3_SECURITYLEVEL_AUTHPRIV:
-				session.securityLevel = SNMP_SEC_LEVEL_AUTHPRIV;
+				session->securityLevel = SNMP_SEC_LEVEL_AUTHPRIV;
 
-				if (FAIL == zbx_snmpv3_set_auth_protocol(item, &session))
+				if (FAIL == zbx_snmpv3_set_auth_protocol(item, session))
 				{
 					zbx_snprintf(error, max_error_len, "Unsupported authentication protocol [%d]",
 							item->snmpv3_authprotocol);
-					goto end;
+					return FAIL;
 				}
 
-				session.securityAuthKeyLen = USM_AUTH_KU_LEN;
+				session->securityAuthKeyLen = USM_AUTH_KU_LEN;
 
-				if (SNMPERR_SUCCESS != generate_Ku(session.securityAuthProto,
-						session.securityAuthProtoLen, (u_char *)item->snmpv3_authpassphrase,
-						strlen(item->snmpv3_authpassphrase), session.securityAuthKey,
-						&session.securityAuthKeyLen))
+				if (SNMPERR_SUCCESS != generate_Ku(session->securityAuthProto,
+						session->securityAuthProtoLen, (u_char *)item->snmpv3_authpassphrase,
+						strlen(item->snmpv3_authpassphrase), session->securityAuthKey,
+						&session->securityAuthKeyLen))
 				{
 					zbx_strlcpy(error, "Error generating Ku from authentication pass phrase",
 							max_error_len);
-					goto end;
+					return FAIL;
 				}
 
 				switch (item->snmpv3_privprotocol)
@@ -571,59 +582,59 @@ static struct snmp_session	*zbx_snmp_open_session(const DC_ITEM *item, char *err
 #ifdef HAVE_NETSNMP_SESSION_DES
 					case ITEM_SNMPV3_PRIVPROTOCOL_DES:
 						/* set the privacy protocol to DES */
-						session.securityPrivProto = usmDESPrivProtocol;
-						session.securityPrivProtoLen = USM_PRIV_PROTO_DES_LEN;
+						session->securityPrivProto = usmDESPrivProtocol;
+						session->securityPrivProtoLen = USM_PRIV_PROTO_DES_LEN;
 						break;
 #endif
 					case ITEM_SNMPV3_PRIVPROTOCOL_AES128:
 						/* set the privacy protocol to AES128 */
-						session.securityPrivProto = usmAESPrivProtocol;
-						session.securityPrivProtoLen = USM_PRIV_PROTO_AES_LEN;
+						session->securityPrivProto = usmAESPrivProtocol;
+						session->securityPrivProtoLen = USM_PRIV_PROTO_AES_LEN;
 						break;
 #ifdef HAVE_NETSNMP_STRONG_PRIV
 					case ITEM_SNMPV3_PRIVPROTOCOL_AES192:
 						/* set the privacy protocol to AES192 */
-						session.securityPrivProto = usmAES192PrivProtocol;
-						session.securityPrivProtoLen = OID_LENGTH(usmAES192PrivProtocol);
+						session->securityPrivProto = usmAES192PrivProtocol;
+						session->securityPrivProtoLen = OID_LENGTH(usmAES192PrivProtocol);
 						break;
 					case ITEM_SNMPV3_PRIVPROTOCOL_AES256:
 						/* set the privacy protocol to AES256 */
-						session.securityPrivProto = usmAES256PrivProtocol;
-						session.securityPrivProtoLen = OID_LENGTH(usmAES256PrivProtocol);
+						session->securityPrivProto = usmAES256PrivProtocol;
+						session->securityPrivProtoLen = OID_LENGTH(usmAES256PrivProtocol);
 						break;
 					case ITEM_SNMPV3_PRIVPROTOCOL_AES192C:
 						/* set the privacy protocol to AES192 (Cisco version) */
-						session.securityPrivProto = usmAES192CiscoPrivProtocol;
-						session.securityPrivProtoLen = OID_LENGTH(usmAES192CiscoPrivProtocol);
+						session->securityPrivProto = usmAES192CiscoPrivProtocol;
+						session->securityPrivProtoLen = OID_LENGTH(usmAES192CiscoPrivProtocol);
 						break;
 					case ITEM_SNMPV3_PRIVPROTOCOL_AES256C:
 						/* set the privacy protocol to AES256 (Cisco version) */
-						session.securityPrivProto = usmAES256CiscoPrivProtocol;
-						session.securityPrivProtoLen = OID_LENGTH(usmAES256CiscoPrivProtocol);
+						session->securityPrivProto = usmAES256CiscoPrivProtocol;
+						session->securityPrivProtoLen = OID_LENGTH(usmAES256CiscoPrivProtocol);
 						break;
 #endif
 					default:
 						zbx_snprintf(error, max_error_len,
 								"Unsupported privacy protocol [%d]",
 								item->snmpv3_privprotocol);
-						goto end;
+						return FAIL;
 				}
 
-				session.securityPrivKeyLen = USM_PRIV_KU_LEN;
+				session->securityPrivKeyLen = USM_PRIV_KU_LEN;
 
-				if (SNMPERR_SUCCESS != generate_Ku(session.securityAuthProto,
-						session.securityAuthProtoLen, (u_char *)item->snmpv3_privpassphrase,
-						strlen(item->snmpv3_privpassphrase), session.securityPrivKey,
-						&session.securityPrivKeyLen))
+				if (SNMPERR_SUCCESS != generate_Ku(session->securityAuthProto,
+						session->securityAuthProtoLen, (u_char *)item->snmpv3_privpassphrase,
+						strlen(item->snmpv3_privpassphrase), session->securityPrivKey,
+						&session->securityPrivKeyLen))
 				{
 					zbx_strlcpy(error, "Error generating Ku from privacy pass phrase",
 							max_error_len);
-					goto end;
+					return FAIL;
 				}
 				break;
 		}
 
-		zabbix_log(LOG_LEVEL_DEBUG, "SNMPv3 [%s@%s]", session.securityName, session.peername);
+		zabbix_log(LOG_LEVEL_DEBUG, "SNMPv3 [%s@%s]", session->securityName, session->peername);
 	}
 
 #ifdef HAVE_NETSNMP_SESSION_LOCALNAME
@@ -636,10 +647,23 @@ static struct snmp_session	*zbx_snmp_open_session(const DC_ITEM *item, char *err
 		static char	localname[64];
 
 		zbx_snprintf(localname, sizeof(localname), "%s:0", CONFIG_SOURCE_IP);
-		session.localname = localname;
+		session->localname = localname;
 	}
 #endif
 
+	return SUCCEED;
+}
+
+static struct snmp_session	*zbx_snmp_open_session(const DC_ITEM *item, char *error, size_t max_error_len)
+{
+	struct snmp_session	session, *ss = NULL;
+	char			addr[128];
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
+
+	if (SUCCEED != zbx_snmp_init_session(item, &session, addr, sizeof(addr), error, max_error_len))
+		goto end;
+
 	SOCK_STARTUP;
 
 	if (NULL == (ss = snmp_open(&session)))
@@ -654,6 +678,45 @@ end:
 	return ss;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: open single SNMP session for asynchronous requests                *
+ *                                                                            *
+ * Return value: the session handle to be used with snmp_sess_*() functions   *
+ *               or NULL on error                                             *
+ *                                                                            *
+ ******************************************************************************/
+void	*zbx_snmp_sess_open(const DC_ITEM *item, char *error, size_t max_error_len)
+{
+	struct snmp_session	session;
+	char			addr[128];
+	void			*sessp = NULL;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
+
+	if (SUCCEED != zbx_snmp_init_session(item, &session, addr, sizeof(addr), error, max_error_len))
+		goto end;
+
+	SOCK_STARTUP;
+
+	if (NULL == (sessp = snmp_sess_open(&session)))
+	{
+		SOCK_CLEANUP;
+
+		zbx_strlcpy(error, "Cannot open SNMP session", max_error_len);
+	}
+end:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+
+	return sessp;
+}
+
+void	zbx_snmp_sess_close(void *sessp)
+{
+	snmp_sess_close(sessp);
+	SOCK_CLEANUP;
+}
+
 static void	zbx_snmp_close_session(struct snmp_session *session)
 {
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
@@ -723,7 +786,7 @@ end:
 	return strval_dyn;
 }
 
-static int	zbx_snmp_set_result(const struct variable_list *var, AGENT_RESULT *result, unsigned char *string_type)
+int	zbx_snmp_set_result(const struct variable_list *var, AGENT_RESULT *result, unsigned char *string_type)
 {
 	char		*strval_dyn;
 	int		ret = SUCCEED;
@@ -1586,7 +1649,7 @@ out:
  * Purpose: translate well-known object identifiers into numeric form         *
  *                                                                            *
  ******************************************************************************/
-static void	zbx_snmp_translate(char *oid_translated, const char *snmp_oid, size_t max_oid_len)
+void	zbx_snmp_translate(char *oid_translated, const char *snmp_oid, size_t max_oid_len)
 {
 	typedef struct
 	{
@@ -2120,7 +2183,7 @@ int	get_value_snmp(const DC_ITEM *item, AGENT_RESULT *result, unsigned char poll
 	return errcode;
 }
 
-static void	zbx_init_snmp(void)
+void	zbx_init_snmp(void)
 {
 	sigset_t	mask, orig_mask;
 
@@ -39,6 +39,19 @@ extern int	CONFIG_TIMEOUT;
 int	get_value_snmp(const DC_ITEM *item, AGENT_RESULT *result, unsigned char poller_type);
 void	get_values_snmp(const DC_ITEM *items, AGENT_RESULT *results, int *errcodes, int num, unsigned char poller_type);
 void	zbx_clear_cache_snmp(unsigned char process_type, int process_num);
+
+/* helpers for asynchronous SNMP checks */
+struct snmp_session;
+struct snmp_pdu;
+struct variable_list;
+
+void	zbx_init_snmp(void);
+void	*zbx_snmp_sess_open(const DC_ITEM *item, char *error, size_t max_error_len);
+void	zbx_snmp_sess_close(void *sessp);
+void	zbx_snmp_translate(char *oid_translated, const char *snmp_oid, size_t max_oid_len);
+int	zbx_snmp_set_result(const struct variable_list *var, AGENT_RESULT *result, unsigned char *string_type);
+int	zbx_get_snmp_response_error(const struct snmp_session *ss, const DC_INTERFACE *interface, int status,
+		const struct snmp_pdu *response, char *error, size_t max_error_len);
 #endif
 
 #endif
@@ -25,19 +25,24 @@
 #include "zbxlld.h"
 #include "preprocessing.h"
 #include "preproc_history.h"
+#include "preproc_worker.h"
 #include "../../libs/zbxalgo/vectorimpl.h"
 #include "preproc_manager.h"
 
 extern ZBX_THREAD_LOCAL unsigned char	process_type;
 extern unsigned char			program_type;
 extern ZBX_THREAD_LOCAL int		server_num, process_num;
-extern int				CONFIG_PREPROCESSOR_FORKS;
 
 #define ZBX_PREPROCESSING_MANAGER_DELAY	1
 
 #define ZBX_PREPROC_PRIORITY_NONE	0
 #define ZBX_PREPROC_PRIORITY_FIRST	1
 
+/* the maximum total cost of preprocessing steps executed by manager without dispatching to workers */
+#define ZBX_PREPROC_INLINE_COST_MAX	4
+/* the maximum length of string values preprocessed by manager without dispatching to workers */
+#define ZBX_PREPROC_INLINE_VALUE_LEN_MAX	1024
+
 typedef enum
 {
 	REQUEST_STATE_QUEUED		= 0,		/* requires preprocessing */
@@ -131,6 +136,7 @@ typedef struct
 {
 	zbx_preprocessing_worker_t	*workers;	/* preprocessing worker array */
 	int				worker_count;	/* preprocessing worker count */
+	int				worker_max;	/* the number of workers served by this manager */
 	zbx_list_t			queue;		/* queue of item values */
 	zbx_hashset_t			item_config;	/* item configuration L2 cache */
 	zbx_hashset_t			history_cache;	/* item value history cache */
@@ -139,6 +145,8 @@ typedef struct
 	zbx_uint64_t			processed_num;	/* processed value counter */
 	zbx_uint64_t			queued_num;	/* queued value counter */
 	zbx_uint64_t			preproc_num;	/* queued values with preprocessing steps */
+	zbx_uint64_t			inline_num;	/* values preprocessed by manager */
+	zbx_uint64_t			dispatched_num;	/* values dispatched to workers */
 	zbx_list_iterator_t		priority_tail;	/* iterator to the last queued priority item */
 
 	zbx_list_t			direct_queue;	/* Queue of external requests that have to be */
@@ -152,6 +160,9 @@ static void	preprocessor_enqueue_dependent(zbx_preprocessing_manager_t *manager,
 static void	preprocessor_update_history(zbx_preprocessing_manager_t *manager, zbx_uint64_t itemid,
 		zbx_vector_ptr_t *history);
 
+static int	preprocessor_set_variant_result(zbx_preprocessing_request_t *request,
+		zbx_variant_t *value, char *error);
+
 /* cleanup functions */
 
 static void	preproc_item_clear(zbx_preproc_item_t *item)
@@ -619,6 +630,7 @@ static void	preprocessor_assign_tasks(zbx_preprocessing_manager_t *manager)
 
 		worker->task = data;
 		zbx_ipc_message_clean(&message);
+		manager->dispatched_num++;
 	}
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
@@ -893,6 +905,160 @@ static void	preprocessor_enqueue_dependent_value(zbx_preprocessing_manager_t *ma
 			value->item_value_type, value->ts);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get the relative cost of preprocessing step execution             *
+ *                                                                            *
+ * Parameters: type - [IN] the preprocessing step type                        *
+ *                                                                            *
+ * Return value: the step cost or -1 if the step must be always executed by   *
+ *               preprocessing workers                                        *
+ *                                                                            *
+ ******************************************************************************/
+static int	preprocessor_get_step_cost(unsigned char type)
+{
+	switch (type)
+	{
+		case ZBX_PREPROC_MULTIPLIER:
+		case ZBX_PREPROC_RTRIM:
+		case ZBX_PREPROC_LTRIM:
+		case ZBX_PREPROC_TRIM:
+		case ZBX_PREPROC_BOOL2DEC:
+		case ZBX_PREPROC_OCT2DEC:
+		case ZBX_PREPROC_HEX2DEC:
+		case ZBX_PREPROC_DELTA_VALUE:
+		case ZBX_PREPROC_DELTA_SPEED:
+		case ZBX_PREPROC_THROTTLE_VALUE:
+		case ZBX_PREPROC_THROTTLE_TIMED_VALUE:
+		case ZBX_PREPROC_VALIDATE_RANGE:
+		case ZBX_PREPROC_STR_REPLACE:
+			return 1;
+		case ZBX_PREPROC_JSONPATH:
+			return 2;
+		case ZBX_PREPROC_REGSUB:
+		case ZBX_PREPROC_VALIDATE_REGEX:
+		case ZBX_PREPROC_VALIDATE_NOT_REGEX:
+		case ZBX_PREPROC_ERROR_FIELD_JSON:
+		case ZBX_PREPROC_ERROR_FIELD_REGEX:
+			return 3;
+		default:
+			/* XML, JavaScript, Prometheus and CSV processing is left to workers */
+			return -1;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: check if preprocessing request is cheap enough to be executed by  *
+ *          manager without dispatching it to preprocessing workers           *
+ *                                                                            *
+ * Parameters: request - [IN] preprocessing request                           *
+ *                                                                            *
+ * Return value: SUCCEED - the request can be executed by manager             *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	preprocessor_can_execute_inline(const zbx_preprocessing_request_t *request)
+{
+	int		i, cost, cost_total = 0;
+	AGENT_RESULT	*ar = request->value.result;
+	const char	*str;
+
+	if (ITEM_STATE_NORMAL != request->value.state || NULL == ar)
+		return FAIL;
+
+	if (ISSET_LOG(ar))
+		str = ar->log->value;
+	else if (ISSET_UI64(ar) || ISSET_DBL(ar))
+		str = NULL;
+	else if (ISSET_STR(ar))
+		str = ar->str;
+	else if (ISSET_TEXT(ar))
+		str = ar->text;
+	else
+		return FAIL;
+
+	if (NULL != str && ZBX_PREPROC_INLINE_VALUE_LEN_MAX < strlen(str))
+		return FAIL;
+
+	for (i = 0; i < request->steps_num; i++)
+	{
+		if (0 > (cost = preprocessor_get_step_cost(request->steps[i].type)))
+			return FAIL;
+
+		if (ZBX_PREPROC_INLINE_COST_MAX < (cost_total += cost))
+			return FAIL;
+	}
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: execute preprocessing request by manager                          *
+ *                                                                            *
+ * Parameters: manager     - [IN] preprocessing manager                       *
+ *             request     - [IN] preprocessing request                       *
+ *             enqueued_at - [IN] position in value queue                     *
+ *                                                                            *
+ * Comments: The result is handled the same way as results received from      *
+ *           preprocessing workers, saving the IPC round trip for cheap step  *
+ *           chains.                                                          *
+ *                                                                            *
+ ******************************************************************************/
+static void	preprocessor_execute_inline(zbx_preprocessing_manager_t *manager, zbx_preprocessing_request_t *request,
+		zbx_list_item_t *enqueued_at)
+{
+	zbx_variant_t		value, value_ar;
+	zbx_preproc_history_t	*vault;
+	zbx_vector_ptr_t	history_in, history_out;
+	char			*error = NULL;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() itemid: " ZBX_FS_UI64, __func__, request->value.itemid);
+
+	request->base.state = REQUEST_STATE_PROCESSING;
+
+	zbx_vector_ptr_create(&history_in);
+	zbx_vector_ptr_create(&history_out);
+
+	if (NULL != (vault = (zbx_preproc_history_t *)zbx_hashset_search(&manager->history_cache,
+			&request->value.itemid)))
+	{
+		zbx_vector_ptr_append_array(&history_in, vault->history.values, vault->history.values_num);
+		zbx_vector_ptr_clear(&vault->history);
+	}
+
+	preprocessing_ar_to_variant(request->value.result, &value_ar);
+	zbx_variant_copy(&value, &value_ar);
+
+	(void)zbx_preprocessor_execute_steps(request->value_type, &value, request->value.ts, request->steps,
+			request->steps_num, &history_in, &history_out, &error);
+
+	if (FAIL == preprocessor_set_variant_result(request, &value, error))
+	{
+		preprocessor_update_history(manager, request->value.itemid, NULL);
+		zbx_vector_ptr_clear_ext(&history_out, (zbx_clean_func_t)zbx_preproc_op_history_free);
+	}
+	else
+	{
+		preprocessor_enqueue_dependent_value(manager, &request->value);
+		preprocessor_update_history(manager, request->value.itemid, &history_out);
+	}
+
+	preprocessor_set_request_state_done(manager, (zbx_preprocessing_request_base_t *)request, enqueued_at);
+
+	zbx_variant_clear(&value);
+
+	zbx_vector_ptr_clear_ext(&history_in, (zbx_clean_func_t)zbx_preproc_op_history_free);
+	zbx_vector_ptr_destroy(&history_in);
+	zbx_vector_ptr_destroy(&history_out);
+
+	manager->preproc_num--;
+	manager->inline_num++;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: enqueue preprocessing request                                     *
@@ -1011,11 +1177,18 @@ static void	preprocessor_enqueue(zbx_preprocessing_manager_t *manager, zbx_prepr
 	}
 
 	if (REQUEST_STATE_QUEUED == request->base.state)
+	{
 		preprocessor_link_items(manager, enqueued_at, item);
 
-	/* if no preprocessing is needed, dependent items are enqueued */
-	if (REQUEST_STATE_DONE == request->base.state)
+		/* linked requests waiting on other requests to complete are left in pending state */
+		if (REQUEST_STATE_QUEUED == request->base.state && SUCCEED == preprocessor_can_execute_inline(request))
+			preprocessor_execute_inline(manager, request, enqueued_at);
+	}
+	else if (REQUEST_STATE_DONE == request->base.state)
+	{
+		/* if no preprocessing is needed, dependent items are enqueued */
 		preprocessor_enqueue_dependent_value(manager, value);
+	}
 
 	manager->queued_num++;
 out:
@@ -1837,11 +2010,16 @@ static int	preproc_item_link_compare(const void *d1, const void *d2)
  ******************************************************************************/
 static void	preprocessor_init_manager(zbx_preprocessing_manager_t *manager)
 {
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() workers: %d", __func__, CONFIG_PREPROCESSOR_FORKS);
+	int	worker_max;
+
+	worker_max = zbx_preprocessor_manager_worker_count(process_num);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() workers: %d", __func__, worker_max);
 
 	memset(manager, 0, sizeof(zbx_preprocessing_manager_t));
 
-	manager->workers = (zbx_preprocessing_worker_t *)zbx_calloc(NULL, (size_t)CONFIG_PREPROCESSOR_FORKS,
+	manager->worker_max = worker_max;
+	manager->workers = (zbx_preprocessing_worker_t *)zbx_calloc(NULL, (size_t)worker_max,
 			sizeof(zbx_preprocessing_worker_t));
 	zbx_list_create(&manager->queue);
 	zbx_list_create(&manager->direct_queue);
@@ -1881,7 +2059,7 @@ static void preprocessor_register_worker(zbx_preprocessing_manager_t *manager, z
 	}
 	else
 	{
-		if (CONFIG_PREPROCESSOR_FORKS == manager->worker_count)
+		if (manager->worker_max == manager->worker_count)
 		{
 			THIS_SHOULD_NEVER_HAPPEN;
 			exit(EXIT_FAILURE);
@@ -1900,10 +2078,10 @@ ZBX_THREAD_ENTRY(preprocessing_manager_thread, args)
 {
 	zbx_ipc_service_t		service;
 	char				*error = NULL;
-	zbx_ipc_client_t		*client;
-	zbx_ipc_message_t		*message;
+	zbx_ipc_client_t		*client, *clients[ZBX_IPC_RECV_BATCH_SIZE];
+	zbx_ipc_message_t		*message, *messages[ZBX_IPC_RECV_BATCH_SIZE];
 	zbx_preprocessing_manager_t	manager;
-	int				ret;
+	int				ret, i, messages_num;
 	double				time_stat, time_idle = 0, time_now, time_flush, sec;
 	zbx_timespec_t			timeout = {ZBX_PREPROCESSING_MANAGER_DELAY, 0};
 
@@ -1921,7 +2099,7 @@ ZBX_THREAD_ENTRY(preprocessing_manager_thread, args)
 
 	update_selfmon_counter(ZBX_PROCESS_STATE_BUSY);
 
-	if (FAIL == zbx_ipc_service_start(&service, ZBX_IPC_SERVICE_PREPROCESSING, &error))
+	if (FAIL == zbx_ipc_service_start(&service, zbx_preprocessor_service_name(process_num), &error))
 	{
 		zabbix_log(LOG_LEVEL_CRIT, "cannot start preprocessing service: %s", error);
 		zbx_free(error);
@@ -1942,18 +2120,23 @@ ZBX_THREAD_ENTRY(preprocessing_manager_thread, args)
 
 		if (STAT_INTERVAL < time_now - time_stat)
 		{
-			zbx_setproctitle("%s #%d [queued " ZBX_FS_UI64 ", processed " ZBX_FS_UI64 " values, idle "
-					ZBX_FS_DBL " sec during " ZBX_FS_DBL " sec]",
+			zbx_setproctitle("%s #%d [queued " ZBX_FS_UI64 ", processed " ZBX_FS_UI64 " values ("
+					ZBX_FS_UI64 " inline, " ZBX_FS_UI64 " dispatched), idle " ZBX_FS_DBL
+					" sec during " ZBX_FS_DBL " sec]",
 					get_process_type_string(process_type), process_num,
-					manager.queued_num, manager.processed_num, time_idle, time_now - time_stat);
+					manager.queued_num, manager.processed_num, manager.inline_num,
+					manager.dispatched_num, time_idle, time_now - time_stat);
 
 			time_stat = time_now;
 			time_idle = 0;
 			manager.processed_num = 0;
+			manager.inline_num = 0;
+			manager.dispatched_num = 0;
 		}
 
 		update_selfmon_counter(ZBX_PROCESS_STATE_IDLE);
-		ret = zbx_ipc_service_recv(&service, &timeout, &client, &message);
+		messages_num = ZBX_IPC_RECV_BATCH_SIZE;
+		ret = zbx_ipc_service_recv_batch(&service, &timeout, clients, messages, &messages_num);
 		update_selfmon_counter(ZBX_PROCESS_STATE_BUSY);
 		sec = zbx_time();
 		zbx_update_env(get_process_type_string(process_type), sec);
@@ -1961,58 +2144,65 @@ ZBX_THREAD_ENTRY(preprocessing_manager_thread, args)
 		if (ZBX_IPC_RECV_IMMEDIATE != ret)
 			time_idle += sec - time_now;
 
-		if (NULL != message)
+		for (i = 0; i < messages_num; i++)
 		{
-			switch (message->code)
+			client = clients[i];
+			message = messages[i];
+
+			if (NULL != message)
 			{
-				case ZBX_IPC_PREPROCESSOR_WORKER:
-					preprocessor_register_worker(&manager, client, message);
-					break;
-				case ZBX_IPC_PREPROCESSOR_REQUEST:
-					preprocessor_add_request(&manager, message);
-					break;
-				case ZBX_IPC_PREPROCESSOR_RESULT:
-					preprocessor_add_result(&manager, client, message);
-					break;
-				case ZBX_IPC_PREPROCESSOR_DEP_NEXT:
-					preprocessor_next_dep_request(&manager, client);
-					break;
-				case ZBX_IPC_PREPROCESSOR_DEP_RESULT:
-					preprocessor_process_dep_result(&manager, client, message);
-					break;
-				case ZBX_IPC_PREPROCESSOR_DEP_RESULT_CONT:
-					preprocessor_process_dep_result_cont(&manager, client, message);
-					break;
-				case ZBX_IPC_PREPROCESSOR_QUEUE:
-					zbx_ipc_client_send(client, message->code, (unsigned char *)&manager.queued_num,
-							sizeof(zbx_uint64_t));
-					break;
-				case ZBX_IPC_PREPROCESSOR_TEST_REQUEST:
-					preprocessor_add_test_request(&manager, client, message);
-					break;
-				case ZBX_IPC_PREPROCESSOR_TEST_RESULT:
-					preprocessor_flush_test_result(&manager, client, message);
-					break;
-				case ZBX_IPC_PREPROCESSOR_DIAG_STATS:
-					preprocessor_get_diag_stats(&manager, client);
-					break;
-				case ZBX_IPC_PREPROCESSOR_TOP_ITEMS:
-					preprocessor_get_top_items(&manager, client, message);
-					break;
-				case ZBX_IPC_PREPROCESSOR_TOP_OLDEST_PREPROC_ITEMS:
-					preprocessor_get_oldest_preproc_items(&manager, client, message);
-					break;
+				switch (message->code)
+				{
+					case ZBX_IPC_PREPROCESSOR_WORKER:
+						preprocessor_register_worker(&manager, client, message);
+						break;
+					case ZBX_IPC_PREPROCESSOR_REQUEST:
+						preprocessor_add_request(&manager, message);
+						break;
+					case ZBX_IPC_PREPROCESSOR_RESULT:
+						preprocessor_add_result(&manager, client, message);
+						break;
+					case ZBX_IPC_PREPROCESSOR_DEP_NEXT:
+						preprocessor_next_dep_request(&manager, client);
+						break;
+					case ZBX_IPC_PREPROCESSOR_DEP_RESULT:
+						preprocessor_process_dep_result(&manager, client, message);
+						break;
+					case ZBX_IPC_PREPROCESSOR_DEP_RESULT_CONT:
+						preprocessor_process_dep_result_cont(&manager, client, message);
+						break;
+					case ZBX_IPC_PREPROCESSOR_QUEUE:
+						zbx_ipc_client_send(client, message->code, (unsigned char *)&manager.queued_num,
+								sizeof(zbx_uint64_t));
+						break;
+					case ZBX_IPC_PREPROCESSOR_TEST_REQUEST:
+						preprocessor_add_test_request(&manager, client, message);
+						break;
+					case ZBX_IPC_PREPROCESSOR_TEST_RESULT:
+						preprocessor_flush_test_result(&manager, client, message);
+						break;
+					case ZBX_IPC_PREPROCESSOR_DIAG_STATS:
+						preprocessor_get_diag_stats(&manager, client);
+						break;
+					case ZBX_IPC_PREPROCESSOR_TOP_ITEMS:
+						preprocessor_get_top_items(&manager, client, message);
+						break;
+					case ZBX_IPC_PREPROCESSOR_TOP_OLDEST_PREPROC_ITEMS:
+						preprocessor_get_oldest_preproc_items(&manager, client, message);
+						break;
+				}
+
+				zbx_ipc_message_free(message);
 			}
 
-			zbx_ipc_message_free(message);
+			if (NULL != client)
+				zbx_ipc_client_release(client);
 		}
 
-		if (NULL != client)
-			zbx_ipc_client_release(client);
-
 		if (0 == manager.preproc_num || 1 < time_now - time_flush)
 		{
 			dc_flush_history();
+			zbx_lld_flush();
 			time_flush = time_now;
 		}
 	}
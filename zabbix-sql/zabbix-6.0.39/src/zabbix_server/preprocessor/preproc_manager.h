@@ -22,6 +22,9 @@
 
 #include "threads.h"
 
+/* the maximum number of preprocessing managers, see StartPreprocessingManagers configuration parameter */
+#define ZBX_PREPROCESSING_MANAGERS_MAX	16
+
 ZBX_THREAD_ENTRY(preprocessing_manager_thread, args);
 
 #endif
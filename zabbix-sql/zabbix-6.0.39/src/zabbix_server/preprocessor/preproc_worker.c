@@ -286,58 +286,99 @@ static int	worker_item_preproc_execute(zbx_preproc_cache_t *cache, unsigned char
 
 /******************************************************************************
  *                                                                            *
- * Purpose: handle item value preprocessing task                              *
+ * Purpose: execute item value preprocessing steps                            *
  *                                                                            *
- * Parameters: socket  - [IN] IPC socket                                      *
- *             message - [IN] packed preprocessing task                       *
+ * Parameters: value_type  - [IN] the item value type                         *
+ *             value       - [IN/OUT] the value to process                    *
+ *             ts          - [IN] the value timestamp                         *
+ *             steps       - [IN] the preprocessing steps to execute          *
+ *             steps_num   - [IN] the number of preprocessing steps           *
+ *             history_in  - [IN] the preprocessing history                   *
+ *             history_out - [OUT] the new preprocessing history              *
+ *             error       - [OUT] the formatted error message                *
+ *                                                                            *
+ * Return value: SUCCEED - the preprocessing steps finished successfully      *
+ *               FAIL - otherwise, error contains the error message           *
+ *                                                                            *
+ * Comments: This function is used by preprocessing workers and by            *
+ *           preprocessing manager to execute cheap steps without             *
+ *           dispatching value to worker.                                     *
  *                                                                            *
  ******************************************************************************/
-static void	worker_preprocess_value(zbx_ipc_socket_t *socket, zbx_ipc_message_t *message)
+int	zbx_preprocessor_execute_steps(unsigned char value_type, zbx_variant_t *value, const zbx_timespec_t *ts,
+		zbx_preproc_op_t *steps, int steps_num, zbx_vector_ptr_t *history_in, zbx_vector_ptr_t *history_out,
+		char **error)
 {
-	zbx_uint32_t		size = 0;
-	unsigned char		*data = NULL, value_type;
-	zbx_uint64_t		itemid;
-	zbx_variant_t		value, value_start;
-	int			i, steps_num, results_num, ret;
-	char			*errmsg = NULL, *error = NULL;
-	zbx_timespec_t		*ts;
-	zbx_preproc_op_t	*steps;
-	zbx_vector_ptr_t	history_in, history_out;
+	zbx_variant_t		value_start;
+	int			i, results_num, ret;
+	char			*errmsg = NULL;
 	zbx_preproc_result_t	*results;
 
-	zbx_vector_ptr_create(&history_in);
-	zbx_vector_ptr_create(&history_out);
-
-	zbx_preprocessor_unpack_task(&itemid, &value_type, &ts, &value, &history_in, &steps, &steps_num,
-			message->data);
-
-	zbx_variant_copy(&value_start, &value);
+	zbx_variant_copy(&value_start, value);
 	results = (zbx_preproc_result_t *)zbx_malloc(NULL, sizeof(zbx_preproc_result_t) * (size_t)steps_num);
 	memset(results, 0, sizeof(zbx_preproc_result_t) * (size_t)steps_num);
 
-	if (FAIL == (ret = worker_item_preproc_execute(NULL, value_type, &value, &value, ts, steps, steps_num, &history_in,
-			&history_out, results, &results_num, &errmsg)) && 0 != results_num)
+	if (FAIL == (ret = worker_item_preproc_execute(NULL, value_type, value, value, ts, steps, steps_num, history_in,
+			history_out, results, &results_num, &errmsg)) && 0 != results_num)
 	{
 		int action = results[results_num - 1].action;
 
 		if (ZBX_PREPROC_FAIL_SET_ERROR != action && ZBX_PREPROC_FAIL_FORCE_ERROR != action)
 		{
-			worker_format_error(&value_start, results, results_num, errmsg, &error);
+			worker_format_error(&value_start, results, results_num, errmsg, error);
 			zbx_free(errmsg);
 		}
 		else
-			error = errmsg;
+			*error = errmsg;
 	}
 
 	if (SUCCEED == ZBX_CHECK_LOG_LEVEL(LOG_LEVEL_DEBUG))
 	{
 		const char	*result;
 
-		result = (SUCCEED == ret ? zbx_variant_value_desc(&value) : error);
+		result = (SUCCEED == ret ? zbx_variant_value_desc(value) : *error);
 		zabbix_log(LOG_LEVEL_DEBUG, "%s(): %s", __func__, zbx_variant_value_desc(&value_start));
 		zabbix_log(LOG_LEVEL_DEBUG, "%s: %s %s",__func__, zbx_result_string(ret), result);
 	}
 
+	zbx_variant_clear(&value_start);
+
+	for (i = 0; i < results_num; i++)
+		zbx_variant_clear(&results[i].value);
+	zbx_free(results);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: handle item value preprocessing task                              *
+ *                                                                            *
+ * Parameters: socket  - [IN] IPC socket                                      *
+ *             message - [IN] packed preprocessing task                       *
+ *                                                                            *
+ ******************************************************************************/
+static void	worker_preprocess_value(zbx_ipc_socket_t *socket, zbx_ipc_message_t *message)
+{
+	zbx_uint32_t		size = 0;
+	unsigned char		*data = NULL, value_type;
+	zbx_uint64_t		itemid;
+	zbx_variant_t		value;
+	int			steps_num;
+	char			*error = NULL;
+	zbx_timespec_t		*ts;
+	zbx_preproc_op_t	*steps;
+	zbx_vector_ptr_t	history_in, history_out;
+
+	zbx_vector_ptr_create(&history_in);
+	zbx_vector_ptr_create(&history_out);
+
+	zbx_preprocessor_unpack_task(&itemid, &value_type, &ts, &value, &history_in, &steps, &steps_num,
+			message->data);
+
+	(void)zbx_preprocessor_execute_steps(value_type, &value, ts, steps, steps_num, &history_in, &history_out,
+			&error);
+
 	size = zbx_preprocessor_pack_result(&data, &value, &history_out, error);
 	zbx_variant_clear(&value);
 	zbx_free(error);
@@ -352,12 +393,6 @@ static void	worker_preprocess_value(zbx_ipc_socket_t *socket, zbx_ipc_message_t
 
 	zbx_free(data);
 
-	zbx_variant_clear(&value_start);
-
-	for (i = 0; i < results_num; i++)
-		zbx_variant_clear(&results[i].value);
-	zbx_free(results);
-
 	zbx_vector_ptr_clear_ext(&history_out, (zbx_clean_func_t)zbx_preproc_op_history_free);
 	zbx_vector_ptr_destroy(&history_out);
 
@@ -593,7 +628,9 @@ ZBX_THREAD_ENTRY(preprocessing_worker_thread, args)
 
 	zbx_ipc_message_init(&message);
 
-	if (FAIL == zbx_ipc_socket_open(&socket, ZBX_IPC_SERVICE_PREPROCESSING, SEC_PER_MIN, &error))
+	/* workers are distributed between preprocessing managers by process number */
+	if (FAIL == zbx_ipc_socket_open(&socket, zbx_preprocessor_service_name(
+			zbx_preprocessor_worker_manager(process_num)), SEC_PER_MIN, &error))
 	{
 		zabbix_log(LOG_LEVEL_CRIT, "cannot connect to preprocessing service: %s", error);
 		zbx_free(error);
@@ -21,7 +21,13 @@
 #define ZABBIX_PREPROCESSING_WORKER_H
 
 #include "threads.h"
+#include "zbxvariant.h"
+#include "preproc.h"
 
 ZBX_THREAD_ENTRY(preprocessing_worker_thread, args);
 
+int	zbx_preprocessor_execute_steps(unsigned char value_type, zbx_variant_t *value, const zbx_timespec_t *ts,
+		zbx_preproc_op_t *steps, int steps_num, zbx_vector_ptr_t *history_in, zbx_vector_ptr_t *history_out,
+		char **error);
+
 #endif
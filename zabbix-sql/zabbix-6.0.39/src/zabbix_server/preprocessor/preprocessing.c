@@ -23,9 +23,13 @@
 #include "log.h"
 #include "zbxserialize.h"
 #include "preproc_history.h"
+#include "preproc_manager.h"
 #include "item_preproc.h"
 #include "../../libs/zbxalgo/vectorimpl.h"
 
+extern int	CONFIG_PREPROCMAN_FORKS;
+extern int	CONFIG_PREPROCESSOR_FORKS;
+
 #define PACKED_FIELD_RAW	0
 #define PACKED_FIELD_STRING	1
 #define MAX_VALUES_LOCAL	256
@@ -33,8 +37,9 @@
 #define PACKED_FIELD(value, size)	\
 		(zbx_packed_field_t){(value), (size), (0 == (size) ? PACKED_FIELD_STRING : PACKED_FIELD_RAW)};
 
-static zbx_ipc_message_t	cached_message;
-static int			cached_values;
+/* values cached for each preprocessing manager */
+static zbx_ipc_message_t	cached_messages[ZBX_PREPROCESSING_MANAGERS_MAX];
+static int			cached_values[ZBX_PREPROCESSING_MANAGERS_MAX];
 
 ZBX_PTR_VECTOR_IMPL(ipcmsg, zbx_ipc_message_t *)
 
@@ -1471,44 +1476,120 @@ void	zbx_preprocessor_unpack_top_result(zbx_vector_ptr_t *items, const unsigned
 	}
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets IPC service name of preprocessing manager                    *
+ *                                                                            *
+ * Parameters: manager_num - [IN] the preprocessing manager process number    *
+ *                                (1..StartPreprocessingManagers)             *
+ *                                                                            *
+ * Return value: the service name                                             *
+ *                                                                            *
+ * Comments: The first manager uses the default service name. The returned    *
+ *           name is stored in static buffer and is valid until next call.    *
+ *                                                                            *
+ ******************************************************************************/
+const char	*zbx_preprocessor_service_name(int manager_num)
+{
+	static char	name[MAX_ID_LEN + sizeof(ZBX_IPC_SERVICE_PREPROCESSING)];
+
+	if (1 == manager_num)
+		return ZBX_IPC_SERVICE_PREPROCESSING;
+
+	zbx_snprintf(name, sizeof(name), ZBX_IPC_SERVICE_PREPROCESSING "%d", manager_num);
+
+	return name;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets preprocessing manager serving the specified worker           *
+ *                                                                            *
+ * Parameters: worker_num - [IN] the preprocessing worker process number      *
+ *                                                                            *
+ * Return value: the preprocessing manager process number                     *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_preprocessor_worker_manager(int worker_num)
+{
+	return (worker_num - 1) % CONFIG_PREPROCMAN_FORKS + 1;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets the number of workers served by preprocessing manager        *
+ *                                                                            *
+ * Parameters: manager_num - [IN] the preprocessing manager process number    *
+ *                                                                            *
+ * Return value: the number of preprocessing workers                          *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_preprocessor_manager_worker_count(int manager_num)
+{
+	return CONFIG_PREPROCESSOR_FORKS / CONFIG_PREPROCMAN_FORKS +
+			(manager_num <= CONFIG_PREPROCESSOR_FORKS % CONFIG_PREPROCMAN_FORKS ? 1 : 0);
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: sends command to preprocessor manager                             *
  *                                                                            *
- * Parameters: code     - [IN] message code                                   *
- *             data     - [IN] message data                                   *
- *             size     - [IN] message data size                              *
- *             response - [OUT] response message (can be NULL if response is  *
- *                              not requested)                                *
+ * Parameters: manager_num - [IN] the preprocessing manager process number    *
+ *             code        - [IN] message code                                *
+ *             data        - [IN] message data                                *
+ *             size        - [IN] message data size                           *
+ *             response    - [OUT] response message (can be NULL if response  *
+ *                                 is not requested)                          *
  *                                                                            *
  ******************************************************************************/
-static void	preprocessor_send(zbx_uint32_t code, unsigned char *data, zbx_uint32_t size,
+static void	preprocessor_send(int manager_num, zbx_uint32_t code, unsigned char *data, zbx_uint32_t size,
 		zbx_ipc_message_t *response)
 {
 	char			*error = NULL;
-	static zbx_ipc_socket_t	socket = {0};
+	static zbx_ipc_socket_t	sockets[ZBX_PREPROCESSING_MANAGERS_MAX];
+	zbx_ipc_socket_t	*socket = &sockets[manager_num - 1];
 
-	/* each process has a permanent connection to preprocessing manager */
-	if (0 == socket.fd && FAIL == zbx_ipc_socket_open(&socket, ZBX_IPC_SERVICE_PREPROCESSING, SEC_PER_MIN,
-			&error))
+	/* each process has a permanent connection to preprocessing managers */
+	if (0 == socket->fd && FAIL == zbx_ipc_socket_open(socket, zbx_preprocessor_service_name(manager_num),
+			SEC_PER_MIN, &error))
 	{
 		zabbix_log(LOG_LEVEL_CRIT, "cannot connect to preprocessing service: %s", error);
 		exit(EXIT_FAILURE);
 	}
 
-	if (FAIL == zbx_ipc_socket_write(&socket, code, data, size))
+	if (FAIL == zbx_ipc_socket_write(socket, code, data, size))
 	{
 		zabbix_log(LOG_LEVEL_CRIT, "cannot send data to preprocessing service");
 		exit(EXIT_FAILURE);
 	}
 
-	if (NULL != response && FAIL == zbx_ipc_socket_read(&socket, response))
+	if (NULL != response && FAIL == zbx_ipc_socket_read(socket, response))
 	{
 		zabbix_log(LOG_LEVEL_CRIT, "cannot receive data from preprocessing service");
 		exit(EXIT_FAILURE);
 	}
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: sends values cached for preprocessing manager                     *
+ *                                                                            *
+ * Parameters: index - [IN] the preprocessing manager index                   *
+ *                                                                            *
+ ******************************************************************************/
+static void	preprocessor_flush_manager(int index)
+{
+	if (0 < cached_messages[index].size)
+	{
+		preprocessor_send(index + 1, ZBX_IPC_PREPROCESSOR_REQUEST, cached_messages[index].data,
+				cached_messages[index].size, NULL);
+
+		zbx_ipc_message_clean(&cached_messages[index]);
+		zbx_ipc_message_init(&cached_messages[index]);
+		cached_values[index] = 0;
+	}
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: perform item value preprocessing and dependent item processing    *
@@ -1524,6 +1605,10 @@ static void	preprocessor_send(zbx_uint32_t code, unsigned char *data, zbx_uint32
  *             error           - [IN] the error message in case item state is *
  *                               ITEM_STATE_NOTSUPPORTED                      *
  *                                                                            *
+ * Comments: Values are routed to preprocessing managers by itemid, so all    *
+ *           values of an item and its dependent items are processed by the   *
+ *           same manager.                                                    *
+ *                                                                            *
  ******************************************************************************/
 void	zbx_preprocess_item_value(zbx_uint64_t itemid, zbx_uint64_t hostid, unsigned char item_value_type,
 		unsigned char item_flags, AGENT_RESULT *result, zbx_timespec_t *ts, unsigned char state, char *error)
@@ -1532,6 +1617,7 @@ void	zbx_preprocess_item_value(zbx_uint64_t itemid, zbx_uint64_t hostid, unsigne
 					.error = error, .item_flags = item_flags, .state = state, .ts = ts,
 					.result = result};
 	size_t				value_len = 0, len;
+	int				index;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -1560,53 +1646,57 @@ void	zbx_preprocess_item_value(zbx_uint64_t itemid, zbx_uint64_t hostid, unsigne
 		}
 	}
 
-	if (0 == preprocessor_pack_value(&cached_message, &value))
+	index = (int)(itemid % (zbx_uint64_t)CONFIG_PREPROCMAN_FORKS);
+
+	if (0 == preprocessor_pack_value(&cached_messages[index], &value))
 	{
-		zbx_preprocessor_flush();
-		preprocessor_pack_value(&cached_message, &value);
+		preprocessor_flush_manager(index);
+		preprocessor_pack_value(&cached_messages[index], &value);
 	}
 
-	if (MAX_VALUES_LOCAL < ++cached_values)
-		zbx_preprocessor_flush();
+	if (MAX_VALUES_LOCAL < ++cached_values[index])
+		preprocessor_flush_manager(index);
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: send flush command to preprocessing manager                       *
+ * Purpose: send flush command to preprocessing managers                      *
  *                                                                            *
  ******************************************************************************/
 void	zbx_preprocessor_flush(void)
 {
-	if (0 < cached_message.size)
-	{
-		preprocessor_send(ZBX_IPC_PREPROCESSOR_REQUEST, cached_message.data, cached_message.size, NULL);
+	int	i;
 
-		zbx_ipc_message_clean(&cached_message);
-		zbx_ipc_message_init(&cached_message);
-		cached_values = 0;
-	}
+	for (i = 0; i < CONFIG_PREPROCMAN_FORKS; i++)
+		preprocessor_flush_manager(i);
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: get queue size (enqueued value count) of preprocessing manager    *
+ * Purpose: get queue size (enqueued value count) of preprocessing managers   *
  *                                                                            *
  * Return value: enqueued item count                                          *
  *                                                                            *
  ******************************************************************************/
 zbx_uint64_t	zbx_preprocessor_get_queue_size(void)
 {
-	zbx_uint64_t		size;
+	zbx_uint64_t		size, total = 0;
 	zbx_ipc_message_t	message;
+	int			i;
 
-	zbx_ipc_message_init(&message);
-	preprocessor_send(ZBX_IPC_PREPROCESSOR_QUEUE, NULL, 0, &message);
-	memcpy(&size, message.data, sizeof(zbx_uint64_t));
-	zbx_ipc_message_clean(&message);
+	for (i = 1; i <= CONFIG_PREPROCMAN_FORKS; i++)
+	{
+		zbx_ipc_message_init(&message);
+		preprocessor_send(i, ZBX_IPC_PREPROCESSOR_QUEUE, NULL, 0, &message);
+		memcpy(&size, message.data, sizeof(zbx_uint64_t));
+		zbx_ipc_message_clean(&message);
 
-	return size;
+		total += size;
+	}
+
+	return total;
 }
 
 /******************************************************************************
@@ -1742,45 +1832,136 @@ out:
  *                                                                            *
  * Purpose: get preprocessing manager diagnostic statistics                   *
  *                                                                            *
+ * Comments: The statistics are summed over all preprocessing managers.       *
+ *                                                                            *
  ******************************************************************************/
 int	zbx_preprocessor_get_diag_stats(int *total, int *queued, int *processing, int *done,
 		int *pending, char **error)
 {
 	unsigned char	*result;
+	int		i, m_total, m_queued, m_processing, m_done, m_pending;
 
-	if (SUCCEED != zbx_ipc_async_exchange(ZBX_IPC_SERVICE_PREPROCESSING, ZBX_IPC_PREPROCESSOR_DIAG_STATS,
-			SEC_PER_MIN, NULL, 0, &result, error))
+	*total = *queued = *processing = *done = *pending = 0;
+
+	for (i = 1; i <= CONFIG_PREPROCMAN_FORKS; i++)
 	{
-		return FAIL;
-	}
+		if (SUCCEED != zbx_ipc_async_exchange(zbx_preprocessor_service_name(i), ZBX_IPC_PREPROCESSOR_DIAG_STATS,
+				SEC_PER_MIN, NULL, 0, &result, error))
+		{
+			return FAIL;
+		}
 
-	zbx_preprocessor_unpack_diag_stats(total, queued, processing, done, pending, result);
-	zbx_free(result);
+		zbx_preprocessor_unpack_diag_stats(&m_total, &m_queued, &m_processing, &m_done, &m_pending, result);
+		zbx_free(result);
+
+		*total += m_total;
+		*queued += m_queued;
+		*processing += m_processing;
+		*done += m_done;
+		*pending += m_pending;
+	}
 
 	return SUCCEED;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: compare item statistics by value                                  *
+ *                                                                            *
+ ******************************************************************************/
+static int	preprocessor_compare_item_stats_by_values_desc(const void *d1, const void *d2)
+{
+	const zbx_preproc_item_stats_t	*i1 = *(const zbx_preproc_item_stats_t * const *)d1;
+	const zbx_preproc_item_stats_t	*i2 = *(const zbx_preproc_item_stats_t * const *)d2;
+
+	return i2->values_num - i1->values_num;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: get the top N items by the number of queued values                *
  *                                                                            *
+ * Comments: Top items are requested from every preprocessing manager. Items  *
+ *           by the number of queued values are sorted again while the oldest *
+ *           items are merged by taking one item from each manager in turn.   *
+ *                                                                            *
  ******************************************************************************/
 static int	preprocessor_get_top_items(int limit, zbx_vector_ptr_t *items, char **error, zbx_uint32_t code)
 {
-	int		ret;
-	unsigned char	*data, *result;
-	zbx_uint32_t	data_len;
+	int			ret = SUCCEED, i, j, added;
+	unsigned char		*data, *result;
+	zbx_uint32_t		data_len;
+	zbx_vector_ptr_t	manager_items[ZBX_PREPROCESSING_MANAGERS_MAX];
 
 	data_len = zbx_preprocessor_pack_top_items_request(&data, limit);
 
-	if (SUCCEED != (ret = zbx_ipc_async_exchange(ZBX_IPC_SERVICE_PREPROCESSING, code, SEC_PER_MIN, data, data_len,
-			&result, error)))
+	if (1 == CONFIG_PREPROCMAN_FORKS)
 	{
+		if (SUCCEED != (ret = zbx_ipc_async_exchange(ZBX_IPC_SERVICE_PREPROCESSING, code, SEC_PER_MIN, data,
+				data_len, &result, error)))
+		{
+			goto out;
+		}
+
+		zbx_preprocessor_unpack_top_result(items, result);
+		zbx_free(result);
 		goto out;
 	}
 
-	zbx_preprocessor_unpack_top_result(items, result);
-	zbx_free(result);
+	for (i = 0; i < CONFIG_PREPROCMAN_FORKS; i++)
+		zbx_vector_ptr_create(&manager_items[i]);
+
+	for (i = 0; i < CONFIG_PREPROCMAN_FORKS; i++)
+	{
+		if (SUCCEED != (ret = zbx_ipc_async_exchange(zbx_preprocessor_service_name(i + 1), code, SEC_PER_MIN,
+				data, data_len, &result, error)))
+		{
+			goto clean;
+		}
+
+		zbx_preprocessor_unpack_top_result(&manager_items[i], result);
+		zbx_free(result);
+	}
+
+	if (ZBX_IPC_PREPROCESSOR_TOP_ITEMS == code)
+	{
+		for (i = 0; i < CONFIG_PREPROCMAN_FORKS; i++)
+		{
+			zbx_vector_ptr_append_array(items, manager_items[i].values, manager_items[i].values_num);
+			zbx_vector_ptr_clear(&manager_items[i]);
+		}
+
+		zbx_vector_ptr_sort(items, preprocessor_compare_item_stats_by_values_desc);
+	}
+	else
+	{
+		for (j = 0, added = 1; 0 != added; j++)
+		{
+			for (i = 0, added = 0; i < CONFIG_PREPROCMAN_FORKS; i++)
+			{
+				if (j < manager_items[i].values_num)
+				{
+					zbx_vector_ptr_append(items, manager_items[i].values[j]);
+					added = 1;
+				}
+			}
+		}
+
+		for (i = 0; i < CONFIG_PREPROCMAN_FORKS; i++)
+			zbx_vector_ptr_clear(&manager_items[i]);
+	}
+
+	while (items->values_num > limit)
+	{
+		zbx_free(items->values[items->values_num - 1]);
+		zbx_vector_ptr_remove_noorder(items, items->values_num - 1);
+	}
+clean:
+	for (i = 0; i < CONFIG_PREPROCMAN_FORKS; i++)
+	{
+		zbx_vector_ptr_clear_ext(&manager_items[i], zbx_ptr_free);
+		zbx_vector_ptr_destroy(&manager_items[i]);
+	}
 out:
 	zbx_free(data);
 
@@ -80,6 +80,10 @@ typedef struct
 }
 zbx_preproc_dep_result_t;
 
+const char	*zbx_preprocessor_service_name(int manager_num);
+int	zbx_preprocessor_worker_manager(int worker_num);
+int	zbx_preprocessor_manager_worker_count(int manager_num);
+
 zbx_uint32_t	zbx_preprocessor_pack_task(unsigned char **data, zbx_uint64_t itemid, unsigned char value_type,
 		zbx_timespec_t *ts, zbx_variant_t *value, const zbx_vector_ptr_t *history,
 		const zbx_preproc_op_t *steps, int steps_num);
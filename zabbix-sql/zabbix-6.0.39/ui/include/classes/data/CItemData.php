@@ -1751,7 +1751,7 @@ final class CItemData {
 				'value_type' => null
 			],
 			'zabbix[wcache,<cache>,<mode>]' => [
-				'description' => _('Statistics and availability of Zabbix write cache. Cache - one of values (modes: all, float, uint, str, log, text, not supported), history (modes: pfree, free, total, used, pused), index (modes: pfree, free, total, used, pused), trend (modes: pfree, free, total, used, pused).'),
+				'description' => _('Statistics and availability of Zabbix write cache. Cache - one of values (modes: all, float, uint, str, log, text, not supported), history (modes: pfree, free, total, used, pused), index (modes: pfree, free, total, used, pused), trend (modes: pfree, free, total, used, pused), ring (modes: pfree, free, total, used, pused, values, overflow).'),
 				'value_type' => null
 			]
 		];